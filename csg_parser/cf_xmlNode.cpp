@@ -16,9 +16,45 @@
 #include "cf_xmlNode.h"
 
 #include <boost/algorithm/string.hpp>
+#include <cstdlib>
+#include <climits>
 using namespace std;
 using namespace boost::algorithm;
 
+// numeric conversion of property and value text. As for the iostream conversions
+// of the property tree, the whole text except surrounding whitespace must be used
+static bool only_space(const char* text)
+{
+   while(*text==' ' || *text=='\t' || *text=='\n' || *text=='\r') text++;
+   return *text == 0;
+}
+
+static bool to_number(const string& text, double& value)
+{
+   const char* first = text.c_str();
+   char* last = 0;
+   value = strtod(first,&last);
+   return last!=first && only_space(last);
+}
+
+static bool to_number(const string& text, size_t& value)
+{
+   const char* first = text.c_str();
+   char* last = 0;
+   value = static_cast<size_t>(strtoull(first,&last,10));
+   return last!=first && only_space(last);
+}
+
+static bool to_number(const string& text, int& value)
+{
+   const char* first = text.c_str();
+   char* last = 0;
+   long v = strtol(first,&last,10);
+   if(v < INT_MIN || v > INT_MAX) return false;
+   value = static_cast<int>(v);
+   return last!=first && only_space(last);
+}
+
 cf_xmlNode::cf_xmlNode()
 {}
 
@@ -47,7 +83,7 @@ bool cf_xmlNode::is_valid() const
    return (bool)m_ptree_node;
 }
 
-string cf_xmlNode::tag() const
+const string& cf_xmlNode::tag() const
 {
    return m_tag;
 }
@@ -97,58 +133,54 @@ bool cf_xmlNode::add_property(const string& name, double value)
    return false;
 }
 
-bool cf_xmlNode::has_property(const string& name) const
+const string* cf_xmlNode::find_property(const string& name) const
 {
    if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<string> v = m_ptree_node.get().get_optional<string>(attrib); // anything can be represented as a string
-      return (bool)v;
+      const ptree& node = m_ptree_node.get();
+      ptree::const_assoc_iterator iattr = node.find("<xmlattr>");
+      if(iattr != node.not_found()) {
+         ptree::const_assoc_iterator iprop = iattr->second.find(name);
+         if(iprop != iattr->second.not_found()) return &iprop->second.data();
+      }
    }
-   return false;
+   return 0;
+}
+
+bool cf_xmlNode::has_property(const string& name) const
+{
+   return find_property(name) != 0;
 }
 
 string cf_xmlNode::get_property(const string& name, const string& default_value) const
 {
-   if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<string> v = m_ptree_node.get().get_optional<string>(attrib);
-      if(v) {
-         trim(v.get());
-         return v.get();
-      }
+   if(const string* v = find_property(name)) {
+      return trim_copy(*v);
    }
    return  default_value;
 }
 
 size_t cf_xmlNode::get_property(const string& name, size_t default_value) const
 {
-   if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<size_t> v = m_ptree_node.get().get_optional<size_t>(attrib);
-      if(v) return v.get();
-   }
+   size_t value = 0;
+   const string* v = find_property(name);
+   if(v && to_number(*v,value)) return value;
    return  default_value;
 }
 
 
 int    cf_xmlNode::get_property(const string& name, int default_value) const
 {
-   if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<int> v = m_ptree_node.get().get_optional<int>(attrib);
-      if(v) return v.get();
-   }
+   int value = 0;
+   const string* v = find_property(name);
+   if(v && to_number(*v,value)) return value;
    return  default_value;
 }
 
 double cf_xmlNode::get_property(const string& name, double default_value) const
 {
-   if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<double> v = m_ptree_node.get().get_optional<double>(attrib);
-      if(v) return v.get();
-      return  default_value;
-   }
+   double value = 0.0;
+   const string* v = find_property(name);
+   if(v && to_number(*v,value)) return value;
    return  default_value;
 }
 
@@ -200,31 +232,22 @@ string cf_xmlNode::get_value(const string& default_value) const
 
 size_t cf_xmlNode::get_value(size_t default_value) const
 {
-   if(m_ptree_node) {
-      boost::optional<size_t> v = m_ptree_node.get().get_value_optional<size_t>();
-      if(v) return v.get();
-      return  default_value;
-   }
+   size_t value = 0;
+   if(m_ptree_node && to_number(m_ptree_node.get().data(),value)) return value;
    return  default_value;
 }
 
 int  cf_xmlNode::get_value(int default_value) const
 {
-   if(m_ptree_node) {
-      boost::optional<int> v = m_ptree_node.get().get_value_optional<int>();
-      if(v) return v.get();
-      return  default_value;
-   }
+   int value = 0;
+   if(m_ptree_node && to_number(m_ptree_node.get().data(),value)) return value;
    return  default_value;
 }
 
 double cf_xmlNode::get_value(double default_value) const
 {
-   if(m_ptree_node) {
-      boost::optional<double> v = m_ptree_node.get().get_value_optional<double>();
-      if(v) return v.get();
-      return  default_value;
-   }
+   double value = 0.0;
+   if(m_ptree_node && to_number(m_ptree_node.get().data(),value)) return value;
    return  default_value;
 }
 
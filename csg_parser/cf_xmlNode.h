@@ -39,7 +39,7 @@ public:
    // return the tag of the node.
    // NOTE: The tag "<xmlattr>" is reserved and indicates a node containing attributes.
    // Du NOT try to read properties from such a node. Use instead get_property(...) for the the parent node.
-   string tag() const;
+   const string& tag() const;
 
    // return true if this is a special node containing attributes (ref.  "<xmlattr>" )
    bool is_attribute_node() const;
@@ -104,6 +104,9 @@ public:
 private:
    cf_xmlNode(const string& tag, ptree& m_ptree_node);
 
+   // return the text of named property, or null if not found
+   const string* find_property(const string& name) const;
+
 private:
    string  m_tag;
    boost::optional<ptree &> m_ptree_node;
@@ -0,0 +1,335 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "cf_xmlReader.h"
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static inline bool is_space(char c)
+{
+   return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+static inline bool is_name_char(char c)
+{
+   return !is_space(c) && c!='/' && c!='>' && c!='=' && c!='<' && c!='?' && c!='!' && c!='"' && c!='\'';
+}
+
+// parser state for one document
+class xml_scanner {
+public:
+   typedef cf_xmlReader::ptree ptree;
+
+   xml_scanner(const char* begin, const char* end, const cf_xmlReader::raw_blocks& raw)
+   : m_begin(begin)
+   , m_pos(begin)
+   , m_end(end)
+   , m_raw(raw)
+   , m_attributes(std::string("<xmlattr>"),ptree())
+   {}
+
+   void parse(ptree& tree);
+
+private:
+   void error(const std::string& message) const;
+   bool starts_with(const char* text) const;
+   void skip_past(const char* text);
+   void skip_space() { while(m_pos<m_end && is_space(*m_pos)) m_pos++; }
+
+   // scan a name, returns a prototype child with the name as key and an empty tree
+   const ptree::value_type& name();
+
+   // append text [first,last) with entities decoded
+   void decode(const char* first, const char* last, std::string& value) const;
+
+   // append text [first,last) trimmed, with whitespace collapsed and entities decoded
+   void append_text(const char* first, const char* last, std::string& data) const;
+
+   typedef std::vector<std::pair<ptree*,const std::string*>> open_elements;
+   void element(open_elements& open);
+
+   // m_pos is after the start tag of node, store the content as raw text if selected
+   bool raw_block(const std::string& parent, const std::string& tag, ptree& node);
+
+private:
+   const char* m_begin;
+   const char* m_pos;
+   const char* m_end;
+   const cf_xmlReader::raw_blocks& m_raw;
+
+   // Inserting a copy of a prototype is much cheaper than constructing each tree child.
+   // Documents use few distinct element and attribute names, so one prototype per name is kept
+   std::deque<ptree::value_type> m_names;
+   const ptree::value_type       m_attributes;
+};
+
+void xml_scanner::error(const std::string& message) const
+{
+   size_t line = 1 + std::count(m_begin,m_pos,'\n');
+   std::ostringstream out;
+   out << "XML error at line " << line << ": " << message;
+   throw std::runtime_error(out.str());
+}
+
+bool xml_scanner::starts_with(const char* text) const
+{
+   size_t len = strlen(text);
+   return size_t(m_end-m_pos) >= len && std::equal(text,text+len,m_pos);
+}
+
+void xml_scanner::skip_past(const char* text)
+{
+   const char* found = std::search(m_pos,m_end,text,text+strlen(text));
+   if(found == m_end) error(std::string("missing '") + text + "'");
+   m_pos = found + strlen(text);
+}
+
+const xml_scanner::ptree::value_type& xml_scanner::name()
+{
+   const char* first = m_pos;
+   while(m_pos<m_end && is_name_char(*m_pos)) m_pos++;
+   if(m_pos == first) error("expected name");
+
+   const size_t len = m_pos - first;
+   for(auto& proto : m_names) {
+      if(proto.first.size()==len && std::equal(first,m_pos,proto.first.begin())) return proto;
+   }
+   const size_t max_names = 256;
+   if(m_names.size() == max_names) m_names.pop_front();
+   m_names.push_back(ptree::value_type(std::string(first,m_pos),ptree()));
+   return m_names.back();
+}
+
+void xml_scanner::decode(const char* first, const char* last, std::string& value) const
+{
+   while(first < last) {
+      const char* amp = std::find(first,last,'&');
+      value.append(first,amp);
+      if(amp == last) break;
+
+      const char* semi = std::find(amp,last,';');
+      if(semi == last) error("unterminated entity");
+      std::string entity(amp+1,semi);
+      if(entity == "lt")        value += '<';
+      else if(entity == "gt")   value += '>';
+      else if(entity == "amp")  value += '&';
+      else if(entity == "quot") value += '"';
+      else if(entity == "apos") value += '\'';
+      else if(entity.size()>1 && entity[0]=='#') {
+         unsigned long code = (entity[1]=='x')? strtoul(entity.c_str()+2,0,16) : strtoul(entity.c_str()+1,0,10);
+
+         // UTF-8 encoding of the character
+         if(code < 0x80)        value += char(code);
+         else if(code < 0x800)  { value += char(0xC0 | (code>>6));  value += char(0x80 | (code & 0x3F)); }
+         else if(code < 0x10000){ value += char(0xE0 | (code>>12)); value += char(0x80 | ((code>>6) & 0x3F)); value += char(0x80 | (code & 0x3F)); }
+         else                   { value += char(0xF0 | (code>>18)); value += char(0x80 | ((code>>12) & 0x3F)); value += char(0x80 | ((code>>6) & 0x3F)); value += char(0x80 | (code & 0x3F)); }
+      }
+      else error("unknown entity '&" + entity + ";'");
+      first = semi+1;
+   }
+}
+
+void xml_scanner::append_text(const char* first, const char* last, std::string& data) const
+{
+   while(first<last && is_space(*first)) first++;
+   while(last>first && is_space(*(last-1))) last--;
+   if(first == last) return;
+
+   // collapse inner whitespace to single spaces, the common case has none
+   if(std::find_if(first,last,[](char c) { return c=='\t' || c=='\n' || c=='\r'; }) == last && std::search_n(first,last,2,' ') == last) {
+      decode(first,last,data);
+      return;
+   }
+   std::string collapsed;
+   collapsed.reserve(last-first);
+   while(first < last) {
+      if(is_space(*first)) {
+         collapsed += ' ';
+         while(first<last && is_space(*first)) first++;
+      }
+      else collapsed += *first++;
+   }
+   decode(collapsed.data(),collapsed.data()+collapsed.size(),data);
+}
+
+void xml_scanner::element(open_elements& open)
+{
+   // m_pos is just after '<'
+   ptree::iterator inode = open.back().first->push_back(name());
+   ptree& node = inode->second;
+   const std::string& tag = inode->first;
+
+   ptree* attributes = 0;
+   while(true) {
+      skip_space();
+      if(m_pos >= m_end) error("unterminated element <" + tag + ">");
+      if(*m_pos == '/') {
+         if(m_pos+1>=m_end || m_pos[1]!='>') error("expected '/>' in element <" + tag + ">");
+         m_pos += 2;
+         return;
+      }
+      if(*m_pos == '>') {
+         m_pos++;
+         if(m_raw.min_bytes>0 && open.size()>1 && raw_block(*open.back().second,tag,node)) return;
+         open.push_back(std::make_pair(&node,&tag));
+         return;
+      }
+
+      const ptree::value_type& attrib = name();
+      skip_space();
+      if(m_pos>=m_end || *m_pos!='=') error("expected '=' after attribute " + attrib.first);
+      m_pos++;
+      skip_space();
+      if(m_pos>=m_end || (*m_pos!='"' && *m_pos!='\'')) error("expected quoted value for attribute " + attrib.first);
+      const char quote = *m_pos++;
+      const char* value_end = std::find(m_pos,m_end,quote);
+      if(value_end == m_end) error("unterminated value for attribute " + attrib.first);
+
+      if(!attributes) attributes = &node.push_back(m_attributes)->second;
+      ptree& value = attributes->push_back(attrib)->second;
+      decode(m_pos,value_end,value.data());
+      m_pos = value_end+1;
+   }
+}
+
+bool xml_scanner::raw_block(const std::string& parent, const std::string& tag, ptree& node)
+{
+   auto ielem = m_raw.elements.find(tag);
+   if(ielem==m_raw.elements.end() || ielem->second.count(parent)==0) return false;
+
+   const std::string end_tag = "</" + tag;
+   const char* close = std::search(m_pos,m_end,end_tag.begin(),end_tag.end());
+   if(close == m_end) error("unterminated element <" + tag + ">");
+   if(size_t(close-m_pos) < m_raw.min_bytes) return false;
+
+   node.push_back(ptree::value_type(std::string("<xmlraw>"),ptree()))->second.data().assign(m_pos,close);
+   m_pos = close + end_tag.size();
+   skip_space();
+   if(m_pos>=m_end || *m_pos!='>') error("expected '>' in closing tag </" + tag + ">");
+   m_pos++;
+   return true;
+}
+
+void xml_scanner::parse(ptree& tree)
+{
+   // stack of open elements, the document itself at the bottom
+   open_elements open;
+   open.push_back(std::make_pair(&tree,static_cast<const std::string*>(0)));
+
+   while(m_pos < m_end) {
+      if(*m_pos != '<') {
+         const char* first = m_pos;
+         m_pos = std::find(m_pos,m_end,'<');
+         if(open.size() > 1) append_text(first,m_pos,open.back().first->data());
+      }
+      else if(starts_with("<?")) {
+         skip_past("?>");
+      }
+      else if(starts_with("<!--")) {
+         m_pos += 4;
+         const char* first = m_pos;
+         skip_past("-->");
+         ptree& comment = open.back().first->push_back(ptree::value_type(std::string("<xmlcomment>"),ptree()))->second;
+         comment.data().assign(first,m_pos-3);
+      }
+      else if(starts_with("<![CDATA[")) {
+         m_pos += 9;
+         const char* first = m_pos;
+         skip_past("]]>");
+         if(open.size() > 1) open.back().first->data().append(first,m_pos-3);
+      }
+      else if(starts_with("<!")) {
+         // DOCTYPE, possibly with an internal subset
+         int depth = 0;
+         for(; m_pos<m_end; m_pos++) {
+            if(*m_pos == '[') depth++;
+            else if(*m_pos == ']') depth--;
+            else if(*m_pos == '>' && depth == 0) break;
+         }
+         if(m_pos == m_end) error("unterminated declaration");
+         m_pos++;
+      }
+      else if(starts_with("</")) {
+         m_pos += 2;
+         const std::string& tag = name().first;
+         skip_space();
+         if(m_pos>=m_end || *m_pos!='>') error("expected '>' in closing tag </" + tag + ">");
+         m_pos++;
+         if(open.size()<2 || *open.back().second!=tag) error("unexpected closing tag </" + tag + ">");
+         open.pop_back();
+      }
+      else {
+         m_pos++;
+         element(open);
+      }
+   }
+   if(open.size() > 1) error("unterminated element <" + *open.back().second + ">");
+}
+
+void cf_xmlReader::parse(const char* begin, const char* end, ptree& tree, const raw_blocks& raw)
+{
+   xml_scanner scanner(begin,end,raw);
+   scanner.parse(tree);
+}
+
+bool cf_xmlReader::parse_file(const std::string& path, ptree& tree, const raw_blocks& raw)
+{
+#ifndef _WIN32
+   int fd = ::open(path.c_str(),O_RDONLY);
+   if(fd < 0) return false;
+   struct stat st;
+   if(fstat(fd,&st) != 0) {
+      ::close(fd);
+      return false;
+   }
+   size_t len = size_t(st.st_size);
+   if(len == 0) {
+      ::close(fd);
+      return true;
+   }
+   void* data = mmap(0,len,PROT_READ,MAP_PRIVATE,fd,0);
+   ::close(fd);
+   if(data != MAP_FAILED) {
+      madvise(data,len,MADV_SEQUENTIAL);
+      try {
+         parse(static_cast<const char*>(data),static_cast<const char*>(data)+len,tree,raw);
+      }
+      catch(...) {
+         munmap(data,len);
+         throw;
+      }
+      munmap(data,len);
+      return true;
+   }
+#endif
+
+   // read the whole file in one go
+   std::ifstream in(path.c_str(),std::ios::binary);
+   if(!in.is_open()) return false;
+   std::string text((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+   parse(text.data(),text.data()+text.size(),tree,raw);
+   return true;
+}
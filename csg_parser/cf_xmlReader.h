@@ -0,0 +1,51 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef CF_XMLREADER_H
+#define CF_XMLREADER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <string>
+#include <map>
+#include <set>
+
+// cf_xmlReader is a fast in-situ XML parser for large .xcsg files. The document is
+// memory mapped (where supported) and scanned once, element names, attributes and text
+// are taken directly from the input and stored in the property tree without any
+// intermediate DOM. The tree has the same layout as boost::property_tree::read_xml
+// with the trim_whitespace flag: attributes under "<xmlattr>", comments as "<xmlcomment>"
+// and element text trimmed, with inner whitespace collapsed.
+//
+// Optionally, the content of selected large elements is not parsed, but kept as text
+// in a "<xmlraw>" child, so the caller may parse bulk data by other means (in parallel).
+
+class cf_xmlReader {
+public:
+   typedef boost::property_tree::ptree ptree;
+
+   // elements kept as raw text when their content is at least min_bytes
+   struct raw_blocks {
+      raw_blocks() : min_bytes(0) {}
+      std::map<std::string,std::set<std::string>> elements;  // element tag -> parent tags
+      size_t                                      min_bytes;  // 0 means no raw blocks
+   };
+
+   // parse document text [begin,end) into tree, throws std::runtime_error on syntax errors
+   static void parse(const char* begin, const char* end, ptree& tree, const raw_blocks& raw = raw_blocks());
+
+   // parse file into tree, returns false if the file could not be opened
+   static bool parse_file(const std::string& path, ptree& tree, const raw_blocks& raw = raw_blocks());
+};
+
+#endif // CF_XMLREADER_H
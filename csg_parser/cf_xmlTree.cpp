@@ -15,6 +15,7 @@
 
 #include "cf_xmlTree.h"
 #include <fstream>
+#include <iterator>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -66,21 +67,27 @@ bool cf_xmlTree::write_xml(const string& path)
 
 bool cf_xmlTree::read_xml(istream& is)
 {
+   string text((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
    m_tree = ptree();
-   boost::property_tree::read_xml(is,m_tree,boost::property_tree::xml_parser::trim_whitespace);
-   if(m_tree.size() == 1) {
-      ptree::iterator i=m_tree.begin();
-      m_root_name = i->first;
-      return true;
+   cf_xmlReader::parse(text.data(),text.data()+text.size(),m_tree);
+   return read_root();
+}
+
+bool cf_xmlTree::read_xml(const string& path, const cf_xmlReader::raw_blocks& raw)
+{
+   m_tree = ptree();
+   if(cf_xmlReader::parse_file(path,m_tree,raw)) {
+      return read_root();
    }
    return false;
 }
 
-bool cf_xmlTree::read_xml(const string& path)
+bool cf_xmlTree::read_root()
 {
-   ifstream in(path.c_str());
-   if(in.is_open()) {
-      return read_xml(in);
+   if(m_tree.size() == 1) {
+      ptree::iterator i=m_tree.begin();
+      m_root_name = i->first;
+      return true;
    }
    return false;
 }
@@ -103,12 +110,7 @@ bool cf_xmlTree::read_json(istream& is)
 {
    m_tree = ptree();
    boost::property_tree::read_json(is,m_tree);
-   if(m_tree.size() == 1) {
-      ptree::iterator i=m_tree.begin();
-      m_root_name = i->first;
-      return true;
-   }
-   return false;
+   return read_root();
 }
 
 bool cf_xmlTree::read_json(const string& path)
@@ -20,6 +20,7 @@
 // http://akrzemi1.wordpress.com/2011/07/13/parsing-xml-with-boost/
 
 #include "cf_xmlNode.h"
+#include "cf_xmlReader.h"
 
 #include <ostream>
 #include <string>
@@ -52,8 +53,9 @@ public:
    // read xml data from any input stream
    bool read_xml(istream& is);
 
-   // read xml data from file
-   bool read_xml(const string& path);
+   // read xml data from file, the file is memory mapped where supported.
+   // Selected large elements may be kept as raw text, see cf_xmlReader
+   bool read_xml(const string& path, const cf_xmlReader::raw_blocks& raw = cf_xmlReader::raw_blocks());
 
    // === JSON export/import
 
@@ -69,6 +71,10 @@ public:
    // read json data from any file
    bool read_json(const string& path);
 
+private:
+   // set the root name after reading, return false unless there is exactly one root
+   bool read_root();
+
 private:
    string  m_root_name;
    ptree   m_tree;
@@ -0,0 +1,34 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "csg_array.h"
+#include "csg_scalar.h"
+#include <stdexcept>
+
+csg_array::csg_array(std::string text, std::vector<size_t> offsets, size_t line_no)
+: csg_value(line_no)
+, m_text(std::move(text))
+, m_offsets(std::move(offsets))
+{}
+
+csg_array::~csg_array()
+{}
+
+std::shared_ptr<csg_value> csg_array::get(size_t i) const
+{
+   if(i >= size()) throw std::runtime_error("csg_array::get(), index out of bounds");
+
+   return std::make_shared<csg_scalar>(m_text.substr(m_offsets[i],m_offsets[i+1]-m_offsets[i]),line_no());
+}
@@ -0,0 +1,44 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef CSG_ARRAY_H
+#define CSG_ARRAY_H
+
+#include "csg_value.h"
+#include <string>
+#include <vector>
+
+// a vector of scalar parameter values in a csg node, such as a polyhedron point or face.
+// The scalar texts are kept in one buffer instead of one object per value
+class csg_array : public csg_value {
+public:
+   // text holds the scalar texts back to back, value i starts at offsets[i] and ends at offsets[i+1]
+   csg_array(std::string text, std::vector<size_t> offsets, size_t line_no);
+   virtual ~csg_array();
+
+   virtual bool is_vector() const { return true; }
+
+   // length of value vector
+   virtual size_t size() const { return m_offsets.size()-1; }
+
+   // returns value index i as a scalar
+   virtual std::shared_ptr<csg_value> get(size_t i) const;
+
+private:
+   std::string         m_text;
+   std::vector<size_t> m_offsets;
+};
+
+#endif // CSG_ARRAY_H
@@ -26,27 +26,6 @@
 static const double pi = 4.0*atan(1.0);
 
 
-inline void tokenize(const std::string& input,
-                     const std::string& delimiters,
-                     std::vector<std::string>& tokens)
-{
-   using namespace std;
-   string::size_type last_pos = 0;
-   string::size_type pos = 0;
-   while(true) {
-      pos = input.find_first_of(delimiters, last_pos);
-      if( pos == string::npos ) {
-         if(input.length()-last_pos > 0)tokens.push_back(input.substr(last_pos));
-         break;
-      }
-      else {
-         if(pos-last_pos > 0)tokens.push_back(input.substr(last_pos, pos - last_pos));
-         last_pos = pos + 1;
-      }
-   }
-}
-
-
 csg_node::xmap csg_node::m_xmap;
 
 void csg_node::configure_xmap()
@@ -94,13 +73,13 @@ csg_node::csg_node()
 , m_has_matrix(false)
 {}
 
-csg_node::csg_node(size_t level, size_t line_no, const std::string& func)
+csg_node::csg_node(size_t level, size_t line_no, const std::string& func, par_map& par)
 : m_level(int(level))
 , m_line_no(line_no)
 , m_func(func)
 , m_has_matrix(false)
 {
-   parse_params();
+   m_par.swap(par);
 }
 
 csg_node::~csg_node()
@@ -131,88 +110,6 @@ void csg_node::push_back(std::shared_ptr<csg_node> child)
    m_children.push_back(child);
 }
 
-void csg_node::build_tree(const std::vector<func_data>& func, size_t& index)
-{
-   while(index < func.size()) {
-      const func_data& f = func[index];
-      auto& p = f.second;
-      int level = int(p.first);
-      size_t line_no = p.second;
-      if(level == m_level+1){
-         std::shared_ptr<csg_node> child = std::make_shared<csg_node>(level,line_no,f.first);
-         m_children.push_back(child);
-         child->build_tree(func,++index);
-      }
-      else break;
-   }
-}
-
-void csg_node::parse_params()
-{
-   std::string type   = tag();
-   std::string params = par();
-
-   // first get rid of the enclosing parentheses
-   std::vector<std::string> tokens;
-   tokenize(params,"()",tokens);
-   if(tokens.size() > 0) {
-
-      size_t iparam = 0; // parameter counter
-      params = tokens[0];
-
-      // we now have  name1=value1,name2=name2,... where values can be (nested) vectors
-      // but note that in some few cases, the name is missing (multmatrix)
-      while(params.size() > 0) {
-         size_t ieq = params.find_first_of('=');
-         std::string name;
-         if(ieq==std::string::npos) {
-            name = par_name(iparam);  // nameless parameter
-            ieq = 0;
-         }
-         else {
-            // increment ieq to eat equal sign
-            name = params.substr(0,ieq++);
-         }
-
-         // extract value, parse it and assign it to parameter map
-         std::string value_str = par_value(params,ieq);
-         std::shared_ptr<csg_value> value = csg_value::parse(value_str,m_line_no);
-         if(value.get()) m_par[name] = value;
-
-         // truncate the parameter list from left
-         size_t len = name.length()+1 + value_str.length()+1;
-         params = (len <= params.size()) ? params.substr(len) : "";
-      }
-   }
-}
-
-// find the next value substring in the parameter list
-// Make sure to account for (nested) vectors using [] characters
-// we essentially search for end of vector ']', next comma or end of string
-// if we find a comma, we replace it with a blank
-std::string csg_node::par_value(std::string& param, size_t istart)
-{
-   std::string value;
-   size_t inside = 0;
-   for(size_t i=istart; i<param.size(); i++) {
-      char c = param[i];
-      if(c == '[') inside++;        // vector begins
-      if(c == ',' && inside==0) {   // next parameter
-         param[i] = ' ';
-         break;
-      }
-      if(c == ']') {                // vector ends
-         inside--;
-         if(inside==0) {            // outer vector ends
-            value += c;
-            break;
-         }
-      }
-      value += c;
-   }
-   return value;
-}
-
 void  csg_node::dump()
 {
    for(int i=0; i<m_level; i++) std::cout << ' ';
@@ -32,14 +32,13 @@ public:
    typedef std::map<std::string,std::string> xmap;
    static void configure_xmap();
 
-   typedef std::pair<std::string,std::pair<size_t,size_t>> func_data;  // <signature,<tree_level,line>>
-
    // for parameter list
    typedef std::map<std::string,std::shared_ptr<csg_value>> par_map;
    typedef par_map::iterator par_iterator;
 
    csg_node();
-   csg_node(size_t level, size_t line_no, const std::string& func);
+   // node for function signature func, the parsed parameters are taken over from par
+   csg_node(size_t level, size_t line_no, const std::string& func, par_map& par);
    virtual ~csg_node();
 
    // return naked function name
@@ -71,11 +70,6 @@ public:
 
 protected:
 
-   // helpers to buuild csg tree, parse node parameters etc
-   void build_tree(const std::vector<func_data>& func, size_t& index);
-   void parse_params();
-   std::string par_value(std::string& param, size_t istart);
-
    void dump();
 
    // dummy nodes such as group(); with zero children
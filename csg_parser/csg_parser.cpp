@@ -17,72 +17,145 @@
 #include <sstream>
 #include <vector>
 #include <iomanip>
+#include <iterator>
+#include <stdexcept>
 
 csg_parser::csg_parser(std::istream& csg, double secant_tolerance)
 : m_root(std::make_shared<csg_node>())
 , m_secant_tolerance(secant_tolerance)
 {
    // read the whole file into a string
-   std::ostringstream sstr;
-   sstr << csg.rdbuf();
-   init_func(sstr.str());
+   std::string text((std::istreambuf_iterator<char>(csg)),std::istreambuf_iterator<char>());
+   parse(text.data(),text.data()+text.size());
    // m_root->dump();
 }
 
 csg_parser::~csg_parser()
 {}
 
-void csg_parser::init_func(const std::string& csg)
+static inline bool is_space(char c)
 {
-   std::vector<func_data>   func;  // function calls, by function index
+   return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
 
-   std::string token;
+static inline bool is_name(char c)
+{
+   return (c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') || c=='_' || c=='$';
+}
 
-   // level in tree
-   size_t level = 0;
-   size_t line_no = 1;
+// skip white space and comments, counting lines
+static void skip_space(const char*& p, const char* last, size_t& line_no)
+{
+   while(p<last) {
+      if(*p == '\n') line_no++;
+      if(is_space(*p)) p++;
+      else if(*p=='/' && p+1<last && p[1]=='/') {
+         while(p<last && *p!='\n') p++;
+      }
+      else if(*p=='/' && p+1<last && p[1]=='*') {
+         for(p+=2; p<last && !(*p=='*' && p+1<last && p[1]=='/'); p++) {
+            if(*p == '\n') line_no++;
+         }
+         p = (p<last)? p+2 : last;
+      }
+      else break;
+   }
+}
+
+static std::runtime_error syntax_error(size_t line_no, const std::string& message)
+{
+   return std::runtime_error(".csg file line " + std::to_string(line_no) + ", syntax error: " + message);
+}
 
-   size_t i=0;
-   while(i<csg.size()) {
+void csg_parser::parse(const char* p, const char* last)
+{
+   size_t line_no = 1;
+   size_t nfunc   = 0;
 
-      // get current character
-      char c = csg[i++];
+   // the nodes whose {} block is being parsed, innermost last
+   std::vector<csg_node*> open(1,m_root.get());
 
-      // Skip // comment line
-      while(c=='/' && csg[i]=='/') {
-         while(csg[++i]!='\n') c = csg[i];
-         c = csg[i];
-      }
+   while(true) {
 
-      // update the tree level
-           if( c=='{') ++level;
-      else if( c=='}') --level;
+      skip_space(p,last,line_no);
+      if(p == last) break;
 
-      if( c=='\n') {
-         line_no++;
-         token.clear();
+      // end of a child block, an empty statement or a debug modifier
+      if(*p == '}') {
+         if(open.size() == 1) throw syntax_error(line_no,"unbalanced '}'");
+         open.pop_back();
+         p++;
+         continue;
+      }
+      if(*p==';' || *p=='#') {
+         p++;
+         continue;
       }
 
-      // characters not contributing to token
-      if( c==' ' || c=='\t' || c=='\n' || c==';' || c=='{' || c=='}' || c=='#') continue;
+      // function call: tag(name1=value1,name2=value2,...) followed by ';' or a {} block of children
+      // in some few cases, the parameter name is missing (multmatrix)
+      size_t func_line = line_no;
+      const char* func_begin = p;
+      while(p<last && *p!='(' && !is_space(*p) && *p!=';' && *p!='{' && *p!='}') p++;
+      std::string tag(func_begin,p);
+      skip_space(p,last,line_no);
+      if(tag.length()==0 || p==last || *p!='(') throw syntax_error(line_no,"expected function call but found '" + tag + "'");
+      p++;
+
+      csg_node::par_map par;
+      skip_space(p,last,line_no);
+      for(size_t iparam=0; p<last && *p!=')'; iparam++) {
+
+         const char* name_begin = p;
+         while(p<last && is_name(*p)) p++;
+         const char* name_end = p;
+         size_t name_line = line_no;
+         skip_space(p,last,name_line);
+
+         std::string name;
+         if(name_end>name_begin && p<last && *p=='=') {
+            name.assign(name_begin,name_end);
+            line_no = name_line;
+            p++;
+         }
+         else {
+            name = csg_node::par_name(iparam);  // nameless parameter
+            p = name_begin;
+         }
+
+         std::shared_ptr<csg_value> value = csg_value::parse(p,last,line_no);
+         if(value.get()) par[name] = value;
+
+         skip_space(p,last,line_no);
+         if(p<last && *p==',') {
+            p++;
+            skip_space(p,last,line_no);
+         }
+         else if(p==last || *p!=')') throw syntax_error(line_no,"expected ',' or ')' in parameters of " + tag);
+      }
+      if(p == last) throw syntax_error(line_no,"missing ')' in parameters of " + tag);
+      p++;
+
+      // the function signature without white space, as used in messages
+      std::string func;
+      func.reserve(p-func_begin);
+      for(const char* c=func_begin; c<p; c++) {
+         if(!is_space(*c)) func += *c;
+      }
 
-      // add character to token
-      token += c;
+      std::shared_ptr<csg_node> node = std::make_shared<csg_node>(open.size()-1,func_line,func,par);
+      open.back()->push_back(node);
+      nfunc++;
 
-      if(c==')') {
-         // end of token
-         func.push_back(func_data(token,std::make_pair(level,line_no)));
-         token.clear();
+      skip_space(p,last,line_no);
+      if(p<last && *p=='{') {
+         open.push_back(node.get());
+         p++;
       }
-
+      else if(p<last && *p==';') p++;
    }
 
-   if(func.size() == 0) throw std::runtime_error("csg tree has 0 elements!");
-
-   // build the tree
-   size_t index = 0;
-   m_root->build_tree(func,index);
-//   m_root->dump();
+   if(nfunc == 0) throw std::runtime_error("csg tree has 0 elements!");
 }
 
 bool csg_parser::to_xcsg(cf_xmlTree& tree)
@@ -26,8 +26,6 @@
 // csg_parser reads an openscad .csg file, builds a tree amd exports to xcsg
 class csg_parser {
 public:
-   typedef std::pair<std::string,std::pair<size_t,size_t>> func_data;  // <signature,<tree_level,line>>
-
    // parse openscad.csg file and build the openscad tree
    csg_parser(std::istream& csg, double secant_tolerance);
    virtual ~csg_parser();
@@ -36,7 +34,8 @@ public:
    bool to_xcsg(cf_xmlTree& tree);
 
 protected:
-   void init_func(const std::string& csg);
+   // single pass parse of the .csg text in [p,last) into the openscad tree
+   void parse(const char* p, const char* last);
 
 private:
    double                     m_secant_tolerance;
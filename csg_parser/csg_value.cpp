@@ -16,7 +16,10 @@
 #include "csg_value.h"
 #include "csg_scalar.h"
 #include "csg_vector.h"
+#include "csg_array.h"
 #include <stdexcept>
+#include <vector>
+#include <utility>
 
 csg_value::csg_value(size_t line_no)
 : m_line_no(line_no)
@@ -50,70 +53,95 @@ std::shared_ptr<csg_value> csg_value::get(size_t i) const
    throw std::runtime_error(".csg file line " + std::to_string(m_line_no) +", csg_value::get(), value is not a vector");
 }
 
-std::shared_ptr<csg_value> csg_value::parse(const std::string& value_str, size_t line_no)
+static inline bool is_space(char c)
 {
-   std::shared_ptr<csg_value> value;
+   return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
 
-   // recursively parse the string
-   // when a vector is found [
-   //    call this function again, until corresponding ] is found
+static void skip_space(const char*& p, const char* last, size_t& line_no)
+{
+   while(p<last && is_space(*p)) {
+      if(*p == '\n') line_no++;
+      p++;
+   }
+}
 
-   for(size_t i=0; i<value_str.size(); i++) {
-      char c = value_str[i];
+// advance p past a scalar: a number, identifier or quoted string
+static void skip_scalar(const char*& p, const char* last, size_t line_no)
+{
+   if(*p == '"') {
+      for(p++; p<last && *p!='"'; p++) {
+         if(*p == '\\' && p+1<last) p++;
+      }
+      if(p == last) throw std::runtime_error(".csg file line " + std::to_string(line_no) +", csg_value::parse(), unterminated string");
+      p++;
+   }
+   else {
+      while(p<last && !is_space(*p) && *p!=',' && *p!=']' && *p!=')' && *p!='[' && *p!='(' && *p!=';') p++;
+   }
+}
 
-      if( c==',') continue;
+std::shared_ptr<csg_value> csg_value::parse(const char*& p, const char* last, size_t& line_no)
+{
+   skip_space(p,last,line_no);
+   if(p==last || *p==',' || *p==')' || *p==']') return nullptr;
+
+   if(*p != '[') {
+      // found a scalar
+      const char* begin = p;
+      skip_scalar(p,last,line_no);
+      if(p == begin) throw std::runtime_error(".csg file line " + std::to_string(line_no) +", csg_value::parse(), unexpected character '" + std::string(1,*p) + "'");
+      return std::make_shared<csg_scalar>(std::string(begin,p),line_no);
+   }
 
-      if(c == '[') {
-         // found an array, find the corresponding ']' from the right side
-         size_t i2 = value_str.find_last_of(']');
+   // found a vector. As long as it contains only scalars, the values are collected as
+   // text in one buffer. Nested vectors require a vector of values.
+   size_t vec_line = line_no;
+   std::string text;
+   std::vector<size_t> offsets(1,0);
+   std::vector<std::shared_ptr<csg_value>> vec;
+   bool nested = false;
 
-         // strip the [] pair from both sides
-         // so we end up with a string of comma separated values (which may be vectors)
-         return parse_vector(value_str.substr(i+1,i2-1),line_no);
+   p++;
+   skip_space(p,last,line_no);
+   if(p<last && *p==']') {
+      p++;
+      return std::make_shared<csg_vector>(vec,vec_line);
+   }
+   while(true) {
+      skip_space(p,last,line_no);
+      if(p<last && *p=='[') {
+         if(!nested) {
+            // switch to a vector of values
+            for(size_t i=0; i+1<offsets.size(); i++) {
+               vec.push_back(std::make_shared<csg_scalar>(text.substr(offsets[i],offsets[i+1]-offsets[i]),vec_line));
+            }
+            nested = true;
+         }
+         vec.push_back(parse(p,last,line_no));
       }
       else {
-         // found a scalar
-         return std::make_shared<csg_scalar>(value_str,line_no);
+         const char* begin = p;
+         if(p<last) skip_scalar(p,last,line_no);
+         if(p == begin) throw std::runtime_error(".csg file line " + std::to_string(line_no) +", csg_value::parse(), expected vector element");
+         if(nested) vec.push_back(std::make_shared<csg_scalar>(std::string(begin,p),line_no));
+         else {
+            text.append(begin,p);
+            offsets.push_back(text.size());
+         }
       }
-   }
-
-   return value;
-}
 
-std::shared_ptr<csg_value> csg_value::parse_vector(const std::string& values, size_t line_no)
-{
-   std::vector<std::shared_ptr<csg_value>> vec;
-   std::string token;
-
-   size_t icount = 0;
-   for(size_t i=0; i<values.size(); i++) {
-      char c = values[i];
-
-      if(c == '[') icount++;
-      if(c == ']') icount--;
-      token +=c;
-
-      if(icount==0 && c == ']') {
-         // end of vector data
-         size_t len = token.size();
-         std::string vals = token.substr(1,len-2);
-         vec.push_back(parse_vector(vals,line_no));
-         token  = "";
-         icount = 0;
-
-         // eat following comma
-         i++;
+      skip_space(p,last,line_no);
+      if(p<last && *p==',') {
+         p++;
       }
-      else if(icount==0 && (c == ',' || i==values.size()-1) ) {
-         // end of scalar data
-         size_t len = (c == ',')? token.size()-1 : token.size();
-         std::string val = token.substr(0,len);
-         vec.push_back(std::make_shared<csg_scalar>(val,line_no));
-         token  = "";
-         icount = 0;
+      else if(p<last && *p==']') {
+         p++;
+         break;
       }
+      else throw std::runtime_error(".csg file line " + std::to_string(line_no) +", csg_value::parse(), expected ',' or ']' in vector");
    }
-   return std::make_shared<csg_vector>(vec,line_no);
-}
-
 
+   if(nested) return std::make_shared<csg_vector>(vec,vec_line);
+   return std::make_shared<csg_array>(std::move(text),std::move(offsets),vec_line);
+}
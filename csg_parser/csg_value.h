@@ -25,9 +25,10 @@ public:
    csg_value(size_t line_no);
    virtual ~csg_value();
 
-   // convert a value string into a csg_value, possibly a scalar or (nested) vector
-   static std::shared_ptr<csg_value> parse(const std::string& value_str, size_t line_no);
-   static std::shared_ptr<csg_value> parse_vector(const std::string& value_str, size_t line_no);
+   // parse the value text starting at p into a csg_value, possibly a scalar or (nested) vector.
+   // p is advanced past the value and line_no is updated for any line breaks passed.
+   // Returns nullptr if there is no value at p
+   static std::shared_ptr<csg_value> parse(const char*& p, const char* last, size_t& line_no);
 
    virtual bool is_vector() const { return false; }
 
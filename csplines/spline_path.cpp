@@ -5,6 +5,9 @@
 
 namespace csplines {
 
+   // arc length table entries per knot interval, each integrated by 3 point Gauss-Legendre
+   static const size_t arc_steps = 8;
+
    spline_path::spline_path()
    : m_length(0.0)
    {}
@@ -72,55 +75,193 @@ namespace csplines {
       buildcubicspline(t,vx,n,0,0.0,0,0.0,m_cvx);
       buildcubicspline(t,vy,n,0,0.0,0,0.0,m_cvy);
       buildcubicspline(t,vz,n,0,0.0,0,0.0,m_cvz);
+
+      pack_intervals();
+      build_arc_table();
+      m_summed.reset();
       return true;
    }
 
-   cpoint spline_path::pos(double t) const
+   void spline_path::pack_intervals()
    {
-      double px = splineinterpolation(m_cpx,t);
-      double py = splineinterpolation(m_cpy,t);
-      double pz = splineinterpolation(m_cpz,t);
+      // ALGLIB table layout: c(2)=n, knots in c(3..3+n-1), then 4 coefficients per interval
+      int n = ap::round(m_cpx(2));
+      const ap::real_1d_array* c[6] = { &m_cpx, &m_cpy, &m_cpz, &m_cvx, &m_cvy, &m_cvz };
 
-      double vx = splineinterpolation(m_cvx,t);
-      double vy = splineinterpolation(m_cvy,t);
-      double vz = splineinterpolation(m_cvz,t);
+      m_knots.resize(n);
+      for(int i=0; i<n; i++) m_knots[i] = m_cpx(3+i);
 
-      return cpoint(px,py,pz, vx,vy,vz);
+      m_intervals.resize(n-1);
+      for(int i=0; i<n-1; i++) {
+         interval& iv = m_intervals[i];
+         int m = 3+n+4*i;
+         for(int k=0; k<6; k++) {
+            const ap::real_1d_array& ck = *c[k];
+            iv.c0[k] = ck(m);
+            iv.c1[k] = ck(m+1);
+            iv.c2[k] = ck(m+2);
+            iv.c3[k] = ck(m+3);
+         }
+      }
+   }
+
+   double spline_path::speed(size_t i, double t) const
+   {
+      const interval& iv = m_intervals[i];
+      double x = t - m_knots[i];
+      double sum = 0.0;
+      for(int k=0; k<3; k++) {
+         double ds = iv.c1[k]+2*x*iv.c2[k]+3*(x*x)*iv.c3[k];
+         sum += ds*ds;
+      }
+      return sqrt(sum);
+   }
+
+   void spline_path::build_arc_table()
+   {
+      // Gauss-Legendre abscissae and weights on [-1,1]
+      const double gx[3] = { -sqrt(0.6), 0.0, sqrt(0.6) };
+      const double gw[3] = { 5.0/9.0, 8.0/9.0, 5.0/9.0 };
+
+      size_t nentry = m_intervals.size()*arc_steps + 1;
+      m_arc_t.resize(nentry);
+      m_arc_s.resize(nentry);
+      m_arc_t[0] = m_knots[0];
+      m_arc_s[0] = 0.0;
+      size_t j = 0;
+      for(size_t i=0; i<m_intervals.size(); i++) {
+         double h = (m_knots[i+1]-m_knots[i])/arc_steps;
+         for(size_t k=0; k<arc_steps; k++) {
+            double tmid = m_knots[i] + (k+0.5)*h;
+            double ds = 0.0;
+            for(int g=0; g<3; g++) ds += gw[g]*speed(i,tmid+0.5*h*gx[g]);
+            m_arc_t[j+1] = m_knots[i] + (k+1)*h;
+            m_arc_s[j+1] = m_arc_s[j] + 0.5*h*ds;
+            j++;
+         }
+      }
+      m_arc_t[nentry-1] = m_knots.back();
+
+      // one bucket per entry, so an inverse lookup scans about one entry
+      double total = m_arc_s.back();
+      size_t nbucket = nentry;
+      m_arc_index.assign(nbucket+1,0);
+      if(!(total > 0.0)) return;
+      size_t e = 0;
+      for(size_t b=0; b<=nbucket; b++) {
+         double s = total*b/nbucket;
+         while(e+2 < nentry && m_arc_s[e+1] <= s) e++;
+         m_arc_index[b] = e;
+      }
+   }
+
+   size_t spline_path::find_interval(double t) const
+   {
+      // the last knot below t among the first n-1 knots, or the first interval
+      auto it = std::lower_bound(m_knots.begin()+1,m_knots.end()-1,t);
+      return (it - m_knots.begin()) - 1;
+   }
+
+   size_t spline_path::next_interval(size_t i, double t) const
+   {
+      // a parameter below the current interval restarts the search
+      if(i > 0 && !(m_knots[i] < t)) return find_interval(t);
+
+      const size_t last = m_intervals.size()-1;
+      while(i < last && m_knots[i+1] < t) i++;
+      return i;
+   }
+
+   void spline_path::evaluate(size_t i, double t, double s[6]) const
+   {
+      const interval& iv = m_intervals[i];
+      double x = t - m_knots[i];
+      for(int k=0; k<6; k++) {
+         s[k] = iv.c0[k]+x*(iv.c1[k]+x*(iv.c2[k]+x*iv.c3[k]));
+      }
+   }
+
+   void spline_path::evaluate(size_t i, double t, double s[6], double ds[6], double d2s[6]) const
+   {
+      const interval& iv = m_intervals[i];
+      double x = t - m_knots[i];
+      for(int k=0; k<6; k++) {
+         s[k]   = iv.c0[k]+x*(iv.c1[k]+x*(iv.c2[k]+x*iv.c3[k]));
+         ds[k]  = iv.c1[k]+2*x*iv.c2[k]+3*(x*x)*iv.c3[k];
+         d2s[k] = 2*iv.c2[k]+6*x*iv.c3[k];
+      }
+   }
+
+   // absolute curvature from the 1st and 2nd derivatives of the position
+   static double curvature_of(const double ds[6], const double d2s[6])
+   {
+      // https://math.stackexchange.com/questions/1786495/estimating-the-curvature-of-a-discretized-curve-in-3d-with-cubic-splines
+      double v1 =pow((d2s[2]*ds[1]-d2s[1]*ds[2]),2.0);
+      double v2 =pow((d2s[0]*ds[2]-d2s[2]*ds[0]),2.0);
+      double v3 =pow((d2s[1]*ds[0]-d2s[0]*ds[1]),2.0);
+
+      double denom = pow((ds[0]*ds[0]+ds[1]*ds[1]+ds[2]*ds[2]),-1.5);
+      return sqrt(v1+v2+v3)*denom;
+   }
+
+   cpoint spline_path::pos(double t) const
+   {
+      double s[6];
+      evaluate(find_interval(t),t,s);
+      return cpoint(s[0],s[1],s[2], s[3],s[4],s[5]);
    }
 
    cpoint spline_path::dir(double t) const
    {
-      double px,dpx,d2px;
-      double py,dpy,d2py;
-      double pz,dpz,d2pz;
-      splinedifferentiation(m_cpx,t,px,dpx,d2px);
-      splinedifferentiation(m_cpy,t,py,dpy,d2py);
-      splinedifferentiation(m_cpz,t,pz,dpz,d2pz);
+      double s[6],ds[6],d2s[6];
+      evaluate(find_interval(t),t,s,ds,d2s);
+      return cpoint(ds[0],ds[1],ds[2], s[3],s[4],s[5]);
+   }
 
-      double vx = splineinterpolation(m_cvx,t);
-      double vy = splineinterpolation(m_cvy,t);
-      double vz = splineinterpolation(m_cvz,t);
+   void spline_path::pos(const std::vector<double>& t, std::vector<cpoint>& points) const
+   {
+      points.clear();
+      points.reserve(t.size());
+      size_t i = 0;
+      double s[6];
+      for(double ti : t) {
+         i = next_interval(i,ti);
+         evaluate(i,ti,s);
+         points.push_back(cpoint(s[0],s[1],s[2], s[3],s[4],s[5]));
+      }
+   }
 
-      return cpoint(dpx,dpy,dpz, vx,vy,vz);
+   void spline_path::dir(const std::vector<double>& t, std::vector<cpoint>& dirs) const
+   {
+      dirs.clear();
+      dirs.reserve(t.size());
+      size_t i = 0;
+      double s[6],ds[6],d2s[6];
+      for(double ti : t) {
+         i = next_interval(i,ti);
+         evaluate(i,ti,s,ds,d2s);
+         dirs.push_back(cpoint(ds[0],ds[1],ds[2], s[3],s[4],s[5]));
+      }
    }
 
    double spline_path::curvature(double t) const
    {
-      // https://math.stackexchange.com/questions/1786495/estimating-the-curvature-of-a-discretized-curve-in-3d-with-cubic-splines
-
-      double px,dpx,d2px;
-      double py,dpy,d2py;
-      double pz,dpz,d2pz;
-      splinedifferentiation(m_cpx,t,px,dpx,d2px);
-      splinedifferentiation(m_cpy,t,py,dpy,d2py);
-      splinedifferentiation(m_cpz,t,pz,dpz,d2pz);
-
-      double v1 =pow((d2pz*dpy-d2py*dpz),2.0);
-      double v2 =pow((d2px*dpz-d2pz*dpx),2.0);
-      double v3 =pow((d2py*dpx-d2px*dpy),2.0);
+      double s[6],ds[6],d2s[6];
+      evaluate(find_interval(t),t,s,ds,d2s);
+      return curvature_of(ds,d2s);
+   }
 
-      double denom = pow((dpx*dpx+dpy*dpy+dpz*dpz),-1.5);
-      return sqrt(v1+v2+v3)*denom;
+   void spline_path::curvature(const std::vector<double>& t, std::vector<double>& c) const
+   {
+      c.clear();
+      c.reserve(t.size());
+      size_t i = 0;
+      double s[6],ds[6],d2s[6];
+      for(double ti : t) {
+         i = next_interval(i,ti);
+         evaluate(i,ti,s,ds,d2s);
+         c.push_back(curvature_of(ds,d2s));
+      }
    }
 
    double spline_path::max_curvature(int nseg) const
@@ -129,9 +270,13 @@ namespace csplines {
       double dt = 1.0/nseg;
       double c  = 0.0;
       int    np = nseg+1;
+      size_t i  = 0;
+      double s[6],ds[6],d2s[6];
       for(int ip=0; ip<np; ip++) {
          double t = ip*dt;
-         c = std::max(c,curvature(t));
+         i = next_interval(i,t);
+         evaluate(i,t,s,ds,d2s);
+         c = std::max(c,curvature_of(ds,d2s));
       }
       return c;
    }
@@ -141,6 +286,52 @@ namespace csplines {
    {
       return m_length;
    }
+
+   double spline_path::arc_length() const
+   {
+      return (m_arc_s.size() > 0)? m_arc_s.back() : 0.0;
+   }
+
+   double spline_path::arc_length(double t) const
+   {
+      if(m_arc_s.size() < 2) return 0.0;
+      if(!(t > m_knots.front())) return 0.0;
+      if(!(t < m_knots.back()))  return m_arc_s.back();
+
+      // entries are equally spaced within the knot interval
+      size_t i = find_interval(t);
+      double u = (t-m_knots[i])/(m_knots[i+1]-m_knots[i])*arc_steps;
+      size_t k = std::min(static_cast<size_t>(u),arc_steps-1);
+      size_t j = i*arc_steps + k;
+      return m_arc_s[j] + (u-k)*(m_arc_s[j+1]-m_arc_s[j]);
+   }
+
+   double spline_path::arc_parameter(double s) const
+   {
+      if(m_arc_s.size() < 2) return 0.0;
+      double total = m_arc_s.back();
+      if(!(s > 0.0))    return m_arc_t.front();
+      if(!(s < total))  return m_arc_t.back();
+
+      // start at the entry of the bucket and move forward to the entry containing s
+      size_t nbucket = m_arc_index.size()-1;
+      size_t j = m_arc_index[static_cast<size_t>(s/total*nbucket)];
+      while(j+2 < m_arc_s.size() && m_arc_s[j+1] < s) j++;
+
+      double ds = m_arc_s[j+1]-m_arc_s[j];
+      double f  = (ds > 0.0)? (s-m_arc_s[j])/ds : 0.0;
+      return m_arc_t[j] + f*(m_arc_t[j+1]-m_arc_t[j]);
+   }
+
+   void spline_path::arc_parameters(size_t nseg, std::vector<double>& t) const
+   {
+      nseg = std::max(nseg,size_t(1));
+      double total = arc_length();
+      t.resize(nseg+1);
+      for(size_t i=0; i<nseg; i++) t[i] = arc_parameter(total*i/nseg);
+      t[0]    = 0.0;
+      t[nseg] = 1.0;
+   }
 
    double spline_path::scaling_range() const
    {
@@ -164,8 +355,14 @@ namespace csplines {
       return points2;
    }
 
-   std::shared_ptr<csplines::spline_path> spline_path::summed_spline() const
+   std::shared_ptr<const csplines::spline_path> spline_path::summed_spline() const
    {
-      return std::make_shared<spline_path>(summed_points());
+      // threads sharing the spline may both compute it, the results are identical
+      std::shared_ptr<const spline_path> summed = std::atomic_load(&m_summed);
+      if(!summed.get()) {
+         summed = std::make_shared<spline_path>(summed_points());
+         std::atomic_store(&m_summed,summed);
+      }
+      return summed;
    }
 }
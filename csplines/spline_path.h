@@ -56,6 +56,12 @@ namespace csplines {
       // vx,vy,vz contains interpolated vector
       cpoint dir(double t) const;
 
+      // batch versions of pos() and dir(), evaluating all parameters t in one pass.
+      // With t sorted in increasing order, the knot interval is found by a cursor
+      // moving forward instead of a binary search per parameter
+      void pos(const std::vector<double>& t, std::vector<cpoint>& points) const;
+      void dir(const std::vector<double>& t, std::vector<cpoint>& dirs) const;
+
       // return max curvature observed by sampling nseg segments
       // note that this evaluates points only (see summed_spline() to evaluate both)
       double max_curvature(int nseg) const;
@@ -66,19 +72,60 @@ namespace csplines {
       // return sum of segment lengths
       double length() const;
 
+      // arc length of the curve, integrated when the spline is computed
+      double arc_length() const;
+
+      // arc length from parameter 0 to t [0,1]
+      double arc_length(double t) const;
+
+      // inverse of arc_length(t): parameter at arc length s [0,arc_length()], constant time
+      double arc_parameter(double s) const;
+
+      // nseg+1 parameters at equal arc length steps, from 0 to 1
+      void arc_parameters(size_t nseg, std::vector<double>& t) const;
+
       // return number of input control points
       size_t size() const;
 
-      // return equivalent spline where points and vectors are summed
-      std::shared_ptr<csplines::spline_path> summed_spline() const;
+      // return equivalent spline where points and vectors are summed.
+      // It is computed once and shared by all callers
+      std::shared_ptr<const csplines::spline_path> summed_spline() const;
 
       // return absolute curvature at parameter t [0,1]
       // NOTE: use only with summed spline, because vectors are not evaluated
       double curvature(double t) const;
 
+      // batch version of curvature(), parameters sorted in increasing order are evaluated in one pass
+      void curvature(const std::vector<double>& t, std::vector<double>& c) const;
+
    protected:
       std::vector<cpoint>  summed_points() const;
 
+      // cubic coefficients of the six splines px,py,pz,vx,vy,vz in one knot interval.
+      // The channel index is innermost, so each coefficient is evaluated for all channels at once
+      struct interval {
+         double c0[6],c1[6],c2[6],c3[6];
+      };
+
+      // copy knots and coefficients from the ALGLIB tables
+      void pack_intervals();
+
+      // knot interval of t, the same as the binary search of ALGLIB splineinterpolation
+      size_t find_interval(double t) const;
+
+      // knot interval of t, moving forward from interval i
+      size_t next_interval(size_t i, double t) const;
+
+      // value, 1st and 2nd derivative of the six channels at t in interval i
+      void evaluate(size_t i, double t, double s[6]) const;
+      void evaluate(size_t i, double t, double s[6], double ds[6], double d2s[6]) const;
+
+      // speed |dpos/dt| at t in interval i
+      double speed(size_t i, double t) const;
+
+      // integrate the arc length table and its index by arc length
+      void build_arc_table();
+
    private:
       std::vector<cpoint> m_points;
       double              m_length;  // sum of segment lengths
@@ -88,6 +135,15 @@ namespace csplines {
       ap::real_1d_array   m_cvx;
       ap::real_1d_array   m_cvy;
       ap::real_1d_array   m_cvz;
+      std::vector<double>   m_knots;      // spline parameter at each control point
+      std::vector<interval> m_intervals;  // one less than the knots
+
+      // arc length table, arc_steps entries per knot interval equally spaced in t
+      std::vector<double>   m_arc_t;      // parameter of each entry
+      std::vector<double>   m_arc_s;      // arc length from t=0 to each entry
+      std::vector<size_t>   m_arc_index;  // per equal arc length bucket, the entry at or before it
+
+      mutable std::shared_ptr<const spline_path> m_summed;  // summed_spline(), once computed
    };
 
 }
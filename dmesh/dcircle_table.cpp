@@ -0,0 +1,123 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "dcircle_table.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// relative width of the undecided band, generous compared to the rounding
+// error of the circumcentre for triangles that are not close to degenerate
+static const double screen_tolerance = 1.0E-6;
+
+dcircle_table::dcircle_table()
+{}
+
+dcircle_table::~dcircle_table()
+{}
+
+size_t dcircle_table::create(dtriangle* triangle, const dpos2d& p1, const dpos2d& p2, const dpos2d& p3)
+{
+   // centre relative to p1, so the result does not depend on the distance from the origin
+   double bx = p2.x() - p1.x(), by = p2.y() - p1.y();
+   double cx = p3.x() - p1.x(), cy = p3.y() - p1.y();
+   double b2 = bx*bx + by*by;
+   double c2 = cx*cx + cy*cy;
+   double cross = bx*cy - by*cx;
+   double ux = (cy*b2 - by*c2)/(2.0*cross);
+   double uy = (bx*c2 - cx*b2)/(2.0*cross);
+   double r2 = ux*ux + uy*uy;
+
+   // nearly degenerate triangles have an unreliable centre, they are never decided by screening
+   double band = screen_tolerance*r2;
+   if(!(std::fabs(cross) > screen_tolerance*std::max(b2,c2))) band = std::numeric_limits<double>::infinity();
+
+   size_t handle = 0;
+   if(m_free.size() > 0) {
+      handle = m_free.back();
+      m_free.pop_back();
+   }
+   else {
+      handle = m_tri.size();
+      m_x.push_back(0.0);
+      m_y.push_back(0.0);
+      m_r2.push_back(0.0);
+      m_band.push_back(0.0);
+      m_tri.push_back(0);
+   }
+   m_x[handle]    = p1.x() + ux;
+   m_y[handle]    = p1.y() + uy;
+   m_r2[handle]   = r2;
+   m_band[handle] = band;
+   m_tri[handle]  = triangle;
+   return handle;
+}
+
+void dcircle_table::release(size_t handle)
+{
+   // a released record is always screened as outside
+   m_x[handle]    = 0.0;
+   m_y[handle]    = 0.0;
+   m_r2[handle]   = -1.0;
+   m_band[handle] = 0.0;
+   m_tri[handle]  = 0;
+   m_free.push_back(handle);
+}
+
+double dcircle_table::radius(size_t handle) const
+{
+   // degenerate triangles have infinite circumcircles
+   double r2 = m_r2[handle];
+   return (r2 < std::numeric_limits<double>::infinity())? std::sqrt(r2) : std::numeric_limits<double>::infinity();
+}
+
+int dcircle_table::screen(size_t handle, const dpos2d& pos) const
+{
+   double dx = pos.x() - m_x[handle];
+   double dy = pos.y() - m_y[handle];
+   double diff = dx*dx + dy*dy - m_r2[handle];
+   double band = m_band[handle];
+   return (diff < -band)? 1 : ((diff > band)? -1 : 0);
+}
+
+void dcircle_table::screen_all(const dpos2d& pos, std::vector<signed char>& result) const
+{
+   const size_t n = m_tri.size();
+   result.resize(n);
+
+   const double  px   = pos.x();
+   const double  py   = pos.y();
+   const double* x    = m_x.data();
+   const double* y    = m_y.data();
+   const double* r2   = m_r2.data();
+   const double* band = m_band.data();
+   signed char*  res  = result.data();
+   for(size_t i=0; i<n; i++) {
+      double dx = px - x[i];
+      double dy = py - y[i];
+      double diff = dx*dx + dy*dy - r2[i];
+      res[i] = (diff < -band[i])? 1 : ((diff > band[i])? -1 : 0);
+   }
+}
+
+void dcircle_table::clear()
+{
+   m_x.clear();
+   m_y.clear();
+   m_r2.clear();
+   m_band.clear();
+   m_tri.clear();
+   m_free.clear();
+}
@@ -0,0 +1,72 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef DCIRCLE_TABLE_H
+#define DCIRCLE_TABLE_H
+
+#include <cstddef>
+#include <vector>
+#include "dpos2d.h"
+class dtriangle;
+
+// Geometry
+// ========
+// dcircle_table holds the circumcircles of all triangles in a mesh as separate
+// contiguous arrays (centre x, centre y, squared radius), indexed by a triangle handle.
+// Screening a position against many circles is then a tight loop without
+// dereferencing triangles or vertices. The screening is approximate, positions
+// too close to a circle to be decided are reported as undecided and must be
+// resolved by the exact incircle predicate.
+
+class dcircle_table {
+public:
+   dcircle_table();
+   virtual ~dcircle_table();
+
+   // create a circle record for the CCW triangle (p1,p2,p3), returns the handle
+   size_t create(dtriangle* triangle, const dpos2d& p1, const dpos2d& p2, const dpos2d& p3);
+
+   // release a record, the handle may be reused by a later create
+   void release(size_t handle);
+
+   // number of records, including released ones
+   size_t size() const { return m_tri.size(); }
+
+   // triangle owning the record, NULL for released records
+   dtriangle* triangle(size_t handle) const { return m_tri[handle]; }
+
+   // circle centre and radius
+   dpos2d center(size_t handle) const { return dpos2d(m_x[handle],m_y[handle]); }
+   double radius(size_t handle) const;
+
+   // screen pos against one circle: 1=inside, -1=outside, 0=undecided
+   int screen(size_t handle, const dpos2d& pos) const;
+
+   // screen pos against all records, result[handle] as for screen(). Released records are outside
+   void screen_all(const dpos2d& pos, std::vector<signed char>& result) const;
+
+   // remove all records
+   void clear();
+
+private:
+   std::vector<double>     m_x;     // centre x
+   std::vector<double>     m_y;     // centre y
+   std::vector<double>     m_r2;    // squared radius
+   std::vector<double>     m_band;  // half width of the undecided band around m_r2
+   std::vector<dtriangle*> m_tri;   // owning triangle
+   std::vector<size_t>     m_free;  // released handles
+};
+
+#endif // DCIRCLE_TABLE_H
@@ -15,6 +15,7 @@
 
 #include "dcoedge.h"
 #include "dedge.h"
+#include "dmesh.h"
 
 dcoedge::dcoedge(dentity* parent, dedge* edge, bool fwd)
 : m_parent(parent)
@@ -31,7 +32,7 @@ dcoedge::~dcoedge()
 
 dcoedge* dcoedge::clone(dentity* parent)
 {
-   return new dcoedge(parent,m_edge,m_fwd);
+   return parent->get_mesh()->create_coedge(parent,m_edge,m_fwd);
 }
 
 
@@ -32,6 +32,7 @@ public:
    friend class dtriangle;
    friend class dloop;
    friend class dprofile;
+   friend class dmesh;
 
    // return the parent object
    const dentity* parent() const { return m_parent; }
@@ -24,17 +24,12 @@ dedge::dedge(dmesh* mesh, size_t iv1, size_t iv2)
 : dentity(mesh)
 , m_iv1((iv1<iv2)? iv1 : iv2)
 , m_iv2((iv1<iv2)? iv2 : iv1)
+, m_index(0)
 {}
 
 dedge::~dedge()
 {}
 
-size_t dedge::key(size_t iv1, size_t iv2)
-{
-   if(iv1 < iv2) return iv1*1000000 + iv2;
-   return  iv2*1000000 + iv1;
-}
-
 dvec2d dedge::dir() const
 {
    const dmesh* mesh = get_mesh();
@@ -65,9 +65,6 @@ public:
 
 protected:
 
-   // return the edge key, used for edge lookup based on vertex indices
-   static size_t key(size_t iv1, size_t iv2);
-
    dedge(dmesh* mesh, size_t iv1, size_t iv2);
    virtual ~dedge();
 
@@ -75,14 +72,16 @@ private:
    size_t       m_iv1;   // ALWAYS the lowest vertex index
    size_t       m_iv2;   // ALWAYS the highest vertex index
    dcoedge_set  m_users;
+   size_t       m_index; // position in the mesh edge vector
 };
 
 
 template<typename T>
 bool dedge::is_referenced_from() const
 {
+   // the zero reference of the supertriangle is skipped
    for(auto coedge : m_users) {
-      if(dynamic_cast<T*>(coedge->parent())) return true;
+      if(coedge && dynamic_cast<T*>(coedge->parent())) return true;
    }
    return false;
 }
@@ -33,7 +33,7 @@ dloop::~dloop()
 void dloop::clear()
 {
    for(auto coedge : m_coedges) {
-      delete coedge;
+      get_mesh()->destroy_coedge(coedge);
    }
    m_coedges.clear();
 }
@@ -152,14 +152,14 @@ size_t dloop::split_coedge(dcoedge* coedge)
 
       // erase the old coedge from the container and delete it
       auto ipos = m_coedges.erase(icoedge);
-      delete coedge;
+      mesh->destroy_coedge(coedge);
 
       // also request the old edge to be removed
       mesh->remove_edge(edge);
 
       // insert the new coedges in their proper loop positions
-      ipos = m_coedges.insert(ipos,new dcoedge(this,e2,fwd2));
-      ipos = m_coedges.insert(ipos,new dcoedge(this,e1,fwd1));
+      ipos = m_coedges.insert(ipos,mesh->create_coedge(this,e2,fwd2));
+      ipos = m_coedges.insert(ipos,mesh->create_coedge(this,e1,fwd1));
 
       // return the vertex index
       return ivm;
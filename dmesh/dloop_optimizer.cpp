@@ -15,43 +15,68 @@
 
 #include "dloop_optimizer.h"
 #include "dline2d.h"
-#include <map>
+#include <thread>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
 
-typedef std::map<size_t,dpos2d> pos_map;
-
-
-dloop_optimizer::dloop_optimizer(double arrow_max, double dist_max)
+dloop_optimizer::dloop_optimizer(double arrow_max, double dist_max, method m)
 : m_arrow_max(arrow_max)
 , m_dist_max(dist_max)
+, m_method(m)
 {}
 
 dloop_optimizer::~dloop_optimizer()
 {}
 
-static pos_map::iterator next_pos(pos_map& pmap, pos_map::iterator it)
+std::vector<dpos2d> dloop_optimizer::optimize(const std::vector<dpos2d>& points) const
 {
-   // next_pos finds the next position in the lopp, possibly beyond the vector end
-   pos_map::iterator itnext = it;
-   itnext++;
-   if(itnext == pmap.end()) itnext = pmap.begin();
-   return itnext;
+   return (m_method == DOUGLAS_PEUCKER)? optimize_douglas_peucker(points) : optimize_arrow(points);
 }
 
-std::vector<dpos2d> dloop_optimizer::optimize(const std::vector<dpos2d>& points) const
+std::vector<std::vector<dpos2d>> dloop_optimizer::optimize(const std::vector<std::vector<dpos2d>>& loops, size_t nthreads) const
+{
+   std::vector<std::vector<dpos2d>> opt_loops(loops.size());
+   if(nthreads == 0) nthreads = std::max(1u,std::thread::hardware_concurrency());
+   nthreads = std::min(nthreads,loops.size());
+
+   // the largest loops are started first, each thread takes the next loop when done
+   std::vector<size_t> order(loops.size());
+   std::iota(order.begin(),order.end(),size_t(0));
+   std::sort(order.begin(),order.end(),[&loops](size_t a, size_t b) { return loops[a].size() > loops[b].size(); });
+
+   std::atomic<size_t> inext(0);
+   auto work = [this,&loops,&opt_loops,&order,&inext]() {
+      for(size_t k=inext++; k<order.size(); k=inext++) {
+         opt_loops[order[k]] = optimize(loops[order[k]]);
+      }
+   };
+
+   std::vector<std::thread> threads;
+   for(size_t i=1; i<nthreads; i++) threads.push_back(std::thread(work));
+   work();
+   for(auto& t : threads) t.join();
+
+   return opt_loops;
+}
+
+std::vector<dpos2d> dloop_optimizer::optimize_arrow(const std::vector<dpos2d>& points) const
 {
    std::vector<dpos2d> opt_points;
    if(points.size() > 0) {
 
-      // first make a map to simplify erasing, the key is the original vector index
-      // we need to use a map and not an unordered_map, as the sequence is significant
-      pos_map pmap;
-      for(size_t i=0; i<points.size(); i++) {
-         pmap[i] = points[i];
-      }
+      // the loop is kept as a circular list of the original vector indices,
+      // so a point is erased in constant time and the remaining points keep their sequence
+      const size_t n = points.size();
+      std::vector<size_t> next(n);
+      std::vector<bool>   alive(n,true);
+      for(size_t i=0; i<n; i++) next[i] = (i+1<n)? i+1 : 0;
+      size_t nalive = n;
 
-      pos_map::iterator iprev = pmap.begin();
-      pos_map::iterator imid  = next_pos(pmap,iprev);
-      pos_map::iterator inext = next_pos(pmap,imid);
+      size_t iprev = 0;
+      size_t imid  = next[iprev];
+      size_t inext = next[imid];
 
       size_t icount  = 0;  // counts the number of tests, i.e. rounds of the while loop
       size_t ierased = 0;  // count when last erased happened
@@ -59,13 +84,13 @@ std::vector<dpos2d> dloop_optimizer::optimize(const std::vector<dpos2d>& points)
       while(!finished) {
 
          // minimal size of loop vector is 3
-         if(pmap.size() < 4)break;
+         if(nalive < 4)break;
 
          icount++;
 
-         dpos2d p1(iprev->second);
-         dpos2d midpos(imid->second);
-         dpos2d p2(inext->second);
+         const dpos2d& p1     = points[iprev];
+         const dpos2d& midpos = points[imid];
+         const dpos2d& p2     = points[inext];
          double dist = p1.dist(midpos);
 
          dline2d line(p1,p2);
@@ -73,33 +98,108 @@ std::vector<dpos2d> dloop_optimizer::optimize(const std::vector<dpos2d>& points)
          double  arrow = midpos.dist(proj);
          if((dist > m_dist_max) || (arrow > m_arrow_max)) {
             // keep midpos
-             iprev = next_pos(pmap,iprev);
-             imid  = next_pos(pmap,imid);
-             inext = next_pos(pmap,inext);
+             iprev = next[iprev];
+             imid  = next[imid];
+             inext = next[inext];
          }
          else {
             // eliminate midpos
-            pos_map::iterator ierase = imid;
-            pmap.erase(ierase);
+            next[iprev] = inext;
+            alive[imid] = false;
+            nalive--;
             ierased = icount;
 
             iprev = inext;
-            imid  = next_pos(pmap,iprev);
-            inext = next_pos(pmap,imid);
+            imid  = next[iprev];
+            inext = next[imid];
          }
 
          // if we have gone 2 rounds without any points erased, we call it quits
-         finished = ((icount - ierased) > 2*pmap.size());
+         finished = ((icount - ierased) > 2*nalive);
       }
 
       // return the points remaining
-      opt_points.reserve(pmap.size());
-      for(auto p : pmap) {
-         opt_points.push_back(p.second);
+      opt_points.reserve(nalive);
+      for(size_t i=0; i<n; i++) {
+         if(alive[i]) opt_points.push_back(points[i]);
+      }
+   }
+
+   return opt_points;
+}
+
+// distance from p to the line segment a-b
+static double segment_dist(const dpos2d& p, const dpos2d& a, const dpos2d& b)
+{
+   double dx = b.x()-a.x();
+   double dy = b.y()-a.y();
+   double len2 = dx*dx + dy*dy;
+   double u = (len2 > 0.0)? ((p.x()-a.x())*dx + (p.y()-a.y())*dy)/len2 : 0.0;
+   u = std::max(0.0,std::min(1.0,u));
+   double ex = a.x() + u*dx - p.x();
+   double ey = a.y() + u*dy - p.y();
+   return sqrt(ex*ex + ey*ey);
+}
+
+std::vector<dpos2d> dloop_optimizer::optimize_douglas_peucker(const std::vector<dpos2d>& points) const
+{
+   // minimal size of loop vector is 3
+   const size_t n = points.size();
+   if(n < 4) return points;
+
+   // the loop is split in two chains at the first point and the point farthest from it
+   size_t ifar = 0;
+   double dfar = 0.0;
+   for(size_t i=1; i<n; i++) {
+      double d = points[0].dist(points[i]);
+      if(d > dfar) { dfar = d; ifar = i; }
+   }
+   if(ifar == 0) return points;
+
+   std::vector<bool> keep(n,false);
+   keep[0]    = true;
+   keep[ifar] = true;
+
+   // chains [a,b] of indices, b==n is the first point closing the loop.
+   // An explicit stack avoids deep recursion on long outlines
+   std::vector<std::pair<size_t,size_t>> chains;
+   chains.push_back(std::make_pair(size_t(0),ifar));
+   chains.push_back(std::make_pair(ifar,n));
+   while(chains.size() > 0) {
+      size_t a = chains.back().first;
+      size_t b = chains.back().second;
+      chains.pop_back();
+      if(b-a < 2) continue;
+
+      const dpos2d& pa = points[a];
+      const dpos2d& pb = points[(b<n)? b : 0];
+      size_t imax = a;
+      double dmax = -1.0;
+      for(size_t i=a+1; i<b; i++) {
+         double d = segment_dist(points[i],pa,pb);
+         if(d > dmax) { dmax = d; imax = i; }
+      }
+
+      // a chord within the arrow tolerance may still be too long
+      bool split = (dmax > m_arrow_max);
+      if(!split && pa.dist(pb) > m_dist_max) {
+         split = true;
+         if(!(dmax > 0.0)) imax = (a+b)/2;
+      }
+      if(split) {
+         keep[imax] = true;
+         chains.push_back(std::make_pair(a,imax));
+         chains.push_back(std::make_pair(imax,b));
       }
    }
 
-   return std::move(opt_points);
+   std::vector<dpos2d> opt_points;
+   opt_points.reserve(std::count(keep.begin(),keep.end(),true));
+   for(size_t i=0; i<n; i++) {
+      if(keep[i]) opt_points.push_back(points[i]);
+   }
+   if(opt_points.size() < 3) return points;
+   return opt_points;
 }
 
 
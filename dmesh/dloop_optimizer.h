@@ -16,6 +16,7 @@
 #ifndef dloop_optimizer_H
 #define dloop_optimizer_H
 
+#include <cstddef>
 #include <vector>
 #include "dpos2d.h"
 
@@ -27,25 +28,40 @@
 //
 // Points are erased on the basis of the "arrow tolerance", i.e. for
 // 3 consecutive points, p1 -- p2 -- p3 how far from the line p1-p3 is p2 allowed to be.
+//
+// ARROW tests consecutive point triplets until a round erases nothing.
+// DOUGLAS_PEUCKER keeps the point farthest from a chord while it is beyond the arrow
+// tolerance or the chord is longer than the distance tolerance, O(n log n) for typical
+// outlines, suited for loops of 10^5 points and more.
 
 class dloop_optimizer {
 public:
+   enum method { ARROW, DOUGLAS_PEUCKER };
 
-   dloop_optimizer(double arrow_max, double dist_max);
+   dloop_optimizer(double arrow_max, double dist_max, method m = ARROW);
    virtual ~dloop_optimizer();
 
    // run the optimizer
    std::vector<dpos2d> optimize(const std::vector<dpos2d>& points) const;
 
+   // run the optimizer on several loops, using up to nthreads threads (0 = all cores)
+   std::vector<std::vector<dpos2d>> optimize(const std::vector<std::vector<dpos2d>>& loops, size_t nthreads = 0) const;
+
    // compute signed area of ppoint loop
    static double signed_area(const std::vector<dpos2d>& points);
 
    double arrow_max() const { return m_arrow_max; }
    double dist_max() const { return m_dist_max; }
+   method opt_method() const { return m_method; }
+
+protected:
+   std::vector<dpos2d> optimize_arrow(const std::vector<dpos2d>& points) const;
+   std::vector<dpos2d> optimize_douglas_peucker(const std::vector<dpos2d>& points) const;
 
 private:
    double m_arrow_max;  // "arrow tolerance" - max arrow distance from p2 to projection p1 - p3
    double m_dist_max;   // "distance tolerance" - max distance between vertices along loop
+   method m_method;
 };
 
 #endif // dloop_optimizer_H
@@ -21,19 +21,90 @@
 
 #include "dpos2d.h"
 #include "dvec2d.h"
+#include "dpredicates.h"
 #include <map>
+#include <queue>
+#include <tuple>
 #include <string>
 #include <cmath>
+#include <random>
+#include <algorithm>
+#include <cstdint>
 
 #include <iomanip>
 
+// return the distance along a Hilbert curve of order 16 for grid cell (x,y)
+static uint64_t hilbert_key(uint32_t x, uint32_t y)
+{
+   const uint32_t n = 1u << 16;
+   uint64_t d = 0;
+   for(uint32_t s=n/2; s>0; s/=2) {
+      uint32_t rx = (x & s)? 1 : 0;
+      uint32_t ry = (y & s)? 1 : 0;
+      d += uint64_t(s)*uint64_t(s)*((3*rx)^ry);
+
+      // rotate the quadrant
+      if(ry == 0) {
+         if(rx == 1) {
+            x = s-1 - (x & (s-1));
+            y = s-1 - (y & (s-1));
+         }
+         std::swap(x,y);
+      }
+   }
+   return d;
+}
+
 dmesh::dmesh(double epspnt)
 : m_epspnt(epspnt)
+, m_last(0)
+, m_serial(0)
+, m_created(0)
 , m_profile(this)
 {}
 
 dmesh::~dmesh()
-{}
+{
+   destroy_all();
+}
+
+void dmesh::destroy_all()
+{
+   m_profile.clear();
+
+   for(auto triangle : m_tri) {
+      triangle->~dtriangle();
+      m_tri_pool.release(triangle);
+   }
+   m_tri.clear();
+   m_last = 0;
+
+   for(auto edge : m_edge) {
+      edge->~dedge();
+      m_edge_pool.release(edge);
+   }
+   m_edge.clear();
+   m_vert_edges.clear();
+
+   for(auto v : m_vert) {
+      v->~dvertex();
+      m_vert_pool.release(v);
+   }
+   m_vert.clear();
+}
+
+dcoedge* dmesh::create_coedge(dentity* parent, dedge* edge, bool fwd)
+{
+   return new(m_coedge_pool.allocate()) dcoedge(parent,edge,fwd);
+}
+
+void dmesh::destroy_coedge(dcoedge* coedge)
+{
+   if(coedge) {
+      coedge->~dcoedge();
+      m_coedge_pool.release(coedge);
+   }
+}
 
 bool dmesh::triangulate_point_cloud(const std::vector<dpos2d>& points)
 {
@@ -57,6 +128,7 @@ void dmesh::reserve_vertices(size_t nv)
 {
    // the 3 first vertices are supervertices, will be assigned positions by triangulate_vertices();
    m_vert.reserve(3 + nv);
+   m_vert_edges.reserve(3 + nv);
 
    if(m_vert.size() == 0) {
       // allocate the supervertices, here with dummy coordinates
@@ -74,11 +146,10 @@ void dmesh::add_loop(const std::vector<dpos2d>& points)
 void  dmesh::remove_unused_edges()
 {
    // clear any unused edges
-   std::unordered_set<dedge*> bad_edges;
-   for(auto p : m_edge) {
-      dedge* edge = p.second;
+   std::vector<dedge*> bad_edges;
+   for(auto edge : m_edge) {
       if(edge->use_count() < 1) {
-         bad_edges.insert(edge);
+         bad_edges.push_back(edge);
       }
    }
    for(auto edge : bad_edges) {
@@ -91,29 +162,20 @@ bool dmesh::triangulate_profile(bool rmv_nonmat, bool split_loops, bool rmv_unbo
    // Sort profile loops
    m_profile.sort_loops();
 
-   // run triangulation based on loop vertices
-   bool repeat = true;
-   while(repeat) {
-
-      // remove any existing triangles, we will perform a remesh based on vertices and edges
-      clear_triangles();
-      remove_unused_edges();
-
-      repeat = false;
-      triangulate_vertices();
+   // remove any existing triangles, we will perform a remesh based on vertices and edges
+   clear_triangles();
+   remove_unused_edges();
 
-      // remove extra triangles
-      if(rmv_nonmat) {
-         remove_nonmaterial_triangles();
-      }
+   // run triangulation based on loop vertices, optionally recover the missing loop edges
+   triangulate_vertices(split_loops);
 
-      if(split_loops) {
-         repeat = (recover_loop_edges_split() > 0);
-      }
+   // remove extra triangles
+   if(rmv_nonmat) {
+      remove_nonmaterial_triangles();
+   }
 
-      if(rmv_unbound) {
-         remove_unbounded_triangles();
-      }
+   if(rmv_unbound) {
+      remove_unbounded_triangles();
    }
 
    return true;
@@ -121,37 +183,37 @@ bool dmesh::triangulate_profile(bool rmv_nonmat, bool split_loops, bool rmv_unbo
 
 bool dmesh::triangulate_refine_area(double area_limit, double param, bool rmv_nonmat, bool split_loops, bool rmv_unbound)
 {
-   size_t nref = 0;
-   do {
-      nref = 0;
-      typedef std::multimap<double,dtriangle*>         area_mmap;
-      area_mmap    area;
-      for(auto triangle : m_tri) {
-         area.insert(std::make_pair(triangle->signed_area(),triangle));
-      }
+   // max-heap of oversized triangles, largest first. Entries of triangles destroyed by
+   // later insertions are skipped when popped, identified by the creation serial number
+   typedef std::tuple<double,size_t,dtriangle*> area_entry;
+   std::priority_queue<area_entry> heap;
+   for(auto triangle : m_tri) {
+      double area = triangle->signed_area();
+      if(area > area_limit) heap.push(area_entry(area,triangle->m_serial,triangle));
+   }
 
-      for(auto p : area) {
-         if(p.first > area_limit) {
-            dtriangle* triangle = p.second;
-            dpos2d p1 = triangle->centroid();
-            dpos2d p2 = triangle->circle().center();
-            dpos2d p  = p1 + param*(p2-p1);
-            if(triangle->in_triangle(p)) {
-               bowyer_watson(add_vertex(p));
-               nref++;
-               break;
-            }
+   // each insertion only adds the triangles of its own cavity to the heap
+   std::vector<dtriangle*> created;
+   m_created = &created;
+   while(heap.size() > 0) {
+      dtriangle* triangle = std::get<2>(heap.top());
+      size_t     serial   = std::get<1>(heap.top());
+      heap.pop();
+      if(m_tri.find(triangle) == m_tri.end() || triangle->m_serial != serial) continue;
+
+      dpos2d p1 = triangle->centroid();
+      dpos2d p2 = triangle->circle().center();
+      dpos2d p  = p1 + param*(p2-p1);
+      if(triangle->in_triangle(p)) {
+         created.clear();
+         bowyer_watson(add_vertex(p),triangle);
+         for(auto t : created) {
+            double area = t->signed_area();
+            if(area > area_limit) heap.push(area_entry(area,t->m_serial,t));
          }
       }
    }
-   while(nref > 0);
-
-   size_t nsplit = 0;
-   do {
-      remove_nonmaterial_triangles();
-      nsplit = recover_loop_edges_split();
-   }
-   while(nsplit > 0);
+   m_created = 0;
 
    triangulate_profile(rmv_nonmat,split_loops,rmv_unbound);
 //   remove_unbounded_triangles();
@@ -202,7 +264,7 @@ dtriangle* dmesh::add_supertriangle()
    return triangle;
 }
 
-bool dmesh::triangulate_vertices()
+bool dmesh::triangulate_vertices(bool recover_loops)
 {
    if(m_vert.size()<6)throw std::logic_error("triangulate_vertices: not enough vertices exist");
 
@@ -218,10 +280,16 @@ bool dmesh::triangulate_vertices()
    size_t isv3 = triangle->vertex3();
 
    // perform meshing by adding user points (skipping the super vertices)
-   for(size_t iv=3; iv<m_vert.size(); iv++) {
+   for(size_t iv : insertion_order()) {
       bowyer_watson(iv);
    }
 
+   // recover the loop edges missing from the triangulation, locally around each of them.
+   // This is done while the supertriangle still covers all the split vertices
+   if(recover_loops) {
+      recover_loop_edges_split();
+   }
+
    // remove triangles referring to supervertices
    std::unordered_set<dtriangle*> bad_triangles;
    for(auto triangle : m_tri) {
@@ -238,9 +306,10 @@ bool dmesh::triangulate_vertices()
       }
    }
 
-   // erase the zero-references in edges, introduced by supertriangle
-   for(auto p : m_edge) {
-      dedge* edge = p.second;
+   // erase the zero-references in edges, introduced by supertriangle.
+   // Traversed from the back, as removing an edge moves the last edge into its position
+   for(size_t ie=m_edge.size(); ie-- > 0; ) {
+      dedge* edge = m_edge[ie];
       edge->release(0);
 
       if(edge->use_count() == 0) {
@@ -256,7 +325,46 @@ bool dmesh::triangulate_vertices()
    return true;
 }
 
-void dmesh::bowyer_watson(size_t iv)
+std::vector<size_t> dmesh::insertion_order() const
+{
+   std::vector<size_t> order;
+   if(m_vert.size() <= 3) return order;
+   order.reserve(m_vert.size()-3);
+   for(size_t iv=3; iv<m_vert.size(); iv++) order.push_back(iv);
+
+   // extent of the user vertices, mapped to the Hilbert grid
+   double xmin = m_vert[3]->pos().x(), xmax = xmin;
+   double ymin = m_vert[3]->pos().y(), ymax = ymin;
+   for(size_t iv : order) {
+      const dpos2d& p = m_vert[iv]->pos();
+      xmin = std::min(xmin,p.x()); xmax = std::max(xmax,p.x());
+      ymin = std::min(ymin,p.y()); ymax = std::max(ymax,p.y());
+   }
+   double dmax  = std::max(xmax-xmin,ymax-ymin);
+   double scale = (dmax > 0.0)? 65535.0/dmax : 0.0;
+
+   std::vector<uint64_t> key(m_vert.size(),0);
+   for(size_t iv : order) {
+      const dpos2d& p = m_vert[iv]->pos();
+      key[iv] = hilbert_key(uint32_t((p.x()-xmin)*scale),uint32_t((p.y()-ymin)*scale));
+   }
+
+   // fixed seed, so the triangulation is repeatable
+   std::mt19937 rng(12345);
+   std::shuffle(order.begin(),order.end(),rng);
+
+   // rounds from the back: the last round holds half the vertices, the one before a quarter etc.
+   auto by_key = [&key](size_t iv1, size_t iv2) { return key[iv1] < key[iv2]; };
+   size_t iend = order.size();
+   while(iend > 0) {
+      size_t ibegin = (iend > 64)? iend/2 : 0;
+      std::sort(order.begin()+ibegin,order.begin()+iend,by_key);
+      iend = ibegin;
+   }
+   return order;
+}
+
+void dmesh::bowyer_watson(size_t iv, dtriangle* hint)
 {
    // get the position of the vertex
    const dpos2d& p = m_vert[iv]->pos();
@@ -264,9 +372,53 @@ void dmesh::bowyer_watson(size_t iv)
    // this will contain the triangles to be removed because of p
    std::unordered_set<dtriangle*> bad_triangles;
 
-   for(auto triangle : m_tri) {
-      if(triangle->in_circumcircle(p,m_epspnt)) {
-         bad_triangles.insert(triangle);
+   // locate the triangle containing p, the bad triangles form a connected
+   // cavity around it which is found by flood fill from there
+   dtriangle* start = locate_triangle(p,(hint)? hint : m_last);
+   bool constrained = (m_profile.size() > 0);
+   if(start && start->in_circumcircle(p)) {
+      std::vector<dtriangle*> stack(1,start);
+      bad_triangles.insert(start);
+      while(stack.size() > 0) {
+         dtriangle* triangle = stack.back();
+         stack.pop_back();
+         for(size_t i=0; i<3; i++) {
+            // the cavity never crosses a loop edge, so recovered loop edges are kept
+            dcoedge* coedge = triangle->coedge(i);
+            if(constrained && coedge->edge()->is_referenced_from<dloop>()) continue;
+            dtriangle* next = neighbour(triangle,coedge);
+            if(next && bad_triangles.find(next)==bad_triangles.end() && next->in_circumcircle(p)) {
+               bad_triangles.insert(next);
+               stack.push_back(next);
+            }
+         }
+      }
+   }
+   else {
+      // p is not inside the mesh, screen all circumcircles in one pass and
+      // resolve the undecided ones with a batched exact incircle test
+      std::vector<signed char> screen;
+      m_circles.screen_all(p,screen);
+      std::vector<dtriangle*> tri;
+      for(size_t handle=0; handle<screen.size(); handle++) {
+         if(screen[handle] > 0)       bad_triangles.insert(m_circles.triangle(handle));
+         else if(screen[handle] == 0) tri.push_back(m_circles.triangle(handle));
+      }
+      std::vector<double> coords(6*tri.size());
+      for(size_t i=0; i<tri.size(); i++) {
+         const dtriangle* triangle = tri[i];
+         const dpos2d& p1 = m_vert[triangle->vertex1()]->pos();
+         const dpos2d& p2 = m_vert[triangle->vertex2()]->pos();
+         const dpos2d& p3 = m_vert[triangle->vertex3()]->pos();
+         double* c = &coords[6*i];
+         c[0] = p1.x(); c[1] = p1.y();
+         c[2] = p2.x(); c[3] = p2.y();
+         c[4] = p3.x(); c[5] = p3.y();
+      }
+      std::vector<unsigned char> inside(tri.size());
+      if(tri.size() > 0) dpredicates::incircle(coords.data(),tri.size(),p,inside.data());
+      for(size_t i=0; i<tri.size(); i++) {
+         if(inside[i]) bad_triangles.insert(tri[i]);
       }
    }
 
@@ -302,6 +454,48 @@ void dmesh::bowyer_watson(size_t iv)
    }
 }
 
+dtriangle* dmesh::neighbour(dtriangle* triangle, dcoedge* coedge)
+{
+   // the edge users can also be loop coedges or the zero reference of the supertriangle
+   dedge* edge = coedge->edge();
+   for(auto user : *edge) {
+      if(user && user != coedge) {
+         if(dtriangle* next = dynamic_cast<dtriangle*>(user->parent())) {
+            if(next != triangle) return next;
+         }
+      }
+   }
+   return 0;
+}
+
+dtriangle* dmesh::locate_triangle(const dpos2d& pos, dtriangle* start)
+{
+   if(!start) return 0;
+
+   // straight walk: cross any edge having pos on its outside (triangles are CCW).
+   // The first edge checked is rotated for each step, so the walk cannot cycle forever
+   dtriangle* triangle = start;
+   size_t max_steps = m_tri.size();
+   for(size_t istep=0; istep<max_steps; istep++) {
+      dtriangle* next = 0;
+      for(size_t k=0; k<3; k++) {
+         dcoedge* coedge = triangle->coedge((k+istep)%3);
+         const dpos2d& p1 = m_vert[coedge->vertex1()]->pos();
+         const dpos2d& p2 = m_vert[coedge->vertex2()]->pos();
+         if(dpredicates::orient2d(p1,p2,pos) < 0.0) {
+            next = neighbour(triangle,coedge);
+
+            // pos is outside the mesh
+            if(!next) return 0;
+            break;
+         }
+      }
+      if(!next) return triangle;
+      triangle = next;
+   }
+   return 0;
+}
+
 bool dmesh::compute_profile()
 {
    m_profile.compute(this);
@@ -311,7 +505,8 @@ bool dmesh::compute_profile()
 size_t dmesh::add_vertex(const dpos2d& pos)
 {
    size_t iv = m_vert.size();
-   m_vert.push_back(new dvertex(pos));
+   m_vert.push_back(new(m_vert_pool.allocate()) dvertex(pos));
+   m_vert_edges.push_back(std::vector<dedge*>());
    return iv;
 }
 
@@ -323,16 +518,31 @@ const dvertex* dmesh::get_vertex(size_t iv) const
 
 dedge* dmesh::get_create_edge(size_t iv1, size_t iv2)
 {
-   // get edge key
-   size_t key = dedge::key(iv1,iv2);
+   // edges are listed under their lowest vertex index
+   size_t ivlow  = (iv1<iv2)? iv1 : iv2;
+   size_t ivhigh = (iv1<iv2)? iv2 : iv1;
 
    // look it up or create a new
-   auto iedge = m_edge.find(key);
-   if(iedge == m_edge.end()) {
-      auto p = m_edge.insert(std::make_pair(key,new dedge(this,iv1,iv2)));
-      iedge = p.first;
+   std::vector<dedge*>& edges = m_vert_edges[ivlow];
+   for(auto edge : edges) {
+      if(edge->vertex2() == ivhigh) return edge;
+   }
+
+   dedge* edge = new(m_edge_pool.allocate()) dedge(this,iv1,iv2);
+   edge->m_index = m_edge.size();
+   m_edge.push_back(edge);
+   edges.push_back(edge);
+   return edge;
+}
+
+dedge* dmesh::find_edge(size_t iv1, size_t iv2)
+{
+   size_t ivlow  = (iv1<iv2)? iv1 : iv2;
+   size_t ivhigh = (iv1<iv2)? iv2 : iv1;
+   for(auto edge : m_vert_edges[ivlow]) {
+      if(edge->vertex2() == ivhigh) return edge;
    }
-   return iedge->second;
+   return 0;
 }
 
 double dmesh::cross(size_t iv1, size_t iv2, size_t iv3)
@@ -341,9 +551,7 @@ double dmesh::cross(size_t iv1, size_t iv2, size_t iv3)
    const dvertex* v2 = get_vertex(iv2);
    const dvertex* v3 = get_vertex(iv3);
 
-   dvec2d vec1(v1->pos(),v2->pos());
-   dvec2d vec2(v1->pos(),v3->pos());
-   return vec1.cross(vec2);
+   return dpredicates::orient2d(v1->pos(),v2->pos(),v3->pos());
 }
 
 dtriangle* dmesh::add_triangle(size_t iv1, dedge* edge)
@@ -355,12 +563,15 @@ dtriangle* dmesh::add_triangle(size_t iv1, size_t iv2,size_t iv3)
 {
    dtriangle* triangle = 0;
    if(cross(iv1,iv2,iv3) > 0) {
-      triangle = new dtriangle(this,iv1,iv2,iv3);
+      triangle = new(m_tri_pool.allocate()) dtriangle(this,iv1,iv2,iv3);
    }
    else {
-      triangle = new dtriangle(this,iv1,iv3,iv2);
+      triangle = new(m_tri_pool.allocate()) dtriangle(this,iv1,iv3,iv2);
    }
+   triangle->m_serial = m_serial++;
    m_tri.insert(triangle);
+   m_last = triangle;
+   if(m_created) m_created->push_back(triangle);
 
    return triangle;
 }
@@ -371,17 +582,16 @@ std::vector<dedge*> dmesh::remove_triangle(dtriangle* triangle, bool remove_unus
    // some of the edges may have use_count=0 after deleting triangle
    std::vector<dedge*> edges = triangle->get_edges();
    m_tri.erase(triangle);
-   delete triangle;
+   if(m_last == triangle) m_last = 0;
+   triangle->~dtriangle();
+   m_tri_pool.release(triangle);
 
    if(remove_unused_edges) {
       std::vector<dedge*> used_edges;
       for(auto edge : edges) {
 
-         // get edge key
          if(edge->use_count() == 0) {
-            size_t key = dedge::key(edge->vertex1(),edge->vertex2());
-            m_edge.erase(key);
-            delete edge;
+            destroy_edge(edge);
          }
          else {
             // this edge is still in use after deleting triangle
@@ -397,9 +607,27 @@ std::vector<dedge*> dmesh::remove_triangle(dtriangle* triangle, bool remove_unus
 void dmesh::remove_edge(dedge* edge)
 {
    if(!edge->use_count() == 0) throw std::logic_error("remove_edge: trying to remove edge with use_count>0!");
-   size_t key = dedge::key(edge->vertex1(),edge->vertex2());
-   m_edge.erase(key);
-   delete edge;
+   destroy_edge(edge);
+}
+
+void dmesh::destroy_edge(dedge* edge)
+{
+   // remove from the vertex adjacency
+   std::vector<dedge*>& edges = m_vert_edges[edge->vertex1()];
+   auto iedge = std::find(edges.begin(),edges.end(),edge);
+   if(iedge != edges.end()) {
+      *iedge = edges.back();
+      edges.pop_back();
+   }
+
+   // remove from the edge vector by moving the last edge into its position
+   dedge* last = m_edge.back();
+   m_edge[edge->m_index] = last;
+   last->m_index = edge->m_index;
+   m_edge.pop_back();
+
+   edge->~dedge();
+   m_edge_pool.release(edge);
 }
 
 void dmesh::clear_triangles()
@@ -416,12 +644,9 @@ void dmesh::clear_edges()
 {
    if(m_tri.size() > 0) throw std::logic_error("clear_edges: error, triangles exist!");
 
-   auto i=m_edge.begin();
-   while(i != m_edge.end()) {
-      remove_edge(i->second);
-      i=m_edge.begin();
+   while(m_edge.size() > 0) {
+      remove_edge(m_edge.back());
    }
-   m_edge.clear();
 }
 
 void dmesh::clear_vertices()
@@ -430,9 +655,11 @@ void dmesh::clear_vertices()
    if(m_edge.size() > 0) throw std::logic_error("clear_vertices: error, edges exist!");
 
    for(auto v : m_vert) {
-      delete v;
+      v->~dvertex();
+      m_vert_pool.release(v);
    }
    m_vert.clear();
+   m_vert_edges.clear();
 }
 
 void dmesh::prune_radius(double r)
@@ -520,8 +747,7 @@ void dmesh::remove_overlapping_triangles()
    std::unordered_set<dtriangle*> overlapping;
    for(auto& loop : m_profile ) {
 
-      for(auto& e : m_edge) {
-         dedge* edge = e.second;
+      for(auto edge : m_edge) {
          loop->collect_overlapping_triangles(edge,overlapping);
       }
    }
@@ -533,9 +759,10 @@ void dmesh::remove_overlapping_triangles()
 }
 
 
-void dmesh::export_p2d(std::ostream& out) const
+void dmesh::export_p2d(std::ostream& out, bool binary) const
 {
-   m_profile.export_p2d(out);
+   if(binary) m_profile.export_p2d_binary(out);
+   else       m_profile.export_p2d(out);
 }
 
 void  dmesh::import_p2d(std::istream& in, bool move_to_1st_quadrant)
@@ -548,61 +775,172 @@ size_t dmesh::recover_loop_edges_split()
 {
    size_t nsplit=0;
 
-   // traverse the profile loops and check the triangles next to them
+   // collect the loop coedges with edges missing from the triangulation, i.e. only used by the loop.
+   // After this, only the missing coedges and the ones created by splitting them are visited
+   std::vector<dcoedge*> missing;
    for(auto loop : m_profile) {
-
-      // bad_coedges contain the coedges that must be split in this loop
-      std::list<dcoedge*> bad_coedges;
-
-      // traverse the coedges in the loop
       for(auto coedge : *loop) {
          if(coedge->edge()->use_count() == 1) {
-            // this edge must be split
-            bad_coedges.push_back(coedge);
+            missing.push_back(coedge);
          }
       }
+   }
 
-      // perform the actual splitting
-      for(auto coedge : bad_coedges) {
-         size_t ivm = loop->split_coedge(coedge);
-         bowyer_watson(ivm);
-         nsplit++;
+   while(missing.size() > 0) {
+      dcoedge* coedge = missing.back();
+      missing.pop_back();
+
+      // the edge may have been recovered as a side effect of earlier flips or splits
+      dedge* edge = coedge->edge();
+      if(edge->use_count() > 1) continue;
+
+      // an edge crossing a single triangle edge is recovered by flipping that edge
+      if(flip_to_edge(edge)) continue;
+
+      // otherwise split the coedge. The cavity of the split vertex stops at loop edges,
+      // so edges already recovered are kept
+      dloop* loop = static_cast<dloop*>(coedge->parent());
+      size_t iv1  = edge->vertex1();
+      size_t iv2  = edge->vertex2();
+      size_t ivm  = loop->split_coedge(coedge);
+      bowyer_watson(ivm);
+      nsplit++;
+
+      // queue the new loop coedges that are still missing
+      dedge* split_edges[2] = { find_edge(iv1,ivm), find_edge(ivm,iv2) };
+      for(auto split_edge : split_edges) {
+         if(split_edge && split_edge->use_count() == 1) {
+            missing.push_back(*split_edge->begin());
+         }
       }
    }
 
    return nsplit;
 }
 
+bool dmesh::flip_to_edge(dedge* edge)
+{
+   size_t iv1 = edge->vertex1();
+   size_t iv2 = edge->vertex2();
+
+   // the triangle containing the edge midpoint must have iv1 or iv2 as a corner,
+   // its opposite triangle edge is then the first edge crossed
+   const dpos2d& p1 = m_vert[iv1]->pos();
+   const dpos2d& p2 = m_vert[iv2]->pos();
+   dtriangle* triangle = locate_triangle(0.5*(p1+p2),m_last);
+   if(!triangle) return false;
+
+   for(size_t i=0; i<3; i++) {
+      dcoedge* coedge = triangle->coedge(i);
+      dedge* cross_edge = coedge->edge();
+      size_t iva = triangle->oppsite_vertex(cross_edge);
+      if(iva != iv1 && iva != iv2) continue;
+
+      // the crossed edge can be flipped only if it is not a loop edge and the
+      // vertex on its other side is the other end of the missing edge
+      if(cross_edge->is_referenced_from<dloop>()) return false;
+      dtriangle* next = neighbour(triangle,coedge);
+      if(!next) return false;
+      size_t ivb = next->oppsite_vertex(cross_edge);
+      if(ivb != ((iva==iv1)? iv2 : iv1)) return false;
+
+      // the quadrilateral must be strictly convex
+      size_t ivc = cross_edge->vertex1();
+      size_t ivd = cross_edge->vertex2();
+      if(cross(iv1,iv2,ivc)*cross(iv1,iv2,ivd) >= 0.0) return false;
+      if(cross(ivc,ivd,iv1)*cross(ivc,ivd,iv2) >= 0.0) return false;
+
+      remove_triangle(triangle);
+      remove_triangle(next);
+      add_triangle(iv1,iv2,ivc);
+      add_triangle(iv1,iv2,ivd);
+
+      // restore the Delaunay property around the flipped edge
+      std::vector<std::pair<size_t,size_t>> candidates = { {iv1,ivc}, {ivc,iv2}, {iv2,ivd}, {ivd,iv1} };
+      legalize_edges(candidates);
+      return true;
+   }
+   return false;
+}
+
+void dmesh::legalize_edges(std::vector<std::pair<size_t,size_t>>& candidates)
+{
+   // Lawson flips of candidate edges not satisfying the empty circumcircle criterion.
+   // The edges are given by vertex pairs, since flipping removes edges
+   size_t max_flips = 4*m_tri.size();
+   size_t nflip = 0;
+   while(candidates.size() > 0 && nflip < max_flips) {
+      std::pair<size_t,size_t> iv = candidates.back();
+      candidates.pop_back();
+
+      // loop edges are never flipped
+      dedge* edge = find_edge(iv.first,iv.second);
+      if(!edge || edge->is_referenced_from<dloop>()) continue;
+
+      std::unordered_set<dtriangle*> tri = edge->triangles();
+      if(tri.size() != 2) continue;
+      auto i = tri.begin();
+      dtriangle* triangle1 = *i++;
+      dtriangle* triangle2 = *i;
+
+      size_t v1 = edge->vertex1();
+      size_t v2 = edge->vertex2();
+      size_t v3 = triangle1->oppsite_vertex(edge);
+      size_t v4 = triangle2->oppsite_vertex(edge);
+
+      // strict exact test, so cocircular vertices do not flip back and forth
+      if(!triangle1->in_circumcircle(m_vert[v4]->pos())) continue;
+
+      remove_triangle(triangle1);
+      remove_triangle(triangle2);
+      add_triangle(v3,v4,v1);
+      add_triangle(v3,v4,v2);
+      nflip++;
+
+      candidates.push_back(std::make_pair(v1,v3));
+      candidates.push_back(std::make_pair(v3,v2));
+      candidates.push_back(std::make_pair(v2,v4));
+      candidates.push_back(std::make_pair(v4,v1));
+   }
+}
+
 size_t dmesh::split_long_edges(double length)
 {
    size_t nsplit = 0;
    size_t iter = 0;
    size_t maxiter = 5000;
 
-   while(true) {
-
-      // collect the candidate edges
-      std::multimap<double,dedge*> edges;
-      for(auto p : m_edge) {
-         dedge* edge = p.second;
-
-         // check that this edge is not referenced by a loop
-         if(!edge->is_referenced_from<dloop>()) {
-            double edge_len = edge->length();
-
-            // check that the length is longer than limit
-            if(edge_len > length){
-               edges.insert(std::make_pair(edge_len,edge));
-            }
-         }
+   // max-heap of candidate edges, longest first. Entries refer to the vertex pair,
+   // so edges removed by earlier splits are detected by find_edge when popped
+   typedef std::tuple<double,size_t,size_t> edge_entry;
+   std::priority_queue<edge_entry> heap;
+   auto push_candidate = [&heap,length](dedge* edge) {
+      // check that this edge is not referenced by a loop and longer than limit
+      if(!edge->is_referenced_from<dloop>()) {
+         double edge_len = edge->length();
+         if(edge_len > length) heap.push(edge_entry(edge_len,edge->vertex1(),edge->vertex2()));
       }
+   };
+   for(auto edge : m_edge) push_candidate(edge);
 
-      if(edges.size() == 0  || ++iter>maxiter) break;
+   // each split only adds the edges of its new triangles to the heap
+   std::vector<dtriangle*> created;
+   m_created = &created;
+   while(heap.size() > 0) {
 
       // split longest first
-      dedge* edge = edges.rbegin()->second;
+      dedge* edge = find_edge(std::get<1>(heap.top()),std::get<2>(heap.top()));
+      heap.pop();
+      if(!edge) continue;
+      if(++iter>maxiter) break;
+
+      created.clear();
       nsplit += split_edge(edge);
+      for(auto triangle : created) {
+         for(size_t i=0; i<3; i++) push_candidate(triangle->coedge(i)->edge());
+      }
    }
+   m_created = 0;
 
    return nsplit;
 }
@@ -690,8 +1028,7 @@ void dmesh::debug_mesh_report(std::ostream& out) const
    out << endl;
    map<const dedge*,string> edge_names;
    size_t iedge=0;
-   for(auto& e : m_edge) {
-      const dedge* edge = e.second;
+   for(auto edge : m_edge) {
       string edge_name = 'e'+std::to_string(iedge++);
       edge_names[edge] = edge_name;
       out << "Edge: "
@@ -706,7 +1043,7 @@ void dmesh::debug_mesh_report(std::ostream& out) const
    size_t itri=0;
    dpos2d p11(100.0/3,100);
    for(auto& t : m_tri) {
-      const dcircle& c = t->circle();
+      dcircle c = t->circle();
       const dpos2d& p  = c.center();
       out << "Triangle: "
           << setw(5)  << 't'+std::to_string(itri++)
@@ -728,7 +1065,7 @@ void dmesh::debug_mesh_report(std::ostream& out) const
           << "   :r "
           << setw(20)  << setprecision(16) << c.radius()
           << setw(20)  << setprecision(16) << p.dist(p11)
-          << setw(5)  << ( (t->in_circumcircle(p11,m_epspnt)) ? " T " : " " )
+          << setw(5)  << ( (t->in_circumcircle(p11)) ? " T " : " " )
           << endl;
    }
 
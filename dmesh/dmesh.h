@@ -21,12 +21,13 @@
 
 #include <cstddef>
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
 
 #include "dentity.h"
 #include "dpos2d.h"
 #include "dprofile.h"
+#include "dpool.h"
+#include "dcircle_table.h"
 
 class dvertex;
 class dedge;
@@ -46,9 +47,10 @@ public:
    friend class dtriangle;
    friend class dprofile;
    friend class dloop;
+   friend class dcoedge;
 
    typedef std::unordered_set<dtriangle*>::iterator    triangle_iterator;
-   typedef std::unordered_map<size_t,dedge*>::iterator edge_iterator;
+   typedef std::vector<dedge*>::iterator               edge_iterator;
 
    dmesh(double epspnt = 1.0E-8);
    virtual ~dmesh();
@@ -86,10 +88,11 @@ public:
    // split edges longer than given length, returns number of edges split
    size_t split_long_edges(double length);
 
-   // export the mesh dprofile to .p2d format (2d profile text format)
-   void export_p2d(std::ostream& out) const;
+   // export the mesh dprofile to .p2d format (2d profile text format), or the binary variant.
+   // Binary streams must be opened in binary mode
+   void export_p2d(std::ostream& out, bool binary = false) const;
 
-   // import to mesh dprofile from .p2d format (2d profile text format).
+   // import to mesh dprofile from .p2d format (2d profile text format) or the binary variant, detected automatically.
    // This implies repeated calls to add_loop(...). Recommend to start from clean/empty mesh
    void import_p2d(std::istream& in, bool move_to_1st_quadrant);
 
@@ -125,6 +128,9 @@ public:
 protected:
    size_t         add_vertex(const dpos2d& pos);
    dedge*         get_create_edge(size_t iv1, size_t iv2);
+
+   // return existing edge between the vertices, or NULL if none
+   dedge*         find_edge(size_t iv1, size_t iv2);
    dtriangle*     add_triangle(size_t iv1, size_t iv2, size_t iv3);
    dtriangle*     add_triangle(size_t iv1, dedge* edge);
 
@@ -137,17 +143,41 @@ protected:
    // remove the specified edge. Throws if edge is in use
    void           remove_edge(dedge* edge);
 
+   // unlink the edge from the adjacency and destroy it
+   void           destroy_edge(dedge* edge);
+
+   // create and destroy coedges, owned by triangles or loops in this mesh
+   dcoedge*       create_coedge(dentity* parent, dedge* edge, bool fwd);
+   void           destroy_coedge(dcoedge* coedge);
+
+   // destroy all topology without any checking, used by destructor
+   void           destroy_all();
+
    // remove all unused edges
    void           remove_unused_edges();
 
    // compute the orientation of triangle (iv1,iv2,iv3)
    double         cross(size_t iv1, size_t iv2, size_t iv3);
 
-   // triangulate based on existing vertices
-   bool           triangulate_vertices();
+   // triangulate based on existing vertices, optionally recovering missing loop edges
+   bool           triangulate_vertices(bool recover_loops = false);
+
+   // return the user vertex indices (supervertices excluded) in the order they shall be inserted.
+   // This is a biased randomized insertion order (BRIO): the vertices are randomly assigned to
+   // rounds of doubling size, the vertices in each round are sorted along a Hilbert curve.
+   // It keeps point location walks short while avoiding worst cases of a purely spatial order
+   std::vector<size_t> insertion_order() const;
 
-   // add point based on Bowyer Watson method, using a pre-created vertex
-   void           bowyer_watson(size_t iv);
+   // add point based on Bowyer Watson method, using a pre-created vertex.
+   // hint is an optional triangle near the vertex, where the point location walk starts
+   void           bowyer_watson(size_t iv, dtriangle* hint = 0);
+
+   // walk from the start triangle towards pos, return the triangle containing pos.
+   // Returns NULL if pos is outside the mesh or the walk fails
+   dtriangle*     locate_triangle(const dpos2d& pos, dtriangle* start);
+
+   // return the triangle on the other side of the coedge, or NULL if none
+   dtriangle*     neighbour(dtriangle* triangle, dcoedge* coedge);
 
    // remove nonmaterial triangles next to loops.
    // This can be inside holes our outside outer loops.
@@ -159,9 +189,16 @@ protected:
    // remove triangles overlapping loops
    void           remove_overlapping_triangles();
 
-   // enforce free loop edges by splitting them, return number of splits. Zero return means all recovered
+   // enforce free loop edges by flipping or splitting them, return number of splits.
+   // Only the missing loop edges are visited, all are recovered on return
    size_t         recover_loop_edges_split();
 
+   // recover the missing edge by flipping the single triangle edge crossing it, if possible
+   bool           flip_to_edge(dedge* edge);
+
+   // flip the candidate edges (vertex pairs) until all satisfy the Delaunay criterion
+   void           legalize_edges(std::vector<std::pair<size_t,size_t>>& candidates);
+
    // split the given edge and replace the neighbour elements
    size_t         split_edge(dedge* edge);
 
@@ -169,10 +206,21 @@ protected:
    void debug_stl(std::ostream& out) const;
 
 private:
-   double                            m_epspnt;   // tolerance for circumcircles
+   // all topology is allocated from these pools, declared first so they are destroyed last
+   dpool<dvertex>                    m_vert_pool;
+   dpool<dedge>                      m_edge_pool;
+   dpool<dcoedge>                    m_coedge_pool;
+   dpool<dtriangle>                  m_tri_pool;
+
+   double                            m_epspnt;   // point tolerance, circumcircle tests use the exact predicates in dpredicates
    std::vector<dvertex*>             m_vert;     // user defined vertices
-   std::unordered_map<size_t,dedge*> m_edge;     // map of edges key(v1,v2), allowing lookup of edge based on vertices
+   std::vector<dedge*>               m_edge;     // all edges, dedge::m_index is the position in this vector
+   std::vector<std::vector<dedge*>>  m_vert_edges; // edges per vertex, listed under the lowest vertex index of the edge
    std::unordered_set<dtriangle*>    m_tri;      // generated triangles
+   dcircle_table                     m_circles;  // circumcircles of m_tri, indexed by dtriangle::m_handle
+   dtriangle*                        m_last;     // most recently created triangle, start of point location walks
+   size_t                            m_serial;   // number of triangles created, see dtriangle::m_serial
+   std::vector<dtriangle*>*          m_created;  // when set, add_triangle records the new triangles here
 
    dprofile                     m_profile;  // the mesh profile (optional)
 };
@@ -0,0 +1,104 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef DPOOL_H
+#define DPOOL_H
+
+#include <cstddef>
+#include <vector>
+#include <new>
+
+// Memory
+// ======
+// dpool is a free-list allocator for topology objects of type T.
+// Memory is obtained in blocks holding many objects, released objects are
+// recycled through a free list. All memory is released when the pool is destroyed,
+// so the pool must outlive every object allocated from it.
+// dpool only manages memory, objects are constructed with placement new and
+// destroyed by explicit destructor calls.
+
+template <typename T>
+class dpool {
+public:
+   dpool(size_t block_size = 1024);
+   virtual ~dpool();
+
+   // return memory for one object of type T
+   void* allocate();
+
+   // return memory of a destroyed object to the pool
+   void  release(void* p);
+
+private:
+   dpool(const dpool&) = delete;
+   dpool& operator=(const dpool&) = delete;
+
+   struct free_slot { free_slot* next; };
+
+   // size of each slot, large enough for T and the free list link, and properly aligned
+   static size_t slot_size()
+   {
+      const size_t align = alignof(std::max_align_t);
+      size_t size = (sizeof(T) > sizeof(free_slot))? sizeof(T) : sizeof(free_slot);
+      return ((size + align - 1)/align)*align;
+   }
+
+   size_t             m_block_size;  // number of slots per block
+   std::vector<char*> m_blocks;
+   size_t             m_next;        // next unused slot in last block
+   free_slot*         m_free;        // list of released slots
+};
+
+template <typename T>
+dpool<T>::dpool(size_t block_size)
+: m_block_size(block_size)
+, m_next(block_size)
+, m_free(0)
+{}
+
+template <typename T>
+dpool<T>::~dpool()
+{
+   for(auto block : m_blocks) {
+      ::operator delete(block);
+   }
+}
+
+template <typename T>
+void* dpool<T>::allocate()
+{
+   if(m_free) {
+      free_slot* slot = m_free;
+      m_free = slot->next;
+      return slot;
+   }
+   if(m_next == m_block_size) {
+      m_blocks.push_back(static_cast<char*>(::operator new(m_block_size*slot_size())));
+      m_next = 0;
+   }
+   return m_blocks.back() + slot_size()*(m_next++);
+}
+
+template <typename T>
+void dpool<T>::release(void* p)
+{
+   if(p) {
+      free_slot* slot = static_cast<free_slot*>(p);
+      slot->next = m_free;
+      m_free = slot;
+   }
+}
+
+#endif // DPOOL_H
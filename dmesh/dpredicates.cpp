@@ -0,0 +1,204 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "dpredicates.h"
+#include <cmath>
+#include <vector>
+
+// Expansion arithmetic: a value is represented as a sum of non-overlapping doubles
+// stored in increasing order of magnitude, so the sign is the sign of the last component
+
+typedef std::vector<double> expansion;
+
+static const double epsilon       = 1.1102230246251565e-16;  // 2^-53
+static const double ccwerrboundA  = (3.0 + 16.0*epsilon)*epsilon;
+static const double iccerrboundA  = (10.0 + 96.0*epsilon)*epsilon;
+
+static inline void two_sum(double a, double b, double& x, double& y)
+{
+   x = a + b;
+   double bvirt = x - a;
+   double avirt = x - bvirt;
+   y = (a - avirt) + (b - bvirt);
+}
+
+static inline void two_product(double a, double b, double& x, double& y)
+{
+   x = a * b;
+   y = std::fma(a,b,-x);
+}
+
+// exact difference a-b as an expansion
+static expansion two_diff(double a, double b)
+{
+   double x,y;
+   two_sum(a,-b,x,y);
+   expansion e;
+   if(y != 0.0) e.push_back(y);
+   if(x != 0.0) e.push_back(x);
+   return e;
+}
+
+// e + b, with zero components eliminated
+static expansion grow_expansion(const expansion& e, double b)
+{
+   expansion h;
+   h.reserve(e.size()+1);
+   double q = b;
+   for(double ei : e) {
+      double x,y;
+      two_sum(q,ei,x,y);
+      if(y != 0.0) h.push_back(y);
+      q = x;
+   }
+   if(q != 0.0) h.push_back(q);
+   return h;
+}
+
+static expansion expansion_sum(const expansion& e, const expansion& f)
+{
+   expansion h = e;
+   for(double fi : f) h = grow_expansion(h,fi);
+   return h;
+}
+
+static expansion scale_expansion(const expansion& e, double b)
+{
+   expansion h;
+   for(double ei : e) {
+      double x,y;
+      two_product(ei,b,x,y);
+      h = grow_expansion(h,y);
+      h = grow_expansion(h,x);
+   }
+   return h;
+}
+
+static expansion product(const expansion& e, const expansion& f)
+{
+   expansion h;
+   for(double fi : f) h = expansion_sum(h,scale_expansion(e,fi));
+   return h;
+}
+
+static expansion negate(expansion e)
+{
+   for(double& ei : e) ei = -ei;
+   return e;
+}
+
+static double estimate(const expansion& e)
+{
+   double sum = 0.0;
+   for(double ei : e) sum += ei;
+   return sum;
+}
+
+double dpredicates::orient2d(const dpos2d& a, const dpos2d& b, const dpos2d& c)
+{
+   double detleft  = (a.x() - c.x()) * (b.y() - c.y());
+   double detright = (a.y() - c.y()) * (b.x() - c.x());
+   double det      = detleft - detright;
+
+   double detsum   = std::fabs(detleft) + std::fabs(detright);
+   if(std::fabs(det) > ccwerrboundA*detsum) return det;
+
+   return orient2d_exact(a.x(),a.y(),b.x(),b.y(),c.x(),c.y());
+}
+
+double dpredicates::orient2d_exact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+   expansion acx = two_diff(ax,cx);
+   expansion acy = two_diff(ay,cy);
+   expansion bcx = two_diff(bx,cx);
+   expansion bcy = two_diff(by,cy);
+   return estimate(expansion_sum(product(acx,bcy),negate(product(acy,bcx))));
+}
+
+// floating point incircle determinant and its error bound, written without
+// branches so it can be evaluated for many triangles in one vectorized loop
+static inline double incircle_filter(double ax, double ay, double bx, double by, double cx, double cy,
+                                     double dx, double dy, double& errbound)
+{
+   double adx = ax - dx, ady = ay - dy;
+   double bdx = bx - dx, bdy = by - dy;
+   double cdx = cx - dx, cdy = cy - dy;
+
+   double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+   double cdxady = cdx * ady, adxcdy = adx * cdy;
+   double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+   double alift = adx * adx + ady * ady;
+   double blift = bdx * bdx + bdy * bdy;
+   double clift = cdx * cdx + cdy * cdy;
+
+   double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift
+                    + (std::fabs(cdxady) + std::fabs(adxcdy)) * blift
+                    + (std::fabs(adxbdy) + std::fabs(bdxady)) * clift;
+   errbound = iccerrboundA * permanent;
+
+   return alift * (bdxcdy - cdxbdy)
+        + blift * (cdxady - adxcdy)
+        + clift * (adxbdy - bdxady);
+}
+
+double dpredicates::incircle(const dpos2d& a, const dpos2d& b, const dpos2d& c, const dpos2d& d)
+{
+   double errbound = 0.0;
+   double det = incircle_filter(a.x(),a.y(),b.x(),b.y(),c.x(),c.y(),d.x(),d.y(),errbound);
+   if(std::fabs(det) > errbound) return det;
+
+   return incircle_exact(a.x(),a.y(),b.x(),b.y(),c.x(),c.y(),d.x(),d.y());
+}
+
+void dpredicates::incircle(const double* tri, size_t n, const dpos2d& d, unsigned char* inside)
+{
+   const double dx = d.x();
+   const double dy = d.y();
+
+   // filtered pass: 1 = inside, 0 = outside, 2 = ambiguous
+   for(size_t i=0; i<n; i++) {
+      const double* t = tri + 6*i;
+      double errbound = 0.0;
+      double det = incircle_filter(t[0],t[1],t[2],t[3],t[4],t[5],dx,dy,errbound);
+      inside[i] = (det > errbound) ? 1 : ((-det > errbound) ? 0 : 2);
+   }
+
+   // exact pass for the few that could not be decided
+   for(size_t i=0; i<n; i++) {
+      if(inside[i] == 2) {
+         const double* t = tri + 6*i;
+         inside[i] = (incircle_exact(t[0],t[1],t[2],t[3],t[4],t[5],dx,dy) > 0.0) ? 1 : 0;
+      }
+   }
+}
+
+double dpredicates::incircle_exact(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
+{
+   expansion adx = two_diff(ax,dx), ady = two_diff(ay,dy);
+   expansion bdx = two_diff(bx,dx), bdy = two_diff(by,dy);
+   expansion cdx = two_diff(cx,dx), cdy = two_diff(cy,dy);
+
+   expansion alift = expansion_sum(product(adx,adx),product(ady,ady));
+   expansion blift = expansion_sum(product(bdx,bdx),product(bdy,bdy));
+   expansion clift = expansion_sum(product(cdx,cdx),product(cdy,cdy));
+
+   expansion bc = expansion_sum(product(bdx,cdy),negate(product(cdx,bdy)));
+   expansion ca = expansion_sum(product(cdx,ady),negate(product(adx,cdy)));
+   expansion ab = expansion_sum(product(adx,bdy),negate(product(bdx,ady)));
+
+   expansion det = expansion_sum(expansion_sum(product(alift,bc),product(blift,ca)),product(clift,ab));
+   return estimate(det);
+}
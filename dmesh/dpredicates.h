@@ -0,0 +1,47 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef DPREDICATES_H
+#define DPREDICATES_H
+
+#include <cstddef>
+#include "dpos2d.h"
+
+// Robust geometric predicates after Shewchuk, "Adaptive Precision Floating-Point
+// Arithmetic and Fast Robust Geometric Predicates". Each predicate is first
+// evaluated in plain floating point, and the sign is accepted when the result
+// exceeds a static error bound. Only the rare ambiguous cases are recomputed
+// with exact expansion arithmetic, so the returned sign is always correct.
+
+class dpredicates {
+public:
+   // > 0 if a,b,c are in CCW order, < 0 if CW, 0 if collinear.
+   // The magnitude is approximately twice the signed area of the triangle
+   static double orient2d(const dpos2d& a, const dpos2d& b, const dpos2d& c);
+
+   // > 0 if d is inside the circle through the CCW points a,b,c, < 0 if outside, 0 if cocircular
+   static double incircle(const dpos2d& a, const dpos2d& b, const dpos2d& c, const dpos2d& d);
+
+   // incircle test of d against n triangles stored as 6 coordinates each (ax,ay,bx,by,cx,cy).
+   // inside[i] is set to 1 when d is strictly inside circle i. The filtered pass is a
+   // branch free loop the compiler can vectorize, only ambiguous triangles use the exact path
+   static void incircle(const double* tri, size_t n, const dpos2d& d, unsigned char* inside);
+
+private:
+   static double orient2d_exact(double ax, double ay, double bx, double by, double cx, double cy);
+   static double incircle_exact(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy);
+};
+
+#endif // DPREDICATES_H
@@ -21,6 +21,8 @@
 #include <map>
 #include <sstream>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 using namespace std;
 
 #include "dmesh.h"
@@ -29,6 +31,9 @@ using namespace std;
 #include "dvertex.h"
 #include "dbox2d.h"
 
+// signature of binary .p2d files. The first byte is not printable, so it never starts a text file
+static const char p2d_binary_magic[8] = { '\x89', 'p', '2', 'd', 'b', '\r', '\n', '\0' };
+
 // key = vertex id, value = set of edges referring to the vertex
 typedef unordered_map<size_t,unordered_set<dedge*>>  vertex_edge_map;
 
@@ -88,7 +93,7 @@ void dprofile::compute(dmesh* mesh)
    // This happens when 2 loops share only a single vertex, but no shared edges
    // in theory we could resolve this by starting from the problematic vertex, but if there are multiple cases we still end up in trouble
    for(auto iedge=mesh->edge_begin(); iedge!=mesh->edge_end(); iedge++) {
-      dedge* edge = iedge->second;
+      dedge* edge = *iedge;
       if(edge->use_count() == 1) {
          edge_set.insert(edge);
          ve_map[edge->vertex1()].insert(edge);
@@ -189,14 +194,14 @@ void dprofile::add_loop(const vector<dpos2d>& points)
       size_t iv1 = vind[i-1];
       size_t iv2 = vind[i];
       dedge* edge = get_mesh()->get_create_edge(iv1,iv2);
-      loop->push_back(new dcoedge(loop,edge,true));
+      loop->push_back(get_mesh()->create_coedge(loop,edge,true));
    }
 
    // close the loop, this coedge is reversed since it goes from last to first vertex
    size_t iv1 = vind[vind.size()-1];
    size_t iv2 = vind[0];
    dedge* edge = get_mesh()->get_create_edge(iv1,iv2);
-   loop->push_back(new dcoedge(loop,edge,false));
+   loop->push_back(get_mesh()->create_coedge(loop,edge,false));
 }
 
 void dprofile::sort_loops()
@@ -250,10 +255,107 @@ void  dprofile::export_p2d(ostream& out) const
 }
 
 
+void  dprofile::export_p2d_binary(ostream& out) const
+{
+   /*
+
+      2d profile binary file format *.p2d
+      ===================================
+      All fields are 8 bytes in host byte order, so the file can be used memory mapped
+
+      char[8]  signature    '\x89' 'p' '2' 'd' 'b' '\r' '\n' '\0'
+      uint64   nc           number of contour paths
+      double   xlow ylow xhigh yhigh   bounding box of profile
+      uint64   offset[nc+1] point offset of each path, offset[nc] is the total number of points
+      double   xy[2*offset[nc]]        packed x y coordinates of all paths
+
+   */
+
+   dbox2d box = bounding_box();
+   const dpos2d& plo = box.p1();
+   const dpos2d& phi = box.p2();
+
+   uint64_t nc     = m_loops.size();
+   double   bbox[] = { plo.x(), plo.y(), phi.x(), phi.y() };
+
+   vector<uint64_t> offset;
+   offset.reserve(nc+1);
+   offset.push_back(0);
+   for(auto loop : m_loops) {
+      offset.push_back(offset.back()+loop->size());
+   }
+
+   vector<double> xy;
+   xy.reserve(2*offset.back());
+   for(auto loop : m_loops) {
+      vector<dpos2d> points = loop->get_pos(true);
+      for(auto& p : points) {
+         xy.push_back(p.x());
+         xy.push_back(p.y());
+      }
+   }
+
+   out.write(p2d_binary_magic,sizeof(p2d_binary_magic));
+   out.write(reinterpret_cast<const char*>(&nc),sizeof(nc));
+   out.write(reinterpret_cast<const char*>(bbox),sizeof(bbox));
+   out.write(reinterpret_cast<const char*>(&offset[0]),offset.size()*sizeof(uint64_t));
+   if(xy.size() > 0) out.write(reinterpret_cast<const char*>(&xy[0]),xy.size()*sizeof(double));
+}
+
+void dprofile::import_p2d_binary(istream& in, bool move_to_1st_quadrant)
+{
+   char magic[sizeof(p2d_binary_magic)];
+   uint64_t nc = 0;
+   double bbox[4];
+   if(!in.read(magic,sizeof(magic)) || memcmp(magic,p2d_binary_magic,sizeof(magic)) != 0) {
+      throw std::logic_error("dmesh::import_p2d(), invalid binary p2d signature");
+   }
+   if(!in.read(reinterpret_cast<char*>(&nc),sizeof(nc)) || !in.read(reinterpret_cast<char*>(bbox),sizeof(bbox))) {
+      throw std::logic_error("dmesh::import_p2d(), error reading binary p2d header");
+   }
+
+   vector<uint64_t> offset(nc+1);
+   if(!in.read(reinterpret_cast<char*>(&offset[0]),offset.size()*sizeof(uint64_t))) {
+      throw std::logic_error("dmesh::import_p2d(), error reading binary p2d path offsets");
+   }
+   for(size_t ic=0; ic<nc; ic++) {
+      if(offset[ic+1] < offset[ic]) throw std::logic_error("dmesh::import_p2d(), invalid binary p2d path offsets");
+   }
+
+   // all coordinates are read at once
+   size_t npos = offset[nc];
+   vector<double> xy(2*npos);
+   if(npos > 0 && !in.read(reinterpret_cast<char*>(&xy[0]),xy.size()*sizeof(double))) {
+      throw std::logic_error("dmesh::import_p2d(), error reading binary p2d coordinates");
+   }
+
+   // reserve the vertices for all loops at once
+   size_t nv = get_mesh()->vertex_size();
+   get_mesh()->reserve_vertices(((nv>3)? nv-3 : 0) + npos);
+
+   double dx = (move_to_1st_quadrant)? -bbox[0] : 0.0;
+   double dy = (move_to_1st_quadrant)? -bbox[1] : 0.0;
+   vector<dpos2d> points;
+   for(size_t ic=0; ic<nc; ic++) {
+      points.clear();
+      points.reserve(offset[ic+1]-offset[ic]);
+      for(size_t ip=offset[ic]; ip<offset[ic+1]; ip++) {
+         points.push_back(dpos2d(xy[2*ip]+dx,xy[2*ip+1]+dy));
+      }
+      add_loop(points);
+   }
+}
+
 void dprofile::import_p2d(istream& in, bool move_to_1st_quadrant)
 {
+   // binary files are recognised from the signature
+   if(in.peek() == static_cast<unsigned char>(p2d_binary_magic[0])) {
+      import_p2d_binary(in,move_to_1st_quadrant);
+      return;
+   }
+
    string line,entity;
-   if(!std::getline(in,line)) std::logic_error("dmesh::import_p2d(), error reading p2d header line ");
+   if(!std::getline(in,line)) throw std::logic_error("dmesh::import_p2d(), error reading p2d header line ");
 
    istringstream in0(line);
    size_t nc = 0;
@@ -264,14 +366,14 @@ void dprofile::import_p2d(istream& in, bool move_to_1st_quadrant)
          size_t np=0;
          double area = 0.0;
 
-         if(!std::getline(in,line)) std::logic_error("dmesh::import_p2d(), error reading p2d_path header line ");
+         if(!std::getline(in,line)) throw std::logic_error("dmesh::import_p2d(), error reading p2d_path header line ");
          istringstream in1(line);
          in1 >> entity >> np >> area;
          if(entity == "p2d_path") {
             vector<dpos2d> points;
             points.reserve(np);
             for(size_t ip=0; ip<np; ip++) {
-               if(!std::getline(in,line)) std::logic_error("dmesh::import_p2d(), error reading x,y line ");
+               if(!std::getline(in,line)) throw std::logic_error("dmesh::import_p2d(), error reading x,y line ");
                double x,y;
                istringstream inxy(line);
                inxy >> x >> y;
@@ -283,7 +385,7 @@ void dprofile::import_p2d(istream& in, bool move_to_1st_quadrant)
             }
             add_loop(points);
          }
-         else std::logic_error("dmesh::import_p2d(), expected 'p2d_path' but got " + entity);
+         else throw std::logic_error("dmesh::import_p2d(), expected 'p2d_path' but got " + entity);
       }
 
       return;
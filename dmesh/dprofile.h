@@ -54,7 +54,10 @@ public:
    // export the profile in .p2d format.
    void export_p2d(std::ostream& out) const;
 
-   // import the profile from .p2d format
+   // export the profile in binary .p2d format, see export_p2d_binary implementation
+   void export_p2d_binary(std::ostream& out) const;
+
+   // import the profile from .p2d format, text or binary
    void import_p2d(std::istream& in, bool move_to_1st_quadrant);
 
    // return the profile bounding box
@@ -67,6 +70,9 @@ protected:
    // add a loop to the profile
    void add_loop(const std::vector<dpos2d>& points);
 
+   // import the profile from binary .p2d format
+   void import_p2d_binary(std::istream& in, bool move_to_1st_quadrant);
+
    // compute profile from mesh containing triangles
    // NOTE: this may throw std::exception if the model is ambigous, call in try/catch clause
    void compute(dmesh* mesh);
@@ -22,25 +22,26 @@
 #include "dloop.h"
 #include "dvec2d.h"
 #include "dline2d.h"
+#include "dpredicates.h"
 
 #include <unordered_set>
 
 dtriangle::dtriangle(dmesh* mesh,size_t iv1,size_t iv2,size_t iv3)
 : dentity(mesh)
-, m_circle(dpos2d(),-1.0)
+, m_handle(0)
+, m_serial(0)
 {
    // create_coedge will generate the underlying dedge as required
 
-   m_coedges.reserve(3);
-   m_coedges.push_back(create_coedge(iv1,iv2));
-   m_coedges.push_back(create_coedge(iv2,iv3));
-   m_coedges.push_back(create_coedge(iv3,iv1));
+   m_coedges[0] = create_coedge(iv1,iv2);
+   m_coedges[1] = create_coedge(iv2,iv3);
+   m_coedges[2] = create_coedge(iv3,iv1);
 
    const dpos2d& p1 = mesh->get_vertex(m_coedges[0]->vertex1())->pos();
    const dpos2d& p2 = mesh->get_vertex(m_coedges[1]->vertex1())->pos();
    const dpos2d& p3 = mesh->get_vertex(m_coedges[2]->vertex1())->pos();
 
-   m_circle = dcircle(p1,p2,p3);
+   m_handle = mesh->m_circles.create(this,p1,p2,p3);
 }
 
 void dtriangle::super()
@@ -52,12 +53,27 @@ void dtriangle::super()
 
 dtriangle::~dtriangle()
 {
+   get_mesh()->m_circles.release(m_handle);
    clear();
 }
 
-bool dtriangle::in_circumcircle(const dpos2d& pos, double epspnt)
+dcircle dtriangle::circle() const
 {
-   return m_circle.pos_inside(pos,epspnt);
+   const dcircle_table& circles = get_mesh()->m_circles;
+   return dcircle(circles.center(m_handle),circles.radius(m_handle));
+}
+
+bool dtriangle::in_circumcircle(const dpos2d& pos) const
+{
+   // the cached circle decides most cases, the exact predicate the rest
+   const dmesh* mesh = get_mesh();
+   int screen = mesh->m_circles.screen(m_handle,pos);
+   if(screen != 0) return (screen > 0);
+
+   const dpos2d& p1 = mesh->get_vertex(m_coedges[0]->vertex1())->pos();
+   const dpos2d& p2 = mesh->get_vertex(m_coedges[1]->vertex1())->pos();
+   const dpos2d& p3 = mesh->get_vertex(m_coedges[2]->vertex1())->pos();
+   return dpredicates::incircle(p1,p2,p3,pos) > 0.0;
 }
 
 dcoedge* dtriangle::create_coedge(size_t iv1, size_t iv2)
@@ -65,16 +81,16 @@ dcoedge* dtriangle::create_coedge(size_t iv1, size_t iv2)
    // get the underlying edge
    dedge* edge = get_mesh()->get_create_edge(iv1,iv2);
    bool fwd = (iv1 == edge->vertex1());
-   return new dcoedge(this,edge,fwd);
+   return get_mesh()->create_coedge(this,edge,fwd);
 }
 
 void dtriangle::clear()
 {
    // the coedges are owned here
-   for(auto coedge : m_coedges) {
-      delete coedge;
+   for(auto& coedge : m_coedges) {
+      get_mesh()->destroy_coedge(coedge);
+      coedge = 0;
    }
-   m_coedges.clear();
 }
 
 
@@ -124,7 +140,7 @@ double dtriangle::signed_area() const
    */
 
    double sum = 0.0;
-   size_t ivcur = (*m_coedges.begin())->vertex1();
+   size_t ivcur = m_coedges[0]->vertex1();
    const dmesh* mesh = get_mesh();
    dpos2d p1 = mesh->get_vertex(ivcur)->pos();
    for(auto coedge : m_coedges) {
@@ -179,11 +195,13 @@ bool dtriangle::in_triangle(const dpos2d& pos)
    dvec2d v2p(p2,pos);
    dvec2d v3p(p3,pos);
 
-   double dot1 = v1.dot(v1p);
-   double dot2 = v2.dot(v2p);
-   double dot3 = v3.dot(v3p);
+   // the method tests the side of each edge, i.e. the dot product with the edge normal.
+   // The triangle is CCW, so pos is inside when it is on the left of all edges
+   double side1 = v1.cross(v1p);
+   double side2 = v2.cross(v2p);
+   double side3 = v3.cross(v3p);
 
-   return ((dot1>=0.0) && (dot2>=0) && (dot3>=0));
+   return ((side1>=0.0) && (side2>=0) && (side3>=0));
 }
 
 double dtriangle::aspect_ratio() const
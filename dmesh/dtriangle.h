@@ -28,7 +28,7 @@ class dedge;
 // Topology
 // ========
 // A dtriangle is a mesh triangle with its 3 sides defined by coedges
-// it also contains a circle defined by the 3 triangle vertices.
+// its circumcircle is stored in the mesh dcircle_table, referred to by a handle.
 // Triangles shall be defined with CCW vertex order, giving positive signed area.
 
 class dtriangle : public dentity {
@@ -47,14 +47,15 @@ public:
    size_t vertex2() const { return m_coedges[1]->vertex1(); }
    size_t vertex3() const { return m_coedges[2]->vertex1(); }
 
-   // return true if 'pos' is inside the triangle circumcircle
-   bool in_circumcircle(const dpos2d& pos, double epspnt);
+   // return true if 'pos' is strictly inside the triangle circumcircle.
+   // Screened by the cached circle, undecided cases use the exact incircle predicate
+   bool in_circumcircle(const dpos2d& pos) const;
 
    // return true if 'pos' is inside the triangle (more expensive than in_circumcircle(...))
    bool in_triangle(const dpos2d& pos);
 
    // return circumcircle
-   const dcircle& circle() const { return m_circle; }
+   dcircle circle() const;
 
    // return the centroid of the triangle
    dpos2d centroid() const;
@@ -90,8 +91,9 @@ protected:
    void clear();
 
 private:
-   std::vector<dcoedge*> m_coedges;  // the 3 edges of the triangle
-   dcircle          m_circle;   // the circumcircle of the triangle
+   dcoedge*         m_coedges[3];  // the 3 edges of the triangle
+   size_t           m_handle;      // circumcircle record in the mesh dcircle_table
+   size_t           m_serial;      // creation number in the mesh, distinguishes recycled triangle memory
 };
 
 #endif // DTRIANGLE_H
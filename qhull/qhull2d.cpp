@@ -15,8 +15,11 @@
 
 #include "qhull2d.h"
 #include "qvec3d.h"
+#include "qhull_stats.h"
 #include <iostream>
+#include <chrono>
 #include <set>
+#include <algorithm>
 using namespace std;
 
 // ref http://stackoverflow.com/questions/19530731/qhull-library-c-interface
@@ -34,6 +37,9 @@ using namespace std;
 //#include "libqhullcpp/QhullSet.h"
 #include "libqhullcpp/QhullVertexSet.h"
 
+// inputs with fewer points than this are computed without qhull
+static const size_t monotone_chain_limit = 10000;
+
 qhull2d::qhull2d()
 {}
 
@@ -80,6 +86,26 @@ static orgQhull::QhullVertex next_contour_vertex(orgQhull::QhullVertex& vtx, con
 }
 
 bool qhull2d::compute()
+{
+   std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+   size_t npoints   = m_in_vert.size()/2;
+   size_t processed = 0;
+   size_t merges    = 0;
+
+   // small hulls avoid the qhull setup cost
+   m_contour.clear();
+   bool success = (npoints < monotone_chain_limit)? compute_monotone_chain() : compute_qhull(processed,merges);
+
+   // a 2d hull has as many edges as vertices
+   qhull_stats& stats = qhull_stats::singleton();
+   if(stats.enabled()) {
+      double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - t0).count();
+      stats.add(2,npoints,processed,m_contour.size(),m_contour.size(),merges,ms);
+   }
+   return success;
+}
+
+bool qhull2d::compute_qhull(size_t& processed, size_t& merges)
 {
    // this is the 2d version
    const int pointDimension = 2;
@@ -89,6 +115,11 @@ bool qhull2d::compute()
    orgQhull::Qhull qhull;
    qhull.runQhull("qhull2d",pointDimension, pointCount,&m_in_vert[0],"Qt");
 
+   // statistics of this qhull instance
+   qhT* qh   = qhull.qh();
+   processed = zzval_(Zprocessed);
+   merges    = zzval_(Ztotmerge);
+
    // the result will be somewhat chaotic, the following must be fixed in a few post-processing steps
    // - The "facets" returned are actually edges between hull contour vertices
    // - we need to look at neighbour facets at each vertex and then pick the next one we have not already seen
@@ -125,6 +156,41 @@ bool qhull2d::compute()
    return (m_contour.size() > 2);
 }
 
+// z component of (a-o)x(b-o), positive when o,a,b turn left
+static inline double cross(const qhull2d::xy& o, const qhull2d::xy& a, const qhull2d::xy& b)
+{
+   return (a.x-o.x)*(b.y-o.y) - (a.y-o.y)*(b.x-o.x);
+}
+
+bool qhull2d::compute_monotone_chain()
+{
+   size_t np = m_in_vert.size()/2;
+   std::vector<xy> pnt;
+   pnt.reserve(np);
+   for(size_t ip=0; ip<np; ip++) pnt.push_back(xy(m_in_vert[2*ip],m_in_vert[2*ip+1]));
+
+   // sort lexicographically on x, then y
+   std::sort(pnt.begin(),pnt.end(),[](const xy& a, const xy& b) { return (a.x < b.x) || (a.x == b.x && a.y < b.y); });
+
+   // lower hull left to right, then upper hull right to left.
+   // Only strict left turns are kept, so collinear points are left out as with qhull
+   std::vector<xy>& hull = m_contour;
+   hull.resize(2*np);
+   size_t k = 0;
+   for(size_t ip=0; ip<np; ip++) {
+      while(k >= 2 && cross(hull[k-2],hull[k-1],pnt[ip]) <= 0.0) k--;
+      hull[k++] = pnt[ip];
+   }
+   for(size_t ip=np-1, t=k+1; ip>0; ip--) {
+      while(k >= t && cross(hull[k-2],hull[k-1],pnt[ip-1]) <= 0.0) k--;
+      hull[k++] = pnt[ip-1];
+   }
+
+   // the last point is the same as the first
+   hull.resize((k>0)? k-1 : 0);
+   return (m_contour.size() > 2);
+}
+
 double qhull2d::signed_area() const
 {
    // this function computes the area of the polygon described by m_contour.
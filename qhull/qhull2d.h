@@ -16,6 +16,7 @@
 #ifndef QHULL2D_H
 #define QHULL2D_H
 
+#include <cstddef>
 #include <vector>
 #include <map>
 
@@ -47,7 +48,8 @@ public:
    // push an input vertex,
    void push_back(const xy& pnt);
 
-   // compute the convex hull, contour will be properly oriented CCW
+   // compute the convex hull, contour will be properly oriented CCW.
+   // The hull is added to qhull_stats when it is enabled
    bool compute();
 
    // contour vertex results below (defined after calling compute)
@@ -63,6 +65,12 @@ public:
 private:
    double signed_area() const;
 
+   // qhull, processed points and merged facets are returned from the libqhull statistics
+   bool compute_qhull(size_t& processed, size_t& merges);
+
+   // Andrew's monotone chain, used instead of qhull for small inputs
+   bool compute_monotone_chain();
+
 private:
    std::vector<double>  m_in_vert;   // input vertices as flat vector {x1,y1,z1,x2,y2,z2,....,xn,yn,zn}
    vertex_vector        m_contour;   // hull contour
@@ -15,22 +15,34 @@
 
 #include "qhull3d.h"
 #include "qvec3d.h"
+#include "quickhull3d.h"
+#include "qhull_stats.h"
 #include <iostream>
+#include <chrono>
 using namespace std;
 
-// ref http://stackoverflow.com/questions/19530731/qhull-library-c-interface
+#include <algorithm>
 
-//#include "libqhullcpp/RboxPoints.h"
-//#include "libqhullcpp/Coordinates.h"
-//#include "libqhullcpp/QhullError.h"
-#include "libqhullcpp/Qhull.h"
-//#include "libqhullcpp/QhullQh.h"
-#include "libqhullcpp/QhullFacet.h"
-#include "libqhullcpp/QhullFacetList.h"
-//#include "libqhullcpp/QhullLinkedList.h"
-#include "libqhullcpp/QhullVertex.h"
-//#include "libqhullcpp/QhullSet.h"
-#include "libqhullcpp/QhullVertexSet.h"
+extern "C" {
+   #include "libqhull_r/qhull_ra.h"
+}
+
+// qhull state reused by all hull computations on the same thread,
+// this avoids constructing and zeroing a new qhT for every hull
+class qhull3d_state {
+public:
+   qhull3d_state() { qh_zero(&m_qh,stderr); }
+   qhT* qh() { return &m_qh; }
+private:
+   qhT m_qh;
+};
+
+static thread_local qhull3d_state qhull_state;
+
+// quickhull work arrays reused by all hull computations on the same thread
+static thread_local quickhull3d quickhull_state;
+
+qhull3d::hull_engine qhull3d::m_engine = qhull3d::LIBQHULL;
 
 class bbox {
 public:
@@ -81,8 +93,9 @@ qhull3d::~qhull3d()
 void qhull3d::clear()
 {
    m_in_vert.clear();
-   m_faces.clear();
    m_vert.clear();
+   m_face_offset.clear();
+   m_face_vind.clear();
 }
 
 void qhull3d::reserve(size_t nvert)
@@ -99,6 +112,14 @@ void qhull3d::push_back(double x, double y, double z)
    m_in_vert.push_back(z);
 }
 
+double* qhull3d::extend(size_t nvert)
+{
+   size_t icoord = m_in_vert.size();
+   if(nvert == 0) return 0;
+   m_in_vert.resize(icoord+3*nvert);
+   return &m_in_vert[icoord];
+}
+
 size_t qhull3d::nvertices() const
 {
    return m_vert.size();
@@ -106,116 +127,149 @@ size_t qhull3d::nvertices() const
 
 size_t qhull3d::nfaces() const
 {
-   return m_faces.size();
+   return (m_face_offset.size()>0)? m_face_offset.size()-1 : 0;
 }
 
 bool qhull3d::compute()
 {
+   m_vert.clear();
+   m_face_offset.clear();
+   m_face_vind.clear();
+
    const int pointDimension = 3;
    int pointCount = static_cast<int>(m_in_vert.size()/pointDimension);
+   if(pointCount < pointDimension+1) return false;
 
-   // actually run the hull algorithm
-   orgQhull::Qhull qhull;
-   qhull.runQhull("qhull3d",pointDimension, pointCount,&m_in_vert[0],"Qt");
-
-   // the result will be somewhat chaotic, the following must be fixed in a few post-processing steps
-   // - vertex id's are not sequential anymore, some may be missing
-   // - some faces will have face normals pointing the wrong way, no consistency
-
-   // <id,iinode> : vmap = mapping from qhull vertex_id to iinode (zero based and sequential)
-   map<size_t,size_t> vmap;
-   size_t iinode = 0;
+   std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+   size_t processed = 0;
+   size_t merges    = 0;
+   bool success = (m_engine == QUICKHULL)? compute_quickhull() : compute_libqhull(processed,merges);
 
-   // compute mean hull coordinate, this will always be inside the convex hull
-   xyz pmean;
-   size_t nv = 0;
-
-   // First collect vertices
-   orgQhull::QhullVertexList  vertices = qhull.vertexList();
-   for (orgQhull::QhullVertexList::iterator it = vertices.begin(); it != vertices.end(); ++it)  {
-
-      // vertex and its coordinates
-      orgQhull::QhullVertex& v = *it;
-      orgQhull::QhullPoint p = v.point();
-      double* coords = p.coordinates();
+   qhull_stats& stats = qhull_stats::singleton();
+   if(stats.enabled()) {
+      double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - t0).count();
+      stats.add(pointDimension,pointCount,processed,nvertices(),nfaces(),merges,ms);
+   }
+   return success;
+}
 
-      // insert the new vertex with sequential number iinode, then keep mapping from id() to iinode
-      xyz pnt(coords[0],coords[1],coords[2]);
+bool qhull3d::compute_quickhull()
+{
+   size_t npoints = m_in_vert.size()/3;
+   if(!quickhull_state.compute(&m_in_vert[0],npoints)) return false;
+
+   // faces are triangles with outward normals already
+   const std::vector<size_t>& hull_vert = quickhull_state.vertices();
+   m_vert.reserve(hull_vert.size());
+   for(size_t iv=0; iv<hull_vert.size(); iv++) {
+      const double* p = &m_in_vert[3*hull_vert[iv]];
+      m_vert.push_back(xyz(p[0],p[1],p[2]));
+   }
 
-      // add oint to boundary box
-      pmean.add(pnt);
-      nv++;
+   m_face_vind = quickhull_state.triangles();
+   size_t nfaces = m_face_vind.size()/3;
+   m_face_offset.resize(nfaces+1);
+   for(size_t iface=0; iface<=nfaces; iface++) m_face_offset[iface] = 3*iface;
 
-      // insert in vertex map
-      m_vert.insert(std::make_pair(iinode, pnt ));
+   return true;
+}
 
-      // insert in id to iinode map
-      vmap[v.id()] = iinode++;
-   }
+bool qhull3d::compute_libqhull(size_t& processed, size_t& merges)
+{
+   const int pointDimension = 3;
+   int pointCount = static_cast<int>(m_in_vert.size()/pointDimension);
 
-   // the "hull_center" is a point guaranteed to be inside the convex hull body
-   pmean.scale(1.0/nv);
-   xyz hull_center = pmean;
+   // actually run the hull algorithm, using the qhull state of this thread
+   qhT* qh = qhull_state.qh();
+   char qhull_cmd[] = "qhull Qt";
+   int exitcode = qh_new_qhull(qh,pointDimension,pointCount,&m_in_vert[0],False,qhull_cmd,NULL,stderr);
 
-   int iface = 0;
-   orgQhull::QhullFacetList facets = qhull.facetList();
-   for (orgQhull::QhullFacetList::iterator it = facets.begin(); it != facets.end(); ++it)  {
+   if(!exitcode) {
 
-      // check to see if the face is usable
-      if(it->isGood()) {
+      // the result will be somewhat chaotic, the following must be fixed in a few post-processing steps
+      // - vertex id's are not sequential anymore, some may be missing
+      // - some faces will have face normals pointing the wrong way, no consistency
 
-         // get the face and it vertices
-         orgQhull::QhullFacet& f = *it;
-         orgQhull::QhullVertexSet vSet = f.vertices();
+      // vmap = mapping from qhull vertex_id to iinode (zero based and sequential)
+      std::vector<size_t> vmap(qh->vertex_id,0);
+      m_vert.reserve(qh->num_vertices);
 
-         // we want a continuous sequence of face id's as output, so just increment here
-         face_vertices& fv = m_faces[iface++];
+      // compute mean hull coordinate, this will always be inside the convex hull
+      xyz pmean;
 
-         // compute the face center
-         xyz face_cen;
-         for (orgQhull::QhullVertexSet::iterator vIt = vSet.begin(); vIt != vSet.end(); ++vIt)  {
+      // First collect vertices
+      vertexT* vertex = 0;
+      FORALLvertices {
 
-            orgQhull::QhullVertex v = *vIt;
-            size_t node_id = v.id();
-            size_t iinode  = vmap[node_id];
+         // insert the new vertex with sequential number iinode, then keep mapping from id to iinode
+         const double* coords = vertex->point;
+         xyz pnt(coords[0],coords[1],coords[2]);
+         pmean.add(pnt);
 
-            // Keep the converted reference for the face vertex in the face vertex vector
-            fv.push_back(iinode);
+         vmap[vertex->id] = m_vert.size();
+         m_vert.push_back(pnt);
+      }
 
-            // accumulate face vertex coordinates
-            xyz& fvc = m_vert[iinode];
-            face_cen.x += fvc.x;
-            face_cen.y += fvc.y;
-            face_cen.z += fvc.z;
+      // the "hull_center" is a point guaranteed to be inside the convex hull body
+      pmean.scale(1.0/m_vert.size());
+      xyz hull_center = pmean;
+
+      m_face_offset.reserve(qh->num_facets+1);
+      m_face_vind.reserve(3*qh->num_facets);
+      m_face_offset.push_back(0);
+
+      facetT* facet = 0;
+      FORALLfacets {
+
+         // check to see if the face is usable
+         if(facet->good) {
+
+            // compute the face center while storing the converted face vertex references
+            xyz face_cen;
+            vertexT** vertexp = 0;
+            FOREACHvertex_(facet->vertices) {
+               size_t iinode = vmap[vertex->id];
+               m_face_vind.push_back(iinode);
+               face_cen.add(m_vert[iinode]);
+            }
+
+            // divide by number of face vertices to get the face center estimate
+            size_t ifv = m_face_offset.back();
+            size_t nfv = m_face_vind.size() - ifv;
+            face_cen.scale(1.0/nfv);
+
+            // compute the face normal and flip the face as needed
+            check_flip(hull_center,face_cen,&m_face_vind[ifv],nfv);
+            m_face_offset.push_back(m_face_vind.size());
          }
-
-         // divide by number of face vertices to get the face center estimate
-         size_t nfv = fv.size();
-         face_cen.x /= nfv;
-         face_cen.y /= nfv;
-         face_cen.z /= nfv;
-
-         // compute the face normal and flip the face as needed
-         check_flip(hull_center,face_cen,fv);
       }
    }
 
-   return true;
+   // the statistics are reset by the next qh_new_qhull
+   processed = zzval_(Zprocessed);
+   merges    = zzval_(Ztotmerge);
+
+   // return the memory to qhull, the qhT itself is kept for the next computation
+   int curlong=0, totlong=0;
+   qh_freeqhull(qh,!qh_ALL);
+   qh_memfreeshort(qh,&curlong,&totlong);
+
+   return (exitcode==0);
 }
 
-void qhull3d::check_flip(xyz& cen, xyz& face_cen, face_vertices& fv)
+void qhull3d::check_flip(const xyz& cen, const xyz& face_cen, size_t* fv, size_t nfv)
 {
    // vector from centre of hull to centre of face
    qvec3d vref(face_cen.x-cen.x,face_cen.y-cen.y,face_cen.z-cen.z);
    qvec3d vnorm;
 
-   if(fv.size() < 4) {
+   if(nfv < 4) {
       // a simple triangle, use the fastest method
 
       // face coordinates
-      xyz&  p0 = m_vert[fv[0]];
-      xyz&  p1 = m_vert[fv[1]];
-      xyz&  p2 = m_vert[fv[2]];
+      const xyz&  p0 = m_vert[fv[0]];
+      const xyz&  p1 = m_vert[fv[1]];
+      const xyz&  p2 = m_vert[fv[2]];
 
       // face edge vectors
       qvec3d v1(p1.x-p0.x,p1.y-p0.y,p1.z-p0.z);
@@ -226,23 +280,22 @@ void qhull3d::check_flip(xyz& cen, xyz& face_cen, face_vertices& fv)
    }
    else {
       // use Newell's method, more expensive but safer for general polygons
-      vnorm = newell_face_normal(fv);
+      vnorm = newell_face_normal(fv,nfv);
    }
 
    if(vref.dot(vnorm) < 0.0) {
 
       // normal was opposite the reference, so we must flip the face
-      std::reverse(fv.begin(),fv.end());
+      std::reverse(fv,fv+nfv);
    }
 }
 
-qvec3d qhull3d::newell_face_normal(face_vertices& fv)
+qvec3d qhull3d::newell_face_normal(const size_t* fv, size_t nvert)
 {
    // https://www.opengl.org/wiki/Calculating_a_Surface_Normal
    // http://www.gamedev.net/topic/416131-calculating-a-polygon-normal/?p=3771628#entry3771628
 
    double nx(0.0),ny(0.0),nz(0.0);
-   size_t nvert = fv.size();
    size_t ilast = nvert-1;
    for(size_t i=0; i<nvert; i++) {
 
@@ -265,22 +318,12 @@ qvec3d qhull3d::newell_face_normal(face_vertices& fv)
    return vnorm;
 }
 
-qhull3d::face_iterator qhull3d::face_begin()
-{
-   return m_faces.begin();
-}
-
-qhull3d::face_iterator qhull3d::face_end()
-{
-   return m_faces.end();
-}
-
-qhull3d::vertex_iterator qhull3d::vertex_begin()
+qhull3d::vertex_iterator qhull3d::vertex_begin() const
 {
    return m_vert.begin();
 }
 
-qhull3d::vertex_iterator qhull3d::vertex_end()
+qhull3d::vertex_iterator qhull3d::vertex_end() const
 {
    return m_vert.end();
 }
@@ -16,8 +16,8 @@
 #ifndef QHULL3D_H
 #define QHULL3D_H
 
+#include <cstddef>
 #include <vector>
-#include <map>
 
 #include "qvec3d.h"
 
@@ -38,12 +38,20 @@ public:
       double z;
    };
 
-   typedef std::map<size_t,xyz>           vertex_map;
-   typedef vertex_map::iterator           vertex_iterator;
+   typedef std::vector<xyz>               vertex_vector;
+   typedef vertex_vector::const_iterator  vertex_iterator;
 
-   typedef std::vector<size_t>            face_vertices;
-   typedef std::map<size_t,face_vertices> face_map;
-   typedef face_map::iterator             face_iterator;
+   // faces are stored in compressed row form: the vertex indices of face i
+   // are m_face_vind[m_face_offset[i]] ... m_face_vind[m_face_offset[i+1]-1]
+   typedef std::vector<size_t>            index_vector;
+   typedef const size_t*                  face_vertex_iterator;
+
+   // hull algorithm used by compute()
+   //    LIBQHULL  : libqhull_r
+   //    QUICKHULL : native quickhull3d with per thread work arrays
+   enum hull_engine { LIBQHULL, QUICKHULL };
+   static hull_engine engine() { return m_engine; }
+   static void set_engine(hull_engine engine) { m_engine = engine; }
 
    qhull3d();
    virtual ~qhull3d();
@@ -56,10 +64,16 @@ public:
 
    // push an input coordinate
    void push_back(double x, double y, double z);
+
+   // extend the input by nvert coordinates and return a pointer to them,
+   // the caller fills them as xyz triplets
+   double* extend(size_t nvert);
    in_coords_iterator in_coords_begin();
    in_coords_iterator in_coords_end();
 
    // compute the convex hull, faces will be properly oriented
+   // returns false if qhull failed or there were too few input vertices.
+   // The hull is added to qhull_stats when it is enabled
    bool compute();
 
    // number of vertices (defined after calling compute)
@@ -69,24 +83,36 @@ public:
    size_t nfaces() const;
 
    // vertex traversal. result vertices are different from input!
-   vertex_iterator vertex_begin();
-   vertex_iterator vertex_end();
+   vertex_iterator vertex_begin() const;
+   vertex_iterator vertex_end() const;
+   const xyz& vertex(size_t iv) const { return m_vert[iv]; }
+
+   // face traversal, iface = [0,nfaces()>
+   size_t face_size(size_t iface) const { return m_face_offset[iface+1] - m_face_offset[iface]; }
+   face_vertex_iterator face_begin(size_t iface) const { return &m_face_vind[0] + m_face_offset[iface]; }
+   face_vertex_iterator face_end(size_t iface) const   { return &m_face_vind[0] + m_face_offset[iface+1]; }
 
-   // face traversal
-   face_iterator face_begin();
-   face_iterator face_end();
+   // flat face vertex indices for all faces, in face order
+   const index_vector& face_vertex_indices() const { return m_face_vind; }
 
 private:
-   void check_flip(xyz& cen, xyz& face_cen, face_vertices& vert);
+   // processed points and merged facets are returned from the libqhull statistics
+   bool compute_libqhull(size_t& processed, size_t& merges);
+   bool compute_quickhull();
+
+   void check_flip(const xyz& cen, const xyz& face_cen, size_t* fv, size_t nfv);
 
    // compute a face normal using Newell's method
-   qvec3d newell_face_normal(face_vertices& vert);
+   qvec3d newell_face_normal(const size_t* fv, size_t nfv);
 
 private:
    in_coords  m_in_vert;   // input vertices as flat vector {x1,y1,z1,x2,y2,z2,....,xn,yn,zn}
 
-   vertex_map     m_vert;    // result vertices
-   face_map       m_faces;   // face id, face vertex indices
+   vertex_vector  m_vert;         // result vertices
+   index_vector   m_face_offset;  // nfaces+1 offsets into m_face_vind
+   index_vector   m_face_vind;    // face vertex indices, all faces concatenated
+
+   static hull_engine m_engine;
 };
 
 #endif // QHULL3D_H
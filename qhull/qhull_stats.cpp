@@ -0,0 +1,57 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Gemoetry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "qhull_stats.h"
+#include <algorithm>
+
+qhull_stats::qhull_stats()
+: m_enabled(false)
+{}
+
+qhull_stats::~qhull_stats()
+{}
+
+void qhull_stats::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_2d = totals();
+   m_3d = totals();
+}
+
+void qhull_stats::add(int dim, size_t points_in, size_t processed, size_t vertices, size_t facets, size_t merges, double ms)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   totals& t = (dim == 2)? m_2d : m_3d;
+   t.nhull++;
+   t.points_in += points_in;
+   t.processed += processed;
+   t.vertices  += vertices;
+   t.facets    += facets;
+   t.merges    += merges;
+   t.ms        += ms;
+   t.max_ms     = std::max(t.max_ms,ms);
+}
+
+qhull_stats::totals qhull_stats::hull2d() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_2d;
+}
+
+qhull_stats::totals qhull_stats::hull3d() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_3d;
+}
@@ -0,0 +1,67 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Gemoetry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef QHULL_STATS_H
+#define QHULL_STATS_H
+
+#include <cstddef>
+#include <mutex>
+#include <atomic>
+
+// qhull_stats aggregates the statistics of the hulls computed by qhull2d and qhull3d,
+// for profiling pipelines running thousands of hulls. Collection is off unless enabled,
+// then each hull adds its counts under one lock
+
+class qhull_stats {
+public:
+   struct totals {
+      totals() : nhull(0), points_in(0), processed(0), vertices(0), facets(0), merges(0), ms(0), max_ms(0) {}
+      size_t nhull;
+      size_t points_in;    // input points
+      size_t processed;    // points added to the hull by libqhull, 0 for the other algorithms
+      size_t vertices;     // hull vertices
+      size_t facets;       // hull facets, edges in 2d
+      size_t merges;       // facets merged by libqhull
+      double ms;           // wall time of the hulls, summed over threads
+      double max_ms;       // slowest hull
+   };
+
+   static qhull_stats& singleton()  { static qhull_stats instance; return instance;  }
+
+   bool enabled() const { return m_enabled; }
+   void set_enabled(bool enabled) { m_enabled = enabled; }
+
+   // reset the totals
+   void clear();
+
+   // add one hull of dimension dim (2 or 3)
+   void add(int dim, size_t points_in, size_t processed, size_t vertices, size_t facets, size_t merges, double ms);
+
+   // totals per dimension
+   totals hull2d() const;
+   totals hull3d() const;
+
+protected:
+   qhull_stats();
+   virtual ~qhull_stats();
+
+private:
+   std::atomic<bool>  m_enabled;
+   totals             m_2d;
+   totals             m_3d;
+   mutable std::mutex m_mutex;
+};
+
+#endif // QHULL_STATS_H
@@ -0,0 +1,355 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "quickhull3d.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+static const size_t none = size_t(-1);
+
+static inline void sub(const double* a, const double* b, double* c)
+{
+   c[0] = a[0]-b[0]; c[1] = a[1]-b[1]; c[2] = a[2]-b[2];
+}
+
+static inline void cross(const double* a, const double* b, double* c)
+{
+   c[0] = a[1]*b[2] - a[2]*b[1];
+   c[1] = a[2]*b[0] - a[0]*b[2];
+   c[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline double dot(const double* a, const double* b)
+{
+   return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+quickhull3d::quickhull3d()
+: m_coords(0)
+, m_npoints(0)
+, m_eps(0.0)
+, m_mark(0)
+{}
+
+quickhull3d::~quickhull3d()
+{}
+
+bool quickhull3d::compute(const double* coords, size_t npoints)
+{
+   m_coords  = coords;
+   m_npoints = npoints;
+   m_mark    = 0;
+   m_faces.clear();
+   m_free.clear();
+   m_pending.clear();
+   m_hull_vert.clear();
+   m_hull_tri.clear();
+   if(npoints < 4) return false;
+
+   m_next.assign(npoints,none);
+   m_start.assign(npoints,none);
+
+   // distance tolerance relative to the coordinate magnitudes, as in qhull
+   double maxabs[3] = {0.0,0.0,0.0};
+   for(size_t ip=0; ip<npoints; ip++) {
+      const double* p = coords + 3*ip;
+      for(size_t k=0; k<3; k++) maxabs[k] = std::max(maxabs[k],std::fabs(p[k]));
+   }
+   m_eps = 3.0*DBL_EPSILON*(maxabs[0]+maxabs[1]+maxabs[2]);
+
+   if(!initial_simplex()) return false;
+
+   // expand the hull by the furthest outside point of a face, until no face has outside points
+   while(!m_pending.empty()) {
+      size_t iface = m_pending.back();
+      m_pending.pop_back();
+      const face& f = m_faces[iface];
+      if(f.alive && f.outside != none) add_point(iface);
+   }
+
+   collect_result();
+   return true;
+}
+
+double quickhull3d::distance(const face& f, size_t ip) const
+{
+   return dot(f.n,m_coords+3*ip) - f.d;
+}
+
+size_t quickhull3d::new_face(size_t a, size_t b, size_t c)
+{
+   size_t iface = 0;
+   if(m_free.size() > 0) {
+      iface = m_free.back();
+      m_free.pop_back();
+   }
+   else {
+      iface = m_faces.size();
+      m_faces.push_back(face());
+   }
+
+   face& f = m_faces[iface];
+   f.v[0] = a; f.v[1] = b; f.v[2] = c;
+   f.nbr[0] = f.nbr[1] = f.nbr[2] = none;
+
+   const double* pa = m_coords + 3*a;
+   double u[3],v[3];
+   sub(m_coords+3*b,pa,u);
+   sub(m_coords+3*c,pa,v);
+   cross(u,v,f.n);
+   double len = std::sqrt(dot(f.n,f.n));
+   if(len > 0.0) {
+      f.n[0] /= len; f.n[1] /= len; f.n[2] /= len;
+   }
+   f.d        = dot(f.n,pa);
+   f.outside  = none;
+   f.furthest = none;
+   f.dmax     = 0.0;
+   f.mark     = 0;
+   f.alive    = true;
+   return iface;
+}
+
+void quickhull3d::add_outside(size_t iface, size_t ip, double dist)
+{
+   face& f = m_faces[iface];
+   m_next[ip] = f.outside;
+   f.outside  = ip;
+   if(dist > f.dmax) {
+      f.dmax     = dist;
+      f.furthest = ip;
+   }
+}
+
+bool quickhull3d::initial_simplex()
+{
+   // extreme points along the axes
+   size_t ext[6] = {0,0,0,0,0,0};
+   for(size_t ip=1; ip<m_npoints; ip++) {
+      const double* p = m_coords + 3*ip;
+      for(size_t k=0; k<3; k++) {
+         if(p[k] < m_coords[3*ext[2*k]+k])   ext[2*k]   = ip;
+         if(p[k] > m_coords[3*ext[2*k+1]+k]) ext[2*k+1] = ip;
+      }
+   }
+
+   // the 2 extremes furthest apart
+   size_t i0=0,i1=0;
+   double dmax = 0.0;
+   for(size_t i=0; i<6; i++) {
+      for(size_t j=i+1; j<6; j++) {
+         double u[3]; sub(m_coords+3*ext[i],m_coords+3*ext[j],u);
+         double d = dot(u,u);
+         if(d > dmax) { dmax = d; i0 = ext[i]; i1 = ext[j]; }
+      }
+   }
+   if(std::sqrt(dmax) <= m_eps) return false;
+
+   // the point furthest from the line i0-i1
+   const double* p0 = m_coords + 3*i0;
+   double u[3]; sub(m_coords+3*i1,p0,u);
+   size_t i2 = none;
+   dmax = 0.0;
+   for(size_t ip=0; ip<m_npoints; ip++) {
+      double v[3],c[3];
+      sub(m_coords+3*ip,p0,v);
+      cross(u,v,c);
+      double d = dot(c,c);
+      if(d > dmax) { dmax = d; i2 = ip; }
+   }
+   if(i2 == none || std::sqrt(dmax/dot(u,u)) <= m_eps) return false;
+
+   // the point furthest from the plane i0-i1-i2
+   double v[3],n[3];
+   sub(m_coords+3*i2,p0,v);
+   cross(u,v,n);
+   double len = std::sqrt(dot(n,n));
+   n[0] /= len; n[1] /= len; n[2] /= len;
+   size_t i3 = none;
+   double dabs = 0.0;
+   double dsigned = 0.0;
+   for(size_t ip=0; ip<m_npoints; ip++) {
+      double w[3]; sub(m_coords+3*ip,p0,w);
+      double d = dot(n,w);
+      if(std::fabs(d) > dabs) { dabs = std::fabs(d); dsigned = d; i3 = ip; }
+   }
+   if(i3 == none || dabs <= m_eps) return false;
+
+   // base face a,b,c with its normal pointing away from the apex d
+   size_t a = i0, b = i1, c = i2, d = i3;
+   if(dsigned > 0.0) std::swap(b,c);
+
+   size_t f[4];
+   f[0] = new_face(a,b,c);
+   f[1] = new_face(b,a,d);
+   f[2] = new_face(c,b,d);
+   f[3] = new_face(a,c,d);
+
+   // link the neighbours through their shared, opposite edges
+   for(size_t i=0; i<4; i++) {
+      face& fi = m_faces[f[i]];
+      for(size_t ei=0; ei<3; ei++) {
+         size_t va = fi.v[ei];
+         size_t vb = fi.v[(ei+1)%3];
+         for(size_t j=0; j<4; j++) {
+            if(j == i) continue;
+            const face& fj = m_faces[f[j]];
+            for(size_t ej=0; ej<3; ej++) {
+               if(fj.v[ej] == vb && fj.v[(ej+1)%3] == va) fi.nbr[ei] = f[j];
+            }
+         }
+      }
+   }
+
+   // distribute the remaining points to the face they are furthest outside of
+   for(size_t ip=0; ip<m_npoints; ip++) {
+      if(ip==a || ip==b || ip==c || ip==d) continue;
+      size_t best = none;
+      double dbest = m_eps;
+      for(size_t i=0; i<4; i++) {
+         double dist = distance(m_faces[f[i]],ip);
+         if(dist > dbest) { dbest = dist; best = f[i]; }
+      }
+      if(best != none) add_outside(best,ip,dbest);
+   }
+
+   for(size_t i=0; i<4; i++) m_pending.push_back(f[i]);
+   return true;
+}
+
+void quickhull3d::find_horizon(size_t iface, size_t eye)
+{
+   // depth first search of the faces visible from the eye point.
+   // Edges to faces that are not visible make up the horizon
+   m_visible.clear();
+   m_horizon.clear();
+   m_stack.clear();
+
+   m_faces[iface].mark = m_mark;
+   m_visible.push_back(iface);
+   frame fr0 = {iface,0,0};
+   m_stack.push_back(fr0);
+
+   while(!m_stack.empty()) {
+      frame& fr = m_stack.back();
+      if(fr.k == 3) {
+         m_stack.pop_back();
+         continue;
+      }
+      size_t f = fr.f;
+      size_t e = (fr.start + fr.k)%3;
+      fr.k++;
+
+      size_t g = m_faces[f].nbr[e];
+      if(m_faces[g].mark == m_mark) continue;
+
+      if(distance(m_faces[g],eye) > m_eps) {
+         m_faces[g].mark = m_mark;
+         m_visible.push_back(g);
+
+         // continue in g after the edge leading back to f
+         size_t eg = 0;
+         while(eg<3 && m_faces[g].nbr[eg] != f) eg++;
+         frame frg = {g,(eg+1)%3,0};
+         m_stack.push_back(frg);
+      }
+      else {
+         m_horizon.push_back(std::make_pair(f,e));
+      }
+   }
+}
+
+void quickhull3d::add_point(size_t iface)
+{
+   size_t eye = m_faces[iface].furthest;
+
+   m_mark++;
+   find_horizon(iface,eye);
+
+   // one new face per horizon edge, connecting the edge to the eye point
+   m_created.clear();
+   for(size_t ih=0; ih<m_horizon.size(); ih++) {
+      size_t f = m_horizon[ih].first;
+      size_t e = m_horizon[ih].second;
+      size_t a = m_faces[f].v[e];
+      size_t b = m_faces[f].v[(e+1)%3];
+      size_t g = m_faces[f].nbr[e];
+
+      size_t n = new_face(a,b,eye);
+      m_faces[n].nbr[0] = g;
+
+      face& gf = m_faces[g];
+      for(size_t k=0; k<3; k++) {
+         if(gf.v[k]==b && gf.v[(k+1)%3]==a) gf.nbr[k] = n;
+      }
+      m_start[a] = n;
+      m_created.push_back(n);
+   }
+
+   // link the new faces to each other: edge b->eye of one face is edge eye->b of the next
+   for(size_t i=0; i<m_created.size(); i++) {
+      size_t n = m_created[i];
+      size_t m = m_start[m_faces[n].v[1]];
+      m_faces[n].nbr[1] = m;
+      m_faces[m].nbr[2] = n;
+   }
+   for(size_t i=0; i<m_created.size(); i++) {
+      m_start[m_faces[m_created[i]].v[0]] = none;
+   }
+
+   // move the outside points of the visible faces to the new faces, then retire the visible faces
+   for(size_t iv=0; iv<m_visible.size(); iv++) {
+      size_t f = m_visible[iv];
+      size_t ip = m_faces[f].outside;
+      while(ip != none) {
+         size_t next = m_next[ip];
+         if(ip != eye) {
+            size_t best = none;
+            double dbest = m_eps;
+            for(size_t i=0; i<m_created.size(); i++) {
+               double dist = distance(m_faces[m_created[i]],ip);
+               if(dist > dbest) { dbest = dist; best = m_created[i]; }
+            }
+            if(best != none) add_outside(best,ip,dbest);
+         }
+         ip = next;
+      }
+      m_faces[f].outside = none;
+      m_faces[f].alive   = false;
+      m_free.push_back(f);
+   }
+
+   for(size_t i=0; i<m_created.size(); i++) {
+      if(m_faces[m_created[i]].outside != none) m_pending.push_back(m_created[i]);
+   }
+}
+
+void quickhull3d::collect_result()
+{
+   m_vmap.assign(m_npoints,none);
+   for(size_t iface=0; iface<m_faces.size(); iface++) {
+      const face& f = m_faces[iface];
+      if(!f.alive) continue;
+      for(size_t k=0; k<3; k++) {
+         size_t ip = f.v[k];
+         if(m_vmap[ip] == none) {
+            m_vmap[ip] = m_hull_vert.size();
+            m_hull_vert.push_back(ip);
+         }
+         m_hull_tri.push_back(m_vmap[ip]);
+      }
+   }
+}
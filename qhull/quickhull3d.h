@@ -0,0 +1,90 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef QUICKHULL3D_H
+#define QUICKHULL3D_H
+
+#include <cstddef>
+#include <vector>
+
+// quickhull3d is a native 3d quickhull, an alternative to libqhull_r for qhull3d.
+// All work arrays are kept between calls, so repeated hulls on the same
+// instance do not allocate once the arrays have grown to size.
+// The result faces are triangles with outward normals.
+
+class quickhull3d {
+public:
+   quickhull3d();
+   virtual ~quickhull3d();
+
+   // compute the hull of npoints points given as {x1,y1,z1,x2,y2,z2,....}
+   // returns false if the points do not span a volume
+   bool compute(const double* coords, size_t npoints);
+
+   // the result: hull vertices as input point indices, and triangles referring to
+   // positions in that vertex list.
+   const std::vector<size_t>& vertices() const { return m_hull_vert; }
+   const std::vector<size_t>& triangles() const { return m_hull_tri; }
+
+private:
+   struct face {
+      size_t v[3];        // vertices CCW seen from outside
+      size_t nbr[3];      // neighbour face across edge v[i]->v[(i+1)%3]
+      double n[3];        // unit outward normal
+      double d;           // plane offset, n.p = d
+      size_t outside;     // first point in the outside list, or none
+      size_t furthest;    // point in the outside list furthest from the plane
+      double dmax;        // distance of the furthest point
+      size_t mark;        // visit mark of the latest horizon search
+      bool   alive;
+   };
+
+   // horizon search frame, edges are processed from 'start' in CCW order
+   struct frame {
+      size_t f;
+      size_t start;
+      size_t k;
+   };
+
+   bool   initial_simplex();
+   size_t new_face(size_t a, size_t b, size_t c);
+   double distance(const face& f, size_t ip) const;
+   void   add_outside(size_t iface, size_t ip, double dist);
+   void   add_point(size_t iface);
+   void   find_horizon(size_t iface, size_t eye);
+   void   collect_result();
+
+private:
+   const double*        m_coords;
+   size_t               m_npoints;
+   double               m_eps;      // distance tolerance
+
+   std::vector<face>    m_faces;
+   std::vector<size_t>  m_free;     // dead faces for reuse
+   std::vector<size_t>  m_pending;  // faces that may have outside points
+   std::vector<size_t>  m_next;     // outside list link per point
+   std::vector<size_t>  m_start;    // new face starting at a horizon vertex, per point
+   std::vector<size_t>  m_visible;  // faces visible from the eye point
+   std::vector<std::pair<size_t,size_t>> m_horizon;  // (face,edge) of horizon edges
+   std::vector<size_t>  m_created;  // faces created for the eye point
+   std::vector<frame>   m_stack;
+   size_t               m_mark;
+
+   std::vector<size_t>  m_vmap;     // input point to hull vertex index
+   std::vector<size_t>  m_hull_vert;
+   std::vector<size_t>  m_hull_tri;
+};
+
+#endif // QUICKHULL3D_H
@@ -14,9 +14,12 @@
 // EndLicense:
 
 #include "amf_file.h"
-#include "csg_parser/cf_xmlTree.h"
-#include <carve/poly.hpp>
+#include "buffered_writer.h"
+#include "zip_writer.h"
+#include "trace_writer.h"
 #include <ctime>
+#include <stdexcept>
+#include <algorithm>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
@@ -31,14 +34,32 @@ amf_file::~amf_file()
    //dtor
 }
 
-std::string amf_file::write(std::shared_ptr<poly_vector> polyset, const std::string& file_path)
+// escape text for XML element content and attribute values
+static std::string xml_escape(const std::string& text)
 {
+   std::string escaped;
+   for(char c : text) {
+      switch(c) {
+         case '&':  escaped += "&amp;";  break;
+         case '<':  escaped += "&lt;";   break;
+         case '>':  escaped += "&gt;";   break;
+         case '"':  escaped += "&quot;"; break;
+         case '\'': escaped += "&apos;"; break;
+         default:   escaped += c;
+      }
+   }
+   return escaped;
+}
+
+std::string amf_file::write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path, bool zip)
+{
+   trace_span span("write_amf","export");
    // ISO8601 date and time string of current time
    time_t now = time(0);
    const size_t blen = 80;
    char buffer[blen];
    strftime(buffer,blen,"%Y-%m-%dT%H:%M:%S",gmtime(&now));
-   string iso8601(buffer);
+   std::string iso8601(buffer);
 
    boost::filesystem::path fullpath(file_path);
    boost::filesystem::path amf_path = fullpath.parent_path() / fullpath.stem();
@@ -47,66 +68,70 @@ std::string amf_file::write(std::shared_ptr<poly_vector> polyset, const std::str
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   cf_xmlTree tree;
-   if(tree.create_root("amf")) {
-      cf_xmlNode root;
-      if(tree.get_root(root)) {
-         root.add_property("unit","millimeter");
-
-         // add some metadata
-         cf_xmlNode name      = root.add_child("metadata"); name.add_property("type","name");         name.put_value(fullpath.stem().string());
-         cf_xmlNode date_time = root.add_child("metadata"); date_time.add_property("type","created"); date_time.put_value(iso8601);
-         cf_xmlNode software  = root.add_child("metadata"); software.add_property("type","software"); software.put_value("xcsg");
-
-         // write one amf "object" per polyhedron
-         for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-            to_amf_object(root,polyset,ipoly);
-         }
-
-         tree.write_xml(path);
-      }
+   // the document is written in the same layout as the property tree used to produce
+   zip_writer archive;
+   buffered_writer out;
+   bool ok = false;
+   if(zip) ok = archive.open(path) && out.open(archive,fullpath.stem().string() + ".amf");
+   else    ok = out.open(path);
+   if(!ok) throw std::runtime_error("amf_file::write(...)  Failed to open: " + path);
+
+   out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+   out << "<amf unit=\"millimeter\">\n";
+
+   // add some metadata
+   out << "\t<metadata type=\"name\">" << xml_escape(fullpath.stem().string()) << "</metadata>\n";
+   out << "\t<metadata type=\"created\">" << iso8601 << "</metadata>\n";
+   out << "\t<metadata type=\"software\">xcsg</metadata>\n";
+
+   // write one amf "object" per lump
+   for(size_t imesh=0; imesh<meshes->size(); imesh++) {
+      write_amf_object(out,*(*meshes)[imesh],imesh);
    }
 
+   out << "</amf>\n";
+   out.close();
+   archive.close();
+
    return path;
 }
 
 
-bool amf_file::to_amf_object(cf_xmlNode& parent, std::shared_ptr<poly_vector> polyset, size_t index)
+void amf_file::write_amf_object(buffered_writer& out, const triangle_mesh& mesh, size_t index)
 {
-   std::shared_ptr<carve::poly::Polyhedron> poly = (*polyset)[index];
-
-   cf_xmlNode object = parent.add_child("object");
-   object.add_property("id",index);
-   cf_xmlNode mesh = object.add_child("mesh");
-
-   cf_xmlNode vertices = mesh.add_child("vertices");
-   for(size_t ivert=0; ivert<poly->vertices.size(); ivert++) {
-      carve::poly::Geometry<3>::vertex_t& vtx = poly->vertices[ivert];
-
-      cf_xmlNode coordinates = vertices.add_child("vertex").add_child("coordinates");
-      coordinates.add_child("x").put_value(vtx.v[0]);
-      coordinates.add_child("y").put_value(vtx.v[1]);
-      coordinates.add_child("z").put_value(vtx.v[2]);
-   }
-
-   cf_xmlNode volume = mesh.add_child("volume");
-
-   const string vtags[] = { "v1", "v2", "v3" } ;
-
-   for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-      carve::poly::Face<3>& face = poly->faces[iface];
-
-      size_t nvert = face.nVertices();
-      if(nvert != 3)throw std::logic_error("amf_file::to_xml, non-triangular face encountered!");
-
-      cf_xmlNode triangle = volume.add_child("triangle");
-      std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-      poly->faces[iface].getVertexLoop(vloop);
-      for(size_t ivert=0; ivert<nvert; ivert++) {
-         size_t index = poly->vertexToIndex(vloop[ivert]);
-         triangle.add_child(vtags[ivert]).put_value(index);
+   out << "\t<object id=\"" << index << "\">\n";
+   out << "\t\t<mesh>\n";
+
+   out << "\t\t\t<vertices>\n";
+   out.write_chunked(mesh.nvertices(),[&mesh](size_t ivert, std::string& text) {
+      static const char* tags[] = { "\t\t\t\t\t\t<x>", "\t\t\t\t\t\t<y>", "\t\t\t\t\t\t<z>" };
+      static const char* end_tags[] = { "</x>\n", "</y>\n", "</z>\n" };
+      const xvertex& vtx = mesh.vertex(ivert);
+      text += "\t\t\t\t<vertex>\n\t\t\t\t\t<coordinates>\n";
+      for(size_t i=0; i<3; i++) {
+         text += tags[i];
+         buffered_writer::append_general(text,vtx.v[i],16);
+         text += end_tags[i];
       }
-   }
+      text += "\t\t\t\t\t</coordinates>\n\t\t\t\t</vertex>\n";
+   });
+   out << "\t\t\t</vertices>\n";
+
+   out << "\t\t\t<volume>\n";
+   out.write_chunked(mesh.ntriangles(),[&mesh](size_t itri, std::string& text) {
+      static const char* tags[] = { "\t\t\t\t\t<v1>", "\t\t\t\t\t<v2>", "\t\t\t\t\t<v3>" };
+      static const char* end_tags[] = { "</v1>\n", "</v2>\n", "</v3>\n" };
+      const size_t* tri = mesh.triangle(itri);
+      text += "\t\t\t\t<triangle>\n";
+      for(size_t ivert=0; ivert<3; ivert++) {
+         text += tags[ivert];
+         buffered_writer::append(text,tri[ivert]);
+         text += end_tags[ivert];
+      }
+      text += "\t\t\t\t</triangle>\n";
+   });
+   out << "\t\t\t</volume>\n";
 
-   return true;
+   out << "\t\t</mesh>\n";
+   out << "\t</object>\n";
 }
@@ -16,25 +16,26 @@
 #ifndef AMF_FILE_H
 #define AMF_FILE_H
 
-class cf_xmlNode;
+class buffered_writer;
 #include <vector>
 #include <memory>
-#include <carve/csg.hpp>
 #include <ostream>
+#include "triangle_mesh.h"
 
 class amf_file {
 public:
-   typedef std::vector<std::shared_ptr<carve::poly::Polyhedron>> poly_vector;
+   typedef triangle_mesh::mesh_vector mesh_vector;
 
    amf_file();
    virtual ~amf_file();
 
    // export to AMF, return the path to the file created
    // input is full path to file, file extension will be replaced to ".amf"
-   std::string  write(std::shared_ptr<poly_vector> polyset, const std::string& file_path);
+   // The XML is streamed to file, optionally compressed as a zip archive (still named .amf)
+   std::string  write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path, bool zip = false);
 
 protected:
-   bool to_amf_object(cf_xmlNode& parent, std::shared_ptr<poly_vector> polyset, size_t index);
+   void write_amf_object(buffered_writer& out, const triangle_mesh& mesh, size_t index);
 
 };
 
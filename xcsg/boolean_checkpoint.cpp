@@ -0,0 +1,215 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "boolean_checkpoint.h"
+#include "mesh_binary.h"
+#include "xml_hash.h"
+#include "std_filename.h"
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <boost/filesystem.hpp>
+
+static const char     checkpoint_magic[8] = { 'X','C','S','G','C','K','P','T' };
+static const uint32_t checkpoint_version  = 1;
+
+template <typename T>
+static bool read_value(std::istream& in, T& value)
+{
+   in.read(reinterpret_cast<char*>(&value),sizeof(T));
+   return in.good();
+}
+
+template <typename T>
+static void write_value(std::ostream& out, const T& value)
+{
+   out.write(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+// write to a temporary file and rename it, so a crash while writing keeps the previous file
+static bool write_file(const std::string& path, const std::function<bool(std::ostream&)>& write)
+{
+   std::string tmp = path + "." + boost::filesystem::unique_path().string() + ".tmp";
+   {
+      std::ofstream out(tmp,std::ios::binary);
+      if(!out.is_open() || !write(out) || !out.good()) return false;
+   }
+   boost::system::error_code ec;
+   boost::filesystem::rename(tmp,path,ec);
+   if(ec) boost::filesystem::remove(tmp,ec);
+   return !ec;
+}
+
+boolean_checkpoint::boolean_checkpoint()
+: m_interval(60.0)
+, m_last_write(std::chrono::steady_clock::now())
+, m_writing(false)
+, m_resumed(0)
+{}
+
+boolean_checkpoint::~boolean_checkpoint()
+{}
+
+void boolean_checkpoint::open(const std::string& path, double interval)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_path       = path;
+   m_interval   = interval;
+   m_last_write = std::chrono::steady_clock::now();
+   m_resumed    = 0;
+   m_saved.clear();
+   if(path.length() == 0) return;
+
+   std::string results = path + ".results";
+   if(!std_filename::Exists(results)) std_filename::create_directories(results);
+
+   // a missing or damaged checkpoint file means starting from scratch
+   std::ifstream in(path,std::ios::binary);
+   if(!in.is_open()) return;
+   char magic[sizeof(checkpoint_magic)];
+   in.read(magic,sizeof(magic));
+   uint32_t version = 0;
+   uint64_t nreduction = 0;
+   if(!in.good() || std::memcmp(magic,checkpoint_magic,sizeof(magic)) != 0) return;
+   if(!read_value(in,version) || version != checkpoint_version || !read_value(in,nreduction)) return;
+
+   std::map<uint64_t,std::vector<MeshSet_ptr>> saved;
+   for(uint64_t ireduction=0; ireduction<nreduction; ireduction++) {
+      uint64_t key = 0, nmesh = 0;
+      if(!read_value(in,key) || !read_value(in,nmesh)) return;
+      std::vector<MeshSet_ptr>& meshes = saved[key];
+      for(uint64_t imesh=0; imesh<nmesh; imesh++) {
+         MeshSet_ptr mesh = mesh_binary::read(in);
+         if(!mesh.get()) return;
+         meshes.push_back(mesh);
+      }
+   }
+   m_saved.swap(saved);
+}
+
+void boolean_checkpoint::complete()
+{
+   if(!enabled()) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   boost::system::error_code ec;
+   boost::filesystem::remove(m_path,ec);
+   boost::filesystem::remove_all(m_path + ".results",ec);
+   m_saved.clear();
+}
+
+std::string boolean_checkpoint::result_path(uint64_t key) const
+{
+   boost::filesystem::path path(m_path + ".results");
+   path /= xml_hash::to_string(key) + ".xmesh";
+   return path.string();
+}
+
+void boolean_checkpoint::write_if_due()
+{
+   std::chrono::duration<double> since = std::chrono::steady_clock::now() - m_last_write;
+   if(since.count() < m_interval) return;
+
+   // one thread writes, the others carry on
+   if(m_writing.exchange(true)) return;
+   write();
+   m_writing = false;
+}
+
+void boolean_checkpoint::write()
+{
+   // the snapshot is taken under the lock, the meshes are not modified once created
+   std::vector<std::pair<uint64_t,std::vector<MeshSet_ptr>>> snapshot;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(reduction* r : m_reductions) {
+         std::vector<MeshSet_ptr> meshes;
+         for(auto& m : r->m_live) meshes.push_back(m.second);
+         snapshot.push_back(std::make_pair(r->m_key,meshes));
+      }
+      m_last_write = std::chrono::steady_clock::now();
+   }
+
+   write_file(m_path,[&snapshot](std::ostream& out) {
+      out.write(checkpoint_magic,sizeof(checkpoint_magic));
+      write_value(out,checkpoint_version);
+      write_value(out,uint64_t(snapshot.size()));
+      for(auto& s : snapshot) {
+         write_value(out,s.first);
+         write_value(out,uint64_t(s.second.size()));
+         for(auto& mesh : s.second) {
+            if(!mesh_binary::write(out,mesh)) return false;
+         }
+      }
+      return true;
+   });
+}
+
+boolean_checkpoint::reduction::reduction(uint64_t key, std::vector<MeshSet_ptr>& meshes)
+: m_key(key)
+{
+   boolean_checkpoint& ckpt = boolean_checkpoint::singleton();
+   if(!ckpt.enabled()) return;
+
+   // a completed reduction gives its result directly, a saved one its state
+   std::ifstream in(ckpt.result_path(key),std::ios::binary);
+   MeshSet_ptr result = (in.is_open())? mesh_binary::read(in) : nullptr;
+
+   std::lock_guard<std::mutex> lock(ckpt.m_mutex);
+   if(result.get()) {
+      meshes.assign(1,result);
+      ckpt.m_resumed++;
+   }
+   else {
+      auto i = ckpt.m_saved.find(key);
+      if(i != ckpt.m_saved.end()) {
+         meshes.swap(i->second);
+         ckpt.m_saved.erase(i);
+         ckpt.m_resumed++;
+      }
+   }
+   for(auto& mesh : meshes) m_live[mesh.get()] = mesh;
+   ckpt.m_reductions.push_back(this);
+}
+
+boolean_checkpoint::reduction::~reduction()
+{
+   boolean_checkpoint& ckpt = boolean_checkpoint::singleton();
+   std::lock_guard<std::mutex> lock(ckpt.m_mutex);
+   auto i = std::find(ckpt.m_reductions.begin(),ckpt.m_reductions.end(),this);
+   if(i != ckpt.m_reductions.end()) ckpt.m_reductions.erase(i);
+}
+
+void boolean_checkpoint::reduction::replace(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b, MeshSet_ptr result)
+{
+   boolean_checkpoint& ckpt = boolean_checkpoint::singleton();
+   if(!ckpt.enabled()) return;
+   {
+      std::lock_guard<std::mutex> lock(ckpt.m_mutex);
+      m_live.erase(a);
+      m_live.erase(b);
+      m_live[result.get()] = result;
+   }
+   ckpt.write_if_due();
+}
+
+void boolean_checkpoint::reduction::finish(MeshSet_ptr result)
+{
+   boolean_checkpoint& ckpt = boolean_checkpoint::singleton();
+   if(!ckpt.enabled() || !result.get()) return;
+   write_file(ckpt.result_path(m_key),[&result](std::ostream& out) { return mesh_binary::write(out,result); });
+}
@@ -0,0 +1,93 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BOOLEAN_CHECKPOINT_H
+#define BOOLEAN_CHECKPOINT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <carve/mesh.hpp>
+
+// boolean_checkpoint saves the state of the boolean reductions to a file (--checkpoint),
+// so a restarted process resumes them instead of starting over.
+// The state of a reduction is the set of meshes whose union (or intersection) is its result:
+// the queued meshes plus the operands of booleans in progress. It is written periodically as
+//    header : "XCSGCKPT", uint32 format version, uint64 number of reductions
+//    per reduction: uint64 key, uint64 number of meshes, then the meshes in mesh_binary format
+// Results of completed reductions are kept as mesh_binary files in the directory <file>.results.
+// A reduction is identified by a key computed from its operation and input meshes.
+
+class boolean_checkpoint {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static boolean_checkpoint& singleton()  { static boolean_checkpoint instance; return instance;  }
+
+   // enable checkpoints to file, written at most every interval seconds.
+   // An existing checkpoint file is loaded for resuming. An empty path disables checkpoints
+   void open(const std::string& path, double interval);
+   bool enabled() const { return m_path.length() > 0; }
+
+   // remove the checkpoint files after a completed run
+   void complete();
+
+   // state of one running reduction, registered while in scope
+   class reduction {
+   public:
+      // meshes are replaced by the saved state of the reduction when there is one
+      reduction(uint64_t key, std::vector<MeshSet_ptr>& meshes);
+      ~reduction();
+
+      // a boolean of a and b produced result
+      void replace(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b, MeshSet_ptr result);
+
+      // the reduction completed with result
+      void finish(MeshSet_ptr result);
+
+   private:
+      friend class boolean_checkpoint;
+      uint64_t                                            m_key;
+      std::map<const carve::mesh::MeshSet<3>*,MeshSet_ptr> m_live;
+   };
+
+   size_t resumed() const { return m_resumed; }
+
+protected:
+   boolean_checkpoint();
+   virtual ~boolean_checkpoint();
+
+   // write the state of all reductions when the interval has passed
+   void write_if_due();
+   void write();
+
+   std::string result_path(uint64_t key) const;
+
+private:
+   std::string                                m_path;
+   double                                     m_interval;
+   std::chrono::steady_clock::time_point      m_last_write;
+   std::map<uint64_t,std::vector<MeshSet_ptr>> m_saved;      // loaded states not yet resumed
+   std::vector<reduction*>                    m_reductions; // running reductions
+   std::atomic<bool>                          m_writing;
+   std::atomic<size_t>                        m_resumed;
+   std::mutex                                 m_mutex;
+};
+
+#endif // BOOLEAN_CHECKPOINT_H
@@ -0,0 +1,223 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "boolean_engine.h"
+#include "sdf_field.h"
+#include "trace_writer.h"
+#include "thread_engine.h"
+#include "node_profiler.h"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+
+boolean_engine::~boolean_engine()
+{}
+
+namespace {
+
+   // carve_phase_hook marks the phases of one CSG::compute. Carve calls its hooks between
+   // its internal phases: intersection vertices and edge divisions are reported once the
+   // intersections are found, output faces while the face loops are classified.
+   // The first call of each kind ends a phase, later calls only test a flag
+   class carve_phase_hook : public carve::csg::CSG::Hook {
+   public:
+      typedef carve::mesh::MeshSet<3> meshset_t;
+
+      carve_phase_hook(carve::csg::CSG& csg)
+      : m_csg(csg)
+      , m_start(boost::posix_time::microsec_clock::universal_time())
+      , m_intersected(false)
+      , m_classifying(false)
+      {
+         m_csg.hooks.registerHook(this,carve::csg::CSG::Hooks::INTERSECTION_VERTEX_BIT
+                                      |carve::csg::CSG::Hooks::EDGE_DIVISION_BIT
+                                      |carve::csg::CSG::Hooks::PROCESS_OUTPUT_FACE_BIT);
+      }
+
+      virtual ~carve_phase_hook()
+      {
+         m_csg.hooks.unregisterHook(this);
+      }
+
+      virtual void intersectionVertex(const meshset_t::vertex_t*, const carve::csg::IObjPairSet&) { intersected(); }
+      virtual void edgeDivision(const meshset_t::edge_t*, size_t, const meshset_t::vertex_t*, const meshset_t::vertex_t*) { intersected(); }
+      virtual void processOutputFace(std::vector<meshset_t::face_t*>&, const meshset_t::face_t*, bool) { classifying(); }
+
+      // charge the phases to the profiler and the trace, a missing phase takes no time
+      void report()
+      {
+         boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+         if(!m_classifying) m_classify = end;
+         if(!m_intersected) m_intersect = m_classify;
+
+         long long intersect_us = (m_intersect - m_start).total_microseconds();
+         long long loops_us     = (m_classify - m_intersect).total_microseconds();
+         long long classify_us  = (end - m_classify).total_microseconds();
+
+         node_profiler& profiler = node_profiler::singleton();
+         if(profiler.enabled()) {
+            node_profiler::carve_phases phases;
+            phases.intersect_ms = 0.001*intersect_us;
+            phases.loops_ms     = 0.001*loops_us;
+            phases.classify_ms  = 0.001*classify_us;
+            profiler.add_carve_phases(phases);
+         }
+
+         trace_writer& trace = trace_writer::singleton();
+         if(trace.enabled()) {
+            long long ts = trace.now() - (end - m_start).total_microseconds();
+            trace.add("carve_intersect","boolean",ts,intersect_us);
+            trace.add("carve_loops","boolean",ts+intersect_us,loops_us);
+            trace.add("carve_classify","boolean",ts+intersect_us+loops_us,classify_us);
+         }
+      }
+
+   private:
+      void intersected()
+      {
+         if(m_intersected || m_classifying) return;
+         m_intersect   = boost::posix_time::microsec_clock::universal_time();
+         m_intersected = true;
+      }
+
+      void classifying()
+      {
+         if(m_classifying) return;
+         m_classify    = boost::posix_time::microsec_clock::universal_time();
+         m_classifying = true;
+      }
+
+   private:
+      carve::csg::CSG&         m_csg;
+      boost::posix_time::ptime m_start;
+      boost::posix_time::ptime m_intersect;
+      boost::posix_time::ptime m_classify;
+      bool                     m_intersected;
+      bool                     m_classifying;
+   };
+
+   // the exact carve boolean
+   class carve_engine : public boolean_engine {
+   public:
+      std::string name() const { return "carve"; }
+
+      mesh_handle compute(const mesh_handle& a, const mesh_handle& b, carve::csg::CSG::OP op) const
+      {
+         trace_span span("carve_boolean","boolean");
+
+         // CSG::compute starts by clearing the intersections and the vertex pool of the previous boolean
+         thread_engine<carve::csg::CSG> csg;
+         if(!node_profiler::singleton().enabled() && !trace_writer::singleton().enabled()) {
+            mesh_handle result(csg->compute(a.get(),b.get(),op));
+            csg.dismiss();
+            return result;
+         }
+
+         carve_phase_hook hook(*csg);
+         mesh_handle result(csg->compute(a.get(),b.get(),op));
+         csg.dismiss();
+         hook.report();
+         return result;
+      }
+   };
+
+   // both operands are rasterized and combined as signed distance fields, the voxel size
+   // is 1/256 of the largest operand extent unless set
+   class sdf_engine : public boolean_engine {
+   public:
+      std::string name() const { return "sdf"; }
+
+      mesh_handle compute(const mesh_handle& a, const mesh_handle& b, carve::csg::CSG::OP op) const
+      {
+         trace_span span("sdf_boolean","boolean");
+         if(op == carve::csg::CSG::B_MINUS_A) return compute(b,a,carve::csg::CSG::A_MINUS_B);
+
+         sdf_field::op_type sdf_op = sdf_field::UNION;
+         switch(op) {
+            case carve::csg::CSG::UNION:        { sdf_op = sdf_field::UNION; break; }
+            case carve::csg::CSG::INTERSECTION: { sdf_op = sdf_field::INTERSECTION; break; }
+            case carve::csg::CSG::A_MINUS_B:    { sdf_op = sdf_field::DIFFERENCE; break; }
+            default: throw std::logic_error("sdf boolean engine: unsupported boolean operation");
+         };
+
+         double voxel = sdf_engine::voxel();
+         if(voxel <= 0.0) {
+            carve::geom3d::AABB box_a = a->getAABB();
+            carve::geom3d::AABB box_b = b->getAABB();
+            double extent = 0.0;
+            for(size_t i=0; i<3; i++) extent = std::max(extent,2.0*std::max(box_a.extent[i],box_b.extent[i]));
+            voxel = extent/256.0;
+            if(voxel <= 0.0) throw std::logic_error("sdf boolean engine: operands without volume");
+         }
+
+         std::shared_ptr<sdf_field> field = sdf_field::from_mesh(*a,voxel);
+         field->combine(*sdf_field::from_mesh(*b,voxel),sdf_op);
+         return field->create_mesh();
+      }
+
+      static double voxel() { return sdf_field::default_voxel(); }
+   };
+
+   struct engine_registry {
+      engine_registry()
+      : current(std::make_shared<carve_engine>())
+      {
+         engines["carve"] = current;
+         engines["sdf"]   = std::make_shared<sdf_engine>();
+      }
+
+      std::mutex                                            mutex;
+      std::map<std::string,std::shared_ptr<boolean_engine>> engines;
+      std::shared_ptr<boolean_engine>                       current;
+   };
+
+   engine_registry& registry()
+   {
+      static engine_registry instance;
+      return instance;
+   }
+}
+
+void boolean_engine::register_engine(std::shared_ptr<boolean_engine> engine)
+{
+   engine_registry& r = registry();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   r.engines[engine->name()] = engine;
+}
+
+std::vector<std::string> boolean_engine::names()
+{
+   engine_registry& r = registry();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   std::vector<std::string> names;
+   for(auto& e : r.engines) names.push_back(e.first);
+   return names;
+}
+
+const boolean_engine& boolean_engine::current()
+{
+   // the engine is selected before the booleans start, so it is read without locking
+   return *registry().current;
+}
+
+void boolean_engine::set_current(const std::string& name)
+{
+   engine_registry& r = registry();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   auto i = r.engines.find(name);
+   if(i == r.engines.end()) throw std::logic_error("Unknown boolean engine '" + name + "'");
+   r.current = i->second;
+}
@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BOOLEAN_ENGINE_H
+#define BOOLEAN_ENGINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+
+// boolean_engine computes a single mesh boolean for carve_boolean. The lump splitting, disjoint
+// fast paths, partitioning and retries of carve_boolean apply to any engine, so engines can be
+// compared on the same models without changing the CSG tree code. Built in are "carve" (exact, default)
+// and "sdf" (voxel approximation, see sdf_field). Other engines may be registered before the run starts
+
+class boolean_engine {
+public:
+   // meshes are exchanged as carve mesh sets, an engine converts to its own representation internally
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> mesh_handle;
+
+   virtual ~boolean_engine();
+
+   virtual std::string name() const = 0;
+
+   // return a op b, or throw when the boolean fails
+   virtual mesh_handle compute(const mesh_handle& a, const mesh_handle& b, carve::csg::CSG::OP op) const = 0;
+
+   // add an engine selectable by its name, replacing any engine of the same name
+   static void register_engine(std::shared_ptr<boolean_engine> engine);
+
+   // names of the registered engines
+   static std::vector<std::string> names();
+
+   // the engine used by all booleans of the run
+   static const boolean_engine& current();
+
+   // select the engine by name, throws std::logic_error for unknown names
+   static void set_current(const std::string& name);
+};
+
+#endif // BOOLEAN_ENGINE_H
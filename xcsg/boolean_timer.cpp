@@ -16,19 +16,48 @@
 #include "boolean_timer.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include "json_log.h"
+#include "node_profiler.h"
+#include "mesh_memory.h"
+#include "thread_pool.h"
+
+// seconds between progress reports
+static const double report_interval = 2.0;
 
 boolean_timer::boolean_timer()
+: m_next_slot(0)
+, m_nbool_tot(1)
+, m_wall_start(std::chrono::steady_clock::now())
+, m_stop(true)
 {}
 
 boolean_timer::~boolean_timer()
-{}
+{
+   stop();
+}
+
+boolean_timer::slot& boolean_timer::thread_slot()
+{
+   static thread_local size_t index = m_next_slot++ % nslots;
+   return m_slots[index];
+}
 
 void boolean_timer::init(int nbool)
 {
-   m_nbool = 0;
+   stop();
+   for(auto& s : m_slots) {
+      s.busy_microsec = 0;
+      s.wait_microsec = 0;
+      s.nbool = 0;
+   }
    m_nbool_tot = (nbool>0)? nbool : 1;
-   m_progress = 0;
-   m_progress_report = 0;
+   m_wall_start = std::chrono::steady_clock::now();
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_stop = false;
+   m_reporter = boost::thread(&boolean_timer::reporter,this);
 }
 
 void boolean_timer::add_nbool(int nbool)
@@ -38,23 +67,112 @@ void boolean_timer::add_nbool(int nbool)
 
 void boolean_timer::add_elapsed(double esec)
 {
-   int millisec        = static_cast<int>(1000*esec);
-   m_elapsed_millisec += millisec;
-   m_nbool++;
-   m_progress = static_cast<unsigned int>((1000.0*m_nbool)/m_nbool_tot);
+   slot& s = thread_slot();
+   s.busy_microsec.fetch_add(static_cast<unsigned long long>(1.0E6*esec),std::memory_order_relaxed);
+   s.nbool.fetch_add(1,std::memory_order_relaxed);
+}
 
-   // report progress at every 5% progress
-   if( (m_progress - m_progress_report) >= 50) {
-      unsigned int p = m_progress;
-      m_progress_report = p;
+void boolean_timer::add_wait(double esec)
+{
+   thread_slot().wait_microsec.fetch_add(static_cast<unsigned long long>(1.0E6*esec),std::memory_order_relaxed);
 
-      double percent = m_progress*0.1;
-      std::cout << std::setprecision(3) << "...boolean progress: " << percent <<"% " << std::endl;
-   }
+   node_profiler& profiler = node_profiler::singleton();
+   if(profiler.enabled()) profiler.add_wait(1000*esec);
 }
 
+size_t boolean_timer::nbool() const
+{
+   unsigned long long n = 0;
+   for(auto& s : m_slots) n += s.nbool.load(std::memory_order_relaxed);
+   return static_cast<size_t>(n);
+}
 
 double boolean_timer::thread_elapsed()
 {
-   return m_elapsed_millisec*0.001;
+   unsigned long long busy = 0;
+   for(auto& s : m_slots) busy += s.busy_microsec.load(std::memory_order_relaxed);
+   return busy*1.0E-6;
+}
+
+double boolean_timer::thread_wait()
+{
+   unsigned long long wait = 0;
+   for(auto& s : m_slots) wait += s.wait_microsec.load(std::memory_order_relaxed);
+   return wait*1.0E-6;
+}
+
+double boolean_timer::wall_elapsed()
+{
+   std::chrono::duration<double> wall = std::chrono::steady_clock::now() - m_wall_start;
+   return wall.count();
+}
+
+double boolean_timer::efficiency(size_t nthreads)
+{
+   double capacity = wall_elapsed()*nthreads;
+   return (capacity > 0.0)? thread_elapsed()/capacity : 0.0;
+}
+
+double boolean_timer::thread_idle(size_t nthreads)
+{
+   // time neither in booleans nor waiting, e.g. meshing primitives or unused threads
+   double idle = wall_elapsed()*nthreads - thread_elapsed() - thread_wait();
+   return (idle > 0.0)? idle : 0.0;
+}
+
+void boolean_timer::stop()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+   }
+   m_cv.notify_all();
+   if(m_reporter.joinable()) m_reporter.join();
+}
+
+void boolean_timer::reporter()
+{
+   size_t nreported = 0;
+   std::unique_lock<std::mutex> lock(m_mutex);
+   while(!m_cv.wait_for(lock,std::chrono::duration<double>(report_interval),[this]() { return m_stop; })) {
+
+      // nothing is printed while no boolean completes
+      const size_t done  = nbool();
+      if(done == nreported) continue;
+      nreported = done;
+
+      // the total may grow, e.g. by minkowski sums, and is only an estimate
+      const size_t total = std::max(done,size_t(m_nbool_tot.load()));
+      const double wall  = wall_elapsed();
+      const double eta   = (done > 0)? wall*(total-done)/done : 0.0;
+
+      size_t queued = 0;
+      mesh_memory& memory = mesh_memory::singleton();
+      for(int s=0; s<mesh_memory::NSTAGE; s++) queued += memory.get_usage(mesh_memory::stage(s)).nmesh;
+      thread_pool& pool = thread_pool::singleton();
+      const size_t active = pool.active();
+
+      std::ostringstream out;
+      out << std::fixed << std::setprecision(1) << "...boolean progress: " << 100.0*done/total << "% (" << done << " of " << total
+          << "), eta " << eta << " [sec], queued meshes " << queued << ", active threads " << active << " of " << pool.nthreads()-1;
+      std::cout << out.str() << std::endl;
+      json_log::record("boolean_progress").add("done",done).add("total",total).add("eta",eta).add("queued",queued).add("active",active);
+   }
+}
+
+void boolean_timer::report(size_t nthreads)
+{
+   stop();
+
+   double wall = wall_elapsed();
+   double busy = thread_elapsed();
+   double wait = thread_wait();
+   double idle = thread_idle(nthreads);
+   double eff  = efficiency(nthreads);
+
+   std::cout << std::setprecision(4) << "...boolean threads: " << nthreads << ", wall " << wall << " [sec], busy " << busy
+             << " [sec], wait " << wait << " [sec], idle " << idle << " [sec], efficiency " << 100*eff << "%" << std::endl;
+
+   json_log::record("boolean_efficiency").add("threads",nthreads).add("wall",wall).add("busy",busy)
+                                         .add("wait",wait).add("idle",idle).add("efficiency",eff);
 }
@@ -17,12 +17,23 @@
 #define BOOLEAN_TIMER_H
 
 #include <atomic>
+#include <chrono>
+#include <boost/thread.hpp>
+#include <mutex>
+#include <condition_variable>
+
+// boolean_timer collects the metrics of the boolean phase: booleans done, busy and wait time.
+// The counters are kept per thread, in slots of their own cache line, and merged when read,
+// so the booleans and waits of many threads do not contend on shared counters.
+// While the booleans run, a reporter thread samples the counters at a fixed interval and
+// prints progress and the estimated time left, with the gauges of queued meshes and active workers.
 
 class boolean_timer {
 public:
    static boolean_timer& singleton()  { static boolean_timer instance; return instance;  }
 
    // call init before starting booleans, provide estimated number of booleans
+   // init also starts the wall clock of the boolean phase and the progress reporter
    void init(int nbool);
 
    // for operations like minkowski, number of booleans are not known until later
@@ -32,23 +43,69 @@ public:
    // measure time in each boolean and add elapsed seconds by calling add_elapsed
    void add_elapsed(double esec);
 
-   // return total elapsed in threads so far
+   // threads blocked waiting for other threads during booleans add the seconds waited by calling add_wait
+   void add_wait(double esec);
+
+   // number of booleans done since init, and the expected total
+   size_t nbool() const;
+   size_t nbool_total() const { return m_nbool_tot; }
+
+   // return total elapsed in threads so far, i.e. busy seconds summed over threads
    double thread_elapsed();
 
+   // seconds waited, summed over threads
+   double thread_wait();
+
+   // wall clock seconds since init
+   double wall_elapsed();
+
+   // parallel efficiency busy/(wall*nthreads), idle is the remainder not busy or waiting
+   double efficiency(size_t nthreads);
+   double thread_idle(size_t nthreads);
+
+   // stop the progress reporter, also done by report()
+   void stop();
+
+   // print busy, wait, idle and efficiency of the boolean phase, also as a --json_log event
+   void report(size_t nthreads);
+
+   // stops the progress reporter when the boolean phase is left, also by an exception
+   class reporter_scope {
+   public:
+      reporter_scope() {}
+      ~reporter_scope() { boolean_timer::singleton().stop(); }
+   };
+
 protected:
    boolean_timer();
    virtual ~boolean_timer();
 
-private:
+   // counters of the threads using one slot, normally one thread
+   struct alignas(64) slot {
+      slot() : busy_microsec(0), wait_microsec(0), nbool(0) {}
+      std::atomic<unsigned long long> busy_microsec;  // sum of elapsed times in booleans
+      std::atomic<unsigned long long> wait_microsec;  // sum of waiting times
+      std::atomic<unsigned long long> nbool;          // booleans processed
+   };
+
+   // the slot of the calling thread
+   slot& thread_slot();
+
+   // sample the metrics every interval until stopped
+   void reporter();
 
 private:
+   static const size_t nslots = 128;
+   slot                 m_slots[nslots];
+   std::atomic<size_t>  m_next_slot;      // slots are handed out round robin to new threads
+
+   std::atomic_uint     m_nbool_tot;      // total number of booleans
+   std::chrono::steady_clock::time_point m_wall_start; // set by init
 
-   // variables that are updated by threads
-   std::atomic_uint  m_nbool_tot;           // total number of booleans
-   std::atomic_uint  m_elapsed_millisec;    // total elapsed time added, actually sum of elapsed times in threads, not clock time
-   std::atomic_uint  m_nbool;               // number of booleans processed so far
-   std::atomic_uint  m_progress;            // A value from [0..1000] measuring progress, i.e. per thousand
-   std::atomic_uint  m_progress_report;     // progress value for previous report
+   boost::thread           m_reporter;
+   bool                    m_stop;        // protected by m_mutex
+   std::mutex              m_mutex;
+   std::condition_variable m_cv;
 };
 
 #endif // BOOLEAN_TIMER_H
@@ -21,6 +21,7 @@
 //#include <boost/token_functions.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/thread.hpp>
 
 #include <sstream>
 #include <numeric>
@@ -46,11 +47,34 @@ boost_command_line::boost_command_line(int argc , char **argv)
 , m_max_bool(std::numeric_limits<size_t>::max())
 , m_export_dir(false,"")
 , m_secant_tolerance(0.05)
+, m_threads(std::max(1u,boost::thread::hardware_concurrency()))
+, m_bool_order("size")
+, m_hull_engine("qhull")
+, m_partition_bool(1)
+, m_io_files(8)
+, m_backend("carve")
+, m_voxel(0.0)
+, m_snap(0.0)
+, m_bool_engine("carve")
+, m_timeout(0.0)
+, m_max_queue_mem(0.0)
+, m_max_triangles(0)
+, m_max_error(0.0)
+, m_checkpoint_interval(60.0)
+, m_worker_port(0)
+, m_stdout_format("")
+, m_cache_dir(false,"")
+, m_spill_dir(false,"")
+, m_dxf_precision(6)
+, m_svg_precision(6)
+, m_job_mem(0.0)
+, m_program((argc > 0)? argv[0] : "xcsg")
 {
    generic.add_options()
         ("help,h",  "Show this help message.")
         ("version,v",  "Show program version (numeric part).")
         ("amf",   "AMF output format (Additive Manufacturing Format)")
+        ("3mf",   "3MF output format (3D Manufacturing Format)")
         ("csg",   "CSG output format (OpenSCAD)")
         ("dxf",   "DXF output format (AutoCAD DXF - 2D only)")
         ("svg",   "SVG output format (Scalar Vector Graphics - 2D only)")
@@ -58,21 +82,76 @@ boost_command_line::boost_command_line(int argc , char **argv)
         ("astl",  "STL output format (STereoLitography) - ASCII")
         ("obj",   "OBJ output format (Wavefront format)")
         ("off",   "OFF output format (Geomview Object File Format)")
+        ("xmesh", "XMESH output format (binary lumps, for polyhedron 'file' input)")
+        ("glb",   "GLB output format (binary glTF, for web viewers)")
+        ("stdout", po::value<std::string>(), "Write one format to stdout: stl, astl, obj, off, xmesh or glb, messages go to stderr")
         ("export_dir", po::value<std::string>(), "Export output files to directory")
+        ("export_direct", "Write outputs directly into export_dir, renamed into place when complete")
+        ("dxf_precision", po::value<int>(),  "Number of decimals in DXF coordinates (6)")
+        ("svg_precision", po::value<int>(),  "Number of decimals in SVG coordinates (6)")
+        ("svg_relative", "Compact SVG path data using relative coordinates")
+        ("stl_mmap", "Write binary STL through a memory mapped file (not on Windows)")
+        ("amf_zip", "Write AMF as zip compressed archive")
+        ("glb_quantize", "Store GLB positions as 16 bit integers (KHR_mesh_quantization)")
+        ("props", "Write volume, area, centroid and bounding box per lump and in total, as .props.json")
+        ("compress", po::value<std::string>(), "Compress STL, OBJ and OFF files: 'gzip', written as .gz")
+        ("io_files", po::value<size_t>(), "Max number of per lump files written concurrently (8)")
         ("max_bool", po::value<size_t>(),  "Max number of booleans allowed")
         ("sec_tol", po::value<double>(),  "Secant tolerance when importing OpenSCAD csg (0.05)")
+        ("keep_xcsg", "Write the .xcsg file converted from OpenSCAD csg input")
+        ("bulk_read", "Parse large polyhedron and tin_model vertex/face blocks in parallel")
+        ("threads", po::value<size_t>(),  "Number of threads, 1 means sequential (all cores)")
+        ("pin_threads", "Pin worker threads to cpus, one NUMA node after the other")
+        ("no_simplify", "Evaluate the CSG tree as written, without simplifying it first")
+        ("lod", po::value<std::string>(), "Levels of detail from one parse, outputs per secant tolerance 0.5,0.1,.. named _lod0, _lod1,..")
+        ("preview", "Fast coarse result: secant tolerance scaled by object size, capped segment counts")
+        ("weld", "Merge near duplicate vertices of meshes before and after each boolean")
+        ("snap", po::value<double>(),  "Snap boolean results to a grid of given fraction of the mesh size, merging degenerate faces")
+        ("simplify", "Merge coplanar faces and eliminate short edges after each boolean")
+        ("no_instance", "Triangulate and write every lump in full, also lumps identical to another lump up to a translation")
+        ("split_lumps", "Run booleans only against the lumps of a multi-lump operand that overlap the other operand")
+        ("no_retry", "Do not retry failing booleans on welded, triangulated or perturbed operands")
+        ("bool_order", po::value<std::string>(),  "Boolean order: 'size' or 'spatial' (size)")
+        ("partition_bool", po::value<size_t>(),  "Split booleans of large operands into given number of slabs run in parallel (1)")
+        ("backend", po::value<std::string>(),  "Boolean backend: 'carve' (exact) or 'sdf' (voxel approximation for previews) (carve)")
+        ("voxel", po::value<double>(),  "Voxel size of the sdf backend and engine (1/256 of the model size)")
+        ("bool_engine", po::value<std::string>(),  "Mesh boolean engine: 'carve' or 'sdf' (carve)")
+        ("deterministic", "Reduce booleans in a fixed order, output is identical for any number of threads")
+        ("hull_engine", po::value<std::string>(),  "3d hull algorithm: 'qhull' or 'quickhull' (qhull)")
+        ("timeout", po::value<double>(),  "Stop processing after given number of seconds")
+        ("max_queue_mem", po::value<double>(),  "Throttle hull producers when queued meshes exceed given MB (no limit)")
+        ("spill_dir", po::value<std::string>(), "Out-of-core mode: spill queued meshes beyond max_queue_mem to files in directory")
+        ("max_triangles", po::value<size_t>(), "Decimate exported lumps to a total of at most given number of triangles")
+        ("max_error", po::value<double>(), "Decimate exported lumps while the surface error stays below given distance")
+        ("cache_dir", po::value<std::string>(), "Cache subtree meshes in directory between runs")
+        ("incremental", "Recompute only changed subtrees since previous run")
+        ("watch", "Rerun incrementally each time the input file changes, outputs replaced atomically")
+        ("checkpoint", "Save the boolean reductions to .checkpoint file, a rerun resumes from it")
+        ("checkpoint_interval", po::value<double>(), "Seconds between checkpoints (60)")
+        ("server", "Read jobs from stdin, one command line per job")
+        ("worker", po::value<int>(), "Mesh subtrees sent by a coordinator, listening on given TCP port")
+        ("workers", po::value<std::string>(), "Mesh the children of top level booleans on workers host:port,..")
+        ("batch", po::value<std::string>(), "Process input files listed in file, one per line")
+        ("job_mem", po::value<double>(), "Run batch and server jobs as concurrent processes within given MB and --threads, sized by their estimates")
+        ("query", po::value<std::string>(), "Answer inside, distance and ray queries listed in file against the result, as .query.txt")
+        ("estimate", "Estimate faces, boolean work and peak memory without booleans, as .estimate.json")
+        ("profile", "Report time, carve phases and mesh sizes per CSG node, also as .profile.json")
+        ("trace", po::value<std::string>(), "Write thread timeline to file (Chrome trace format)")
+        ("json_log", "Also write progress and phase timings to stdout as JSON lines")
+        ("mem_stats", "Report resident memory, heap peak and allocations per phase and per top CSG node")
+        ("microbench", po::value<std::string>(), "Time kernels on synthetic inputs, as xcsg_microbench.json (all, or boolean,hull,..)")
         ("fullpath", "Show full file paths.")
          ;
 
    hidden.add_options()
-        ("xcsg-file",   po::value<string>(),         "input file") ;
+        ("xcsg-file",   po::value<std::vector<string>>(), "input file(s)") ;
 
    allowed.add(generic).add(hidden);
 
    // Declare that input-file can be specified without the "--input-file" specifier
-   // declare that we require exactly 1 such parameter (-1 would mean unlimited number)
+   // declare that we accept any number of such parameters (batch mode)
    po::positional_options_description p;
-   p.add("xcsg-file", 1);
+   p.add("xcsg-file", -1);
 
    // Parse the command line catching and displaying any
    // parser errors
@@ -80,8 +159,16 @@ boost_command_line::boost_command_line(int argc , char **argv)
    size_t error_count=0;
 
    try {
-      po::store(po::command_line_parser( argc, argv).options(allowed).positional(p).run(), vm);
+      po::parsed_options parsed = po::command_line_parser( argc, argv).options(allowed).positional(p).run();
+      po::store(parsed, vm);
       po::notify(vm);
+
+      // the options of a job process, its input file and threads are given per job
+      for(auto& option : parsed.options) {
+         const std::string& key = option.string_key;
+         if(key=="xcsg-file" || key=="batch" || key=="threads" || key=="job_mem" || key=="server" || key=="trace") continue;
+         m_job_args.insert(m_job_args.end(),option.original_tokens.begin(),option.original_tokens.end());
+      }
    }
    catch (std::exception &e) {
 
@@ -101,13 +188,49 @@ boost_command_line::boost_command_line(int argc , char **argv)
       help_count++;
    }
 
+   // in server mode the input files and output formats are given per job
+   // a worker receives its subtrees from the coordinator
+   bool server = vm.count("server") > 0 || vm.count("worker") > 0;
+
+   // micro benchmarks use synthetic inputs only
+   bool microbench = vm.count("microbench") > 0;
+
+   // input files are given as arguments and/or listed in a batch file
+   if(vm.count("xcsg-file") > 0) {
+      m_xcsg_files = get<std::vector<std::string>>("xcsg-file");
+   }
+   if(vm.count("batch") > 0) {
+      std::string batch = get<std::string>("batch");
+      std::ifstream in(batch);
+      if(!in.is_open()) {
+         error_list.push_back("ERROR: 'batch' file could not be opened: " + batch);
+         error_count++;
+      }
+      std::string line;
+      while(std::getline(in,line)) {
+         // skip empty lines and comments
+         size_t ipos = line.find_first_not_of(" \t\r");
+         if(ipos == std::string::npos || line[ipos] == '#') continue;
+         size_t iend = line.find_last_not_of(" \t\r");
+         m_xcsg_files.push_back(line.substr(ipos,iend-ipos+1));
+      }
+   }
+
    // Check input file name
-   if(vm.count("xcsg-file") == 0){
+   if(m_xcsg_files.size() == 0){
       // no message here, it is handled below
-      error_count++;
+      if(!server && !microbench) error_count++;
    }
-   else {
-      boost::filesystem::path fullpath(get<std::string>("xcsg-file"));
+   for(auto& file : m_xcsg_files) {
+      // '-' reads the model from stdin
+      if(file == "-") {
+         if(m_xcsg_files.size() > 1 || server) {
+            error_list.push_back("ERROR: Input '-' (stdin) must be the only input file");
+            error_count++;
+         }
+         continue;
+      }
+      boost::filesystem::path fullpath(file);
       if(fullpath.extension() != ".xcsg" && fullpath.extension() != ".csg") {
          ostringstream sout;
          sout << "ERROR: Input file extension must be '.xcsg', file name was " << fullpath;
@@ -128,9 +251,63 @@ boost_command_line::boost_command_line(int argc , char **argv)
       }
    }
 
+   if(vm.count("export_direct") > 0 && vm.count("export_dir") == 0) {
+      error_list.push_back("ERROR: 'export_direct' requires 'export_dir'");
+      error_count++;
+   }
+
+   if(vm.count("watch") > 0) {
+      if(m_xcsg_files.size() != 1 || m_xcsg_files[0] == "-" || server) {
+         error_list.push_back("ERROR: 'watch' requires a single input file");
+         error_count++;
+      }
+      if(vm.count("stdout") > 0) {
+         error_list.push_back("ERROR: 'watch' cannot be combined with 'stdout'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("cache_dir") > 0) {
+      std::string dir = get<std::string>("cache_dir");
+      if(dir.length() > 0) m_cache_dir = std::make_pair(true,dir);
+      else {
+         error_list.push_back("ERROR: 'cache_dir' specified, but no directory provided");
+         error_count++;
+      }
+   }
+
+   if(vm.count("spill_dir") > 0) {
+      std::string dir = get<std::string>("spill_dir");
+      if(dir.length() > 0) m_spill_dir = std::make_pair(true,dir);
+      else {
+         error_list.push_back("ERROR: 'spill_dir' specified, but no directory provided");
+         error_count++;
+      }
+   }
+
+   if(vm.count("compress") > 0) {
+      std::string compress = get<std::string>("compress");
+      if(compress != "gzip") {
+         error_list.push_back("ERROR: 'compress' must be 'gzip', but was '" + compress + "'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("stdout") > 0) {
+      m_stdout_format = get<std::string>("stdout");
+      if(m_stdout_format != "stl" && m_stdout_format != "astl" && m_stdout_format != "obj" && m_stdout_format != "off" && m_stdout_format != "xmesh" && m_stdout_format != "glb") {
+         error_list.push_back("ERROR: 'stdout' must be 'stl', 'astl', 'obj', 'off', 'xmesh' or 'glb', but was '" + m_stdout_format + "'");
+         error_count++;
+      }
+      if(m_xcsg_files.size() > 1 || server) {
+         error_list.push_back("ERROR: 'stdout' requires a single input file");
+         error_count++;
+      }
+   }
+
    // check the output format specifiers
-   size_t out_count = vm.count("amf") + vm.count("csg") + vm.count("stl") + vm.count("astl") + vm.count("obj") + vm.count("off") + vm.count("dxf") + vm.count("svg");
-   if(out_count == 0  && vm.count("xcsg-file")>0) {
+   size_t out_count = vm.count("stdout") + vm.count("amf") + vm.count("3mf") + vm.count("csg") + vm.count("stl") + vm.count("astl") + vm.count("obj") + vm.count("off") + vm.count("xmesh") + vm.count("glb") + vm.count("dxf") + vm.count("svg");
+   if(out_count == 0  && m_xcsg_files.size()>0 && vm.count("estimate")==0 && vm.count("query")==0) {
 
       // input file name specified, but no output format(s)
       ostringstream sout;
@@ -140,7 +317,7 @@ boost_command_line::boost_command_line(int argc , char **argv)
    }
 
    // check combination of input file and output specifiers
-   if(vm.count("xcsg-file") == 0 && out_count>0 ) {
+   if(m_xcsg_files.size() == 0 && out_count>0 && !server) {
       error_list.push_back("ERROR: Output format(s) specified, but no input file name.");
       error_count++;
    }
@@ -153,9 +330,192 @@ boost_command_line::boost_command_line(int argc , char **argv)
       m_secant_tolerance = get<double>("sec_tol");
    }
 
+   if(vm.count("lod") > 0) {
+      std::istringstream in(get<std::string>("lod"));
+      std::string item;
+      while(std::getline(in,item,',')) {
+         double tol = 0.0;
+         std::istringstream value(item);
+         if(!(value >> tol) || tol <= 0.0) {
+            error_list.push_back("ERROR: 'lod' must be a comma separated list of positive secant tolerances, but contained '" + item + "'");
+            error_count++;
+            break;
+         }
+         m_lod.push_back(tol);
+      }
+      if(m_lod.empty()) {
+         error_list.push_back("ERROR: 'lod' requires at least one secant tolerance");
+         error_count++;
+      }
+      else if(vm.count("stdout") > 0 && m_lod.size() > 1) {
+         error_list.push_back("ERROR: 'lod' with several levels cannot be combined with --stdout");
+         error_count++;
+      }
+   }
+
+   if(vm.count("threads") > 0) {
+      m_threads = get<size_t>("threads");
+      if(m_threads == 0) {
+         error_list.push_back("ERROR: 'threads' must be 1 or larger");
+         error_count++;
+      }
+   }
+
+   if(vm.count("job_mem") > 0) {
+      m_job_mem = get<double>("job_mem");
+      if(m_job_mem <= 0.0) {
+         error_list.push_back("ERROR: 'job_mem' must be larger than 0");
+         error_count++;
+      }
+      if(vm.count("stdout") > 0 || vm.count("watch") > 0 || vm.count("worker") > 0) {
+         error_list.push_back("ERROR: 'job_mem' cannot be combined with --stdout, --watch or --worker");
+         error_count++;
+      }
+      for(auto& file : m_xcsg_files) {
+         if(file == "-") {
+            error_list.push_back("ERROR: 'job_mem' requires input files, not stdin");
+            error_count++;
+            break;
+         }
+      }
+   }
+
+   if(vm.count("bool_order") > 0) {
+      m_bool_order = get<std::string>("bool_order");
+      if(m_bool_order != "size" && m_bool_order != "spatial") {
+         error_list.push_back("ERROR: 'bool_order' must be 'size' or 'spatial', but was '" + m_bool_order + "'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("partition_bool") > 0) {
+      m_partition_bool = get<size_t>("partition_bool");
+      if(m_partition_bool == 0) {
+         error_list.push_back("ERROR: 'partition_bool' must be 1 or larger");
+         error_count++;
+      }
+   }
+
+   if(vm.count("io_files") > 0) {
+      m_io_files = get<size_t>("io_files");
+      if(m_io_files == 0) {
+         error_list.push_back("ERROR: 'io_files' must be 1 or larger");
+         error_count++;
+      }
+   }
+
+   if(vm.count("backend") > 0) {
+      m_backend = get<std::string>("backend");
+      if(m_backend != "carve" && m_backend != "sdf") {
+         error_list.push_back("ERROR: 'backend' must be 'carve' or 'sdf', but was '" + m_backend + "'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("bool_engine") > 0) {
+      m_bool_engine = get<std::string>("bool_engine");
+      if(m_bool_engine != "carve" && m_bool_engine != "sdf") {
+         error_list.push_back("ERROR: 'bool_engine' must be 'carve' or 'sdf', but was '" + m_bool_engine + "'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("voxel") > 0) {
+      m_voxel = get<double>("voxel");
+      if(m_voxel <= 0.0) {
+         error_list.push_back("ERROR: 'voxel' must be larger than 0");
+         error_count++;
+      }
+      else if(m_backend != "sdf" && m_bool_engine != "sdf") {
+         error_list.push_back("ERROR: 'voxel' requires --backend sdf or --bool_engine sdf");
+         error_count++;
+      }
+   }
+
+   if(vm.count("snap") > 0) {
+      m_snap = get<double>("snap");
+      if(m_snap <= 0.0 || m_snap >= 0.1) {
+         error_list.push_back("ERROR: 'snap' must be larger than 0 and smaller than 0.1");
+         error_count++;
+      }
+   }
+
+   if(vm.count("hull_engine") > 0) {
+      m_hull_engine = get<std::string>("hull_engine");
+      if(m_hull_engine != "qhull" && m_hull_engine != "quickhull") {
+         error_list.push_back("ERROR: 'hull_engine' must be 'qhull' or 'quickhull', but was '" + m_hull_engine + "'");
+         error_count++;
+      }
+   }
+
+   if(vm.count("dxf_precision") > 0) {
+      m_dxf_precision = get<int>("dxf_precision");
+      if(m_dxf_precision < 0 || m_dxf_precision > 15) {
+         error_list.push_back("ERROR: 'dxf_precision' must be in the range 0 to 15");
+         error_count++;
+      }
+   }
+
+   if(vm.count("svg_precision") > 0) {
+      m_svg_precision = get<int>("svg_precision");
+      if(m_svg_precision < 0 || m_svg_precision > 15) {
+         error_list.push_back("ERROR: 'svg_precision' must be in the range 0 to 15");
+         error_count++;
+      }
+   }
+
+   if(vm.count("timeout") > 0) {
+      m_timeout = get<double>("timeout");
+      if(m_timeout <= 0.0) {
+         error_list.push_back("ERROR: 'timeout' must be a positive number of seconds");
+         error_count++;
+      }
+   }
+
+   if(vm.count("max_queue_mem") > 0) {
+      m_max_queue_mem = get<double>("max_queue_mem");
+      if(m_max_queue_mem <= 0.0) {
+         error_list.push_back("ERROR: 'max_queue_mem' must be a positive number of MB");
+         error_count++;
+      }
+   }
+
+   if(vm.count("max_triangles") > 0) {
+      m_max_triangles = get<size_t>("max_triangles");
+      if(m_max_triangles == 0) {
+         error_list.push_back("ERROR: 'max_triangles' must be 1 or larger");
+         error_count++;
+      }
+   }
+
+   if(vm.count("max_error") > 0) {
+      m_max_error = get<double>("max_error");
+      if(m_max_error <= 0.0) {
+         error_list.push_back("ERROR: 'max_error' must be a positive distance");
+         error_count++;
+      }
+   }
+
+   if(vm.count("checkpoint_interval") > 0) {
+      m_checkpoint_interval = get<double>("checkpoint_interval");
+      if(m_checkpoint_interval <= 0.0) {
+         error_list.push_back("ERROR: 'checkpoint_interval' must be a positive number of seconds");
+         error_count++;
+      }
+   }
+
+   if(vm.count("worker") > 0) {
+      m_worker_port = get<int>("worker");
+      if(m_worker_port < 1 || m_worker_port > 65535) {
+         error_list.push_back("ERROR: 'worker' must be a TCP port in the range 1 to 65535");
+         error_count++;
+      }
+   }
+
    // some things are counted as errors without error message
    // this causes m_parse_ok to be false and the program stops
-   if(out_count == 0)  error_count++;
+   // queries are answered from the result in memory, no output format is needed
+   if(out_count == 0 && !server && vm.count("query")==0)  error_count++;
    if(help_count==0 && error_count>0) {
 
       // the user did not ask for help but still didn't provide good parameters,
@@ -183,7 +543,7 @@ void boost_command_line::show_version()
 void boost_command_line::show_help()
 {
    if(!m_help_shown) {
-      cout << generic << "  <xcsg-file>\t\tpath to input .xcsg file (required)" << endl << endl;
+      cout << generic << "  <xcsg-file>\t\tpath to input .xcsg file(s) (required), '-' reads from stdin" << endl << endl;
       m_help_shown = true;
    }
 }
@@ -19,6 +19,7 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <string>
+#include <vector>
 
 class boost_command_line {
 public:
@@ -40,8 +41,82 @@ public:
 
    double  secant_tolerance() { return m_secant_tolerance; }
 
+   // secant tolerances of the levels of detail, empty when the model tolerance is used
+   const std::vector<double>& lod() const { return m_lod; }
+
+   // number of threads to use, 1 means sequential (deterministic) processing
+   size_t threads() const { return m_threads; }
+
+   // order of boolean reduction, "size" or "spatial"
+   std::string bool_order() const { return m_bool_order; }
+
+   // number of parallel slabs for booleans of large operands, 1 means no partitioning
+   size_t partition_bool() const { return m_partition_bool; }
+
+   // max number of per lump output files written concurrently
+   size_t io_files() const { return m_io_files; }
+
+   // boolean backend, "carve" or "sdf"
+   std::string backend() const { return m_backend; }
+
+   // voxel size of the sdf backend and engine, 0 means derived from the model size
+   double voxel() const { return m_voxel; }
+
+   // snap grid of boolean results relative to the mesh size, 0 means no snapping
+   double snap() const { return m_snap; }
+
+   // engine of the mesh booleans, "carve" or "sdf"
+   std::string bool_engine() const { return m_bool_engine; }
+
+   // 3d hull algorithm, "qhull" or "quickhull"
+   std::string hull_engine() const { return m_hull_engine; }
+
+   // max run time in seconds, 0 means no limit
+   double timeout() const { return m_timeout; }
+
+   // memory budget for queued meshes in MB, 0 means no limit
+   double max_queue_mem() const { return m_max_queue_mem; }
+
+   // triangle budget of the exported model, 0 means no decimation
+   size_t max_triangles() const { return m_max_triangles; }
+
+   // max geometric error allowed by decimation, 0 means no decimation
+   double max_error() const { return m_max_error; }
+
+   // seconds between checkpoints of the boolean reductions
+   double checkpoint_interval() const { return m_checkpoint_interval; }
+
+   // TCP port of worker mode, 0 when not a worker
+   int worker_port() const { return m_worker_port; }
+
+   // format written to stdout ("stl", "astl", "obj", "off", "xmesh" or "glb"), empty when outputs are files
+   std::string stdout_format() const { return m_stdout_format; }
+
+   // directory for caching subtree meshes between runs
+   std::pair<bool,std::string> cache_dir() const { return m_cache_dir; }
+
+   // directory for spilling queued meshes in out-of-core mode
+   std::pair<bool,std::string> spill_dir() const { return m_spill_dir; }
+
    std::pair<bool,std::string> export_dir() { return m_export_dir; }
 
+   // number of decimals in DXF coordinates
+   int dxf_precision() const { return m_dxf_precision; }
+
+   // number of decimals in SVG path coordinates
+   int svg_precision() const { return m_svg_precision; }
+
+   // input files, from the command line and the batch file
+   const std::vector<std::string>& xcsg_files() const { return m_xcsg_files; }
+
+   // memory budget in MB of concurrent batch and server jobs, 0 means the jobs run one by one in this process
+   double job_mem() const { return m_job_mem; }
+
+   // the program path, and the options passed on to job processes: the command line
+   // without input files, --batch, --threads, --job_mem, --server and --trace
+   const std::string& program() const { return m_program; }
+   const std::vector<std::string>& job_args() const { return m_job_args; }
+
 private:
    boost::program_options::options_description generic;
    boost::program_options::options_description hidden;
@@ -52,7 +127,32 @@ private:
    bool  m_version_shown;
    size_t m_max_bool;
    double m_secant_tolerance;
+   std::vector<double> m_lod;
+   size_t m_threads;
+   std::string m_bool_order;
+   std::string m_hull_engine;
+   size_t m_partition_bool;
+   size_t m_io_files;
+   std::string m_backend;
+   double m_voxel;
+   double m_snap;
+   std::string m_bool_engine;
+   double m_timeout;
+   double m_max_queue_mem;
+   size_t m_max_triangles;
+   double m_max_error;
+   double m_checkpoint_interval;
+   int    m_worker_port;
+   std::string m_stdout_format;
+   std::pair<bool,std::string> m_cache_dir;
+   std::pair<bool,std::string> m_spill_dir;
    std::pair<bool,std::string> m_export_dir;
+   int                         m_dxf_precision;
+   int                         m_svg_precision;
+   std::vector<std::string>    m_xcsg_files;
+   double                      m_job_mem;
+   std::string                 m_program;
+   std::vector<std::string>    m_job_args;
 };
 
 #endif // BOOST_COMMAND_LINE_H
@@ -0,0 +1,336 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "box_boolean.h"
+#include <carve/input.hpp>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+
+// largest grid evaluated, larger expressions are left to the mesh booleans
+static const size_t max_cells = size_t(1) << 24;
+
+box_node::box_node(const double p1[3], const double p2[3])
+: op(BOX)
+, nincl(0)
+{
+   for(size_t i=0; i<3; i++) {
+      pmin[i] = std::min(p1[i],p2[i]);
+      pmax[i] = std::max(p1[i],p2[i]);
+   }
+}
+
+box_node::box_node(op_type op_)
+: op(op_)
+, nincl(0)
+{
+   for(size_t i=0; i<3; i++) pmin[i] = pmax[i] = 0.0;
+}
+
+std::shared_ptr<box_node> box_boolean::make_box(double dx, double dy, double dz, bool center, const carve::math::Matrix& t)
+{
+   // each column and each row of the linear part must have exactly one nonzero entry,
+   // carve matrices are stored by column, m[col][row]
+   double scale = 0.0;
+   for(size_t col=0; col<3; col++) {
+      for(size_t row=0; row<3; row++) scale = std::max(scale,std::fabs(t.m[col][row]));
+   }
+   const double tol = 1.0E-12*scale;
+   for(size_t i=0; i<3; i++) {
+      size_t ncol=0,nrow=0;
+      for(size_t j=0; j<3; j++) {
+         if(std::fabs(t.m[i][j]) > tol) ncol++;
+         if(std::fabs(t.m[j][i]) > tol) nrow++;
+      }
+      if(ncol != 1 || nrow != 1) return nullptr;
+   }
+
+   double s = (center)? -0.5 : 0.0;
+   carve::geom::vector<3> c1 = t*carve::geom::VECTOR(s*dx,s*dy,s*dz);
+   carve::geom::vector<3> c2 = t*carve::geom::VECTOR((s+1)*dx,(s+1)*dy,(s+1)*dz);
+   double p1[3] = { c1[0], c1[1], c1[2] };
+   double p2[3] = { c2[0], c2[1], c2[2] };
+   return std::make_shared<box_node>(p1,p2);
+}
+
+// the grid of an expression, cells are indexed i + n0*(j + n1*k)
+class box_grid {
+public:
+   box_grid(const box_node& tree)
+   : m_nbox(0)
+   {
+      collect(tree);
+      double extent = 0.0;
+      for(size_t d=0; d<3; d++) {
+         std::vector<double>& c = m_coord[d];
+         std::sort(c.begin(),c.end());
+         if(c.size() > 0) extent = std::max(extent,c.back()-c.front());
+      }
+      m_tol = 1.0E-9*std::max(1.0,extent);
+
+      // coordinates closer than the tolerance are one grid plane
+      for(size_t d=0; d<3; d++) {
+         std::vector<double>& c = m_coord[d];
+         std::vector<double> planes;
+         for(double v : c) {
+            if(planes.size()==0 || v-planes.back() > m_tol) planes.push_back(v);
+         }
+         c.swap(planes);
+         m_n[d] = (c.size() > 0)? c.size()-1 : 0;
+      }
+   }
+
+   size_t nbox() const { return m_nbox; }
+   size_t n(size_t d) const { return m_n[d]; }
+   size_t ncells() const { return m_n[0]*m_n[1]*m_n[2]; }
+   double coord(size_t d, size_t i) const { return m_coord[d][i]; }
+
+   size_t cell(size_t i, size_t j, size_t k) const { return i + m_n[0]*(j + m_n[1]*k); }
+
+   // cell occupancy of the expression
+   void evaluate(const box_node& node, std::vector<uint8_t>& occ) const
+   {
+      occ.assign(ncells(),0);
+      switch(node.op) {
+         case box_node::BOX: { fill(node,occ,1); break; }
+         case box_node::UNION: {
+            for(auto& child : node.children) combine(*child,occ,box_node::UNION);
+            break;
+         }
+         case box_node::INTERSECTION: {
+            if(node.children.size() == 0) break;
+            evaluate(*node.children[0],occ);
+            for(size_t i=1; i<node.children.size(); i++) combine(*node.children[i],occ,box_node::INTERSECTION);
+            break;
+         }
+         case box_node::DIFFERENCE: {
+            for(size_t i=0; i<node.children.size(); i++) {
+               combine(*node.children[i],occ,(i<node.nincl)? box_node::UNION : box_node::DIFFERENCE);
+            }
+            break;
+         }
+      };
+   }
+
+private:
+   void collect(const box_node& node)
+   {
+      if(node.op == box_node::BOX) {
+         m_nbox++;
+         for(size_t d=0; d<3; d++) {
+            m_coord[d].push_back(node.pmin[d]);
+            m_coord[d].push_back(node.pmax[d]);
+         }
+      }
+      for(auto& child : node.children) collect(*child);
+   }
+
+   // grid plane index of a box coordinate
+   size_t plane(size_t d, double v) const
+   {
+      const std::vector<double>& c = m_coord[d];
+      return std::lower_bound(c.begin(),c.end(),v-m_tol) - c.begin();
+   }
+
+   // set the cells inside a box to value
+   void fill(const box_node& box, std::vector<uint8_t>& occ, uint8_t value) const
+   {
+      size_t i0[3],i1[3];
+      for(size_t d=0; d<3; d++) {
+         i0[d] = plane(d,box.pmin[d]);
+         i1[d] = plane(d,box.pmax[d]);
+      }
+      for(size_t k=i0[2]; k<i1[2]; k++) {
+         for(size_t j=i0[1]; j<i1[1]; j++) {
+            size_t ic = cell(i0[0],j,k);
+            std::fill(occ.begin()+ic,occ.begin()+ic+(i1[0]-i0[0]),value);
+         }
+      }
+   }
+
+   // combine occ with the occupancy of node, box leaves are applied directly
+   void combine(const box_node& node, std::vector<uint8_t>& occ, box_node::op_type op) const
+   {
+      if(node.op == box_node::BOX && op != box_node::INTERSECTION) {
+         fill(node,occ,(op==box_node::UNION)? 1 : 0);
+         return;
+      }
+      std::vector<uint8_t> b;
+      evaluate(node,b);
+      const size_t nc = occ.size();
+      switch(op) {
+         case box_node::UNION:        { for(size_t i=0; i<nc; i++) occ[i] |= b[i];  break; }
+         case box_node::INTERSECTION: { for(size_t i=0; i<nc; i++) occ[i] &= b[i];  break; }
+         case box_node::DIFFERENCE:   { for(size_t i=0; i<nc; i++) if(b[i]) occ[i] = 0;  break; }
+         default: break;
+      };
+   }
+
+private:
+   size_t              m_nbox;
+   double              m_tol;
+   std::vector<double> m_coord[3];  // grid planes per axis
+   size_t              m_n[3];      // cells per axis
+};
+
+// a merged boundary rectangle in the grid plane p normal to axis d, spanning [a0,a1]x[b0,b1]
+// along the axes a=(d+1)%3 and b=(d+2)%3. The face normal is +d when positive
+struct box_face {
+   size_t d,p,a0,a1,b0,b1;
+   bool   positive;
+};
+
+std::shared_ptr<carve::mesh::MeshSet<3>> box_boolean::create_mesh(const box_node& tree)
+{
+   box_grid grid(tree);
+   if(grid.nbox() < 2 || grid.ncells() == 0 || grid.ncells() > max_cells) return nullptr;
+
+   std::vector<uint8_t> occ;
+   grid.evaluate(tree,occ);
+
+   // boundary faces of each grid plane, merged greedily into rectangles
+   std::vector<box_face> faces;
+   for(size_t d=0; d<3; d++) {
+      const size_t a = (d+1)%3, b = (d+2)%3;
+      const size_t na = grid.n(a), nb = grid.n(b);
+      std::vector<int8_t> mask(na*nb);
+      for(size_t p=0; p<=grid.n(d); p++) {
+         size_t ijk[3];
+         ijk[d] = p;
+         for(size_t ib=0; ib<nb; ib++) {
+            for(size_t ia=0; ia<na; ia++) {
+               ijk[a] = ia; ijk[b] = ib;
+               bool above = false, below = false;
+               if(p < grid.n(d)) above = occ[grid.cell(ijk[0],ijk[1],ijk[2])] != 0;
+               if(p > 0) {
+                  ijk[d] = p-1;
+                  below = occ[grid.cell(ijk[0],ijk[1],ijk[2])] != 0;
+                  ijk[d] = p;
+               }
+               mask[ia + na*ib] = (below==above)? 0 : ((below)? 1 : -1);
+            }
+         }
+
+         for(size_t ib=0; ib<nb; ib++) {
+            for(size_t ia=0; ia<na; ) {
+               int8_t v = mask[ia + na*ib];
+               if(v == 0) { ia++; continue; }
+
+               size_t ia1 = ia+1;
+               while(ia1<na && mask[ia1 + na*ib]==v) ia1++;
+
+               size_t ib1 = ib+1;
+               for(; ib1<nb; ib1++) {
+                  size_t ja = ia;
+                  while(ja<ia1 && mask[ja + na*ib1]==v) ja++;
+                  if(ja < ia1) break;
+               }
+               for(size_t jb=ib; jb<ib1; jb++) {
+                  std::fill(mask.begin()+ia+na*jb,mask.begin()+ia1+na*jb,int8_t(0));
+               }
+               box_face face = { d, p, ia, ia1, ib, ib1, v > 0 };
+               faces.push_back(face);
+               ia = ia1;
+            }
+         }
+      }
+   }
+   if(faces.size() == 0) return nullptr;
+
+   // grid points are keyed i + (n0+1)*(j + (n1+1)*k)
+   const uint64_t n0 = grid.n(0)+1, n1 = grid.n(1)+1;
+   auto point_key = [n0,n1](const size_t ijk[3]) { return uint64_t(ijk[0]) + n0*(uint64_t(ijk[1]) + n1*uint64_t(ijk[2])); };
+
+   // rectangle corners on each axis-parallel grid line. A corner lying inside the edge of a neighbour
+   // rectangle is inserted into that edge, so the merged faces share all their vertices
+   std::unordered_map<uint64_t,std::vector<size_t>> lines[3];
+   for(auto& f : faces) {
+      const size_t a = (f.d+1)%3, b = (f.d+2)%3;
+      size_t ca[2] = { f.a0, f.a1 }, cb[2] = { f.b0, f.b1 };
+      for(size_t ia=0; ia<2; ia++) {
+         for(size_t ib=0; ib<2; ib++) {
+            size_t ijk[3];
+            ijk[f.d] = f.p; ijk[a] = ca[ia]; ijk[b] = cb[ib];
+            for(size_t l=0; l<3; l++) {
+               size_t pos = ijk[l];
+               ijk[l] = 0;
+               lines[l][point_key(ijk)].push_back(pos);
+               ijk[l] = pos;
+            }
+         }
+      }
+   }
+   for(size_t l=0; l<3; l++) {
+      for(auto& line : lines[l]) {
+         std::vector<size_t>& pos = line.second;
+         std::sort(pos.begin(),pos.end());
+         pos.erase(std::unique(pos.begin(),pos.end()),pos.end());
+      }
+   }
+
+   carve::input::PolyhedronData data;
+   std::unordered_map<uint64_t,int> vertex_index;
+   auto vertex = [&](const size_t ijk[3]) {
+      uint64_t key = point_key(ijk);
+      auto i = vertex_index.find(key);
+      if(i != vertex_index.end()) return i->second;
+      int iv = static_cast<int>(data.points.size());
+      data.points.push_back(carve::geom::VECTOR(grid.coord(0,ijk[0]),grid.coord(1,ijk[1]),grid.coord(2,ijk[2])));
+      vertex_index[key] = iv;
+      return iv;
+   };
+
+   std::vector<int> polygon;
+   for(auto& f : faces) {
+      const size_t a = (f.d+1)%3, b = (f.d+2)%3;
+
+      // corners counterclockwise around +d
+      const size_t corner[4][2] = { {f.a0,f.b0}, {f.a1,f.b0}, {f.a1,f.b1}, {f.a0,f.b1} };
+      polygon.clear();
+      for(size_t ic=0; ic<4; ic++) {
+         size_t ijk[3];
+         ijk[f.d] = f.p; ijk[a] = corner[ic][0]; ijk[b] = corner[ic][1];
+         polygon.push_back(vertex(ijk));
+
+         // the edge to the next corner runs along a for even ic, along b for odd ic
+         const size_t l     = (ic%2==0)? a : b;
+         const size_t from  = ijk[l];
+         const size_t to    = corner[(ic+1)%4][(ic%2==0)? 0 : 1];
+         ijk[l] = 0;
+         const std::vector<size_t>& pos = lines[l][point_key(ijk)];
+         if(from < to) {
+            for(auto i=std::upper_bound(pos.begin(),pos.end(),from); i!=pos.end() && *i<to; i++) {
+               ijk[l] = *i;
+               polygon.push_back(vertex(ijk));
+            }
+         }
+         else {
+            auto i = std::lower_bound(pos.begin(),pos.end(),from);
+            while(i != pos.begin() && *(--i) > to) {
+               ijk[l] = *i;
+               polygon.push_back(vertex(ijk));
+            }
+         }
+      }
+      if(!f.positive) std::reverse(polygon.begin(),polygon.end());
+
+      data.faceIndices.push_back(static_cast<int>(polygon.size()));
+      data.faceIndices.insert(data.faceIndices.end(),polygon.begin(),polygon.end());
+   }
+   data.faceCount = static_cast<int>(faces.size());
+
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(carve::input::Options()));
+}
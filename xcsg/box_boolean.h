@@ -0,0 +1,55 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BOX_BOOLEAN_H
+#define BOX_BOOLEAN_H
+
+#include <memory>
+#include <vector>
+#include <carve/matrix.hpp>
+#include <carve/mesh.hpp>
+
+// box_node is a CSG expression of axis-aligned boxes, see xsolid::box_expression
+struct box_node {
+   enum op_type { BOX, UNION, INTERSECTION, DIFFERENCE };
+
+   // a box leaf spanning the corners p1 and p2
+   box_node(const double p1[3], const double p2[3]);
+
+   // a boolean of the children. For DIFFERENCE the first nincl children are included, the rest excluded
+   box_node(op_type op);
+
+   op_type                                 op;
+   double                                  pmin[3];
+   double                                  pmax[3];
+   std::vector<std::shared_ptr<box_node>>  children;
+   size_t                                  nincl;
+};
+
+// box_boolean evaluates a box_node expression exactly on the rectilinear grid of all box coordinates.
+// Each grid cell is either inside or outside, and the boundary between them is emitted with
+// coplanar cell faces merged into rectangles, so the cost does not grow with the number of booleans
+
+class box_boolean {
+public:
+   // a box of size dx,dy,dz placed by t, in the 1st octant or centred. nullptr unless t maps the box to an axis-aligned box
+   static std::shared_ptr<box_node> make_box(double dx, double dy, double dz, bool center, const carve::math::Matrix& t);
+
+   // the mesh of the expression, nullptr when the expression has fewer than 2 boxes,
+   // is empty or would need a larger grid than the engine handles
+   static std::shared_ptr<carve::mesh::MeshSet<3>> create_mesh(const box_node& tree);
+};
+
+#endif // BOX_BOOLEAN_H
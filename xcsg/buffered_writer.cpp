@@ -0,0 +1,278 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "buffered_writer.h"
+#include "zip_writer.h"
+#include "gzip_writer.h"
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+// powers of 10 that can be represented exactly in long long
+static const long long pow10_table[] = {
+   1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+   1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+   100000000000000LL, 1000000000000000LL
+};
+static const int max_precision = 15;
+
+// powers of 10 that can be represented exactly in unsigned long long, for the general format
+static const unsigned long long upow10_table[] = {
+   1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+   1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+   100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+   1000000000000000000ULL
+};
+static const int max_general_decimals = 18;
+static const int max_significant      = 17;
+
+buffered_writer::buffered_writer(int precision, size_t capacity)
+: m_zip(nullptr)
+, m_gzip(nullptr)
+, m_stream(nullptr)
+, m_capacity(capacity)
+, m_precision(6)
+{
+   set_precision(precision);
+   m_buffer.reserve(m_capacity + 256);
+}
+
+buffered_writer::~buffered_writer()
+{
+   close();
+}
+
+bool buffered_writer::open(const std::string& path)
+{
+   m_buffer.clear();
+   m_out.open(path,std::ios::binary);
+   return m_out.is_open();
+}
+
+bool buffered_writer::open(zip_writer& zip, const std::string& entry_name)
+{
+   m_buffer.clear();
+   if(!zip.is_open()) return false;
+   zip.begin_entry(entry_name);
+   m_zip = &zip;
+   return true;
+}
+
+bool buffered_writer::open(gzip_writer& gzip)
+{
+   m_buffer.clear();
+   if(!gzip.is_open()) return false;
+   m_gzip = &gzip;
+   return true;
+}
+
+bool buffered_writer::open(std::ostream& out)
+{
+   m_buffer.clear();
+   if(!out.good()) return false;
+   m_stream = &out;
+   return true;
+}
+
+void buffered_writer::close()
+{
+   if(m_out.is_open()) {
+      flush();
+      m_out.close();
+   }
+   else if(m_zip) {
+      flush();
+      m_zip->end_entry();
+      m_zip = nullptr;
+   }
+   else if(m_gzip) {
+      flush();
+      m_gzip = nullptr;
+   }
+   else if(m_stream) {
+      flush();
+      m_stream->flush();
+      m_stream = nullptr;
+   }
+}
+
+void buffered_writer::set_precision(int precision)
+{
+   m_precision = std::max(0,std::min(precision,max_precision));
+}
+
+void buffered_writer::flush()
+{
+   if(m_buffer.size() > 0) {
+      if(m_zip)         m_zip->write(m_buffer);
+      else if(m_gzip)   m_gzip->write(m_buffer);
+      else if(m_stream) m_stream->write(m_buffer.data(),m_buffer.size());
+      else              m_out.write(m_buffer.data(),m_buffer.size());
+      m_buffer.clear();
+   }
+}
+
+void buffered_writer::flush_if_full()
+{
+   if(m_buffer.size() >= m_capacity) flush();
+}
+
+buffered_writer& buffered_writer::operator<<(const std::string& value)
+{
+   m_buffer += value;
+   flush_if_full();
+   return *this;
+}
+
+buffered_writer& buffered_writer::operator<<(const char* value)
+{
+   m_buffer += value;
+   flush_if_full();
+   return *this;
+}
+
+buffered_writer& buffered_writer::operator<<(char value)
+{
+   m_buffer += value;
+   flush_if_full();
+   return *this;
+}
+
+buffered_writer& buffered_writer::operator<<(int value)
+{
+   return operator<<(static_cast<long long>(value));
+}
+
+buffered_writer& buffered_writer::operator<<(size_t value)
+{
+   append(m_buffer,value);
+   flush_if_full();
+   return *this;
+}
+
+void buffered_writer::append(std::string& buffer, size_t value)
+{
+   char digits[24];
+   int n = 0;
+   do { digits[n++] = char('0' + value%10); value /= 10; } while(value > 0);
+   while(n > 0) buffer += digits[--n];
+}
+
+buffered_writer& buffered_writer::operator<<(long long value)
+{
+   if(value < 0) {
+      m_buffer += '-';
+      // negate in unsigned to handle the most negative value
+      return operator<<(static_cast<size_t>(0ULL - static_cast<unsigned long long>(value)));
+   }
+   return operator<<(static_cast<size_t>(value));
+}
+
+buffered_writer& buffered_writer::operator<<(double value)
+{
+   append(m_buffer,value,m_precision);
+   flush_if_full();
+   return *this;
+}
+
+void buffered_writer::append(std::string& buffer, double value, int precision)
+{
+   precision = std::max(0,std::min(precision,max_precision));
+   const long long scale = pow10_table[precision];
+   double scaled = std::fabs(value)*scale;
+
+   // values that do not fit the integer formatting are printed the slow way
+   if(!(scaled < 9.0e18)) {
+      char tmp[64];
+      int n = std::snprintf(tmp,sizeof(tmp),"%.*g",17,value);
+      buffer.append(tmp,n);
+      return;
+   }
+
+   unsigned long long ival  = static_cast<unsigned long long>(std::llround(scaled));
+   unsigned long long ipart = ival / scale;
+   unsigned long long fpart = ival % scale;
+
+   if(value < 0.0 && ival > 0) buffer += '-';
+
+   char digits[24];
+   int n = 0;
+   do { digits[n++] = char('0' + ipart%10); ipart /= 10; } while(ipart > 0);
+   while(n > 0) buffer += digits[--n];
+
+   if(fpart > 0) {
+      // trailing zeros are not written
+      int ndec = precision;
+      while(fpart%10 == 0) { fpart /= 10; ndec--; }
+      buffer += '.';
+      n = 0;
+      for(int i=0; i<ndec; i++) { digits[n++] = char('0' + fpart%10); fpart /= 10; }
+      while(n > 0) buffer += digits[--n];
+   }
+}
+
+void buffered_writer::append_general(std::string& buffer, double value, int significant)
+{
+   significant = std::max(1,std::min(significant,max_significant));
+   double a = std::fabs(value);
+
+   // decimal exponent and number of decimals giving the requested significant digits.
+   // Zero, non-finite values and values printed in exponent format take the slow way
+   int e    = (a > 0.0 && std::isfinite(a))? static_cast<int>(std::floor(std::log10(a))) : 0;
+   int ndec = significant-1-e;
+   if(!(a > 0.0) || !std::isfinite(a) || e < -4 || e >= significant || ndec > max_general_decimals) {
+      char tmp[64];
+      int n = std::snprintf(tmp,sizeof(tmp),"%.*g",significant,value);
+      buffer.append(tmp,n);
+      return;
+   }
+
+   // scale to an integer with the requested significant digits, rounded to nearest, ties to even
+   // as printf. Values too close to a tie to decide with the precision of long double take the
+   // slow way, so the output is always the same as printf
+   long double scaled = static_cast<long double>(a)*upow10_table[ndec];
+   if(scaled >= upow10_table[significant] && ndec > 0) {
+      // log10 underestimated the exponent, there is one digit too many
+      ndec--;
+      scaled = static_cast<long double>(a)*upow10_table[ndec];
+   }
+   long double frac = scaled - std::floor(scaled);
+   if(std::fabs(frac-0.5L) <= 4*scaled*std::numeric_limits<long double>::epsilon()) {
+      char tmp[64];
+      int n = std::snprintf(tmp,sizeof(tmp),"%.*g",significant,value);
+      buffer.append(tmp,n);
+      return;
+   }
+   unsigned long long ival = static_cast<unsigned long long>(std::llrint(scaled));
+   unsigned long long scale = upow10_table[ndec];
+   unsigned long long ipart = ival / scale;
+   unsigned long long fpart = ival % scale;
+
+   if(value < 0.0) buffer += '-';
+
+   char digits[24];
+   int n = 0;
+   do { digits[n++] = char('0' + ipart%10); ipart /= 10; } while(ipart > 0);
+   while(n > 0) buffer += digits[--n];
+
+   if(fpart > 0) {
+      // trailing zeros are not written
+      while(fpart%10 == 0) { fpart /= 10; ndec--; }
+      buffer += '.';
+      n = 0;
+      for(int i=0; i<ndec; i++) { digits[n++] = char('0' + fpart%10); fpart /= 10; }
+      while(n > 0) buffer += digits[--n];
+   }
+}
@@ -0,0 +1,124 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include "thread_pool.h"
+class zip_writer;
+class gzip_writer;
+
+// buffered_writer is an output file stream replacement for large text exports.
+// Output is collected in a large buffer written to file in big blocks, and
+// floating point values are printed in fixed format with a given number of decimals,
+// trailing zeros removed, without going through iostream formatting.
+// The static append functions format into a string, so that parts of a file can be
+// formatted in parallel and written in order.
+
+class buffered_writer {
+public:
+   buffered_writer(int precision = 6, size_t capacity = 1<<20);
+   virtual ~buffered_writer();
+
+   // open file for writing, returns true if ok
+   bool open(const std::string& path);
+
+   // write into a new entry of an open zip archive instead of a file
+   bool open(zip_writer& zip, const std::string& entry_name);
+
+   // write through an open gzip file, it is not closed by close()
+   bool open(gzip_writer& gzip);
+
+   // write to a stream owned by the caller, it is flushed but not closed by close()
+   bool open(std::ostream& out);
+   bool is_open() const { return m_out.is_open() || m_zip || m_gzip || m_stream; }
+
+   // flush remaining buffer and close the file, zip entry, gzip or stream
+   void close();
+
+   // number of decimals used for floating point values
+   void set_precision(int precision);
+   int  precision() const { return m_precision; }
+
+   buffered_writer& operator<<(const std::string& value);
+   buffered_writer& operator<<(const char* value);
+   buffered_writer& operator<<(char value);
+   buffered_writer& operator<<(int value);
+   buffered_writer& operator<<(long long value);
+   buffered_writer& operator<<(size_t value);
+   buffered_writer& operator<<(double value);
+
+   // format items [0,n) with format(i,text) in parallel chunks and write the text in order.
+   // A batch of chunks is formatted at a time, so the memory used is bounded
+   template <typename Format>
+   void write_chunked(size_t n, const Format& format);
+
+   // append a double value to a string, using fixed format with given number of decimals
+   static void append(std::string& buffer, double value, int precision);
+
+   // append a double value to a string in general format with given number of significant digits,
+   // the same text as iostream default formatting with std::setprecision(significant) or printf "%.*g"
+   static void append_general(std::string& buffer, double value, int significant);
+
+   // append an unsigned integer value to a string
+   static void append(std::string& buffer, size_t value);
+
+protected:
+   void flush_if_full();
+   void flush();
+
+private:
+   std::ofstream m_out;
+   zip_writer*   m_zip;
+   gzip_writer*  m_gzip;
+   std::ostream* m_stream;
+   std::string   m_buffer;
+   size_t        m_capacity;
+   int           m_precision;
+};
+
+template <typename Format>
+void buffered_writer::write_chunked(size_t n, const Format& format)
+{
+   const size_t chunk_items = 1<<14;
+   const size_t nbatch      = 2*thread_pool::singleton().nthreads();
+   std::vector<std::string> texts(nbatch);
+   for(size_t ibatch=0; ibatch<n; ibatch += nbatch*chunk_items) {
+      const size_t nchunk = std::min(nbatch,(n-ibatch+chunk_items-1)/chunk_items);
+      auto format_chunk = [&texts,&format,ibatch,n,chunk_items](size_t ichunk) {
+         std::string& text = texts[ichunk];
+         text.clear();
+         size_t ifirst = ibatch + ichunk*chunk_items;
+         size_t ilast  = std::min(n,ifirst+chunk_items);
+         for(size_t i=ifirst; i<ilast; i++) format(i,text);
+      };
+      if(nchunk <= 1) {
+         format_chunk(0);
+      }
+      else {
+         task_group tasks;
+         for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+            tasks.run([&format_chunk,ichunk]() { format_chunk(ichunk); });
+         }
+         tasks.wait();
+      }
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) *this << texts[ichunk];
+   }
+}
+
+#endif // BUFFERED_WRITER_H
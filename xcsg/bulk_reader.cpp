@@ -0,0 +1,414 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "bulk_reader.h"
+#include "thread_pool.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <climits>
+#include <fstream>
+#include <cctype>
+#include <ctime>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include "mesh_binary.h"
+#include "mapped_file.h"
+
+// raw blocks smaller than this are parsed as ordinary xml
+static const size_t min_raw_bytes   = 1<<16;
+
+// bytes of text per parsing task
+static const size_t min_chunk_bytes = 1<<20;
+
+cf_xmlReader::raw_blocks bulk_reader::raw_blocks()
+{
+   cf_xmlReader::raw_blocks raw;
+   raw.elements["vertices"] = { "polyhedron", "tin_model" };
+   raw.elements["faces"]    = { "polyhedron" };
+   raw.min_bytes = min_raw_bytes;
+   return raw;
+}
+
+static inline bool is_space(char c)
+{
+   return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+static inline const char* skip_space(const char* p, const char* last)
+{
+   while(p<last && is_space(*p)) p++;
+   return p;
+}
+
+// match "<tag" followed by a character that cannot be part of the name, advance past it
+static bool start_tag(const char*& p, const char* last, const char* tag, size_t len)
+{
+   if(size_t(last-p) < len+2 || *p!='<' || strncmp(p+1,tag,len)!=0) return false;
+   char c = p[len+1];
+   if(!is_space(c) && c!='/' && c!='>') return false;
+   p += len+1;
+   return true;
+}
+
+// match "</tag>", advance past it
+static bool end_tag(const char*& p, const char* last, const char* tag, size_t len)
+{
+   if(size_t(last-p) < len+2 || p[0]!='<' || p[1]!='/' || strncmp(p+2,tag,len)!=0) return false;
+   const char* q = skip_space(p+len+2,last);
+   if(q==last || *q!='>') return false;
+   p = q+1;
+   return true;
+}
+
+// parse the attributes of a start tag up to and including "/>" or ">".
+// value(name,len,text) is called for each attribute and returns false if the attribute is not accepted.
+// Returns 1 for an empty element, 2 for an element with content and 0 if not understood
+template <typename Value>
+static int attributes(const char*& p, const char* last, Value value)
+{
+   while(true) {
+      p = skip_space(p,last);
+      if(p == last) return 0;
+      if(*p == '/') {
+         if(p+1==last || p[1]!='>') return 0;
+         p += 2;
+         return 1;
+      }
+      if(*p == '>') {
+         p++;
+         return 2;
+      }
+      const char* name = p;
+      while(p<last && !is_space(*p) && *p!='=' && *p!='/' && *p!='>') p++;
+      const size_t len = p-name;
+      p = skip_space(p,last);
+      if(p==last || *p!='=') return 0;
+      p = skip_space(p+1,last);
+      if(p==last || (*p!='"' && *p!='\'')) return 0;
+      const char* end = static_cast<const char*>(memchr(p+1,*p,last-p-1));
+      if(!end) return 0;
+      if(!value(name,len,p+1,end)) return 0;
+      p = end+1;
+   }
+}
+
+// the whole attribute text except surrounding whitespace is a number
+static bool to_double(const char* text, const char* end, double& value)
+{
+   char* e = 0;
+   value = strtod(text,&e);
+   return e!=text && skip_space(e,end)==end;
+}
+
+static bool to_int(const char* text, const char* end, int& value)
+{
+   char* e = 0;
+   long v = strtol(text,&e,10);
+   if(v<INT_MIN || v>INT_MAX) return false;
+   value = static_cast<int>(v);
+   return e!=text && skip_space(e,end)==end;
+}
+
+// parse <vertex x=".." y=".." z=".."/> elements in [p,last)
+static bool parse_vertices(const char* p, const char* last, std::vector<xvertex>& vertices)
+{
+   while(true) {
+      p = skip_space(p,last);
+      if(p == last) return true;
+      if(!start_tag(p,last,"vertex",6)) return false;
+
+      // as for the xml node, missing coordinates are zero and the first of repeated attributes counts
+      double xyz[3] = { 0.0, 0.0, 0.0 };
+      bool   seen[3] = { false, false, false };
+      int content = attributes(p,last,[&xyz,&seen](const char* name, size_t len, const char* text, const char* end) {
+         if(len!=1 || name[0]<'x' || name[0]>'z') return true;
+         int i = name[0]-'x';
+         if(seen[i]) return true;
+         seen[i] = true;
+         return to_double(text,end,xyz[i]);
+      });
+      if(content == 0) return false;
+      if(content == 2) {
+         p = skip_space(p,last);
+         if(!end_tag(p,last,"vertex",6)) return false;
+      }
+      vertices.push_back(carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]));
+   }
+}
+
+// parse <face><fv index=".."/>...</face> elements in [p,last)
+static bool parse_faces(const char* p, const char* last, std::vector<xface>& faces)
+{
+   std::vector<size_t> indices;
+   auto any_attribute = [](const char*, size_t, const char*, const char*) { return true; };
+   while(true) {
+      p = skip_space(p,last);
+      if(p == last) return true;
+      if(!start_tag(p,last,"face",4)) return false;
+
+      indices.clear();
+      int content = attributes(p,last,any_attribute);
+      if(content == 0) return false;
+      while(content == 2) {
+         p = skip_space(p,last);
+         if(end_tag(p,last,"face",4)) break;
+         if(!start_tag(p,last,"fv",2)) return false;
+
+         int  index = -1;
+         bool seen  = false;
+         int fv_content = attributes(p,last,[&index,&seen](const char* name, size_t len, const char* text, const char* end) {
+            if(len!=5 || strncmp(name,"index",5)!=0 || seen) return true;
+            seen = true;
+            return to_int(text,end,index);
+         });
+         if(fv_content == 0) return false;
+         if(fv_content == 2) {
+            p = skip_space(p,last);
+            if(!end_tag(p,last,"fv",2)) return false;
+         }
+         indices.push_back(static_cast<size_t>(index));
+      }
+      faces.push_back(xface(indices));
+   }
+}
+
+// parse text in parallel chunks starting at "<tag", returns false if any chunk is not understood
+template <typename Item, typename Parse>
+static bool parse_chunks(const std::string& text, const char* tag, std::vector<Item>& items, Parse parse)
+{
+   const char* first = text.data();
+   const char* last  = first + text.size();
+
+   // comments, CDATA and entities are left to the xml parser
+   if(std::find(first,last,'&') != last) return false;
+   const char markup[] = "<!";
+   if(std::search(first,last,markup,markup+2) != last) return false;
+
+   thread_pool& pool = thread_pool::singleton();
+   const size_t nchunk = std::max(size_t(1),std::min(4*pool.nthreads(),text.size()/min_chunk_bytes));
+
+   // chunk boundaries at element start tags
+   const std::string start = std::string("<") + tag;
+   std::vector<const char*> bounds(1,first);
+   for(size_t ichunk=1; ichunk<nchunk; ichunk++) {
+      const char* p = std::max(bounds.back()+1,first + text.size()*ichunk/nchunk);
+      if(p >= last) break;
+      p = std::search(p,last,start.begin(),start.end());
+      if(p == last) break;
+      bounds.push_back(p);
+   }
+   bounds.push_back(last);
+
+   const size_t nparts = bounds.size()-1;
+   std::vector<std::vector<Item>> parts(nparts);
+   std::vector<char> ok(nparts,0);
+   if(nparts == 1 || pool.nthreads() <= 1) {
+      for(size_t ipart=0; ipart<nparts; ipart++) ok[ipart] = parse(bounds[ipart],bounds[ipart+1],parts[ipart]);
+   }
+   else {
+      task_group tasks;
+      for(size_t ipart=0; ipart<nparts; ipart++) {
+         tasks.run([&bounds,&parts,&ok,&parse,ipart]() { ok[ipart] = parse(bounds[ipart],bounds[ipart+1],parts[ipart]); });
+      }
+      tasks.wait();
+   }
+   if(std::find(ok.begin(),ok.end(),0) != ok.end()) return false;
+
+   size_t nitems = 0;
+   for(auto& part : parts) nitems += part.size();
+   items.reserve(items.size()+nitems);
+   for(auto& part : parts) {
+      std::move(part.begin(),part.end(),std::back_inserter(items));
+   }
+   return true;
+}
+
+// return the raw text of a block, or null if the block was parsed as xml
+static const std::string* raw_text(const cf_xmlNode& node)
+{
+   for(auto i=node.begin(); i!=node.end(); i++) {
+      if(i->first == "<xmlraw>") return &i->second.data();
+   }
+   return 0;
+}
+
+// parse a raw block as ordinary xml and read it from the resulting node
+template <typename Item, typename Read>
+static void read_parsed(const cf_xmlNode& node, const std::string& text, std::vector<Item>& items, Read read)
+{
+   cf_xmlReader::ptree doc;
+   cf_xmlReader::ptree& block = doc.push_back(cf_xmlReader::ptree::value_type(node.tag(),cf_xmlReader::ptree()))->second;
+   cf_xmlReader::parse(text.data(),text.data()+text.size(),block);
+   cf_xmlNode parsed(doc.begin());
+   read(parsed,items);
+}
+
+void bulk_reader::read_vertices(const cf_xmlNode& node, const std::string& owner, std::vector<xvertex>& vertices)
+{
+   vertices.clear();
+   auto read = [&owner](const cf_xmlNode& const_block, std::vector<xvertex>& v) {
+      cf_xmlNode block = const_block;
+      for(auto iv=block.begin(); iv!=block.end(); iv++) {
+         cf_xmlNode vertex(iv);
+         if("vertex" == vertex.tag()) {
+            v.push_back(carve::geom::VECTOR( vertex.get_property("x",0.0),
+                                             vertex.get_property("y",0.0),
+                                             vertex.get_property("z",0.0)));
+         }
+         else {
+            throw std::logic_error(owner + ": expected tag 'vertex' but found " + vertex.tag());
+         }
+      }
+   };
+
+   if(const std::string* text = raw_text(node)) {
+      if(!parse_chunks(*text,"vertex",vertices,parse_vertices)) {
+         vertices.clear();
+         read_parsed(node,*text,vertices,read);
+      }
+   }
+   else read(node,vertices);
+}
+
+void bulk_reader::read_faces(const cf_xmlNode& node, const std::string& owner, std::vector<xface>& faces)
+{
+   faces.clear();
+   auto read = [&owner](const cf_xmlNode& const_block, std::vector<xface>& f) {
+      cf_xmlNode block = const_block;
+      for(auto iv=block.begin(); iv!=block.end(); iv++) {
+         cf_xmlNode face(iv);
+         if(!face.is_attribute_node()) {
+            if("face" == face.tag()) {
+               f.push_back(xface(face));
+            }
+            else {
+               throw std::logic_error(owner + ": expected tag 'face' but found " + face.tag());
+            }
+         }
+      }
+   };
+
+   if(const std::string* text = raw_text(node)) {
+      if(!parse_chunks(*text,"face",faces,parse_faces)) {
+         faces.clear();
+         read_parsed(node,*text,faces,read);
+      }
+   }
+   else read(node,faces);
+}
+
+std::string bulk_reader::m_directory;
+
+void bulk_reader::set_directory(const std::string& dir)
+{
+   m_directory = dir;
+}
+
+std::string bulk_reader::resolve_path(const std::string& file)
+{
+   boost::filesystem::path path(file);
+   if(path.is_relative() && m_directory.length() > 0) path = boost::filesystem::path(m_directory) / path;
+   std::string resolved = path.string();
+   std::replace(resolved.begin(),resolved.end(), '\\', '/');
+   return resolved;
+}
+
+std::string bulk_reader::file_signature(const std::string& file)
+{
+   std::string path = resolve_path(file);
+   boost::system::error_code ec;
+   uintmax_t size = boost::filesystem::file_size(path,ec);
+   if(ec) return path;
+   std::time_t time = boost::filesystem::last_write_time(path,ec);
+   if(ec) return path;
+   return path + ";" + std::to_string(size) + ";" + std::to_string(static_cast<long long>(time));
+}
+
+// binary STL vertex as stored, used to weld the corners of neighbouring triangles
+struct stl_vertex {
+   float xyz[3];
+   bool operator==(const stl_vertex& other) const { return std::memcmp(xyz,other.xyz,sizeof(xyz)) == 0; }
+};
+
+struct stl_vertex_hash {
+   size_t operator()(const stl_vertex& v) const
+   {
+      uint32_t bits[3];
+      std::memcpy(bits,v.xyz,sizeof(bits));
+      return size_t(bits[0]*73856093u ^ bits[1]*19349663u ^ bits[2]*83492791u);
+   }
+};
+
+// read a binary STL file, vertices are numbered in order of first appearance.
+// Triangles collapsing to an edge or point are skipped
+static bool read_stl(const char* data, size_t size, std::vector<xvertex>& vertices, std::vector<xface>* faces)
+{
+   const size_t header_size = 84;
+   const size_t record_size = 50;
+   if(size < header_size) return false;
+   uint32_t ntri = 0;
+   std::memcpy(&ntri,data+80,sizeof(ntri));
+   if(size != header_size + size_t(ntri)*record_size) return false;
+
+   vertices.clear();
+   if(faces) faces->clear();
+   std::unordered_map<stl_vertex,size_t,stl_vertex_hash> index;
+   index.reserve(ntri/2+1);
+   vertices.reserve(ntri/2+1);
+   if(faces) faces->reserve(ntri);
+
+   const char* record = data + header_size;
+   for(uint32_t itri=0; itri<ntri; itri++,record+=record_size) {
+      size_t corner[3];
+      for(size_t ic=0; ic<3; ic++) {
+         // the first 12 bytes of a record is the facet normal, then 3 corners and 2 attribute bytes
+         stl_vertex v;
+         std::memcpy(v.xyz,record+12+ic*sizeof(v.xyz),sizeof(v.xyz));
+         for(size_t k=0; k<3; k++) v.xyz[k] += 0.0f; // -0 and +0 are the same vertex
+         auto ins = index.insert(std::make_pair(v,vertices.size()));
+         if(ins.second) vertices.push_back(carve::geom::VECTOR(v.xyz[0],v.xyz[1],v.xyz[2]));
+         corner[ic] = ins.first->second;
+      }
+      if(faces && corner[0]!=corner[1] && corner[1]!=corner[2] && corner[2]!=corner[0]) {
+         faces->push_back(xface(corner[0],corner[1],corner[2]));
+      }
+   }
+   return true;
+}
+
+void bulk_reader::read_file(const std::string& file, const std::string& owner, std::vector<xvertex>& vertices, std::vector<xface>* faces)
+{
+   std::string path = resolve_path(file);
+   mapped_file mapped(path);
+
+   std::string ext = boost::filesystem::path(path).extension().string();
+   std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+   if(ext == ".stl") {
+      if(!read_stl(mapped.data(),mapped.size(),vertices,faces)) throw std::runtime_error(owner + ": not a binary STL file: " + path);
+   }
+   else if(mesh_binary::is_triangles(mapped.data(),mapped.size())) {
+      // exported lumps of a previous run (--xmesh)
+      std::vector<xface> all_faces;
+      if(!mesh_binary::read_triangles(mapped.data(),mapped.size(),vertices,all_faces)) throw std::runtime_error(owner + ": not a valid xmesh file: " + path);
+      if(faces) faces->swap(all_faces);
+   }
+   else {
+      std::vector<xface> all_faces;
+      if(!mesh_binary::read(mapped.data(),mapped.size(),vertices,all_faces)) throw std::runtime_error(owner + ": not a valid binary mesh file: " + path);
+      if(faces) faces->swap(all_faces);
+   }
+}
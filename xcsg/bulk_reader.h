@@ -0,0 +1,64 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef BULK_READER_H
+#define BULK_READER_H
+
+#include <vector>
+#include <string>
+#include "csg_parser/cf_xmlNode.h"
+#include "csg_parser/cf_xmlReader.h"
+#include "xshape.h"
+#include "xface.h"
+
+// bulk_reader reads the vertices and faces of polyhedron and tin_model elements.
+// With the raw_blocks() reader configuration, large <vertices> and <faces> blocks are
+// not parsed into the xml tree, but kept as text. That text is split into chunks
+// parsed in parallel straight into the vertex and face vectors. Blocks using
+// anything beyond plain elements and attributes are parsed as ordinary xml instead.
+//
+// Alternatively the bulk data may be kept outside the .xcsg file, referenced by a
+// 'file' attribute of the polyhedron or tin_model element. The file is memory mapped and
+// is either a binary STL file (.stl extension, identical vertices are welded) or
+// any other extension for the mesh_binary forms (float64 vertices, uint32 face indices),
+// including the exported lumps of an xcsg run with --xmesh.
+
+class bulk_reader {
+public:
+   // xml reader configuration keeping large polyhedron and tin_model vertex/face blocks as text
+   static cf_xmlReader::raw_blocks raw_blocks();
+
+   // read vertices of a <vertices> node, owner is the parent tag used in error messages
+   static void read_vertices(const cf_xmlNode& node, const std::string& owner, std::vector<xvertex>& vertices);
+
+   // read faces of a <faces> node, owner is the parent tag used in error messages
+   static void read_faces(const cf_xmlNode& node, const std::string& owner, std::vector<xface>& faces);
+
+   // directory used to resolve relative 'file' attribute paths, normally that of the .xcsg file
+   static void set_directory(const std::string& dir);
+
+   // full path of a 'file' attribute value
+   static std::string resolve_path(const std::string& file);
+
+   // read vertices and, unless faces is null, faces from an external file. Throws on error
+   static void read_file(const std::string& file, const std::string& owner, std::vector<xvertex>& vertices, std::vector<xface>* faces);
+
+   // text that changes whenever the external file changes (path, size and modification time)
+   static std::string file_signature(const std::string& file);
+
+private:
+   static std::string m_directory;
+};
+
+#endif // BULK_READER_H
@@ -0,0 +1,82 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "cancel_token.h"
+#include <sstream>
+
+cancel_token::cancel_token()
+: m_cancelled(false)
+, m_timed_out(false)
+, m_has_deadline(false)
+{}
+
+cancel_token::~cancel_token()
+{}
+
+void cancel_token::set_timeout(double seconds)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(seconds > 0.0) {
+      m_deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(static_cast<long>(1000*seconds));
+      m_has_deadline = true;
+   }
+   else {
+      m_has_deadline = false;
+   }
+}
+
+void cancel_token::cancel(const std::string& reason)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(!m_cancelled) {
+      m_reason    = reason;
+      m_cancelled = true;
+   }
+}
+
+bool cancel_token::cancelled()
+{
+   if(m_cancelled) return true;
+
+   if(m_has_deadline) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!m_cancelled && boost::posix_time::microsec_clock::universal_time() > m_deadline) {
+         m_reason    = "timeout, deadline passed";
+         m_timed_out = true;
+         m_cancelled = true;
+      }
+   }
+   return m_cancelled;
+}
+
+std::string cancel_token::reason() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_reason;
+}
+
+void cancel_token::reset()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_cancelled    = false;
+   m_timed_out    = false;
+   m_has_deadline = false;
+   m_reason.clear();
+}
+
+void cancel_token::check()
+{
+   if(cancelled()) throw cancel_exception("cancelled: " + reason());
+}
@@ -0,0 +1,73 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef CANCEL_TOKEN_H
+#define CANCEL_TOKEN_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <boost/date_time.hpp>
+
+// cancel_exception is thrown by cancel_token::check() when the run is cancelled
+class cancel_exception : public std::runtime_error {
+public:
+   cancel_exception(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// cancel_token is a process-wide cooperative cancellation flag.
+// It is set on the first error in any thread, or when the deadline passes.
+// Threads call check() between booleans, so all work stops promptly.
+
+class cancel_token {
+public:
+   static cancel_token& singleton()  { static cancel_token instance; return instance;  }
+
+   // set a deadline in seconds from now, 0 means no deadline
+   void set_timeout(double seconds);
+
+   // cancel the run, only the first reason is kept
+   void cancel(const std::string& reason);
+
+   // true if cancelled or the deadline has passed
+   bool cancelled();
+
+   // true if cancellation was caused by the deadline
+   bool timed_out() const { return m_timed_out; }
+
+   // reason for the cancellation
+   std::string reason() const;
+
+   // throw cancel_exception if cancelled
+   void check();
+
+   // clear cancellation and deadline before a new run
+   void reset();
+
+protected:
+   cancel_token();
+   virtual ~cancel_token();
+
+private:
+   std::atomic<bool>          m_cancelled;
+   std::atomic<bool>          m_timed_out;
+   std::atomic<bool>          m_has_deadline;
+   boost::posix_time::ptime   m_deadline;
+   std::string                m_reason;
+   mutable std::mutex         m_mutex;
+};
+
+#endif // CANCEL_TOKEN_H
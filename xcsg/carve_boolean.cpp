@@ -14,15 +14,56 @@
 // EndLicense:
 
 #include <boost/date_time.hpp>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <iostream>
 
 #include "carve_boolean.h"
 #include "xpolyhedron.h"
+#include "triangle_mesh.h"
 //#include <carve/mesh_simplify.hpp>
 #include "carve/mesh_simplify.hpp"
 #include <carve/input.hpp>
 
 #include "boolean_timer.h"
+#include "node_profiler.h"
+#include "trace_writer.h"
+#include "boolean_engine.h"
+#include "cancel_token.h"
 #include "mesh_utils.h"
+#include "extrude_mesh.h"
+#include "json_log.h"
+#include "primitives3d.h"
+#include "thread_pool.h"
+#include "carve_boolean_thread.h"
+
+bool carve_boolean::m_split_lumps   = false;
+bool carve_boolean::m_simplify      = false;
+bool carve_boolean::m_welding       = false;
+double carve_boolean::m_snap        = 0.0;
+bool carve_boolean::m_deterministic = false;
+bool carve_boolean::m_retry         = true;
+size_t carve_boolean::m_partitions  = 1;
+
+// operands with fewer faces in total are not partitioned
+static const size_t partition_min_faces = 100000;
+
+// true when the boxes are separated by a small positive gap, touching boxes are not separated
+static bool separated(const carve::geom3d::AABB& abox, const carve::geom3d::AABB& bbox)
+{
+   for(size_t k=0; k<3; k++) {
+      double extent = abox.extent[k] + bbox.extent[k];
+      double gap    = std::fabs(abox.pos[k]-bbox.pos[k]) - extent;
+      if(gap > 1.0E-9*extent) return true;
+   }
+   return false;
+}
 
 std::string carve_boolean::boolean_type(carve::csg::CSG::OP op)
 {
@@ -59,18 +100,52 @@ size_t carve_boolean::compute( std::shared_ptr<carve::mesh::MeshSet<3>> b,  carv
          m_meshset = b;
       }
       else {
+         // stop here if the run has been cancelled
+         cancel_token::singleton().check();
+
          // the time runs only when an actual boolean is taking place
          boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
 
-         carve::csg::CSG  csg;
-         m_meshset = std::shared_ptr<carve::mesh::MeshSet<3>>(csg.compute(m_meshset.get(),b.get(),op));
+         std::shared_ptr<carve::mesh::MeshSet<3>> a = m_meshset;
+         if(!compute_disjoint(b,op) && !compute_lumps(b,op) && !compute_partitioned(b,op)) {
+            m_meshset = compute_carve(m_meshset,b,op);
+         }
+
+         // the time after carve is reported separately by the profiler
+         boost::posix_time::ptime p2 = boost::posix_time::microsec_clock::universal_time();
+         if(m_welding) {
+            std::shared_ptr<carve::mesh::MeshSet<3>> welded = weld_vertices(m_meshset.get(),weld_tolerance(m_meshset.get()));
+            if(welded.get()) m_meshset = welded;
+         }
+
+         // intersection vertices are rounded to the grid before they reach the next boolean
+         if(m_snap > 0.0) {
+            std::shared_ptr<carve::mesh::MeshSet<3>> snapped = snap_vertices(m_meshset.get(),snap_grid(m_meshset.get()));
+            if(snapped.get()) m_meshset = snapped;
+         }
+
+         // one pass of each per boolean keeps the cost proportional to the result size
+         if(m_simplify) {
+            merge_faces();
+            eliminate_short_edges();
+         }
+
+         // the next boolean sees the same input regardless of how carve ordered this result
+         if(m_deterministic) m_meshset = canonical(m_meshset.get());
 
-         boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
-         double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+         boost::posix_time::ptime p3 = boost::posix_time::microsec_clock::universal_time();
+         boost::posix_time::time_duration  ptime_diff = p3 - p1;
+         double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
 
          boolean_timer::singleton().add_elapsed(elapsed_sec);
+         node_profiler& profiler = node_profiler::singleton();
+         if(profiler.enabled()) profiler.add_boolean(0.001*ptime_diff.total_microseconds(),a.get(),b.get(),0.001*(p3-p2).total_microseconds());
       }
    }
+   catch (cancel_exception&)
+   {
+      throw;
+   }
    catch (std::exception& ex)
    {
       std::string msg = string(ex.what()) + " (originated in carve_boolean::compute)";
@@ -79,6 +154,799 @@ size_t carve_boolean::compute( std::shared_ptr<carve::mesh::MeshSet<3>> b,  carv
    return m_meshset->meshes.size();
 }
 
+bool carve_boolean::disjoint(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b)
+{
+   if(a->vertex_storage.size()==0 || b->vertex_storage.size()==0) return false;
+
+   return separated(a->getAABB(),b->getAABB());
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::concatenate(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b)
+{
+   std::vector<const carve::mesh::MeshSet<3>*> sets;
+   sets.push_back(a);
+   sets.push_back(b);
+   return concatenate(sets);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::concatenate(const std::vector<const carve::mesh::MeshSet<3>*>& sets)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+
+   // size the face index table up front, so the faces are written in place
+   // instead of going through per face vertex and index vectors
+   size_t nvert    = 0;
+   size_t nfaces   = 0;
+   size_t nindices = 0;
+   for(const carve::mesh::MeshSet<3>* mset : sets) {
+      nvert += mset->vertex_storage.size();
+      for(size_t imesh=0; imesh<mset->meshes.size(); imesh++) {
+         const carve::mesh::Mesh<3>* mesh = mset->meshes[imesh];
+         nfaces += mesh->faces.size();
+         for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+            nindices += 1 + mesh->faces[iface]->n_edges;
+         }
+      }
+   }
+
+   carve::input::PolyhedronData data;
+   data.points.reserve(nvert);
+   data.faceIndices.resize(nindices);
+   data.faceCount = static_cast<int>(nfaces);
+
+   size_t pos = 0;
+   for(const carve::mesh::MeshSet<3>* mset : sets) {
+      if(mset->vertex_storage.empty()) continue;
+      int offset = static_cast<int>(data.points.size());
+      for(size_t i=0;i<mset->vertex_storage.size();i++) {
+         data.points.push_back(mset->vertex_storage[i].v);
+      }
+
+      const carve::mesh::MeshSet<3>::vertex_t* vbase = &mset->vertex_storage[0];
+      for(size_t imesh=0; imesh<mset->meshes.size(); imesh++) {
+         carve::mesh::Mesh<3>* mesh = mset->meshes[imesh];
+         for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+            carve::mesh::Face<3>* face = mesh->faces[iface];
+            data.faceIndices[pos++] = static_cast<int>(face->n_edges);
+            edge_t* edge = face->edge;
+            do {
+               data.faceIndices[pos++] = offset + static_cast<int>(edge->vert-vbase);
+               edge = edge->next;
+            } while(edge != face->edge);
+         }
+      }
+   }
+
+   carve::input::Options options;
+   std::shared_ptr<carve::mesh::MeshSet<3>> result(data.createMesh(options));
+
+   // the order of the sets may depend on thread timing
+   if(m_deterministic) result = canonical(result.get());
+   return result;
+}
+
+// lexicographic order of vertex coordinates
+static bool vertex_less(const carve::geom3d::Vector& a, const carve::geom3d::Vector& b)
+{
+   for(size_t k=0; k<3; k++) {
+      if(a[k] < b[k]) return true;
+      if(a[k] > b[k]) return false;
+   }
+   return false;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::canonical(const carve::mesh::MeshSet<3>* a)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+   typedef std::vector<size_t>  loop_t;   // vertex_storage offsets of a face
+
+   carve::input::PolyhedronData data;
+   if(a->vertex_storage.empty()) return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(carve::input::Options()));
+
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = &a->vertex_storage[0];
+   auto vless = [vbase](size_t i, size_t j) { return vertex_less(vbase[i].v,vbase[j].v); };
+   auto loop_less = [&vless](const loop_t& x, const loop_t& y) {
+      return std::lexicographical_compare(x.begin(),x.end(),y.begin(),y.end(),vless);
+   };
+
+   // each face loop starts at its smallest vertex, the orientation is kept
+   std::vector<std::vector<loop_t>> meshes(a->meshes.size());
+   size_t nindices = 0;
+   for(size_t imesh=0; imesh<a->meshes.size(); imesh++) {
+      const carve::mesh::Mesh<3>* mesh = a->meshes[imesh];
+      std::vector<loop_t>& faces = meshes[imesh];
+      faces.resize(mesh->faces.size());
+      for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+         loop_t& loop = faces[iface];
+         const edge_t* edge = mesh->faces[iface]->edge;
+         do {
+            loop.push_back(edge->vert - vbase);
+            edge = edge->next;
+         } while(edge != mesh->faces[iface]->edge);
+         std::rotate(loop.begin(),std::min_element(loop.begin(),loop.end(),vless),loop.end());
+         nindices += 1 + loop.size();
+      }
+      std::sort(faces.begin(),faces.end(),loop_less);
+   }
+
+   // lumps are ordered by their sorted faces
+   std::sort(meshes.begin(),meshes.end(),[&loop_less](const std::vector<loop_t>& x, const std::vector<loop_t>& y) {
+      return std::lexicographical_compare(x.begin(),x.end(),y.begin(),y.end(),loop_less);
+   });
+
+   // vertices are numbered in the order they are first referenced
+   std::vector<int> index(a->vertex_storage.size(),-1);
+   data.points.reserve(a->vertex_storage.size());
+   data.faceIndices.reserve(nindices);
+   size_t nfaces = 0;
+   for(auto& faces : meshes) {
+      for(auto& loop : faces) {
+         data.faceIndices.push_back(static_cast<int>(loop.size()));
+         for(size_t offset : loop) {
+            if(index[offset] < 0) {
+               index[offset] = static_cast<int>(data.points.size());
+               data.points.push_back(vbase[offset].v);
+            }
+            data.faceIndices.push_back(index[offset]);
+         }
+      }
+      nfaces += faces.size();
+   }
+   data.faceCount = static_cast<int>(nfaces);
+
+   carve::input::Options options;
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::extract(const carve::mesh::MeshSet<3>* a, const std::vector<size_t>& mesh_ids)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+   const int unused = -1;
+
+   size_t nfaces   = 0;
+   size_t nindices = 0;
+   for(size_t id : mesh_ids) {
+      const carve::mesh::Mesh<3>* mesh = a->meshes[id];
+      nfaces += mesh->faces.size();
+      for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+         nindices += 1 + mesh->faces[iface]->n_edges;
+      }
+   }
+
+   carve::input::PolyhedronData data;
+   data.faceIndices.resize(nindices);
+   data.faceCount = static_cast<int>(nfaces);
+
+   // new vertex index per vertex_storage offset, vertices are numbered in the order they are first referenced
+   std::vector<int> vertex_index(a->vertex_storage.size(),unused);
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = &a->vertex_storage[0];
+   size_t pos = 0;
+   for(size_t id : mesh_ids) {
+      carve::mesh::Mesh<3>* mesh = a->meshes[id];
+      for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+         carve::mesh::Face<3>* face = mesh->faces[iface];
+         data.faceIndices[pos++] = static_cast<int>(face->n_edges);
+         edge_t* edge = face->edge;
+         do {
+            int& index = vertex_index[edge->vert-vbase];
+            if(index == unused) {
+               index = static_cast<int>(data.points.size());
+               data.points.push_back(edge->vert->v);
+            }
+            data.faceIndices[pos++] = index;
+            edge = edge->next;
+         } while(edge != face->edge);
+      }
+   }
+
+   carve::input::Options options;
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
+}
+
+double carve_boolean::weld_tolerance(const carve::mesh::MeshSet<3>* a)
+{
+   if(a->vertex_storage.size()==0) return 0.0;
+   carve::geom3d::AABB box = a->getAABB();
+   return 1.0E-9*2.0*std::sqrt(carve::geom::dot(box.extent,box.extent));
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::weld_vertices(const carve::mesh::MeshSet<3>* a, double tol)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+   std::shared_ptr<carve::mesh::MeshSet<3>> welded;
+   if(a->vertex_storage.size()==0 || !(tol > 0.0)) return welded;
+
+   const size_t unused = std::numeric_limits<size_t>::max();
+   const double scale  = 1.0/tol;
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = &a->vertex_storage[0];
+
+   // new point index per vertex_storage offset, valid within the current mesh
+   static thread_local std::vector<size_t> vertex_index;
+   static thread_local std::vector<size_t> offsets;
+   if(vertex_index.size() < a->vertex_storage.size()) vertex_index.resize(a->vertex_storage.size(),unused);
+
+   // Vertices are hashed on their coordinates rounded to the tolerance, the first vertex of a
+   // cell represents it. Only the own cell is searched, so a pair straddling a cell boundary is
+   // kept apart, which is harmless. Vertices of different meshes are never merged
+   std::unordered_map<uint64_t,size_t> cells;
+   carve::input::PolyhedronData data;
+   data.points.reserve(a->vertex_storage.size());
+   std::vector<int> face;
+   size_t nmerged  = 0;
+   size_t nfaces   = 0;
+   for(size_t imesh=0; imesh<a->meshes.size(); imesh++) {
+      const carve::mesh::Mesh<3>* mesh = a->meshes[imesh];
+      cells.clear();
+      offsets.clear();
+      for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+         const carve::mesh::Face<3>* face_ptr = mesh->faces[iface];
+         face.clear();
+         const edge_t* edge = face_ptr->edge;
+         do {
+            size_t offset = edge->vert - vbase;
+            size_t& index = vertex_index[offset];
+            if(index == unused) {
+               const xvertex& v = edge->vert->v;
+               long long cell[3];
+               uint64_t key = 0;
+               for(size_t k=0; k<3; k++) {
+                  cell[k] = std::llround(v[k]*scale);
+                  key = key*0x100000001b3ULL ^ static_cast<uint64_t>(cell[k]);
+               }
+               auto ins = cells.insert(std::make_pair(key,data.points.size()));
+               index = ins.first->second;
+               if(!ins.second) {
+                  // the representative must be in the same cell, not just have the same hash
+                  const xvertex& rep = data.points[index];
+                  for(size_t k=0; k<3; k++) {
+                     if(std::llround(rep[k]*scale) != cell[k]) index = unused;
+                  }
+               }
+               if(ins.second || index == unused) {
+                  index = data.points.size();
+                  data.points.push_back(v);
+               }
+               else nmerged++;
+               offsets.push_back(offset);
+            }
+            // consecutive vertices merged into one are kept once
+            int ipoint = static_cast<int>(index);
+            if(face.empty() || face.back() != ipoint) face.push_back(ipoint);
+            edge = edge->next;
+         } while(edge != face_ptr->edge);
+         while(face.size() > 1 && face.back() == face.front()) face.pop_back();
+
+         if(face.size() >= 3) {
+            data.faceIndices.push_back(static_cast<int>(face.size()));
+            data.faceIndices.insert(data.faceIndices.end(),face.begin(),face.end());
+            nfaces++;
+         }
+      }
+      for(size_t i=0; i<offsets.size(); i++) vertex_index[offsets[i]] = unused;
+   }
+
+   if(nmerged > 0) {
+      data.faceCount = static_cast<int>(nfaces);
+      carve::input::Options options;
+      welded = std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
+   }
+   return welded;
+}
+
+double carve_boolean::snap_grid(const carve::mesh::MeshSet<3>* a)
+{
+   if(a->vertex_storage.size()==0 || !(m_snap > 0.0)) return 0.0;
+   carve::geom3d::AABB box = a->getAABB();
+   double size = 2.0*std::max(std::max(box.extent[0],box.extent[1]),box.extent[2]);
+   if(!(size > 0.0)) return 0.0;
+
+   // m_snap*size = f*2^exponent with 0.5 <= f < 1
+   int exponent = 0;
+   std::frexp(m_snap*size,&exponent);
+   return std::ldexp(1.0,exponent-1);
+}
+
+// a point of an integer grid, rounded coordinates used as hash key
+struct grid_cell {
+   long long c[3];
+   bool operator==(const grid_cell& other) const { return c[0]==other.c[0] && c[1]==other.c[1] && c[2]==other.c[2]; }
+};
+
+struct grid_cell_hash {
+   size_t operator()(const grid_cell& cell) const
+   {
+      uint64_t key = 0;
+      for(size_t k=0; k<3; k++) key = key*0x100000001b3ULL ^ static_cast<uint64_t>(cell.c[k]);
+      return static_cast<size_t>(key);
+   }
+};
+
+// true when all vertices of the face are within half a grid step of the line through its two
+// most distant vertices ip and iq
+static bool flat_face(const std::vector<int>& face, const std::vector<carve::geom3d::Vector>& points, double grid, int& ip, int& iq)
+{
+   ip = face[0];
+   for(int i=0; i<2; i++) {
+      const carve::geom3d::Vector& from = points[ip];
+      double dmax = -1.0;
+      int ifar = ip;
+      for(size_t j=0; j<face.size(); j++) {
+         carve::geom3d::Vector d = points[face[j]] - from;
+         double d2 = carve::geom::dot(d,d);
+         if(d2 > dmax) { dmax = d2; ifar = face[j]; }
+      }
+      if(i == 0) ip = ifar;
+      else       iq = ifar;
+   }
+   carve::geom3d::Vector line = points[iq] - points[ip];
+   double len2 = carve::geom::dot(line,line);
+   if(!(len2 > 0.0)) return false;
+
+   double limit = 0.25*grid*grid*len2;
+   for(size_t j=0; j<face.size(); j++) {
+      carve::geom3d::Vector c = carve::geom::cross(points[face[j]] - points[ip],line);
+      if(carve::geom::dot(c,c) > limit) return false;
+   }
+   return true;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::snap_vertices(const carve::mesh::MeshSet<3>* a, double grid)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+   std::shared_ptr<carve::mesh::MeshSet<3>> snapped;
+   if(a->vertex_storage.size()==0 || !(grid > 0.0)) return snapped;
+
+   const size_t unused = std::numeric_limits<size_t>::max();
+   const double scale  = 1.0/grid;
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = &a->vertex_storage[0];
+
+   // new point index per vertex_storage offset, valid within the current mesh
+   static thread_local std::vector<size_t> vertex_index;
+   static thread_local std::vector<size_t> offsets;
+   if(vertex_index.size() < a->vertex_storage.size()) vertex_index.resize(a->vertex_storage.size(),unused);
+
+   // The grid is a power of two, so the rounded coordinates are exact multiples of it and
+   // vertices rounded to the same grid point become one point. Vertices of different meshes are never merged
+   std::unordered_map<grid_cell,size_t,grid_cell_hash> cells;
+   std::unordered_map<uint64_t,size_t> edges;
+   std::vector<std::vector<int>> faces;
+   std::vector<size_t> flat;
+   std::vector<char>   state;
+   std::vector<std::pair<double,int>> between;
+   carve::input::PolyhedronData data;
+   data.points.reserve(a->vertex_storage.size());
+   size_t nfaces = 0;
+   for(size_t imesh=0; imesh<a->meshes.size(); imesh++) {
+      const carve::mesh::Mesh<3>* mesh = a->meshes[imesh];
+      cells.clear();
+      offsets.clear();
+      faces.clear();
+      flat.clear();
+      for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+         const carve::mesh::Face<3>* face_ptr = mesh->faces[iface];
+         std::vector<int> face;
+         const edge_t* edge = face_ptr->edge;
+         do {
+            size_t offset = edge->vert - vbase;
+            size_t& index = vertex_index[offset];
+            if(index == unused) {
+               const xvertex& v = edge->vert->v;
+               grid_cell cell;
+               for(size_t k=0; k<3; k++) cell.c[k] = std::llround(v[k]*scale);
+               auto ins = cells.insert(std::make_pair(cell,data.points.size()));
+               index = ins.first->second;
+               if(ins.second) data.points.push_back(carve::geom::VECTOR(cell.c[0]*grid,cell.c[1]*grid,cell.c[2]*grid));
+               offsets.push_back(offset);
+            }
+            // consecutive vertices snapped to one are kept once
+            int ipoint = static_cast<int>(index);
+            if(face.empty() || face.back() != ipoint) face.push_back(ipoint);
+            edge = edge->next;
+         } while(edge != face_ptr->edge);
+         while(face.size() > 1 && face.back() == face.front()) face.pop_back();
+
+         if(face.size() >= 3) {
+            int ip = 0, iq = 0;
+            if(flat_face(face,data.points,grid,ip,iq)) flat.push_back(faces.size());
+            faces.push_back(std::move(face));
+         }
+      }
+      for(size_t i=0; i<offsets.size(); i++) vertex_index[offsets[i]] = unused;
+
+      // A flat face is removed and its vertices are inserted in the opposite edges of the neighbours,
+      // which keeps the mesh closed. Flat faces next to another flat face, or next to a face changed
+      // in this pass, are kept, the next boolean gets another chance at them
+      if(flat.size() > 0) {
+         state.assign(faces.size(),0);
+         for(size_t i=0; i<flat.size(); i++) state[flat[i]] = 1;
+         edges.clear();
+         for(size_t iface=0; iface<faces.size(); iface++) {
+            const std::vector<int>& face = faces[iface];
+            for(size_t j=0; j<face.size(); j++) {
+               uint64_t key = (static_cast<uint64_t>(face[j])<<32) | static_cast<uint32_t>(face[(j+1)%face.size()]);
+               edges.insert(std::make_pair(key,iface));
+            }
+         }
+         for(size_t i=0; i<flat.size(); i++) {
+            const std::vector<int>& face = faces[flat[i]];
+            bool mergeable = true;
+            for(size_t j=0; j<face.size() && mergeable; j++) {
+               uint64_t key = (static_cast<uint64_t>(face[(j+1)%face.size()])<<32) | static_cast<uint32_t>(face[j]);
+               auto it = edges.find(key);
+               mergeable = (it != edges.end() && state[it->second] == 0);
+            }
+            if(!mergeable) continue;
+
+            // vertex positions along the line
+            int ip = 0, iq = 0;
+            flat_face(face,data.points,grid,ip,iq);
+            const carve::geom3d::Vector line = data.points[iq] - data.points[ip];
+            between.clear();
+            for(size_t j=0; j<face.size(); j++) between.push_back(std::make_pair(carve::geom::dot(data.points[face[j]] - data.points[ip],line),face[j]));
+            std::sort(between.begin(),between.end());
+
+            std::vector<size_t> neighbours;
+            for(size_t j=0; j<face.size(); j++) {
+               int u = face[j];
+               int v = face[(j+1)%face.size()];
+               uint64_t key = (static_cast<uint64_t>(v)<<32) | static_cast<uint32_t>(u);
+               size_t inb = edges.find(key)->second;
+               std::vector<int>& nb = faces[inb];
+               neighbours.push_back(inb);
+
+               // the edge v->u of the neighbour gets the vertices strictly between v and u, in that order
+               size_t pos = 0;
+               while(pos < nb.size() && !(nb[pos] == v && nb[(pos+1)%nb.size()] == u)) pos++;
+               if(pos == nb.size()) continue;
+               double tv = 0.0, tu = 0.0;
+               for(size_t k=0; k<between.size(); k++) {
+                  if(between[k].second == v) tv = between[k].first;
+                  if(between[k].second == u) tu = between[k].first;
+               }
+               std::vector<int> insert;
+               for(size_t k=0; k<between.size(); k++) {
+                  double t = between[k].first;
+                  if((tv < t && t < tu) || (tu < t && t < tv)) insert.push_back(between[k].second);
+               }
+               if(tv > tu) std::reverse(insert.begin(),insert.end());
+               nb.insert(nb.begin()+pos+1,insert.begin(),insert.end());
+            }
+            for(size_t k=0; k<neighbours.size(); k++) state[neighbours[k]] = 2;
+            state[flat[i]] = 3;
+         }
+      }
+
+      for(size_t iface=0; iface<faces.size(); iface++) {
+         if(flat.size() > 0 && state[iface] == 3) continue;
+         const std::vector<int>& face = faces[iface];
+         data.faceIndices.push_back(static_cast<int>(face.size()));
+         data.faceIndices.insert(data.faceIndices.end(),face.begin(),face.end());
+         nfaces++;
+      }
+   }
+
+   data.faceCount = static_cast<int>(nfaces);
+   carve::input::Options options;
+   snapped = std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
+   return snapped;
+}
+
+// a single boolean by the selected engine
+static std::shared_ptr<carve::mesh::MeshSet<3>> carve_compute(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   return boolean_engine::current().compute(a,b,op);
+}
+
+// the failing boolean as far as it can be located
+static std::string failure_location(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b)
+{
+   std::ostringstream out;
+   std::string path = node_profiler::singleton().current_path();
+   if(path.length() > 0) out << " in " << path;
+   else                  out << " (use --profile to locate the subtree)";
+   out << ", operands with " << a->vertex_storage.size() << " and " << b->vertex_storage.size() << " vertices";
+   return out.str();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::compute_carve(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   if(!m_retry) return carve_compute(a,b,op);
+
+   std::string failure;
+   try {
+      return carve_compute(a,b,op);
+   }
+   catch(carve::exception& ex) { failure = "(carve error): " + ex.str(); }
+   catch(cancel_exception&)    { throw; }
+   catch(std::exception& ex)   { failure = ex.what(); }
+
+   // the strategies are tried in order, each returns nullptr when it does not apply
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+   typedef std::pair<const char*,std::function<MeshSet_ptr()>> strategy;
+   std::vector<strategy> strategies;
+
+   // near duplicate vertices and slivers are the usual cause
+   strategies.push_back(strategy("weld",[a,b,op]() {
+      MeshSet_ptr wa = weld_vertices(a.get(),weld_tolerance(a.get()));
+      MeshSet_ptr wb = weld_vertices(b.get(),weld_tolerance(b.get()));
+      if(!wa.get() && !wb.get()) return MeshSet_ptr();
+      return carve_compute((wa.get())? wa : a,(wb.get())? wb : b,op);
+   }));
+
+   // non planar polygons become planar triangles
+   strategies.push_back(strategy("triangulate",[a,b,op]() {
+      return carve_compute(triangulated(a.get()),triangulated(b.get()),op);
+   }));
+
+   // coincident faces and edges are moved apart by a small fraction of the operand size
+   strategies.push_back(strategy("perturb",[a,b,op]() {
+      carve::geom3d::AABB box = b->getAABB();
+      double d = 1.0E-6*2.0*box.extent.length();
+      carve::math::Matrix shift = carve::math::Matrix::TRANS(0.5773*d,0.5801*d,0.5749*d);
+      return carve_compute(a,extrude_mesh::clone_transform(b,shift),op);
+   }));
+
+   // a op (b1 + b2) = (a op b1) op b2 for union and difference, so b is applied one lump at a time
+   strategies.push_back(strategy("lumps",[a,b,op]() {
+      if(b->meshes.size() < 2 || (op!=carve::csg::CSG::UNION && op!=carve::csg::CSG::A_MINUS_B)) return MeshSet_ptr();
+      MeshSet_ptr result = a;
+      for(size_t imesh=0; imesh<b->meshes.size(); imesh++) {
+         result = carve_compute(result,extract(b.get(),std::vector<size_t>(1,imesh)),op);
+      }
+      return result;
+   }));
+
+   std::string where = failure_location(a.get(),b.get());
+   std::string tried;
+   for(auto& s : strategies) {
+      MeshSet_ptr result;
+      try {
+         result = s.second();
+      }
+      catch(carve::exception&) {}
+      catch(cancel_exception&) { throw; }
+      catch(std::exception&)   {}
+      if(!result.get()) continue;
+
+      std::cout << "...boolean " << boolean_type(op) << " failed" << where << ", retry '" << s.first << "' succeeded: " << failure << std::endl;
+      json_log::record("boolean_retry").add("op",boolean_type(op)).add("strategy",s.first).add("failure",failure)
+                                       .add("path",node_profiler::singleton().current_path());
+      return result;
+   }
+   throw std::runtime_error("boolean " + boolean_type(op) + " failed" + where + ", retries (weld, triangulate, perturb, lumps) did not help: " + failure);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::triangulated(const carve::mesh::MeshSet<3>* a)
+{
+   carve::input::PolyhedronData data;
+   size_t nfaces = 0;
+   for(size_t imesh=0; imesh<a->meshes.size(); imesh++) {
+      triangle_mesh lump(*a,imesh,false,true);
+      int offset = static_cast<int>(data.points.size());
+      for(size_t ivert=0; ivert<lump.nvertices(); ivert++) data.points.push_back(lump.vertex(ivert));
+      for(size_t itri=0; itri<lump.ntriangles(); itri++) {
+         const size_t* tri = lump.triangle(itri);
+         data.faceIndices.push_back(3);
+         for(size_t k=0; k<3; k++) data.faceIndices.push_back(offset + static_cast<int>(tri[k]));
+      }
+      nfaces += lump.ntriangles();
+   }
+   data.faceCount = static_cast<int>(nfaces);
+
+   carve::input::Options options;
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
+}
+
+bool carve_boolean::compute_lumps(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   if(!m_split_lumps || m_meshset->meshes.size() < 2) return false;
+   if(op!=carve::csg::CSG::UNION && op!=carve::csg::CSG::INTERSECTION && op!=carve::csg::CSG::A_MINUS_B) return false;
+
+   // Each mesh is classified on its own. A cavity shell that b does not reach is
+   // left inside its enclosing lump whatever happens to that lump, so it may pass through too
+   carve::geom3d::AABB bbox = b->getAABB();
+   std::vector<size_t> touched,untouched;
+   for(size_t imesh=0; imesh<m_meshset->meshes.size(); imesh++) {
+      carve::mesh::Mesh<3>* mesh = m_meshset->meshes[imesh];
+      if(separated(mesh->getAABB(),bbox)) untouched.push_back(imesh);
+      else                                touched.push_back(imesh);
+   }
+   if(untouched.empty()) return false;
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> result;
+   if(!touched.empty()) {
+      trace_span span("carve_boolean","boolean");
+      std::shared_ptr<carve::mesh::MeshSet<3>> a = extract(m_meshset.get(),touched);
+      result = compute_carve(a,b,op);
+   }
+
+   switch(op) {
+      case carve::csg::CSG::UNION:
+      {
+         // b alone when no lump was touched
+         if(!result.get()) result = b;
+         m_meshset = concatenate(result.get(),extract(m_meshset.get(),untouched).get());
+         return true;
+      }
+      case carve::csg::CSG::A_MINUS_B:
+      {
+         if(result.get()) m_meshset = concatenate(result.get(),extract(m_meshset.get(),untouched).get());
+         return true;
+      }
+      case carve::csg::CSG::INTERSECTION:
+      {
+         // the untouched lumps are outside b
+         m_meshset = (result.get())? result : std::shared_ptr<carve::mesh::MeshSet<3>>(carve::input::PolyhedronData().createMesh(carve::input::Options()));
+         return true;
+      }
+      default: { return false; }
+   };
+}
+
+bool carve_boolean::compute_disjoint(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   if(!disjoint(m_meshset.get(),b.get())) return false;
+
+   // the operands do not overlap, the result follows without running carve
+   switch(op) {
+      case carve::csg::CSG::UNION:
+      case carve::csg::CSG::SYMMETRIC_DIFFERENCE:  { m_meshset = concatenate(m_meshset.get(),b.get()); return true; }
+      case carve::csg::CSG::INTERSECTION:          { m_meshset = std::shared_ptr<carve::mesh::MeshSet<3>>(carve::input::PolyhedronData().createMesh(carve::input::Options())); return true; }
+      case carve::csg::CSG::A_MINUS_B:             { return true; }
+      case carve::csg::CSG::B_MINUS_A:             { m_meshset = b; return true; }
+      default:                                     { return false; }
+   };
+}
+
+static size_t face_count(const carve::mesh::MeshSet<3>* a)
+{
+   size_t nfaces = 0;
+   for(auto mesh : a->meshes) nfaces += mesh->faces.size();
+   return nfaces;
+}
+
+// an empty mesh set
+static std::shared_ptr<carve::mesh::MeshSet<3>> empty_meshset()
+{
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(carve::input::PolyhedronData().createMesh(carve::input::Options()));
+}
+
+bool carve_boolean::compute_partitioned(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+   if(m_partitions < 2 || thread_pool::singleton().nthreads() < 2) return false;
+   if(op!=carve::csg::CSG::UNION && op!=carve::csg::CSG::INTERSECTION && op!=carve::csg::CSG::A_MINUS_B) return false;
+   MeshSet_ptr a = m_meshset;
+   if(face_count(a.get()) + face_count(b.get()) < partition_min_faces) return false;
+
+   // the region where the result may be
+   carve::geom3d::AABB abox = a->getAABB();
+   carve::geom3d::AABB bbox = b->getAABB();
+   double lo[3],hi[3];
+   for(size_t k=0; k<3; k++) {
+      double alo = abox.pos[k]-abox.extent[k], ahi = abox.pos[k]+abox.extent[k];
+      double blo = bbox.pos[k]-bbox.extent[k], bhi = bbox.pos[k]+bbox.extent[k];
+      switch(op) {
+         case carve::csg::CSG::UNION:        { lo[k] = std::min(alo,blo); hi[k] = std::max(ahi,bhi); break; }
+         case carve::csg::CSG::INTERSECTION: { lo[k] = std::max(alo,blo); hi[k] = std::min(ahi,bhi); break; }
+         default:                            { lo[k] = alo; hi[k] = ahi; break; }
+      };
+   }
+   size_t axis = 0;
+   for(size_t k=1; k<3; k++) if(hi[k]-lo[k] > hi[axis]-lo[axis]) axis = k;
+   if(!(hi[axis] > lo[axis])) return false;
+
+   // The cut planes are placed at quantiles of the vertex coordinates, so the slabs get similar work.
+   // Each plane is moved to the middle of a gap between vertex coordinates, so no input face
+   // lies in it and the faces of the result in a cut plane are exactly the slab caps
+   std::vector<double> coords;
+   coords.reserve(a->vertex_storage.size() + b->vertex_storage.size());
+   for(auto& v : a->vertex_storage) if(v.v[axis] > lo[axis] && v.v[axis] < hi[axis]) coords.push_back(v.v[axis]);
+   for(auto& v : b->vertex_storage) if(v.v[axis] > lo[axis] && v.v[axis] < hi[axis]) coords.push_back(v.v[axis]);
+   std::sort(coords.begin(),coords.end());
+   coords.erase(std::unique(coords.begin(),coords.end()),coords.end());
+   std::vector<double> cuts;
+   for(size_t i=1; i<m_partitions; i++) {
+      size_t j = (coords.size()*i)/m_partitions;
+      if(j == 0 || j >= coords.size()) continue;
+      double cut = 0.5*(coords[j-1]+coords[j]);
+      if(cuts.empty() || cut > cuts.back()) cuts.push_back(cut);
+   }
+   if(cuts.empty()) return false;
+
+   // the outer slab faces are well outside the region, so they never cut the result
+   const double margin = 0.1*(hi[axis]-lo[axis]) + 1.0;
+   const size_t nslab = cuts.size()+1;
+   std::vector<MeshSet_ptr> slab_result(nslab);
+   auto compute_slab = [&](size_t islab) {
+      double smin[3],smax[3];
+      for(size_t k=0; k<3; k++) { smin[k] = lo[k]-margin; smax[k] = hi[k]+margin; }
+      if(islab > 0)       smin[axis] = cuts[islab-1];
+      if(islab+1 < nslab) smax[axis] = cuts[islab];
+      carve::math::Matrix t = carve::math::Matrix::TRANS(smin[0],smin[1],smin[2]);
+      MeshSet_ptr slab = primitives3d::make_cuboid(smax[0]-smin[0],smax[1]-smin[1],smax[2]-smin[2],false,false,t)->create_carve_mesh(carve::math::Matrix());
+
+      MeshSet_ptr as = carve_compute(a,slab,carve::csg::CSG::INTERSECTION);
+      MeshSet_ptr bs = carve_compute(b,slab,carve::csg::CSG::INTERSECTION);
+      bool aempty = as->meshes.empty();
+      bool bempty = bs->meshes.empty();
+      switch(op) {
+         case carve::csg::CSG::UNION:        { slab_result[islab] = (aempty)? bs : (bempty)? as : compute_carve(as,bs,op); break; }
+         case carve::csg::CSG::INTERSECTION: { slab_result[islab] = (aempty || bempty)? empty_meshset() : compute_carve(as,bs,op); break; }
+         default:                            { slab_result[islab] = (aempty || bempty)? as : compute_carve(as,bs,op); break; }
+      };
+   };
+   {
+      // inside a reduction task the slabs run inline, see carve_boolean_thread::in_reduction()
+      trace_span span("carve_partitioned","boolean");
+      if(carve_boolean_thread::in_reduction()) {
+         for(size_t islab=0; islab<nslab; islab++) compute_slab(islab);
+      }
+      else {
+         task_group tasks;
+         for(size_t islab=0; islab<nslab; islab++) tasks.run([&compute_slab,islab]() { compute_slab(islab); });
+         tasks.wait();
+      }
+   }
+
+   // Stitch: the slab caps are dropped, and vertices of neighbouring slabs that coincide are merged.
+   // Vertices near a cut get its exact coordinate before they are hashed on rounded coordinates
+   const double diag = std::sqrt((hi[0]-lo[0])*(hi[0]-lo[0]) + (hi[1]-lo[1])*(hi[1]-lo[1]) + (hi[2]-lo[2])*(hi[2]-lo[2]));
+   const double tol  = 1.0E-8*diag;
+   const double scale = 1.0/tol;
+   auto on_cut = [&cuts,tol](double c) {
+      auto i = std::lower_bound(cuts.begin(),cuts.end(),c-tol);
+      return (i != cuts.end() && *i <= c+tol)? int(i-cuts.begin()) : -1;
+   };
+
+   carve::input::PolyhedronData data;
+   std::unordered_map<grid_cell,int,grid_cell_hash> cells;
+   std::vector<int> face;
+   std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+   size_t nfaces = 0;
+   for(auto& result : slab_result) {
+      for(auto mesh : result->meshes) {
+         for(auto face_ptr : mesh->faces) {
+            face_ptr->getVertices(verts);
+            int icut = on_cut(verts[0]->v[axis]);
+            bool cap = (icut >= 0);
+            for(size_t i=1; cap && i<verts.size(); i++) cap = (on_cut(verts[i]->v[axis]) == icut);
+            if(cap) continue;
+
+            face.clear();
+            for(auto vert : verts) {
+               xvertex v = vert->v;
+               int ivcut = on_cut(v[axis]);
+               if(ivcut >= 0) v[axis] = cuts[ivcut];
+               grid_cell cell;
+               for(size_t k=0; k<3; k++) cell.c[k] = std::llround(v[k]*scale);
+               auto ins = cells.insert(std::make_pair(cell,static_cast<int>(data.points.size())));
+               if(ins.second) data.points.push_back(v);
+               if(face.empty() || face.back() != ins.first->second) face.push_back(ins.first->second);
+            }
+            while(face.size() > 1 && face.back() == face.front()) face.pop_back();
+            if(face.size() >= 3) {
+               data.faceIndices.push_back(static_cast<int>(face.size()));
+               data.faceIndices.insert(data.faceIndices.end(),face.begin(),face.end());
+               nfaces++;
+            }
+         }
+      }
+   }
+   data.faceCount = static_cast<int>(nfaces);
+   MeshSet_ptr stitched(data.createMesh(carve::input::Options()));
+
+   // the plain boolean is used when the seams do not close
+   for(auto mesh : stitched->meshes) {
+      if(!mesh->isClosed()) {
+         json_log::record("partition_fallback").add("op",boolean_type(op)).add("slabs",nslab);
+         return false;
+      }
+   }
+   m_meshset = stitched;
+   return true;
+}
+
 size_t carve_boolean::size() const
 {
    if(!m_meshset.get()) return 0;
@@ -92,75 +960,92 @@ std::shared_ptr<xpolyhedron> carve_boolean::create_manifold(size_t manifold_id)
 
    if(manifold_id<m_meshset->meshes.size()) {
 
+      typedef carve::mesh::Face<3>::vertex_t vertex_t;
+      typedef carve::mesh::Edge<3>           edge_t;
+      const size_t unused = std::numeric_limits<size_t>::max();
+
       carve::mesh::Mesh<3>* mesh = m_meshset->meshes[manifold_id];
       size_t nfaces = mesh->faces.size();
 
-      // find the vertices referenced by the selected manifold
-      std::map<carve::mesh::Face<3>::vertex_t*,size_t> vi_map;
-      std::map<size_t,carve::mesh::Face<3>::vertex_t*> iv_map;
-      for (size_t iface=0; iface<nfaces; iface++) {
-         carve::mesh::Face<3>* face = mesh->faces[iface];
-         std::vector<carve::mesh::Face<3>::vertex_t*> verts;
-         face->getVertices(verts);
-         for(size_t i=0;i<verts.size();i++) {
-            carve::mesh::Face<3>::vertex_t* vertex = verts[i];
-            if(vi_map.find(vertex) == vi_map.end()) {
-               size_t index = vi_map.size();
-               vi_map.insert(std::make_pair(vertex,index));
-               iv_map.insert(std::make_pair(index,vertex));
-            }
-         }
-      }
+      // polyhedron vertex index per vertex_storage offset, unused if not yet referenced.
+      // The buffers are reused, only the entries of this manifold are reset afterwards
+      static thread_local std::vector<size_t> vertex_index;
+      static thread_local std::vector<size_t> indices;
+      static thread_local std::vector<size_t> offsets;
+      const vertex_t* vertex_base = &m_meshset->vertex_storage[0];
+      if(vertex_index.size() < m_meshset->vertex_storage.size()) vertex_index.resize(m_meshset->vertex_storage.size(),unused);
 
-      // create polyhedron referencing only the relevant vertices
+      // vertices are numbered in the order they are first referenced.
+      // A single pass adds vertices and faces to the polyhedron
       poly = std::shared_ptr<xpolyhedron>(new xpolyhedron());
-      poly->v_reserve(vi_map.size());
       poly->f_reserve(nfaces);
-      for(auto i=iv_map.begin(); i!=iv_map.end();i++) {
-        carve::mesh::Face<3>::vertex_t* vtx = i->second;
-        poly->v_add(vtx->v);
-      }
-
-      // recompute face vertex indices
+      offsets.clear();
       for (size_t iface=0; iface<nfaces; iface++) {
          carve::mesh::Face<3>* face = mesh->faces[iface];
-         std::vector<carve::mesh::Face<3>::vertex_t*> verts;
-         face->getVertices(verts);
-         std::vector<size_t> indices;
-         indices.reserve(verts.size());
-         for(size_t i=0;i<verts.size();i++) {
-            carve::mesh::Face<3>::vertex_t* vertex = verts[i];
-            indices.push_back(vi_map[vertex]);
-         }
+         indices.clear();
+         edge_t* edge = face->edge;
+         do {
+            size_t offset = edge->vert - vertex_base;
+            size_t& index = vertex_index[offset];
+            if(index == unused) {
+               index = poly->v_add(edge->vert->v);
+               offsets.push_back(offset);
+            }
+            indices.push_back(index);
+            edge = edge->next;
+         } while(edge != face->edge);
          poly->f_add(xface(indices),false);
       }
+
+      for(size_t i=0; i<offsets.size(); i++) vertex_index[offsets[i]] = unused;
    }
    return poly;
 }
 
+std::shared_ptr<triangle_mesh> carve_boolean::create_triangle_mesh(size_t manifold_id, bool improve, bool degen_check) const
+{
+   if(manifold_id>=m_meshset->meshes.size()) return 0;
+   return std::make_shared<triangle_mesh>(*m_meshset,manifold_id,improve,degen_check);
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::mesh_set()
 {
    return m_meshset;
 }
 
+void carve_boolean::unshare()
+{
+   // the operands may be cached or instanced meshes used elsewhere
+   if(m_meshset.use_count() > 1) m_meshset = std::shared_ptr<carve::mesh::MeshSet<3>>(m_meshset->clone());
+}
+
 bool carve_boolean::merge_faces(double min_normal_angle)
 {
- //   carve::mesh::MeshSimplifier simplifier;
- //   simplifier.mergeCoplanarFaces(m_meshset.get(), min_normal_angle);
-    return true;
+   if(!m_simplify || !m_meshset.get() || m_meshset->meshes.size()==0) return false;
+
+   trace_span span("carve_boolean","merge_faces");
+   unshare();
+   carve::mesh::MeshSimplifier simplifier;
+   simplifier.mergeCoplanarFaces(m_meshset.get(), min_normal_angle);
+   return true;
 }
 
 size_t  carve_boolean::eliminate_short_edges(double min_length)
 {
-   // carve::mesh::MeshSimplifier simplifier;
-   // return simplifier.eliminateShortEdges(m_meshset.get(),min_length);
-   return 0;
+   if(!m_simplify || !m_meshset.get() || m_meshset->meshes.size()==0) return 0;
+
+   trace_span span("carve_boolean","eliminate_short_edges");
+   unshare();
+   carve::mesh::MeshSimplifier simplifier;
+   return simplifier.eliminateShortEdges(m_meshset.get(),min_length);
 }
 
 size_t carve_boolean::compute(qhull3d& qhull)
 {
    // compute the convex 3d hull
-   qhull.compute();
+   if(!qhull.compute()) {
+      throw std::logic_error("hull3d computation failed");
+   }
 
    // the result will now be tidy with all faces properly oriented
 
@@ -170,17 +1055,17 @@ size_t carve_boolean::compute(qhull3d& qhull)
    carve::input::PolyhedronData data;
    data.reserveVertices(static_cast<int>(qhull.nvertices()));
    for(auto iv=qhull.vertex_begin();iv!=qhull.vertex_end(); iv++) {
-      qhull3d::xyz& v = iv->second;
+      const qhull3d::xyz& v = *iv;
       data.addVertex(carve::geom::VECTOR(v.x,v.y,v.z));
    }
 
    // faces
-   data.reserveFaces(static_cast<int>(qhull.nfaces()),3);
-   for(auto iface=qhull.face_begin(); iface!=qhull.face_end(); iface++) {
+   size_t nfaces = qhull.nfaces();
+   data.reserveFaces(static_cast<int>(nfaces),3);
+   for(size_t iface=0; iface<nfaces; iface++) {
 
       // face vertices have already been oriented with normals out
-      qhull3d::face_vertices& fv = iface->second;
-      data.addFace(fv.begin(),fv.end());
+      data.addFace(qhull.face_begin(iface),qhull.face_end(iface));
    }
 
    // create the mesh
@@ -19,6 +19,7 @@
 #include <vector>
 #include <memory>
 class xpolyhedron;
+class triangle_mesh;
 #include <carve/csg.hpp>
 #include "qhull/qhull3d.h"
 
@@ -39,6 +40,73 @@ public:
 
    static std::string boolean_type(carve::csg::CSG::OP op);
 
+   // true when the bounding boxes of a and b are separated
+   static bool disjoint(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b);
+
+   // return a new mesh set containing all meshes of a and b
+   static std::shared_ptr<carve::mesh::MeshSet<3>> concatenate(const carve::mesh::MeshSet<3>* a, const carve::mesh::MeshSet<3>* b);
+
+   // return a new mesh set containing all meshes of the given sets, copied in a single pass
+   static std::shared_ptr<carve::mesh::MeshSet<3>> concatenate(const std::vector<const carve::mesh::MeshSet<3>*>& sets);
+
+   // return a new mesh set containing the given meshes of a, with only the vertices they use
+   static std::shared_ptr<carve::mesh::MeshSet<3>> extract(const carve::mesh::MeshSet<3>* a, const std::vector<size_t>& mesh_ids);
+
+   // when enabled, booleans run only against the lumps of the current mesh that overlap "b"
+   static bool split_lumps() { return m_split_lumps; }
+   static void set_split_lumps(bool split) { m_split_lumps = split; }
+
+   // when > 1, a boolean of large operands is split into this many slabs along the longest axis of
+   // the operand boxes. The slab booleans run in parallel and are stitched into one result
+   static size_t partitions() { return m_partitions; }
+   static void set_partitions(size_t partitions) { m_partitions = partitions; }
+
+   // when enabled, near duplicate vertices are merged in meshes entering the boolean queues and after each boolean
+   static bool welding() { return m_welding; }
+   static void set_welding(bool welding) { m_welding = welding; }
+
+   // vertex welding tolerance of a mesh, relative to its bounding box
+   static double weld_tolerance(const carve::mesh::MeshSet<3>* a);
+
+   // return a copy of a where vertices of the same mesh closer than about tol are merged,
+   // and faces left with less than 3 vertices are dropped. Returns nullptr if there was nothing to merge
+   static std::shared_ptr<carve::mesh::MeshSet<3>> weld_vertices(const carve::mesh::MeshSet<3>* a, double tol);
+
+   // when larger than 0, every boolean result is snap rounded to a grid of about snap() times its size
+   static double snap() { return m_snap; }
+   static void set_snap(double snap) { m_snap = snap; }
+
+   // snap grid of a mesh: the power of two at or below snap() times its largest extent. Grids of
+   // different sizes nest, so vertices snapped in a subtree stay in place when a parent result is snapped
+   static double snap_grid(const carve::mesh::MeshSet<3>* a);
+
+   // return a copy of a with its vertices rounded to multiples of grid. Vertices of the same mesh in
+   // the same grid point are merged, faces left with less than 3 vertices are dropped, and faces
+   // flattened onto a line are removed with their vertices inserted in the neighbouring faces.
+   // Returns nullptr if a is empty
+   static std::shared_ptr<carve::mesh::MeshSet<3>> snap_vertices(const carve::mesh::MeshSet<3>* a, double grid);
+
+   // when enabled, coplanar faces are merged and short edges eliminated after each boolean
+   static bool simplify() { return m_simplify; }
+   static void set_simplify(bool simplify) { m_simplify = simplify; }
+
+   // when enabled, a boolean where carve fails is retried on welded, triangulated or perturbed operands,
+   // or one lump at a time. Only if all retries fail, the error is reported with the failing subtree
+   static bool retry() { return m_retry; }
+   static void set_retry(bool retry) { m_retry = retry; }
+
+   // return a copy of a with all faces triangulated, zero area triangles are dropped
+   static std::shared_ptr<carve::mesh::MeshSet<3>> triangulated(const carve::mesh::MeshSet<3>* a);
+
+   // when enabled, booleans are reduced in a fixed order and every result is brought to canonical
+   // form, so the output does not depend on thread timing or the number of threads
+   static bool deterministic() { return m_deterministic; }
+   static void set_deterministic(bool deterministic) { m_deterministic = deterministic; }
+
+   // return a copy of a with lumps, faces and vertices in an order given by the coordinates only:
+   // each face starts at its smallest vertex, faces and lumps are sorted, vertices are numbered as first used
+   static std::shared_ptr<carve::mesh::MeshSet<3>> canonical(const carve::mesh::MeshSet<3>* a);
+
    carve_boolean();
    virtual ~carve_boolean();
 
@@ -54,18 +122,48 @@ public:
    // number of resulting manifolds
    size_t size() const;
 
+   // merge adjacent faces with normals within min_normal_angle (radians), only when simplify() is enabled
    bool merge_faces(double min_normal_angle = 1.0e-2);
 
+   // collapse edges shorter than min_length, only when simplify() is enabled. Returns number of edges removed
    size_t eliminate_short_edges(double min_length = 1.0e-1);
 
    // create result manifolds from mesh
    std::shared_ptr<xpolyhedron>  create_manifold(size_t imani) const;
 
+   // create triangulated result manifold for export directly from mesh
+   std::shared_ptr<triangle_mesh> create_triangle_mesh(size_t imani, bool improve, bool degen_check) const;
+
    // return the current mesh
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh_set();
 
+protected:
+   // fast path when m_meshset and b are disjoint, returns false if a full boolean is required
+   bool compute_disjoint(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
+
+   // boolean against the overlapping lumps only, untouched lumps pass through.
+   // returns false if all lumps overlap or op is not supported
+   bool compute_lumps(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
+
+   // boolean in parallel slabs when partitions() > 1 and the operands are large.
+   // returns false if not applicable, or if the slab results could not be stitched
+   bool compute_partitioned(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
+
+   // make sure m_meshset is not shared before it is modified in place
+   void unshare();
+
+   // carve boolean a op b, with the retry strategies when enabled
+   static std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
+
 private:
    std::shared_ptr<carve::mesh::MeshSet<3>> m_meshset;
+   static bool                              m_split_lumps;
+   static bool                              m_simplify;
+   static bool                              m_welding;
+   static double                            m_snap;
+   static bool                              m_deterministic;
+   static bool                              m_retry;
+   static size_t                            m_partitions;
 };
 
 #endif // CARVE_BOOLEAN_H
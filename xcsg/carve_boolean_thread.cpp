@@ -16,54 +16,431 @@
 
 #include "carve_boolean_thread.h"
 #include "carve_boolean.h"
+#include "cancel_token.h"
+#include "trace_writer.h"
+#include "boolean_checkpoint.h"
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <array>
 
-carve_boolean_thread::carve_boolean_thread(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue)
+carve_boolean_thread::reduction_order carve_boolean_thread::m_order = carve_boolean_thread::SIZE_ORDER;
+
+// reduction tasks running on the stack of this thread
+static thread_local size_t reduction_depth = 0;
+
+bool carve_boolean_thread::in_reduction()
+{
+   return reduction_depth > 0;
+}
+
+carve_boolean_thread::reduction_scope::reduction_scope()
+{
+   reduction_depth++;
+}
+
+carve_boolean_thread::reduction_scope::~reduction_scope()
+{
+   reduction_depth--;
+}
+
+// spread the lower 10 bits of v so there are 2 zero bits between each
+static uint32_t morton_spread(uint32_t v)
+{
+   v = (v | (v << 16)) & 0x030000FF;
+   v = (v | (v <<  8)) & 0x0300F00F;
+   v = (v | (v <<  4)) & 0x030C30C3;
+   v = (v | (v <<  2)) & 0x09249249;
+   return v;
+}
+
+// quantize a coordinate to 10 bits within [vmin,vmin+range]
+static uint32_t morton_quantize(double v, double vmin, double range)
+{
+   if(range <= 0.0) return 0;
+   double f = (v-vmin)/range;
+   if(f < 0.0) f = 0.0;
+   if(f > 1.0) f = 1.0;
+   return uint32_t(f*1023.0);
+}
+
+// key of a mesh that does not depend on the order of its vertices:
+// the vertex count and the sum of hashes of the vertex coordinates
+static std::pair<size_t,uint64_t> content_key(const carve::mesh::MeshSet<3>* mesh)
+{
+   uint64_t sum = 0;
+   for(size_t i=0; i<mesh->vertex_storage.size(); i++) {
+      uint64_t h = 0xcbf29ce484222325ULL;
+      for(size_t k=0; k<3; k++) {
+         double   v = mesh->vertex_storage[i].v[k];
+         uint64_t bits;
+         std::memcpy(&bits,&v,sizeof(bits));
+         h = (h ^ bits)*0x100000001b3ULL;
+      }
+      sum += h;
+   }
+   return std::make_pair(mesh->vertex_storage.size(),sum);
+}
+
+// full content of a mesh independent of its vertex and face order: the sorted vertex
+// coordinates and the sorted face loops, each starting at its smallest vertex
+typedef std::array<double,3> content_vertex;
+typedef std::pair<std::vector<content_vertex>,std::vector<std::vector<content_vertex>>> mesh_content;
+static mesh_content canonical_content(const carve::mesh::MeshSet<3>* mesh)
+{
+   mesh_content content;
+   for(size_t i=0; i<mesh->vertex_storage.size(); i++) {
+      const carve::geom3d::Vector& v = mesh->vertex_storage[i].v;
+      content.first.push_back(content_vertex{{v[0],v[1],v[2]}});
+   }
+   std::sort(content.first.begin(),content.first.end());
+
+   for(size_t imesh=0; imesh<mesh->meshes.size(); imesh++) {
+      for(auto face : mesh->meshes[imesh]->faces) {
+         std::vector<content_vertex> loop;
+         const carve::mesh::Edge<3>* edge = face->edge;
+         do {
+            const carve::geom3d::Vector& v = edge->vert->v;
+            loop.push_back(content_vertex{{v[0],v[1],v[2]}});
+            edge = edge->next;
+         } while(edge != face->edge);
+         std::rotate(loop.begin(),std::min_element(loop.begin(),loop.end()),loop.end());
+         content.second.push_back(std::move(loop));
+      }
+   }
+   std::sort(content.second.begin(),content.second.end());
+   return content;
+}
+
+carve_boolean_thread::carve_boolean_thread(mesh_priority_queue& mesh_queue, mesh_memory::scope& memory, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue)
 : m_op(op)
 , m_mesh_queue(mesh_queue)
+, m_memory(memory)
 , m_exception_queue(exception_queue)
 {}
 
 carve_boolean_thread::~carve_boolean_thread()
 {}
 
+carve_boolean_thread::MeshSet_ptr carve_boolean_thread::compute(MeshSet_ptr a, MeshSet_ptr b, carve::csg::CSG::OP op)
+{
+   trace_span span("carve_boolean_thread","boolean");
+   size_t nva = a->vertex_storage.size();
+   size_t nvb = b->vertex_storage.size();
+   if(nva==0 || nvb==0) {
+      throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(op));
+   }
 
-void carve_boolean_thread::run()
+   // the operands are handed over, so they are released as soon as carve is done with them
+   carve_boolean csg;
+   csg.compute(std::move(a),op);
+   csg.compute(std::move(b),op);
+   return csg.mesh_set();
+}
+
+void carve_boolean_thread::compute(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op)
 {
-   // pick work from mesh queue as long as there are at least 2 meshes
+   // no point in running more tasks than there are mesh pairs
+   size_t npairs = mesh_queue.size()/2;
+   if(npairs == 0) return;
 
-   try {
-      while(m_mesh_queue.size() > 1) {
-
-         MeshSet_ptr a,b;
-         if(m_mesh_queue.try_dequeue(a)) {
-            if(m_mesh_queue.try_dequeue(b)) {
-
-               size_t nva = a->vertex_storage.size();
-               size_t nvb = b->vertex_storage.size();
-               if(nva>0 && nvb>0) {
-                  carve_boolean csg;
-                  csg.compute(a,m_op);
-                  csg.compute(b,m_op);
-                  m_mesh_queue.enqueue(csg.mesh_set());
-               }
-               else {
-                  throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(m_op));
-               }
+   if(carve_boolean::deterministic() || boolean_checkpoint::singleton().enabled()) {
+      compute_fixed(mesh_queue,op);
+      return;
+   }
+   if(m_order == SPATIAL_ORDER) {
+      compute_spatial(mesh_queue,op);
+      return;
+   }
+   const size_t ntasks = std::min(default_nthreads(),npairs);
+
+   // order the meshes by size
+   mesh_priority_queue size_queue;
+   mesh_memory::scope memory(mesh_memory::BOOLEAN);
+   MeshSet_ptr mesh;
+   while(mesh_queue.try_dequeue(mesh)) {
+      memory.add(mesh.get());
+      size_queue.enqueue(std::move(mesh));
+   }
+
+   safe_queue<std::string> exception_queue;
+   task_group csg_tasks;
+   for(size_t i=0; i<ntasks; i++) {
+      csg_tasks.run(carve_boolean_thread(size_queue,memory,op,exception_queue));
+   }
+
+   // wait for the tasks to finish
+   csg_tasks.wait();
+
+   if(exception_queue.size() > 0) {
+      throw std::logic_error(exception_queue.dequeue());
+   }
+
+   // return the result
+   while(size_queue.try_dequeue(mesh)) {
+      mesh_queue.enqueue(std::move(mesh));
+   }
+}
+
+void carve_boolean_thread::compute(safe_queue<MeshView_ptr>& view_queue, carve::csg::CSG::OP op)
+{
+   size_t npairs = view_queue.size()/2;
+   if(npairs == 0) return;
+
+   MeshView_ptr view;
+   if(m_order == SPATIAL_ORDER || carve_boolean::deterministic() || boolean_checkpoint::singleton().enabled()) {
+
+      // the spatial order needs the bounding boxes and the fixed order the vertices,
+      // so the views are materialized first
+      safe_queue<MeshSet_ptr> mesh_queue;
+      while(view_queue.try_dequeue(view)) mesh_queue.enqueue(view->materialize());
+      compute(mesh_queue,op);
+      view_queue.enqueue(std::make_shared<mesh_view>(mesh_queue.dequeue()));
+      return;
+   }
+   const size_t ntasks = std::min(default_nthreads(),npairs);
+
+   // order the views by size, only the owned meshes take memory
+   view_priority_queue size_queue;
+   mesh_memory::scope memory(mesh_memory::BOOLEAN);
+   while(view_queue.try_dequeue(view)) {
+      memory.add(view->owned());
+      size_queue.enqueue(std::move(view));
+   }
+
+   // as run(), but the pairs are materialized before the boolean
+   safe_queue<std::string> exception_queue;
+   auto csg_task = [&size_queue,&memory,op,&exception_queue]() {
+      reduction_scope scope;
+      try {
+         MeshView_ptr a,b;
+         while(size_queue.wait_dequeue_pair(a,b)) {
+            memory.remove(a->owned());
+            memory.remove(b->owned());
+            MeshSet_ptr result = compute(a->materialize(),b->materialize(),op);
+            const bool empty = result->meshes.size()==0;
+
+            // the operands are released before the result may be spilled to wait for its next boolean
+            a.reset();
+            b.reset();
+            MeshView_ptr view = std::make_shared<mesh_view>(result);
+            result.reset();
+            view->spill();
+            memory.add(view->owned());
+            size_queue.enqueue_result(std::move(view));
+
+            // an empty intersection makes the final result empty, the remaining pairs are skipped
+            if(op==carve::csg::CSG::INTERSECTION && empty) size_queue.cancel();
+         }
+      }
+      catch(carve::exception& ex) {
+         std::string msg("(carve error): ");
+         msg += ex.str();
+         exception_queue.enqueue(msg);
+         cancel_token::singleton().cancel(msg);
+         size_queue.cancel();
+      }
+      catch(std::exception& ex) {
+         exception_queue.enqueue(ex.what());
+         cancel_token::singleton().cancel(ex.what());
+         size_queue.cancel();
+      }
+   };
+
+   task_group csg_tasks;
+   for(size_t i=0; i<ntasks; i++) {
+      csg_tasks.run(csg_task);
+   }
+
+   // wait for the tasks to finish
+   csg_tasks.wait();
+
+   if(exception_queue.size() > 0) {
+      throw std::logic_error(exception_queue.dequeue());
+   }
+
+   // return the result, or only the empty result of a cancelled intersection
+   std::vector<MeshView_ptr> results;
+   while(size_queue.try_dequeue(view)) results.push_back(std::move(view));
+   if(op==carve::csg::CSG::INTERSECTION) {
+      for(auto& r : results) {
+         const carve::mesh::MeshSet<3>* mesh = r->owned();
+         if(mesh && mesh->meshes.size()==0) {
+            results.assign(1,r);
+            break;
+         }
+      }
+   }
+   for(auto& r : results) view_queue.enqueue(std::move(r));
+}
+
+void carve_boolean_thread::compute_spatial(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, boolean_checkpoint::reduction* state)
+{
+   // bounding box centres of all meshes
+   std::vector<MeshSet_ptr>  meshes;
+   std::vector<carve::geom3d::Vector> centres;
+   mesh_memory::scope memory(mesh_memory::BOOLEAN);
+   MeshSet_ptr mesh;
+   while(mesh_queue.try_dequeue(mesh)) {
+      memory.add(mesh.get());
+      centres.push_back(mesh->getAABB().pos);
+      meshes.push_back(std::move(mesh));
+   }
+
+   carve::geom3d::Vector cmin = centres[0];
+   carve::geom3d::Vector cmax = centres[0];
+   for(auto& c : centres) {
+      for(size_t k=0; k<3; k++) {
+         cmin[k] = std::min(cmin[k],c[k]);
+         cmax[k] = std::max(cmax[k],c[k]);
+      }
+   }
+
+   // sort meshes along the Morton curve
+   std::vector<std::pair<uint32_t,size_t>> keys(meshes.size());
+   for(size_t i=0; i<meshes.size(); i++) {
+      uint32_t code = 0;
+      for(size_t k=0; k<3; k++) {
+         code |= morton_spread(morton_quantize(centres[i][k],cmin[k],cmax[k]-cmin[k])) << k;
+      }
+      keys[i] = std::make_pair(code,i);
+   }
+   std::sort(keys.begin(),keys.end());
+
+   std::vector<MeshSet_ptr> level(meshes.size());
+   for(size_t i=0; i<keys.size(); i++) level[i] = std::move(meshes[keys[i].second]);
+
+   reduce_levels(level,op,memory,state);
+   mesh_queue.enqueue(std::move(level[0]));
+}
+
+void carve_boolean_thread::compute_fixed(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op)
+{
+   // the queue order depends on thread timing, the meshes are ordered by content instead.
+   // The key is a hash, meshes with equal keys are ordered by their full content.
+   // Meshes with equal content are interchangeable, so their order does not matter
+   typedef std::pair<std::pair<size_t,uint64_t>,MeshSet_ptr> keyed_mesh;
+   std::vector<keyed_mesh> keyed;
+   MeshSet_ptr mesh;
+   while(mesh_queue.try_dequeue(mesh)) {
+      std::pair<size_t,uint64_t> mesh_key = content_key(mesh.get());
+      keyed.push_back(std::make_pair(mesh_key,std::move(mesh)));
+   }
+   std::sort(keyed.begin(),keyed.end(),[](const keyed_mesh& a, const keyed_mesh& b) { return a.first < b.first; });
+   for(size_t ibeg=0; ibeg<keyed.size(); ) {
+      size_t iend = ibeg+1;
+      while(iend<keyed.size() && keyed[iend].first == keyed[ibeg].first) iend++;
+      if(iend-ibeg > 1) {
+         std::vector<std::pair<mesh_content,size_t>> contents;
+         for(size_t i=ibeg; i<iend; i++) contents.push_back(std::make_pair(canonical_content(keyed[i].second.get()),i));
+         std::sort(contents.begin(),contents.end());
+         std::vector<keyed_mesh> tied;
+         for(auto& c : contents) tied.push_back(std::move(keyed[c.second]));
+         std::move(tied.begin(),tied.end(),keyed.begin()+ibeg);
+      }
+      ibeg = iend;
+   }
+
+   // with checkpoints, the reduction is identified by its operation and sorted input keys,
+   // and a saved state replaces the inputs
+   uint64_t key = 0xcbf29ce484222325ULL ^ static_cast<uint64_t>(op);
+   for(auto& k : keyed) key = ((key ^ k.first.first)*0x100000001b3ULL ^ k.first.second)*0x100000001b3ULL;
+   std::vector<MeshSet_ptr> meshes;
+   meshes.reserve(keyed.size());
+   for(auto& k : keyed) meshes.push_back(std::move(k.second));
+   boolean_checkpoint::reduction state(key,meshes);
+   if(meshes.size() < 2) {
+      for(auto& m : meshes) mesh_queue.enqueue(std::move(m));
+      return;
+   }
+
+   MeshSet_ptr result;
+   if(m_order == SPATIAL_ORDER) {
+      for(auto& m : meshes) mesh_queue.enqueue(std::move(m));
+      compute_spatial(mesh_queue,op,&state);
+      result = mesh_queue.dequeue();
+   }
+   else {
+      // as SIZE_ORDER, but neighbours in size are paired level by level instead of as threads finish
+      mesh_memory::scope memory(mesh_memory::BOOLEAN);
+      for(auto& m : meshes) memory.add(m.get());
+      reduce_levels(meshes,op,memory,&state);
+      result = meshes[0];
+   }
+   state.finish(result);
+   mesh_queue.enqueue(std::move(result));
+}
+
+void carve_boolean_thread::reduce_levels(std::vector<MeshSet_ptr>& level, carve::csg::CSG::OP op, mesh_memory::scope& memory, boolean_checkpoint::reduction* state)
+{
+   // combine neighbours pairwise, one level at a time
+   while(level.size() > 1) {
+      size_t npairs = level.size()/2;
+      std::vector<MeshSet_ptr> next((level.size()+1)/2);
+      task_group csg_tasks;
+      for(size_t i=0; i<npairs; i++) {
+         MeshSet_ptr a = level[2*i];
+         MeshSet_ptr b = level[2*i+1];
+         MeshSet_ptr* result = &next[i];
+         mesh_memory::scope* level_memory = &memory;
+         csg_tasks.run([a,b,op,result,level_memory,state]() {
+            try {
+               *result = compute(a,b,op);
+               level_memory->add(result->get());
+               if(state) state->replace(a.get(),b.get(),*result);
             }
-            else {
-               m_mesh_queue.enqueue(a);
+            catch(carve::exception& ex) {
+               throw std::runtime_error("(carve error): " + ex.str());
+            }
+         });
+      }
+      if(level.size()%2 == 1) next.back() = level.back();
+
+      // wait for the level to finish, errors are rethrown here
+      csg_tasks.wait();
+      for(size_t i=0; i<2*npairs; i++) memory.remove(level[i].get());
+      level.swap(next);
+
+      // an empty intersection makes the final result empty
+      if(op==carve::csg::CSG::INTERSECTION) {
+         for(size_t i=0; i<level.size(); i++) {
+            if(level[i]->meshes.size()==0) {
+               level.assign(1,level[i]);
+               break;
             }
          }
       }
    }
+}
+
+void carve_boolean_thread::run()
+{
+   // pick the 2 smallest meshes from mesh queue as long as more pairs can be formed.
+   // wait_dequeue_pair blocks while other tasks compute results still to be returned
+   reduction_scope scope;
+
+   try {
+      MeshSet_ptr a,b;
+      while(m_mesh_queue.wait_dequeue_pair(a,b)) {
+         m_memory.remove(a.get());
+         m_memory.remove(b.get());
+         MeshSet_ptr result = compute(std::move(a),std::move(b),m_op);
+         m_memory.add(result.get());
+         m_mesh_queue.enqueue_result(std::move(result));
+      }
+   }
    catch(carve::exception& ex) {
       std::string msg("(carve error): ");
       msg += ex.str();
       m_exception_queue.enqueue(msg);
+      cancel_token::singleton().cancel(msg);
+      m_mesh_queue.cancel();
    }
    catch(std::exception& ex) {
       m_exception_queue.enqueue(ex.what());
+      cancel_token::singleton().cancel(ex.what());
+      m_mesh_queue.cancel();
    }
 }
-
@@ -21,34 +21,98 @@
 #include <string>
 #include <carve/csg.hpp>
 #include "safe_queue.h"
+#include "safe_priority_queue.h"
+#include "mesh_memory.h"
+#include "mesh_view.h"
+#include "thread_pool.h"
+#include "boolean_checkpoint.h"
 
-#include <boost/thread.hpp>
-
-// carve_boolean_thread allows boolean operations to be performed in boost::threads
-// meshes to be processed must be placed in mesh_queue before launching the threads.
+// carve_boolean_thread allows boolean operations to be performed as thread_pool tasks
+// meshes to be processed must be placed in mesh_queue before launching the tasks.
+// The two smallest meshes are always combined first, so each boolean runs on
+// operands of similar complexity instead of growing one huge mesh step by step.
 
 class carve_boolean_thread {
 public:
 
-   // default hard coded until we have something more sophisticated
-   static size_t default_nthreads() { return 12; }
+   // number of workers in the shared thread pool
+   static size_t default_nthreads() { return thread_pool::singleton().nthreads(); }
 
    typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
 
-   carve_boolean_thread(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue);
+   // ordering of meshes with the smallest (fewest vertices) on top
+   struct mesh_greater {
+      bool operator()(const MeshSet_ptr& a, const MeshSet_ptr& b) const { return a->vertex_storage.size() > b->vertex_storage.size(); }
+   };
+   typedef safe_priority_queue<MeshSet_ptr,mesh_greater> mesh_priority_queue;
+
+   // the same ordering for mesh views, which know their size before they are materialized
+   typedef std::shared_ptr<mesh_view> MeshView_ptr;
+   struct view_greater {
+      bool operator()(const MeshView_ptr& a, const MeshView_ptr& b) const { return a->nvertices() > b->nvertices(); }
+   };
+   typedef safe_priority_queue<MeshView_ptr,view_greater> view_priority_queue;
+
+   // order in which meshes are combined by compute()
+   //    SIZE_ORDER    : always combine the 2 smallest meshes
+   //    SPATIAL_ORDER : sort meshes along a Morton curve of their bounding box centres
+   //                    and combine spatial neighbours level by level
+   // With carve_boolean::deterministic() both orders reduce along a fixed tree,
+   // the meshes are first ordered by content instead of by arrival
+   enum reduction_order { SIZE_ORDER, SPATIAL_ORDER };
+   static reduction_order order() { return m_order; }
+   static void set_order(reduction_order order) { m_order = order; }
+
+   // reduce all meshes in mesh_queue to a single mesh using the shared thread pool.
+   // On return, mesh_queue contains the result mesh (or nothing if it was empty)
+   static void compute(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op);
+
+   // reduce all mesh views in view_queue to a single mesh. Each view is materialized just before
+   // its boolean, so transformed views take no memory while they wait.
+   // On return, view_queue contains the result (or nothing if it was empty)
+   static void compute(safe_queue<MeshView_ptr>& view_queue, carve::csg::CSG::OP op);
+
+   // compute a single boolean a op b
+   static MeshSet_ptr compute(MeshSet_ptr a, MeshSet_ptr b, carve::csg::CSG::OP op);
+
+   // true while the calling thread runs a reduction task taking pairs from a shared queue.
+   // A task_group waited for there may run a sibling task of the same queue, which then
+   // waits for the pair held below it on the stack. Nested parallel work runs inline instead
+   static bool in_reduction();
+
+   // marks the calling thread as running a reduction task during its lifetime
+   class reduction_scope {
+   public:
+      reduction_scope();
+      ~reduction_scope();
+   };
+
+   carve_boolean_thread(mesh_priority_queue& mesh_queue, mesh_memory::scope& memory, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue);
    virtual ~carve_boolean_thread();
 
-   // allow this class to run as a boost::thread
+   // allow this class to run as a thread_pool task
    void operator()() { run(); }
 
 protected:
    // run does the actual calculation work
    void run();
 
+   // reduction of meshes in SPATIAL_ORDER, booleans are recorded in state when given
+   static void compute_spatial(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, boolean_checkpoint::reduction* state = nullptr);
+
+   // reduction of meshes ordered by content, for carve_boolean::deterministic() and checkpoints
+   static void compute_fixed(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op);
+
+   // combine neighbours of level pairwise, one level at a time, until one mesh remains
+   static void reduce_levels(std::vector<MeshSet_ptr>& level, carve::csg::CSG::OP op, mesh_memory::scope& memory, boolean_checkpoint::reduction* state = nullptr);
+
 private:
    carve::csg::CSG::OP m_op;
-   safe_queue<MeshSet_ptr>& m_mesh_queue;
+   mesh_priority_queue&     m_mesh_queue;
+   mesh_memory::scope&      m_memory;
    safe_queue<std::string>& m_exception_queue;
+
+   static reduction_order   m_order;
 };
 
 #endif // CARVE_BOOLEAN_THREAD_H
@@ -1,16 +1,25 @@
 #include "carve_mesh_thread.h"
 #include <list>
+#include <vector>
+#include <algorithm>
 #include "boolean_timer.h"
+#include "cancel_token.h"
+#include "trace_writer.h"
+#include "carve_boolean.h"
 #include <typeinfo>
 #include <stdexcept>
 
 carve_mesh_thread::carve_mesh_thread(const carve::math::Matrix& t,
-                                     const std::unordered_set<std::shared_ptr<xsolid>>& solids,
-                                     safe_queue<MeshSet_ptr>&   mesh_queue,
+                                     const std::vector<std::shared_ptr<xsolid>>& solids,
+                                     std::atomic<size_t>&       next,
+                                     safe_queue<MeshView_ptr>&  view_queue,
+                                     mesh_memory::scope&        memory,
                                      safe_queue<std::string>&   exception_queue)
 : m_t(t)
 , m_solids(solids)
-, m_mesh_queue(mesh_queue)
+, m_next(next)
+, m_view_queue(view_queue)
+, m_memory(memory)
 , m_exception_queue(exception_queue)
 {}
 
@@ -19,66 +28,106 @@ carve_mesh_thread::~carve_mesh_thread()
 
 void carve_mesh_thread::run()
 {
+   trace_span span("carve_mesh_thread","mesh");
    try {
-      for(auto& solid : m_solids) {
-         std::shared_ptr<carve::mesh::MeshSet<3>> mesh = solid->create_carve_mesh(m_t);
+      for(size_t i=m_next++; i<m_solids.size(); i=m_next++) {
+         cancel_token::singleton().check();
+         const std::shared_ptr<xsolid>& solid = m_solids[i];
+         MeshView_ptr mesh = solid->create_mesh_view(m_t);
 
-         size_t nv = mesh->vertex_storage.size();
+         size_t nv = mesh->nvertices();
          if(nv == 0) {
             std::string type = typeid(*solid.get()).name();
             throw std::runtime_error("ERROR: Solid of type '" + type + "' created empty mesh");
          }
 
-         m_mesh_queue.enqueue(mesh);
+         // transformed views share their source mesh, only meshes of their own are welded
+         if(carve_boolean::welding() && mesh->owned()) {
+            std::shared_ptr<carve::mesh::MeshSet<3>> welded = carve_boolean::weld_vertices(mesh->owned(),carve_boolean::weld_tolerance(mesh->owned()));
+            if(welded.get()) mesh = std::make_shared<mesh_view>(welded);
+         }
+
+         // in out-of-core mode the mesh may wait in a spill file, it then takes no queue memory
+         mesh->spill();
+         m_memory.add(mesh->owned());
+         m_view_queue.enqueue(std::move(mesh));
+
+         // the mesh is queued, a solid owned by this tree alone is not needed any more
+         if(solid->releasable()) solid->release_mesh_data();
       }
    }
    catch(carve::exception& ex) {
       std::string msg("(carve error): ");
       msg += ex.str();
       m_exception_queue.enqueue(msg);
+      cancel_token::singleton().cancel(msg);
    }
    catch(std::exception& ex) {
       m_exception_queue.enqueue(ex.what());
+      cancel_token::singleton().cancel(ex.what());
    }
 }
 
-void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>> objects, safe_queue<MeshSet_ptr>& mesh_queue)
+void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, const std::unordered_set<std::shared_ptr<xsolid>>& objects, safe_queue<MeshSet_ptr>& mesh_queue)
+{
+   safe_queue<MeshView_ptr> view_queue;
+   create_mesh_queue(t,objects,view_queue);
+
+   // materialize all views
+   MeshView_ptr view;
+   while(view_queue.try_dequeue(view)) {
+      mesh_queue.enqueue(view->materialize());
+   }
+}
+
+void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, const std::unordered_set<std::shared_ptr<xsolid>>& objects, safe_queue<MeshView_ptr>& view_queue)
 {
    safe_queue<std::string> exception_queue;
-   std::list<boost::thread>  mesh_threads;
+   task_group mesh_tasks;
+
+   // the meshes are all queued before the booleans start, so this stage is only measured
+   mesh_memory::scope memory(mesh_memory::MESH);
 
    if(objects.size() > 0) {
 
-      size_t max_threads = 20;
+      size_t max_threads = thread_pool::singleton().nthreads();
       size_t num_threads = std::min(objects.size(),max_threads);
 
-      size_t num_obj_thread = 1 + objects.size()/num_threads;
-      while(objects.size() > 0) {
-         std::unordered_set<std::shared_ptr<xsolid>> thread_objects;
-         size_t num_obj =std::min(num_obj_thread,objects.size());
-         for(size_t iobj=0; iobj<num_obj; iobj++) {
-            if(objects.size()==0)break;
-            auto i = objects.begin();
-            thread_objects.insert(*i);
-            objects.erase(i);
-         }
-         mesh_threads.push_back(boost::thread(carve_mesh_thread(t,thread_objects,mesh_queue,exception_queue)));
-      }
+      // most expensive subtrees first. Each task takes the next object when it is done with the previous one,
+      // so a heavy child does not hold back a fixed share of cheap ones
+      std::vector<std::pair<double,std::shared_ptr<xsolid>>> ranked;
+      ranked.reserve(objects.size());
+      for(auto& solid : objects) ranked.push_back(std::make_pair(solid->mesh_cost(),solid));
+      std::stable_sort(ranked.begin(),ranked.end(),[](const std::pair<double,std::shared_ptr<xsolid>>& a, const std::pair<double,std::shared_ptr<xsolid>>& b) { return a.first > b.first; });
+
+      std::vector<std::shared_ptr<xsolid>> solids;
+      solids.reserve(ranked.size());
+      for(auto& p : ranked) solids.push_back(std::move(p.second));
 
-      // wait for the threads to finish
-      for(auto ithread=mesh_threads.begin(); ithread!=mesh_threads.end(); ithread++) {
-         ithread->join();
+      std::atomic<size_t> next(0);
+      for(size_t ithread=0; ithread<num_threads; ithread++) {
+         mesh_tasks.run(carve_mesh_thread(t,solids,next,view_queue,memory,exception_queue));
       }
 
+      // wait for the tasks to finish
+      mesh_tasks.wait();
+
       if(exception_queue.size() > 0) {
          throw std::logic_error(exception_queue.dequeue());
       }
    }
 }
 
-void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, std::list<std::shared_ptr<xsolid>> objects, safe_queue<MeshSet_ptr>& mesh_queue)
+void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, const std::list<std::shared_ptr<xsolid>>& objects, safe_queue<MeshSet_ptr>& mesh_queue)
 {
    std::unordered_set<std::shared_ptr<xsolid>> objects_set;
    std::copy(objects.begin(),objects.end(),std::inserter(objects_set,objects_set.begin()));
    create_mesh_queue(t,objects_set,mesh_queue);
 }
+
+void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, const std::list<std::shared_ptr<xsolid>>& objects, safe_queue<MeshView_ptr>& view_queue)
+{
+   std::unordered_set<std::shared_ptr<xsolid>> objects_set;
+   std::copy(objects.begin(),objects.end(),std::inserter(objects_set,objects_set.begin()));
+   create_mesh_queue(t,objects_set,view_queue);
+}
@@ -4,42 +4,62 @@
 #include <memory>
 #include <string>
 #include <list>
-#include <boost/thread.hpp>
+#include <vector>
+#include <atomic>
+#include "thread_pool.h"
 #include "safe_queue.h"
+#include "mesh_memory.h"
 
 #include "xsolid.h"
+#include "mesh_view.h"
 
 class carve_mesh_thread {
 public:
   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+  typedef std::shared_ptr<mesh_view>               MeshView_ptr;
 
+   // the task meshes solids[next++] until all solids are taken
    carve_mesh_thread(const carve::math::Matrix& t,
-                     const std::unordered_set<std::shared_ptr<xsolid>>& solids,
-                     safe_queue<MeshSet_ptr>&   mesh_queue,
+                     const std::vector<std::shared_ptr<xsolid>>& solids,
+                     std::atomic<size_t>&       next,
+                     safe_queue<MeshView_ptr>&  view_queue,
+                     mesh_memory::scope&        memory,
                      safe_queue<std::string>&   exception_queue);
 
    virtual ~carve_mesh_thread();
 
-   // allow this class to run as a boost::thread
+   // allow this class to run as a thread_pool task
    void operator()() { run(); }
 
    // build the mesh queue in threads
    static void create_mesh_queue(const carve::math::Matrix& t,
-                                 std::unordered_set<std::shared_ptr<xsolid>> objects,
+                                 const std::unordered_set<std::shared_ptr<xsolid>>& objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
 
    // build the mesh queue in threads
    static void create_mesh_queue(const carve::math::Matrix& t,
-                                 std::list<std::shared_ptr<xsolid>> objects,
+                                 const std::list<std::shared_ptr<xsolid>>& objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
 
+   // build a queue of mesh views in threads, repeated instances are not materialized
+   static void create_mesh_queue(const carve::math::Matrix& t,
+                                 const std::unordered_set<std::shared_ptr<xsolid>>& objects,
+                                 safe_queue<MeshView_ptr>& view_queue);
+
+   // build a queue of mesh views in threads, repeated instances are not materialized
+   static void create_mesh_queue(const carve::math::Matrix& t,
+                                 const std::list<std::shared_ptr<xsolid>>& objects,
+                                 safe_queue<MeshView_ptr>& view_queue);
+
 protected:
    void run();
 
 private:
    carve::math::Matrix                           m_t;
-   std::unordered_set<std::shared_ptr<xsolid>>   m_solids;
-   safe_queue<MeshSet_ptr>&                      m_mesh_queue;
+   const std::vector<std::shared_ptr<xsolid>>&   m_solids;
+   std::atomic<size_t>&                          m_next;
+   safe_queue<MeshView_ptr>&                     m_view_queue;
+   mesh_memory::scope&                           m_memory;
    safe_queue<std::string>&                      m_exception_queue;
 };
 
@@ -1,14 +1,49 @@
 #include "carve_minkowski_hull.h"
 #include "qhull/qhull3d.h"
+#include "extreme_point_filter.h"
 #include "carve_boolean.h"
+#include "boolean_checkpoint.h"
+#include "cancel_token.h"
+#include "trace_writer.h"
 #include <carve/matrix.hpp>
 #include "xshape.h"
 
-carve_minkowski_hull::carve_minkowski_hull(safe_queue<hull_pair>&  hull_queue,
-                                          safe_queue<MeshSet_ptr>& mesh_queue,
+// write b+offset as xyz triplets to p. The loop runs over contiguous arrays so it vectorizes
+static void translate(const carve_minkowski_hull::packed_vertices& b, const xvertex& offset, double* p)
+{
+   const size_t nvert = b.size();
+   const double* bx = &b.x[0];
+   const double* by = &b.y[0];
+   const double* bz = &b.z[0];
+   const double ox = offset.x;
+   const double oy = offset.y;
+   const double oz = offset.z;
+   for(size_t i=0; i<nvert; i++) {
+      p[3*i]   = bx[i] + ox;
+      p[3*i+1] = by[i] + oy;
+      p[3*i+2] = bz[i] + oz;
+   }
+}
+
+carve_minkowski_hull::packed_vertices::packed_vertices(const std::vector<xvertex>& vertices)
+: x(vertices.size())
+, y(vertices.size())
+, z(vertices.size())
+{
+   for(size_t i=0; i<vertices.size(); i++) {
+      x[i] = vertices[i].x;
+      y[i] = vertices[i].y;
+      z[i] = vertices[i].z;
+   }
+}
+
+carve_minkowski_hull::carve_minkowski_hull(hull_queue_t&            hull_queue,
+                                          mesh_queue_t&            mesh_queue,
+                                          mesh_memory::scope&      memory,
                                           safe_queue<std::string>& exception_queue)
 : m_hull_queue(hull_queue)
 , m_mesh_queue(mesh_queue)
+, m_memory(memory)
 , m_exception_queue(exception_queue)
 {}
 
@@ -18,48 +53,80 @@ carve_minkowski_hull::~carve_minkowski_hull()
 
 void carve_minkowski_hull::run()
 {
-   // compute hull meshes as long as the hull queue is non-empty
+   // union available mesh pairs first, then compute a hull mesh if any remains.
+   // The hull queue is complete before the tasks start, so an empty queue means that
+   // only the unions remain, wait_dequeue_pair blocks until the last hull or union is returned.
+   // Over the memory budget, a new hull waits until a running union has completed
+   // In deterministic mode and with checkpoints only the hulls are computed here,
+   // they are unioned in a fixed order afterwards
+   const bool unions = !carve_boolean::deterministic() && !boolean_checkpoint::singleton().enabled();
+   carve_boolean_thread::reduction_scope scope;
    try {
-      while(m_hull_queue.size() > 0) {
-         hull_pair hp;
-         if(m_hull_queue.try_dequeue(hp)) {
-            m_mesh_queue.enqueue(compute_hull(hp));
+      hull_pair hp;
+      MeshSet_ptr a,b;
+      while(true) {
+         cancel_token::singleton().check();
+         if(unions && m_mesh_queue.try_dequeue_outstanding_pair(a,b)) {
+            compute_union(std::move(a),std::move(b));
          }
+         else if(unions && m_memory.throttle()) {
+            continue;
+         }
+         else if(m_hull_queue.try_dequeue(hp)) {
+            MeshSet_ptr hull = compute_hull(hp);
+            m_memory.add(hull.get());
+            m_mesh_queue.enqueue_result(std::move(hull));
+         }
+         else if(unions && m_mesh_queue.wait_dequeue_pair(a,b)) {
+            compute_union(std::move(a),std::move(b));
+         }
+         else break;
       }
    }
    catch(carve::exception& ex) {
       std::string msg("(carve error): ");
       msg += ex.str();
       m_exception_queue.enqueue(msg);
+      cancel_token::singleton().cancel(msg);
+      m_mesh_queue.cancel();
    }
    catch(std::exception& ex) {
       m_exception_queue.enqueue(ex.what());
+      cancel_token::singleton().cancel(ex.what());
+      m_mesh_queue.cancel();
    }
 
 }
 
+void carve_minkowski_hull::compute_union(MeshSet_ptr a, MeshSet_ptr b)
+{
+   mesh_memory::busy busy(m_memory);
+   m_memory.remove(a.get());
+   m_memory.remove(b.get());
+   MeshSet_ptr result = carve_boolean_thread::compute(std::move(a),std::move(b),carve::csg::CSG::UNION);
+   m_memory.add(result.get());
+   m_mesh_queue.enqueue_result(std::move(result));
+}
+
 carve_minkowski_hull::MeshSet_ptr carve_minkowski_hull::compute_hull(hull_pair& hp)
 {
+   trace_span span("carve_minkowski_hull","hull");
    std::vector<xvertex>& coord = hp.first;
-   MeshSet_ptr meshB           = hp.second;
+   const packed_vertices& vertB = *hp.second;
 
    qhull3d qhull;
-   size_t nvert =  meshB->vertex_storage.size();
+   size_t nvert =  vertB.size();
+   if(nvert == 0) throw std::logic_error("minkowski3d: B has no vertices");
    qhull.reserve(nvert*coord.size());
    for(size_t i=0; i<coord.size(); i++) {
-      // use perturbation point to establish translation matrix
-      // and then translate all vertex coordinates in the B mesh
-      carve::math::Matrix t;
-      t.m[3][0] = coord[i].x;
-      t.m[3][1] = coord[i].y;
-      t.m[3][2] = coord[i].z;
-      for(size_t i=0;i<nvert;i++) {
-         carve::mesh::MeshSet<3>::vertex_t vertex = meshB->vertex_storage[i];
-         xvertex pos = t*vertex.v;
-         qhull.push_back(pos[0],pos[1],pos[2]);
-      }
+      // translate all B vertices to the perturbation point
+      translate(vertB,coord[i],qhull.extend(nvert));
    }
 
+   // drop the points that are obviously interior before computing the hull
+   extreme_point_filter culling;
+   culling.filter(qhull);
+
    // compute the hull mesh and return it as carve mesh
    carve_boolean csg;
    csg.compute(qhull);
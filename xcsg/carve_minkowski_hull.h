@@ -4,26 +4,57 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <boost/thread.hpp>
+#include "thread_pool.h"
 #include "safe_queue.h"
+#include "lockfree_queue.h"
 #include "xshape.h"
+#include "carve_boolean_thread.h"
+#include "mesh_memory.h"
 
 // carve_minkowski_hull translates the "hull_queue" into the "mesh_queue"
 // by computing convex hull meshes for all entries in the hull queue
-// Each hull_pair contains a mesh and associated perturbation coordinates for computing a hull
+// Each hull_pair contains perturbation coordinates and the hull vertices of B for computing a hull
+//
+// The tasks also union the meshes in mesh_queue while hulls are still produced.
+// With a queue memory budget, a task waits for running unions instead of computing
+// another hull while the queued meshes exceed the budget.
+// A task prefers a union whenever 2 meshes are available, so only a few hull meshes
+// are held in memory at a time. Each hull_pair must be registered as outstanding
+// in mesh_queue, when all are done the mesh_queue holds the union.
 
 class carve_minkowski_hull {
 public:
    typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
-   typedef std::pair<std::vector<xvertex>,MeshSet_ptr>  hull_pair;
 
-   carve_minkowski_hull(safe_queue<hull_pair>&   hull_queue,
-                        safe_queue<MeshSet_ptr>& mesh_queue,
+   // B vertices packed as separate coordinate arrays, shared read-only by all hull tasks
+   struct packed_vertices {
+      packed_vertices(const std::vector<xvertex>& vertices);
+      size_t size() const { return x.size(); }
+      std::vector<double> x;
+      std::vector<double> y;
+      std::vector<double> z;
+   };
+   typedef std::shared_ptr<const packed_vertices>       Vertices_ptr;
+   typedef std::pair<std::vector<xvertex>,Vertices_ptr> hull_pair;
+
+   // the hull queue carries one item per face of A, define XCSG_LOCKFREE_QUEUE
+   // to use the lock free queue instead of the mutex based one
+#ifdef XCSG_LOCKFREE_QUEUE
+   typedef lockfree_queue<hull_pair> hull_queue_t;
+#else
+   typedef safe_queue<hull_pair>     hull_queue_t;
+#endif
+
+   typedef carve_boolean_thread::mesh_priority_queue mesh_queue_t;
+
+   carve_minkowski_hull(hull_queue_t&            hull_queue,
+                        mesh_queue_t&            mesh_queue,
+                        mesh_memory::scope&      memory,
                         safe_queue<std::string>& exception_queue);
 
    virtual ~carve_minkowski_hull();
 
-   // allow this class to run as a boost::thread
+   // allow this class to run as a thread_pool task
    void operator()() { run(); }
 
 protected:
@@ -31,9 +62,13 @@ protected:
 
    MeshSet_ptr compute_hull(hull_pair& hp);
 
+   // union a dequeued pair and return the result to the mesh queue
+   void compute_union(MeshSet_ptr a, MeshSet_ptr b);
+
 private:
-   safe_queue<hull_pair>&   m_hull_queue;
-   safe_queue<MeshSet_ptr>& m_mesh_queue;
+   hull_queue_t&            m_hull_queue;
+   mesh_queue_t&            m_mesh_queue;
+   mesh_memory::scope&      m_memory;
    safe_queue<std::string>& m_exception_queue;
 };
 
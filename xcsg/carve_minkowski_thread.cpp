@@ -3,7 +3,10 @@
 #include "carve_boolean.h"
 #include "carve_triangulate.h"
 #include "carve_boolean_thread.h"
+#include "boolean_checkpoint.h"
 #include "xpolyhedron.h"
+#include "qhull/qhull3d.h"
+#include "boolean_timer.h"
 
 #include <map>
 
@@ -13,7 +16,7 @@ carve_minkowski_thread::carve_minkowski_thread()
 carve_minkowski_thread::~carve_minkowski_thread()
 {}
 
-void carve_minkowski_thread::add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, MeshSet_ptr meshB, safe_queue<hull_pair>& hull_queue)
+void carve_minkowski_thread::add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, Vertices_ptr vertB, hull_queue_t& hull_queue)
 {
    size_t nfaces = poly->faces.size();
    std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
@@ -25,6 +28,7 @@ void carve_minkowski_thread::add_faces(std::shared_ptr<carve::poly::Polyhedron>
 
       // the face should always be triangular at this point
       size_t nv = poly->faces[iface].nVertices();
+      hp.first.reserve(nv);
       std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
       poly->faces[iface].getVertexLoop(vloop);
       for(size_t ivert=0; ivert<nv; ivert++) {
@@ -33,60 +37,155 @@ void carve_minkowski_thread::add_faces(std::shared_ptr<carve::poly::Polyhedron>
          hp.first.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
       }
 
-      hp.second = meshB;
-      hull_queue.enqueue(hp);
+      hp.second = vertB;
+      hull_queue.enqueue(std::move(hp));
    }
 }
 
 void carve_minkowski_thread::create_mesh_queue(const carve::math::Matrix& t,
-                                               std::list<std::shared_ptr<xsolid>> objects,
+                                               const std::list<std::shared_ptr<xsolid>>& objects,
                                                safe_queue<MeshSet_ptr>& mesh_queue)
 {
    if(objects.size() != 2) {
       throw logic_error("carve_minkowski_thread: expected 2 object parameters, but got " + objects.size());
    }
 
-   // first create meshes for for A and B, stored in "objects"
-   // we do this synchronously here, so that the order of the parameters are guaranteed
+   // first get the hull vertices of B, stored in "objects".
+   // Only the convex hull of B is used, so B is not meshed when it is a convex primitive
    auto i = objects.begin();
-   MeshSet_ptr meshA = (*i++)->create_carve_mesh(t);
-   MeshSet_ptr meshB = (*i++)->create_carve_mesh(t);
-
-   // meshA goes straight into the mesh queue as it will be unioned
-   // with the hull meshes
-   mesh_queue.enqueue(meshA);
-
-   // extract coordinates for all faces in A and build the hull queue.
-   // The hull queue contains the B mesh pluss perturbation coordinates
-   // for computing a hull mesh, based on A faces
-   safe_queue<hull_pair> hull_queue;
-
-   // triangulate meshA so we are sure it contains only triangular (i.e. convex) faces
-   // then add all faces to the hull_queue
-   auto polyA = triangulate(meshA);
-   for(size_t ipoly=0; ipoly<polyA->size(); ipoly++) {
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*polyA)[ipoly];
-      add_faces(poly,meshB,hull_queue);
+   std::shared_ptr<xsolid> objA = *i++;
+   std::shared_ptr<xsolid> objB = *i++;
+   std::vector<xvertex> hull_vertB;
+   objB->append_hull_vertices(hull_vertB,t);
+   Vertices_ptr vertB(new carve_minkowski_hull::packed_vertices(hull_vertB));
+
+   // The hull queue contains the B vertices pluss perturbation coordinates
+   // for computing a hull mesh, i.e. the hull of all pairwise vertex sums
+   hull_queue_t hull_queue;
+
+   // hull meshes are unioned in this queue while they are computed
+   mesh_queue_t union_queue;
+   mesh_memory::scope memory(mesh_memory::MINKOWSKI);
+
+   // When A is a union of convex parts, the minkowski sum is the union of one hull per part
+   std::vector<std::vector<xvertex>> partsA;
+   if(objA->append_convex_parts(partsA,t) && partsA.size() > 0) {
+      hull_queue.reserve(partsA.size());
+      for(size_t ipart=0; ipart<partsA.size(); ipart++) {
+         hull_queue.emplace(std::move(partsA[ipart]),vertB);
+      }
+   }
+   else {
+      // create the mesh for A synchronously here, so that the order of the parameters are guaranteed
+      MeshSet_ptr meshA = objA->create_carve_mesh(t);
+
+      // a convex A mesh needs only one hull and no union
+      std::vector<xvertex> vertA;
+      if(is_convex(meshA,vertA)) {
+         hull_queue.emplace(std::move(vertA),vertB);
+      }
+      else {
+         // meshA goes straight into the union queue as it will be unioned
+         // with the hull meshes
+         memory.add(meshA.get());
+         union_queue.enqueue(meshA);
+
+         // extract coordinates for all faces in A and build the hull queue, based on A faces.
+         // triangulate meshA so we are sure it contains only triangular (i.e. convex) faces
+         // then add all faces to the hull_queue
+         auto polyA = triangulate(meshA);
+         size_t nfaces = 0;
+         for(size_t ipoly=0; ipoly<polyA->size(); ipoly++) nfaces += (*polyA)[ipoly]->faces.size();
+         hull_queue.reserve(nfaces);
+         for(size_t ipoly=0; ipoly<polyA->size(); ipoly++) {
+            std::shared_ptr<carve::poly::Polyhedron> poly = (*polyA)[ipoly];
+            add_faces(poly,vertB,hull_queue);
+         }
+      }
    }
 
-   // compute the hull meshes and store them in the mesh queue
+   // improve the timer estimate now that the number of booleans is known for this operation
+   boolean_timer::singleton().add_nbool(static_cast<int>(hull_queue.size()+union_queue.size()));
+
+   // every hull mesh is a result still to arrive in the union queue
+   union_queue.add_outstanding(hull_queue.size());
+
+   // compute the hull meshes and union them as they arrive
    const size_t nthreads = std::min(carve_boolean_thread::default_nthreads(),hull_queue.size());
    safe_queue<std::string>   exception_queue;
-   std::list<boost::thread>  hull_threads;
+   task_group hull_tasks;
    for(size_t i=0; i<nthreads; i++) {
-      hull_threads.push_back(boost::thread(carve_minkowski_hull(hull_queue,mesh_queue,exception_queue)));
+      hull_tasks.run(carve_minkowski_hull(hull_queue,union_queue,memory,exception_queue));
    }
 
-   // wait for the threads to finish
-   for(auto ithread=hull_threads.begin(); ithread!=hull_threads.end(); ithread++) {
-      ithread->join();
-   }
+   // wait for the tasks to finish
+   hull_tasks.wait();
 
    if(exception_queue.size() > 0) {
       throw std::logic_error(exception_queue.dequeue());
    }
 
-   // the mesh queue is now complete
+   // return the result, in deterministic mode and with checkpoints the hulls are still to be unioned
+   MeshSet_ptr mesh;
+   if(carve_boolean::deterministic() || boolean_checkpoint::singleton().enabled()) {
+      safe_queue<MeshSet_ptr> hull_meshes;
+      while(union_queue.try_dequeue(mesh)) hull_meshes.enqueue(std::move(mesh));
+      carve_boolean_thread::compute(hull_meshes,carve::csg::CSG::UNION);
+      while(hull_meshes.try_dequeue(mesh)) mesh_queue.enqueue(std::move(mesh));
+      return;
+   }
+   while(union_queue.try_dequeue(mesh)) {
+      mesh_queue.enqueue(std::move(mesh));
+   }
+}
+
+// signed volume of the tetrahedron (origin,a,b,c)
+static inline double tet_volume(const xvertex& a, const xvertex& b, const xvertex& c)
+{
+   return (  a.v[0]*(b.v[1]*c.v[2] - b.v[2]*c.v[1])
+           + a.v[1]*(b.v[2]*c.v[0] - b.v[0]*c.v[2])
+           + a.v[2]*(b.v[0]*c.v[1] - b.v[1]*c.v[0]) )/6.0;
+}
+
+bool carve_minkowski_thread::is_convex(MeshSet_ptr mesh_set, std::vector<xvertex>& vertices)
+{
+   if(mesh_set->meshes.size() != 1) return false;
+
+   size_t nvert = mesh_set->vertex_storage.size();
+   vertices.clear();
+   vertices.reserve(nvert);
+   for(size_t i=0; i<nvert; i++) vertices.push_back(mesh_set->vertex_storage[i].v);
+
+   // volume of the closed mesh, from face fans
+   double volume = 0.0;
+   carve::mesh::Mesh<3>* mesh = mesh_set->meshes[0];
+   for(size_t iface=0; iface<mesh->faces.size(); iface++) {
+      std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+      mesh->faces[iface]->getVertices(verts);
+      for(size_t i=2; i<verts.size(); i++) {
+         volume += tet_volume(verts[0]->v,verts[i-1]->v,verts[i]->v);
+      }
+   }
+   if(volume <= 0.0) return false;
+
+   // a closed mesh is convex when its volume equals the volume of its hull
+   qhull3d qhull;
+   qhull.reserve(nvert);
+   for(size_t i=0; i<nvert; i++) qhull.push_back(vertices[i].v[0],vertices[i].v[1],vertices[i].v[2]);
+   if(!qhull.compute()) return false;
+
+   double hull_volume = 0.0;
+   for(size_t iface=0; iface<qhull.nfaces(); iface++) {
+      qhull3d::face_vertex_iterator fv = qhull.face_begin(iface);
+      const qhull3d::xyz& p0 = qhull.vertex(fv[0]);
+      for(size_t i=2; i<qhull.face_size(iface); i++) {
+         const qhull3d::xyz& p1 = qhull.vertex(fv[i-1]);
+         const qhull3d::xyz& p2 = qhull.vertex(fv[i]);
+         hull_volume += tet_volume(carve::geom::VECTOR(p0.x,p0.y,p0.z),carve::geom::VECTOR(p1.x,p1.y,p1.z),carve::geom::VECTOR(p2.x,p2.y,p2.z));
+      }
+   }
+
+   return (hull_volume-volume) <= 1.0E-6*hull_volume;
 }
 
 std::shared_ptr<std::vector<std::shared_ptr<carve::poly::Polyhedron>>> carve_minkowski_thread::triangulate(MeshSet_ptr mesh_set)
@@ -102,16 +201,8 @@ std::shared_ptr<std::vector<std::shared_ptr<carve::poly::Polyhedron>>> carve_min
    for(size_t imani=0; imani<nmani; imani++) {
       std::shared_ptr<xpolyhedron> poly = csg.create_manifold(imani);
 
-      // check if there are any non-triangular faces
-      bool must_triangulate = false;
-      size_t nfaces = poly->f_size();
-      for(size_t iface=0;iface<nfaces; iface++) {
-         const xface& face = poly->f_get(iface);
-         if(face.size() > 3) {
-            must_triangulate = true;
-            break;
-         }
-      }
+      // check if there are any non-triangular faces, from the face offsets only
+      bool must_triangulate = (poly->num_non_tri() > 0);
 
       if(must_triangulate) {
          bool improve = false;
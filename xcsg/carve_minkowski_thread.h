@@ -3,8 +3,9 @@
 
 #include <memory>
 #include <string>
-#include <boost/thread.hpp>
+#include "thread_pool.h"
 #include "safe_queue.h"
+#include "carve_minkowski_hull.h"
 #include <carve/poly.hpp>
 #include "xsolid.h"
 
@@ -14,18 +15,25 @@
 class carve_minkowski_thread {
 public:
    typedef std::shared_ptr<carve::mesh::MeshSet<3>>     MeshSet_ptr;
-   typedef std::pair<std::vector<xvertex>,MeshSet_ptr>  hull_pair;
+   typedef carve_minkowski_hull::Vertices_ptr           Vertices_ptr;
+   typedef carve_minkowski_hull::hull_pair              hull_pair;
+   typedef carve_minkowski_hull::hull_queue_t           hull_queue_t;
+   typedef carve_minkowski_hull::mesh_queue_t           mesh_queue_t;
 
    carve_minkowski_thread();
    virtual ~carve_minkowski_thread();
 
-   // build the mesh queue
+   // compute the minkowski sum, hulls and their union run as one pipeline.
+   // On return, mesh_queue contains the result mesh
    static void create_mesh_queue(const carve::math::Matrix& t,
-                                 std::list<std::shared_ptr<xsolid>> objects,
+                                 const std::list<std::shared_ptr<xsolid>>& objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
 
 protected:
-   static void add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, MeshSet_ptr meshB, safe_queue<hull_pair>& hull_queue);
+   static void add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, Vertices_ptr vertB, hull_queue_t& hull_queue);
+
+   // true when mesh_set is a single convex manifold, vertices returns its vertex coordinates
+   static bool is_convex(MeshSet_ptr mesh_set, std::vector<xvertex>& vertices);
 
    // create triangulated polyhedra from mesh
    static std::shared_ptr<std::vector<std::shared_ptr<carve::poly::Polyhedron>>>  triangulate(MeshSet_ptr mesh);
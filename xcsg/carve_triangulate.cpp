@@ -18,7 +18,13 @@
 #include <carve/csg_triangulator.hpp>
 
 #include "carve_triangulate_face.h"
+#include "thread_pool.h"
 #include <forward_list>
+#include <algorithm>
+#include <stdexcept>
+
+// minimum number of output triangles per parallel triangulation task
+static const size_t min_chunk = 4096;
 
 // #include <boost/filesystem.hpp>
 // #include <boost/filesystem/convenience.hpp>
@@ -68,27 +74,27 @@ static double polyhedron_face_area( const carve::poly::Polyhedron::vertex_t* va,
 
 size_t carve_triangulate::compute(std::shared_ptr<carve::poly::Polyhedron> poly, bool improve, bool canonicalize, bool degen_check)
 {
-   // copy all vertices from onput polyhedron
-   std::vector<carve::poly::Vertex<3> > out_vertices = poly->vertices;
+   std::shared_ptr<carve::poly::Polyhedron> poly_triangle = triangulated(poly,improve,canonicalize,degen_check,std::cout);
 
-   // storage for triangulated vertices
-   std::vector<carve::poly::Face<3> > out_faces;
+   // add to the vector of triangulated polyhedrons
+   m_polyset->push_back(poly_triangle);
 
-   // compute number of output faces
-   size_t N = 0;
-   for (size_t i = 0; i < poly->faces.size(); ++i) {
-      carve::poly::Face<3> &f = poly->faces[i];
-      N += f.nVertices() - 2;
-   }
-   out_faces.reserve(N);
+   // return number of faces after triangulation
+   return poly_triangle->faces.size();
+}
 
-   // triangulate each face
+// triangulate faces [ifirst,ilast) of poly, the output faces refer to out_vertices.
+// Returns the number of zero area triangles dropped
+static size_t triangulate_faces(carve::poly::Polyhedron& poly, size_t ifirst, size_t ilast, bool improve, bool degen_check,
+                                std::vector<carve::poly::Vertex<3> >& out_vertices, std::vector<carve::poly::Face<3> >& out_faces)
+{
    size_t nzero_dropped = 0;
-   for(size_t i = 0; i < poly->faces.size(); ++i) {
-      carve::poly::Face<3> &f = poly->faces[i];
-      std::vector<carve::triangulate::tri_idx> result;
-
-      std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
+   std::vector<carve::triangulate::tri_idx> result;
+   std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
+   for(size_t i = ifirst; i < ilast; ++i) {
+      carve::poly::Face<3> &f = poly.faces[i];
+      result.clear();
+      vloop.clear();
       f.getVertexLoop(vloop);
 
       carve::triangulate::triangulate(carve::poly::p2_adapt_project<3>(f.project), vloop, result);
@@ -104,9 +110,9 @@ size_t carve_triangulate::compute(std::shared_ptr<carve::poly::Polyhedron> poly,
 
         if(0 <  face_area ) {
             out_faces.push_back(carve::poly::Face<3>(
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].a])],
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].b])],
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].c])]
+               &out_vertices[poly.vertexToIndex_fast(vloop[result[j].a])],
+               &out_vertices[poly.vertexToIndex_fast(vloop[result[j].b])],
+               &out_vertices[poly.vertexToIndex_fast(vloop[result[j].c])]
             ));
         }
         else {
@@ -114,19 +120,78 @@ size_t carve_triangulate::compute(std::shared_ptr<carve::poly::Polyhedron> poly,
         }
       }
    }
-   if(nzero_dropped>0) std::cout << ">>> Warning: dropped "<<nzero_dropped <<" zero area triangles(s) during triangulation." << std::endl;
+   return nzero_dropped;
+}
+
+std::shared_ptr<carve::poly::Polyhedron> carve_triangulate::triangulated(std::shared_ptr<carve::poly::Polyhedron> poly, bool improve, bool canonicalize, bool degen_check, std::ostream& out)
+{
+   // copy all vertices from onput polyhedron
+   std::vector<carve::poly::Vertex<3> > out_vertices = poly->vertices;
+
+   // storage for triangulated vertices
+   std::vector<carve::poly::Face<3> > out_faces;
+
+   // compute number of output faces
+   size_t N = 0;
+   for (size_t i = 0; i < poly->faces.size(); ++i) {
+      carve::poly::Face<3> &f = poly->faces[i];
+      N += f.nVertices() - 2;
+   }
+   out_faces.reserve(N);
+
+   // triangulate each face, in parallel chunks of similar size when there is enough work.
+   // Each chunk has its own output, the chunks are concatenated in face order
+   size_t nzero_dropped = 0;
+   const size_t nfaces = poly->faces.size();
+   const size_t ntask  = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),N/min_chunk));
+   if(ntask <= 1) {
+      nzero_dropped = triangulate_faces(*poly,0,nfaces,improve,degen_check,out_vertices,out_faces);
+   }
+   else {
+      // chunk boundaries, balanced by number of triangles
+      std::vector<size_t> first(ntask+1,nfaces);
+      first[0] = 0;
+      size_t ntri = 0;
+      size_t itask = 1;
+      for(size_t i = 0; i < nfaces && itask < ntask; ++i) {
+         ntri += poly->faces[i].nVertices() - 2;
+         if(ntri >= (N*itask)/ntask) first[itask++] = i+1;
+      }
+
+      std::vector<std::vector<carve::poly::Face<3> >> task_faces(ntask);
+      std::vector<size_t> task_dropped(ntask,0);
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         carve::poly::Polyhedron* p = poly.get();
+         std::vector<carve::poly::Vertex<3> >* vertices = &out_vertices;
+         std::vector<carve::poly::Face<3> >* faces = &task_faces[itask];
+         size_t* dropped = &task_dropped[itask];
+         size_t ifirst = first[itask];
+         size_t ilast  = first[itask+1];
+         tasks.run([p,ifirst,ilast,improve,degen_check,vertices,faces,dropped]() {
+            try {
+               *dropped = triangulate_faces(*p,ifirst,ilast,improve,degen_check,*vertices,*faces);
+            }
+            catch(carve::exception& ex) {
+               throw std::runtime_error("(carve error): " + ex.str());
+            }
+         });
+      }
+      tasks.wait();
+
+      for(size_t itask=0; itask<ntask; itask++) {
+         out_faces.insert(out_faces.end(),task_faces[itask].begin(),task_faces[itask].end());
+         nzero_dropped += task_dropped[itask];
+      }
+   }
+   if(nzero_dropped>0) out << ">>> Warning: dropped "<<nzero_dropped <<" zero area triangles(s) during triangulation." << std::endl;
 
    // create the new polyhedron
    std::shared_ptr<carve::poly::Polyhedron> poly_triangle(new carve::poly::Polyhedron(out_faces, out_vertices));
    if(canonicalize) {
       poly_triangle->canonicalize();
    }
-
-   // add to the vector of triangulated polyhedrons
-   m_polyset->push_back(poly_triangle);
-
-   // return number of faces after triangulation
-   return poly_triangle->faces.size();
+   return poly_triangle;
 }
 
 void carve_triangulate::add(std::shared_ptr<carve::poly::Polyhedron> poly)
@@ -31,6 +31,10 @@ public:
    // compute triangulated polyhedron and add to polyset
    size_t compute(std::shared_ptr<carve::poly::Polyhedron> poly, bool improve, bool canonicalize, bool degen_check);
 
+   // compute and return triangulated polyhedron without adding it, warnings are written to out.
+   // Independent polyhedra may be triangulated in parallel this way
+   static std::shared_ptr<carve::poly::Polyhedron> triangulated(std::shared_ptr<carve::poly::Polyhedron> poly, bool improve, bool canonicalize, bool degen_check, std::ostream& out);
+
    // compute triangulated polyhedron and add to polyset, alternative implementation
    size_t compute2d(std::shared_ptr<carve::poly::Polyhedron> poly);
 
@@ -16,7 +16,39 @@
 #include "clipper_boolean.h"
 
 #include "boolean_timer.h"
+#include "thread_pool.h"
+#include "thread_engine.h"
 #include <boost/date_time.hpp>
+#include <algorithm>
+
+// a reused Clipper starts without the paths of the previous operation
+template <>
+inline void thread_engine_clear(ClipperLib::Clipper& clipper) { clipper.Clear(); }
+
+// minimum number of profiles per task in a parallel union
+static const size_t min_union_chunk = 8;
+
+// minimum number of vertices in the operands before a boolean is tiled
+static const size_t min_tiled_vertices = 200000;
+
+// bounding box of a path
+struct path_box {
+   path_box() : xmin(0), xmax(0), ymin(0), ymax(0) {}
+   path_box(const ClipperLib::Path& path)
+   : xmin(path[0].X), xmax(path[0].X), ymin(path[0].Y), ymax(path[0].Y)
+   {
+      for(auto& p : path) {
+         xmin = std::min(xmin,p.X); xmax = std::max(xmax,p.X);
+         ymin = std::min(ymin,p.Y); ymax = std::max(ymax,p.Y);
+      }
+   }
+   void add(const path_box& b)
+   {
+      xmin = std::min(xmin,b.xmin); xmax = std::max(xmax,b.xmax);
+      ymin = std::min(ymin,b.ymin); ymax = std::max(ymax,b.ymax);
+   }
+   ClipperLib::cInt xmin,xmax,ymin,ymax;
+};
 
 clipper_boolean::clipper_boolean()
 {}
@@ -31,53 +63,278 @@ bool clipper_boolean::compute(std::shared_ptr<clipper_profile> b, ClipperLib::Cl
    if(!m_profile.get()) {
       m_profile = b;
    }
+   else if(thread_pool::singleton().nthreads() > 1 && nvertices(m_profile->paths())+nvertices(b->paths()) >= min_tiled_vertices) {
+      success = compute_tiled(b,op,thread_pool::singleton().nthreads());
+   }
    else {
       boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
 
       success = false;
-      ClipperLib::Clipper clipper;
-      clipper.AddPaths(m_profile->paths(),ClipperLib::ptSubject,true);
-      clipper.AddPaths(b->paths(),ClipperLib::ptClip,true);
+      thread_engine<ClipperLib::Clipper> clipper;
+      clipper->AddPaths(m_profile->paths(),ClipperLib::ptSubject,true);
+      clipper->AddPaths(b->paths(),ClipperLib::ptClip,true);
       std::shared_ptr<clipper_profile> result(new clipper_profile);
-      success = clipper.Execute(op, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+      success = clipper->Execute(op, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero);
       if(success) {
-         ClipperLib::CleanPolygons(result->paths());
+         clipper.dismiss();
+         result->set_dirty();
          m_profile = result;
       }
       else {
          throw std::logic_error("clipper_boolean::compute, operation failed");
       }
       boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
-      double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+      double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
 
       boolean_timer::singleton().add_elapsed(elapsed_sec);
    }
    return success;
 }
 
+bool clipper_boolean::compute_union(const profile_vector& profiles)
+{
+   // a single profile is taken as is, like in compute()
+   if(profiles.size() == 0) return true;
+   if(!m_profile.get() && profiles.size() == 1) {
+      m_profile = profiles[0];
+      return true;
+   }
+
+   // large unions are reduced as a tree, the chunks are unioned in parallel
+   size_t nthreads = thread_pool::singleton().nthreads();
+   if(nthreads > 1 && profiles.size() >= 2*min_union_chunk) {
+      size_t ntask = std::min(nthreads,profiles.size()/min_union_chunk);
+      profile_vector partial(ntask);
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         size_t ibeg = (itask*profiles.size())/ntask;
+         size_t iend = ((itask+1)*profiles.size())/ntask;
+         std::shared_ptr<clipper_profile>* slot = &partial[itask];
+         tasks.run([&profiles,ibeg,iend,slot]() {
+            clipper_boolean csg;
+            csg.compute_union(profile_vector(profiles.begin()+ibeg,profiles.begin()+iend));
+            *slot = csg.profile();
+         });
+      }
+      tasks.wait();
+      return compute_union(partial);
+   }
+
+   boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
+
+   // with non-zero filling, all subject paths are unioned by one Execute
+   thread_engine<ClipperLib::Clipper> clipper;
+   if(m_profile.get()) clipper->AddPaths(m_profile->paths(),ClipperLib::ptSubject,true);
+   for(auto& p : profiles) {
+      clipper->AddPaths(p->paths(),ClipperLib::ptSubject,true);
+   }
+   std::shared_ptr<clipper_profile> result(new clipper_profile);
+   bool success = clipper->Execute(ClipperLib::ctUnion, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+   if(success) {
+      clipper.dismiss();
+      result->set_dirty();
+      m_profile = result;
+   }
+   else {
+      throw std::logic_error("clipper_boolean::compute_union, operation failed");
+   }
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
+   double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
+
+   boolean_timer::singleton().add_elapsed(elapsed_sec);
+   return success;
+}
+
+bool clipper_boolean::compute_fill(const profile_vector& profiles)
+{
+   boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
+
+   // without the negative paths, positive filling leaves no holes
+   ClipperLib::Paths paths;
+   if(m_profile.get()) m_profile->positive_paths(paths);
+   for(auto& p : profiles) p->positive_paths(paths);
+
+   thread_engine<ClipperLib::Clipper> clipper;
+   clipper->AddPaths(paths,ClipperLib::ptSubject,true);
+   std::shared_ptr<clipper_profile> result(new clipper_profile);
+   bool success = clipper->Execute(ClipperLib::ctUnion, result->paths(), ClipperLib::pftPositive, ClipperLib::pftPositive);
+   if(success) {
+      clipper.dismiss();
+      result->set_dirty();
+      m_profile = result;
+   }
+   else {
+      throw std::logic_error("clipper_boolean::compute_fill, operation failed");
+   }
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
+   double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
+
+   boolean_timer::singleton().add_elapsed(elapsed_sec);
+   return success;
+}
+
+size_t clipper_boolean::nvertices(const ClipperLib::Paths& paths)
+{
+   size_t nvert = 0;
+   for(auto& path : paths) nvert += path.size();
+   return nvert;
+}
+
+bool clipper_boolean::compute_tiled(std::shared_ptr<clipper_profile> b, ClipperLib::ClipType op, size_t nstrips)
+{
+   if(!m_profile.get()) {
+      m_profile = b;
+      return true;
+   }
+
+   boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
+
+   // bounding boxes of all paths, so each strip only sees the paths overlapping it
+   const ClipperLib::Paths& a_paths = m_profile->paths();
+   const ClipperLib::Paths& b_paths = b->paths();
+   std::vector<path_box> a_boxes, b_boxes;
+   path_box box;
+   bool has_box = false;
+   for(auto& path : a_paths) {
+      a_boxes.push_back((path.size()>0)? path_box(path) : path_box());
+      if(path.size() > 0) { if(has_box) box.add(a_boxes.back()); else box = a_boxes.back(); has_box = true; }
+   }
+   for(auto& path : b_paths) {
+      b_boxes.push_back((path.size()>0)? path_box(path) : path_box());
+      if(path.size() > 0) { if(has_box) box.add(b_boxes.back()); else box = b_boxes.back(); has_box = true; }
+   }
+   if(!has_box || nstrips < 2 || box.xmax-box.xmin < static_cast<ClipperLib::cInt>(2*nstrips)) {
+      nstrips = 1;
+   }
+
+   // the strips share their integer boundaries, so the stitched result is exact
+   std::vector<ClipperLib::Paths> strips(nstrips);
+   task_group tasks;
+   for(size_t istrip=0; istrip<nstrips; istrip++) {
+      ClipperLib::cInt x0 = box.xmin + ((box.xmax-box.xmin)*static_cast<ClipperLib::cInt>(istrip))/static_cast<ClipperLib::cInt>(nstrips);
+      ClipperLib::cInt x1 = box.xmin + ((box.xmax-box.xmin)*static_cast<ClipperLib::cInt>(istrip+1))/static_cast<ClipperLib::cInt>(nstrips);
+      if(istrip == 0)         x0 -= 1;
+      if(istrip == nstrips-1) x1 += 1;
+      ClipperLib::Paths* strip = &strips[istrip];
+      tasks.run([&a_paths,&b_paths,&a_boxes,&b_boxes,&box,x0,x1,op,strip]() {
+         ClipperLib::Path rect;
+         rect.push_back(ClipperLib::IntPoint(x0,box.ymin-1));
+         rect.push_back(ClipperLib::IntPoint(x1,box.ymin-1));
+         rect.push_back(ClipperLib::IntPoint(x1,box.ymax+1));
+         rect.push_back(ClipperLib::IntPoint(x0,box.ymax+1));
+
+         // clip an operand to the strip
+         auto clip_to_strip = [&rect,x0,x1](const ClipperLib::Paths& paths, const std::vector<path_box>& boxes, ClipperLib::Paths& clipped) {
+            thread_engine<ClipperLib::Clipper> clipper;
+            for(size_t i=0; i<paths.size(); i++) {
+               if(paths[i].size() > 0 && boxes[i].xmax >= x0 && boxes[i].xmin <= x1) clipper->AddPath(paths[i],ClipperLib::ptSubject,true);
+            }
+            clipper->AddPath(rect,ClipperLib::ptClip,true);
+            if(clipper->Execute(ClipperLib::ctIntersection, clipped, ClipperLib::pftNonZero, ClipperLib::pftNonZero)) clipper.dismiss();
+         };
+         ClipperLib::Paths a_strip, b_strip;
+         clip_to_strip(a_paths,a_boxes,a_strip);
+         clip_to_strip(b_paths,b_boxes,b_strip);
+
+         thread_engine<ClipperLib::Clipper> clipper;
+         clipper->AddPaths(a_strip,ClipperLib::ptSubject,true);
+         clipper->AddPaths(b_strip,ClipperLib::ptClip,true);
+         if(!clipper->Execute(op, *strip, ClipperLib::pftNonZero, ClipperLib::pftNonZero)) {
+            throw std::logic_error("clipper_boolean::compute_tiled, strip operation failed");
+         }
+         clipper.dismiss();
+      });
+   }
+   tasks.wait();
+
+   // stitch the strips, the union only merges along the strip boundaries.
+   // The collinear seam vertices are removed when the profile is cleaned
+   thread_engine<ClipperLib::Clipper> clipper;
+   for(auto& strip : strips) clipper->AddPaths(strip,ClipperLib::ptSubject,true);
+   std::shared_ptr<clipper_profile> result(new clipper_profile);
+   bool success = clipper->Execute(ClipperLib::ctUnion, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+   if(success) {
+      clipper.dismiss();
+      result->set_dirty();
+      m_profile = result;
+   }
+   else {
+      throw std::logic_error("clipper_boolean::compute_tiled, operation failed");
+   }
+
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
+   double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
+
+   boolean_timer::singleton().add_elapsed(elapsed_sec);
+   return success;
+}
+
 bool clipper_boolean::minkowski_sum(std::shared_ptr<clipper_profile> a, std::shared_ptr<clipper_profile> b_brush )
 {
-   ClipperLib::Clipper clipper;
-   ClipperLib::Paths& a_paths = a->paths();
-   ClipperLib::Paths& b_paths = b_brush->paths();
-   if(b_paths.size() != 1) {
-      throw std::logic_error("clipper_boolean::minkowski_sum, 'b' parameter must contain exactly one path");
+   const ClipperLib::Paths& a_paths = a->paths();
+   const ClipperLib::Paths& b_paths = b_brush->paths();
+
+   // decompose the brush into its outer contours, any brush holes are filled.
+   // A profile consisting of a single path is used as is, regardless of orientation
+   std::vector<const ClipperLib::Path*> patterns;
+   for(auto& path : b_paths) {
+      if(path.size() > 0 && (b_paths.size() == 1 || ClipperLib::Orientation(path))) patterns.push_back(&path);
+   }
+   if(patterns.size() == 0) {
+      throw std::logic_error("clipper_boolean::minkowski_sum, 'b' parameter contains no usable paths");
    }
+   std::vector<const ClipperLib::Path*> paths;
+   for(auto& path : a_paths) {
+      if(path.size() > 0) paths.push_back(&path);
+   }
+   if(paths.size() == 0) return false;
 
    boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
 
-   ClipperLib::Path& pattern = b_paths[0];
+   // The sum is the union of each brush contour swept along the boundary of each path in a,
+   // plus 'a' translated to a brush vertex and each brush contour translated to a vertex in 'a'.
+   // The sweeps are independent and computed in parallel
+   std::vector<ClipperLib::Paths> sweeps(patterns.size()*paths.size());
+   task_group tasks;
+   for(size_t ib=0; ib<patterns.size(); ib++) {
+      for(size_t ia=0; ia<paths.size(); ia++) {
+         const ClipperLib::Path* pattern = patterns[ib];
+         const ClipperLib::Path* path    = paths[ia];
+         ClipperLib::Paths* sweep        = &sweeps[ib*paths.size()+ia];
+         tasks.run([pattern,path,sweep]() { ClipperLib::MinkowskiSum(*pattern,*path,*sweep,true); });
+      }
+   }
+
+   // translate a path by a vertex
+   auto translated = [](const ClipperLib::Path& path, const ClipperLib::IntPoint& delta) {
+      ClipperLib::Path result;
+      result.reserve(path.size());
+      for(auto& p : path) result.push_back(ClipperLib::IntPoint(p.X+delta.X,p.Y+delta.Y));
+      return result;
+   };
+
+   // 'a' is added as clip paths so that it keeps its own winding, everything else is positive
+   thread_engine<ClipperLib::Clipper> clipper;
+   for(size_t ib=0; ib<patterns.size(); ib++) {
+      const ClipperLib::Path& pattern = *patterns[ib];
+      for(auto path : paths) clipper->AddPath(translated(*path,pattern[0]),ClipperLib::ptClip,true);
+      ClipperLib::Path brush = translated(pattern,(*paths[0])[0]);
+      if(!ClipperLib::Orientation(brush)) ClipperLib::ReversePath(brush);
+      clipper->AddPath(brush,ClipperLib::ptSubject,true);
+   }
+   tasks.wait();
+   for(auto& sweep : sweeps) clipper->AddPaths(sweep,ClipperLib::ptSubject,true);
+
    std::shared_ptr<clipper_profile> result(new clipper_profile);
-   bool pathIsClosed = true;
-   ClipperLib::MinkowskiSum(pattern,a_paths,result->paths(),pathIsClosed);
+   if(clipper->Execute(ClipperLib::ctUnion, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero)) clipper.dismiss();
    bool success = result->paths().size() > 0;
    if(success) {
-      ClipperLib::CleanPolygons(result->paths());
+      result->set_dirty();
       m_profile = result;
    }
 
    boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
-   double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+   double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
 
    boolean_timer::singleton().add_elapsed(elapsed_sec);
 
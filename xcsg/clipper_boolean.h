@@ -18,15 +18,30 @@
 
 #include "clipper_csg/clipper_profile.h"
 #include <memory>
+#include <vector>
 
 class clipper_boolean {
 public:
+   typedef std::vector<std::shared_ptr<clipper_profile>> profile_vector;
+
    clipper_boolean();
    virtual ~clipper_boolean();
 
    // compute boolean against current mesh using a MeshSet as "b"
    bool compute(std::shared_ptr<clipper_profile> b, ClipperLib::ClipType op);
 
+   // union the current profile with all the given profiles in a single clipper operation
+   bool compute_union(const profile_vector& profiles);
+
+   // union the current profile with the positive paths of the given profiles in a single clipper operation,
+   // i.e. the profiles with all holes filled
+   bool compute_fill(const profile_vector& profiles);
+
+   // same as compute(), but the plane is split into nstrips vertical strips
+   // that are computed in parallel and then stitched together.
+   // compute() uses this automatically for very large profiles
+   bool compute_tiled(std::shared_ptr<clipper_profile> b, ClipperLib::ClipType op, size_t nstrips);
+
    // sort contained profile paths according to area, with positive areas first
    void sort();
 
@@ -35,8 +50,13 @@ public:
 
    // compute minkowski sum of a and b_brush
    // a is assumed to be the main object and "b_brush" is "brushed" along the a path
+   // b_brush may contain several, possibly concave, contours. Holes in b_brush are ignored.
    bool minkowski_sum(std::shared_ptr<clipper_profile> a, std::shared_ptr<clipper_profile> b_brush );
 
+protected:
+   // total number of vertices in paths
+   static size_t nvertices(const ClipperLib::Paths& paths);
+
 private:
    std::shared_ptr<clipper_profile>  m_profile;
 };
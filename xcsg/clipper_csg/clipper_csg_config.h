@@ -17,7 +17,14 @@
 #define CLIPPER_CSG_CONFIG_H_INCLUDED
 
 #include "clipper.hpp"
-const ClipperLib::cInt TO_CLIPPER = (1 << 16);
+
+// scale factor from model coordinates to clipper integer coordinates.
+// A larger scale gives higher precision, a smaller scale gives more headroom for large coordinates.
+// Profiles remain in clipper coordinates through all 2d operations, the scale is applied at the boundaries only
+const ClipperLib::cInt DEFAULT_TO_CLIPPER = (1 << 16);
+inline ClipperLib::cInt& clipper_scale() { static ClipperLib::cInt scale = DEFAULT_TO_CLIPPER; return scale; }
+inline void set_clipper_scale(ClipperLib::cInt scale) { clipper_scale() = (scale > 0)? scale : DEFAULT_TO_CLIPPER; }
+#define TO_CLIPPER (clipper_scale())
 
 #ifdef _MSC_VER
 
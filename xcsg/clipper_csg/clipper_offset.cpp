@@ -14,40 +14,91 @@
 // EndLicense:
 
 #include "clipper_offset.h"
+#include "thread_pool.h"
+#include <algorithm>
 using namespace std;
 
 clipper_offset::clipper_offset()
+: m_arc_tolerance(0.005)
 {}
 
 clipper_offset::~clipper_offset()
 {}
 
 
-bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, double delta, bool round, bool chamfer)
+ClipperLib::JoinType clipper_offset::join_type(bool round, bool chamfer)
 {
    if(round) {
-      return compute(profile,delta,ClipperLib::jtRound);
+      return ClipperLib::jtRound;
    }
    else {
       if(chamfer) {
-         return compute(profile,delta,ClipperLib::jtSquare);
+         return ClipperLib::jtSquare;
       }
       else {
-         return compute(profile,delta,ClipperLib::jtMiter);
+         return ClipperLib::jtMiter;
       }
    }
 }
 
+bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, double delta, bool round, bool chamfer)
+{
+   return compute(profile,delta,join_type(round,chamfer));
+}
+
+bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, const std::vector<double>& deltas, bool round, bool chamfer, bool parallel)
+{
+   ClipperLib::JoinType op = join_type(round,chamfer);
+   m_profiles.clear();
+   m_profiles.resize(deltas.size());
+
+   // ClipperOffset::Execute modifies the offsetter, so each task prepares its own and reuses it for a range of deltas
+   size_t ntask = (parallel)? std::min(thread_pool::singleton().nthreads(),deltas.size()) : 1;
+   if(ntask <= 1) {
+      compute_range(profile,deltas,0,deltas.size(),op);
+   }
+   else {
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         size_t ifirst = (deltas.size()*itask)/ntask;
+         size_t ilast  = (deltas.size()*(itask+1))/ntask;
+         tasks.run([this,profile,&deltas,ifirst,ilast,op]() { compute_range(profile,deltas,ifirst,ilast,op); });
+      }
+      tasks.wait();
+   }
+
+   if(m_profiles.size() > 0) m_profile = m_profiles.back();
+   return true;
+}
+
+void clipper_offset::prepare(ClipperLib::ClipperOffset& offset, std::shared_ptr<clipper_profile> profile, ClipperLib::JoinType op, double arc_tolerance)
+{
+   offset.ArcTolerance = arc_tolerance* TO_CLIPPER;
+   offset.AddPaths(profile->paths(),op,ClipperLib::etClosedPolygon);
+}
+
+void clipper_offset::compute_range(std::shared_ptr<clipper_profile> profile, const std::vector<double>& deltas, size_t ifirst, size_t ilast, ClipperLib::JoinType op)
+{
+   double miterLimit = 1000000;
+   ClipperLib::ClipperOffset offset(miterLimit);
+   prepare(offset,profile,op,m_arc_tolerance);
+   for(size_t i=ifirst; i<ilast; i++) {
+      std::shared_ptr<clipper_profile> result(new clipper_profile);
+      offset.Execute(result->paths(), deltas[i] * TO_CLIPPER);
+      result->set_dirty();
+      m_profiles[i] = result;
+   }
+}
+
 // compute offset, store resut in member (input also affected)
 bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, double delta, ClipperLib::JoinType op)
 {
    double miterLimit = 1000000;
    ClipperLib::ClipperOffset offset(miterLimit);
-   offset.ArcTolerance = 0.005* TO_CLIPPER;
-   offset.AddPaths(profile->paths(),op,ClipperLib::etClosedPolygon);
+   prepare(offset,profile,op,m_arc_tolerance);
    std::shared_ptr<clipper_profile> result(new clipper_profile);
    offset.Execute(result->paths(), delta * TO_CLIPPER);
-   ClipperLib::CleanPolygons(result->paths());
+   result->set_dirty();
    m_profile = result;
 
    return true;
@@ -58,3 +109,8 @@ std::shared_ptr<clipper_profile> clipper_offset::profile()
 {
    return m_profile;
 }
+
+const std::vector<std::shared_ptr<clipper_profile>>& clipper_offset::profiles()
+{
+   return m_profiles;
+}
@@ -18,23 +18,44 @@
 
 #include "clipper_profile.h"
 #include <memory>
+#include <vector>
 
 class clipper_offset {
 public:
    clipper_offset();
    virtual ~clipper_offset();
 
+   // max distance between a round join and the true arc, in model units (0.005)
+   void set_arc_tolerance(double tol) { m_arc_tolerance = tol; }
+
    bool compute(std::shared_ptr<clipper_profile> profile, double delta, bool round, bool chamfer);
 
+   // compute offsets of the same profile for a list of deltas, the prepared offsetter is reused for all deltas.
+   // When parallel is true, the deltas are distributed over the thread pool
+   bool compute(std::shared_ptr<clipper_profile> profile, const std::vector<double>& deltas, bool round, bool chamfer, bool parallel = true);
+
    // return the offset profile
    std::shared_ptr<clipper_profile> profile();
 
+   // return the offset profiles of the multi delta compute, in the same order as the deltas
+   const std::vector<std::shared_ptr<clipper_profile>>& profiles();
+
 protected:
    // compute offset, store resut in member (input not affected)
    bool compute(std::shared_ptr<clipper_profile> profile, double delta, ClipperLib::JoinType op);
 
+   // compute offsets for deltas [ifirst,ilast> using a single offsetter, store results in m_profiles
+   void compute_range(std::shared_ptr<clipper_profile> profile, const std::vector<double>& deltas, size_t ifirst, size_t ilast, ClipperLib::JoinType op);
+
+   // prepare an offsetter for the given profile
+   static void prepare(ClipperLib::ClipperOffset& offset, std::shared_ptr<clipper_profile> profile, ClipperLib::JoinType op, double arc_tolerance);
+
+   static ClipperLib::JoinType join_type(bool round, bool chamfer);
+
 private:
-   std::shared_ptr<clipper_profile>  m_profile;
+   double                                         m_arc_tolerance;
+   std::shared_ptr<clipper_profile>               m_profile;
+   std::vector<std::shared_ptr<clipper_profile>>  m_profiles;
 };
 
 #endif // CLIPPER_OFFSET_H
@@ -14,11 +14,14 @@
 // EndLicense:
 
 #include "clipper_profile.h"
+#include "tmesh_adapter.h"
 #include <map>
+#include <algorithm>
 #include <iostream>
 using namespace std;
 
 clipper_profile::clipper_profile()
+: m_dirty(false)
 {}
 
 clipper_profile::~clipper_profile()
@@ -29,8 +32,23 @@ ClipperLib::Paths& clipper_profile::paths()
    return m_paths;
 }
 
+void clipper_profile::set_dirty()
+{
+   m_dirty = true;
+   m_mesh.reset();
+}
+
+void clipper_profile::clean()
+{
+   if(m_dirty) {
+      ClipperLib::CleanPolygons(m_paths);
+      m_dirty = false;
+   }
+}
+
 void clipper_profile::AddPaths(std::shared_ptr<ClipperLib::Paths> paths)
 {
+   m_mesh.reset();
    m_paths.reserve(m_paths.size()+paths->size());
    for(size_t i=0;i<paths->size(); i++) {
       m_paths.push_back((*paths)[i]);
@@ -39,11 +57,14 @@ void clipper_profile::AddPaths(std::shared_ptr<ClipperLib::Paths> paths)
 
 void clipper_profile::AddPath(const ClipperLib::Path& path)
 {
+   m_mesh.reset();
    m_paths.push_back(path);
 }
 
 std::shared_ptr<polyset2d> clipper_profile::polyset()
 {
+   clean();
+
    std::shared_ptr<polyset2d> pset(new polyset2d());
 
    // check orientation of 1st path
@@ -63,8 +84,19 @@ std::shared_ptr<polyset2d> clipper_profile::polyset()
    return pset;
 }
 
+std::shared_ptr<const polymesh2d> clipper_profile::mesh()
+{
+   if(!m_mesh.get()) {
+      tmesh_adapter tess;
+      tess.tesselate(polyset());
+      m_mesh = tess.mesh();
+   }
+   return m_mesh;
+}
+
 void clipper_profile::positive_profiles(std::list<std::shared_ptr<clipper_profile>>& profiles )
 {
+   clean();
    for(size_t i=0; i<m_paths.size(); i++) {
       bool positive = Orientation(m_paths[i]);
       if(positive) {
@@ -75,17 +107,30 @@ void clipper_profile::positive_profiles(std::list<std::shared_ptr<clipper_profil
    }
 }
 
+void clipper_profile::positive_paths(ClipperLib::Paths& paths)
+{
+   clean();
+   for(size_t i=0; i<m_paths.size(); i++) {
+      if(Orientation(m_paths[i])) paths.push_back(m_paths[i]);
+   }
+}
+
 void clipper_profile::sort()
 {
 //   cout << "   DEBUG: clipper_profile::sort(), number of paths= " << m_paths.size() << endl;
 
-   // build a sorted map of paths, largest positive areas first
-   std::multimap<double,ClipperLib::Path> path_map;
+   // sort path indices, largest positive areas first. Each area is computed once
+   // and the paths are moved into place rather than copied
+   std::vector<std::pair<double,size_t>> order;
+   order.reserve(m_paths.size());
    for(size_t i=0; i<m_paths.size(); i++) {
-      double area = ClipperLib::Area(m_paths[i]);
-      path_map.insert(std::make_pair(-area,m_paths[i]));
+      order.push_back(std::make_pair(-ClipperLib::Area(m_paths[i]),i));
    }
-   m_paths.clear();
-   m_paths.reserve(path_map.size());
-   for(auto p : path_map) m_paths.push_back(p.second);
+   std::stable_sort(order.begin(),order.end(),[](const std::pair<double,size_t>& a, const std::pair<double,size_t>& b) { return a.first < b.first; });
+
+   ClipperLib::Paths sorted;
+   sorted.reserve(m_paths.size());
+   for(auto& p : order) sorted.push_back(std::move(m_paths[p.second]));
+   m_paths.swap(sorted);
+   m_mesh.reset();
 }
@@ -19,6 +19,7 @@
 #include "clipper_csg_config.h"
 #include "clipper.hpp"
 #include "polyset2d.h"
+#include "polymesh2d.h"
 #include <list>
 
 // A clipper_profile represents the result of successive 2d booleans
@@ -38,18 +39,33 @@ public:
    // return access to the Clipper paths
    ClipperLib::Paths& paths();
 
-   // return a set of polygons for this profile
+   // mark the paths as possibly containing redundant vertices, i.e. a result of a clipper operation
+   void set_dirty();
+
+   // remove redundant vertices, only performed when the paths are marked dirty.
+   // This is done once before the profile leaves the 2d world (export, extrusion or meshing)
+   void clean();
+
+   // return a set of polygons for this profile, the profile is cleaned first
    std::shared_ptr<polyset2d> polyset();
 
+   // return the triangulated profile, used for extrusion caps. It is computed once and kept until the paths change
+   std::shared_ptr<const polymesh2d> mesh();
+
    // split this profile into a number of single contour profiles containing only positive winding order paths
    // negative winding order paths are discareded
    void positive_profiles(std::list<std::shared_ptr<clipper_profile>>& profiles );
 
+   // append the positive winding order paths of this profile to paths, negative ones are skipped
+   void positive_paths(ClipperLib::Paths& paths);
+
 protected:
    void AddPath(  const ClipperLib::Path& path);
 
 private:
    ClipperLib::Paths m_paths;
+   bool              m_dirty;  // true when clean() has work to do
+   std::shared_ptr<const polymesh2d> m_mesh;  // triangulation of the paths, computed on demand
 };
 
 #endif // CLIPPER_PROFILE_H
@@ -17,18 +17,22 @@
 #include "vmap2d.h"
 #include <utility>
 #include <map>
-#include <limits>
 #include <algorithm>
+#include <cmath>
+
+static const double pi = 4.0*atan(1.0);
 
 contour2d::contour2d()
+: m_edge_sum(0.0)
 {}
 
 contour2d::contour2d(const ClipperLib::Path& cpath)
+: m_edge_sum(0.0)
 {
    m_vert.reserve(cpath.size());
    for(size_t i=0; i<cpath.size(); i++) {
       const ClipperLib::IntPoint& v = cpath[i];
-      m_vert.push_back(dpos2d(double(v.X)/TO_CLIPPER,double(v.Y)/TO_CLIPPER));
+      push_back(dpos2d(double(v.X)/TO_CLIPPER,double(v.Y)/TO_CLIPPER));
    }
 }
 
@@ -38,6 +42,8 @@ contour2d::~contour2d()
 void contour2d::clear()
 {
    m_vert.clear();
+   m_box      = dbox2d();
+   m_edge_sum = 0.0;
 }
 
 void  contour2d::reserve(size_t nvert)
@@ -52,7 +58,14 @@ size_t contour2d::size() const
 
 void contour2d::push_back(const dpos2d& vertex)
 {
+   if(m_vert.size() > 0) add_edge_sum(m_vert.back(),vertex);
    m_vert.push_back(vertex);
+   m_box.enclose(vertex);
+}
+
+void contour2d::add_edge_sum(const dpos2d& p1, const dpos2d& p2)
+{
+   m_edge_sum += (p2.x() - p1.x())*(p2.y() + p1.y());
 }
 
 const dpos2d& contour2d::operator[](size_t i) const
@@ -84,19 +97,9 @@ double contour2d::length() const
 
 dpos2d contour2d::geometric_center() const
 {
-   double xmin = +std::numeric_limits<double>::max();
-   double xmax = -std::numeric_limits<double>::max();
-   double ymin = +std::numeric_limits<double>::max();
-   double ymax = -std::numeric_limits<double>::max();
-
-   size_t nv = m_vert.size();
-   for(size_t i=0; i<nv; i++) {
-     xmin = std::min(xmin,m_vert[i].x());
-     xmax = std::max(xmax,m_vert[i].x());
-     ymin = std::min(ymin,m_vert[i].y());
-     ymax = std::max(ymax,m_vert[i].y());
-   }
-   return dpos2d(0.5*(xmin+xmax),0.5*(ymin+ymax));
+   const dpos2d& p1 = m_box.p1();
+   const dpos2d& p2 = m_box.p2();
+   return dpos2d(0.5*(p1.x()+p2.x()),0.5*(p1.y()+p2.y()));
 }
 
 bool contour2d::make_compatible(contour2d& a, contour2d& b, double epspnt)
@@ -154,23 +157,12 @@ double contour2d::signed_area() const
                                               -44  counter-clockwise
    */
 
+   // the sum over consecutive vertices is maintained in push_back,
+   // here we account for the final edge from last to first point
    size_t np  = m_vert.size();
-   double sum = 0.0;
-
-   for (size_t ip = 1; ip < np; ip++)    {
-      const dpos2d& prev = m_vert[ip-1];
-      const dpos2d& pcur = m_vert[ip];
+   if(np == 0) return 0.0;
 
-      double x1 = prev.x();
-      double y1 = prev.y();
-
-      double x2 = pcur.x();
-      double y2 = pcur.y();
-
-      sum += (x2 - x1)*(y2 + y1);
-   }
-
-   // close the polygon: account for the final edge from last to first point
+   double sum = m_edge_sum;
    const dpos2d& prev = m_vert[np-1];
    const dpos2d& pcur = m_vert[0];
 
@@ -191,15 +183,35 @@ double contour2d::signed_area() const
 
 dbox2d contour2d::bounding_box() const
 {
-   dbox2d box;
-   for(size_t i=0; i<m_vert.size(); i++) {
-      const dpos2d& p = m_vert[i];
-      box.enclose(p);
-   }
-   return box;
+   return m_box;
 }
 
 void contour2d::reverse()
 {
    std::reverse(m_vert.begin(),m_vert.end());
+
+   // reversing every edge changes the sign of each term in the sum
+   m_edge_sum = -m_edge_sum;
+}
+
+bool contour2d::is_convex() const
+{
+   size_t nv = m_vert.size();
+   if(nv < 3) return false;
+
+   // sum the turning angles, a star shaped contour also turns left everywhere but winds more than once
+   double turn = 0.0;
+   for(size_t i=0; i<nv; i++) {
+      const dpos2d& p0 = m_vert[(i+nv-1)%nv];
+      const dpos2d& p1 = m_vert[i];
+      const dpos2d& p2 = m_vert[(i+1)%nv];
+      double ux = p1.x()-p0.x();
+      double uy = p1.y()-p0.y();
+      double vx = p2.x()-p1.x();
+      double vy = p2.y()-p1.y();
+      double cross = ux*vy - uy*vx;
+      if(cross <= 0.0) return false;
+      turn += atan2(cross,ux*vx+uy*vy);
+   }
+   return (fabs(turn-2.0*pi) < 1.0E-6);
 }
@@ -22,6 +22,9 @@
 #include "dmesh/dbox2d.h"
 #include <vector>
 
+// The bounding box and signed area are maintained as vertices are added,
+// so querying them does not rescan the vertices
+
 class contour2d {
 public:
    contour2d();
@@ -51,12 +54,21 @@ public:
    // reverse the winding order of the contour
    void reverse();
 
+   // true if the contour is strictly convex and CCW,
+   // i.e. it turns left at every vertex and winds around exactly once
+   bool is_convex() const;
+
    // return bounding box of this contour
    dbox2d bounding_box() const;
 
    ClipperLib::Path path() const;
+private:
+   void add_edge_sum(const dpos2d& p1, const dpos2d& p2);
+
 private:
    std::vector<dpos2d> m_vert;
+   dbox2d              m_box;       // bounding box of m_vert
+   double              m_edge_sum;  // sum of (x2-x1)(y2+y1) for consecutive vertices, closing edge excluded
 };
 
 #endif // CONTOUR2D_H
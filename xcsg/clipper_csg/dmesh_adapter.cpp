@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "dmesh_adapter.h"
+#include "thread_pool.h"
 
 #include "dmesh/dmesh.h"
 #include "dmesh/dvertex.h"
@@ -29,13 +30,46 @@ dmesh_adapter::~dmesh_adapter()
 
 bool dmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
 {
-   dmesh dmesher;
+   // the polygons are independent, so each is meshed into its own mesh
+   // by its own dmesh. The meshes are merged in polyset order
+   std::vector<std::shared_ptr<polygon2d>> polygons(polyset->begin(),polyset->end());
+   std::vector<std::shared_ptr<polymesh2d>> meshes(polygons.size());
+   double maxlen = m_maxlen;
+   auto tesselate_one = [&polygons,&meshes,maxlen](size_t i) {
+      dmesh_adapter tess(maxlen);
+      tess.tesselate_polygon(polygons[i]);
+      meshes[i] = tess.mesh();
+   };
+
+   if(polygons.size() > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(size_t i=0; i<polygons.size(); i++) {
+         tasks.run([&tesselate_one,i]() { tesselate_one(i); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(size_t i=0; i<polygons.size(); i++) tesselate_one(i);
+   }
 
-   // transfer the contours from polyset to dmesher
-   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
-      std::shared_ptr<polygon2d> poly = *i;
-      add_contour(poly,dmesher);
+   for(auto& mesh : meshes) {
+      m_mesh->append(*mesh);
    }
+   return true;
+}
+
+bool dmesh_adapter::tesselate_polygon(std::shared_ptr<polygon2d> poly)
+{
+   // a convex polygon without holes is simply a triangle fan, no maxlen subdivision is needed
+   if(poly->size() == 1 && poly->get_contour(0)->is_convex()) {
+      m_mesh->add_convex_contour(poly->get_contour(0));
+      return true;
+   }
+
+   dmesh dmesher;
+
+   // transfer the contours from the polygon to dmesher
+   add_contour(poly,dmesher);
 
    // now we have all the contours. Perform tesselation based on the profile vertices only
    if(dmesher.triangulate_profile()) {
@@ -51,33 +85,25 @@ bool dmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
       }
 
       // convert trangle faces to polymesh2d
-      m_mesh->m_face.reserve(dmesher.size());
+      m_mesh->m_face.reserve(dmesher.size(),3*dmesher.size());
       for(auto triangle : dmesher ) {
 
-         polymesh2d::index_vector face;
-         face.reserve(3);
-
          // subtract 3 for supervertices in dmesh
-         face.push_back(triangle->vertex1()-3);
-         face.push_back(triangle->vertex2()-3);
-         face.push_back(triangle->vertex3()-3);
-         m_mesh->add_face(face);
+         const size_t face[] = { size_t(triangle->vertex1()-3), size_t(triangle->vertex2()-3), size_t(triangle->vertex3()-3) };
+         m_mesh->add_face(face,3);
       }
 
       // convert contours to polymesh2d
       const dprofile* profile = dmesher.get_profile();
-      m_mesh->m_contour.reserve(profile->size());
+      m_mesh->m_contour.reserve(profile->size(),m_mesh->m_vert.size());
       for(auto loop : *profile) {
 
-         // vertex vector for contour
-         polymesh2d::index_vector vind;
-         vind.reserve(loop->size());
-
+         // vertex indices for contour
          for(auto coedge : *loop) {
             size_t iv = coedge->vertex1();
-            vind.push_back(iv-3);
+            m_mesh->m_contour.push_index(iv-3);
          }
-         m_mesh->m_contour.push_back(vind);
+         m_mesh->m_contour.end_list();
       }
       return true;
    }
@@ -27,7 +27,8 @@ public:
    dmesh_adapter(double maxlen);
    virtual ~dmesh_adapter();
 
-   // tesselate all polygons in the polyset into the same mesh
+   // tesselate all polygons in the polyset into the same mesh.
+   // Each polygon is meshed by its own dmesh, concurrently when the thread pool allows
    bool tesselate(std::shared_ptr<polyset2d> polyset);
 
    // return the contained mesh
@@ -35,6 +36,9 @@ public:
 
 protected:
 
+   // tesselate a single polygon into this mesh
+   bool tesselate_polygon(std::shared_ptr<polygon2d> poly);
+
    // add conour of single polygon
    bool add_contour(std::shared_ptr<polygon2d> poly, dmesh& mesher);
 
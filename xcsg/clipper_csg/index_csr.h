@@ -0,0 +1,91 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef INDEX_CSR_H
+#define INDEX_CSR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// index_span is a read only view of the vertex indices of one face or contour in an index_csr
+class index_span {
+public:
+   index_span(const uint32_t* first, const uint32_t* last) : m_first(first), m_last(last) {}
+
+   size_t size() const                     { return m_last - m_first; }
+   bool empty() const                      { return m_first == m_last; }
+   uint32_t operator[](size_t i) const     { return m_first[i]; }
+   const uint32_t* begin() const           { return m_first; }
+   const uint32_t* end() const             { return m_last; }
+
+private:
+   const uint32_t* m_first;
+   const uint32_t* m_last;
+};
+
+// index_csr stores variable length index lists, such as the faces or contours of a mesh,
+// in compressed row form: the indices of all lists back to back, and the start of each list.
+// Adding a list costs no allocation of its own, and indices are 32 bit.
+
+class index_csr {
+public:
+   index_csr() : m_first(1,0) {}
+
+   // number of lists
+   size_t size() const                     { return m_first.size()-1; }
+
+   // total number of indices in all lists
+   size_t nindices() const                 { return m_indices.size(); }
+
+   index_span operator[](size_t i) const   { return index_span(m_indices.data()+m_first[i],m_indices.data()+m_first[i+1]); }
+
+   void reserve(size_t nlists, size_t nindices)
+   {
+      m_first.reserve(m_first.size()+nlists);
+      m_indices.reserve(m_indices.size()+nindices);
+   }
+
+   // add indices to the list being built, end_list() completes it
+   void push_index(size_t index)           { m_indices.push_back(static_cast<uint32_t>(index)); }
+   void end_list()                         { m_first.push_back(static_cast<uint32_t>(m_indices.size())); }
+
+   // add a complete list
+   template <class T>
+   void push_back(const T* indices, size_t n)
+   {
+      for(size_t i=0; i<n; i++) push_index(indices[i]);
+      end_list();
+   }
+
+   // remove the indices added since the last completed list
+   void cancel_list()                      { m_indices.resize(m_first.back()); }
+
+   // append the lists of another index_csr, with the indices increased by offset
+   void append(const index_csr& other, size_t offset)
+   {
+      const uint32_t base = static_cast<uint32_t>(m_indices.size());
+      m_first.reserve(m_first.size()+other.size());
+      for(size_t i=1; i<other.m_first.size(); i++) m_first.push_back(base + other.m_first[i]);
+      m_indices.reserve(m_indices.size()+other.m_indices.size());
+      for(uint32_t index : other.m_indices) m_indices.push_back(index + static_cast<uint32_t>(offset));
+   }
+
+private:
+   std::vector<uint32_t> m_first;     // start of each list in m_indices, plus the end of the last
+   std::vector<uint32_t> m_indices;
+};
+
+#endif // INDEX_CSR_H
@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "polygon2d.h"
+#include "thread_pool.h"
 
 polygon2d::polygon2d()
 {
@@ -69,9 +70,21 @@ bool polygon2d::make_compatible(polygon2d& a, polygon2d& b, double epspnt)
       throw std::logic_error("polygon2d::make_compatible: polygons not compatible' - must have same number of contours");
    }
 
+   // the contour pairs are independent, profiles with holes make them compatible in parallel
    size_t nc = a.size();
-   for(size_t ic=0;ic<nc; ic++) {
-      contour2d::make_compatible(*(a.m_contours[ic]),*(b.m_contours[ic]),epspnt);
+   if(nc > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(size_t ic=0;ic<nc; ic++) {
+         contour2d* ca = a.m_contours[ic].get();
+         contour2d* cb = b.m_contours[ic].get();
+         tasks.run([ca,cb,epspnt]() { contour2d::make_compatible(*ca,*cb,epspnt); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(size_t ic=0;ic<nc; ic++) {
+         contour2d::make_compatible(*(a.m_contours[ic]),*(b.m_contours[ic]),epspnt);
+      }
    }
 
    return true;
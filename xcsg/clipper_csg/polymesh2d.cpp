@@ -45,12 +45,9 @@ void polymesh2d::add_contour(std::shared_ptr<const contour2d> contour)
    size_t icv_offset = m_vert.size();
    size_t ncv        = contour->size();
 
-   // reserve space for more vertices
+   // reserve space for more vertices and contour indices
    m_vert.reserve(icv_offset+ncv);
-
-   // reserve space in contour index vector
-   index_vector index_contour;
-   index_contour.reserve(ncv);
+   m_contour.reserve(1,ncv);
 
    // add vertices and contour indices
    for(size_t icv=0; icv<contour->size(); icv++) {
@@ -59,16 +56,36 @@ void polymesh2d::add_contour(std::shared_ptr<const contour2d> contour)
       m_vert.push_back(vtx);
 
       // add contour index for this vertex
-      index_contour.push_back(icv_offset + icv);
+      m_contour.push_index(icv_offset + icv);
    }
 
-   // add the contour index vector to the vector of contours
-   m_contour.push_back(index_contour);
+   // complete the contour
+   m_contour.end_list();
 }
 
-void polymesh2d::add_face(const index_vector& face)
+void polymesh2d::add_convex_contour(std::shared_ptr<const contour2d> contour)
 {
-   m_face.push_back(face);
+   size_t iv_offset = m_vert.size();
+   add_contour(contour);
+
+   // fan from the first vertex, all triangles are CCW as the contour
+   size_t nv = contour->size();
+   if(nv < 3) return;
+   m_face.reserve(nv-2,3*(nv-2));
+   for(size_t iv=1; iv+1<nv; iv++) {
+      const size_t face[] = { iv_offset, iv_offset+iv, iv_offset+iv+1 };
+      m_face.push_back(face,3);
+   }
+}
+
+void polymesh2d::append(const polymesh2d& mesh)
+{
+   // get current number of vertices to use as index offset
+   size_t iv_offset = m_vert.size();
+   m_vert.insert(m_vert.end(),mesh.m_vert.begin(),mesh.m_vert.end());
+
+   m_face.append(mesh.m_face,iv_offset);
+   m_contour.append(mesh.m_contour,iv_offset);
 }
 
 const dpos2d& polymesh2d::vertex(size_t ivertex) const
@@ -76,22 +93,22 @@ const dpos2d& polymesh2d::vertex(size_t ivertex) const
    return m_vert[ivertex];
 }
 
-const polymesh2d::index_vector& polymesh2d::face(size_t iface) const
+index_span polymesh2d::face(size_t iface) const
 {
    return m_face[iface];
 }
 
-const polymesh2d::index_vector&  polymesh2d::contour(size_t icontour) const
+index_span polymesh2d::contour(size_t icontour) const
 {
    return m_contour[icontour];
 }
 
-const polymesh2d::face_vector&  polymesh2d::faces() const
+const index_csr& polymesh2d::faces() const
 {
    return m_face;
 }
 
-const polymesh2d::contour_vector  polymesh2d::contours() const
+const index_csr& polymesh2d::contours() const
 {
    return m_contour;
 }
@@ -20,10 +20,12 @@
 #include <memory>
 #include "dmesh/dpos2d.h"
 #include "contour2d.h"
+#include "index_csr.h"
 
 // polymesh2d can represent the mesh of multiple complex polygons, possibly with holes.
 // Contours must be added successively per polygon, in proper CCW/CW order, ref. polygon2d definitions.
 // Each polygon is tesselated and faces added (with adjusted vertex offset) to the mesh.
+// Faces and contours are stored in compressed row form, see index_csr.
 
 class polymesh2d {
 public:
@@ -31,9 +33,6 @@ public:
    friend class tmesh_adapter;
 
    typedef std::vector<dpos2d>      vertex_vector;
-   typedef std::vector<size_t>        index_vector;    // a vector of indices into m_vert
-   typedef std::vector<index_vector>  face_vector;     // an index_vector per face
-   typedef std::vector<index_vector>  contour_vector;  // an index_vector per contour
 
    polymesh2d();
    virtual ~polymesh2d();
@@ -47,31 +46,39 @@ public:
    // return number of faces
    size_t nfaces() const;
 
-   // return vertex index vector for given face
-   const index_vector& face(size_t iface) const;
+   // return vertex indices for given face
+   index_span face(size_t iface) const;
 
    // return number of contours
    size_t ncontours() const;
 
-   // return vertex index vector for given contour
-   const index_vector& contour(size_t icontour) const;
+   // return vertex indices for given contour
+   index_span contour(size_t icontour) const;
 
-   const face_vector& faces() const;
-   const contour_vector contours() const;
+   const index_csr& faces() const;
+   const index_csr& contours() const;
 
 protected:
 
    // add a new contour to the mesh, this adds vertices also
    void add_contour(std::shared_ptr<const contour2d> contour);
 
-   // add a face to the mesh, the index_vector contains vertex indices for the face
+   // add a convex contour to the mesh together with its triangle fan,
+   // this is used instead of a tesselator for convex single contour polygons
+   void add_convex_contour(std::shared_ptr<const contour2d> contour);
+
+   // add a face to the mesh, given n vertex indices for the face
    // The indicies must properly refer to vertexes in this mesh
-   void add_face(const index_vector& face);
+   template <class T>
+   void add_face(const T* face, size_t n) { m_face.push_back(face,n); }
+
+   // append all vertices, faces and contours of another mesh, with adjusted vertex offset
+   void append(const polymesh2d& mesh);
 
 private:
     vertex_vector   m_vert;    // vertices
-    face_vector     m_face;    // faces    , each entry contains N indices into m_vert (not limited to 3)
-    contour_vector  m_contour; // contours , each entry contains N indices into m_vert
+    index_csr       m_face;    // faces    , each entry contains N indices into m_vert (not limited to 3)
+    index_csr       m_contour; // contours , each entry contains N indices into m_vert
 };
 
 #endif // POLYMESH2D_H
@@ -1,19 +1,114 @@
 #include "tmesh_adapter.h"
+#include "thread_pool.h"
 #include <cstdlib>
 #include <memory>
 #include <map>
 #include <cmath>
+#include <cstring>
+#include <cstddef>
 #include "tmesh/libtess2/Include/tesselator.h"
 
-static void *stdAlloc(void* userData, unsigned int size) {
-	TESS_NOTUSED(userData);
-	return malloc(size);
-}
+// tess_pool is a size class allocator for libtess2. Blocks are rounded up to a power of 2
+// and freed blocks are kept in per class free lists, so repeated tesselations
+// reuse the same memory instead of going through the heap. Large blocks bypass the pool.
+class tess_pool {
+public:
+   tess_pool() { for(size_t i=0; i<nclasses; i++) m_free[i] = 0; }
+   ~tess_pool()
+   {
+      for(size_t i=0; i<nclasses; i++) {
+         while(m_free[i]) {
+            header* h = m_free[i];
+            m_free[i] = h->next;
+            free(h);
+         }
+      }
+   }
 
-static void stdFree(void* userData, void* ptr) {
-	TESS_NOTUSED(userData);
-	free(ptr);
-}
+   void* alloc(unsigned int size)
+   {
+      size_t iclass = 0;
+      while(iclass<nclasses && (min_block<<iclass) < size) iclass++;
+
+      header* h = 0;
+      if(iclass < nclasses && m_free[iclass]) {
+         h = m_free[iclass];
+         m_free[iclass] = h->next;
+      }
+      else {
+         size_t block = (iclass < nclasses)? (min_block<<iclass) : size;
+         h = static_cast<header*>(malloc(sizeof(header)+block));
+         if(!h) return 0;
+      }
+      h->iclass = iclass;
+      return h+1;
+   }
+
+   void release(void* ptr)
+   {
+      if(!ptr) return;
+      header* h = static_cast<header*>(ptr)-1;
+      size_t iclass = h->iclass;
+      if(iclass < nclasses) {
+         // the free list link overwrites the size class
+         h->next = m_free[iclass];
+         m_free[iclass] = h;
+      }
+      else {
+         free(h);
+      }
+   }
+
+   // TESSalloc callbacks, userData is the pool
+   static void* tess_alloc(void* userData, unsigned int size) { return static_cast<tess_pool*>(userData)->alloc(size); }
+   static void  tess_free(void* userData, void* ptr)          { static_cast<tess_pool*>(userData)->release(ptr); }
+
+private:
+   static const size_t min_block = 32;
+   static const size_t nclasses  = 16;   // largest pooled block is 1MB
+
+   // block header, keeps the user memory aligned
+   union header {
+      size_t          iclass;
+      header*         next;
+      std::max_align_t align;
+   };
+
+   header* m_free[nclasses];
+};
+
+// tess_cache keeps the tesselator of a thread alive across tesselations
+class tess_cache {
+public:
+   tess_cache() : m_tess(0) {}
+   ~tess_cache() { reset(); }
+
+   TESStesselator* get()
+   {
+      if(!m_tess) {
+         TESSalloc ma;
+         memset(&ma, 0, sizeof(ma));
+         ma.memalloc = tess_pool::tess_alloc;
+         ma.memfree = tess_pool::tess_free;
+         ma.userData = &m_pool;
+         ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
+         m_tess = tessNewTess(&ma);
+      }
+      return m_tess;
+   }
+
+   void reset()
+   {
+      if(m_tess)tessDeleteTess(m_tess);
+      m_tess = 0;
+   }
+
+private:
+   tess_pool       m_pool;   // declared first, so it outlives the tesselator
+   TESStesselator* m_tess;
+};
+
+static thread_local tess_cache thread_tess;
 
 tmesh_adapter::tmesh_adapter()
 : m_tess(0)
@@ -27,40 +122,75 @@ tmesh_adapter::~tmesh_adapter()
 
 void tmesh_adapter::create_tess()
 {
-   delete_tess();
-   TESSalloc ma;
-   memset(&ma, 0, sizeof(ma));
-   ma.memalloc = stdAlloc;
-   ma.memfree = stdFree;
-   ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
-   m_tess = tessNewTess(&ma);
+   m_tess = thread_tess.get();
 }
 
 void tmesh_adapter::delete_tess()
 {
-   if(m_tess)tessDeleteTess(m_tess);
+   // a tesselator still in use here was left by a failure, it may hold a partial mesh
+   if(m_tess)thread_tess.reset();
+   m_tess = 0;
+}
+
+void tmesh_adapter::release_tess()
+{
+   // the tesselator is kept for the next tesselation in this thread
    m_tess = 0;
 }
 
 bool tmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
 {
+   // the polygons are independent, so each is tesselated into its own mesh
+   // by its own tesselator. The meshes are merged in polyset order
+   std::vector<std::shared_ptr<polygon2d>> polygons(polyset->begin(),polyset->end());
+   std::vector<std::shared_ptr<polymesh2d>> meshes(polygons.size());
+   auto tesselate_one = [&polygons,&meshes](size_t i) {
+      tmesh_adapter tess;
+      if(tess.tesselate_polygon(polygons[i])) meshes[i] = tess.mesh();
+   };
+
+   if(polygons.size() > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(size_t i=0; i<polygons.size(); i++) {
+         tasks.run([&tesselate_one,i]() { tesselate_one(i); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(size_t i=0; i<polygons.size(); i++) tesselate_one(i);
+   }
+
+   for(auto& mesh : meshes) {
+      if(!mesh) return false;
+      m_mesh->append(*mesh);
+   }
+   return true;
+}
+
+bool tmesh_adapter::tesselate_polygon(std::shared_ptr<polygon2d> poly)
+{
+   // a convex polygon without holes is simply a triangle fan
+   if(poly->size() == 1 && poly->get_contour(0)->is_convex()) {
+      m_mesh->add_convex_contour(poly->get_contour(0));
+      return true;
+   }
+
    // build a sorted map of contours, largest areas first
-   std::multimap<double,std::shared_ptr<contour2d>> sorted_contours;
-   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
-      std::shared_ptr<polygon2d> poly = *i;
-      size_t nc = poly->size();
-      for(size_t ic=0;ic<nc;ic++) {
-         std::shared_ptr<contour2d> contour = poly->get_contour(ic);
-         double area = fabs(contour->signed_area());
-         if(area > 0) {
-            sorted_contours.insert(std::make_pair(area,contour));
-         }
+   ContourMap sorted_contours;
+   size_t nc = poly->size();
+   for(size_t ic=0;ic<nc;ic++) {
+      std::shared_ptr<contour2d> contour = poly->get_contour(ic);
+      double area = fabs(contour->signed_area());
+      if(area > 0) {
+         sorted_contours.insert(std::make_pair(area,contour));
       }
    }
 
+   // nothing to tesselate
+   if(sorted_contours.size() == 0) return true;
+
    // then tesselate the contours
    return tesselate_contours(sorted_contours);
-
 }
 
 bool tmesh_adapter::tesselate_contours(ContourMap& contours)
@@ -100,7 +230,10 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
    // compute the Constrained Delaunay mesh for the whole profile
    TESSreal* normalvec = 0; // normal automatically calculated
    bool success = (1 == tessTesselate(m_tess,TESS_WINDING_ODD,TESS_CONSTRAINED_DELAUNAY_TRIANGLES, polySize, vertexSize, normalvec));
-   if(!success) return false;
+   if(!success) {
+      delete_tess();
+      return false;
+   }
 
    // get the tesselation results
    const TESSreal* verts = tessGetVertices(m_tess);
@@ -122,10 +255,11 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
    // However, we must use the "vinds" lookup table as the order of the vertices have been changed by the tesselator
 
    // traverse the tesselator faces and add them to the mesh
+   std::vector<size_t> face;
+   face.reserve(polySize);
    for(int iiel=0; iiel<nelems; iiel++) {
 
-      polymesh2d::index_vector face;
-      face.reserve(polySize);
+      face.clear();
 
       // p = pointer to polygon triangle, each polygon uses polySize*1 indices for TESS_CONSTRAINED_DELAUNAY_TRIANGLES
       const int* p = &elems[iiel*polySize];
@@ -144,11 +278,11 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
       }
 
       // add the completed face to the mesh
-      if(face.size() == polySize)m_mesh->add_face(face);
+      if(face.size() == polySize)m_mesh->add_face(face.data(),face.size());
    }
 
-   // tess data structure no longer needed
-   delete_tess();
+   // tess data structure no longer needed here
+   release_tess();
 
    return true;
 }
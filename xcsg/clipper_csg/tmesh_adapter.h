@@ -16,7 +16,8 @@ public:
    tmesh_adapter();
    virtual ~tmesh_adapter();
 
-   // tesselate all polygons in the polyset into the same mesh
+   // tesselate all polygons in the polyset into the same mesh.
+   // Each polygon is tesselated separately, concurrently when the thread pool allows
    bool tesselate(std::shared_ptr<polyset2d> polyset);
 
    // return the contained mesh
@@ -24,11 +25,14 @@ public:
 
 private:
    typedef std::multimap<double,std::shared_ptr<contour2d>>  ContourMap;
+   bool tesselate_polygon(std::shared_ptr<polygon2d> poly);
    bool tesselate_contours(ContourMap& contours);
 
 private:
+   // the tesselator is borrowed from a thread local cache using a pooled allocator
    void create_tess();
    void delete_tess();
+   void release_tess();
    TESStesselator* m_tess;
 
    std::shared_ptr<polymesh2d> m_mesh;
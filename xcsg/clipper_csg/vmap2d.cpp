@@ -15,6 +15,7 @@
 
 #include "vmap2d.h"
 #include "contour2d.h"
+#include <algorithm>
 
 vmap2d::vmap2d(const contour2d& c)
 : m_contour(c)
@@ -25,21 +26,49 @@ vmap2d::vmap2d(const contour2d& c)
 
 void vmap2d::compute_map()
 {
+   // the parameters are increasing along the contour, so no sorting is required
    m_vmap.clear();
-   m_vmap[0.0] = m_contour[0];
+   m_vmap.reserve(m_contour.size());
+   m_vmap.push_back(std::make_pair(0.0,m_contour[0]));
    double dist = 0.0;
    for(size_t i=1; i<m_contour.size(); i++) {
       dist += m_contour[i].dist(m_contour[i-1]);
-      m_vmap[dist/m_len] = m_contour[i];
+      double p = dist/m_len;
+      if(p > m_vmap.back().first) m_vmap.push_back(std::make_pair(p,m_contour[i]));
+      else                        m_vmap.back().second = m_contour[i];
    }
 }
 
+void vmap2d::merge_vertices(const Vmap& added)
+{
+   if(added.size() == 0) return;
+
+   Vmap merged;
+   merged.reserve(m_vmap.size()+added.size());
+   size_t iv = 0;
+   size_t ia = 0;
+   while(iv<m_vmap.size() || ia<added.size()) {
+      if(ia<added.size() && (iv==m_vmap.size() || added[ia].first <= m_vmap[iv].first)) {
+         // the last of a run of equal parameters replaces any existing vertex
+         size_t ib = ia;
+         while(ib+1<added.size() && added[ib+1].first == added[ia].first) ib++;
+         if(iv<m_vmap.size() && m_vmap[iv].first == added[ia].first) iv++;
+         merged.push_back(added[ib]);
+         ia = ib+1;
+      }
+      else {
+         merged.push_back(m_vmap[iv++]);
+      }
+   }
+   m_vmap.swap(merged);
+}
+
 void vmap2d::compute_contour()
 {
    // update the contour
    m_contour.clear();
    m_contour.reserve(m_vmap.size());
-   for(auto ip : m_vmap) {
+   for(auto& ip : m_vmap) {
       m_contour.push_back(ip.second);
    }
 }
@@ -73,16 +102,32 @@ size_t  vmap2d::imprint(Vlines& lines, double epspnt)
    // dist is the distance along contour before current edge
    double dist = 0.0;
 
+   // the intersections found, merged into the map afterwards. Edges are traversed
+   // along the contour, so sorting the intersections of each edge keeps them all sorted
+   Vmap added;
+   auto by_param = [](const Vpar& a, const Vpar& b) { return a.first < b.first; };
+
    // traverse contour edges
    for(size_t iedge=0; iedge<edges.size(); iedge++) {
       auto& p = edges[iedge];
       const dpos2d& pos1 = m_contour[p.first];
       const dpos2d& pos2 = m_contour[p.second];
       dline2d edge(pos1,pos2);
+      size_t iadded = added.size();
 
       // traverse vertex lines
       for(size_t ivlin=0; ivlin<lines.size(); ivlin++) {
          const dline2d& vline = lines[ivlin];
+
+         // quick rejection when both edge ends are on the same side of the vertex line
+         const dpos2d& l1 = vline.end1();
+         const dpos2d& l2 = vline.end2();
+         double dx = l2.x()-l1.x();
+         double dy = l2.y()-l1.y();
+         double s1 = dx*(pos1.y()-l1.y()) - dy*(pos1.x()-l1.x());
+         double s2 = dx*(pos2.y()-l1.y()) - dy*(pos2.x()-l1.x());
+         if((s1>0.0 && s2>0.0) || (s1<0.0 && s2<0.0)) continue;
+
          dpos2d xpos;
          double edge_param = -1;
          double vlin_param = -1;
@@ -96,17 +141,20 @@ size_t  vmap2d::imprint(Vlines& lines, double epspnt)
                if((dist1>epspnt) && (dist2>epspnt)) {
                   // compute intersection parameter
                   double p = (dist + dist1)/m_len;
-                  m_vmap[p] = xpos;
+                  added.push_back(std::make_pair(p,xpos));
                }
             }
          }
       }
 
+      std::stable_sort(added.begin()+iadded,added.end(),by_param);
+
       // update dist
       dist += pos1.dist(pos2);
    }
 
    // update the contour
+   merge_vertices(added);
    compute_contour();
    return m_contour.size();
 }
@@ -118,18 +166,46 @@ void vmap2d::add_vertices(size_t nv)
       double dp = 1.0/nv;
       double p0 = dp/2.0;
       double par = p0;
+
+      // Each new vertex splits the interval [lo,hi> containing par at its midpoint.
+      // As par is increasing, the map is rebuilt in one pass: vertices below lo are final,
+      // the vertices after hi are the pending split vertices (top is lowest) followed by the old tail.
+      // Beyond the last vertex the interval closes at parameter 1.0 on the first vertex.
+      Vmap merged;
+      merged.reserve(m_vmap.size()+nv);
+      Vmap pending;
+      const Vpar closing(1.0,m_vmap[0].second);
+      size_t iv = 1;
+      auto next = [&]() -> Vpar {
+         if(pending.size() > 0) { Vpar v = pending.back(); pending.pop_back(); return v; }
+         return (iv < m_vmap.size())? m_vmap[iv++] : closing;
+      };
+
+      Vpar lo = m_vmap[0];
+      Vpar hi = next();
       for(size_t i=0; i<nv; i++) {
-         Vmap::const_iterator ip2 = m_vmap.upper_bound(par);
-         Vmap::const_iterator ip1 = ip2; ip1--;
-         double p = 0.5*(ip1->first + ip2->first);
-         const dpos2d& p1 = ip1->second;
-         const dpos2d& p2 = ip2->second;
+         while(hi.first <= par && hi.first < 1.0) {
+            merged.push_back(lo);
+            lo = hi;
+            hi = next();
+         }
+         const dpos2d& p1 = lo.second;
+         const dpos2d& p2 = hi.second;
          double x = 0.5*(p1.x() + p2.x());
          double y = 0.5*(p1.y() + p2.y());
-         m_vmap[p] = dpos2d(x,y);
+         pending.push_back(hi);
+         hi = std::make_pair(0.5*(lo.first + hi.first),dpos2d(x,y));
          par += dp;
       }
 
+      // flush the remaining vertices
+      merged.push_back(lo);
+      while(hi.first < 1.0) {
+         merged.push_back(hi);
+         hi = next();
+      }
+      m_vmap.swap(merged);
+
       // update the contour
       compute_contour();
    }
@@ -19,15 +19,16 @@
 #include "dmesh/dpos2d.h"
 #include "dmesh/dline2d.h"
 #include "contour2d.h"
-#include <map>
 #include <vector>
 // vmap2d implements a closed contour where the vertices have parameters [0,1]
 // The lowest  parameter value is always = 0.0
 // The highest parameter value is always < 1.0, since the last vertex is the same as the first
+// The vertices are kept in a vector sorted on parameter, new vertices are merged in batches
 
 class vmap2d {
 public:
-   typedef std::map<double,dpos2d> Vmap;
+   typedef std::pair<double,dpos2d> Vpar;
+   typedef std::vector<Vpar> Vmap;
    typedef Vmap::iterator iterator;
 
    typedef std::vector<std::pair<int,int>> EdgeVec; // indices into m_contour
@@ -56,6 +57,10 @@ protected:
    void compute_contour();
    void get_edges(EdgeVec& edges) const;
 
+   // merge vertices sorted on parameter into m_vmap, a single pass over both.
+   // For equal parameters the last one wins
+   void merge_vertices(const Vmap& added);
+
 private:
    contour2d m_contour;
    double    m_len;
@@ -15,10 +15,12 @@
 
 #include "dxf_file.h"
 #include "clipper_csg/polyset2d.h"
+#include "trace_writer.h"
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
-dxf_file::dxf_file()
+dxf_file::dxf_file(int precision)
+: m_out(precision)
 {}
 
 dxf_file::~dxf_file()
@@ -26,22 +28,28 @@ dxf_file::~dxf_file()
 
 void dxf_file::write_item(int gc, const std::string& value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   m_out << "  " << gc << '\n' << value << '\n';
 }
 
 void dxf_file::write_item(int gc, double value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   m_out << "  " << gc << '\n' << value << '\n';
 }
 
 void dxf_file::write_item(int gc, int value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   m_out << "  " << gc << '\n' << value << '\n';
 }
 
 
 std::string dxf_file::write( std::shared_ptr<polyset2d> polyset, const std::string& file_path)
 {
+   return write(polyset_layers(1,std::make_pair(std::string("0"),polyset)),file_path);
+}
+
+std::string dxf_file::write( const polyset_layers& layers, const std::string& file_path)
+{
+   trace_span span("write_dxf","export");
    boost::filesystem::path fullpath(file_path);
    boost::filesystem::path dxf_path = fullpath.parent_path() / fullpath.stem();
    std::string path = dxf_path.string() + ".dxf";
@@ -61,11 +69,13 @@ std::string dxf_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    // write entities, only LWPOLYLINE written
    write_item(0,"SECTION");
    write_item(2,"ENTITIES");
-   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
-      std::shared_ptr<polygon2d> poly = *i;
-      size_t nc = poly->size();
-      for(size_t ic=0;ic<nc;ic++) {
-         write_lwpolyline(poly->get_contour(ic));
+   for(auto& layer : layers) {
+      for(auto i=layer.second->begin(); i!=layer.second->end(); i++) {
+         std::shared_ptr<polygon2d> poly = *i;
+         size_t nc = poly->size();
+         for(size_t ic=0;ic<nc;ic++) {
+            write_lwpolyline(poly->get_contour(ic),layer.first);
+         }
       }
    }
    write_item(0,"ENDSEC");
@@ -75,14 +85,15 @@ std::string dxf_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    write_item(2,"OBJECTS");
    write_item(0,"ENDSEC");
    write_item(0,"EOF");
+   m_out.close();
 
    return path;
 }
 
-void dxf_file::write_lwpolyline(std::shared_ptr<contour2d> contour)
+void dxf_file::write_lwpolyline(std::shared_ptr<contour2d> contour, const std::string& layer)
 {
    write_item(0,"LWPOLYLINE");
-   write_item(8,0);  // layer 0
+   write_item(8,layer);
    write_item(70,1); // closed polyline
    for(size_t i=0; i<contour->size();i++) {
       const dpos2d& vtx = (*contour)[i];
@@ -18,27 +18,34 @@
 
 #include <memory>
 #include <string>
-#include <fstream>
+#include <vector>
+#include "buffered_writer.h"
 class polyset2d;
 class contour2d;
 
 class dxf_file {
 public:
-   dxf_file();
+   typedef std::vector<std::pair<std::string,std::shared_ptr<polyset2d>>> polyset_layers;
+
+   // precision is number of decimals in coordinates
+   dxf_file(int precision = 6);
    virtual ~dxf_file();
 
    // export to DXF, return the path to the file created
    // input is full path to file, file extension will be replaced to ".dxf"
    std::string  write( std::shared_ptr<polyset2d> polyset, const std::string& file_path);
 
+   // export each polyset to its named layer
+   std::string  write( const polyset_layers& layers, const std::string& file_path);
+
 protected:
    void write_item(int gc, const std::string& value);
    void write_item(int gc, double value);
    void write_item(int gc, int value);
-   void write_lwpolyline(std::shared_ptr<contour2d> contour);
+   void write_lwpolyline(std::shared_ptr<contour2d> contour, const std::string& layer);
 
 private:
-   std::ofstream m_out;
+   buffered_writer m_out;
 };
 
 #endif // DXF_FILE_H
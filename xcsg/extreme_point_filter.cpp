@@ -0,0 +1,265 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "extreme_point_filter.h"
+#include "qhull/qhull3d.h"
+#include "thread_pool.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// search directions, extremes are found in both positive and negative direction
+static const size_t ndirs = 13;
+static const double dirs[ndirs][3] = {
+   {1,0,0}, {0,1,0}, {0,0,1},
+   {1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1},
+   {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1}
+};
+
+// inputs smaller than this are passed to qhull unfiltered
+static const size_t min_points = 64;
+
+// minimum number of points handled by each parallel task
+static const size_t min_chunk = 4096;
+
+// extreme points along the search directions, for a range of input points
+class extremes {
+public:
+   extremes()
+   {
+      for(size_t i=0; i<ndirs; i++) {
+         imin[i] = imax[i] = 0;
+         dmin[i] = std::numeric_limits<double>::max();
+         dmax[i] = -std::numeric_limits<double>::max();
+      }
+   }
+
+   void add(const double* coords, size_t ifirst, size_t ilast)
+   {
+      for(size_t ip=ifirst; ip<ilast; ip++) {
+         const double* p = coords + 3*ip;
+         for(size_t i=0; i<ndirs; i++) {
+            double d = dirs[i][0]*p[0] + dirs[i][1]*p[1] + dirs[i][2]*p[2];
+            if(d < dmin[i]) { dmin[i] = d; imin[i] = ip; }
+            if(d > dmax[i]) { dmax[i] = d; imax[i] = ip; }
+         }
+      }
+   }
+
+   void merge(const extremes& other)
+   {
+      for(size_t i=0; i<ndirs; i++) {
+         if(other.dmin[i] < dmin[i]) { dmin[i] = other.dmin[i]; imin[i] = other.imin[i]; }
+         if(other.dmax[i] > dmax[i]) { dmax[i] = other.dmax[i]; imax[i] = other.imax[i]; }
+      }
+   }
+
+   // sorted unique indices of the extreme points
+   std::vector<size_t> indices() const
+   {
+      std::vector<size_t> ind(imin,imin+ndirs);
+      ind.insert(ind.end(),imax,imax+ndirs);
+      std::sort(ind.begin(),ind.end());
+      ind.erase(std::unique(ind.begin(),ind.end()),ind.end());
+      return ind;
+   }
+
+private:
+   size_t imin[ndirs];
+   size_t imax[ndirs];
+   double dmin[ndirs];
+   double dmax[ndirs];
+};
+
+// outward facing plane of the extreme point polytope, n.p = d on the plane
+struct plane {
+   double n[3];
+   double d;
+};
+
+static inline void sub(const double* a, const double* b, double* c)
+{
+   c[0] = a[0]-b[0]; c[1] = a[1]-b[1]; c[2] = a[2]-b[2];
+}
+
+static inline void cross(const double* a, const double* b, double* c)
+{
+   c[0] = a[1]*b[2] - a[2]*b[1];
+   c[1] = a[2]*b[0] - a[0]*b[2];
+   c[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline double dot(const double* a, const double* b)
+{
+   return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+// returns true when the extreme points span a volume, so their hull can be computed.
+// scale is set to the largest distance from the first extreme point
+static bool is_solid(const double* coords, const std::vector<size_t>& ind, double& scale)
+{
+   if(ind.size() < 4) return false;
+
+   // p0 = first point, p1 = farthest from p0
+   const double* p0 = coords + 3*ind[0];
+   const double* p1 = p0;
+   double dmax = 0.0;
+   for(size_t i=1; i<ind.size(); i++) {
+      const double* p = coords + 3*ind[i];
+      double v[3]; sub(p,p0,v);
+      double d = dot(v,v);
+      if(d > dmax) { dmax = d; p1 = p; }
+   }
+   scale = std::sqrt(dmax);
+   if(scale == 0.0) return false;
+
+   // normal of the plane through p0, p1 and the point farthest from that line
+   double u[3]; sub(p1,p0,u);
+   double n[3] = {0,0,0};
+   double nmax = 0.0;
+   for(size_t i=1; i<ind.size(); i++) {
+      double v[3],c[3];
+      sub(coords + 3*ind[i],p0,v);
+      cross(u,v,c);
+      double d = dot(c,c);
+      if(d > nmax) { nmax = d; n[0]=c[0]; n[1]=c[1]; n[2]=c[2]; }
+   }
+   if(nmax == 0.0) return false;
+   double len = std::sqrt(nmax);
+   n[0] /= len; n[1] /= len; n[2] /= len;
+
+   // some point must be clearly off that plane
+   const double tol = 1.0E-6*scale;
+   for(size_t i=1; i<ind.size(); i++) {
+      double v[3]; sub(coords + 3*ind[i],p0,v);
+      if(std::fabs(dot(n,v)) > tol) return true;
+   }
+   return false;
+}
+
+// mark the points in [ifirst,ilast> that are not strictly inside all planes
+static void mark_keep(const double* coords, const std::vector<plane>& planes, double tol, std::vector<char>& keep, size_t ifirst, size_t ilast)
+{
+   for(size_t ip=ifirst; ip<ilast; ip++) {
+      const double* p = coords + 3*ip;
+      char inside = 1;
+      for(size_t i=0; i<planes.size(); i++) {
+         if(dot(planes[i].n,p) >= planes[i].d - tol) { inside = 0; break; }
+      }
+      keep[ip] = !inside;
+   }
+}
+
+extreme_point_filter::extreme_point_filter()
+{}
+
+extreme_point_filter::~extreme_point_filter()
+{}
+
+size_t extreme_point_filter::filter(qhull3d& qhull)
+{
+   size_t npoints = (qhull.in_coords_end() - qhull.in_coords_begin())/3;
+   if(npoints < min_points) return 0;
+   const double* coords = &*qhull.in_coords_begin();
+
+   size_t ntask = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),npoints/min_chunk));
+
+   // find the extreme points
+   extremes ext;
+   if(ntask <= 1) {
+      ext.add(coords,0,npoints);
+   }
+   else {
+      std::vector<extremes> task_ext(ntask);
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         size_t ifirst = (npoints*itask)/ntask;
+         size_t ilast  = (npoints*(itask+1))/ntask;
+         extremes& e   = task_ext[itask];
+         tasks.run([&e,coords,ifirst,ilast]() { e.add(coords,ifirst,ilast); });
+      }
+      tasks.wait();
+      for(size_t itask=0; itask<ntask; itask++) ext.merge(task_ext[itask]);
+   }
+
+   // a flat set of extremes is left for qhull to deal with
+   std::vector<size_t> ind = ext.indices();
+   double scale = 0.0;
+   if(!is_solid(coords,ind,scale)) return 0;
+
+   // the hull of the extreme points defines the culling polytope
+   qhull3d ext_hull;
+   ext_hull.reserve(ind.size());
+   for(size_t i=0; i<ind.size(); i++) {
+      const double* p = coords + 3*ind[i];
+      ext_hull.push_back(p[0],p[1],p[2]);
+   }
+   if(!ext_hull.compute()) return 0;
+
+   std::vector<plane> planes;
+   planes.reserve(ext_hull.nfaces());
+   for(size_t iface=0; iface<ext_hull.nfaces(); iface++) {
+
+      // faces are oriented with normals out
+      qhull3d::face_vertex_iterator fv = ext_hull.face_begin(iface);
+      const qhull3d::xyz& a = ext_hull.vertex(fv[0]);
+      const qhull3d::xyz& b = ext_hull.vertex(fv[1]);
+      const qhull3d::xyz& c = ext_hull.vertex(fv[2]);
+      double p0[3] = {a.x,a.y,a.z};
+      double v1[3] = {b.x-a.x,b.y-a.y,b.z-a.z};
+      double v2[3] = {c.x-b.x,c.y-b.y,c.z-b.z};
+      plane pl;
+      cross(v1,v2,pl.n);
+      double len = std::sqrt(dot(pl.n,pl.n));
+      if(len == 0.0) continue;
+      pl.n[0] /= len; pl.n[1] /= len; pl.n[2] /= len;
+      pl.d = dot(pl.n,p0);
+      planes.push_back(pl);
+   }
+
+   // points on or near the polytope boundary are kept
+   const double tol = 1.0E-8*scale;
+   std::vector<char> keep(npoints,1);
+   if(ntask <= 1) {
+      mark_keep(coords,planes,tol,keep,0,npoints);
+   }
+   else {
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         size_t ifirst = (npoints*itask)/ntask;
+         size_t ilast  = (npoints*(itask+1))/ntask;
+         tasks.run([coords,&planes,tol,&keep,ifirst,ilast]() { mark_keep(coords,planes,tol,keep,ifirst,ilast); });
+      }
+      tasks.wait();
+   }
+
+   size_t nkeep = std::count(keep.begin(),keep.end(),1);
+   if(nkeep == npoints) return 0;
+
+   // replace the qhull input by the remaining points
+   std::vector<double> kept;
+   kept.reserve(3*nkeep);
+   for(size_t ip=0; ip<npoints; ip++) {
+      if(keep[ip]) kept.insert(kept.end(),coords+3*ip,coords+3*ip+3);
+   }
+   qhull.clear();
+   qhull.reserve(nkeep);
+   for(size_t ip=0; ip<nkeep; ip++) {
+      qhull.push_back(kept[3*ip],kept[3*ip+1],kept[3*ip+2]);
+   }
+
+   return npoints-nkeep;
+}
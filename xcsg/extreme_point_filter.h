@@ -0,0 +1,37 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef EXTREME_POINT_FILTER_H
+#define EXTREME_POINT_FILTER_H
+
+#include <cstddef>
+class qhull3d;
+
+// extreme_point_filter is an Akl-Toussaint style pre-pass for convex hulls.
+// It finds the extreme input points along a fixed set of directions, and removes
+// the input points lying strictly inside the polytope spanned by those extremes.
+// The removed points cannot be hull vertices, so the hull is unchanged.
+
+class extreme_point_filter {
+public:
+   extreme_point_filter();
+   virtual ~extreme_point_filter();
+
+   // remove interior input points from qhull, must be called before qhull.compute().
+   // returns the number of points removed
+   size_t filter(qhull3d& qhull);
+};
+
+#endif // EXTREME_POINT_FILTER_H
@@ -20,9 +20,13 @@
 #include "sweep_path_rotate.h"
 #include "sweep_path_transform.h"
 #include "sweep_path_spline.h"
+#include "primitive_cache.h"
 #include "clipper_csg/dmesh_adapter.h"
 #include "clipper_csg/tmesh_adapter.h"
 #include "carve/mesh_simplify.hpp"
+#include <iostream>
+#include <stdexcept>
+using namespace std;
 
 static const double pi = 4.0*atan(1.0);
 
@@ -41,16 +45,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::linear_extrude(std::share
 {
    // here, we "simply" perform a linear sweep
 
-   std::shared_ptr<polyset2d> polyset = profile->polyset();
-   double maxlen = mesh_utils::maxlen_factor()*polyset->greatest_extent();
+   // the cap triangulation is shared by all extrusions of identical profiles
+   std::shared_ptr<const polymesh2d> pm2d = primitive_cache::singleton().profile_mesh(profile);
 
- //  dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
-
-   std::shared_ptr<sweep_path_linear>  path(new sweep_path_linear(tess.mesh(),h));
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   std::shared_ptr<sweep_path_linear>  path(new sweep_path_linear(pm2d,h));
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = sweep_mesh(path,false).create_carve_mesh(t);
 
 
    carve::mesh::MeshSimplifier simplifier;
@@ -71,20 +70,14 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::rotate_extrude(std::share
       cout << "...Info: rotate_extrude angle>=2*PI implies a torus" << endl;
    }
 
-   std::shared_ptr<polyset2d> polyset = profile->polyset();
-   double maxlen = mesh_utils::maxlen_factor()*polyset->greatest_extent();
-
-   // first tesselate the 2d mesh
-  // dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
+   // first tesselate the 2d mesh, shared by all extrusions of identical profiles
+   std::shared_ptr<const polymesh2d> pm2d = primitive_cache::singleton().profile_mesh(profile);
 
    // then use the 2d mesh as basis for sweep
-   std::shared_ptr<sweep_path_rotate>  path(new sweep_path_rotate(tess.mesh(),angle,pitch));
+   std::shared_ptr<sweep_path_rotate>  path(new sweep_path_rotate(pm2d,angle,pitch));
 
-   // extract the resulting polyhedron and turn it into a carve mesh
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path, torus).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   // sweep the profile directly into a carve mesh
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = sweep_mesh(path, torus).create_carve_mesh(t);
 
    // cleanup
    carve::mesh::MeshSimplifier simplifier;
@@ -128,8 +121,7 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::transform_extrude(const c
    tess_top.tesselate(pset_top);
 
    std::shared_ptr<sweep_path_transform>  path(new sweep_path_transform(t_bot, tess_bot.mesh(),t_top,tess_top.mesh()));
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = sweep_mesh(path,false).create_carve_mesh(t);
 
    carve::mesh::MeshSimplifier simplifier;
    double min_normal_angle=(pi/180.)*1E-4;  // 1E-4 degrees
@@ -142,19 +134,13 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::sweep_extrude(std::shared
                                                                      std::shared_ptr<const csplines::spline_path> spath,
                                                                      const carve::math::Matrix& t)
 {
-   std::shared_ptr<polyset2d> polyset = profile->polyset();
-   double maxlen = mesh_utils::maxlen_factor()*polyset->greatest_extent();
-
-   // tesselate the profile
-//   dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
+   // tesselate the profile, shared by all extrusions of identical profiles
+   std::shared_ptr<const polymesh2d> pm2d = primitive_cache::singleton().profile_mesh(profile);
 
    // use the 2d mesh as basis for sweep
    int nseg = -1;
-   std::shared_ptr<sweep_path_spline>  path(new sweep_path_spline(tess.mesh(),spath,nseg));
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   std::shared_ptr<sweep_path_spline>  path(new sweep_path_spline(pm2d,spath,nseg));
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = sweep_mesh(path,false).create_carve_mesh(t);
 
    carve::mesh::MeshSimplifier simplifier;
    double min_normal_angle=(pi/180.)*1E-4;  // 1E-4 degrees
@@ -182,10 +168,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::clone_transform(std::shar
 {
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh(meshset->clone());
 
+   // the vertex coordinates are strided by the size of the carve vertex
    size_t nvert =  mesh->vertex_storage.size();
-   for(size_t i=0;i<nvert;i++) {
-      carve::mesh::MeshSet<3>::vertex_t& vertex = mesh->vertex_storage[i];
-      vertex = t * carve::geom::VECTOR(vertex.v[0],vertex.v[1],vertex.v[2]);
+   if(nvert > 0) {
+      double* v = &mesh->vertex_storage[0].v.v[0];
+      mesh_utils::transform(t,v,sizeof(carve::mesh::MeshSet<3>::vertex_t),v,sizeof(carve::mesh::MeshSet<3>::vertex_t),nvert);
    }
    return mesh;
 }
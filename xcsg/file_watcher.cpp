@@ -0,0 +1,238 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "file_watcher.h"
+#include "std_filename.h"
+#include <stdexcept>
+#include <chrono>
+#include <boost/filesystem.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <thread>
+#include <algorithm>
+#endif
+
+typedef std::chrono::steady_clock watch_clock;
+
+// milliseconds left until deadline, negative for no deadline
+static int remaining_ms(int timeout_ms, const watch_clock::time_point& deadline)
+{
+   if(timeout_ms < 0) return -1;
+   auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - watch_clock::now()).count();
+   return (left > 0)? static_cast<int>(left) : 0;
+}
+
+#if defined(_WIN32)
+
+struct file_watcher::impl {
+   HANDLE       dir;
+   OVERLAPPED   ov;
+   DWORD        buffer[16384];   // DWORD aligned, as required
+   bool         pending;
+   std::wstring name;
+
+   bool start()
+   {
+      pending = ReadDirectoryChangesW(dir,buffer,sizeof(buffer),FALSE,
+                                      FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_SIZE|FILE_NOTIFY_CHANGE_FILE_NAME,
+                                      NULL,&ov,NULL) != FALSE;
+      return pending;
+   }
+};
+
+file_watcher::file_watcher(const std::string& path)
+: m_path(path)
+, m_impl(new impl)
+{
+   boost::filesystem::path p = boost::filesystem::absolute(path);
+   m_impl->name = p.filename().wstring();
+   m_impl->dir  = CreateFileW(p.parent_path().wstring().c_str(),FILE_LIST_DIRECTORY,
+                              FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,
+                              FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OVERLAPPED,NULL);
+   if(m_impl->dir == INVALID_HANDLE_VALUE) throw std::runtime_error("file_watcher: cannot watch directory of " + path);
+   ZeroMemory(&m_impl->ov,sizeof(m_impl->ov));
+   m_impl->ov.hEvent = CreateEvent(NULL,TRUE,FALSE,NULL);
+   if(!m_impl->start()) {
+      CloseHandle(m_impl->ov.hEvent);
+      CloseHandle(m_impl->dir);
+      throw std::runtime_error("file_watcher: cannot watch directory of " + path);
+   }
+}
+
+file_watcher::~file_watcher()
+{
+   if(m_impl->pending) {
+      CancelIo(m_impl->dir);
+      DWORD nbytes = 0;
+      GetOverlappedResult(m_impl->dir,&m_impl->ov,&nbytes,TRUE);
+   }
+   CloseHandle(m_impl->ov.hEvent);
+   CloseHandle(m_impl->dir);
+}
+
+int file_watcher::wait_event(int timeout_ms)
+{
+   watch_clock::time_point deadline = watch_clock::now() + std::chrono::milliseconds(timeout_ms);
+   for(;;) {
+      if(!m_impl->pending && !m_impl->start()) return -1;
+
+      int wait_ms = remaining_ms(timeout_ms,deadline);
+      DWORD status = WaitForSingleObject(m_impl->ov.hEvent,(wait_ms < 0)? INFINITE : DWORD(wait_ms));
+      if(status == WAIT_TIMEOUT) return 0;
+      if(status != WAIT_OBJECT_0) return -1;
+
+      DWORD nbytes = 0;
+      BOOL ok = GetOverlappedResult(m_impl->dir,&m_impl->ov,&nbytes,FALSE);
+      m_impl->pending = false;
+      ResetEvent(m_impl->ov.hEvent);
+      if(!ok) return -1;
+
+      // an empty result means the buffer overflowed, the file may be among the lost changes
+      if(nbytes == 0) return 1;
+
+      const char* entry = reinterpret_cast<const char*>(m_impl->buffer);
+      for(;;) {
+         const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+         std::wstring name(info->FileName,info->FileNameLength/sizeof(WCHAR));
+         if(_wcsicmp(name.c_str(),m_impl->name.c_str()) == 0) return 1;
+         if(info->NextEntryOffset == 0) break;
+         entry += info->NextEntryOffset;
+      }
+   }
+}
+
+#elif defined(__linux__)
+
+struct file_watcher::impl {
+   int         fd;
+   std::string name;
+};
+
+file_watcher::file_watcher(const std::string& path)
+: m_path(path)
+, m_impl(new impl)
+{
+   boost::filesystem::path p = boost::filesystem::absolute(path);
+   m_impl->name = p.filename().string();
+   m_impl->fd   = inotify_init1(IN_CLOEXEC);
+   if(m_impl->fd < 0) throw std::runtime_error("file_watcher: inotify not available");
+
+   // written in place, or replaced by a rename
+   uint32_t mask = IN_CLOSE_WRITE|IN_MODIFY|IN_MOVED_TO|IN_CREATE;
+   if(inotify_add_watch(m_impl->fd,p.parent_path().string().c_str(),mask) < 0) {
+      ::close(m_impl->fd);
+      throw std::runtime_error("file_watcher: cannot watch directory of " + path);
+   }
+}
+
+file_watcher::~file_watcher()
+{
+   ::close(m_impl->fd);
+}
+
+int file_watcher::wait_event(int timeout_ms)
+{
+   watch_clock::time_point deadline = watch_clock::now() + std::chrono::milliseconds(timeout_ms);
+   alignas(struct inotify_event) char buffer[16384];
+   for(;;) {
+      struct pollfd pfd;
+      pfd.fd      = m_impl->fd;
+      pfd.events  = POLLIN;
+      pfd.revents = 0;
+      int npoll = poll(&pfd,1,remaining_ms(timeout_ms,deadline));
+      if(npoll == 0) return 0;
+      if(npoll < 0) {
+         if(errno == EINTR) continue;
+         return -1;
+      }
+
+      ssize_t nbytes = ::read(m_impl->fd,buffer,sizeof(buffer));
+      if(nbytes <= 0) return -1;
+
+      bool changed = false;
+      for(char* entry = buffer; entry < buffer + nbytes; ) {
+         const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(entry);
+         if(ev->mask & (IN_IGNORED|IN_Q_OVERFLOW)) {
+            // the directory is gone, or changes were lost
+            if(ev->mask & IN_IGNORED) return -1;
+            changed = true;
+         }
+         else if(ev->len > 0 && m_impl->name == ev->name) changed = true;
+         entry += sizeof(struct inotify_event) + ev->len;
+      }
+      if(changed) return 1;
+   }
+}
+
+#else
+
+struct file_watcher::impl {
+   std::time_t stamp;
+   uintmax_t   size;
+};
+
+file_watcher::file_watcher(const std::string& path)
+: m_path(path)
+, m_impl(new impl)
+{
+   boost::system::error_code ec;
+   m_impl->stamp = boost::filesystem::last_write_time(path,ec);
+   m_impl->size  = boost::filesystem::file_size(path,ec);
+}
+
+file_watcher::~file_watcher()
+{}
+
+int file_watcher::wait_event(int timeout_ms)
+{
+   // no change notification here, the modification time and size are polled
+   watch_clock::time_point deadline = watch_clock::now() + std::chrono::milliseconds(timeout_ms);
+   for(;;) {
+      boost::system::error_code ec;
+      std::time_t stamp = boost::filesystem::last_write_time(m_path,ec);
+      uintmax_t   size  = boost::filesystem::file_size(m_path,ec);
+      if(stamp != m_impl->stamp || size != m_impl->size) {
+         m_impl->stamp = stamp;
+         m_impl->size  = size;
+         return 1;
+      }
+      int wait_ms = remaining_ms(timeout_ms,deadline);
+      if(wait_ms == 0) return 0;
+      std::this_thread::sleep_for(std::chrono::milliseconds((wait_ms < 0)? 250 : std::min(wait_ms,250)));
+   }
+}
+
+#endif
+
+bool file_watcher::wait(int settle_ms)
+{
+   int status = 0;
+   while((status = wait_event(-1)) == 0) {}
+   if(status < 0) return false;
+
+   // a save may be several writes, or a delete and a rename. Wait until the file exists and is quiet
+   for(;;) {
+      status = wait_event(settle_ms);
+      if(status < 0) return false;
+      if(status == 0 && std_filename::Exists(m_path)) return true;
+   }
+}
@@ -0,0 +1,51 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <memory>
+
+// file_watcher waits for a file to be written or replaced. The directory of the file is
+// watched, so editors saving through a temporary file and a rename are also seen.
+// It uses inotify on Linux and ReadDirectoryChangesW on Windows, elsewhere the
+// modification time is polled
+
+class file_watcher {
+public:
+   // throws std::runtime_error if the directory cannot be watched
+   file_watcher(const std::string& path);
+   virtual ~file_watcher();
+
+   // block until the file has changed and then stayed unchanged for settle_ms,
+   // so a save in several writes gives one change. Returns false on a watch error
+   bool wait(int settle_ms = 200);
+
+protected:
+   // wait up to timeout_ms for a change of the file, a negative timeout waits forever.
+   // Returns 1 for a change, 0 for a timeout and -1 for a watch error
+   int wait_event(int timeout_ms);
+
+private:
+   file_watcher(const file_watcher&) = delete;
+   file_watcher& operator=(const file_watcher&) = delete;
+
+   struct impl;                   // platform specific watch
+   std::string           m_path;
+   std::unique_ptr<impl> m_impl;
+};
+
+#endif // FILE_WATCHER_H
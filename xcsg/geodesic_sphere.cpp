@@ -18,8 +18,9 @@
 geodesic_sphere::geodesic_sphere(size_t idepth)
 {
    init(idepth);
-   m_vert.shrink_to_fit();
-   m_faces.shrink_to_fit();
+
+   // the midpoint map is not needed after subdivision
+   std::unordered_map<size_t,size_t>().swap(m_vmap);
 }
 
 geodesic_sphere::~geodesic_sphere()
@@ -47,11 +48,27 @@ const xface& geodesic_sphere::f_get(size_t f_ind) const
    return m_faces.at(f_ind);
 }
 
+void geodesic_sphere::face_arrays(std::vector<size_t>& face_offsets, std::vector<size_t>& face_indices, bool reverse_face) const
+{
+   // all faces are triangles
+   face_offsets.resize(m_faces.size()+1);
+   face_indices.resize(3*m_faces.size());
+   size_t k = 0;
+   for(size_t i=0; i<m_faces.size(); i++) {
+      const xface& face = m_faces[i];
+      face_offsets[i] = k;
+      for(size_t j=0; j<3; j++) face_indices[k++] = face[(reverse_face)? 2-j : j];
+   }
+   face_offsets[m_faces.size()] = k;
+}
+
 void geodesic_sphere::init(size_t idepth)
 {
-   // just reserve some
-   m_vert.reserve(12*3*3);
-   m_faces.reserve(20*3*3);
+   // each level of subdivision splits every face in 4 and adds one vertex per edge, so
+   // there will be 20*4^idepth faces and 10*4^idepth + 2 vertices. The midpoint map gets one entry per new vertex
+   const size_t nsplit = size_t(1) << (2*idepth);
+   m_faces.reserve(20*nsplit);
+   m_vmap.reserve(10*nsplit);
 
    // start with an Icosahedron
    // The magic numbers X and Z are chosen so that the distance from the origin to any of the vertices of the icosahedron is 1.0.
@@ -60,7 +77,8 @@ void geodesic_sphere::init(size_t idepth)
    const double Z = 0.850650808352039932;
 
     // create the 12 iniitial vertices
-    m_vert = {
+    m_vert.reserve(10*nsplit + 2);
+    m_vert.assign({
         carve::geom::VECTOR(-  X, 0.0,   Z ),
         carve::geom::VECTOR(   X, 0.0,   Z ),
         carve::geom::VECTOR(  -X, 0.0,  -Z ),
@@ -73,7 +91,7 @@ void geodesic_sphere::init(size_t idepth)
         carve::geom::VECTOR(  -Z,   X, 0.0 ),
         carve::geom::VECTOR(   Z,  -X, 0.0 ),
         carve::geom::VECTOR(  -Z,  -X, 0.0 )
-    };
+    });
 
     // the 20 initial icosahedron faces as vertex indices
     // these are just the starting faces, they will not become faces if idepth>0
@@ -19,7 +19,7 @@
 #include "xshape.h"
 #include "xface.h"
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 // inspired by http://stackoverflow.com/questions/17705621/algorithm-for-a-geodesic-sphere
 // rewritten and extended with topology
@@ -35,10 +35,16 @@ public:
    size_t         v_size() const;
    const xvertex& v_get(size_t v_ind) const;
 
+   // all vertices as one flat array, for transforming in a single pass
+   const std::vector<xvertex>& vertices() const { return m_vert; }
+
    // access faces
    size_t         f_size() const;
    const xface&   f_get(size_t f_ind) const;
 
+   // all faces as flat offset and index arrays, see xpolyhedron bulk construction
+   void face_arrays(std::vector<size_t>& face_offsets, std::vector<size_t>& face_indices, bool reverse_face) const;
+
 protected:
    void init(size_t idepth);
    void subdivide(size_t v1, size_t v2, size_t v3, size_t idepth);
@@ -46,9 +52,9 @@ protected:
    size_t sub_vertex(size_t iv1, size_t iv2);
 
 private:
-   std::map<size_t,size_t>  m_vmap;    // <key,vertex_index>
-   std::vector<xvertex>     m_vert;    // vertex coordinates
-   std::vector<xface>       m_faces;   // vertex indices for faces
+   std::unordered_map<size_t,size_t>  m_vmap;    // <key,vertex_index>, only used while subdividing
+   std::vector<xvertex>               m_vert;    // vertex coordinates
+   std::vector<xface>                 m_faces;   // vertex indices for faces
 };
 
 #endif // GEODESIC_SPHERE_H
@@ -0,0 +1,309 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "glb_file.h"
+#include "trace_writer.h"
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/convenience.hpp>
+
+// GLB container, all values little endian
+static const uint32_t glb_magic      = 0x46546C67;   // "glTF"
+static const uint32_t glb_version    = 2;
+static const uint32_t glb_chunk_json = 0x4E4F534A;   // "JSON"
+static const uint32_t glb_chunk_bin  = 0x004E4942;   // "BIN\0"
+
+// glTF enumerations
+static const int gl_unsigned_short        = 5123;
+static const int gl_unsigned_int          = 5125;
+static const int gl_float                 = 5126;
+static const int gl_array_buffer          = 34962;
+static const int gl_element_array_buffer  = 34963;
+static const int gl_triangles             = 4;
+
+// largest quantized coordinate
+static const double quantize_max = 65535.0;
+
+// elements converted per block when the stored type differs from the compact buffers
+static const size_t convert_block = 1<<16;
+
+static size_t padded(size_t nbytes) { return (nbytes+3) & ~size_t(3); }
+
+// binary layout of one lump in the BIN chunk: the indices followed by the positions,
+// both 4 byte aligned. Quantized positions are 3 uint16 padded to 8 bytes, as vertex
+// attributes must be 4 byte aligned
+struct glb_lump {
+   const triangle_mesh* mesh;
+   size_t number;           // lump number, from 1
+   size_t nvert;
+   size_t ntri;
+   bool   short_indices;
+   size_t index_offset;
+   size_t index_bytes;
+   size_t position_offset;
+   size_t position_stride;
+   size_t position_bytes;
+   double pmin[3];          // bounds of the positions as stored
+   double pmax[3];
+   double translation[3];   // quantized: position = translation + scale*q
+   double scale[3];
+};
+
+// a node places a glTF mesh, instances of another lump share its mesh
+struct glb_node {
+   size_t  imesh;
+   size_t  number;          // lump number, from 1
+   xvertex offset;
+};
+
+glb_file::glb_file(bool quantize)
+: m_quantize(quantize)
+{}
+
+glb_file::~glb_file()
+{}
+
+std::string glb_file::write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path)
+{
+   boost::filesystem::path fullpath(file_path);
+   boost::filesystem::path glb_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = glb_path.string() + ".glb";
+
+   // fix inconsistent slashes to something that is consistent and works everytwhere
+   std::replace(path.begin(),path.end(), '\\', '/');
+
+   std::ofstream out(path,std::ios::binary);
+   if(!out.is_open()) throw std::runtime_error("glb_file::write(...)  Failed to open: " + path);
+   if(!write(out,*meshes)) throw std::runtime_error("glb_file::write(...)  Failed to write: " + path);
+   out.close();
+   return path;
+}
+
+static void write_u32(std::ostream& out, uint32_t value)
+{
+   out.write(reinterpret_cast<const char*>(&value),sizeof(value));
+}
+
+static void write_padding(std::ostream& out, size_t nbytes, char c)
+{
+   for(size_t i=nbytes; i<padded(nbytes); i++) out.put(c);
+}
+
+static void write_vec3(std::ostream& json, const double* v)
+{
+   json << '[' << v[0] << ',' << v[1] << ',' << v[2] << ']';
+}
+
+bool glb_file::write(std::ostream& out, const mesh_vector& meshes)
+{
+   trace_span span("write_glb","export");
+
+   // lay out the BIN chunk, empty lumps are left out as glTF accessors cannot be empty.
+   // A lump that is an instance of another lump becomes a node referring to its mesh
+   std::vector<glb_lump> lumps;
+   std::vector<glb_node> nodes;
+   std::map<const triangle_mesh*,size_t> mesh_index;
+   size_t nbin = 0;
+   for(size_t inum=0; inum<meshes.size(); inum++) {
+      const std::shared_ptr<triangle_mesh>& mesh = meshes[inum];
+      if(mesh->ntriangles() == 0) continue;
+      if(mesh->source()) {
+         auto it = mesh_index.find(mesh->source().get());
+         if(it != mesh_index.end()) {
+            glb_node node = { it->second, inum+1, mesh->offset() };
+            nodes.push_back(node);
+            continue;
+         }
+      }
+      mesh_index[mesh.get()] = lumps.size();
+      glb_node node = { lumps.size(), inum+1, carve::geom::VECTOR(0.0,0.0,0.0) };
+      nodes.push_back(node);
+      const triangle_mesh::compact_buffers& compact = mesh->compact();
+
+      glb_lump lump;
+      lump.mesh            = mesh.get();
+      lump.number          = inum+1;
+      lump.nvert           = mesh->nvertices();
+      lump.ntri            = mesh->ntriangles();
+      lump.short_indices   = lump.nvert <= std::numeric_limits<uint16_t>::max();
+      lump.index_offset    = nbin;
+      lump.index_bytes     = 3*lump.ntri*((lump.short_indices)? sizeof(uint16_t) : sizeof(uint32_t));
+      lump.position_offset = lump.index_offset + padded(lump.index_bytes);
+      lump.position_stride = (m_quantize)? 4*sizeof(uint16_t) : 3*sizeof(float);
+      lump.position_bytes  = lump.nvert*lump.position_stride;
+      nbin = lump.position_offset + lump.position_bytes;
+
+      // the accessor bounds must match the stored values, so they come from the floats.
+      // Quantization spans the double precision bounds
+      for(size_t k=0; k<3; k++) {
+         lump.pmin[k] = std::numeric_limits<double>::max();
+         lump.pmax[k] = -std::numeric_limits<double>::max();
+      }
+      for(size_t ivert=0; ivert<lump.nvert; ivert++) {
+         for(size_t k=0; k<3; k++) {
+            double p = (m_quantize)? mesh->vertex(ivert).v[k] : compact.xyz[3*ivert+k];
+            lump.pmin[k] = std::min(lump.pmin[k],p);
+            lump.pmax[k] = std::max(lump.pmax[k],p);
+         }
+      }
+      if(m_quantize) {
+         for(size_t k=0; k<3; k++) {
+            double extent = lump.pmax[k] - lump.pmin[k];
+            lump.translation[k] = lump.pmin[k];
+            lump.scale[k]       = (extent > 0.0)? extent/quantize_max : 1.0;
+            lump.pmin[k]        = 0.0;
+            lump.pmax[k]        = (extent > 0.0)? quantize_max : 0.0;
+         }
+      }
+      lumps.push_back(lump);
+   }
+
+   // JSON chunk: one node, mesh and pair of accessors per lump, in one buffer
+   std::ostringstream json;
+   json.precision(std::numeric_limits<double>::max_digits10);
+   json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"xcsg\"}";
+   if(m_quantize) {
+      json << ",\"extensionsUsed\":[\"KHR_mesh_quantization\"],\"extensionsRequired\":[\"KHR_mesh_quantization\"]";
+   }
+   json << ",\"scene\":0,\"scenes\":[{\"nodes\":[";
+   for(size_t i=0; i<nodes.size(); i++) json << ((i>0)? ",":"") << i;
+   json << "]}]";
+
+   json << ",\"nodes\":[";
+   for(size_t i=0; i<nodes.size(); i++) {
+      const glb_node& node = nodes[i];
+      const glb_lump& lump = lumps[node.imesh];
+      json << ((i>0)? ",":"") << "{\"name\":\"lump" << node.number << "\",\"mesh\":" << node.imesh;
+      double translation[3];
+      bool translated = false;
+      for(size_t k=0; k<3; k++) {
+         translation[k] = node.offset.v[k] + ((m_quantize)? lump.translation[k] : 0.0);
+         translated = translated || translation[k] != 0.0;
+      }
+      if(translated) {
+         json << ",\"translation\":";
+         write_vec3(json,translation);
+      }
+      if(m_quantize) {
+         json << ",\"scale\":";
+         write_vec3(json,lump.scale);
+      }
+      json << '}';
+   }
+   json << ']';
+
+   json << ",\"meshes\":[";
+   for(size_t i=0; i<lumps.size(); i++) {
+      json << ((i>0)? ",":"") << "{\"name\":\"lump" << lumps[i].number << "\",\"primitives\":[{\"attributes\":{\"POSITION\":" << 2*i+1
+           << "},\"indices\":" << 2*i << ",\"mode\":" << gl_triangles << "}]}";
+   }
+   json << ']';
+
+   json << ",\"buffers\":[{\"byteLength\":" << nbin << "}]";
+
+   json << ",\"bufferViews\":[";
+   for(size_t i=0; i<lumps.size(); i++) {
+      const glb_lump& lump = lumps[i];
+      json << ((i>0)? ",":"")
+           << "{\"buffer\":0,\"byteOffset\":" << lump.index_offset << ",\"byteLength\":" << lump.index_bytes
+           << ",\"target\":" << gl_element_array_buffer << "}"
+           << ",{\"buffer\":0,\"byteOffset\":" << lump.position_offset << ",\"byteLength\":" << lump.position_bytes;
+      if(m_quantize) json << ",\"byteStride\":" << lump.position_stride;
+      json << ",\"target\":" << gl_array_buffer << "}";
+   }
+   json << ']';
+
+   json << ",\"accessors\":[";
+   for(size_t i=0; i<lumps.size(); i++) {
+      const glb_lump& lump = lumps[i];
+      json << ((i>0)? ",":"")
+           << "{\"bufferView\":" << 2*i << ",\"componentType\":" << ((lump.short_indices)? gl_unsigned_short : gl_unsigned_int)
+           << ",\"count\":" << 3*lump.ntri << ",\"type\":\"SCALAR\"}"
+           << ",{\"bufferView\":" << 2*i+1 << ",\"componentType\":" << ((m_quantize)? gl_unsigned_short : gl_float)
+           << ",\"count\":" << lump.nvert << ",\"type\":\"VEC3\",\"min\":";
+      write_vec3(json,lump.pmin);
+      json << ",\"max\":";
+      write_vec3(json,lump.pmax);
+      json << '}';
+   }
+   json << "]}";
+
+   const std::string text = json.str();
+   const size_t total = 12 + 8 + padded(text.size()) + 8 + nbin;
+   if(total > std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("glb_file::write(...)  Model exceeds the 4GB limit of GLB files");
+   }
+
+   write_u32(out,glb_magic);
+   write_u32(out,glb_version);
+   write_u32(out,static_cast<uint32_t>(total));
+
+   write_u32(out,static_cast<uint32_t>(padded(text.size())));
+   write_u32(out,glb_chunk_json);
+   out.write(text.data(),text.size());
+   write_padding(out,text.size(),' ');
+
+   // BIN chunk, streamed from the compact buffers of each lump
+   write_u32(out,static_cast<uint32_t>(nbin));
+   write_u32(out,glb_chunk_bin);
+   std::vector<uint16_t> block;
+   for(const glb_lump& lump : lumps) {
+      const triangle_mesh::compact_buffers& compact = lump.mesh->compact();
+
+      const size_t nind = 3*lump.ntri;
+      if(lump.short_indices) {
+         for(size_t ifirst=0; ifirst<nind; ifirst+=convert_block) {
+            size_t ilast = std::min(nind,ifirst+convert_block);
+            block.resize(ilast-ifirst);
+            for(size_t i=ifirst; i<ilast; i++) block[i-ifirst] = static_cast<uint16_t>(compact.indices[i]);
+            out.write(reinterpret_cast<const char*>(&block[0]),block.size()*sizeof(uint16_t));
+         }
+      }
+      else {
+         out.write(reinterpret_cast<const char*>(&compact.indices[0]),lump.index_bytes);
+      }
+      write_padding(out,lump.index_bytes,'\0');
+
+      if(m_quantize) {
+         for(size_t ifirst=0; ifirst<lump.nvert; ifirst+=convert_block) {
+            size_t ilast = std::min(lump.nvert,ifirst+convert_block);
+            block.resize(4*(ilast-ifirst));
+            for(size_t ivert=ifirst; ivert<ilast; ivert++) {
+               const xvertex& p = lump.mesh->vertex(ivert);
+               uint16_t* q = &block[4*(ivert-ifirst)];
+               for(size_t k=0; k<3; k++) {
+                  double value = std::round((p.v[k] - lump.translation[k])/lump.scale[k]);
+                  q[k] = static_cast<uint16_t>(std::max(0.0,std::min(quantize_max,value)));
+               }
+               q[3] = 0;
+            }
+            out.write(reinterpret_cast<const char*>(&block[0]),block.size()*sizeof(uint16_t));
+         }
+      }
+      else {
+         out.write(reinterpret_cast<const char*>(&compact.xyz[0]),lump.position_bytes);
+      }
+   }
+   return out.good();
+}
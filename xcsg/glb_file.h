@@ -0,0 +1,50 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef GLB_FILE_H
+#define GLB_FILE_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+#include "triangle_mesh.h"
+
+// Binary glTF 2.0 (GLB) export for web viewers. Each lump is one node with an indexed
+// triangle mesh, written from the compact buffers of the lump straight into the binary
+// chunk, so a viewer can upload it without parsing. Indices are 16 bit when the lump allows.
+// With quantize, positions are stored as 16 bit integers dequantized by the node transform,
+// as defined by the KHR_mesh_quantization extension. Instances of another lump are nodes
+// sharing the mesh of that lump.
+
+class glb_file {
+public:
+   typedef triangle_mesh::mesh_vector mesh_vector;
+
+   glb_file(bool quantize = false);
+   virtual ~glb_file();
+
+   // export to GLB, return the path to the file created
+   // input is full path to file, file extension will be replaced to ".glb"
+   std::string  write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path);
+
+   // write to a caller supplied stream opened in binary mode, returns false on stream failure
+   bool write(std::ostream& out, const mesh_vector& meshes);
+
+private:
+   bool m_quantize;
+};
+
+#endif // GLB_FILE_H
@@ -0,0 +1,92 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "gzip_writer.h"
+#include "zip_writer.h"
+#include "thread_pool.h"
+#include <vector>
+#include <stdexcept>
+
+// little endian integer for the gzip trailer
+static void put32(std::string& out, uint32_t value)
+{
+   for(int i=0; i<4; i++) out += char((value >> (8*i)) & 0xFF);
+}
+
+gzip_writer::gzip_writer()
+: m_crc(0)
+, m_size(0)
+{}
+
+gzip_writer::~gzip_writer()
+{
+   // errors are reported by explicit close() only
+   try { close(); }
+   catch(...) {}
+}
+
+bool gzip_writer::open(const std::string& path)
+{
+   m_crc  = 0;
+   m_size = 0;
+   m_pending.clear();
+   m_out.open(path,std::ios::binary);
+   if(!m_out.is_open()) return false;
+
+   // magic, deflate, no flags, no time, no extra flags, unknown OS
+   write_raw(std::string("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff",10));
+   return true;
+}
+
+void gzip_writer::write_raw(const std::string& bytes)
+{
+   m_out.write(bytes.data(),bytes.size());
+   if(!m_out) throw std::runtime_error("gzip_writer: write error");
+}
+
+void gzip_writer::write(const char* data, size_t len)
+{
+   if(!m_out.is_open()) throw std::logic_error("gzip_writer: write to closed file");
+
+   m_crc   = zip_writer::crc32(m_crc,data,len);
+   m_size += len;
+   m_pending.append(data,len);
+   if(m_pending.size() >= 2*thread_pool::singleton().nthreads()*zip_writer::deflate_chunk_size()) {
+      compress_pending();
+   }
+}
+
+void gzip_writer::compress_pending()
+{
+   std::vector<std::string> compressed;
+   zip_writer::deflate_parallel(m_pending.data(),m_pending.size(),compressed);
+   for(auto& c : compressed) write_raw(c);
+   m_pending.clear();
+}
+
+void gzip_writer::close()
+{
+   if(!m_out.is_open()) return;
+
+   compress_pending();
+
+   // final empty fixed Huffman block terminates the deflate stream
+   std::string trailer("\x03\x00",2);
+   put32(trailer,m_crc);
+   put32(trailer,uint32_t(m_size & 0xFFFFFFFFu));
+   write_raw(trailer);
+
+   m_out.close();
+   m_pending.shrink_to_fit();
+}
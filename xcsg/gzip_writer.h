@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef GZIP_WRITER_H
+#define GZIP_WRITER_H
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+// gzip_writer streams a single file in gzip format (RFC 1952), as used by --compress gzip.
+// Data is buffered and compressed with the parallel deflate of zip_writer, so
+// the memory used is bounded regardless of file size.
+
+class gzip_writer {
+public:
+   gzip_writer();
+   virtual ~gzip_writer();
+
+   // open file for writing, returns true if ok
+   bool open(const std::string& path);
+   bool is_open() const { return m_out.is_open(); }
+
+   // append data to the file
+   void write(const char* data, size_t len);
+   void write(const std::string& text) { write(text.data(),text.size()); }
+
+   // finish the deflate stream with the gzip trailer and close the file
+   void close();
+
+private:
+   void compress_pending();
+   void write_raw(const std::string& bytes);
+
+private:
+   std::ofstream m_out;
+   uint32_t      m_crc;
+   uint64_t      m_size;     // uncompressed bytes written
+   std::string   m_pending;  // uncompressed data not yet compressed
+};
+
+#endif // GZIP_WRITER_H
@@ -0,0 +1,294 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "job_admission.h"
+#include "cancel_token.h"
+#include "json_log.h"
+#include <boost/filesystem.hpp>
+#include <boost/date_time.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+// booleans with fewer faces than this per thread do not gain from more threads
+static const size_t faces_per_thread = 50000;
+
+// memory of a job process besides its meshes
+static const size_t job_base_bytes = size_t(64)*1024*1024;
+
+struct job_admission::job {
+   enum job_state { QUEUED, RUNNING, DONE };
+
+   job(const std::string& job_label)
+   : label(job_label), bytes(0), threads(1), state(QUEUED), status(0), sec(0.0)
+   {}
+
+   std::string label;
+   std::string command;   // empty for a job that could not be run
+   std::string log;       // captured output
+   std::string message;
+   size_t      bytes;
+   size_t      threads;
+   job_state   state;
+   int         status;
+   double      sec;
+};
+
+// an argument quoted for the shell of std::system
+static std::string quoted(const std::string& arg)
+{
+#if defined(_WIN32)
+   return "\"" + arg + "\"";
+#else
+   std::string q = "'";
+   for(char c : arg) {
+      if(c == '\'') q += "'\\''";
+      else          q += c;
+   }
+   return q + "'";
+#endif
+}
+
+// the command line of a job, as parsed by the job process
+static boost_command_line job_command_line(const std::vector<std::string>& args)
+{
+   std::vector<std::string> tokens(args);
+   tokens.insert(tokens.begin(),"xcsg");
+   std::vector<char*> argv;
+   for(auto& t : tokens) argv.push_back(&t[0]);
+   argv.push_back(nullptr);
+   return boost_command_line(static_cast<int>(tokens.size()),&argv[0]);
+}
+
+job_admission::job_admission(const boost_command_line& cmd, std::ostream& out, const report_function& report)
+: m_program(cmd.program())
+, m_cores(std::max(size_t(1),cmd.threads()))
+, m_budget(static_cast<size_t>(cmd.job_mem()*1024.0*1024.0))
+, m_out(out)
+, m_report(report)
+, m_next_start(0)
+, m_next_report(0)
+, m_running(0)
+, m_used_threads(0)
+, m_used_bytes(0)
+, m_nfail(0)
+{}
+
+job_admission::~job_admission()
+{
+   wait();
+}
+
+size_t job_admission::job_threads(const xcsg_main::job_estimate& e, size_t cores)
+{
+   // a tree of nbool booleans has at most nbool+1 meshes to combine at the same time
+   size_t threads = std::min(e.nbool+1,1+e.bool_faces/faces_per_thread);
+   return std::max(size_t(1),std::min(threads,cores));
+}
+
+void job_admission::submit(const std::string& label, const std::vector<std::string>& args)
+{
+   std::lock_guard<std::mutex> out_lock(m_out_mutex);
+   std::shared_ptr<job> j = std::make_shared<job>(label);
+
+   boost_command_line cmd = job_command_line(args);
+   if(!cmd.parsed_ok()) {
+      j->message = "invalid job command line";
+   }
+   else {
+      // the estimate runs here with its messages silenced, job output is not written meanwhile.
+      // A job that cannot be estimated is run anyway, its process reports the error.
+      // The estimate is taken on the simplified tree, the one the job evaluates
+      xcsg_main::job_estimate e;
+      size_t file_bytes = 0;
+      std::streambuf* buf = std::cout.rdbuf(nullptr);
+      try {
+         for(auto& file : cmd.xcsg_files()) {
+            boost::system::error_code ec;
+            uintmax_t nbytes = boost::filesystem::file_size(file,ec);
+            if(!ec) file_bytes += static_cast<size_t>(nbytes);
+            xcsg_main engine(cmd,file);
+            engine.set_estimate(&e);
+            engine.run();
+         }
+      }
+      catch(std::exception&) {}
+      std::cout.rdbuf(buf);
+      std::cout.clear();
+      cancel_token::singleton().reset();
+
+      // the input text is held while the tree is built
+      j->bytes   = e.peak_bytes + file_bytes + job_base_bytes;
+      j->threads = job_threads(e,m_cores);
+
+      boost::filesystem::path log = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("xcsg_job_%%%%-%%%%-%%%%.log");
+      j->log = log.string();
+
+      std::ostringstream command;
+      command << quoted(m_program);
+      for(auto& arg : cmd.job_args())   command << ' ' << quoted(arg);
+      for(auto& file : cmd.xcsg_files()) command << ' ' << quoted(file);
+      command << " --threads " << j->threads;
+#if defined(_WIN32)
+      command << " < NUL > " << quoted(j->log) << " 2>&1";
+      // cmd.exe removes the outer quotes of a command starting with a quote
+      j->command = "\"" + command.str() + "\"";
+#else
+      command << " < /dev/null > " << quoted(j->log) << " 2>&1";
+      j->command = command.str();
+#endif
+   }
+   queue(j);
+}
+
+void job_admission::submit_failed(const std::string& label, const std::string& message)
+{
+   std::lock_guard<std::mutex> out_lock(m_out_mutex);
+   std::shared_ptr<job> j = std::make_shared<job>(label);
+   j->message = message;
+   queue(j);
+}
+
+void job_admission::queue(std::shared_ptr<job> j)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.push_back(j);
+      start_admitted();
+   }
+   report_done();
+}
+
+void job_admission::start_admitted()
+{
+   // a long running server would otherwise keep a thread per job
+   join_finished();
+
+   // in the order submitted, a job waiting for its budget holds back the jobs after it
+   while(m_next_start < m_jobs.size()) {
+      std::shared_ptr<job> j = m_jobs[m_next_start];
+      if(j->command.length() == 0) {
+         j->status = 1;
+         j->state  = job::DONE;
+         m_next_start++;
+         continue;
+      }
+      bool fits = (m_used_bytes + j->bytes <= m_budget) && (m_used_threads + j->threads <= m_cores);
+      if(!fits && m_running > 0) break;
+
+      j->state = job::RUNNING;
+      m_running++;
+      m_used_bytes   += j->bytes;
+      m_used_threads += j->threads;
+      m_next_start++;
+      m_threads.push_back(boost::thread(&job_admission::run_job,this,j));
+   }
+}
+
+void job_admission::run_job(std::shared_ptr<job> j)
+{
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   int status = std::system(j->command.c_str());
+#if !defined(_WIN32)
+   status = (status != -1 && WIFEXITED(status))? WEXITSTATUS(status) : 1;
+#endif
+   double sec = 0.001*(boost::posix_time::microsec_clock::universal_time() - time_0).total_milliseconds();
+
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      j->status = status;
+      j->sec    = sec;
+      j->state  = job::DONE;
+      m_running--;
+      m_used_bytes   -= j->bytes;
+      m_used_threads -= j->threads;
+      start_admitted();
+   }
+
+   {
+      std::lock_guard<std::mutex> out_lock(m_out_mutex);
+      report_done();
+   }
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_finished.push_back(boost::this_thread::get_id());
+}
+
+void job_admission::join_finished()
+{
+   // the finished threads only return after their id is listed, so the joins are short
+   for(auto& id : m_finished) {
+      for(auto i=m_threads.begin(); i!=m_threads.end(); i++) {
+         if(i->get_id() == id) {
+            i->join();
+            m_threads.erase(i);
+            break;
+         }
+      }
+   }
+   m_finished.clear();
+}
+
+void job_admission::report_done()
+{
+   std::vector<std::shared_ptr<job>> done;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      while(m_next_report < m_jobs.size() && m_jobs[m_next_report]->state == job::DONE) done.push_back(m_jobs[m_next_report++]);
+   }
+   if(done.size() == 0) return;
+
+   size_t nfail = 0;
+   for(auto& j : done) {
+      if(j->log.length() > 0) {
+         {
+            std::ifstream in(j->log,std::ios::binary);
+            if(in.is_open() && in.peek() != std::ifstream::traits_type::eof()) m_out << in.rdbuf();
+         }
+         boost::system::error_code ec;
+         boost::filesystem::remove(j->log,ec);
+      }
+      json_log::record("job").add("job",j->label).add("status",j->status).add("sec",j->sec)
+                             .add("threads",j->threads).add("mb",j->bytes/(1024.0*1024.0));
+      if(m_report) m_report(j->label,j->status,j->sec,j->message);
+      m_out.flush();
+      if(j->status != 0) nfail++;
+   }
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_nfail += nfail;
+   m_reported.notify_all();
+}
+
+size_t job_admission::wait()
+{
+   std::vector<boost::thread> threads;
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_reported.wait(lock,[this]() { return m_next_report == m_jobs.size() && m_running == 0; });
+      threads.swap(m_threads);
+      m_finished.clear();
+   }
+   // the last report may still be written by its job thread
+   for(auto& t : threads) t.join();
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_nfail;
+}
@@ -0,0 +1,98 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef JOB_ADMISSION_H
+#define JOB_ADMISSION_H
+
+#include "boost_command_line.h"
+#include "xcsg_main.h"
+#include <boost/thread.hpp>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// job_admission runs batch and server jobs as concurrent xcsg processes within a memory budget
+// (--job_mem) and a core budget (--threads). The jobs cannot share this process, as the model
+// settings and caches are global. Each job is sized by a dry run estimate made here, as with
+// --estimate: its peak mesh memory, and a thread count growing with the faces entering its booleans.
+// Jobs are started in the order submitted, each waiting until it fits in the memory and cores
+// left by the running jobs, so large jobs queue instead of pushing the machine into swap.
+// A job larger than the whole budget runs alone. The output of each job is captured and
+// written in the order submitted, followed by the report of its exit status.
+
+class job_admission {
+public:
+   // called after the output of a job is written. status is the exit status of the job process,
+   // 0 ok, 2 stopped by --timeout, otherwise failed. message is set for a job that could not be run
+   typedef std::function<void(const std::string& label, int status, double sec, const std::string& message)> report_function;
+
+   job_admission(const boost_command_line& cmd, std::ostream& out, const report_function& report);
+   virtual ~job_admission();
+
+   // estimate and queue a job given its command line arguments, label identifies it in the report
+   void submit(const std::string& label, const std::vector<std::string>& args);
+
+   // queue a job that failed before it could be run, it is reported in turn
+   void submit_failed(const std::string& label, const std::string& message);
+
+   // wait until all jobs are reported, returns number of failed jobs
+   size_t wait();
+
+   // threads of a job with estimate e, at most cores
+   static size_t job_threads(const xcsg_main::job_estimate& e, size_t cores);
+
+private:
+   struct job;
+
+   void queue(std::shared_ptr<job> j);
+
+   // start queued jobs while they fit in the budget, m_mutex is locked
+   void start_admitted();
+
+   // run the job process on its own thread
+   void run_job(std::shared_ptr<job> j);
+
+   // join the threads of jobs that have been reported, m_mutex is locked
+   void join_finished();
+
+   // write output and report of completed jobs in order, m_out_mutex is locked
+   void report_done();
+
+private:
+   std::string                       m_program;
+   size_t                            m_cores;
+   size_t                            m_budget;        // bytes
+   std::ostream&                     m_out;
+   report_function                   m_report;
+
+   std::mutex                        m_out_mutex;     // job output and reports, and the silenced estimates
+   std::mutex                        m_mutex;         // the fields below
+   std::condition_variable           m_reported;
+   std::vector<std::shared_ptr<job>> m_jobs;
+   std::vector<boost::thread>        m_threads;
+   std::vector<boost::thread::id>    m_finished;      // job threads about to return
+   size_t                            m_next_start;
+   size_t                            m_next_report;
+   size_t                            m_running;
+   size_t                            m_used_threads;
+   size_t                            m_used_bytes;
+   size_t                            m_nfail;
+};
+
+#endif // JOB_ADMISSION_H
@@ -0,0 +1,122 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "json_log.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+// JSON string with quotes and control characters escaped
+static std::string quoted(const std::string& s)
+{
+   std::string q = "\"";
+   for(char c : s) {
+      switch(c) {
+         case '"':  q += "\\\""; break;
+         case '\\': q += "\\\\"; break;
+         case '\n': q += "\\n";  break;
+         case '\r': q += "\\r";  break;
+         case '\t': q += "\\t";  break;
+         default:   q += c;
+      }
+   }
+   return q + "\"";
+}
+
+json_log::json_log()
+: m_enabled(false)
+{}
+
+json_log::~json_log()
+{}
+
+void json_log::set_enabled(bool enabled)
+{
+   m_start   = boost::posix_time::microsec_clock::universal_time();
+   m_enabled = enabled;
+}
+
+double json_log::now() const
+{
+   return 1.0E-6*(boost::posix_time::microsec_clock::universal_time() - m_start).total_microseconds();
+}
+
+void json_log::write(const std::string& line)
+{
+   // events come from several threads, each line is written whole
+   std::lock_guard<std::mutex> lock(m_mutex);
+   std::cout << line << std::endl;
+}
+
+json_log::record::record(const char* event)
+: m_enabled(json_log::singleton().enabled())
+{
+   if(m_enabled) {
+      std::ostringstream out;
+      out << std::setprecision(6) << "{\"event\":" << quoted(event) << ",\"t\":" << json_log::singleton().now();
+      m_line = out.str();
+   }
+}
+
+json_log::record::~record()
+{
+   if(m_enabled) json_log::singleton().write(m_line + "}");
+}
+
+json_log::record& json_log::record::add(const char* name, const std::string& value)
+{
+   if(m_enabled) m_line += "," + quoted(name) + ":" + quoted(value);
+   return *this;
+}
+
+json_log::record& json_log::record::add(const char* name, double value)
+{
+   if(m_enabled) {
+      std::ostringstream out;
+      out << std::setprecision(6) << value;
+      m_line += "," + quoted(name) + ":" + out.str();
+   }
+   return *this;
+}
+
+json_log::record& json_log::record::add(const char* name, size_t value)
+{
+   if(m_enabled) m_line += "," + quoted(name) + ":" + std::to_string(value);
+   return *this;
+}
+
+json_log::record& json_log::record::add(const char* name, int value)
+{
+   if(m_enabled) m_line += "," + quoted(name) + ":" + std::to_string(value);
+   return *this;
+}
+
+json_log::record& json_log::record::add(const char* name, bool value)
+{
+   if(m_enabled) m_line += "," + quoted(name) + ":" + (value? "true" : "false");
+   return *this;
+}
+
+json_log::phase::phase(const char* name)
+: m_name(name)
+, m_start(json_log::singleton().now())
+{
+   json_log::record("phase_start").add("phase",m_name);
+}
+
+json_log::phase::~phase()
+{
+   json_log::record("phase_end").add("phase",m_name).add("sec",json_log::singleton().now()-m_start);
+}
@@ -0,0 +1,82 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef JSON_LOG_H
+#define JSON_LOG_H
+
+#include <mutex>
+#include <string>
+#include <ostream>
+#include <boost/date_time.hpp>
+
+// json_log writes machine readable progress events to stdout (--json_log), one JSON
+// object per line, e.g. {"event":"phase_end","t":1.25,"phase":"boolean","sec":0.98}.
+// Every event has its name and the time "t" in seconds since the log was enabled.
+// The usual text lines are still written, so readers should keep only lines starting with '{'.
+// Logging is off unless enabled, then json_log::record costs only a flag test.
+
+class json_log {
+public:
+   static json_log& singleton()  { static json_log instance; return instance;  }
+
+   void set_enabled(bool enabled);
+   bool enabled() const { return m_enabled; }
+
+   // seconds since the log was enabled
+   double now() const;
+
+   // record builds one event line from name/value fields and writes it when destroyed
+   class record {
+   public:
+      record(const char* event);
+      ~record();
+
+      record& add(const char* name, const std::string& value);
+      record& add(const char* name, const char* value) { return add(name,std::string(value)); }
+      record& add(const char* name, double value);
+      record& add(const char* name, size_t value);
+      record& add(const char* name, int value);
+      record& add(const char* name, bool value);
+
+   private:
+      record(const record&) = delete;
+      record& operator=(const record&) = delete;
+      bool        m_enabled;
+      std::string m_line;
+   };
+
+   // phase writes phase_start when constructed and phase_end with the elapsed time when destroyed
+   class phase {
+   public:
+      phase(const char* name);
+      ~phase();
+   private:
+      const char* m_name;
+      double      m_start;
+   };
+
+protected:
+   json_log();
+   virtual ~json_log();
+
+   void write(const std::string& line);
+
+private:
+   bool                     m_enabled;
+   boost::posix_time::ptime m_start;
+   std::mutex               m_mutex;
+};
+
+#endif // JSON_LOG_H
@@ -0,0 +1,170 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef LOCKFREE_QUEUE_H
+#define LOCKFREE_QUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+#include <utility>
+
+// lockfree_queue is a bounded multi-producer/multi-consumer queue with the same
+// interface as safe_queue. It is an array of cells with sequence numbers
+// (D. Vyukov's bounded MPMC queue), so enqueue and try_dequeue take no locks.
+// The capacity is rounded up to a power of 2. enqueue() yields while the queue is full,
+// so a queue filled before any consumer starts must be given enough capacity.
+
+template <class T>
+class lockfree_queue {
+public:
+   lockfree_queue(size_t capacity = 1024)
+   : m_enqueue_pos(0)
+   , m_dequeue_pos(0)
+   {
+      reserve(capacity);
+   }
+
+   ~lockfree_queue(void)
+   {}
+
+   // set the capacity. Not thread safe, must be called before the queue is used
+   void reserve(size_t capacity)
+   {
+      size_t n = 2;
+      while(n < capacity) n *= 2;
+      if(n <= m_cells.size()) return;
+
+      std::vector<cell> cells(n);
+      for(size_t i=0; i<n; i++) {
+         cells[i].seq.store(i,std::memory_order_relaxed);
+      }
+      m_cells.swap(cells);
+      m_mask = n-1;
+      m_enqueue_pos.store(0,std::memory_order_relaxed);
+      m_dequeue_pos.store(0,std::memory_order_relaxed);
+   }
+
+   // return false if queue is full
+   bool try_enqueue(const T& t)
+   {
+      size_t pos = 0;
+      cell* c = claim_enqueue(pos);
+      if(!c) return false;
+      c->data = t;
+      c->seq.store(pos+1,std::memory_order_release);
+      return true;
+   }
+
+   // return false if queue is full, t is then left unchanged
+   bool try_enqueue(T&& t)
+   {
+      size_t pos = 0;
+      cell* c = claim_enqueue(pos);
+      if(!c) return false;
+      c->data = std::move(t);
+      c->seq.store(pos+1,std::memory_order_release);
+      return true;
+   }
+
+   // yield while queue is full
+   void enqueue(T t)
+   {
+      while(!try_enqueue(std::move(t))) std::this_thread::yield();
+   }
+
+   // construct the element, then move it in
+   template <class... Args>
+   void emplace(Args&&... args)
+   {
+      enqueue(T(std::forward<Args>(args)...));
+   }
+
+   // return false if queue is empty
+   bool try_dequeue(T& val)
+   {
+      cell* c = 0;
+      size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      while(true) {
+         c = &m_cells[pos & m_mask];
+         size_t seq = c->seq.load(std::memory_order_acquire);
+         std::ptrdiff_t dif = std::ptrdiff_t(seq) - std::ptrdiff_t(pos+1);
+         if(dif == 0) {
+            if(m_dequeue_pos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))break;
+         }
+         else if(dif < 0) return false;
+         else pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+      val = std::move(c->data);
+      c->data = T();
+      c->seq.store(pos+m_mask+1,std::memory_order_release);
+      return true;
+   }
+
+   // yield while queue is empty
+   T dequeue(void)
+   {
+      T val;
+      while(!try_dequeue(val)) std::this_thread::yield();
+      return val;
+   }
+
+   // approximate when used concurrently
+   size_t size() const
+   {
+      size_t deq = m_dequeue_pos.load(std::memory_order_relaxed);
+      size_t enq = m_enqueue_pos.load(std::memory_order_relaxed);
+      return (enq > deq)? enq-deq : 0;
+   }
+
+private:
+   lockfree_queue(const lockfree_queue&) = delete;
+   lockfree_queue& operator=(const lockfree_queue&) = delete;
+
+   struct cell {
+      cell() : seq(0), data() {}
+      cell(const cell& other) : seq(other.seq.load()), data(other.data) {}
+      std::atomic<size_t> seq;
+      T                   data;
+   };
+
+   // reserve the cell at the enqueue position pos, nullptr if queue is full
+   cell* claim_enqueue(size_t& pos)
+   {
+      cell* c = 0;
+      pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      while(true) {
+         c = &m_cells[pos & m_mask];
+         size_t seq = c->seq.load(std::memory_order_acquire);
+         std::ptrdiff_t dif = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+         if(dif == 0) {
+            if(m_enqueue_pos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))break;
+         }
+         else if(dif < 0) return 0;
+         else pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+      return c;
+   }
+
+   std::vector<cell>   m_cells;
+   size_t              m_mask;
+
+   // producer and consumer positions on separate cache lines
+   alignas(64) std::atomic<size_t> m_enqueue_pos;
+   alignas(64) std::atomic<size_t> m_dequeue_pos;
+};
+
+#endif // LOCKFREE_QUEUE_H
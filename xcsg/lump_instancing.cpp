@@ -0,0 +1,174 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "lump_instancing.h"
+#include "thread_pool.h"
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+typedef carve::mesh::Vertex<3>  vertex_t;
+typedef carve::mesh::Edge<3>    edge_t;
+typedef carve::mesh::Face<3>    face_t;
+
+// canonical form of a lump, independent of its position and of the vertex and face order
+struct canonical_lump {
+   canonical_lump() : valid(false), hash(0) {}
+   bool                  valid;    // false if two vertices fall on the same grid point
+   xvertex               origin;   // minimum corner of the vertices
+   std::vector<int64_t>  coords;   // grid coordinates relative to origin, sorted, 3 per vertex
+   std::vector<uint32_t> faces;    // per face: vertex count and ranks, first rank smallest, faces sorted
+   size_t                hash;
+};
+
+static inline void hash_combine(size_t& seed, size_t value)
+{
+   seed ^= value + 0x9e3779b97f4a7c15ULL + (seed<<6) + (seed>>2);
+}
+
+static canonical_lump make_canonical(const carve::mesh::Mesh<3>* mesh, double tolerance)
+{
+   canonical_lump canon;
+
+   // local vertex numbers and face loops in mesh order
+   std::unordered_map<const vertex_t*,uint32_t> local;
+   std::vector<const vertex_t*> vertices;
+   std::vector<uint32_t> loops;
+   std::vector<size_t>   first;
+   for(const face_t* face : mesh->faces) {
+      first.push_back(loops.size());
+      const edge_t* edge = face->edge;
+      do {
+         auto it = local.find(edge->vert);
+         if(it == local.end()) {
+            it = local.insert(std::make_pair(edge->vert,static_cast<uint32_t>(vertices.size()))).first;
+            vertices.push_back(edge->vert);
+         }
+         loops.push_back(it->second);
+         edge = edge->next;
+      } while(edge != face->edge);
+   }
+   first.push_back(loops.size());
+   if(vertices.size() == 0) return canon;
+
+   canon.origin = vertices[0]->v;
+   for(const vertex_t* v : vertices) {
+      for(size_t k=0; k<3; k++) canon.origin.v[k] = std::min(canon.origin.v[k],v->v.v[k]);
+   }
+
+   // grid coordinates, sorted. Their rank is the canonical vertex number
+   const size_t nvert = vertices.size();
+   std::vector<int64_t> grid(3*nvert);
+   for(size_t i=0; i<nvert; i++) {
+      for(size_t k=0; k<3; k++) grid[3*i+k] = std::llround((vertices[i]->v.v[k] - canon.origin.v[k])/tolerance);
+   }
+   std::vector<uint32_t> order(nvert);
+   for(size_t i=0; i<nvert; i++) order[i] = static_cast<uint32_t>(i);
+   auto less = [&grid](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(&grid[3*a],&grid[3*a+3],&grid[3*b],&grid[3*b+3]);
+   };
+   std::sort(order.begin(),order.end(),less);
+   std::vector<uint32_t> rank(nvert);
+   canon.coords.resize(3*nvert);
+   for(size_t i=0; i<nvert; i++) {
+      if(i>0 && !less(order[i-1],order[i])) return canon;
+      rank[order[i]] = static_cast<uint32_t>(i);
+      std::copy(&grid[3*order[i]],&grid[3*order[i]+3],&canon.coords[3*i]);
+   }
+
+   // face loops in ranks, rotated to start at the smallest rank so the orientation is kept
+   const size_t nface = first.size()-1;
+   std::vector<std::vector<uint32_t>> faces(nface);
+   for(size_t iface=0; iface<nface; iface++) {
+      std::vector<uint32_t>& face = faces[iface];
+      for(size_t i=first[iface]; i<first[iface+1]; i++) face.push_back(rank[loops[i]]);
+      std::rotate(face.begin(),std::min_element(face.begin(),face.end()),face.end());
+   }
+   std::sort(faces.begin(),faces.end());
+   canon.faces.reserve(loops.size() + nface);
+   for(auto& face : faces) {
+      canon.faces.push_back(static_cast<uint32_t>(face.size()));
+      canon.faces.insert(canon.faces.end(),face.begin(),face.end());
+   }
+
+   canon.hash = 0;
+   for(int64_t c : canon.coords)  hash_combine(canon.hash,static_cast<size_t>(c));
+   for(uint32_t f : canon.faces)  hash_combine(canon.hash,f);
+   canon.valid = true;
+   return canon;
+}
+
+lump_instancing::lump_instancing(const MeshSet& mesh_set, double tolerance)
+: m_source(mesh_set.meshes.size())
+, m_offset(mesh_set.meshes.size(),carve::geom::VECTOR(0.0,0.0,0.0))
+, m_ninstances(0)
+{
+   const size_t nmani = mesh_set.meshes.size();
+   for(size_t imani=0; imani<nmani; imani++) m_source[imani] = imani;
+
+   // candidates share the number of faces and face vertices
+   std::map<std::pair<size_t,size_t>,std::vector<size_t>> buckets;
+   for(size_t imani=0; imani<nmani; imani++) {
+      const carve::mesh::Mesh<3>* mesh = mesh_set.meshes[imani];
+      size_t nhalf = 0;
+      for(const face_t* face : mesh->faces) nhalf += face->n_edges;
+      buckets[std::make_pair(mesh->faces.size(),nhalf)].push_back(imani);
+   }
+
+   // canonical forms of the candidates, in parallel
+   std::vector<size_t> candidates;
+   for(auto& bucket : buckets) {
+      if(bucket.second.size() > 1) candidates.insert(candidates.end(),bucket.second.begin(),bucket.second.end());
+   }
+   if(candidates.size() == 0) return;
+
+   std::vector<canonical_lump> canon(nmani);
+   if(candidates.size() > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(size_t imani : candidates) {
+         const carve::mesh::Mesh<3>* mesh = mesh_set.meshes[imani];
+         canonical_lump* c = &canon[imani];
+         tasks.run([mesh,c,tolerance]() { *c = make_canonical(mesh,tolerance); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(size_t imani : candidates) canon[imani] = make_canonical(mesh_set.meshes[imani],tolerance);
+   }
+
+   // within a bucket, each lump becomes an instance of the first equal lump
+   for(auto& bucket : buckets) {
+      std::vector<size_t>& lumps = bucket.second;
+      for(size_t i=1; i<lumps.size(); i++) {
+         const canonical_lump& ci = canon[lumps[i]];
+         if(!ci.valid) continue;
+         for(size_t j=0; j<i; j++) {
+            const canonical_lump& cj = canon[lumps[j]];
+            if(m_source[lumps[j]] != lumps[j] || !cj.valid || cj.hash != ci.hash) continue;
+            if(cj.coords != ci.coords || cj.faces != ci.faces) continue;
+            m_source[lumps[i]] = lumps[j];
+            m_offset[lumps[i]] = ci.origin - cj.origin;
+            m_ninstances++;
+            break;
+         }
+      }
+   }
+}
+
+lump_instancing::~lump_instancing()
+{}
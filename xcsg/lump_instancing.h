@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef LUMP_INSTANCING_H
+#define LUMP_INSTANCING_H
+
+#include <vector>
+#include <cstddef>
+#include <carve/mesh.hpp>
+#include "xshape.h"
+
+// lump_instancing finds the lumps of a result that are identical up to a translation,
+// such as arrays of identical parts. Each lump is reduced to a canonical form: its vertices
+// relative to the minimum corner of the lump on a grid of the given tolerance, in sorted
+// order, and its faces as loops of sorted vertex ranks. Lumps with equal canonical forms
+// are instances of the first of them, which is triangulated once and written once where
+// the format allows. Only lumps with the same numbers of faces and face vertices are
+// compared, so unique lumps cost one pass over their faces.
+
+class lump_instancing {
+public:
+   typedef carve::mesh::MeshSet<3> MeshSet;
+
+   lump_instancing(const MeshSet& mesh_set, double tolerance = 1.0E-6);
+   virtual ~lump_instancing();
+
+   // the lump whose triangulation is used for imani, imani itself when it is not an instance
+   size_t source(size_t imani) const { return m_source[imani]; }
+
+   // translation from the source lump to imani
+   const xvertex& offset(size_t imani) const { return m_offset[imani]; }
+
+   // number of lumps that are instances of another lump
+   size_t ninstances() const { return m_ninstances; }
+
+private:
+   std::vector<size_t>  m_source;
+   std::vector<xvertex> m_offset;
+   size_t               m_ninstances;
+};
+
+#endif // LUMP_INSTANCING_H
@@ -23,6 +23,20 @@ namespace bdt = boost::date_time;
 
 #include "boost_command_line.h"
 #include "xcsg_main.h"
+#include "xcsg_server.h"
+#include "job_admission.h"
+#include "xcsg_watch.h"
+#include "remote_worker.h"
+#include "cancel_token.h"
+#include "trace_writer.h"
+#include "thread_pool.h"
+#include "micro_bench.h"
+#include "json_log.h"
+#include <fstream>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 
 string elapsed_time(bpt::ptime time_begin, bpt::ptime time_end)
@@ -45,21 +59,131 @@ int main(int argc, char **argv)
    boost_command_line cmd(argc,argv);
    if(cmd.parsed_ok()) {
       // command line parameters accepted
-      try {
-         xcsg_main engine(cmd);
-         if(engine.run()) {
+      trace_writer& trace = trace_writer::singleton();
+      if(cmd.count("trace") > 0) trace.open(cmd.get<std::string>("trace"));
+      json_log::singleton().set_enabled(cmd.count("json_log") > 0);
 
-            // report the elapsed time
-            cout << "xcsg finished using "<< elapsed_time(time_begin,bdt::microsec_clock<bpt::ptime>::local_time()) << endl;
-            return 0;
+      if(cmd.count("microbench") > 0) {
+         // kernel timings only, no input file is processed
+         try {
+            thread_pool::configure(cmd.threads(),cmd.count("pin_threads")>0);
+            std::ofstream json("xcsg_microbench.json");
+            micro_bench().run(cmd.get<std::string>("microbench"),cout,json);
+            cout << "Created microbench file: xcsg_microbench.json" << endl;
          }
+         catch(std::exception& ex) {
+            cout << "xcsg finished with exception: " << ex.what() << endl;
+            return 1;
+         }
+         return 0;
+      }
+
+      if(cmd.count("worker") > 0) {
+         remote_worker worker(cmd);
+         return worker.run(static_cast<unsigned short>(cmd.worker_port()))? 0 : 1;
+      }
+
+      if(cmd.count("server") > 0) {
+         xcsg_server server(cmd);
+         size_t nfail = server.run(cin);
+         if(trace.enabled() && !trace.close()) cout << "xcsg could not write trace file" << endl;
+         return (nfail > 0)? 1 : 0;
+      }
+
+      if(cmd.count("watch") > 0) {
+         xcsg_watch watch(cmd);
+         bool ok = watch.run(cmd.xcsg_files()[0]);
+         if(trace.enabled() && !trace.close()) cout << "xcsg could not write trace file" << endl;
+         return ok? 0 : 1;
+      }
+
+      // with --job_mem the files run as concurrent processes, admitted within the memory and core budget
+      if(cmd.job_mem() > 0.0 && cmd.xcsg_files().size() > 1) {
+         const std::vector<std::string>& files = cmd.xcsg_files();
+         int status = 0;
+         job_admission jobs(cmd,cout,[&status](const std::string& file, int code, double, const std::string& message) {
+            if(message.length() > 0) cout << "xcsg finished with exception: " << file << ": " << message << endl;
+            if(code == 2) { if(status == 0) status = 2; }
+            else if(code != 0) status = 1;
+         });
+         for(auto& file : files) {
+            std::vector<std::string> args(cmd.job_args());
+            args.push_back(file);
+            jobs.submit(file,args);
+         }
+         size_t nfail = jobs.wait();
+         cout << "xcsg batch: " << files.size()-nfail << " of " << files.size() << " files completed in "
+              << elapsed_time(time_begin,bdt::microsec_clock<bpt::ptime>::local_time()) << endl;
+         if(trace.enabled() && !trace.close()) cout << "xcsg could not write trace file" << endl;
+         return status;
+      }
+
+      // with --stdout the data owns stdout, all messages are redirected to stderr
+      std::streambuf* stdout_buf = nullptr;
+      if(cmd.stdout_format().length() > 0) {
+#ifdef _WIN32
+         _setmode(_fileno(stdout),_O_BINARY);
+#endif
+         stdout_buf = cout.rdbuf(cerr.rdbuf());
       }
-      catch(std::exception& ex) {
-         cout << "xcsg finished with exception: " << ex.what() << endl;
-         return 1;
+      std::ostream data_out(stdout_buf);
+
+      // several input files are processed one by one on the same thread pool,
+      // a failing file is reported and the batch continues
+      const std::vector<std::string>& files = cmd.xcsg_files();
+      size_t nfail = 0;
+      int status = 0;
+      for(auto& file : files) {
+         bpt::ptime  time_file = bdt::microsec_clock<bpt::ptime>::local_time();
+         cancel_token& token = cancel_token::singleton();
+         token.reset();
+         const double json_file = json_log::singleton().now();
+         json_log::record("file_start").add("file",file);
+         try {
+            xcsg_main engine(cmd,file);
+            if(stdout_buf) engine.set_stdout(&data_out);
+            if(engine.run()) {
+
+               // report the elapsed time
+               cout << "xcsg finished using "<< elapsed_time(time_file,bdt::microsec_clock<bpt::ptime>::local_time()) << endl;
+               json_log::record("file_end").add("file",file).add("status","ok").add("sec",json_log::singleton().now()-json_file);
+               continue;
+            }
+
+            // the file was not processed, counted as a failure like an exception
+            cout << "xcsg finished with error: " << file << " was not processed" << endl;
+            json_log::record("file_end").add("file",file).add("status","error").add("sec",json_log::singleton().now()-json_file).add("message","file not processed");
+            status = 1;
+            nfail++;
+         }
+         catch(std::exception& ex) {
+            if(token.timed_out()) {
+               // distinct exit status for runs stopped by --timeout
+               cout << "xcsg stopped after "<< elapsed_time(time_file,bdt::microsec_clock<bpt::ptime>::local_time()) << ": " << token.reason() << endl;
+               json_log::record("file_end").add("file",file).add("status","timeout").add("sec",json_log::singleton().now()-json_file).add("message",token.reason());
+               if(status == 0) status = 2;
+            }
+            else {
+               // report the first error, not the cancellations it caused in other threads
+               std::string reason = token.cancelled()? token.reason() : std::string(ex.what());
+               cout << "xcsg finished with exception: " << reason << endl;
+               json_log::record("file_end").add("file",file).add("status","error").add("sec",json_log::singleton().now()-json_file).add("message",reason);
+               status = 1;
+            }
+            nfail++;
+         }
       }
+
+      if(files.size() > 1) {
+         cout << "xcsg batch: " << files.size()-nfail << " of " << files.size() << " files completed in "
+              << elapsed_time(time_begin,bdt::microsec_clock<bpt::ptime>::local_time()) << endl;
+      }
+      if(trace.enabled()) {
+         if(trace.close()) cout << "Created trace file   : " << cmd.get<std::string>("trace") << endl;
+         else              cout << "xcsg could not write trace file: " << cmd.get<std::string>("trace") << endl;
+      }
+      if(stdout_buf) cout.rdbuf(stdout_buf);
+      return status;
    }
    return 0;
 }
-
-
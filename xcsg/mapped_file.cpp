@@ -0,0 +1,61 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+mapped_file::mapped_file(const std::string& path)
+: m_data(0)
+, m_size(0)
+, m_mapped(false)
+{
+#ifndef _WIN32
+   int fd = ::open(path.c_str(),O_RDONLY);
+   if(fd >= 0) {
+      struct stat st;
+      if(fstat(fd,&st) == 0 && st.st_size > 0) {
+         void* data = mmap(0,size_t(st.st_size),PROT_READ,MAP_PRIVATE,fd,0);
+         if(data != MAP_FAILED) {
+            madvise(data,size_t(st.st_size),MADV_SEQUENTIAL);
+            m_data   = static_cast<const char*>(data);
+            m_size   = size_t(st.st_size);
+            m_mapped = true;
+         }
+      }
+      ::close(fd);
+      if(m_mapped) return;
+   }
+#endif
+   std::ifstream in(path.c_str(),std::ios::binary);
+   if(!in.is_open()) throw std::runtime_error("Could not open file: " + path);
+   m_buffer.assign((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+   m_data = m_buffer.data();
+   m_size = m_buffer.size();
+}
+
+mapped_file::~mapped_file()
+{
+#ifndef _WIN32
+   if(m_mapped) munmap(const_cast<char*>(m_data),m_size);
+#endif
+}
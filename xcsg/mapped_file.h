@@ -0,0 +1,42 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+// mapped_file is a read only view of a whole file, memory mapped where supported.
+// Elsewhere, or if mapping fails, the file is read into a buffer instead
+
+class mapped_file {
+public:
+   // throws std::runtime_error if the file cannot be opened
+   mapped_file(const std::string& path);
+   virtual ~mapped_file();
+
+   const char* data() const { return m_data; }
+   size_t      size() const { return m_size; }
+
+private:
+   mapped_file(const mapped_file&) = delete;
+   mapped_file& operator=(const mapped_file&) = delete;
+
+   const char* m_data;
+   size_t      m_size;
+   bool        m_mapped;
+   std::string m_buffer;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,129 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mass_properties.h"
+#include "thread_pool.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// triangles per task
+static const size_t props_chunk = 1<<16;
+
+mass_properties::mass_properties()
+: m_ntri(0)
+, m_volume(0.0)
+, m_area(0.0)
+{
+   for(size_t k=0; k<3; k++) {
+      m_moment[k] = 0.0;
+      m_min[k]    =  std::numeric_limits<double>::max();
+      m_max[k]    = -std::numeric_limits<double>::max();
+   }
+}
+
+mass_properties::mass_properties(const triangle_mesh& lump)
+: mass_properties()
+{
+   const size_t ntri = lump.ntriangles();
+   if(ntri == 0) return;
+
+   // tetrahedra from the first vertex keep the sums small for lumps far from the origin
+   const xvertex ref = lump.vertex(0);
+   const size_t nchunk = (ntri + props_chunk-1)/props_chunk;
+   std::vector<mass_properties> chunks(nchunk);
+   auto compute = [&lump,&ref,&chunks](size_t ichunk, size_t ifirst, size_t ilast) {
+      mass_properties& p = chunks[ichunk];
+      for(size_t itri=ifirst; itri<ilast; itri++) {
+         const size_t* tri = lump.triangle(itri);
+         double v[3][3];
+         for(size_t i=0; i<3; i++) {
+            const xvertex pos = lump.vertex(tri[i]);
+            for(size_t k=0; k<3; k++) {
+               v[i][k] = pos.v[k] - ref.v[k];
+               p.m_min[k] = std::min(p.m_min[k],pos.v[k]);
+               p.m_max[k] = std::max(p.m_max[k],pos.v[k]);
+            }
+         }
+         const double x[] = { v[1][0]-v[0][0], v[1][1]-v[0][1], v[1][2]-v[0][2] };
+         const double y[] = { v[2][0]-v[0][0], v[2][1]-v[0][1], v[2][2]-v[0][2] };
+         const double z[] = { x[1]*y[2]-x[2]*y[1], x[2]*y[0]-x[0]*y[2], x[0]*y[1]-x[1]*y[0] };
+         p.m_area += 0.5*std::sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+
+         // signed volume of the tetrahedron (ref,v0,v1,v2), its centroid is (v0+v1+v2)/4 relative to ref
+         const double vol = ( v[0][0]*(v[1][1]*v[2][2]-v[1][2]*v[2][1])
+                            - v[0][1]*(v[1][0]*v[2][2]-v[1][2]*v[2][0])
+                            + v[0][2]*(v[1][0]*v[2][1]-v[1][1]*v[2][0]) )/6.0;
+         p.m_volume += vol;
+         for(size_t k=0; k<3; k++) p.m_moment[k] += 0.25*vol*(v[0][k]+v[1][k]+v[2][k]);
+      }
+      p.m_ntri += ilast - ifirst;
+   };
+
+   if(nchunk <= 1 || thread_pool::singleton().nthreads() <= 1) {
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) compute(ichunk,ichunk*props_chunk,std::min(ntri,(ichunk+1)*props_chunk));
+   }
+   else {
+      task_group tasks;
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+         size_t ifirst = ichunk*props_chunk;
+         size_t ilast  = std::min(ntri,ifirst+props_chunk);
+         tasks.run([&compute,ichunk,ifirst,ilast]() { compute(ichunk,ifirst,ilast); });
+      }
+      tasks.wait();
+   }
+
+   for(auto& p : chunks) add(p);
+
+   // the moment was summed about ref
+   for(size_t k=0; k<3; k++) m_moment[k] += m_volume*ref.v[k];
+}
+
+mass_properties::~mass_properties()
+{}
+
+void mass_properties::add(const mass_properties& other)
+{
+   m_ntri   += other.m_ntri;
+   m_volume += other.m_volume;
+   m_area   += other.m_area;
+   for(size_t k=0; k<3; k++) {
+      m_moment[k] += other.m_moment[k];
+      m_min[k] = std::min(m_min[k],other.m_min[k]);
+      m_max[k] = std::max(m_max[k],other.m_max[k]);
+   }
+}
+
+xvertex mass_properties::centroid() const
+{
+   if(empty()) return carve::geom::VECTOR(0.0,0.0,0.0);
+   if(m_volume == 0.0) return carve::geom::VECTOR(0.5*(m_min[0]+m_max[0]),0.5*(m_min[1]+m_max[1]),0.5*(m_min[2]+m_max[2]));
+   return carve::geom::VECTOR(m_moment[0]/m_volume,m_moment[1]/m_volume,m_moment[2]/m_volume);
+}
+
+void mass_properties::write_json(std::ostream& out) const
+{
+   auto write_vertex = [&out](const xvertex& p) { out << "[" << p.x << ", " << p.y << ", " << p.z << "]"; };
+   out << "{ \"volume\": " << m_volume << ", \"area\": " << m_area << ", \"triangles\": " << m_ntri << ", \"centroid\": ";
+   write_vertex(centroid());
+   if(!empty()) {
+      out << ", \"min\": ";
+      write_vertex(min());
+      out << ", \"max\": ";
+      write_vertex(max());
+   }
+   out << " }";
+}
@@ -0,0 +1,65 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MASS_PROPERTIES_H
+#define MASS_PROPERTIES_H
+
+#include <ostream>
+#include <cstddef>
+#include "triangle_mesh.h"
+
+// mass_properties of exported lumps: enclosed volume, surface area, centroid of the enclosed
+// volume and bounding box, computed from the triangles as they are written. The triangles are
+// summed as signed tetrahedra from a vertex of the lump, in parallel chunks whose sums are
+// added in chunk order, so the result does not depend on the number of threads.
+// Properties of several lumps are combined with add().
+
+class mass_properties {
+public:
+   // empty properties, zero volume and no bounding box
+   mass_properties();
+
+   // properties of one lump
+   explicit mass_properties(const triangle_mesh& lump);
+   virtual ~mass_properties();
+
+   // combine with the properties of another lump
+   void add(const mass_properties& other);
+
+   double volume() const { return m_volume; }
+   double area() const   { return m_area; }
+   size_t ntriangles() const { return m_ntri; }
+
+   // centroid of the enclosed volume, the centre of the bounding box if there is no volume
+   xvertex centroid() const;
+
+   // bounding box, only valid when not empty
+   bool empty() const { return m_ntri == 0; }
+   xvertex min() const { return carve::geom::VECTOR(m_min[0],m_min[1],m_min[2]); }
+   xvertex max() const { return carve::geom::VECTOR(m_max[0],m_max[1],m_max[2]); }
+
+   // write as a JSON object
+   void write_json(std::ostream& out) const;
+
+private:
+   size_t m_ntri;
+   double m_volume;
+   double m_area;
+   double m_moment[3];   // first moment of the volume, about the origin
+   double m_min[3];
+   double m_max[3];
+};
+
+#endif // MASS_PROPERTIES_H
@@ -0,0 +1,297 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mem_stats.h"
+#include "node_profiler.h"
+#include "json_log.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <iomanip>
+
+#ifdef _WIN32
+   #include <malloc.h>
+   #include <windows.h>
+   #include <psapi.h>
+#elif defined(__APPLE__)
+   #include <malloc/malloc.h>
+   #include <sys/resource.h>
+#else
+   #include <malloc.h>
+   #include <unistd.h>
+   #include <sys/resource.h>
+#endif
+
+// Counters updated by operator new/delete. They are plain globals so the allocator
+// never depends on the construction order of other statics, and never allocates itself.
+
+static const size_t max_slots = 64;   // top nodes beyond this are charged to the last slot
+
+struct node_counter {
+   std::atomic<size_t>    allocations;
+   std::atomic<size_t>    bytes;
+   std::atomic<long long> live;
+   std::atomic<long long> peak;
+};
+
+static std::atomic<bool>       counting(false);
+static std::atomic<size_t>     heap_allocations(0);
+static std::atomic<size_t>     heap_bytes(0);
+static std::atomic<long long>  heap_live(0);
+static std::atomic<long long>  heap_peak(0);          // reset to heap_live by each phase
+static std::atomic<const int*> node_slots(nullptr);   // slot per profiler node
+static std::atomic<size_t>     node_slots_size(0);
+static node_counter            node_counters[max_slots];
+
+static size_t block_size(void* p)
+{
+#ifdef _WIN32
+   return _msize(p);
+#elif defined(__APPLE__)
+   return malloc_size(p);
+#else
+   return malloc_usable_size(p);
+#endif
+}
+
+static void raise_max(std::atomic<long long>& peak, long long value)
+{
+   long long prev = peak.load(std::memory_order_relaxed);
+   while(value > prev && !peak.compare_exchange_weak(prev,value,std::memory_order_relaxed)) {}
+}
+
+static node_counter* current_counter()
+{
+   int inode = node_profiler::current();
+   if(inode < 0 || static_cast<size_t>(inode) >= node_slots_size.load(std::memory_order_acquire)) return nullptr;
+   int slot = node_slots.load(std::memory_order_acquire)[inode];
+   return (slot >= 0)? &node_counters[slot] : nullptr;
+}
+
+static void count_alloc(void* p, size_t size)
+{
+   long long block = static_cast<long long>(block_size(p));
+   heap_allocations.fetch_add(1,std::memory_order_relaxed);
+   heap_bytes.fetch_add(size,std::memory_order_relaxed);
+   raise_max(heap_peak,heap_live.fetch_add(block,std::memory_order_relaxed)+block);
+
+   if(node_counter* c = current_counter()) {
+      c->allocations.fetch_add(1,std::memory_order_relaxed);
+      c->bytes.fetch_add(size,std::memory_order_relaxed);
+      raise_max(c->peak,c->live.fetch_add(block,std::memory_order_relaxed)+block);
+   }
+}
+
+static void count_free(void* p)
+{
+   long long block = static_cast<long long>(block_size(p));
+   heap_live.fetch_sub(block,std::memory_order_relaxed);
+   if(node_counter* c = current_counter()) c->live.fetch_sub(block,std::memory_order_relaxed);
+}
+
+static void* allocate(size_t size, bool nothrow)
+{
+   if(size == 0) size = 1;
+   while(true) {
+      void* p = std::malloc(size);
+      if(p) {
+         if(counting.load(std::memory_order_relaxed)) count_alloc(p,size);
+         return p;
+      }
+      std::new_handler handler = std::get_new_handler();
+      if(!handler) {
+         if(nothrow) return nullptr;
+         throw std::bad_alloc();
+      }
+      handler();
+   }
+}
+
+static void deallocate(void* p)
+{
+   if(!p) return;
+   if(counting.load(std::memory_order_relaxed)) count_free(p);
+   std::free(p);
+}
+
+// replacement of the global allocation functions, memory is taken from malloc as by default
+void* operator new(std::size_t size)                                   { return allocate(size,false); }
+void* operator new[](std::size_t size)                                 { return allocate(size,false); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept   { return allocate(size,true); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size,true); }
+void  operator delete(void* p) noexcept                                { deallocate(p); }
+void  operator delete[](void* p) noexcept                              { deallocate(p); }
+void  operator delete(void* p, const std::nothrow_t&) noexcept         { deallocate(p); }
+void  operator delete[](void* p, const std::nothrow_t&) noexcept       { deallocate(p); }
+
+mem_stats::mem_stats()
+{}
+
+mem_stats::~mem_stats()
+{}
+
+void mem_stats::set_enabled(bool enabled)
+{
+   counting = enabled;
+}
+
+bool mem_stats::enabled() const
+{
+   return counting;
+}
+
+void mem_stats::clear()
+{
+   node_slots_size = 0;
+   node_slots = nullptr;
+   for(size_t i=0; i<max_slots; i++) {
+      node_counters[i].allocations = 0;
+      node_counters[i].bytes = 0;
+      node_counters[i].live  = 0;
+      node_counters[i].peak  = 0;
+   }
+   m_phases.clear();
+   m_node_slot.clear();
+   m_paths.clear();
+}
+
+size_t mem_stats::rss_kb()
+{
+#ifdef _WIN32
+   PROCESS_MEMORY_COUNTERS pmc;
+   if(GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc))) return pmc.WorkingSetSize/1024;
+   return 0;
+#elif defined(__APPLE__)
+   return 0;
+#else
+   // second field of statm is the resident set in pages
+   size_t pages = 0, resident = 0;
+   FILE* statm = std::fopen("/proc/self/statm","r");
+   if(!statm) return 0;
+   int nread = std::fscanf(statm,"%zu %zu",&pages,&resident);
+   std::fclose(statm);
+   return (nread == 2)? resident*(sysconf(_SC_PAGESIZE)/1024) : 0;
+#endif
+}
+
+size_t mem_stats::peak_rss_kb()
+{
+#ifdef _WIN32
+   PROCESS_MEMORY_COUNTERS pmc;
+   if(GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc))) return pmc.PeakWorkingSetSize/1024;
+   return 0;
+#else
+   struct rusage usage;
+   if(getrusage(RUSAGE_SELF,&usage) != 0) return 0;
+#ifdef __APPLE__
+   return usage.ru_maxrss/1024;   // bytes on macOS
+#else
+   return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void mem_stats::set_nodes(const std::vector<int>& node_slot, const std::vector<std::string>& paths)
+{
+   node_slots_size = 0;
+   m_node_slot = node_slot;
+   m_paths     = paths;
+   if(m_paths.size() > max_slots) {
+      m_paths.resize(max_slots);
+      m_paths.back() = "(other top nodes)";
+   }
+   for(int& slot : m_node_slot) {
+      if(slot >= static_cast<int>(max_slots)) slot = max_slots-1;
+   }
+   node_slots = m_node_slot.data();
+   node_slots_size = m_node_slot.size();
+}
+
+mem_stats::phase::phase(const char* name)
+: m_name(name)
+, m_rss_start(0)
+, m_allocations(0)
+, m_bytes(0)
+, m_heap_start(0)
+{
+   if(!mem_stats::singleton().enabled()) return;
+   m_rss_start   = rss_kb();
+   m_allocations = heap_allocations;
+   m_bytes       = heap_bytes;
+   m_heap_start  = heap_live;
+   heap_peak     = m_heap_start;
+}
+
+mem_stats::phase::~phase()
+{
+   mem_stats& stats = mem_stats::singleton();
+   if(!stats.enabled()) return;
+   phase_stat p;
+   p.name        = m_name;
+   p.rss_start   = m_rss_start;
+   p.rss_end     = rss_kb();
+   p.peak_rss    = peak_rss_kb();
+   p.allocations = heap_allocations - m_allocations;
+   p.bytes       = heap_bytes - m_bytes;
+   p.heap_start  = m_heap_start;
+   p.heap_peak   = heap_peak;
+   stats.m_phases.push_back(p);
+}
+
+// live heap counts go negative when blocks allocated before enabling are freed
+static size_t positive(long long bytes)
+{
+   return (bytes > 0)? static_cast<size_t>(bytes) : 0;
+}
+
+static double mbytes(long long bytes)
+{
+   return positive(bytes)/(1024.0*1024.0);
+}
+
+void mem_stats::write_report(std::ostream& out) const
+{
+   out << "...memory:  rss_start[MB]  rss_end[MB]  peak_rss[MB]  heap_peak[MB]  allocations  alloc[MB]  phase" << std::endl;
+   for(const phase_stat& p : m_phases) {
+      out << "..." << std::fixed << std::setprecision(1)
+          << std::setw(19) << p.rss_start/1024.0
+          << std::setw(13) << p.rss_end/1024.0
+          << std::setw(14) << p.peak_rss/1024.0
+          << std::setw(15) << mbytes(p.heap_peak)
+          << std::setw(13) << p.allocations
+          << std::setw(11) << mbytes(p.bytes)
+          << "  " << p.name << std::endl;
+      out.unsetf(std::ios_base::floatfield);
+      json_log::record("mem_phase").add("phase",p.name).add("rss_start_kb",p.rss_start).add("rss_end_kb",p.rss_end)
+                                   .add("peak_rss_kb",p.peak_rss).add("heap_peak",positive(p.heap_peak))
+                                   .add("allocations",p.allocations).add("bytes",p.bytes);
+   }
+
+   if(m_paths.size() > 0) {
+      out << "...memory:  heap_peak[MB]  allocations  alloc[MB]  top node" << std::endl;
+      for(size_t i=0; i<m_paths.size(); i++) {
+         const node_counter& c = node_counters[i];
+         out << "..." << std::fixed << std::setprecision(1)
+             << std::setw(19) << mbytes(c.peak)
+             << std::setw(13) << c.allocations
+             << std::setw(11) << mbytes(c.bytes)
+             << "  " << m_paths[i] << std::endl;
+         out.unsetf(std::ios_base::floatfield);
+         json_log::record("mem_node").add("path",m_paths[i]).add("heap_peak",positive(c.peak))
+                                     .add("allocations",size_t(c.allocations)).add("bytes",size_t(c.bytes));
+      }
+   }
+}
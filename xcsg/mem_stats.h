@@ -0,0 +1,81 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+// mem_stats samples the resident memory of the process at phase boundaries (--mem_stats).
+// While enabled, the global operator new/delete also count allocations and heap bytes,
+// and charge them to the top CSG node the allocating thread is working on.
+// Per node figures require the node_profiler, the current node of a thread is taken from there.
+
+class mem_stats {
+public:
+   static mem_stats& singleton()  { static mem_stats instance; return instance;  }
+
+   void set_enabled(bool enabled);
+   bool enabled() const;
+
+   // remove recorded phases and nodes
+   void clear();
+
+   // resident memory of the process now, and its high water mark, 0 when unknown
+   static size_t rss_kb();
+   static size_t peak_rss_kb();
+
+   // charge allocations to top nodes: node_slot[inode] is the index of the top node in paths, or -1
+   void set_nodes(const std::vector<int>& node_slot, const std::vector<std::string>& paths);
+
+   // phase samples memory when constructed and records the phase when destroyed
+   class phase {
+   public:
+      phase(const char* name);
+      ~phase();
+   private:
+      const char* m_name;
+      size_t      m_rss_start;
+      size_t      m_allocations;
+      size_t      m_bytes;
+      long long   m_heap_start;
+   };
+
+   // text report per phase and per top node, also as --json_log events
+   void write_report(std::ostream& out) const;
+
+protected:
+   mem_stats();
+   virtual ~mem_stats();
+
+private:
+   struct phase_stat {
+      std::string name;
+      size_t      rss_start,rss_end;  // kB
+      size_t      peak_rss;           // kB, process high water mark at end of phase
+      size_t      allocations;
+      size_t      bytes;              // bytes allocated in the phase
+      long long   heap_start;         // live heap bytes
+      long long   heap_peak;
+   };
+
+   std::vector<phase_stat>  m_phases;
+   std::vector<int>         m_node_slot;
+   std::vector<std::string> m_paths;
+};
+
+#endif // MEM_STATS_H
@@ -0,0 +1,300 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_binary.h"
+#include <carve/input.hpp>
+#include <vector>
+#include <cstring>
+
+static const char mesh_binary_magic[8] = { 'X','C','S','G','M','E','S','H' };
+static const char triangles_magic[8]   = { 'X','C','S','G','T','R','I','S' };
+
+// triangle form header: magic, version, lump count, vertex count, triangle count
+static const size_t triangles_header_size = 8 + 4 + 4 + 8 + 8;
+
+// values per block when writing the triangle form
+static const size_t triangles_block = 1<<16;
+
+template <typename T>
+static void write_value(std::ostream& out, T value)
+{
+   out.write(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::istream& in, T& value)
+{
+   in.read(reinterpret_cast<char*>(&value),sizeof(T));
+   return !in.fail();
+}
+
+bool mesh_binary::write(std::ostream& out, MeshSet_ptr mesh)
+{
+   out.write(mesh_binary_magic,sizeof(mesh_binary_magic));
+   write_value<uint32_t>(out,format_version());
+
+   size_t nvert = mesh->vertex_storage.size();
+   write_value<uint64_t>(out,nvert);
+   std::vector<double> xyz;
+   xyz.reserve(3*nvert);
+   for(size_t i=0; i<nvert; i++) {
+      const carve::mesh::MeshSet<3>::vertex_t& vertex = mesh->vertex_storage[i];
+      xyz.push_back(vertex.v[0]);
+      xyz.push_back(vertex.v[1]);
+      xyz.push_back(vertex.v[2]);
+   }
+   if(nvert > 0) out.write(reinterpret_cast<const char*>(&xyz[0]),xyz.size()*sizeof(double));
+
+   uint64_t nfaces = 0;
+   for(size_t imesh=0; imesh<mesh->meshes.size(); imesh++) {
+      nfaces += mesh->meshes[imesh]->faces.size();
+   }
+   write_value<uint64_t>(out,nfaces);
+
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = (nvert>0)? &mesh->vertex_storage[0] : 0;
+   std::vector<uint32_t> indices;
+   for(size_t imesh=0; imesh<mesh->meshes.size(); imesh++) {
+      carve::mesh::Mesh<3>* m = mesh->meshes[imesh];
+      for(size_t iface=0; iface<m->faces.size(); iface++) {
+         std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+         m->faces[iface]->getVertices(verts);
+         indices.clear();
+         indices.push_back(static_cast<uint32_t>(verts.size()));
+         for(size_t i=0; i<verts.size(); i++) {
+            indices.push_back(static_cast<uint32_t>(verts[i]-vbase));
+         }
+         out.write(reinterpret_cast<const char*>(&indices[0]),indices.size()*sizeof(uint32_t));
+      }
+   }
+   return out.good();
+}
+
+mesh_binary::MeshSet_ptr mesh_binary::read(std::istream& in)
+{
+   char magic[sizeof(mesh_binary_magic)];
+   in.read(magic,sizeof(magic));
+   if(!in.good() || std::memcmp(magic,mesh_binary_magic,sizeof(magic)) != 0) return nullptr;
+
+   uint32_t version = 0;
+   if(!read_value(in,version) || version != format_version()) return nullptr;
+
+   uint64_t nvert = 0;
+   if(!read_value(in,nvert)) return nullptr;
+
+   carve::input::PolyhedronData data;
+   data.reserveVertices(static_cast<int>(nvert));
+   std::vector<double> xyz(3*nvert);
+   if(nvert > 0) {
+      in.read(reinterpret_cast<char*>(&xyz[0]),xyz.size()*sizeof(double));
+      if(!in.good()) return nullptr;
+   }
+   for(size_t i=0; i<nvert; i++) {
+      data.addVertex(carve::geom::VECTOR(xyz[3*i],xyz[3*i+1],xyz[3*i+2]));
+   }
+
+   uint64_t nfaces = 0;
+   if(!read_value(in,nfaces)) return nullptr;
+   data.reserveFaces(static_cast<int>(nfaces),3);
+   std::vector<uint32_t> indices;
+   for(uint64_t iface=0; iface<nfaces; iface++) {
+      uint32_t nv = 0;
+      if(!read_value(in,nv) || nv < 3) return nullptr;
+      indices.resize(nv);
+      in.read(reinterpret_cast<char*>(&indices[0]),nv*sizeof(uint32_t));
+      if(in.fail()) return nullptr;
+      for(size_t i=0; i<nv; i++) {
+         if(indices[i] >= nvert) return nullptr;
+      }
+      data.addFace(indices.begin(),indices.end());
+   }
+
+   carve::input::Options options;
+   return MeshSet_ptr(data.createMesh(options));
+}
+
+// parse the binary form held in memory. vertex(x,y,z) is called per vertex after reserve(nvert,nfaces),
+// then face(indices,nv) per face. Returns false if the data does not contain a valid mesh
+template <typename Reserve, typename Vertex, typename Face>
+static bool parse(const char* data, size_t size, Reserve reserve, Vertex vertex, Face face)
+{
+   const char* p    = data;
+   const char* last = data + size;
+   auto take = [&p,last](void* value, size_t len) {
+      if(size_t(last-p) < len) return false;
+      std::memcpy(value,p,len);
+      p += len;
+      return true;
+   };
+
+   char magic[sizeof(mesh_binary_magic)];
+   if(!take(magic,sizeof(magic)) || std::memcmp(magic,mesh_binary_magic,sizeof(magic)) != 0) return false;
+
+   uint32_t version = 0;
+   if(!take(&version,sizeof(version)) || version != mesh_binary::format_version()) return false;
+
+   uint64_t nvert = 0;
+   if(!take(&nvert,sizeof(nvert)) || nvert > size_t(last-p)/(3*sizeof(double))) return false;
+   const char* xyz = p;
+   p += 3*sizeof(double)*nvert;
+
+   uint64_t nfaces = 0;
+   if(!take(&nfaces,sizeof(nfaces)) || nfaces > size_t(last-p)/(4*sizeof(uint32_t))) return false;
+   reserve(static_cast<size_t>(nvert),static_cast<size_t>(nfaces));
+   for(uint64_t i=0; i<nvert; i++) {
+      double v[3];
+      std::memcpy(v,xyz+i*sizeof(v),sizeof(v));
+      vertex(v[0],v[1],v[2]);
+   }
+
+   std::vector<uint32_t> indices;
+   for(uint64_t iface=0; iface<nfaces; iface++) {
+      uint32_t nv = 0;
+      if(!take(&nv,sizeof(nv)) || nv < 3 || nv > size_t(last-p)/sizeof(uint32_t)) return false;
+      indices.resize(nv);
+      take(&indices[0],nv*sizeof(uint32_t));
+      for(size_t i=0; i<nv; i++) {
+         if(indices[i] >= nvert) return false;
+      }
+      face(indices);
+   }
+   return p == last;
+}
+
+bool mesh_binary::read(const char* data, size_t size, std::vector<xvertex>& vertices, std::vector<xface>& faces)
+{
+   vertices.clear();
+   faces.clear();
+   std::vector<size_t> face;
+   return parse(data,size,
+               [&vertices,&faces](size_t nvert, size_t nfaces) { vertices.reserve(nvert); faces.reserve(nfaces); },
+               [&vertices](double x, double y, double z) { vertices.push_back(carve::geom::VECTOR(x,y,z)); },
+               [&faces,&face](const std::vector<uint32_t>& indices) {
+                  face.assign(indices.begin(),indices.end());
+                  faces.push_back(xface(face));
+               });
+}
+
+mesh_binary::MeshSet_ptr mesh_binary::read(const char* data, size_t size)
+{
+   carve::input::PolyhedronData poly;
+   bool ok = parse(data,size,
+                  [&poly](size_t nvert, size_t nfaces) { poly.reserveVertices(static_cast<int>(nvert)); poly.reserveFaces(static_cast<int>(nfaces),3); },
+                  [&poly](double x, double y, double z) { poly.addVertex(carve::geom::VECTOR(x,y,z)); },
+                  [&poly](const std::vector<uint32_t>& indices) { poly.addFace(indices.begin(),indices.end()); });
+   if(!ok) return nullptr;
+
+   carve::input::Options options;
+   return MeshSet_ptr(poly.createMesh(options));
+}
+
+bool mesh_binary::write_triangles(std::ostream& out, const triangle_mesh::mesh_vector& lumps)
+{
+   uint64_t nvert = 0, ntri = 0;
+   std::vector<uint64_t> table;
+   for(auto& lump : lumps) {
+      table.push_back(nvert);
+      table.push_back(ntri);
+      nvert += lump->nvertices();
+      ntri  += lump->ntriangles();
+   }
+   if(nvert > 0xFFFFFFFFu) return false;
+
+   out.write(triangles_magic,sizeof(triangles_magic));
+   write_value<uint32_t>(out,format_version());
+   write_value<uint32_t>(out,static_cast<uint32_t>(lumps.size()));
+   write_value<uint64_t>(out,nvert);
+   write_value<uint64_t>(out,ntri);
+   if(table.size() > 0) out.write(reinterpret_cast<const char*>(&table[0]),table.size()*sizeof(uint64_t));
+
+   // vertices and triangles are written in blocks, so the memory used is bounded
+   std::vector<double> xyz;
+   xyz.reserve(3*triangles_block);
+   for(auto& lump : lumps) {
+      for(size_t ivert=0; ivert<lump->nvertices(); ivert++) {
+         const xvertex& vertex = lump->vertex(ivert);
+         xyz.push_back(vertex.v[0]);
+         xyz.push_back(vertex.v[1]);
+         xyz.push_back(vertex.v[2]);
+         if(xyz.size() == 3*triangles_block) {
+            out.write(reinterpret_cast<const char*>(&xyz[0]),xyz.size()*sizeof(double));
+            xyz.clear();
+         }
+      }
+   }
+   if(xyz.size() > 0) out.write(reinterpret_cast<const char*>(&xyz[0]),xyz.size()*sizeof(double));
+
+   std::vector<uint32_t> indices;
+   indices.reserve(3*triangles_block);
+   for(size_t ilump=0; ilump<lumps.size(); ilump++) {
+      const triangle_mesh& lump = *lumps[ilump];
+      const size_t offset = static_cast<size_t>(table[2*ilump]);
+      for(size_t itri=0; itri<lump.ntriangles(); itri++) {
+         const size_t* tri = lump.triangle(itri);
+         for(size_t k=0; k<3; k++) indices.push_back(static_cast<uint32_t>(offset+tri[k]));
+         if(indices.size() == 3*triangles_block) {
+            out.write(reinterpret_cast<const char*>(&indices[0]),indices.size()*sizeof(uint32_t));
+            indices.clear();
+         }
+      }
+   }
+   if(indices.size() > 0) out.write(reinterpret_cast<const char*>(&indices[0]),indices.size()*sizeof(uint32_t));
+   return out.good();
+}
+
+bool mesh_binary::is_triangles(const char* data, size_t size)
+{
+   return size >= sizeof(triangles_magic) && std::memcmp(data,triangles_magic,sizeof(triangles_magic)) == 0;
+}
+
+bool mesh_binary::read_triangles(const char* data, size_t size, std::vector<xvertex>& vertices, std::vector<xface>& faces)
+{
+   if(size < triangles_header_size || !is_triangles(data,size)) return false;
+
+   uint32_t version = 0, nlump = 0;
+   uint64_t nvert = 0, ntri = 0;
+   std::memcpy(&version,data+8,sizeof(version));
+   std::memcpy(&nlump,data+12,sizeof(nlump));
+   std::memcpy(&nvert,data+16,sizeof(nvert));
+   std::memcpy(&ntri,data+24,sizeof(ntri));
+   if(version != format_version()) return false;
+
+   // the sizes must match exactly, after that no further bounds checks of the sections are needed
+   const size_t table_size = 2*sizeof(uint64_t)*size_t(nlump);
+   if(nvert > 0xFFFFFFFFu || ntri > size/(3*sizeof(uint32_t))) return false;
+   if(size != triangles_header_size + table_size + nvert*3*sizeof(double) + ntri*3*sizeof(uint32_t)) return false;
+
+   const char* pvert = data + triangles_header_size + table_size;
+   vertices.resize(static_cast<size_t>(nvert));
+   for(size_t i=0; i<vertices.size(); i++) {
+      double xyz[3];
+      std::memcpy(xyz,pvert + i*sizeof(xyz),sizeof(xyz));
+      vertices[i] = carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]);
+   }
+
+   const char* ptri = pvert + nvert*3*sizeof(double);
+   faces.clear();
+   faces.reserve(static_cast<size_t>(ntri));
+   std::vector<size_t> face(3);
+   for(size_t itri=0; itri<ntri; itri++) {
+      uint32_t tri[3];
+      std::memcpy(tri,ptri + itri*sizeof(tri),sizeof(tri));
+      for(size_t k=0; k<3; k++) {
+         if(tri[k] >= nvert) return false;
+         face[k] = tri[k];
+      }
+      faces.push_back(xface(face));
+   }
+   return true;
+}
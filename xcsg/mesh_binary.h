@@ -0,0 +1,71 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_BINARY_H
+#define MESH_BINARY_H
+
+#include <memory>
+#include <iostream>
+#include <vector>
+#include <carve/mesh.hpp>
+#include "xshape.h"
+#include "xface.h"
+#include "triangle_mesh.h"
+
+// mesh_binary reads and writes carve mesh sets in a compact binary form
+//    header  : "XCSGMESH", uint32 format version
+//    vertices: uint64 count, then x,y,z as doubles
+//    faces   : uint64 count, then per face uint32 nvert followed by uint32 vertex indices
+// Values are stored in native (little endian on all supported platforms) byte order.
+//
+// The triangle form holds exported lumps, as written by --xmesh. All sections are at fixed
+// offsets and the vertices are 8 byte aligned, so a mapped file is used in place
+//    header   : "XCSGTRIS", uint32 format version, uint32 lump count,
+//               uint64 vertex count, uint64 triangle count
+//    lumps    : per lump uint64 first vertex, uint64 first triangle
+//    vertices : x,y,z as doubles, the vertices of all lumps back to back
+//    triangles: 3 uint32 indices into the vertices per triangle
+
+class mesh_binary {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   // write mesh to stream, returns false on stream error
+   static bool write(std::ostream& out, MeshSet_ptr mesh);
+
+   // read mesh from stream, returns nullptr if the stream does not contain a valid mesh
+   static MeshSet_ptr read(std::istream& in);
+
+   // read vertices and faces from the binary form held in memory, e.g. a mapped file.
+   // Returns false if the data does not contain a valid mesh
+   static bool read(const char* data, size_t size, std::vector<xvertex>& vertices, std::vector<xface>& faces);
+
+   // read mesh from the binary form held in memory, returns nullptr if the data does not contain a valid mesh
+   static MeshSet_ptr read(const char* data, size_t size);
+
+   // write lumps in the triangle form, returns false on stream error or more than 2^32 vertices
+   static bool write_triangles(std::ostream& out, const triangle_mesh::mesh_vector& lumps);
+
+   // true if data starts as the triangle form
+   static bool is_triangles(const char* data, size_t size);
+
+   // read the triangles of all lumps held in memory as one vertex and face set.
+   // Returns false if the data does not contain a valid triangle form
+   static bool read_triangles(const char* data, size_t size, std::vector<xvertex>& vertices, std::vector<xface>& faces);
+
+   static uint32_t format_version() { return 1; }
+};
+
+#endif // MESH_BINARY_H
@@ -0,0 +1,144 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_cache.h"
+#include "csg_parser/cf_xmlNode.h"
+#include <set>
+#include <vector>
+
+// elements whose mesh depends on the secant tolerance. Instances are included,
+// the definitions they refer to are not part of the subtree
+static bool tolerance_tag(const std::string& tag)
+{
+   static const std::set<std::string> tags = { "circle", "cone", "cylinder", "sphere", "rotate_extrude",
+                                               "transform_extrude", "sweep", "instance" };
+   return tags.find(tag) != tags.end();
+}
+
+mesh_cache::mesh_cache()
+: m_enabled(true)
+, m_hits(0)
+{}
+
+mesh_cache::~mesh_cache()
+{}
+
+void mesh_cache::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_count.clear();
+   m_objects.clear();
+   m_meshes.clear();
+   m_levels.clear();
+   m_hits = 0;
+}
+
+void mesh_cache::count_subtrees(const cf_xmlNode& root)
+{
+   if(!m_enabled) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_count[xml_hash::local_hash(root)]++;
+   for(auto i=root.begin(); i!=root.end(); i++) {
+      if(i->first != "<xmlattr>") count_subtrees(i->first,i->second);
+   }
+}
+
+void mesh_cache::count_subtrees(const std::string& tag, const xml_hash::ptree& pt)
+{
+   m_count[xml_hash::local_hash(tag,pt)]++;
+   for(auto i=pt.begin(); i!=pt.end(); i++) {
+      if(i->first != "<xmlattr>") count_subtrees(i->first,i->second);
+   }
+}
+
+void mesh_cache::share_levels(const cf_xmlNode& root)
+{
+   if(!m_enabled) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   bool free = !tolerance_tag(root.tag());
+   std::vector<cf_xmlNode::const_iterator> free_children;
+   for(auto i=root.begin(); i!=root.end(); i++) {
+      if(i->first == "<xmlattr>") continue;
+      if(share_levels(i->first,i->second)) free_children.push_back(i);
+      else                                 free = false;
+   }
+   if(free) m_levels.insert(xml_hash::local_hash(root));
+   else {
+      for(auto i : free_children) m_levels.insert(xml_hash::local_hash(i->first,i->second));
+   }
+}
+
+bool mesh_cache::share_levels(const std::string& tag, const xml_hash::ptree& pt)
+{
+   // the children are shared only when this subtree is not
+   bool free = !tolerance_tag(tag);
+   std::vector<xml_hash::ptree::const_iterator> free_children;
+   for(auto i=pt.begin(); i!=pt.end(); i++) {
+      if(i->first == "<xmlattr>") continue;
+      if(share_levels(i->first,i->second)) free_children.push_back(i);
+      else                                 free = false;
+   }
+   if(!free) {
+      for(auto i : free_children) m_levels.insert(xml_hash::local_hash(i->first,i->second));
+   }
+   return free;
+}
+
+bool mesh_cache::level_shared(uint64_t key) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_levels.find(key) != m_levels.end();
+}
+
+size_t mesh_cache::occurrences(uint64_t key) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto i = m_count.find(key);
+   return (i != m_count.end())? i->second : 0;
+}
+
+bool mesh_cache::register_object(uint64_t key)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return (++m_objects[key] == 1);
+}
+
+bool mesh_cache::get(uint64_t key, MeshSet_ptr& mesh)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto i = m_meshes.find(key);
+   if(i == m_meshes.end()) return false;
+   mesh = i->second;
+   m_hits++;
+   return true;
+}
+
+void mesh_cache::put(uint64_t key, MeshSet_ptr mesh)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_meshes.insert(std::make_pair(key,mesh));
+}
+
+size_t mesh_cache::repeated() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   size_t nrep = 0;
+   for(auto& i : m_objects) {
+      if(i.second > 1) nrep++;
+   }
+   return nrep;
+}
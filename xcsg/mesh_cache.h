@@ -0,0 +1,92 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <carve/mesh.hpp>
+#include "xml_hash.h"
+class cf_xmlNode;
+
+// mesh_cache holds meshes of repeated CSG subtrees in local coordinates,
+// keyed on xml_hash::local_hash of the subtree. Before the CSG tree is built,
+// count_subtrees() finds the subtrees that occur more than once. Only those
+// are cached, each is computed once and then reused via a transformed clone.
+// With several levels of detail (--lod), the CSG tree is built once per secant tolerance.
+// share_levels() finds the largest subtrees without curved shapes, their meshes do not
+// depend on the tolerance and are shared between the levels.
+
+class mesh_cache {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static mesh_cache& singleton()  { static mesh_cache instance; return instance;  }
+
+   bool enabled() const { return m_enabled; }
+   void set_enabled(bool enabled) { m_enabled = enabled; }
+
+   // remove all counts and cached meshes
+   void clear();
+
+   // count occurrences of all subtrees under (and including) root
+   void count_subtrees(const cf_xmlNode& root);
+
+   // number of occurrences of subtree with given key
+   size_t occurrences(uint64_t key) const;
+
+   // find the subtrees under (and including) root shared between levels of detail
+   void share_levels(const cf_xmlNode& root);
+
+   // true when the subtree with given key has the same mesh in every level of detail
+   bool level_shared(uint64_t key) const;
+
+   // register a created object for the key, returns true for the first object
+   bool register_object(uint64_t key);
+
+   // return cached mesh for the key, if any
+   bool get(uint64_t key, MeshSet_ptr& mesh);
+
+   // store mesh for the key. If another thread stored one first, that one is kept
+   void put(uint64_t key, MeshSet_ptr mesh);
+
+   // number of repeated subtrees and number of times a cached mesh was reused
+   size_t repeated() const;
+   size_t hits() const { return m_hits; }
+
+protected:
+   mesh_cache();
+   virtual ~mesh_cache();
+
+   void count_subtrees(const std::string& tag, const xml_hash::ptree& pt);
+
+   // returns true when the subtree is tolerance independent, the caller then decides whether to share it
+   bool share_levels(const std::string& tag, const xml_hash::ptree& pt);
+
+private:
+   bool                                     m_enabled;
+   std::unordered_map<uint64_t,size_t>      m_count;     // occurrences per subtree
+   std::unordered_map<uint64_t,size_t>      m_objects;   // created objects per subtree
+   std::unordered_map<uint64_t,MeshSet_ptr> m_meshes;    // cached meshes
+   std::unordered_set<uint64_t>             m_levels;    // subtrees shared between levels of detail
+   std::atomic<size_t>                      m_hits;
+   mutable std::mutex                       m_mutex;
+};
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,312 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_decimator.h"
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cmath>
+#include <limits>
+
+// largest turn of a triangle normal accepted by a collapse, as cosine
+static const double min_normal_cos = 0.2;
+
+mesh_decimator::quadric::quadric()
+{
+   std::fill(m,m+10,0.0);
+}
+
+void mesh_decimator::quadric::add_plane(const xvertex& n, double d)
+{
+   const double a=n[0], b=n[1], c=n[2];
+   m[0] += a*a; m[1] += a*b; m[2] += a*c; m[3] += a*d;
+                m[4] += b*b; m[5] += b*c; m[6] += b*d;
+                             m[7] += c*c; m[8] += c*d;
+                                          m[9] += d*d;
+}
+
+mesh_decimator::quadric& mesh_decimator::quadric::operator+=(const quadric& q)
+{
+   for(size_t i=0; i<10; i++) m[i] += q.m[i];
+   return *this;
+}
+
+double mesh_decimator::quadric::error(const xvertex& p) const
+{
+   const double x=p[0], y=p[1], z=p[2];
+   double e =   m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x
+              + m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y
+              + m[7]*z*z + 2*m[8]*z
+              + m[9];
+   return std::max(0.0,e);
+}
+
+bool mesh_decimator::quadric::optimum(xvertex& p) const
+{
+   // solve A*p = -b by Cramer's rule, A is the upper left 3x3
+   const double a00=m[0], a01=m[1], a02=m[2];
+   const double a11=m[4], a12=m[5], a22=m[7];
+   const double b0=-m[3], b1=-m[6], b2=-m[8];
+
+   const double c00 = a11*a22 - a12*a12;
+   const double c01 = a02*a12 - a01*a22;
+   const double c02 = a01*a12 - a02*a11;
+   const double det = a00*c00 + a01*c01 + a02*c02;
+
+   // flat or cylindrical neighbourhoods give a (nearly) singular matrix
+   const double trace = a00 + a11 + a22;
+   if(!(std::fabs(det) > 1.0E-9*trace*trace*trace)) return false;
+
+   const double c11 = a00*a22 - a02*a02;
+   const double c12 = a01*a02 - a00*a12;
+   const double c22 = a00*a11 - a01*a01;
+   p = carve::geom::VECTOR( (c00*b0 + c01*b1 + c02*b2)/det,
+                            (c01*b0 + c11*b1 + c12*b2)/det,
+                            (c02*b0 + c12*b1 + c22*b2)/det );
+   return true;
+}
+
+mesh_decimator::mesh_decimator(std::vector<xvertex>& vertices, std::vector<size_t>& triangles)
+: m_vertices(vertices)
+, m_triangles(triangles)
+{}
+
+mesh_decimator::~mesh_decimator()
+{}
+
+mesh_decimator::candidate mesh_decimator::evaluate(size_t v0, size_t v1, xvertex& p) const
+{
+   quadric q = m_quadrics[v0];
+   q += m_quadrics[v1];
+
+   candidate c;
+   c.v0 = v0;
+   c.v1 = v1;
+   c.s0 = m_version[v0];
+   c.s1 = m_version[v1];
+   if(q.optimum(p)) {
+      c.cost = q.error(p);
+   }
+   else {
+      // best of the end points and the mid point
+      const xvertex& p0 = m_vertices[v0];
+      const xvertex& p1 = m_vertices[v1];
+      xvertex pm = 0.5*(p0+p1);
+      double e0 = q.error(p0);
+      double e1 = q.error(p1);
+      double em = q.error(pm);
+      if(em <= e0 && em <= e1) { p = pm; c.cost = em; }
+      else if(e0 <= e1)        { p = p0; c.cost = e0; }
+      else                     { p = p1; c.cost = e1; }
+   }
+   return c;
+}
+
+void mesh_decimator::neighbours(size_t v, std::vector<size_t>& nb) const
+{
+   nb.clear();
+   for(size_t itri : m_vtris[v]) {
+      const size_t* tri = &m_triangles[3*itri];
+      for(size_t k=0; k<3; k++) if(tri[k] != v) nb.push_back(tri[k]);
+   }
+   std::sort(nb.begin(),nb.end());
+   nb.erase(std::unique(nb.begin(),nb.end()),nb.end());
+}
+
+xvertex mesh_decimator::normal(size_t itri, size_t u, size_t v, const xvertex& p) const
+{
+   const size_t* tri = &m_triangles[3*itri];
+   xvertex pos[3];
+   for(size_t k=0; k<3; k++) pos[k] = (tri[k]==u || tri[k]==v)? p : m_vertices[tri[k]];
+   return carve::geom::cross(pos[1]-pos[0],pos[2]-pos[0]);
+}
+
+void mesh_decimator::remove_triangle(size_t v, size_t itri)
+{
+   std::vector<size_t>& tris = m_vtris[v];
+   tris.erase(std::find(tris.begin(),tris.end(),itri));
+}
+
+bool mesh_decimator::collapse(size_t u, size_t v, const xvertex& p)
+{
+   // the edge must be used by exactly 2 triangles, the vertices opposite the edge
+   size_t shared[2];
+   size_t opposite[2];
+   size_t nshared = 0;
+   for(size_t itri : m_vtris[v]) {
+      const size_t* tri = &m_triangles[3*itri];
+      if(tri[0]==u || tri[1]==u || tri[2]==u) {
+         if(nshared == 2) return false;
+         shared[nshared] = itri;
+         for(size_t k=0; k<3; k++) if(tri[k]!=u && tri[k]!=v) opposite[nshared] = tri[k];
+         nshared++;
+      }
+   }
+   if(nshared != 2) return false;
+
+   // an opposite vertex with 3 triangles would be left with 2 on top of each other
+   if(m_vtris[opposite[0]].size() <= 3 || m_vtris[opposite[1]].size() <= 3) return false;
+
+   // link condition: u and v may have no common neighbours other than the opposite vertices
+   neighbours(u,m_nb_u);
+   neighbours(v,m_nb_v);
+   size_t ncommon = 0;
+   for(size_t i=0,j=0; i<m_nb_u.size() && j<m_nb_v.size(); ) {
+      if(m_nb_u[i] < m_nb_v[j])      i++;
+      else if(m_nb_v[j] < m_nb_u[i]) j++;
+      else { ncommon++; i++; j++; }
+   }
+   if(ncommon != 2) return false;
+
+   // the remaining triangles around u and v must not fold over or degenerate
+   const size_t ends[2] = { u, v };
+   for(size_t iend=0; iend<2; iend++) {
+      for(size_t itri : m_vtris[ends[iend]]) {
+         if(itri==shared[0] || itri==shared[1]) continue;
+         xvertex n0 = normal(itri,u,v,m_vertices[ends[iend]]);
+         xvertex n1 = normal(itri,u,v,p);
+         double len = std::sqrt(carve::geom::dot(n0,n0)*carve::geom::dot(n1,n1));
+         if(!(carve::geom::dot(n0,n1) > min_normal_cos*len)) return false;
+      }
+   }
+
+   // remove the 2 triangles of the edge and move the others of v over to u
+   for(size_t i=0; i<2; i++) {
+      m_tri_alive[shared[i]] = 0;
+      remove_triangle(u,shared[i]);
+      remove_triangle(opposite[i],shared[i]);
+   }
+   for(size_t itri : m_vtris[v]) {
+      if(!m_tri_alive[itri]) continue;
+      size_t* tri = &m_triangles[3*itri];
+      for(size_t k=0; k<3; k++) if(tri[k] == v) tri[k] = u;
+      m_vtris[u].push_back(itri);
+   }
+   std::vector<size_t>().swap(m_vtris[v]);
+   m_vert_alive[v] = 0;
+
+   m_vertices[u] = p;
+   m_quadrics[u] += m_quadrics[v];
+   m_version[u]++;
+   return true;
+}
+
+size_t mesh_decimator::decimate(size_t max_triangles, double max_error)
+{
+   const size_t nvert = m_vertices.size();
+   const size_t ntri  = m_triangles.size()/3;
+   if(max_triangles == 0 && max_error <= 0.0) return 0;
+   if(max_triangles > 0 && ntri <= max_triangles) return 0;
+   const double max_cost = max_error*max_error;
+
+   m_quadrics.assign(nvert,quadric());
+   m_vtris.assign(nvert,std::vector<size_t>());
+   m_version.assign(nvert,0);
+   m_locked.assign(nvert,0);
+   m_tri_alive.assign(ntri,1);
+   m_vert_alive.assign(nvert,1);
+
+   // triangle planes are summed per vertex. The edges are sorted with the
+   // vertex pair as key, an edge not used by exactly 2 triangles locks its vertices
+   std::vector<std::pair<size_t,size_t>> edges;
+   edges.reserve(3*ntri);
+   for(size_t itri=0; itri<ntri; itri++) {
+      const size_t* tri = &m_triangles[3*itri];
+      xvertex n = carve::geom::cross(m_vertices[tri[1]]-m_vertices[tri[0]],m_vertices[tri[2]]-m_vertices[tri[0]]);
+      double len = std::sqrt(carve::geom::dot(n,n));
+      if(len > 0.0) {
+         n = n/len;
+         quadric q;
+         q.add_plane(n,-carve::geom::dot(n,m_vertices[tri[0]]));
+         for(size_t k=0; k<3; k++) m_quadrics[tri[k]] += q;
+      }
+      for(size_t k=0; k<3; k++) {
+         m_vtris[tri[k]].push_back(itri);
+         size_t a = tri[k], b = tri[(k+1)%3];
+         edges.push_back(std::make_pair(std::min(a,b),std::max(a,b)));
+      }
+   }
+   std::sort(edges.begin(),edges.end());
+
+   std::vector<candidate> heap;
+   xvertex p;
+   for(size_t i=0; i<edges.size(); ) {
+      size_t j=i+1;
+      while(j<edges.size() && edges[j]==edges[i]) j++;
+      if(j-i != 2) m_locked[edges[i].first] = m_locked[edges[i].second] = 1;
+      i = j;
+   }
+   for(size_t i=0; i<edges.size(); i++) {
+      if(i>0 && edges[i]==edges[i-1]) continue;
+      if(m_locked[edges[i].first] || m_locked[edges[i].second]) continue;
+      heap.push_back(evaluate(edges[i].first,edges[i].second,p));
+   }
+   std::vector<std::pair<size_t,size_t>>().swap(edges);
+
+   std::priority_queue<candidate,std::vector<candidate>,std::greater<candidate>> queue(std::greater<candidate>(),std::move(heap));
+   size_t nalive = ntri;
+   std::vector<size_t> nb;
+   while(!queue.empty() && (max_triangles==0 || nalive>max_triangles)) {
+      candidate c = queue.top();
+      queue.pop();
+
+      // skip candidates computed before one of the vertices moved or was removed
+      if(!m_vert_alive[c.v0] || !m_vert_alive[c.v1]) continue;
+      if(c.s0 != m_version[c.v0] || c.s1 != m_version[c.v1]) continue;
+
+      // the queue is ordered by cost, so no later collapse is within the error either
+      if(max_cost > 0.0 && c.cost > max_cost) break;
+
+      evaluate(c.v0,c.v1,p);
+      if(!collapse(c.v0,c.v1,p)) continue;
+      nalive -= 2;
+
+      // the edges of the moved vertex get new costs
+      neighbours(c.v0,nb);
+      for(size_t w : nb) {
+         if(!m_locked[w]) queue.push(evaluate(c.v0,w,p));
+      }
+   }
+
+   // compact the surviving vertices and triangles, keeping their order
+   const size_t unused = std::numeric_limits<size_t>::max();
+   std::vector<size_t> index(nvert,unused);
+   size_t nv = 0;
+   for(size_t iv=0; iv<nvert; iv++) {
+      if(m_vert_alive[iv] && m_vtris[iv].size() > 0) {
+         index[iv] = nv;
+         m_vertices[nv++] = m_vertices[iv];
+      }
+   }
+   m_vertices.resize(nv);
+   size_t nt = 0;
+   for(size_t itri=0; itri<ntri; itri++) {
+      if(!m_tri_alive[itri]) continue;
+      for(size_t k=0; k<3; k++) m_triangles[3*nt+k] = index[m_triangles[3*itri+k]];
+      nt++;
+   }
+   m_triangles.resize(3*nt);
+
+   // release the work arrays
+   std::vector<quadric>().swap(m_quadrics);
+   std::vector<std::vector<size_t>>().swap(m_vtris);
+   std::vector<unsigned>().swap(m_version);
+   std::vector<char>().swap(m_locked);
+   std::vector<char>().swap(m_tri_alive);
+   std::vector<char>().swap(m_vert_alive);
+
+   return ntri - nt;
+}
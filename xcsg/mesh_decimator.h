@@ -0,0 +1,88 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_DECIMATOR_H
+#define MESH_DECIMATOR_H
+
+#include <vector>
+#include <cstddef>
+#include "xshape.h"
+
+// mesh_decimator reduces the triangle count of an indexed triangle mesh by quadric error
+// edge collapse (Garland & Heckbert). The cheapest edge is collapsed first, into the point
+// minimising the squared distances to the planes of the triangles around its vertices.
+// Collapses that would break the link condition or fold a triangle over are rejected, and
+// vertices on open or non-manifold edges never move, so a closed manifold stays manifold.
+
+class mesh_decimator {
+public:
+   // the vertices and triangles (3 indices each) are modified in place by decimate()
+   mesh_decimator(std::vector<xvertex>& vertices, std::vector<size_t>& triangles);
+   virtual ~mesh_decimator();
+
+   // collapse edges until at most max_triangles remain (0 means no limit), or until the next
+   // collapse would move the surface more than max_error (0 means no limit).
+   // Unused vertices are removed. Returns the number of triangles removed
+   size_t decimate(size_t max_triangles, double max_error);
+
+private:
+   // symmetric 4x4 error matrix, upper triangle stored row by row
+   struct quadric {
+      quadric();
+      void add_plane(const xvertex& n, double d);
+      quadric& operator+=(const quadric& q);
+      double error(const xvertex& p) const;
+
+      // position of minimum error, false if the quadric is singular
+      bool optimum(xvertex& p) const;
+
+      double m[10];
+   };
+
+   // queue entry, the target point is recomputed when the candidate is used
+   struct candidate {
+      bool operator>(const candidate& c) const { return cost > c.cost; }
+      double   cost;
+      size_t   v0,v1;
+      unsigned s0,s1;    // vertex versions when the candidate was computed
+   };
+
+   // cost and target point p of collapsing v0 and v1
+   candidate evaluate(size_t v0, size_t v1, xvertex& p) const;
+
+   // sorted vertices sharing a triangle with v
+   void neighbours(size_t v, std::vector<size_t>& nb) const;
+
+   // collapse v into u at position p, returns false if rejected
+   bool collapse(size_t u, size_t v, const xvertex& p);
+
+   void remove_triangle(size_t v, size_t itri);
+
+   // normal of triangle itri with vertices u and v moved to p, not normalised
+   xvertex normal(size_t itri, size_t u, size_t v, const xvertex& p) const;
+
+private:
+   std::vector<xvertex>&            m_vertices;
+   std::vector<size_t>&             m_triangles;
+   std::vector<quadric>             m_quadrics;
+   std::vector<std::vector<size_t>> m_vtris;     // triangles using each vertex
+   std::vector<unsigned>            m_version;   // incremented when a vertex moves
+   std::vector<char>                m_locked;    // vertex of open or non-manifold edge
+   std::vector<char>                m_tri_alive;
+   std::vector<char>                m_vert_alive;
+   std::vector<size_t>              m_nb_u,m_nb_v;
+};
+
+#endif // MESH_DECIMATOR_H
@@ -0,0 +1,176 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_file_cache.h"
+#include "mesh_binary.h"
+#include "mesh_utils.h"
+#include "carve_boolean.h"
+#include "boolean_engine.h"
+#include "sdf_field.h"
+#include "xml_hash.h"
+#include "std_filename.h"
+#include "version.h"
+#include "clipper_csg/clipper_csg_config.h"
+
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+mesh_file_cache::mesh_file_cache()
+: m_loaded(0)
+, m_saved(0)
+, m_retained_hits(0)
+, m_retain(false)
+{}
+
+mesh_file_cache::~mesh_file_cache()
+{}
+
+void mesh_file_cache::set_directory(const std::string& dir)
+{
+   if(dir.length() > 0 && !std_filename::Exists(dir)) {
+      std_filename::create_directories(dir);
+   }
+   m_dir = dir;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_loaded = 0;
+   m_saved  = 0;
+   m_retained_hits = 0;
+   m_used.clear();
+}
+
+void mesh_file_cache::set_retain(bool retain)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_retain = retain;
+   if(!retain) m_retained.clear();
+}
+
+void mesh_file_cache::release_unused()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   for(auto i=m_retained.begin(); i!=m_retained.end(); ) {
+      if(m_used.find(i->first) == m_used.end()) i = m_retained.erase(i);
+      else i++;
+   }
+}
+
+std::string mesh_file_cache::file_path(uint64_t subtree_key) const
+{
+   std::ostringstream tol;
+   tol.precision(17);
+   tol << mesh_utils::secant_tolerance() << ' ' << TO_CLIPPER << ' ' << mesh_utils::preview() << ' ' << carve_boolean::simplify() << ' ' << carve_boolean::welding() << ' ' << carve_boolean::snap();
+
+   // meshes of different boolean engines differ, the sdf engine also by its voxel size
+   const boolean_engine& engine = boolean_engine::current();
+   tol << ' ' << engine.name();
+   if(engine.name() == "sdf") tol << ' ' << sdf_field::default_voxel();
+
+   uint64_t key = xml_hash::combine(subtree_key,xml_hash::hash(tol.str()));
+   key = xml_hash::combine(key,xml_hash::hash(XCSG_version));
+
+   boost::filesystem::path path(m_dir);
+   path /= xml_hash::to_string(key) + ".xmesh";
+   return path.string();
+}
+
+bool mesh_file_cache::load(uint64_t subtree_key, MeshSet_ptr& mesh)
+{
+   if(!enabled()) return false;
+
+   std::string path = file_path(subtree_key);
+   std::string name = boost::filesystem::path(path).filename().string();
+   if(m_retain) {
+      // the cached mesh is shared, it is only read through transformed views
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto i = m_retained.find(name);
+      if(i != m_retained.end()) {
+         mesh = i->second;
+         m_retained_hits++;
+         return true;
+      }
+   }
+
+   std::ifstream in(path,std::ios::binary);
+   if(!in.is_open()) return false;
+
+   mesh = mesh_binary::read(in);
+   if(!mesh.get()) return false;
+
+   m_loaded++;
+   retain(name,mesh);
+   return true;
+}
+
+void mesh_file_cache::save(uint64_t subtree_key, MeshSet_ptr mesh)
+{
+   if(!enabled()) return;
+
+   // write to a temporary file and rename it, so other processes never see a partial file
+   std::string path = file_path(subtree_key);
+   retain(boost::filesystem::path(path).filename().string(),mesh);
+   std::string tmp = path + "." + boost::filesystem::unique_path().string() + ".tmp";
+   boost::system::error_code ec;
+   {
+      std::ofstream out(tmp,std::ios::binary);
+      bool ok = out.is_open() && mesh_binary::write(out,mesh);
+      if(ok) {
+         out.close();
+         ok = !out.fail();
+      }
+      if(!ok) {
+         out.close();
+         boost::filesystem::remove(tmp,ec);
+         return;
+      }
+   }
+
+   boost::filesystem::rename(tmp,path,ec);
+   if(ec) boost::filesystem::remove(tmp,ec);
+   else   m_saved++;
+}
+
+void mesh_file_cache::retain(const std::string& name, MeshSet_ptr mesh)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_retain) m_retained[name] = mesh;
+}
+
+void mesh_file_cache::keep(uint64_t subtree_key)
+{
+   if(!enabled()) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_used.insert(boost::filesystem::path(file_path(subtree_key)).filename().string());
+}
+
+size_t mesh_file_cache::prune()
+{
+   if(!enabled()) return 0;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   size_t nremoved = 0;
+   boost::system::error_code ec;
+   for(boost::filesystem::directory_iterator i(m_dir,ec),iend; i!=iend; i.increment(ec)) {
+      if(ec) break;
+      const boost::filesystem::path& p = i->path();
+      if(p.extension() == ".xmesh" && m_used.find(p.filename().string()) == m_used.end()) {
+         boost::system::error_code ecr;
+         if(boost::filesystem::remove(p,ecr)) nremoved++;
+      }
+   }
+   return nremoved;
+}
@@ -0,0 +1,88 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_FILE_CACHE_H
+#define MESH_FILE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <map>
+#include <carve/mesh.hpp>
+
+// mesh_file_cache stores meshes of evaluated CSG subtrees in a directory, so later runs
+// can load unchanged subtrees instead of recomputing them. Files are named from the
+// subtree hash combined with the secant tolerance and the xcsg version, and use the
+// mesh_binary format.
+
+class mesh_file_cache {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static mesh_file_cache& singleton()  { static mesh_file_cache instance; return instance;  }
+
+   // enable the cache by giving a directory, created if it does not exist.
+   // An empty string disables it. Counters are reset
+   void set_directory(const std::string& dir);
+   bool enabled() const { return m_dir.length() > 0; }
+
+   // load mesh of subtree, returns false if not cached
+   bool load(uint64_t subtree_key, MeshSet_ptr& mesh);
+
+   // save mesh of subtree
+   void save(uint64_t subtree_key, MeshSet_ptr mesh);
+
+   size_t loaded() const { return m_loaded; }
+   size_t saved() const  { return m_saved; }
+
+   // mark subtree as part of the current model, also when an ancestor is loaded instead
+   void keep(uint64_t subtree_key);
+
+   // remove cache files of subtrees not kept in this run, returns number of files removed.
+   // Only for a directory private to one model, as in incremental mode
+   size_t prune();
+
+   // also keep loaded and saved meshes in memory, so a rerun in the same process (--watch)
+   // takes unchanged subtrees without reading their files
+   void set_retain(bool retain);
+   size_t retained_hits() const { return m_retained_hits; }
+
+   // drop meshes kept in memory for subtrees not kept in this run
+   void release_unused();
+
+protected:
+   mesh_file_cache();
+   virtual ~mesh_file_cache();
+
+   // full path of cache file for given subtree
+   std::string file_path(uint64_t subtree_key) const;
+
+   // keep mesh in memory under its cache file name, when retaining
+   void retain(const std::string& name, MeshSet_ptr mesh);
+
+private:
+   std::string          m_dir;
+   std::atomic<size_t>  m_loaded;
+   std::atomic<size_t>  m_saved;
+   std::atomic<size_t>  m_retained_hits;
+   bool                 m_retain;
+   std::map<std::string,MeshSet_ptr> m_retained;   // meshes in memory, by cache file name
+   std::set<std::string> m_used;   // cache files of the current model
+   std::mutex            m_mutex;
+};
+
+#endif // MESH_FILE_CACHE_H
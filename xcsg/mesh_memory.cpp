@@ -0,0 +1,212 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_memory.h"
+#include <iomanip>
+#include <algorithm>
+
+mesh_memory::scope::scope(stage s)
+: m_stage(s)
+, m_nmesh(0)
+, m_bytes(0)
+, m_busy(0)
+{}
+
+mesh_memory::scope::~scope()
+{
+   // the remaining meshes are handed on to the next stage
+   if(m_nmesh > 0) mesh_memory::singleton().update(*this,m_nmesh,m_bytes,false);
+}
+
+void mesh_memory::scope::add(const MeshSet* mesh)
+{
+   if(mesh) mesh_memory::singleton().update(*this,1,estimate(mesh),true);
+}
+
+void mesh_memory::scope::remove(const MeshSet* mesh)
+{
+   if(mesh) mesh_memory::singleton().update(*this,1,estimate(mesh),false);
+}
+
+bool mesh_memory::scope::throttle()
+{
+   mesh_memory& memory = mesh_memory::singleton();
+   std::unique_lock<std::mutex> lock(memory.m_mutex);
+   if(memory.m_budget == 0) return false;
+
+   bool waited = false;
+   while(m_busy > 0 && memory.m_bytes > memory.m_budget) {
+      if(!waited) memory.m_throttled++;
+      waited = true;
+      memory.m_cond.wait(lock);
+   }
+   return waited;
+}
+
+mesh_memory::busy::busy(scope& s)
+: m_scope(s)
+{
+   std::lock_guard<std::mutex> lock(mesh_memory::singleton().m_mutex);
+   m_scope.m_busy++;
+}
+
+mesh_memory::busy::~busy()
+{
+   mesh_memory& memory = mesh_memory::singleton();
+   {
+      std::lock_guard<std::mutex> lock(memory.m_mutex);
+      m_scope.m_busy--;
+   }
+   memory.m_cond.notify_all();
+}
+
+mesh_memory::mesh_memory()
+: m_budget(0)
+, m_bytes(0)
+, m_throttled(0)
+{}
+
+mesh_memory::~mesh_memory()
+{}
+
+size_t mesh_memory::estimate(const MeshSet* mesh)
+{
+   typedef carve::mesh::Vertex<3> vertex_t;
+   typedef carve::mesh::Edge<3>   edge_t;
+   typedef carve::mesh::Face<3>   face_t;
+   typedef carve::mesh::Mesh<3>   mesh_t;
+
+   size_t nface = 0;
+   size_t nedge = 0;
+   for(size_t i=0; i<mesh->meshes.size(); i++) {
+      const mesh_t* m = mesh->meshes[i];
+      nface += m->faces.size();
+      for(size_t j=0; j<m->faces.size(); j++) nedge += m->faces[j]->n_edges;
+   }
+   return sizeof(MeshSet)
+        + mesh->vertex_storage.capacity()*sizeof(vertex_t)
+        + mesh->meshes.size()*sizeof(mesh_t)
+        + nface*(sizeof(face_t) + sizeof(face_t*))
+        + nedge*sizeof(edge_t);
+}
+
+size_t mesh_memory::estimate(size_t nface)
+{
+   typedef carve::mesh::Vertex<3> vertex_t;
+   typedef carve::mesh::Edge<3>   edge_t;
+   typedef carve::mesh::Face<3>   face_t;
+   typedef carve::mesh::Mesh<3>   mesh_t;
+
+   // a closed triangle mesh has about half as many vertices as faces, and 3 half edges per face
+   return sizeof(MeshSet) + sizeof(mesh_t)
+        + (nface/2+2)*sizeof(vertex_t)
+        + nface*(sizeof(face_t) + sizeof(face_t*))
+        + 3*nface*sizeof(edge_t);
+}
+
+size_t mesh_memory::budget() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_budget;
+}
+
+void mesh_memory::set_budget(size_t bytes)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_budget = bytes;
+   }
+   m_cond.notify_all();
+}
+
+void mesh_memory::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   for(size_t i=0; i<NSTAGE; i++) {
+      usage& u = m_usage[i];
+      u.peak_nmesh = u.nmesh;
+      u.peak_bytes = u.bytes;
+   }
+   m_throttled = 0;
+}
+
+mesh_memory::usage mesh_memory::get_usage(stage s) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_usage[s];
+}
+
+size_t mesh_memory::bytes() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_bytes;
+}
+
+void mesh_memory::update(scope& s, size_t nmesh, size_t bytes, bool added)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      usage& u = m_usage[s.m_stage];
+      if(added) {
+         s.m_nmesh += nmesh;
+         s.m_bytes += bytes;
+         u.nmesh   += nmesh;
+         u.bytes   += bytes;
+         m_bytes   += bytes;
+         u.peak_nmesh = std::max(u.peak_nmesh,u.nmesh);
+         u.peak_bytes = std::max(u.peak_bytes,u.bytes);
+         return;
+      }
+
+      // the estimate of a removed mesh may differ if it changed while queued
+      nmesh = std::min(nmesh,s.m_nmesh);
+      bytes = std::min(bytes,s.m_bytes);
+      s.m_nmesh -= nmesh;
+      s.m_bytes -= bytes;
+      u.nmesh   -= nmesh;
+      u.bytes   -= bytes;
+      m_bytes   -= bytes;
+   }
+   m_cond.notify_all();
+}
+
+const char* mesh_memory::stage_name(stage s)
+{
+   switch(s) {
+      case MESH:      return "mesh";
+      case BOOLEAN:   return "boolean";
+      case MINKOWSKI: return "minkowski";
+      default:        return "unknown";
+   }
+}
+
+void mesh_memory::write_report(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   const double mb = 1.0/(1024.0*1024.0);
+   std::ios_base::fmtflags flags = out.flags();
+   std::streamsize precision = out.precision();
+   for(size_t i=0; i<NSTAGE; i++) {
+      const usage& u = m_usage[i];
+      if(u.peak_nmesh == 0) continue;
+      out << "...queue peak " << std::left << std::setw(10) << stage_name(stage(i)) << std::right
+          << ": " << u.peak_nmesh << " meshes, " << std::fixed << std::setprecision(1) << u.peak_bytes*mb << " MB" << std::endl;
+   }
+   if(m_budget > 0) {
+      out << "...queue budget " << std::fixed << std::setprecision(1) << m_budget*mb << " MB, producers waited " << m_throttled << " times" << std::endl;
+   }
+   out.flags(flags);
+   out.precision(precision);
+}
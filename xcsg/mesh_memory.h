@@ -0,0 +1,118 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_MEMORY_H
+#define MESH_MEMORY_H
+
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <carve/mesh.hpp>
+
+// mesh_memory tracks the meshes waiting in the queues of the boolean pipeline.
+// Each queue is a stage instance (a scope) registering the meshes it holds with add()
+// and the ones taken out with remove(). The current and peak number of meshes and their
+// estimated memory is recorded per stage type, summed over the instances running at the same time.
+//
+// With a memory budget, producers that run alongside the consumers of their queue call
+// throttle() before creating another mesh. It blocks while the queued memory exceeds the
+// budget and a consumer of the same scope is busy ("busy" marks it), since that consumer
+// will reduce the number of queued meshes. A producer never waits for nothing.
+
+class mesh_memory {
+public:
+   typedef carve::mesh::MeshSet<3> MeshSet;
+
+   enum stage { MESH, BOOLEAN, MINKOWSKI, NSTAGE };
+
+   struct usage {
+      usage() : nmesh(0), bytes(0), peak_nmesh(0), peak_bytes(0) {}
+      size_t nmesh, bytes;           // currently queued
+      size_t peak_nmesh, peak_bytes; // high water marks
+   };
+
+   // meshes queued by one stage instance, the remaining are removed when it goes out of scope
+   class scope {
+   public:
+      scope(stage s);
+      ~scope();
+
+      void add(const MeshSet* mesh);
+      void remove(const MeshSet* mesh);
+
+      // block while over budget and a consumer of this scope is busy.
+      // Returns true if it had to wait
+      bool throttle();
+
+   private:
+      scope(const scope&) = delete;
+      scope& operator=(const scope&) = delete;
+      friend class mesh_memory;
+      stage  m_stage;
+      size_t m_nmesh;
+      size_t m_bytes;
+      size_t m_busy;
+   };
+
+   // marks a consumer of the scope as busy while in scope
+   class busy {
+   public:
+      busy(scope& s);
+      ~busy();
+   private:
+      scope& m_scope;
+   };
+
+   static mesh_memory& singleton()  { static mesh_memory instance; return instance;  }
+
+   // estimated memory of a mesh: vertices, faces, half edges and meshes
+   static size_t estimate(const MeshSet* mesh);
+
+   // estimated memory of a triangle mesh with nface faces, before it exists
+   static size_t estimate(size_t nface);
+
+   // budget for all queued meshes in bytes, 0 means no limit
+   size_t budget() const;
+   void set_budget(size_t bytes);
+
+   // reset the high water marks
+   void clear();
+
+   // usage per stage and in total
+   usage get_usage(stage s) const;
+   size_t bytes() const;
+
+   // write the peak usage of each stage that queued meshes
+   void write_report(std::ostream& out) const;
+
+   static const char* stage_name(stage s);
+
+protected:
+   mesh_memory();
+   virtual ~mesh_memory();
+
+   // add or remove meshes of a scope
+   void update(scope& s, size_t nmesh, size_t bytes, bool added);
+
+private:
+   mutable std::mutex      m_mutex;
+   std::condition_variable m_cond;
+   size_t                  m_budget;
+   size_t                  m_bytes;   // queued in all stages
+   usage                   m_usage[NSTAGE];
+   size_t                  m_throttled;  // number of times a producer waited
+};
+
+#endif // MESH_MEMORY_H
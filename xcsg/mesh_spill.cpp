@@ -0,0 +1,127 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "mesh_spill.h"
+#include "mesh_binary.h"
+#include "mesh_memory.h"
+#include "mapped_file.h"
+#include "std_filename.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+mesh_spill::page::page(const std::string& path, size_t nvertices, size_t bytes)
+: m_path(path)
+, m_nvertices(nvertices)
+, m_bytes(bytes)
+{
+   mesh_spill::singleton().update(m_bytes,true);
+}
+
+mesh_spill::page::~page()
+{
+   boost::system::error_code ec;
+   boost::filesystem::remove(m_path,ec);
+   mesh_spill::singleton().update(m_bytes,false);
+}
+
+mesh_spill::MeshSet_ptr mesh_spill::page::load() const
+{
+   mapped_file mapped(m_path);
+   MeshSet_ptr mesh = mesh_binary::read(mapped.data(),mapped.size());
+   if(!mesh.get()) throw std::runtime_error("mesh_spill: corrupt spill file: " + m_path);
+   mesh_spill::singleton().m_loaded++;
+   return mesh;
+}
+
+mesh_spill::mesh_spill()
+: m_spilled(0)
+, m_loaded(0)
+, m_bytes(0)
+, m_peak_bytes(0)
+{}
+
+mesh_spill::~mesh_spill()
+{}
+
+void mesh_spill::set_directory(const std::string& dir)
+{
+   if(dir.length() > 0 && !std_filename::Exists(dir)) {
+      std_filename::create_directories(dir);
+   }
+   m_dir = dir;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_spilled    = 0;
+   m_loaded     = 0;
+   m_peak_bytes = m_bytes;
+}
+
+bool mesh_spill::wanted(size_t bytes) const
+{
+   if(!enabled() || bytes < min_bytes()) return false;
+   const mesh_memory& memory = mesh_memory::singleton();
+   return memory.budget() == 0 || memory.bytes() + bytes > memory.budget();
+}
+
+mesh_spill::page_ptr mesh_spill::spill(MeshSet_ptr mesh)
+{
+   if(!enabled()) return nullptr;
+
+   boost::filesystem::path path(m_dir);
+   path /= boost::filesystem::unique_path("xcsg-spill-%%%%-%%%%-%%%%-%%%%.xmesh");
+   size_t bytes = 0;
+   {
+      std::ofstream out(path.string(),std::ios::binary);
+      bool ok = out.is_open() && mesh_binary::write(out,mesh);
+      if(ok) {
+         out.flush();
+         bytes = static_cast<size_t>(out.tellp());
+         ok = out.good();
+      }
+      if(!ok) {
+         out.close();
+         boost::system::error_code ec;
+         boost::filesystem::remove(path,ec);
+         return nullptr;
+      }
+   }
+   m_spilled++;
+   return std::make_shared<page>(path.string(),mesh->vertex_storage.size(),bytes);
+}
+
+void mesh_spill::update(size_t bytes, bool added)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(added) {
+      m_bytes += bytes;
+      m_peak_bytes = std::max(m_peak_bytes,m_bytes);
+   }
+   else m_bytes -= std::min(m_bytes,bytes);
+}
+
+void mesh_spill::write_report(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   const double mb = 1.0/(1024.0*1024.0);
+   std::ios_base::fmtflags flags = out.flags();
+   std::streamsize precision = out.precision();
+   out << "...spilled " << m_spilled << " queued meshes to " << m_dir << ", " << m_loaded << " paged in, peak "
+       << std::fixed << std::setprecision(1) << m_peak_bytes*mb << " MB on disk" << std::endl;
+   out.flags(flags);
+   out.precision(precision);
+}
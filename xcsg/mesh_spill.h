@@ -0,0 +1,98 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef MESH_SPILL_H
+#define MESH_SPILL_H
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <carve/mesh.hpp>
+
+// mesh_spill is the out-of-core mode of the boolean pipeline. With a spill directory, meshes
+// waiting in the boolean queues are written to files in the mesh_binary form and released.
+// The spill file is memory mapped and the mesh rebuilt only when a boolean takes it, and
+// the file is removed when the page goes out of scope.
+//
+// Meshes are spilled when the queued meshes exceed the mesh_memory budget, or always
+// without a budget. Small meshes are kept in memory, their files would cost more than they save.
+
+class mesh_spill {
+public:
+   typedef carve::mesh::MeshSet<3> MeshSet;
+   typedef std::shared_ptr<MeshSet> MeshSet_ptr;
+
+   // a mesh held in a spill file
+   class page {
+   public:
+      page(const std::string& path, size_t nvertices, size_t bytes);
+      virtual ~page();
+
+      size_t nvertices() const { return m_nvertices; }
+      size_t bytes() const     { return m_bytes; }
+
+      // map the spill file and rebuild the mesh
+      MeshSet_ptr load() const;
+
+   private:
+      page(const page&) = delete;
+      page& operator=(const page&) = delete;
+
+      std::string m_path;
+      size_t      m_nvertices;
+      size_t      m_bytes;        // size of the spill file
+   };
+   typedef std::shared_ptr<page> page_ptr;
+
+   static mesh_spill& singleton()  { static mesh_spill instance; return instance;  }
+
+   // enable spilling by giving a directory, created if it does not exist.
+   // An empty string disables it. Counters are reset
+   void set_directory(const std::string& dir);
+   bool enabled() const { return m_dir.length() > 0; }
+
+   // true if a queued mesh of given estimated memory should be spilled now
+   bool wanted(size_t bytes) const;
+
+   // write mesh to a new spill file, returns nullptr if it could not be written
+   page_ptr spill(MeshSet_ptr mesh);
+
+   size_t spilled() const   { return m_spilled; }
+   size_t loaded() const    { return m_loaded; }
+
+   // write the number of meshes spilled and paged in, and the peak size of the spill files
+   void write_report(std::ostream& out) const;
+
+   // meshes smaller than this are not spilled
+   static size_t min_bytes() { return size_t(1)<<20; }
+
+protected:
+   mesh_spill();
+   virtual ~mesh_spill();
+
+   // spill file bytes added or removed
+   void update(size_t bytes, bool added);
+
+private:
+   std::string         m_dir;
+   std::atomic<size_t> m_spilled;
+   std::atomic<size_t> m_loaded;
+   mutable std::mutex  m_mutex;      // protects m_bytes and m_peak_bytes
+   size_t              m_bytes;      // current size of the spill files
+   size_t              m_peak_bytes;
+};
+
+#endif // MESH_SPILL_H
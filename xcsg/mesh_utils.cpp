@@ -15,13 +15,45 @@
 
 #include "mesh_utils.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
-double  mesh_utils::m_secant_tolerance = 0.05;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESH_UTILS_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MESH_UTILS_NEON
+#endif
+
+double  mesh_utils::m_secant_tolerance = mesh_utils::default_secant_tolerance();
+bool    mesh_utils::m_preview = false;
 static const double min_secant_tolerance = 0.0009;
 
+// preview mode: the tolerance giving about 16 segments per full circle, and the max segment count
+static const double pi = 4.0*atan(1.0);
+static const double preview_tolerance_factor = 1.0-cos(pi/16);
+static const int    preview_max_nseg = 32;
+
+// the tolerance of the innermost tolerance_scope in this thread, 0 when there is none
+static thread_local double scope_secant_tolerance = 0.0;
+
 double mesh_utils::secant_tolerance()
 {
-   return m_secant_tolerance;
+   return (scope_secant_tolerance > 0.0)? scope_secant_tolerance : m_secant_tolerance;
+}
+
+double mesh_utils::secant_tolerance(double r)
+{
+   double tol = secant_tolerance();
+   if(m_preview) return std::max(tol,preview_tolerance_factor*fabs(r));
+   return tol;
+}
+
+int mesh_utils::limit_nseg(int nseg)
+{
+   if(m_preview) return std::min(nseg,preview_max_nseg);
+   return nseg;
 }
 
 void  mesh_utils::set_secant_tolerance(double tol)
@@ -34,6 +66,21 @@ void  mesh_utils::set_secant_tolerance(double tol)
    }
 }
 
+mesh_utils::tolerance_scope::tolerance_scope(double tol)
+: m_previous(scope_secant_tolerance)
+{
+   if(tol > min_secant_tolerance) {
+      scope_secant_tolerance = tol;
+   }
+   else {
+      std::cout << "Info: ignored secant tolerance " << tol << " < min tolerance=" << min_secant_tolerance << std::endl;
+   }
+}
+
+mesh_utils::tolerance_scope::~tolerance_scope()
+{
+   scope_secant_tolerance = m_previous;
+}
 
 bool mesh_utils::is_left_hand(const carve::math::Matrix& t)
 {
@@ -45,3 +92,83 @@ bool mesh_utils::is_left_hand(const carve::math::Matrix& t)
    double dot   = carve::geom::dot(z,z_test);
    return (dot < 0.0);
 }
+
+bool mesh_utils::is_identity(const carve::math::Matrix& t)
+{
+   for(size_t i=0; i<4; i++) {
+      for(size_t j=0; j<4; j++) {
+         if(t.m[i][j] != ((i==j)? 1.0 : 0.0)) return false;
+      }
+   }
+   return true;
+}
+
+void mesh_utils::transform(const carve::math::Matrix& t, const xvertex* in, size_t n, xvertex* out)
+{
+   if(is_identity(t)) {
+      if(out != in) std::copy(in,in+n,out);
+      return;
+   }
+   if(n > 0) transform(t,&in[0].v[0],sizeof(xvertex),&out[0].v[0],sizeof(xvertex),n);
+}
+
+void mesh_utils::transform(const carve::math::Matrix& t, const double* in, size_t in_stride, double* out, size_t out_stride, size_t n)
+{
+   const char* src = reinterpret_cast<const char*>(in);
+   char*       dst = reinterpret_cast<char*>(out);
+   const bool affine = (t.m[0][3] == 0.0 && t.m[1][3] == 0.0 && t.m[2][3] == 0.0 && t.m[3][3] == 1.0);
+   if(!affine) {
+      for(size_t i=0; i<n; i++) {
+         const double* p = reinterpret_cast<const double*>(src + i*in_stride);
+         double*       q = reinterpret_cast<double*>(dst + i*out_stride);
+         const xvertex r = t*carve::geom::VECTOR(p[0],p[1],p[2]);
+         q[0] = r.v[0];
+         q[1] = r.v[1];
+         q[2] = r.v[2];
+      }
+      return;
+   }
+
+   // x and y are computed as a pair, z on its own. The terms are added in the order of carve's
+   // product, so the result is the same as t*v. All inputs of a point are read before it is written
+   const double z0 = t.m[0][2], z1 = t.m[1][2], z2 = t.m[2][2], z3 = t.m[3][2];
+#if defined(MESH_UTILS_SSE2)
+   const __m128d c0 = _mm_set_pd(t.m[0][1],t.m[0][0]);
+   const __m128d c1 = _mm_set_pd(t.m[1][1],t.m[1][0]);
+   const __m128d c2 = _mm_set_pd(t.m[2][1],t.m[2][0]);
+   const __m128d c3 = _mm_set_pd(t.m[3][1],t.m[3][0]);
+   for(size_t i=0; i<n; i++) {
+      const double* p = reinterpret_cast<const double*>(src + i*in_stride);
+      double*       q = reinterpret_cast<double*>(dst + i*out_stride);
+      const double px = p[0], py = p[1], pz = p[2];
+      const __m128d xy = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(c0,_mm_set1_pd(px)),_mm_mul_pd(c1,_mm_set1_pd(py))),_mm_mul_pd(c2,_mm_set1_pd(pz))),c3);
+      q[2] = z0*px + z1*py + z2*pz + z3;
+      _mm_storeu_pd(q,xy);
+   }
+#elif defined(MESH_UTILS_NEON)
+   const double col[4][2] = { {t.m[0][0],t.m[0][1]}, {t.m[1][0],t.m[1][1]}, {t.m[2][0],t.m[2][1]}, {t.m[3][0],t.m[3][1]} };
+   const float64x2_t c0 = vld1q_f64(col[0]);
+   const float64x2_t c1 = vld1q_f64(col[1]);
+   const float64x2_t c2 = vld1q_f64(col[2]);
+   const float64x2_t c3 = vld1q_f64(col[3]);
+   for(size_t i=0; i<n; i++) {
+      const double* p = reinterpret_cast<const double*>(src + i*in_stride);
+      double*       q = reinterpret_cast<double*>(dst + i*out_stride);
+      const double px = p[0], py = p[1], pz = p[2];
+      const float64x2_t xy = vaddq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(c0,px),vmulq_n_f64(c1,py)),vmulq_n_f64(c2,pz)),c3);
+      q[2] = z0*px + z1*py + z2*pz + z3;
+      vst1q_f64(q,xy);
+   }
+#else
+   const double x0 = t.m[0][0], x1 = t.m[1][0], x2 = t.m[2][0], x3 = t.m[3][0];
+   const double y0 = t.m[0][1], y1 = t.m[1][1], y2 = t.m[2][1], y3 = t.m[3][1];
+   for(size_t i=0; i<n; i++) {
+      const double* p = reinterpret_cast<const double*>(src + i*in_stride);
+      double*       q = reinterpret_cast<double*>(dst + i*out_stride);
+      const double px = p[0], py = p[1], pz = p[2];
+      q[0] = x0*px + x1*py + x2*pz + x3;
+      q[1] = y0*px + y1*py + y2*pz + y3;
+      q[2] = z0*px + z1*py + z2*pz + z3;
+   }
+#endif
+}
@@ -17,6 +17,7 @@
 #define MESH_UTILS_H
 
 #include <carve/matrix.hpp>
+#include "xshape.h"
 
 class mesh_utils {
 public:
@@ -29,13 +30,54 @@ public:
 
    // tolerances for adaptive meshing of circular curves/surfaces
    // The tolerance measures the distance from a segment chord to the true circular curve, i.e.  radius*(1-cos(angle/2))
+   // secant_tolerance() is the tolerance of the innermost tolerance_scope of the calling thread,
+   // or the model tolerance set from the root element
    static double secant_tolerance();
    static void set_secant_tolerance(double tol);
+   static double default_secant_tolerance() { return 0.05; }
+
+   // tolerance_scope overrides the secant tolerance of the calling thread while in scope.
+   // Nodes with a secant_tolerance attribute open one while they and their children are constructed,
+   // and shapes open one with their own (inherited) tolerance while they are meshed
+   class tolerance_scope {
+   public:
+      tolerance_scope(double tol);
+      ~tolerance_scope();
+   private:
+      tolerance_scope(const tolerance_scope&) = delete;
+      tolerance_scope& operator=(const tolerance_scope&) = delete;
+      double m_previous;
+   };
+
+   // preview mode trades accuracy for speed: the secant tolerance grows with the curve radius
+   // and segment counts are capped, so every curve gets a few segments regardless of its size
+   static bool preview() { return m_preview; }
+   static void set_preview(bool preview) { m_preview = preview; }
+
+   // secant tolerance for a curve of radius r, equal to secant_tolerance() unless in preview mode
+   static double secant_tolerance(double r);
+
+   // nseg, capped in preview mode
+   static int limit_nseg(int nseg);
 
    static bool is_left_hand(const carve::math::Matrix& t);
 
+   // true if t is exactly the identity matrix
+   static bool is_identity(const carve::math::Matrix& t);
+
+   // out[i] = t*in[i] for n vertices in a single pass, in and out may be the same buffer.
+   // Compose all transforms into t first, so each vertex is transformed once
+   static void transform(const carve::math::Matrix& t, const xvertex* in, size_t n, xvertex* out);
+
+   // the same for n points of 3 doubles placed in_stride and out_stride bytes apart, such as the
+   // vertex storage of a carve mesh. An affine t is applied as a 3x4 matrix in SIMD pairs
+   // (SSE2 or NEON, scalar otherwise) with the rounding of carve's product. Other matrices use
+   // carve's product with its projective divide
+   static void transform(const carve::math::Matrix& t, const double* in, size_t in_stride, double* out, size_t out_stride, size_t n);
+
 private:
    static double m_secant_tolerance;
+   static bool   m_preview;
 };
 
 #endif // MESH_UTILS_H
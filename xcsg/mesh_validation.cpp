@@ -0,0 +1,140 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "mesh_validation.h"
+#include "thread_pool.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// minimum number of faces per parallel binning task
+static const size_t min_chunk = 1<<15;
+
+// a half edge, stored with the smaller vertex index first
+struct half_edge {
+   size_t v0,v1;
+   bool   forward;   // true when the face runs from v0 to v1
+   bool operator<(const half_edge& other) const { return (v0 != other.v0)? v0 < other.v0 : v1 < other.v1; }
+};
+
+static size_t edge_bin(size_t v0, size_t v1, size_t nbin)
+{
+   return size_t((uint64_t(v0)*73856093u) ^ (uint64_t(v1)*19349663u)) % nbin;
+}
+
+mesh_validation::mesh_validation(const size_t* indices, const size_t* offsets, size_t nfaces)
+: m_nfaces(nfaces)
+, m_nedges(0)
+, m_nwrong(0)
+, m_nopen(0)
+, m_nflipped(0)
+, m_num_non_tri(non_triangles(offsets,nfaces))
+{
+   if(nfaces == 0) return;
+
+   const size_t nthreads = thread_pool::singleton().nthreads();
+   const size_t nchunk = std::max(size_t(1),std::min(nthreads,nfaces/min_chunk));
+   const size_t nbin   = (nchunk > 1)? 4*nthreads : 1;
+
+   // bins[ichunk*nbin + ibin] holds the half edges of chunk ichunk falling in bin ibin
+   std::vector<std::vector<half_edge>> bins(nchunk*nbin);
+   auto bin_faces = [indices,offsets,nfaces,nchunk,nbin,&bins](size_t ichunk) {
+      const size_t ifirst = (nfaces*ichunk)/nchunk;
+      const size_t ilast  = (nfaces*(ichunk+1))/nchunk;
+      std::vector<half_edge>* chunk_bins = &bins[ichunk*nbin];
+      if(nbin == 1) chunk_bins->reserve(offsets[ilast]-offsets[ifirst]);
+      for(size_t iface=ifirst; iface<ilast; iface++) {
+         const size_t first = offsets[iface];
+         const size_t nv    = offsets[iface+1] - first;
+         for(size_t i=0; i<nv; i++) {
+            size_t iv0 = indices[first+i];
+            size_t iv1 = indices[first+(i+1)%nv];
+            half_edge edge = { std::min(iv0,iv1), std::max(iv0,iv1), iv0 < iv1 };
+            chunk_bins[edge_bin(edge.v0,edge.v1,nbin)].push_back(edge);
+         }
+      }
+   };
+
+   // the half edges of one bin from all chunks are sorted, so each edge forms a run
+   std::vector<size_t> counts(4*nbin,0);
+   auto count_bin = [nchunk,nbin,&bins,&counts](size_t ibin) {
+      std::vector<half_edge>& edges = bins[ibin];
+      for(size_t ichunk=1; ichunk<nchunk; ichunk++) {
+         std::vector<half_edge>& other = bins[ichunk*nbin + ibin];
+         edges.insert(edges.end(),other.begin(),other.end());
+         std::vector<half_edge>().swap(other);
+      }
+      std::sort(edges.begin(),edges.end());
+
+      size_t* count = &counts[4*ibin];
+      for(size_t i=0; i<edges.size(); ) {
+         size_t j = i;
+         size_t nforward = 0;
+         for(; j<edges.size() && edges[j].v0==edges[i].v0 && edges[j].v1==edges[i].v1; j++) {
+            if(edges[j].forward) nforward++;
+         }
+         const size_t nuse = j-i;
+         count[0]++;
+         if(nuse != 2)       count[1]++;
+         if(nuse == 1)       count[2]++;
+         if(nuse == 2 && nforward != 1) count[3]++;
+         i = j;
+      }
+      std::vector<half_edge>().swap(edges);
+   };
+
+   auto run_parallel = [](size_t n, const std::function<void(size_t)>& f) {
+      if(n <= 1) {
+         for(size_t i=0; i<n; i++) f(i);
+         return;
+      }
+      task_group tasks;
+      for(size_t i=0; i<n; i++) tasks.run([&f,i]() { f(i); });
+      tasks.wait();
+   };
+   run_parallel(nchunk,bin_faces);
+   run_parallel(nbin,count_bin);
+
+   for(size_t ibin=0; ibin<nbin; ibin++) {
+      m_nedges   += counts[4*ibin];
+      m_nwrong   += counts[4*ibin+1];
+      m_nopen    += counts[4*ibin+2];
+      m_nflipped += counts[4*ibin+3];
+   }
+}
+
+mesh_validation::~mesh_validation()
+{}
+
+size_t mesh_validation::non_triangles(const size_t* offsets, size_t nfaces)
+{
+   size_t nnon_tri = 0;
+   for(size_t iface=0; iface<nfaces; iface++) {
+      if(offsets[iface+1] - offsets[iface] != 3) nnon_tri++;
+   }
+   return nnon_tri;
+}
+
+void mesh_validation::write_report(std::ostream& out) const
+{
+   if(m_nwrong == 0) {
+      out << "...Polyhedron is water-tight (edge use-count check OK)" << std::endl;
+   }
+   else {
+      out << ">>> Warning: Polyhedron is not water-tight, it has " << m_nedges << " edges, " << m_nwrong << " with wrong use count, " << m_nopen << " with use-count==1" << std::endl;
+   }
+   if(m_nflipped > 0) {
+      out << ">>> Warning: Polyhedron is not consistently oriented, " << m_nflipped << " edges are used twice in the same direction" << std::endl;
+   }
+}
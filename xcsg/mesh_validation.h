@@ -0,0 +1,59 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef MESH_VALIDATION_H
+#define MESH_VALIDATION_H
+
+#include <cstddef>
+#include <ostream>
+
+// mesh_validation checks the edges of a polygon mesh held as a flat index buffer: the vertex
+// indices of all faces back to back, with an offset table one entry longer than the faces, as
+// in xpolyhedron. The half edges are binned by edge in parallel chunks of faces, then each bin is
+// sorted and its edges counted by a task of its own. A closed, consistently oriented mesh uses
+// every edge exactly twice, once in each direction.
+
+class mesh_validation {
+public:
+   // validate faces [0,nfaces), face i uses indices[offsets[i]] ... indices[offsets[i+1]-1]
+   mesh_validation(const size_t* indices, const size_t* offsets, size_t nfaces);
+   virtual ~mesh_validation();
+
+   // number of faces with other than 3 vertices, without the edge pass
+   static size_t non_triangles(const size_t* offsets, size_t nfaces);
+
+   size_t nfaces() const      { return m_nfaces; }
+   size_t nedges() const      { return m_nedges; }
+   size_t nwrong() const      { return m_nwrong; }
+   size_t nopen() const       { return m_nopen; }
+   size_t nflipped() const    { return m_nflipped; }
+   size_t num_non_tri() const { return m_num_non_tri; }
+
+   bool water_tight() const   { return m_nwrong == 0; }
+   bool oriented() const      { return m_nflipped == 0; }
+   bool triangulated() const  { return m_num_non_tri == 0; }
+
+   // report the edge use and orientation checks as xpolyhedron::check_polyhedron
+   void write_report(std::ostream& out) const;
+
+private:
+   size_t m_nfaces;
+   size_t m_nedges;       // distinct edges
+   size_t m_nwrong;       // edges not used by exactly 2 faces
+   size_t m_nopen;        // edges used by one face only
+   size_t m_nflipped;     // edges used by 2 faces in the same direction
+   size_t m_num_non_tri;  // faces with other than 3 vertices
+};
+
+#endif // MESH_VALIDATION_H
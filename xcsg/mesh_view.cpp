@@ -0,0 +1,68 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_view.h"
+#include "extrude_mesh.h"
+#include "mesh_memory.h"
+
+mesh_view::mesh_view(MeshSet_ptr mesh)
+: m_mesh(mesh)
+, m_owned(true)
+{}
+
+mesh_view::mesh_view(MeshSet_ptr source, const carve::math::Matrix& t)
+: m_mesh(source)
+, m_t(t)
+, m_owned(false)
+{}
+
+mesh_view::~mesh_view()
+{}
+
+size_t mesh_view::nvertices() const
+{
+   return (m_page)? m_page->nvertices() : m_mesh->vertex_storage.size();
+}
+
+const carve::mesh::MeshSet<3>* mesh_view::owned() const
+{
+   return (m_owned)? m_mesh.get() : nullptr;
+}
+
+bool mesh_view::spill()
+{
+   if(!m_owned || !m_mesh || m_mesh.use_count() > 1) return false;
+
+   mesh_spill& spill = mesh_spill::singleton();
+   if(!spill.wanted(mesh_memory::estimate(m_mesh.get()))) return false;
+
+   m_page = spill.spill(m_mesh);
+   if(!m_page) return false;
+   m_mesh.reset();
+   return true;
+}
+
+mesh_view::MeshSet_ptr mesh_view::materialize()
+{
+   if(m_page) {
+      m_mesh = m_page->load();
+      m_page.reset();
+   }
+   else if(!m_owned) {
+      m_mesh  = extrude_mesh::clone_transform(m_mesh,m_t);
+      m_owned = true;
+   }
+   return m_mesh;
+}
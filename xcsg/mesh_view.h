@@ -0,0 +1,62 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_VIEW_H
+#define MESH_VIEW_H
+
+#include <memory>
+#include <carve/mesh.hpp>
+#include <carve/matrix.hpp>
+#include "mesh_spill.h"
+
+// mesh_view is a mesh as seen through a transform. A transformed view shares the
+// source mesh, which is never modified, and stores only the matrix. The transformed
+// copy is created by materialize() when a boolean needs it, so repeated instances
+// waiting in the boolean queues hold no mesh memory of their own. In out-of-core mode an
+// owned mesh may be spilled to a file while it waits, see mesh_spill.
+
+class mesh_view {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   // view of a mesh owned by the view, materialize() returns the mesh itself
+   mesh_view(MeshSet_ptr mesh);
+
+   // transformed view of a shared source mesh. The transform must not mirror,
+   // since the faces are not reoriented
+   mesh_view(MeshSet_ptr source, const carve::math::Matrix& t);
+   virtual ~mesh_view();
+
+   // number of vertices, without materializing
+   size_t nvertices() const;
+
+   // the mesh owned by the view, nullptr for a view not yet materialized or spilled
+   const carve::mesh::MeshSet<3>* owned() const;
+
+   // write an owned mesh not shared elsewhere to a spill file and release it, when
+   // mesh_spill wants it. Returns true if the mesh was spilled
+   bool spill();
+
+   // return the transformed mesh, created or paged in on the first call
+   MeshSet_ptr materialize();
+
+private:
+   MeshSet_ptr          m_mesh;   // the owned mesh, or the shared source
+   carve::math::Matrix  m_t;
+   bool                 m_owned;
+   mesh_spill::page_ptr m_page;   // the spilled mesh, when m_mesh is released
+};
+
+#endif // MESH_VIEW_H
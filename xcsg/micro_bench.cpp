@@ -0,0 +1,284 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "micro_bench.h"
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/date_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include "carve_boolean.h"
+#include "clipper_boolean.h"
+#include "primitives2d.h"
+#include "primitives3d.h"
+#include "xpolyhedron.h"
+#include "triangle_mesh.h"
+#include "out_triangles.h"
+#include "thread_pool.h"
+#include "qhull/qhull3d.h"
+#include "dmesh/dmesh.h"
+#include "clipper_csg/tmesh_adapter.h"
+
+static const double pi = 4.0*atan(1.0);
+
+// the inputs are random but repeatable
+static const unsigned seed = 12345;
+
+// seconds elapsed since t0
+static double elapsed(const boost::posix_time::ptime& t0)
+{
+   return 1.0E-6*(boost::posix_time::microsec_clock::universal_time() - t0).total_microseconds();
+}
+
+static size_t nfaces(const carve::mesh::MeshSet<3>* mesh)
+{
+   size_t n = 0;
+   for(auto m : mesh->meshes) n += m->faces.size();
+   return n;
+}
+
+// profile of the circles given by centres and radius
+static std::shared_ptr<clipper_profile> circles_profile(const std::vector<std::pair<double,double>>& centres, double r)
+{
+   std::shared_ptr<clipper_profile> profile(new clipper_profile());
+   for(auto& c : centres) {
+      profile->AddPaths(primitives2d::make_circle(r,16,carve::math::Matrix::TRANS(c.first,c.second,0.0))->paths());
+   }
+   return profile;
+}
+
+micro_bench::micro_bench(size_t repeat)
+: m_repeat(std::max(size_t(1),repeat))
+{}
+
+micro_bench::~micro_bench()
+{}
+
+const std::vector<std::string>& micro_bench::kernels()
+{
+   static const std::vector<std::string> names = { "boolean", "hull", "tesselate", "delaunay", "clipper", "export", "pool" };
+   return names;
+}
+
+void micro_bench::run(const std::string& kernel_list, std::ostream& log, std::ostream& json)
+{
+   std::vector<std::string> selected;
+   if(kernel_list == "all") selected = kernels();
+   else {
+      std::istringstream in(kernel_list);
+      std::string name;
+      while(std::getline(in,name,',')) {
+         if(std::find(kernels().begin(),kernels().end(),name) == kernels().end()) {
+            throw std::logic_error("microbench: unknown kernel '" + name + "'");
+         }
+         selected.push_back(name);
+      }
+   }
+
+   // compare runs with and without --pin_threads by these
+   thread_pool& pool = thread_pool::singleton();
+   json << "{ \"repeat\": " << m_repeat << ", \"threads\": " << pool.nthreads()
+        << ", \"pinned\": " << (pool.pinned()? "true":"false") << ", \"nodes\": " << pool.nnodes()
+        << ", \"kernels\": [" << std::endl;
+   for(size_t ik=0; ik<selected.size(); ik++) {
+      const std::string& name = selected[ik];
+      std::vector<point> points;
+      if(name == "boolean")        points = measure(name,{ 16, 32, 64, 128 },                 time_boolean,  log);
+      else if(name == "hull")      points = measure(name,{ 1000, 4000, 16000, 64000, 256000 }, time_hull,     log);
+      else if(name == "tesselate") points = measure(name,{ 16, 64, 256, 1024, 4096 },         time_tesselate,log);
+      else if(name == "delaunay")  points = measure(name,{ 1000, 4000, 16000, 64000 },        time_delaunay, log);
+      else if(name == "clipper")   points = measure(name,{ 64, 256, 1024, 4096, 16384 },      time_clipper,  log);
+      else if(name == "export")    points = measure(name,{ 32, 64, 128, 256, 512 },           time_export,   log);
+      else if(name == "pool")      points = measure(name,{ 16, 64, 256 },                     time_pool,     log);
+
+      double p = exponent(points);
+      log << "...microbench " << name << ": t ~ n^" << std::setprecision(3) << p << std::endl;
+
+      json << "{ \"kernel\": \"" << name << "\", \"exponent\": " << p << ", \"points\": [";
+      for(size_t i=0; i<points.size(); i++) {
+         json << ((i>0)? ", ":"") << "{ \"size\": " << points[i].size << ", \"sec\": " << std::setprecision(6) << points[i].sec << " }";
+      }
+      json << "] }" << ((ik+1<selected.size())? ",":"") << std::endl;
+   }
+   json << "]}" << std::endl;
+}
+
+std::vector<micro_bench::point> micro_bench::measure(const std::string& name, const std::vector<size_t>& params, const kernel& k, std::ostream& log)
+{
+   std::vector<point> points;
+   for(size_t n : params) {
+      std::vector<double> times;
+      point pt;
+      pt.size = 0;
+      for(size_t i=0; i<m_repeat; i++) times.push_back(k(n,pt.size));
+      std::sort(times.begin(),times.end());
+      pt.sec = times[times.size()/2];
+      points.push_back(pt);
+      log << "...microbench " << name << " size " << pt.size << ": " << std::setprecision(4) << pt.sec << " [sec]" << std::endl;
+   }
+   return points;
+}
+
+double micro_bench::exponent(const std::vector<point>& points)
+{
+   double sx=0,sy=0,sxx=0,sxy=0;
+   size_t n = 0;
+   for(auto& p : points) {
+      // too short to time reliably
+      if(p.size == 0 || p.sec < 1.0E-5) continue;
+      double x = log(double(p.size));
+      double y = log(p.sec);
+      sx += x; sy += y; sxx += x*x; sxy += x*y;
+      n++;
+   }
+   double d = n*sxx - sx*sx;
+   return (n > 1 && d > 0.0)? (n*sxy - sx*sy)/d : 0.0;
+}
+
+double micro_bench::time_boolean(size_t nseg, size_t& size)
+{
+   // union of two overlapping spheres
+   const double r = 10.0;
+   std::shared_ptr<carve::mesh::MeshSet<3>> a = primitives3d::make_sphere(r,static_cast<int>(nseg))->create_carve_mesh();
+   std::shared_ptr<carve::mesh::MeshSet<3>> b = primitives3d::make_sphere(r,static_cast<int>(nseg),carve::math::Matrix::TRANS(0.5*r,0.3*r,0.2*r))->create_carve_mesh();
+   size = nfaces(a.get()) + nfaces(b.get());
+
+   carve_boolean csg;
+   csg.compute(a,carve::csg::CSG::UNION);
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   csg.compute(b,carve::csg::CSG::UNION);
+   return elapsed(t0);
+}
+
+double micro_bench::time_hull(size_t npoints, size_t& size)
+{
+   // points inside the unit ball
+   std::mt19937 rng(seed);
+   std::uniform_real_distribution<double> u(-1.0,1.0);
+   qhull3d qhull;
+   qhull.reserve(npoints);
+   for(size_t i=0; i<npoints; ) {
+      double x=u(rng), y=u(rng), z=u(rng);
+      if(x*x+y*y+z*z > 1.0) continue;
+      qhull.push_back(x,y,z);
+      i++;
+   }
+   size = npoints;
+
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   if(!qhull.compute()) throw std::runtime_error("microbench: hull failed");
+   return elapsed(t0);
+}
+
+double micro_bench::time_tesselate(size_t nholes, size_t& size)
+{
+   // a plate perforated by a grid of holes
+   size_t ngrid = static_cast<size_t>(ceil(sqrt(double(nholes))));
+   std::vector<std::pair<double,double>> centres;
+   for(size_t i=0; i<nholes; i++) centres.push_back(std::make_pair(10.0*(i%ngrid)+5.0,10.0*(i/ngrid)+5.0));
+
+   std::shared_ptr<clipper_profile> plate(new clipper_profile());
+   plate->AddPaths(primitives2d::make_rectangle(10.0*ngrid,10.0*ngrid,false)->paths());
+   clipper_boolean csg;
+   csg.compute(plate,ClipperLib::ctUnion);
+   csg.compute(circles_profile(centres,3.0),ClipperLib::ctDifference);
+   std::shared_ptr<polyset2d> polyset = csg.profile()->polyset();
+   size = nholes+1;
+
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   tmesh_adapter tess;
+   tess.tesselate(polyset);
+   return elapsed(t0);
+}
+
+double micro_bench::time_delaunay(size_t npoints, size_t& size)
+{
+   std::mt19937 rng(seed);
+   std::uniform_real_distribution<double> u(0.0,1000.0);
+   std::vector<dpos2d> points;
+   points.reserve(npoints);
+   for(size_t i=0; i<npoints; i++) points.push_back(dpos2d(u(rng),u(rng)));
+   size = npoints;
+
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   dmesh mesh;
+   mesh.triangulate_point_cloud(points);
+   return elapsed(t0);
+}
+
+double micro_bench::time_clipper(size_t ncircles, size_t& size)
+{
+   // union of randomly overlapping circles, about 4 circles deep
+   const double r = 1.0;
+   const double side = sqrt(ncircles*pi*r*r/4.0);
+   std::mt19937 rng(seed);
+   std::uniform_real_distribution<double> u(0.0,side);
+   std::vector<std::pair<double,double>> first(1,std::make_pair(u(rng),u(rng)));
+   std::vector<std::pair<double,double>> rest;
+   for(size_t i=1; i<ncircles; i++) rest.push_back(std::make_pair(u(rng),u(rng)));
+   size = ncircles;
+
+   clipper_boolean csg;
+   csg.compute(circles_profile(first,r),ClipperLib::ctUnion);
+   std::shared_ptr<clipper_profile> b = circles_profile(rest,r);
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   csg.compute(b,ClipperLib::ctUnion);
+   return elapsed(t0);
+}
+
+double micro_bench::time_export(size_t nseg, size_t& size)
+{
+   carve_boolean csg;
+   csg.compute(primitives3d::make_sphere(10.0,static_cast<int>(nseg))->create_carve_mesh(),carve::csg::CSG::UNION);
+   std::shared_ptr<triangle_mesh::mesh_vector> lumps(new triangle_mesh::mesh_vector(1,csg.create_triangle_mesh(0,false,false)));
+   size = (*lumps)[0]->ntriangles();
+
+   boost::filesystem::path path = boost::filesystem::temp_directory_path() / "xcsg_microbench.xcsg";
+   out_triangles exporter(lumps);
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   std::string written = exporter.write_stl(path.string(),true);
+   double sec = elapsed(t0);
+   boost::filesystem::remove(written);
+   return sec;
+}
+
+double micro_bench::time_pool(size_t ntasks, size_t& size)
+{
+   // independent sphere unions on the thread pool. The spheres are created in the tasks,
+   // so their memory is placed by the worker running the boolean, as in a CSG tree
+   const double r = 10.0;
+   const int nseg = 32;
+   std::atomic<size_t> nface(0);
+   boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+   task_group tasks;
+   for(size_t itask=0; itask<ntasks; itask++) {
+      tasks.run([r,nseg,&nface]() {
+         std::shared_ptr<carve::mesh::MeshSet<3>> a = primitives3d::make_sphere(r,nseg)->create_carve_mesh();
+         std::shared_ptr<carve::mesh::MeshSet<3>> b = primitives3d::make_sphere(r,nseg,carve::math::Matrix::TRANS(0.5*r,0.3*r,0.2*r))->create_carve_mesh();
+         nface += nfaces(a.get()) + nfaces(b.get());
+         carve_boolean csg;
+         csg.compute(a,carve::csg::CSG::UNION);
+         csg.compute(b,carve::csg::CSG::UNION);
+      });
+   }
+   tasks.wait();
+   double sec = elapsed(t0);
+   size = nface;
+   return sec;
+}
@@ -0,0 +1,66 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+// micro_bench times single kernels on synthetic inputs of increasing size,
+// without parsing or the rest of the pipeline (--microbench). For each kernel the
+// median time per size is reported, and the exponent p of the fitted t ~ n^p,
+// so that a kernel turning quadratic shows up as a jump in p. Input creation is not timed.
+
+class micro_bench {
+public:
+   micro_bench(size_t repeat = 3);
+   virtual ~micro_bench();
+
+   // the kernel names: boolean, hull, tesselate, delaunay, clipper, export, pool
+   static const std::vector<std::string>& kernels();
+
+   // run the comma separated kernels, or "all". Progress is written to log and the report to json
+   void run(const std::string& kernels, std::ostream& log, std::ostream& json);
+
+private:
+   // one timed run of size parameter n, returns the elapsed seconds and the actual input size
+   typedef std::function<double(size_t n, size_t& size)> kernel;
+
+   struct point {
+      size_t size;
+      double sec;
+   };
+
+   std::vector<point> measure(const std::string& name, const std::vector<size_t>& params, const kernel& k, std::ostream& log);
+
+   // slope of log(sec) against log(size), by least squares
+   static double exponent(const std::vector<point>& points);
+
+   static double time_boolean(size_t nseg, size_t& size);
+   static double time_hull(size_t npoints, size_t& size);
+   static double time_tesselate(size_t nholes, size_t& size);
+   static double time_delaunay(size_t npoints, size_t& size);
+   static double time_clipper(size_t ncircles, size_t& size);
+   static double time_export(size_t nseg, size_t& size);
+   static double time_pool(size_t ntasks, size_t& size);
+
+private:
+   size_t m_repeat;
+};
+
+#endif // MICRO_BENCH_H
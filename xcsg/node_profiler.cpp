@@ -0,0 +1,327 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "node_profiler.h"
+#include "mesh_memory.h"
+#include "thread_pool.h"
+#include <boost/thread.hpp>
+#include <sstream>
+#include <iomanip>
+
+static thread_local int current_node = -1;
+
+node_profiler::node_profiler()
+: m_enabled(false)
+{}
+
+node_profiler::~node_profiler()
+{}
+
+void node_profiler::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_nodes.clear();
+   m_stack.clear();
+}
+
+size_t node_profiler::begin_node(const std::string& tag)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   size_t inode = m_nodes.size();
+   m_nodes.push_back(node());
+   node& n = m_nodes.back();
+   n.tag  = tag;
+
+   if(m_stack.size() > 0) {
+      node& p  = m_nodes[m_stack.back()];
+      n.parent = static_cast<int>(m_stack.back());
+      n.path   = p.path + "/" + tag + "[" + std::to_string(++p.tag_count[tag]) + "]";
+      p.children.push_back(inode);
+   }
+   else {
+      n.path = "/xcsg/" + tag;
+   }
+   m_stack.push_back(inode);
+   return inode;
+}
+
+void node_profiler::end_node()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_stack.size() > 0) m_stack.pop_back();
+}
+
+int node_profiler::current()
+{
+   return current_node;
+}
+
+void node_profiler::set_current(int inode)
+{
+   current_node = inode;
+}
+
+std::string node_profiler::current_path() const
+{
+   int inode = current();
+   if(inode < 0) return "";
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(static_cast<size_t>(inode) >= m_nodes.size()) return "";
+   return m_nodes[inode].path;
+}
+
+size_t node_profiler::nfaces(const MeshSet* mesh)
+{
+   size_t nface = 0;
+   for(size_t i=0; i<mesh->meshes.size(); i++) nface += mesh->meshes[i]->faces.size();
+   return nface;
+}
+
+void node_profiler::add_mesh(size_t inode, double ms, const MeshSet* mesh)
+{
+   std::ostringstream thread;
+   thread << boost::this_thread::get_id();
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(inode >= m_nodes.size()) return;
+   node& n   = m_nodes[inode];
+   n.mesh_ms += ms;
+   n.thread  = thread.str();
+   if(mesh) {
+      n.vout = mesh->vertex_storage.size();
+      n.fout = nfaces(mesh);
+   }
+}
+
+void node_profiler::add_boolean(double ms, const MeshSet* a, const MeshSet* b, double post_ms)
+{
+   int inode = current();
+   if(inode < 0) return;
+
+   boolean_size size;
+   size.ms = ms;
+   size.va = a->vertex_storage.size();
+   size.fa = nfaces(a);
+   size.vb = b->vertex_storage.size();
+   size.fb = nfaces(b);
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(static_cast<size_t>(inode) >= m_nodes.size()) return;
+   node& n   = m_nodes[inode];
+   n.bool_ms += ms;
+   n.post_ms += post_ms;
+   n.nbool++;
+   n.vin += size.va + size.vb;
+   n.fin += size.fa + size.fb;
+   if(ms > n.slowest.ms) n.slowest = size;
+}
+
+void node_profiler::add_carve_phases(const carve_phases& phases)
+{
+   int inode = current();
+   if(inode < 0) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(static_cast<size_t>(inode) >= m_nodes.size()) return;
+   carve_phases& c = m_nodes[inode].carve;
+   c.intersect_ms += phases.intersect_ms;
+   c.loops_ms     += phases.loops_ms;
+   c.classify_ms  += phases.classify_ms;
+}
+
+void node_profiler::add_wait(double ms)
+{
+   int inode = current();
+   if(inode < 0) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(static_cast<size_t>(inode) >= m_nodes.size()) return;
+   m_nodes[inode].wait_ms += ms;
+}
+
+void node_profiler::add_estimate(size_t inode, size_t nbool, size_t faces, size_t bool_faces, size_t peak_faces)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(inode >= m_nodes.size()) return;
+   node& n = m_nodes[inode];
+   n.est_nbool      = nbool;
+   n.est_faces      = faces;
+   n.est_bool_faces = bool_faces;
+   n.est_peak_faces = peak_faces;
+}
+
+std::vector<int> node_profiler::top_nodes(std::vector<std::string>& paths) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   paths.clear();
+   std::vector<int> slot(m_nodes.size(),-1);
+
+   // nodes are registered in tree order, so parents get their slot before their children
+   for(size_t inode=0; inode<m_nodes.size(); inode++) {
+      const node& n = m_nodes[inode];
+      if(n.parent < 0 || m_nodes[n.parent].parent < 0) {
+         slot[inode] = static_cast<int>(paths.size());
+         paths.push_back(n.path);
+      }
+      else {
+         slot[inode] = slot[n.parent];
+      }
+   }
+   return slot;
+}
+
+void node_profiler::write_report(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << "...profile:   mesh[ms]   bool[ms]   wait[ms]  eff[%]  nbool   vert_in   face_in  vert_out  face_out  node" << std::endl;
+   for(size_t inode=0; inode<m_nodes.size(); inode++) {
+      if(m_nodes[inode].parent < 0) write_report(out,inode,0);
+   }
+
+   // the booleans broken into carve phases, only for nodes with booleans
+   bool booleans = false;
+   for(auto& n : m_nodes) booleans = booleans || (n.nbool > 0);
+   if(!booleans) return;
+   out << "...carve phases: intersect[ms] loops[ms] classify[ms]  post[ms]  slowest[ms]  vert_a  face_a  vert_b  face_b  node" << std::endl;
+   for(size_t inode=0; inode<m_nodes.size(); inode++) {
+      if(m_nodes[inode].parent < 0) write_phase_report(out,inode,0);
+   }
+}
+
+void node_profiler::write_report(std::ostream& out, size_t inode, size_t depth) const
+{
+   const node& n = m_nodes[inode];
+   out << "..." << std::fixed << std::setprecision(1)
+       << std::setw(19) << n.mesh_ms
+       << std::setw(11) << n.bool_ms
+       << std::setw(11) << n.wait_ms
+       << std::setw(8)  << 100*efficiency(inode)
+       << std::setw(7)  << n.nbool
+       << std::setw(10) << n.vin
+       << std::setw(10) << n.fin
+       << std::setw(10) << n.vout
+       << std::setw(10) << n.fout
+       << "  " << std::string(2*depth,' ') << n.tag << "  " << n.path << std::endl;
+   out.unsetf(std::ios_base::floatfield);
+   for(size_t ichild : n.children) write_report(out,ichild,depth+1);
+}
+
+void node_profiler::write_phase_report(std::ostream& out, size_t inode, size_t depth) const
+{
+   const node& n = m_nodes[inode];
+   if(n.nbool > 0) {
+      out << "..." << std::fixed << std::setprecision(1)
+          << std::setw(27) << n.carve.intersect_ms
+          << std::setw(10) << n.carve.loops_ms
+          << std::setw(13) << n.carve.classify_ms
+          << std::setw(10) << n.post_ms
+          << std::setw(13) << n.slowest.ms
+          << std::setw(8)  << n.slowest.va
+          << std::setw(8)  << n.slowest.fa
+          << std::setw(8)  << n.slowest.vb
+          << std::setw(8)  << n.slowest.fb
+          << "  " << std::string(2*depth,' ') << n.tag << "  " << n.path << std::endl;
+      out.unsetf(std::ios_base::floatfield);
+   }
+   for(size_t ichild : n.children) write_phase_report(out,ichild,depth+1);
+}
+
+void node_profiler::write_json(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << "[";
+   bool first = true;
+   for(size_t inode=0; inode<m_nodes.size(); inode++) {
+      if(m_nodes[inode].parent < 0) {
+         if(!first) out << ",";
+         out << std::endl;
+         write_json(out,inode,1);
+         first = false;
+      }
+   }
+   out << std::endl << "]" << std::endl;
+}
+
+void node_profiler::write_json(std::ostream& out, size_t inode, size_t depth) const
+{
+   const node& n = m_nodes[inode];
+   std::string indent(3*depth,' ');
+   out << indent << "{ \"tag\": \"" << n.tag << "\", \"path\": \"" << n.path << "\""
+       << ", \"mesh_ms\": " << n.mesh_ms << ", \"bool_ms\": " << n.bool_ms
+       << ", \"wait_ms\": " << n.wait_ms << ", \"efficiency\": " << efficiency(inode) << ", \"nbool\": " << n.nbool
+       << ", \"vert_in\": " << n.vin << ", \"face_in\": " << n.fin
+       << ", \"vert_out\": " << n.vout << ", \"face_out\": " << n.fout
+       << ", \"thread\": \"" << n.thread << "\""
+       << ", \"carve\": { \"intersect_ms\": " << n.carve.intersect_ms << ", \"loops_ms\": " << n.carve.loops_ms
+       << ", \"classify_ms\": " << n.carve.classify_ms << ", \"post_ms\": " << n.post_ms << " }"
+       << ", \"slowest_bool\": { \"ms\": " << n.slowest.ms << ", \"vert_a\": " << n.slowest.va << ", \"face_a\": " << n.slowest.fa
+       << ", \"vert_b\": " << n.slowest.vb << ", \"face_b\": " << n.slowest.fb << " }"
+       << ", \"children\": [";
+   for(size_t i=0; i<n.children.size(); i++) {
+      out << ((i>0)? "," : "") << std::endl;
+      write_json(out,n.children[i],depth+1);
+   }
+   if(n.children.size() > 0) out << std::endl << indent;
+   out << "] }";
+}
+
+double node_profiler::subtree_bool_ms(size_t inode) const
+{
+   const node& n = m_nodes[inode];
+   double ms = n.bool_ms;
+   for(size_t ichild : n.children) ms += subtree_bool_ms(ichild);
+   return ms;
+}
+
+double node_profiler::efficiency(size_t inode) const
+{
+   // the wall time of a node includes its children, so their booleans count as busy time
+   double capacity = m_nodes[inode].mesh_ms*thread_pool::singleton().nthreads();
+   return (capacity > 0.0)? subtree_bool_ms(inode)/capacity : 0.0;
+}
+
+void node_profiler::write_estimate_json(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << "[";
+   bool first = true;
+   for(size_t inode=0; inode<m_nodes.size(); inode++) {
+      if(m_nodes[inode].parent < 0) {
+         if(!first) out << ",";
+         out << std::endl;
+         write_estimate_json(out,inode,1);
+         first = false;
+      }
+   }
+   out << std::endl << "]" << std::endl;
+}
+
+void node_profiler::write_estimate_json(std::ostream& out, size_t inode, size_t depth) const
+{
+   const node& n = m_nodes[inode];
+   std::string indent(3*depth,' ');
+   out << indent << "{ \"tag\": \"" << n.tag << "\", \"path\": \"" << n.path << "\""
+       << ", \"nbool\": " << n.est_nbool << ", \"faces\": " << n.est_faces
+       << ", \"bool_faces\": " << n.est_bool_faces << ", \"peak_faces\": " << n.est_peak_faces
+       << ", \"peak_bytes\": " << mesh_memory::estimate(n.est_peak_faces)
+       << ", \"children\": [";
+   for(size_t i=0; i<n.children.size(); i++) {
+      out << ((i>0)? "," : "") << std::endl;
+      write_estimate_json(out,n.children[i],depth+1);
+   }
+   if(n.children.size() > 0) out << std::endl << indent;
+   out << "] }";
+}
@@ -0,0 +1,154 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef NODE_PROFILER_H
+#define NODE_PROFILER_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <carve/mesh.hpp>
+
+// node_profiler records, per CSG node, the time spent creating its mesh and in its
+// booleans, plus input/output mesh sizes and the thread that created the mesh.
+// Nodes are registered in tree order while the CSG tree is built (begin_node/end_node).
+// During evaluation each thread has a current node, booleans are charged to it.
+// task_group propagates the current node to the tasks it runs.
+// Carve booleans are also broken into carve's internal phases, see boolean_engine.cpp
+
+class node_profiler {
+public:
+   typedef carve::mesh::MeshSet<3> MeshSet;
+
+   // time in the internal phases of carve booleans
+   struct carve_phases {
+      carve_phases() : intersect_ms(0), loops_ms(0), classify_ms(0) {}
+      double intersect_ms;   // intersection candidates and intersection vertices
+      double loops_ms;       // edge division and face loops, until the first face is classified
+      double classify_ms;    // classification and collection of the result faces
+   };
+
+   // operand sizes of a single boolean
+   struct boolean_size {
+      boolean_size() : ms(0), va(0), fa(0), vb(0), fb(0) {}
+      double ms;
+      size_t va,fa;          // vertices and faces of operand a
+      size_t vb,fb;          // vertices and faces of operand b
+   };
+
+   struct node {
+      node() : parent(-1), mesh_ms(0), bool_ms(0), wait_ms(0), post_ms(0), nbool(0), vin(0), fin(0), vout(0), fout(0)
+             , est_nbool(0), est_faces(0), est_bool_faces(0), est_peak_faces(0) {}
+      std::string                  tag;
+      std::string                  path;       // position in the xml tree, e.g. /xcsg/union3d[1]/sphere[2]
+      int                          parent;
+      std::vector<size_t>          children;
+      std::map<std::string,size_t> tag_count;  // children per tag, for the path
+      double                       mesh_ms;    // wall time to create the mesh, including children
+      double                       bool_ms;    // time in booleans of this node, summed over threads
+      double                       wait_ms;    // time threads of this node waited for other threads, summed
+      double                       post_ms;    // part of bool_ms spent welding, simplifying and ordering results
+      carve_phases                 carve;      // part of bool_ms spent inside carve, summed over threads
+      boolean_size                 slowest;    // the slowest boolean of this node
+      size_t                       nbool;
+      size_t                       vin,fin;    // vertices and faces into the booleans
+      size_t                       vout,fout;  // vertices and faces of the resulting mesh
+      std::string                  thread;
+      size_t                       est_nbool;       // --estimate: booleans of the subtree
+      size_t                       est_faces;       // faces of the resulting mesh
+      size_t                       est_bool_faces;  // faces entering the booleans of the subtree
+      size_t                       est_peak_faces;  // faces of the meshes alive at the same time
+   };
+
+   // makes inode the current node of the calling thread while in scope
+   class scope {
+   public:
+      scope(int inode) : m_prev(current()) { set_current(inode); }
+      ~scope() { set_current(m_prev); }
+   private:
+      int m_prev;
+   };
+
+   static node_profiler& singleton()  { static node_profiler instance; return instance;  }
+
+   bool enabled() const { return m_enabled; }
+   void set_enabled(bool enabled) { m_enabled = enabled; }
+
+   // remove all nodes
+   void clear();
+
+   // register a node while building the tree, children are registered between begin_node and end_node
+   size_t begin_node(const std::string& tag);
+   void   end_node();
+
+   // current node of the calling thread, -1 if none
+   static int  current();
+   static void set_current(int inode);
+
+   // path of the current node of the calling thread, empty if none
+   std::string current_path() const;
+
+   // record the mesh created by a node
+   void add_mesh(size_t inode, double ms, const MeshSet* mesh);
+
+   // charge a boolean between a and b to the current node of the calling thread,
+   // post_ms is the part of ms spent after carve on the result
+   void add_boolean(double ms, const MeshSet* a, const MeshSet* b, double post_ms = 0.0);
+
+   // charge the phases of one carve CSG::compute to the current node of the calling thread
+   void add_carve_phases(const carve_phases& phases);
+
+   // charge time waited for other threads to the current node of the calling thread
+   void add_wait(double ms);
+
+   // record the estimate of a node, computed without booleans
+   void add_estimate(size_t inode, size_t nbool, size_t faces, size_t bool_faces, size_t peak_faces);
+
+   // per node the index in paths of its top node, i.e. a child of a root node.
+   // Root nodes have their own index, their booleans are charged to it
+   std::vector<int> top_nodes(std::vector<std::string>& paths) const;
+
+   // hierarchical text report and json file
+   void write_report(std::ostream& out) const;
+   void write_json(std::ostream& out) const;
+
+   // json file of the estimates, memory is estimated from the face counts
+   void write_estimate_json(std::ostream& out) const;
+
+protected:
+   node_profiler();
+   virtual ~node_profiler();
+
+   void write_report(std::ostream& out, size_t inode, size_t depth) const;
+   void write_phase_report(std::ostream& out, size_t inode, size_t depth) const;
+   void write_json(std::ostream& out, size_t inode, size_t depth) const;
+   void write_estimate_json(std::ostream& out, size_t inode, size_t depth) const;
+
+   // boolean time of the subtree, and parallel efficiency busy/(wall*nthreads) of a node
+   double subtree_bool_ms(size_t inode) const;
+   double efficiency(size_t inode) const;
+
+   static size_t nfaces(const MeshSet* mesh);
+
+private:
+   bool                m_enabled;
+   std::vector<node>   m_nodes;
+   std::vector<size_t> m_stack;   // nodes being built
+   mutable std::mutex  m_mutex;
+};
+
+#endif // NODE_PROFILER_H
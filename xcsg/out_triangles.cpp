@@ -14,38 +14,58 @@
 // EndLicense:
 
 #include "out_triangles.h"
-#include <carve/poly.hpp>
-#include <fstream>
+#include <functional>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
 #include "std_filename.h"
+#include "trace_writer.h"
+#include "thread_pool.h"
+#include "buffered_writer.h"
+#include "gzip_writer.h"
+#include "mesh_binary.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
-out_triangles::out_triangles(std::shared_ptr<poly_vector> polyset)
-: m_polyset(polyset)
+out_triangles::out_triangles(std::shared_ptr<mesh_vector> meshes)
+: m_meshes(meshes)
 {}
 
 out_triangles::~out_triangles()
 {}
 
-static double face_area(std::vector<carve::geom::vector<3>>& p)
-{
-   // https://en.wikipedia.org/wiki/Heron's_formula
-   double a = (p[1] - p[0]).length();
-   double b = (p[2] - p[1]).length();
-   double c = (p[0] - p[2]).length();
-   double s = 0.5*(a+b+c);
-   return sqrt(s*(s-a)*(s-b)*(s-c));
-}
-
 std::string out_triangles::write_stl(const std::string& xcsg_path, bool binary)
 {
+   trace_span span("write_stl","export");
    if(binary)return write_stl_binary(xcsg_path);
    else      return write_stl_ascii(xcsg_path);
 }
 
+// append coordinates with 16 significant digits, separated by sep
+static void append_xyz(std::string& text, const xvertex& vtx, char sep)
+{
+   buffered_writer::append_general(text,vtx.v[0],16);
+   text += sep;
+   buffered_writer::append_general(text,vtx.v[1],16);
+   text += sep;
+   buffered_writer::append_general(text,vtx.v[2],16);
+}
+
 std::string  out_triangles::write_csg(const std::string& xcsg_path)
 {
+   trace_span span("write_csg","export");
    boost::filesystem::path fullpath(xcsg_path);
    boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
    std::string path = csg_path.string() + ".csg";
@@ -53,163 +73,252 @@ std::string  out_triangles::write_csg(const std::string& xcsg_path)
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   std::ofstream out(path);
+   buffered_writer out;
+   out.open(path);
 
-   out << "// OpenSCAD file created by xcsg : " << path << std::endl;;
-   out << "union() {" << std::endl;
+   out << "// OpenSCAD file created by xcsg : " << path << '\n';
+   out << "union() {" << '\n';
 
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
+      for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
 
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+         const triangle_mesh* mesh = (*m_meshes)[imesh].get();
 
          out << "\tpolyhedron( ";
 
          // ========= points / vertices =================
          out << " points=[ ";
-         for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-            carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-            if(ivert > 0) out << ',';
-            out << '[' << std::setprecision(16) << vtx.v[0] << ',' << std::setprecision(16) << vtx.v[1] << ',' << std::setprecision(16) <<  vtx.v[2] << ']';
-         }
+         out.write_chunked(mesh->nvertices(),[mesh](size_t ivert, std::string& text) {
+            if(ivert > 0) text += ',';
+            text += '[';
+            append_xyz(text,mesh->vertex(ivert),',');
+            text += ']';
+         });
          out << "],";
 
          // ========= faces =================
          out << " faces=[ ";
-         for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-            carve::poly::Face<3>& face = poly->faces[iface];
-
-            size_t nvert = face.nVertices();
-            if(nvert != 3)throw std::logic_error("carve_triangulate:: detected non-triangular face after triangulation!");
-            if(iface > 0) out << ',';
-            out << '[';
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nvert; ivert++) {
-               if(ivert > 0) out << ',';
-               size_t index = poly->vertexToIndex(vloop[2-ivert]); // reverse vertex order in OpenSCAD
-               out << index;
+         out.write_chunked(mesh->ntriangles(),[mesh](size_t itri, std::string& text) {
+            const size_t* tri = mesh->triangle(itri);
+            if(itri > 0) text += ',';
+            text += '[';
+            for(size_t ivert=0; ivert<3; ivert++) {
+               if(ivert > 0) text += ',';
+               buffered_writer::append(text,tri[2-ivert]); // reverse vertex order in OpenSCAD
             }
-            out << ']';
-         }
+            text += ']';
+         });
          out << "] ";
 
-         out << ");" << std::endl;
+         out << ");" << '\n';
       }
 
-   out << "};" << std::endl;
+   out << "};" << '\n';
+   out.close();
 
-   m_files_written.insert(path);
+   add_file_written(path);
    return path;
 }
 
 
+bool out_triangles::m_gzip = false;
+size_t out_triangles::m_io_files = 8;
+
+// open out on path, or on path + ".gz" through gz with --compress gzip. Returns the path written
+static std::string open_output(buffered_writer& out, gzip_writer& gz, const std::string& path)
+{
+   std::string out_path = (out_triangles::gzip())? path + ".gz" : path;
+   bool ok = (out_triangles::gzip())? gz.open(out_path) && out.open(gz) : out.open(out_path);
+   if(!ok) throw std::logic_error("out_triangles: Failed to open: " + out_path);
+   return out_path;
+}
+
 std::string out_triangles::write_off(const std::string& xcsg_path)
 {
+   trace_span span("write_off","export");
    boost::filesystem::path fullpath(xcsg_path);
    boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
 
-   std::string path;
-
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-
-      std::ostringstream postfix;
-      if(ipoly > 0)postfix << '_' << ipoly;
-      postfix << ".off";
+   // one file per lump, up to io_files() of them written at the same time
+   const size_t nmesh = m_meshes->size();
+   std::vector<std::string> paths(nmesh);
+   std::atomic<size_t> next_mesh(0);
+   auto off_task = [this,&csg_path,&paths,&next_mesh,nmesh]() {
+      for(size_t imesh=next_mesh++; imesh<nmesh; imesh=next_mesh++) {
+         std::ostringstream postfix;
+         if(imesh > 0)postfix << '_' << imesh;
+         postfix << ".off";
+
+         std::string path = csg_path.string() + postfix.str();
+         std::replace(path.begin(),path.end(), '\\', '/');
+
+         buffered_writer out;
+         gzip_writer gz;
+         paths[imesh] = open_output(out,gz,path);
+         write_off(out,std::vector<const triangle_mesh*>(1,(*m_meshes)[imesh].get()));
+         out.close();
+         gz.close();
+      }
+   };
+   const size_t ntask = std::min(m_io_files,nmesh);
+   if(ntask <= 1) off_task();
+   else {
+      task_group off_tasks;
+      for(size_t itask=0; itask<ntask; itask++) off_tasks.run(off_task);
+      off_tasks.wait();
+   }
 
-      path = csg_path.string() + postfix.str();
-      std::replace(path.begin(),path.end(), '\\', '/');
+   // all lump files are exported or moved, the last one is reported
+   for(auto& path : paths) add_file_written(path);
+   return (nmesh > 0)? paths.back() : "";
+}
 
-      std::ofstream out(path);
+bool out_triangles::write_off(std::ostream& out)
+{
+   trace_span span("write_off","export");
+   buffered_writer writer;
+   if(!writer.open(out)) return false;
+   std::vector<const triangle_mesh*> meshes;
+   for(auto& mesh : *m_meshes) meshes.push_back(mesh.get());
+   write_off(writer,meshes);
+   writer.close();
+   return out.good();
+}
 
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+void out_triangles::write_off(buffered_writer& out, const std::vector<const triangle_mesh*>& meshes)
+{
+   size_t nvertices = 0, ntriangles = 0;
+   for(auto mesh : meshes) {
+      nvertices  += mesh->nvertices();
+      ntriangles += mesh->ntriangles();
+   }
 
-      out << "OFF " << std::endl;
+   out << "OFF " << '\n';
   // OFF comment line not supported by tetgen
   //    out << "# OFF file created by xcsg : " << path << std::endl;
-      out << poly->vertices.size() << ' ' << poly->faces.size() << " 0 " <<  std::endl;  // numedges always zero
+   out << nvertices << ' ' << ntriangles << " 0 " << '\n';  // numedges always zero
 
-      // ========= vertices =================
-      for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-         carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-         out << std::setprecision(16) << vtx.v[0] << ' ' << std::setprecision(16) << vtx.v[1] << ' ' << std::setprecision(16) <<  vtx.v[2] << std::endl;
-      }
+   // ========= vertices =================
+   for(auto mesh : meshes) {
+      out.write_chunked(mesh->nvertices(),[mesh](size_t ivert, std::string& text) {
+         append_xyz(text,mesh->vertex(ivert),' ');
+         text += '\n';
+      });
+   }
 
-      // ========= faces =================
-      for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-         carve::poly::Face<3>& face = poly->faces[iface];
-
-         size_t nvert = face.nVertices();
-         std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-         poly->faces[iface].getVertexLoop(vloop);
-         out << nvert << ' ';
-         for(size_t ivert=0; ivert<nvert; ivert++) {
-            size_t index = poly->vertexToIndex(vloop[ivert]);
-            out << index << ' ';
+   // ========= faces =================
+   size_t vertex_offset = 0;
+   for(auto mesh : meshes) {
+      out.write_chunked(mesh->ntriangles(),[mesh,vertex_offset](size_t itri, std::string& text) {
+         const size_t* tri = mesh->triangle(itri);
+         text += "3 ";
+         for(size_t ivert=0; ivert<3; ivert++) {
+            buffered_writer::append(text,vertex_offset + tri[ivert]);
+            text += ' ';
          }
-         out << std::endl;
-      }
+         text += '\n';
+      });
+      vertex_offset += mesh->nvertices();
    }
-
-   m_files_written.insert(path);
-   return path;
 }
 
 
 std::string out_triangles::write_obj(const std::string& xcsg_path)
 {
+   trace_span span("write_obj","export");
    boost::filesystem::path fullpath(xcsg_path);
    boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
    std::string path = csg_path.string() + ".obj";
    std::replace(path.begin(),path.end(), '\\', '/');
-   std::ofstream out(path);
-   std::string object_id = fullpath.stem().string();
-
-   out << "# OBJ file created by xcsg : " << path << std::endl;
-   out  << "o " << object_id << std::endl;
+   buffered_writer out;
+   gzip_writer gz;
+   std::string title = path;
+   path = open_output(out,gz,path);
+   write_obj(out,title,fullpath.stem().string());
+   out.close();
+   gz.close();
+
+   add_file_written(path);
+   return path;
+}
 
-   // ========= vertices =================
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
+bool out_triangles::write_obj(std::ostream& out, const std::string& object_id)
+{
+   trace_span span("write_obj","export");
+   buffered_writer writer;
+   if(!writer.open(out)) return false;
+   write_obj(writer,object_id,object_id);
+   writer.close();
+   return out.good();
+}
 
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+static void write_obj_vertices(buffered_writer& out, const triangle_mesh* mesh)
+{
+   out.write_chunked(mesh->nvertices(),[mesh](size_t ivert, std::string& text) {
+      text += "v ";
+      append_xyz(text,mesh->vertex(ivert),' ');
+      text += '\n';
+   });
+}
 
-      for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-         carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-         out << "v " << std::setprecision(16) << vtx.v[0] << ' ' << std::setprecision(16) << vtx.v[1] << ' ' << std::setprecision(16) <<  vtx.v[2] << std::endl;
+static void write_obj_faces(buffered_writer& out, const triangle_mesh* mesh, size_t vertex_offset)
+{
+   out.write_chunked(mesh->ntriangles(),[mesh,vertex_offset](size_t itri, std::string& text) {
+      const size_t* tri = mesh->triangle(itri);
+      text += "f ";
+      for(size_t ivert=0; ivert<3; ivert++) {
+
+         // indices are 1-based in OBJ
+         buffered_writer::append(text,vertex_offset + 1+tri[ivert]);
+         text += ' ';
       }
+      text += '\n';
+   });
+}
+
+void out_triangles::write_obj(buffered_writer& out, const std::string& title, const std::string& object_id)
+{
+   out << "# OBJ file created by xcsg : " << title << '\n';
+   out  << "o " << object_id << '\n';
+
+   // ========= vertices =================
+   for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
+      write_obj_vertices(out,(*m_meshes)[imesh].get());
    }
 
    // ========= faces =================
    size_t vertex_offset = 0;
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+   for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
+      const triangle_mesh* mesh = (*m_meshes)[imesh].get();
+      write_obj_faces(out,mesh,vertex_offset);
+      vertex_offset += mesh->nvertices();
+   }
+}
 
-      for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-         carve::poly::Face<3>& face = poly->faces[iface];
 
-         size_t nvert = face.nVertices();
-         std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-         poly->faces[iface].getVertexLoop(vloop);
-         out << "f ";
-         for(size_t ivert=0; ivert<nvert; ivert++) {
-            size_t index = poly->vertexToIndex(vloop[ivert]);
+std::string out_triangles::write_xmesh(const std::string& xcsg_path)
+{
+   trace_span span("write_xmesh","export");
+   boost::filesystem::path fullpath(xcsg_path);
+   boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = csg_path.string() + ".xmesh";
+   std::replace(path.begin(),path.end(), '\\', '/');
 
-            // indices are 1-based in OBJ
-            out << vertex_offset + 1+index << ' ';
-         }
-         out << std::endl;
-      }
+   // never compressed, the file is memory mapped when read
+   std::ofstream out(path,std::ios::binary);
+   if(!out.is_open()) throw std::logic_error("out_triangles::write_xmesh(...)  Failed to open: " + path);
+   if(!mesh_binary::write_triangles(out,*m_meshes)) throw std::logic_error("out_triangles::write_xmesh(...)  Failed to write: " + path);
+   out.close();
 
-      vertex_offset += vertices.size();
-   }
-   m_files_written.insert(path);
+   add_file_written(path);
    return path;
 }
 
+bool out_triangles::write_xmesh(std::ostream& out)
+{
+   trace_span span("write_xmesh","export");
+   return mesh_binary::write_triangles(out,*m_meshes);
+}
+
 
 std::string  out_triangles::write_stl_ascii(const std::string& file_path)
 {
@@ -219,66 +328,209 @@ std::string  out_triangles::write_stl_ascii(const std::string& file_path)
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   std::ofstream out(path);
-   if(out.is_open()) {
+   buffered_writer out;
+   gzip_writer gz;
+   path = open_output(out,gz,path);
+   write_stl_ascii(out);
+   out.close();
+   gz.close();
+   add_file_written(path);
+   return path;
+}
 
-      out << "solid xcsg " << std::endl;
+static void write_stl_ascii_facets(buffered_writer& out, const triangle_mesh* mesh)
+{
+   const float* normals = (mesh->ntriangles() > 0)? &mesh->normals()[0] : nullptr;
+   out.write_chunked(mesh->ntriangles(),[mesh,normals](size_t itri, std::string& text) {
+
+      typedef carve::geom::vector<3> vec3d;
+      const size_t* tri = mesh->triangle(itri);
+      const vec3d p[] = { mesh->vertex(tri[0]), mesh->vertex(tri[1]), mesh->vertex(tri[2]) };
+      const float* n = normals + 3*itri;
+
+      // facet normal does not require high precision, it is usually ignored, so we save some space instead
+      if(n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f) {
+         text += "facet normal ";
+         buffered_writer::append_general(text,n[0],8);
+         text += ' ';
+         buffered_writer::append_general(text,n[1],8);
+         text += ' ';
+         buffered_writer::append_general(text,n[2],8);
+         text += '\n';
+      }
+      else text += "facet normal 0 0 0\n";
 
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+      text += "\touter loop\n";
+      for(size_t iv=0;iv<3;iv++) {
+         text += "\t\tvertex ";
+         append_xyz(text,p[iv],' ');
+         text += '\n';
+      }
+      text += "\tendloop\n";
+      text += "endfacet\n";
+   });
+}
 
-         size_t nfaces = poly->faces.size();
-         for(size_t iface=0; iface< nfaces; iface++) {
+void out_triangles::write_stl_ascii(buffered_writer& out)
+{
+   out << "solid xcsg " << '\n';
+   for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
+      write_stl_ascii_facets(out,(*m_meshes)[imesh].get());
+   }
+   out << "endsolid" << '\n';
+}
 
-            size_t nv = poly->faces[iface].nVertices();
-            if(nv != 3)throw std::logic_error("out_triangles:: detected non-triangular face after triangulation!");
 
-            typedef carve::geom::vector<3> vec3d;
-            std::vector<vec3d> p;
-            p.reserve(3);
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nv; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vtx = vertices[index];
-               p.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
-            }
+// binary STL file layout: 80 byte header, triangle count, then one 50 byte record per triangle
+static const size_t stl_header_size = 84;
+static const size_t stl_record_size = 50;
+
+// triangles per encoding task, and size of the blocks written to file
+static const size_t stl_chunk_triangles = 1<<16;
+static const size_t stl_block_size      = 1<<20;
+
+// a range of triangles in one mesh, record is the index of the first triangle in the file.
+// The records are encoded from the compact float buffers of the mesh. Instances of
+// another lump are replicated here, from their translated vertices
+struct stl_chunk {
+   const triangle_mesh* instance;
+   const float* xyz;
+   const uint32_t* indices;
+   const float* normals;
+   size_t ifirst;
+   size_t ilast;
+   size_t record;
+};
+
+static std::vector<stl_chunk> stl_chunks(const out_triangles::mesh_vector& meshes)
+{
+   std::vector<stl_chunk> chunks;
+   size_t record = 0;
+   for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+      const triangle_mesh* mesh = meshes[imesh].get();
+      size_t ntri = mesh->ntriangles();
+      if(ntri == 0) continue;
+      const float* normals = &mesh->normals()[0];
+      const triangle_mesh::compact_buffers& compact = mesh->compact();
+      for(size_t ifirst=0; ifirst<ntri; ifirst+=stl_chunk_triangles) {
+         stl_chunk chunk = { (mesh->source())? mesh : nullptr, &compact.xyz[0], &compact.indices[0], normals, ifirst, std::min(ntri,ifirst+stl_chunk_triangles), record };
+         chunks.push_back(chunk);
+         record += chunk.ilast - ifirst;
+      }
+   }
+   return chunks;
+}
 
-            vec3d x = p[1] - p[0];
-            vec3d y = p[2] - p[0];
-            vec3d z = carve::geom::cross(x,y);
-            double len = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+// encode the triangles of a chunk as binary STL records into dest
+static void encode_stl_chunk(const stl_chunk& chunk, char* dest)
+{
+   for(size_t itri=chunk.ifirst; itri<chunk.ilast; itri++) {
+      const uint32_t* tri = chunk.indices + 3*itri;
+
+      // the facet normals are shared with the other exporters
+      float xyz[12];
+      std::memcpy(xyz,chunk.normals + 3*itri,3*sizeof(float));
+      if(chunk.instance) {
+         for(size_t iv=0;iv<3;iv++) {
+            const xvertex p = chunk.instance->vertex(tri[iv]);
+            for(size_t k=0;k<3;k++) xyz[3+3*iv+k] = static_cast<float>(p.v[k]);
+         }
+      }
+      else {
+         for(size_t iv=0;iv<3;iv++) std::memcpy(xyz+3+3*iv,chunk.xyz + 3*size_t(tri[iv]),3*sizeof(float));
+      }
+      std::memcpy(dest,xyz,sizeof(xyz));
 
-            // facet normal does not require high precision, it is usually ignored, so we save some space instead
-            if(len > 0) out << "facet normal "
-                            << std::setprecision(8) << z[0]/len << ' '
-                            << std::setprecision(8) << z[1]/len << ' '
-                            << std::setprecision(8) << z[2]/len << std::endl;
-            else        out << "facet normal 0 0 0" << std::endl;
+      // the attribute byte count value
+      uint16_t bcount = 0;
+      std::memcpy(dest+sizeof(xyz),&bcount,sizeof(bcount));
+      dest += stl_record_size;
+   }
+}
 
+// encode chunks [ibegin,iend) in parallel, base is the address of record number base_record
+static void encode_stl_chunks(const std::vector<stl_chunk>& chunks, size_t ibegin, size_t iend, char* base, size_t base_record)
+{
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),iend-ibegin);
+   if(ntask <= 1) {
+      for(size_t i=ibegin; i<iend; i++) encode_stl_chunk(chunks[i],base + (chunks[i].record-base_record)*stl_record_size);
+      return;
+   }
 
-            out << "\touter loop" << std::endl;
-            for(size_t iv=0;iv<nv;iv++) {
+   task_group tasks;
+   for(size_t i=ibegin; i<iend; i++) {
+      const stl_chunk* chunk = &chunks[i];
+      char* dest = base + (chunk->record-base_record)*stl_record_size;
+      tasks.run([chunk,dest]() { encode_stl_chunk(*chunk,dest); });
+   }
+   tasks.wait();
+}
 
-               out << "\t\tvertex "<< std::setprecision(16) << p[iv].x <<
-                               ' ' << std::setprecision(16) << p[iv].y <<
-                               ' ' << std::setprecision(16) << p[iv].z << std::endl;
-            }
-            out << "\tendloop" << std::endl;
-            out << "endfacet" << std::endl;
-         }
-      }
-      out << "endsolid" << std::endl;
+#ifndef _WIN32
+// write the whole file through a shared memory mapping, the records are encoded in place.
+// returns false if the mapping could not be established
+static bool write_stl_mmap(const std::string& path, const char* header, const std::vector<stl_chunk>& chunks, size_t nrecords)
+{
+   int fd = ::open(path.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+   if(fd < 0) return false;
+
+   const size_t size = stl_header_size + nrecords*stl_record_size;
+   if(::ftruncate(fd,static_cast<off_t>(size)) != 0) {
+      ::close(fd);
+      return false;
    }
-   else {
-      std::string message = "stl_io::write_ascii(...)  Failed to open: " + file_path;
-      throw std::logic_error(message);
+   void* map = ::mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+   if(map == MAP_FAILED) {
+      ::close(fd);
+      return false;
    }
-   m_files_written.insert(path);
-   return path;
+
+   char* base = static_cast<char*>(map);
+   std::memcpy(base,header,stl_header_size);
+   encode_stl_chunks(chunks,0,chunks.size(),base+stl_header_size,0);
+
+   bool ok = (::munmap(map,size) == 0);
+   ok = (::close(fd) == 0) && ok;
+   return ok;
 }
+#endif
 
+// the 84 byte header with the triangle count, returns the number of records
+static size_t stl_header(const std::vector<stl_chunk>& chunks, char* header)
+{
+   size_t nrecords = (chunks.size() > 0)? chunks.back().record + chunks.back().ilast - chunks.back().ifirst : 0;
+   for(size_t i=0; i<80; i++) header[i]=' ';
+   uint32_t ntri = static_cast<uint32_t>(nrecords);
+   std::memcpy(header+80,&ntri,sizeof(ntri));
+   return nrecords;
+}
+
+// the records are encoded in parallel into a buffer, a batch of chunks at a time, after header_size bytes of header.
+// Only whole blocks are passed to write until the end, the rest is carried over to the next batch
+static bool write_stl_blocks(const char* header, size_t header_size, const std::vector<stl_chunk>& chunks, const std::function<bool(const char*,size_t)>& write)
+{
+   const size_t nbatch = 2*thread_pool::singleton().nthreads();
+   std::vector<char> buffer(header,header+header_size);
+   size_t carry = header_size;
+   bool ok = true;
+   size_t ibegin = 0;
+   do {
+      size_t iend = std::min(chunks.size(),ibegin+nbatch);
+      size_t first_record = (ibegin < iend)? chunks[ibegin].record : 0;
+      size_t nbatch_records = (ibegin < iend)? chunks[iend-1].record + chunks[iend-1].ilast - chunks[iend-1].ifirst - first_record : 0;
+      buffer.resize(carry + nbatch_records*stl_record_size);
+      encode_stl_chunks(chunks,ibegin,iend,buffer.data()+carry,first_record);
+
+      size_t nwrite = (iend == chunks.size())? buffer.size() : (buffer.size()/stl_block_size)*stl_block_size;
+      if(nwrite > 0 && !write(buffer.data(),nwrite)) ok = false;
+      carry = buffer.size() - nwrite;
+      if(carry > 0) std::memmove(buffer.data(),buffer.data()+nwrite,carry);
+      ibegin = iend;
+   } while(ok && ibegin < chunks.size());
+   return ok;
+}
+
+bool out_triangles::m_stl_mmap = false;
 
 std::string  out_triangles::write_stl_binary(const std::string& file_path)
 {
@@ -289,79 +541,202 @@ std::string  out_triangles::write_stl_binary(const std::string& file_path)
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   if(FILE* stl = std::fopen(path.c_str(),"wb")) {
-
-      // write the header
-      const size_t blen=80;
-      char buffer[blen];
-      for(size_t i=0; i<blen; i++) buffer[i]=' ';
-      std::fwrite(buffer,sizeof(char),blen,stl);
-
-      // write number of triangles
-      uint32_t ntri=0;
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         ntri += static_cast<uint32_t>(poly->faces.size());
-      }
-      std::fwrite(&ntri,sizeof(uint32_t),1,stl);
-
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+   // the header and number of triangles
+   std::vector<stl_chunk> chunks = stl_chunks(*m_meshes);
+   char header[stl_header_size];
+   size_t nrecords = stl_header(chunks,header);
+
+   if(m_gzip) {
+      gzip_writer gz;
+      path += ".gz";
+      if(!gz.open(path)) throw std::logic_error("out_triangles::write_stl_binary(...)  Failed to open: " + path);
+      write_stl_blocks(header,stl_header_size,chunks,[&gz](const char* data, size_t n) { gz.write(data,n); return true; });
+      gz.close();
+      add_file_written(path);
+      return path;
+   }
 
-         size_t nfaces = poly->faces.size();
-         for(size_t iface=0; iface < nfaces; iface++) {
+#ifndef _WIN32
+   if(m_stl_mmap && write_stl_mmap(path,header,chunks,nrecords)) {
+      add_file_written(path);
+      return path;
+   }
+#else
+   (void)nrecords;
+#endif
 
-            size_t nv = poly->faces[iface].nVertices();
-            if(nv != 3)throw std::logic_error("out_triangles:: detected non-triangular face after triangulation!");
+   if(FILE* stl = std::fopen(path.c_str(),"wb")) {
 
-            typedef carve::geom::vector<3> vec3d;
-            std::vector<vec3d> p;
-            p.reserve(3);
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nv; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vtx = vertices[index];
-               p.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
-            }
+      bool ok = write_stl_blocks(header,stl_header_size,chunks,[stl](const char* data, size_t n) { return std::fwrite(data,1,n,stl) == n; });
+      if(std::fclose(stl) != 0) ok = false;
+      if(!ok) {
+         std::string message = "out_triangles::write_stl_binary(...)  Failed to write: " + path;
+         throw std::logic_error(message);
+      }
+   }
+   else {
+      std::string message = "out_triangles::write_stl_binary(...)  Failed to open: " + file_path;
+      throw std::logic_error(message);
+   }
+   add_file_written(path);
+   return path;
+}
 
-            // compute facet normal
-            vec3d x = p[1] - p[0];
-            vec3d y = p[2] - p[0];
-            vec3d z = carve::geom::cross(x,y);
-            double len = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+bool out_triangles::write_stl(std::ostream& out, bool binary)
+{
+   trace_span span("write_stl","export");
+   if(!binary) {
+      buffered_writer writer;
+      if(!writer.open(out)) return false;
+      write_stl_ascii(writer);
+      writer.close();
+      return out.good();
+   }
 
-            // we write regardless of area here, because we didn't check the areas when we computed the number of triangles
-            float xyz[] = {static_cast<float>(z[0]/len), static_cast<float>(z[1]/len),  static_cast<float>(z[2]/len) };
-            std::fwrite(xyz,sizeof(float),3,stl);
+   std::vector<stl_chunk> chunks = stl_chunks(*m_meshes);
+   char header[stl_header_size];
+   stl_header(chunks,header);
+   bool ok = write_stl_blocks(header,stl_header_size,chunks,[&out](const char* data, size_t n) {
+      out.write(data,static_cast<std::streamsize>(n));
+      return out.good();
+   });
+   out.flush();
+   return ok && out.good();
+}
 
-            for(size_t iv=0;iv<nv;iv++) {
-               float xyz[] = {static_cast<float>(p[iv].x), static_cast<float>(p[iv].y),  static_cast<float>(p[iv].z) };
-               std::fwrite(xyz,sizeof(float),3,stl);
-            }
+struct out_triangles::stream_files {
+   stream_files() : stl(nullptr), stl_ok(true), ntriangles(0), vertex_offset(0), next(0), writing(false) {}
+  ~stream_files() { if(stl) std::fclose(stl); }
+
+   buffered_writer stl_ascii;      // ascii STL
+   FILE*           stl;            // binary STL
+   bool            stl_ok;         // false after a failed binary write
+   std::string     stl_path;
+   size_t          ntriangles;     // binary STL records written, the count is patched into the header on close
+   buffered_writer obj;
+   std::string     obj_path;
+   size_t          vertex_offset;  // OBJ vertices written
+
+   std::mutex      mutex;          // protects pending, next and writing
+   std::map<size_t,std::shared_ptr<triangle_mesh>> pending;  // completed lumps waiting for their predecessors
+   size_t          next;           // index of the next lump to write
+   bool            writing;        // a thread is currently writing lumps
+};
+
+void out_triangles::stream_open(const std::string& xcsg_path, bool stl, bool binary, bool obj)
+{
+   m_stream.reset(new stream_files);
+   boost::filesystem::path fullpath(xcsg_path);
+   std::string base = (fullpath.parent_path() / fullpath.stem()).string();
+   std::replace(base.begin(),base.end(), '\\', '/');
+
+   if(stl) {
+      m_stream->stl_path = base + ".stl";
+      if(binary) {
+         m_stream->stl = std::fopen(m_stream->stl_path.c_str(),"wb");
+         if(!m_stream->stl) throw std::logic_error("out_triangles::stream_open(...)  Failed to open: " + m_stream->stl_path);
+         char header[stl_header_size];
+         stl_header(std::vector<stl_chunk>(),header);
+         if(std::fwrite(header,1,stl_header_size,m_stream->stl) != stl_header_size) m_stream->stl_ok = false;
+      }
+      else {
+         if(!m_stream->stl_ascii.open(m_stream->stl_path)) throw std::logic_error("out_triangles::stream_open(...)  Failed to open: " + m_stream->stl_path);
+         m_stream->stl_ascii << "solid xcsg " << '\n';
+      }
+   }
+   if(obj) {
+      m_stream->obj_path = base + ".obj";
+      if(!m_stream->obj.open(m_stream->obj_path)) throw std::logic_error("out_triangles::stream_open(...)  Failed to open: " + m_stream->obj_path);
+      m_stream->obj << "# OBJ file created by xcsg : " << m_stream->obj_path << '\n';
+      m_stream->obj << "o " << fullpath.stem().string() << '\n';
+   }
+}
 
-            // write the attribute byte count value
-            uint16_t bcount = 0;
-            std::fwrite(&bcount, sizeof(bcount), 1, stl);
-         }
+void out_triangles::stream_lump(size_t index, std::shared_ptr<triangle_mesh> lump)
+{
+   // the thread completing the next lump in order writes it and any waiting successors,
+   // other threads only leave their lump in pending
+   stream_files& files = *m_stream;
+   std::unique_lock<std::mutex> lock(files.mutex);
+   files.pending[index] = lump;
+   lump.reset();
+   if(files.writing) return;
+   files.writing = true;
+   try {
+      for(auto i=files.pending.find(files.next); i!=files.pending.end(); i=files.pending.find(files.next)) {
+         std::shared_ptr<triangle_mesh> mesh = i->second;
+         files.pending.erase(i);
+         files.next++;
+         lock.unlock();
+         stream_write(mesh);
+         mesh.reset();
+         lock.lock();
       }
+   }
+   catch(...) {
+      if(!lock.owns_lock()) lock.lock();
+      files.writing = false;
+      throw;
+   }
+   files.writing = false;
+}
 
-      std::fclose(stl);
+void out_triangles::stream_write(const std::shared_ptr<triangle_mesh>& lump)
+{
+   trace_span span("stream_lump","export");
+   stream_files& files = *m_stream;
+   if(files.stl) {
+      mesh_vector meshes(1,lump);
+      FILE* stl = files.stl;
+      if(!write_stl_blocks(nullptr,0,stl_chunks(meshes),[stl](const char* data, size_t n) { return std::fwrite(data,1,n,stl) == n; })) {
+         files.stl_ok = false;
+      }
+      files.ntriangles += lump->ntriangles();
    }
-   else {
-      std::string message = "out_triangles::write_stl_binary(...)  Failed to open: " + file_path;
-      throw std::logic_error(message);
+   else if(files.stl_ascii.is_open()) {
+      write_stl_ascii_facets(files.stl_ascii,lump.get());
+   }
+   if(files.obj.is_open()) {
+      write_obj_vertices(files.obj,lump.get());
+      write_obj_faces(files.obj,lump.get(),files.vertex_offset);
+      files.vertex_offset += lump->nvertices();
    }
-   m_files_written.insert(path);
-   return path;
 }
 
-std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
+std::vector<std::string> out_triangles::stream_close()
 {
-   namespace bfs = boost::filesystem;
+   std::vector<std::string> paths;
+   if(!m_stream) return paths;
+   std::unique_ptr<stream_files> files(std::move(m_stream));
+
+   if(files->obj.is_open()) {
+      files->obj.close();
+      add_file_written(files->obj_path);
+      paths.push_back(files->obj_path);
+   }
+
+   // STL is closed last, so it is the most recent updated format
+   if(files->stl) {
+      uint32_t ntri = static_cast<uint32_t>(files->ntriangles);
+      bool ok = files->stl_ok && std::fseek(files->stl,80,SEEK_SET) == 0 && std::fwrite(&ntri,1,sizeof(ntri),files->stl) == sizeof(ntri);
+      ok = (std::fclose(files->stl) == 0) && ok;
+      files->stl = nullptr;
+      if(!ok) throw std::logic_error("out_triangles::stream_close()  Failed to write: " + files->stl_path);
+      add_file_written(files->stl_path);
+      paths.push_back(files->stl_path);
+   }
+   else if(files->stl_ascii.is_open()) {
+      files->stl_ascii << "endsolid" << '\n';
+      files->stl_ascii.close();
+      add_file_written(files->stl_path);
+      paths.push_back(files->stl_path);
+   }
+   return paths;
+}
 
+// the directory part of dir_path, created if it does not exist
+static std::string target_directory(const std::string& dir_path)
+{
    std::string target_dir = dir_path;
 
    // if the input path contains a file name, extract only the directory path
@@ -374,6 +749,14 @@ std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
    if(!std_filename::Exists(target_dir)) {
       std_filename::create_directories(target_dir);
    }
+   return target_dir;
+}
+
+std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
+{
+   namespace bfs = boost::filesystem;
+
+   std::string target_dir = target_directory(dir_path);
 
    // traverse the files to be copied
    std::set<std::string> files_copied;
@@ -392,3 +775,26 @@ std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
 
    return std::move(files_copied);
 }
+
+std::set<std::string> out_triangles::move_to(const std::string& dir_path)
+{
+   namespace bfs = boost::filesystem;
+
+   std::string target_dir = target_directory(dir_path);
+
+   // a rename within the same file system replaces the target in one step
+   std::set<std::string> files_moved;
+   for(auto& file : m_files_written) {
+      std_filename source_file(file);
+      std_filename target_file(file);
+      target_file.SetPath(target_dir);
+      bfs::rename(source_file.GetFullPath(),target_file.GetFullPath());
+
+      std::string moved_path = target_file.GetFullPath();
+      std::replace(moved_path.begin(),moved_path.end(), '\\', '/');
+      files_moved.insert(moved_path);
+   }
+   m_files_written = files_moved;
+
+   return std::move(files_moved);
+}
@@ -18,15 +18,18 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <memory>
-#include <carve/csg.hpp>
+#include <mutex>
 #include <ostream>
+#include "triangle_mesh.h"
+class buffered_writer;
 
 class out_triangles {
 public:
-   typedef std::vector<std::shared_ptr<carve::poly::Polyhedron>> poly_vector;
+   typedef triangle_mesh::mesh_vector mesh_vector;
 
-   out_triangles(std::shared_ptr<poly_vector> polyset);
+   out_triangles(std::shared_ptr<mesh_vector> meshes);
    virtual ~out_triangles();
 
    // export to (formatted) STL, return the path to the file created
@@ -41,15 +44,58 @@ public:
    // input is full path to .xcsg file, OFF to be stored in same folder
    std::string  write_obj(const std::string& xcsg_path);
 
+   // export to the binary triangle form of mesh_binary, readable by polyhedron 'file' attributes.
+   // Return the path to the file created, input is full path to .xcsg file
+   std::string  write_xmesh(const std::string& xcsg_path);
+
+   // write to a caller supplied stream instead of a file, returns false on stream failure.
+   // The stream must be opened in binary mode for binary STL.
+   // OFF and OBJ combine all lumps into one mesh with shared vertex numbering
+   bool write_stl(std::ostream& out, bool binary);
+   bool write_off(std::ostream& out);
+   bool write_obj(std::ostream& out, const std::string& object_id = "xcsg");
+   bool write_xmesh(std::ostream& out);
+
    // export to OpenSCAD .csg
    std::string  write_csg(const std::string& xcsg_path);
 
-   // add additional path to written files
-   void add_file_written(const std::string& file_path) { m_files_written.insert(file_path); }
+   // streamed export of STL and OBJ files, the lumps are written as they become ready
+   // instead of being collected first. stream_open creates the files next to xcsg_path,
+   // stream_lump may be called from any thread in any lump order, each lump is appended
+   // in lump order and released once written. stream_close completes the files and returns
+   // their paths, OBJ before STL. Streamed OBJ lists the vertices and faces lump by lump.
+   // gzip and memory mapped STL are not streamed, see can_stream()
+   static bool can_stream() { return !m_gzip && !m_stl_mmap; }
+   void stream_open(const std::string& xcsg_path, bool stl, bool binary, bool obj);
+   void stream_lump(size_t index, std::shared_ptr<triangle_mesh> lump);
+   std::vector<std::string> stream_close();
+
+   // write binary STL through a memory mapped file instead of block writes (not on Windows)
+   static bool stl_mmap() { return m_stl_mmap; }
+   static void set_stl_mmap(bool stl_mmap) { m_stl_mmap = stl_mmap; }
+
+   // write STL, OBJ and OFF files gzip compressed, with ".gz" appended to the file names
+   static bool gzip() { return m_gzip; }
+   static void set_gzip(bool gzip) { m_gzip = gzip; }
+
+   // max number of per lump files written concurrently, as by write_off. Writes to network
+   // storage mostly wait for the file system, so several files are kept in flight
+   static size_t io_files() { return m_io_files; }
+   static void set_io_files(size_t io_files) { m_io_files = std::max(size_t(1),io_files); }
+
+   // add additional path to written files, the write_* functions may run concurrently
+   void add_file_written(const std::string& file_path)
+   {
+      std::lock_guard<std::mutex> lock(m_files_mutex);
+      m_files_written.insert(file_path);
+   }
 
    // copy all previously written files to target directory, return set of target files copied
    std::set<std::string> copy_to(const std::string& dir_path);
 
+   // rename all previously written files into target directory on the same file system, return set of target files
+   std::set<std::string> move_to(const std::string& dir_path);
+
 private:
    // write to ASCII STL, return the path to the file created
    // input is full path to file, file extension will be replaced to ".stl"
@@ -59,10 +105,26 @@ private:
    // input is full path to file, file extension will be replaced to ".stl"
    std::string  write_stl_binary(const std::string& file_path);
 
+   // format bodies shared by the file and stream variants
+   void write_stl_ascii(buffered_writer& out);
+
+   // append one lump to the open streamed files
+   void stream_write(const std::shared_ptr<triangle_mesh>& lump);
+   void write_off(buffered_writer& out, const std::vector<const triangle_mesh*>& meshes);
+   void write_obj(buffered_writer& out, const std::string& title, const std::string& object_id);
+
 private:
-   std::shared_ptr<poly_vector> m_polyset;
+   std::shared_ptr<mesh_vector> m_meshes;
 
    std::set<std::string> m_files_written;  // contains one entry per call to write_* functions
+   std::mutex            m_files_mutex;    // protects m_files_written
+
+   struct stream_files;
+   std::unique_ptr<stream_files> m_stream;   // streamed export state, see stream_open
+
+   static bool m_stl_mmap;
+   static bool m_gzip;
+   static size_t m_io_files;
 };
 
 #endif // OUT_TRIANGLES_H
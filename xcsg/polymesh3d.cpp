@@ -55,12 +55,12 @@ const xvertex& polymesh3d::vertex(size_t ivertex) const
    return m_vert[ivertex];
 }
 
-const polymesh3d::index_vector& polymesh3d::face(size_t iface) const
+index_span polymesh3d::face(size_t iface) const
 {
    return m_face[iface];
 }
 
-const polymesh3d::index_vector&  polymesh3d::contour(size_t icontour) const
+index_span polymesh3d::contour(size_t icontour) const
 {
    return m_contour[icontour];
 }
@@ -24,9 +24,6 @@
 class polymesh3d {
 public:
    typedef std::vector<xvertex>       vertex_vector;
-   typedef std::vector<size_t>        index_vector;    // a vector of indices into m_vert
-   typedef std::vector<index_vector>  face_vector;     // an index_vector per face
-   typedef std::vector<index_vector>  contour_vector;  // an index_vector per contour
 
    polymesh3d();
 
@@ -44,19 +41,19 @@ public:
    // return number of faces
    size_t nfaces() const;
 
-   // return vertex index vector for given face
-   const index_vector& face(size_t iface) const;
+   // return vertex indices for given face
+   index_span face(size_t iface) const;
 
    // return number of contours
    size_t ncontours() const;
 
-   // return vertex index vector for given contour
-   const index_vector& contour(size_t icontour) const;
+   // return vertex indices for given contour
+   index_span contour(size_t icontour) const;
 
 private:
    vertex_vector   m_vert;    // vertices
-   face_vector     m_face;    // faces    , each entry contains N indices into m_vert (not limited to 3)
-   contour_vector  m_contour; // contours , each entry contains N indices into m_vert
+   index_csr       m_face;    // faces    , each entry contains N indices into m_vert (not limited to 3)
+   index_csr       m_contour; // contours , each entry contains N indices into m_vert
 };
 
 #endif // POLYMESH3D_H
@@ -0,0 +1,132 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "primitive_cache.h"
+#include "primitives3d.h"
+#include "geodesic_sphere.h"
+#include "carve/mesh_simplify.hpp"
+
+static const double pi = 4.0*atan(1.0);
+
+// hash of the path coordinates in clipper units
+static size_t paths_hash(const ClipperLib::Paths& paths)
+{
+   size_t h = paths.size();
+   std::hash<ClipperLib::cInt> hc;
+   auto combine = [&h](size_t v) { h ^= v + 0x9e3779b9 + (h<<6) + (h>>2); };
+   for(const ClipperLib::Path& path : paths) {
+      combine(path.size());
+      for(const ClipperLib::IntPoint& p : path) {
+         combine(hc(p.X));
+         combine(hc(p.Y));
+      }
+   }
+   return h;
+}
+
+primitive_cache::primitive_cache()
+{}
+
+primitive_cache::~primitive_cache()
+{}
+
+std::shared_ptr<const geodesic_sphere> primitive_cache::geodesic(size_t idepth)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   auto i = m_geodesic.find(idepth);
+   if(i != m_geodesic.end()) return i->second;
+
+   std::shared_ptr<const geodesic_sphere> gsphere(new geodesic_sphere(idepth));
+   m_geodesic[idepth] = gsphere;
+   return gsphere;
+}
+
+primitive_cache::MeshSet_ptr primitive_cache::geodesic_mesh(size_t idepth)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   auto i = m_geodesic_mesh.find(idepth);
+   if(i != m_geodesic_mesh.end()) return i->second;
+
+   std::shared_ptr<const geodesic_sphere> gsphere = geodesic(idepth);
+   std::vector<xvertex> vertices(gsphere->vertices());
+   std::vector<size_t> face_offsets,face_indices;
+   gsphere->face_arrays(face_offsets,face_indices,false);
+
+   std::shared_ptr<xpolyhedron>  poly(new xpolyhedron(std::move(vertices),std::move(face_offsets),std::move(face_indices)));
+
+   MeshSet_ptr meshset = poly->create_carve_mesh();
+   m_geodesic_mesh[idepth] = meshset;
+   return meshset;
+}
+
+primitive_cache::MeshSet_ptr primitive_cache::unit_cylinder(size_t nseg)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   auto i = m_cylinder.find(nseg);
+   if(i != m_cylinder.end()) return i->second;
+
+   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(1.0,1.0,1.0,false,static_cast<int>(nseg));
+   MeshSet_ptr meshset = poly->create_carve_mesh();
+
+   carve::mesh::MeshSimplifier simplifier;
+   double min_normal_angle=(pi/180.)*1E-4;  // 1E-4 degrees
+   simplifier.mergeCoplanarFaces(meshset.get(),min_normal_angle);
+
+   m_cylinder[nseg] = meshset;
+   return meshset;
+}
+
+std::shared_ptr<const primitive_cache::circle> primitive_cache::unit_circle(size_t nseg)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   auto i = m_circle.find(nseg);
+   if(i != m_circle.end()) return i->second;
+
+   std::shared_ptr<circle> c(new circle);
+   c->reserve(nseg);
+   double dang = 2*pi/nseg;
+   for(size_t iseg=0; iseg<nseg; iseg++) {
+      double ang = iseg*dang;
+      c->push_back(std::make_pair(cos(ang),sin(ang)));
+   }
+   m_circle[nseg] = c;
+   return c;
+}
+
+std::shared_ptr<const polymesh2d> primitive_cache::profile_mesh(std::shared_ptr<clipper_profile> profile)
+{
+   // identical profiles have identical paths after cleaning, in the same clipper scale
+   profile->clean();
+   const ClipperLib::Paths& paths = profile->paths();
+   size_t key = paths_hash(paths);
+   {
+      std::lock_guard<std::recursive_mutex> lock(m_mutex);
+      auto range = m_profile_mesh.equal_range(key);
+      for(auto i=range.first; i!=range.second; i++) {
+         const profile_entry& entry = i->second;
+         if(entry.scale==TO_CLIPPER && entry.paths==paths) return entry.mesh;
+      }
+   }
+
+   // triangulate outside the lock, so different profiles may be triangulated concurrently
+   profile_entry entry;
+   entry.scale = TO_CLIPPER;
+   entry.paths = paths;
+   entry.mesh  = profile->mesh();
+
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   m_profile_mesh.insert(std::make_pair(key,entry));
+   return entry.mesh;
+}
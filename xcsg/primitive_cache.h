@@ -0,0 +1,74 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef PRIMITIVE_CACHE_H
+#define PRIMITIVE_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <carve/mesh.hpp>
+#include "clipper_csg/clipper_profile.h"
+class geodesic_sphere;
+
+// primitive_cache holds unit size tessellations of the curved primitives,
+// keyed on the tessellation parameter (recursion depth or number of segments).
+// Each is built once, instances are made by transforming a clone of the cached mesh.
+
+class primitive_cache {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+   typedef std::vector<std::pair<double,double>>    circle;   // (cos,sin) per segment
+
+   static primitive_cache& singleton()  { static primitive_cache instance; return instance;  }
+
+   // unit radius geodesic sphere topology for the recursion depth
+   std::shared_ptr<const geodesic_sphere> geodesic(size_t idepth);
+
+   // unit radius geodesic sphere mesh for the recursion depth
+   MeshSet_ptr geodesic_mesh(size_t idepth);
+
+   // cylinder with r=1, h=1 from z=0 to z=1. Coplanar faces are merged
+   MeshSet_ptr unit_cylinder(size_t nseg);
+
+   // unit circle coordinates with nseg segments
+   std::shared_ptr<const circle> unit_circle(size_t nseg);
+
+   // triangulation of a 2d profile, shared by all profiles with identical paths
+   std::shared_ptr<const polymesh2d> profile_mesh(std::shared_ptr<clipper_profile> profile);
+
+protected:
+   primitive_cache();
+   virtual ~primitive_cache();
+
+private:
+   // cached profile triangulation, the key is a hash of the paths
+   struct profile_entry {
+      ClipperLib::cInt                  scale;
+      ClipperLib::Paths                 paths;
+      std::shared_ptr<const polymesh2d> mesh;
+   };
+
+private:
+   std::map<size_t,std::shared_ptr<const geodesic_sphere>> m_geodesic;
+   std::map<size_t,MeshSet_ptr>                            m_geodesic_mesh;
+   std::map<size_t,MeshSet_ptr>                            m_cylinder;
+   std::map<size_t,std::shared_ptr<const circle>>          m_circle;
+   std::multimap<size_t,profile_entry>                     m_profile_mesh;
+   std::recursive_mutex                                    m_mutex;
+};
+
+#endif // PRIMITIVE_CACHE_H
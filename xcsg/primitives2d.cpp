@@ -30,11 +30,12 @@ std::shared_ptr<polygon2d> primitives2d::make_circle(double r, int nseg, const c
    if(nseg < 0) {
       nseg = 4;
       double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
          nseg += 2;
          alpha = 2*pi/nseg;
       }
    }
+   nseg = mesh_utils::limit_nseg(nseg);
    double dang = 2*pi/nseg;
 
    std::shared_ptr<polygon2d> polygon(new polygon2d());
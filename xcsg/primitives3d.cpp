@@ -15,6 +15,7 @@
 
 #include "primitives3d.h"
 #include "geodesic_sphere.h"
+#include "primitive_cache.h"
 using namespace std;
 
 static const double pi = 4.0*atan(1.0);
@@ -41,16 +42,16 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cuboid(double dx, double dy, do
    poly->f_reserve(6);
 
    // bottom
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  0.0,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  0.0,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  +dy,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  +dy,  0.0));
+   poly->v_add(carve::geom::VECTOR( 0.0,  0.0,  0.0));
+   poly->v_add(carve::geom::VECTOR( +dx,  0.0,  0.0));
+   poly->v_add(carve::geom::VECTOR( +dx,  +dy,  0.0));
+   poly->v_add(carve::geom::VECTOR( 0.0,  +dy,  0.0));
 
    // top
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  0.0,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  0.0,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  +dy,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  +dy,  +dz));
+   poly->v_add(carve::geom::VECTOR( 0.0,  0.0,  +dz));
+   poly->v_add(carve::geom::VECTOR( +dx,  0.0,  +dz));
+   poly->v_add(carve::geom::VECTOR( +dx,  +dy,  +dz));
+   poly->v_add(carve::geom::VECTOR( 0.0,  +dy,  +dz));
 
    // sides
    poly->f_add( xface(0, 1, 5, 4),reverse_face );
@@ -63,21 +64,14 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cuboid(double dx, double dy, do
    // bottom
    poly->f_add( xface(3 ,2 ,1 ,0),reverse_face );
 
+   poly->v_transform(tloc);
    return poly;
 }
 
 
 std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, double height, bool center, int nseg, const carve::math::Matrix& t)
 {
-   if(nseg < 0) {
-      double r = (r1 > r2)? r1 : r2;
-      nseg = 12;
-      double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance()) {
-         nseg += 2;
-         alpha = 2*pi/nseg;
-      }
-   }
+   if(nseg < 0) nseg = cone_nseg(r1,r2);
 
    bool reverse_face = mesh_utils::is_left_hand(t);
 
@@ -96,7 +90,8 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
    double z2 = (center)? +0.5*height : height;
    double z[] = {z1,z2};
 
-   double dang = 2*pi/nseg;
+   // unit circle coordinates are shared by all cones with the same nseg
+   std::shared_ptr<const primitive_cache::circle> circle = primitive_cache::singleton().unit_circle(nvc);
 
    std::shared_ptr<xpolyhedron> poly(new xpolyhedron());
    poly->v_reserve(nvert);
@@ -105,22 +100,19 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
    // vertices and faces at top & bottom
    for(size_t iz=0; iz<2; iz++) {
       // first vertex v0 is at center
-      size_t v0 = poly->v_add(t * carve::geom::VECTOR(0.0,0.0,z[iz]));
+      size_t v0 = poly->v_add(carve::geom::VECTOR(0.0,0.0,z[iz]));
 
       // then along circumfecence
       double r  = radius[iz];
-      double ang = 0.0;
       for(size_t ivc=0; ivc<nvc; ivc++) {
-         double x = r*cos(ang);
-         double y = r*sin(ang);
-         size_t v1 = poly->v_add(t * carve::geom::VECTOR(x,y,z[iz]));
+         double x = r*(*circle)[ivc].first;
+         double y = r*(*circle)[ivc].second;
+         size_t v1 = poly->v_add(carve::geom::VECTOR(x,y,z[iz]));
          size_t v2 = (ivc==(nvc-1))? v0+1:v1+1;
 
          // reverse bottom faces
          if(iz==0) poly->f_add( xface(v2,v1,v0),reverse_face);
          else      poly->f_add( xface(v0,v1,v2),reverse_face);
-
-         ang += dang;
       }
    }
 
@@ -133,6 +125,9 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
       size_t v3 = v0+1+nvc;
       poly->f_add( xface(v0,v1,v2,v3),reverse_face);
    }
+
+   // the vertices are built in local coordinates and transformed in one pass
+   poly->v_transform(t);
    return poly;
 }
 
@@ -144,11 +139,12 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    if(nseg < 0) {
       nseg = 4;
       double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
          nseg += 2;
          alpha = 2*pi/nseg;
       }
    }
+   nseg = mesh_utils::limit_nseg(nseg);
    bool reverse_face = mesh_utils::is_left_hand(t);
 
    double dang = 2*pi/nseg;
@@ -169,7 +165,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    poly->f_reserve(nface);
 
    // first vertex v0 is at south pole
-   poly->v_add(t * carve::geom::VECTOR(0.0,0.0,-r));
+   poly->v_add(carve::geom::VECTOR(0.0,0.0,-r));
 
    double ang_lat = -0.5*pi + dang;
    while(ang_lat < 0.5*pi) {
@@ -182,7 +178,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
          double ang_lon = ilong*dang;
          double x = r*cos(ang_lat)*cos(ang_lon);
          double y = r*cos(ang_lat)*sin(ang_lon);
-         size_t v0 = poly->v_add(t * carve::geom::VECTOR(x,y,z));
+         size_t v0 = poly->v_add(carve::geom::VECTOR(x,y,z));
 
          if(ang_lat+dang < 0.5*pi) {
             // add faces only as lomg as there wil be another vertex row
@@ -196,7 +192,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    }
 
    // last vertex is at north pole
-   size_t vnp =  poly->v_add(t * carve::geom::VECTOR(0.0,0.0,r));
+   size_t vnp =  poly->v_add(carve::geom::VECTOR(0.0,0.0,r));
 
    // pole faces
    for(size_t ilong=0; ilong<nlong; ilong++) {
@@ -214,6 +210,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
       poly->f_add( xface(v0,v1,v2),reverse_face);
    }
 
+   poly->v_transform(t);
    return poly;
 }
 
@@ -224,14 +221,106 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_geodesic_sphere(double r, int n
    // scale up the sphere
    carve::math::Matrix tloc = t * carve::math::Matrix::SCALE(r,r,r);
 
+   // the unit sphere for the recursion depth is built only once
+   std::shared_ptr<const geodesic_sphere> gsphere = primitive_cache::singleton().geodesic(geodesic_depth(r,nseg));
+
+   size_t nvert = gsphere->v_size();
+
+   // transform the flat vertex array in one pass, and hand the arrays over to the polyhedron
+   std::vector<xvertex> vertices(nvert);
+   mesh_utils::transform(tloc,&gsphere->vertices()[0],nvert,&vertices[0]);
+
+   std::vector<size_t> face_offsets,face_indices;
+   gsphere->face_arrays(face_offsets,face_indices,reverse_face);
+
+   return std::make_shared<xpolyhedron>(std::move(vertices),std::move(face_offsets),std::move(face_indices));
+}
+
+void primitives3d::cuboid_vertices(double dx, double dy, double dz, bool center_xy, bool center_z, const carve::math::Matrix& t, std::vector<xvertex>& vertices)
+{
+   double tdx = (center_xy)? -0.5*dx : 0.0;
+   double tdy = (center_xy)? -0.5*dy : 0.0;
+   double tdz = (center_z)?  -0.5*dz : 0.0;
+   carve::math::Matrix tloc = t * carve::math::Matrix::TRANS(tdx,tdy,tdz);
+
+   size_t ioff = vertices.size();
+   vertices.reserve(ioff+8);
+   for(size_t iz=0; iz<2; iz++) {
+      double z = (iz==0)? 0.0 : dz;
+      vertices.push_back(carve::geom::VECTOR( 0.0,  0.0,  z));
+      vertices.push_back(carve::geom::VECTOR( +dx,  0.0,  z));
+      vertices.push_back(carve::geom::VECTOR( +dx,  +dy,  z));
+      vertices.push_back(carve::geom::VECTOR( 0.0,  +dy,  z));
+   }
+   mesh_utils::transform(tloc,&vertices[ioff],8,&vertices[ioff]);
+}
+
+void primitives3d::cone_vertices(double r1, double r2, double height, bool center, int nseg, const carve::math::Matrix& t, std::vector<xvertex>& vertices)
+{
+   nseg = (nseg < 0)? cone_nseg(r1,r2) : mesh_utils::limit_nseg(nseg);
+   size_t nvc = nseg;
+
+   double radius[] = {r1,r2};
+   double z1 = (center)? -0.5*height : 0.0;
+   double z2 = (center)? +0.5*height : height;
+   double z[] = {z1,z2};
+
+   std::shared_ptr<const primitive_cache::circle> circle = primitive_cache::singleton().unit_circle(nvc);
+
+   size_t ioff = vertices.size();
+   vertices.reserve(ioff+2*nvc);
+   for(size_t iz=0; iz<2; iz++) {
+
+      // a zero radius end is a single apex vertex
+      double r  = radius[iz];
+      if(r == 0.0) {
+         vertices.push_back(carve::geom::VECTOR(0.0,0.0,z[iz]));
+         continue;
+      }
+
+      for(size_t ivc=0; ivc<nvc; ivc++) {
+         double x = r*(*circle)[ivc].first;
+         double y = r*(*circle)[ivc].second;
+         vertices.push_back(carve::geom::VECTOR(x,y,z[iz]));
+      }
+   }
+   mesh_utils::transform(t,&vertices[ioff],vertices.size()-ioff,&vertices[ioff]);
+}
+
+void primitives3d::geodesic_sphere_vertices(double r, int nseg, const carve::math::Matrix& t, std::vector<xvertex>& vertices)
+{
+   carve::math::Matrix tloc = t * carve::math::Matrix::SCALE(r,r,r);
+   std::shared_ptr<const geodesic_sphere> gsphere = primitive_cache::singleton().geodesic(geodesic_depth(r,nseg));
+
+   size_t nvert = gsphere->v_size();
+   size_t ioff  = vertices.size();
+   vertices.resize(ioff+nvert);
+   mesh_utils::transform(tloc,&gsphere->vertices()[0],nvert,&vertices[ioff]);
+}
+
+int primitives3d::cone_nseg(double r1, double r2)
+{
+   double r = (r1 > r2)? r1 : r2;
+   int nseg = 12;
+   double alpha = 2.0*pi/nseg;
+   while(r*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance(r)) {
+      nseg += 2;
+      alpha = 2*pi/nseg;
+   }
+   return mesh_utils::limit_nseg(nseg);
+}
+
+size_t primitives3d::geodesic_depth(double r, int nseg)
+{
    if(nseg < 0) {
       nseg = 6;
       double alpha = 2.0*pi/nseg;
-      while(1.1*r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+      while(1.1*r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
          nseg *= 2;
          alpha = 2*pi/nseg;
       }
    }
+   nseg = mesh_utils::limit_nseg(nseg);
 
    // approximate number of recursion levels from nseg
    size_t idepth = 0;
@@ -242,24 +331,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_geodesic_sphere(double r, int n
    if(nseg >  96)idepth = 4;
    if(nseg > 192)idepth = 5;
 
-
-   geodesic_sphere gsphere(idepth);
-
-   size_t nvert = gsphere.v_size();
-   size_t nface = gsphere.f_size();
-
-   std::shared_ptr<xpolyhedron>  poly(new xpolyhedron());
-   poly->v_reserve(nvert);
-   poly->f_reserve(nface);
-
-   for(size_t ivert=0;ivert<nvert; ivert++) {
-      poly->v_add(tloc* gsphere.v_get(ivert));
-   }
-   for(size_t iface=0;iface<nface; iface++) {
-      poly->f_add(gsphere.f_get(iface),reverse_face);
-   }
-
-   return poly;
+   return idepth;
 }
 
 std::shared_ptr<xpolyhedron> primitives3d::make_polygon(const std::vector<xvertex>& vertices, double dz, const carve::math::Matrix& t)
@@ -277,9 +349,10 @@ std::shared_ptr<xpolyhedron> primitives3d::make_polygon(const std::vector<xverte
    for(size_t i=0; i<2; i++) {
       for(size_t iv=0; iv<nvert; iv++) {
          xvertex vert = (i==0)? vertices[iv] : vertices[iv] + carve::geom::VECTOR(0.0,0.0,dz);
-         poly->v_add(t * vert);
+         poly->v_add(vert);
       }
    }
+   poly->v_transform(t);
 
    // top & bottom faces mentions all vertices in their relative layers, but in opposite orders
    std::vector<size_t> ind_bot(nvert);
@@ -306,3 +379,12 @@ std::shared_ptr<xpolyhedron> primitives3d::make_polygon(const std::vector<xverte
    return poly;
 }
 
+size_t primitives3d::cone_faces(double r1, double r2)
+{
+   return 3*static_cast<size_t>(cone_nseg(r1,r2));
+}
+
+size_t primitives3d::geodesic_sphere_faces(double r, int nseg)
+{
+   return primitive_cache::singleton().geodesic(geodesic_depth(r,nseg))->f_size();
+}
@@ -41,6 +41,22 @@ public:
    // polyhedron from polygon
    static std::shared_ptr<xpolyhedron> make_polygon(const std::vector<xvertex>& vertices, double dz, const carve::math::Matrix& t = carve::math::Matrix());
 
+   // vertex clouds of the convex primitives, the same vertices as the make_* functions without faces.
+   // Cap centres are omitted since they are not on the convex hull
+   static void cuboid_vertices(double dx, double dy, double dz, bool center_xy, bool center_z, const carve::math::Matrix& t, std::vector<xvertex>& vertices);
+   static void cone_vertices(double r1, double r2, double height, bool center, int nseg, const carve::math::Matrix& t, std::vector<xvertex>& vertices);
+   static void geodesic_sphere_vertices(double r, int nseg, const carve::math::Matrix& t, std::vector<xvertex>& vertices);
+
+   // adaptive number of segments along the circumference of a cone, from the secant tolerance
+   static int cone_nseg(double r1, double r2);
+
+   // geodesic sphere recursion depth, nseg<0 means adaptive from the secant tolerance
+   static size_t geodesic_depth(double r, int nseg);
+
+   // number of faces of the adaptive cone and the geodesic sphere, without creating them
+   static size_t cone_faces(double r1, double r2);
+   static size_t geodesic_sphere_faces(double r, int nseg);
+
 };
 
 #endif // PRIMITIVES3D_H
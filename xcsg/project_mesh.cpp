@@ -21,92 +21,115 @@
 
 #include <carve/poly.hpp>
 #include "carve_boolean.h"
-#include "carve_triangulate.h"
+#include "triangle_mesh.h"
 
 #include "clipper_boolean.h"
-#include "xpolyhedron.h"
+
+#include "thread_pool.h"
 
 #include <iostream>
+#include <atomic>
+#include <unordered_map>
 using namespace std;
 
-std::shared_ptr<clipper_profile> project_mesh::project(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
+// silhouette loops of a triangle mesh projected to the XY plane.
+// The boundaries of the upward facing (CCW) triangles cancel along edges shared by two such triangles,
+// so the remaining silhouette edges enclose each point once for every upward triangle covering it.
+// The loops filled with non-zero winding therefore equal the union of the upward triangles
+static std::shared_ptr<clipper_profile> silhouette_profile(const triangle_mesh& tmesh, size_t& nup)
 {
-   clipper_boolean csg_clipper;
-
-   carve_boolean csg_carve;
-   csg_carve.compute(meshset,carve::csg::CSG::OP::UNION);
-   size_t nmani = csg_carve.size();
-
-   size_t npoly = 0;
-
-   // The mesh may contain non-triangular faces, so we must triangulate into polyhedra
-   for(size_t imani=0; imani<nmani; imani++) {
-
-      cout << "manifold " << imani << " of " << nmani << endl;
-
-      // create polyset with triangles from manifold
-      carve_triangulate triangulate;
-      std::shared_ptr<xpolyhedron> poly = csg_carve.create_manifold(imani);
-
-      size_t num_non_tri = 0;
-      poly->check_polyhedron(cout,num_non_tri);
-
-      if(num_non_tri > 0) {
-         cout << "...Triangulating lump ... " << std::endl;
-         cout << "...Triangulation completed with " << triangulate.compute2d(poly->create_carve_polyhedron())<< " triangle faces " << endl;;
-      }
-      else {
-         // triangulation not required
-         triangulate.add(poly->create_carve_polyhedron());
+   // net count of upward triangle edges per undirected edge, positive from lower to higher vertex index
+   std::unordered_map<uint64_t,int> net;
+   nup = 0;
+   for(size_t itri=0; itri<tmesh.ntriangles(); itri++) {
+      const size_t* tri = tmesh.triangle(itri);
+      const xvertex& p0 = tmesh.vertex(tri[0]);
+      const xvertex& p1 = tmesh.vertex(tri[1]);
+      const xvertex& p2 = tmesh.vertex(tri[2]);
+
+      // triangles perpendicular to the XY plane or facing down are hidden by the upward ones
+      double signed_area = (p1.x-p0.x)*(p2.y-p0.y) - (p2.x-p0.x)*(p1.y-p0.y);
+      if(signed_area <= 0.0) continue;
+      nup++;
+
+      for(size_t ivert=0; ivert<3; ivert++) {
+         uint64_t a = tri[ivert];
+         uint64_t b = tri[(ivert+1)%3];
+         if(a < b) net[(a<<32)|b]++;
+         else      net[(b<<32)|a]--;
       }
+   }
 
-      cout << "...Computing projection" << std::endl;
-
-      // extract triangle faces
-      std::shared_ptr<carve_triangulate::poly_vector>  polyset = triangulate.carve_polyset();
-      for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
-
-         for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-
-            // coordinates of face to be stored in this vector
-            std::vector<xvertex> face_coords;
-
-            carve::poly::Face<3>& face = poly->faces[iface];
-            size_t nvert = face.nVertices();
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            face.getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nvert; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vertex = vertices[index];
-               face_coords.push_back(vertex.v);
-            }
-
-            // we now have the triangle face coordinates.
-            std::shared_ptr<polygon2d> polygon = primitives2d::make_polygon(face_coords);
+   // directed silhouette edges by start vertex
+   std::unordered_multimap<size_t,size_t> edges;
+   for(auto& e : net) {
+      size_t lo = static_cast<size_t>(e.first >> 32);
+      size_t hi = static_cast<size_t>(e.first & 0xffffffffULL);
+      for(int i=0; i<e.second; i++)  edges.insert(std::make_pair(lo,hi));
+      for(int i=0; i>e.second; i--)  edges.insert(std::make_pair(hi,lo));
+   }
 
-            // here, there is always just a single contour
-            std::shared_ptr<contour2d> cont = polygon->get_contour(0);
+   // every vertex has as many incoming as outgoing silhouette edges, so walking the edges closes loops.
+   // How the loops are paired at shared vertices does not change the winding numbers
+   std::shared_ptr<polygon2d> loops(new polygon2d());
+   while(edges.size() > 0) {
+      std::shared_ptr<contour2d> contour(new contour2d());
+      size_t istart = edges.begin()->first;
+      size_t ivert  = istart;
+      do {
+         const xvertex& v = tmesh.vertex(ivert);
+         contour->push_back(dpos2d(v.x,v.y));
+         auto it = edges.find(ivert);
+         if(it == edges.end()) break;
+         ivert = it->second;
+         edges.erase(it);
+      } while(ivert != istart);
+      if(contour->size() > 2) loops->push_back(contour);
+   }
 
-            // skip any triangles with zero area, i.e. face was perpendicular to XY plane.
-            // we also consider only triangles with positive winding order. The ones with negative winding
-            // are always hidden by those with positive winding order (CCW) and can safely be ignored
-            double signed_area = cont->signed_area();
-            if(signed_area > 0.0) {
+   // the loops may cross each other, one non-zero union resolves them into the lump outline
+   ClipperLib::Clipper clipper;
+   clipper.AddPaths(*loops->paths(),ClipperLib::ptSubject,true);
+   std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+   if(!clipper.Execute(ClipperLib::ctUnion, profile->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero)) {
+      throw std::logic_error("project_mesh: silhouette union failed");
+   }
+   profile->set_dirty();
+   return profile;
+}
 
-               // turn triangle into a clipper profile and add its paths to the projection (a single path)
-               std::shared_ptr<clipper_profile> poly_prof = std::make_shared<clipper_profile>();
-               poly_prof->AddPaths(polygon->paths());
-               csg_clipper.compute(poly_prof,ClipperLib::ctUnion);
+std::shared_ptr<clipper_profile> project_mesh::project(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
+{
+   carve_boolean csg_carve;
+   csg_carve.compute(meshset,carve::csg::CSG::OP::UNION);
+   size_t nmani = csg_carve.size();
 
-               npoly++;
-            }
-         }
+   // The mesh may contain non-triangular faces, the triangle mesh of each lump is triangulated.
+   // The silhouettes of the lumps are found in parallel
+   cout << "...Computing projection of " << nmani << " lumps" << std::endl;
+   clipper_boolean::profile_vector lumps(nmani);
+   std::vector<size_t> nup(nmani,0);
+   std::atomic<size_t> next_lump(0);
+   auto lump_task = [&csg_carve,&lumps,&nup,&next_lump,nmani]() {
+      for(size_t imani=next_lump++; imani<nmani; imani=next_lump++) {
+         std::shared_ptr<triangle_mesh> tmesh = csg_carve.create_triangle_mesh(imani,false,true);
+         lumps[imani] = silhouette_profile(*tmesh,nup[imani]);
       }
+   };
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),nmani);
+   if(ntask <= 1) lump_task();
+   else {
+      task_group lump_tasks;
+      for(size_t itask=0; itask<ntask; itask++) lump_tasks.run(lump_task);
+      lump_tasks.wait();
    }
 
+   // the lump outlines are unioned in one operation, reduced as a tree when there are many
+   clipper_boolean csg_clipper;
+   csg_clipper.compute_union(lumps);
+
+   size_t npoly = 0;
+   for(auto n : nup) npoly += n;
    cout << "...Projection computed from " << npoly << " triangles." << endl;
 
    // make sure paths are sorted with positive path first
@@ -0,0 +1,248 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "remote_farm.h"
+#include "mesh_binary.h"
+#include "xml_hash.h"
+#include "xcsg_factory.h"
+#include "json_log.h"
+#include "csg_parser/cf_xmlNode.h"
+
+#include <sstream>
+#include <cstring>
+#include <boost/asio.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/algorithm/string.hpp>
+
+static const char     job_magic[8] = { 'X','C','S','G','J','O','B','1' };
+static const uint64_t max_message  = 1ULL << 32;
+
+template <typename T>
+static bool read_value(std::istream& in, T& value)
+{
+   in.read(reinterpret_cast<char*>(&value),sizeof(T));
+   return in.good();
+}
+
+template <typename T>
+static void write_value(std::ostream& out, const T& value)
+{
+   out.write(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+static bool write_string(std::ostream& out, const std::string& s)
+{
+   write_value(out,static_cast<uint64_t>(s.length()));
+   out.write(s.data(),s.length());
+   return out.good();
+}
+
+static bool read_string(std::istream& in, std::string& s)
+{
+   uint64_t length = 0;
+   if(!read_value(in,length) || length > max_message) return false;
+   s.resize(static_cast<size_t>(length));
+   if(length > 0) in.read(&s[0],s.length());
+   return in.good();
+}
+
+struct remote_farm::worker {
+   worker(const std::string& h, const std::string& p) : host(h), port(p), busy(false), failed(false) {}
+
+   std::string host;
+   std::string port;
+   bool        busy;
+   bool        failed;
+   std::unique_ptr<boost::asio::ip::tcp::iostream> stream;  // connected on first use
+};
+
+remote_farm::remote_farm()
+{}
+
+remote_farm::~remote_farm()
+{}
+
+void remote_farm::set_workers(const std::string& workers)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_workers.clear();
+   if(workers.length() == 0) return;
+   std::vector<std::string> tokens;
+   boost::split(tokens,workers,boost::is_any_of(","));
+   for(auto& token : tokens) {
+      boost::trim(token);
+      size_t ipos = token.rfind(':');
+      if(ipos == std::string::npos || ipos == 0 || ipos+1 == token.length()) {
+         throw std::runtime_error("invalid worker '" + token + "', expected host:port");
+      }
+      m_workers.push_back(std::make_shared<worker>(token.substr(0,ipos),token.substr(ipos+1)));
+   }
+}
+
+bool remote_farm::self_contained(const std::string& tag, const boost::property_tree::ptree& pt)
+{
+   // definitions and bulk data files are not available to the workers
+   if(tag == "instance") return false;
+   if(pt.get<std::string>("<xmlattr>.file","").length() > 0) return false;
+   for(auto i=pt.begin(); i!=pt.end(); i++) {
+      if(i->first != "<xmlattr>" && !self_contained(i->first,i->second)) return false;
+   }
+   return true;
+}
+
+void remote_farm::select(cf_xmlNode& object)
+{
+   clear();
+   if(!enabled()) return;
+   if(object.tag() != "union3d" && object.tag() != "difference3d") return;
+
+   for(auto i=object.begin(); i!=object.end(); i++) {
+      cf_xmlNode child(i);
+      if(child.is_attribute_node() || !xcsg_factory::singleton().is_solid(child)) continue;
+      if(!self_contained(i->first,i->second)) continue;
+
+      // the fragment is the geometry in local coordinates, the transform is sent with the job
+      boost::property_tree::ptree local = i->second;
+      local.erase("tmatrix");
+      boost::property_tree::ptree doc;
+      doc.add_child(i->first,local);
+      std::ostringstream out;
+      boost::property_tree::write_xml(out,doc);
+      m_fragments[xml_hash::local_hash(i->first,i->second)] = out.str();
+   }
+}
+
+void remote_farm::clear()
+{
+   m_fragments.clear();
+}
+
+bool remote_farm::selected(const cf_xmlNode& node, std::string& fragment) const
+{
+   if(m_fragments.size() == 0) return false;
+   auto it = m_fragments.find(xml_hash::local_hash(node));
+   if(it == m_fragments.end()) return false;
+   fragment = it->second;
+   return true;
+}
+
+std::shared_ptr<remote_farm::worker> remote_farm::acquire()
+{
+   // a worker runs one job at a time on all its cores
+   std::unique_lock<std::mutex> lock(m_mutex);
+   for(;;) {
+      bool alive = false;
+      for(auto& w : m_workers) {
+         if(w->failed) continue;
+         alive = true;
+         if(!w->busy) {
+            w->busy = true;
+            return w;
+         }
+      }
+      if(!alive) return nullptr;
+      m_cond.wait(lock);
+   }
+}
+
+void remote_farm::release(std::shared_ptr<worker> w, bool ok)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      w->busy = false;
+      if(!ok) {
+         // a broken connection is not reused, the remaining jobs go to the other workers
+         w->failed = true;
+         w->stream.reset();
+      }
+   }
+   m_cond.notify_all();
+}
+
+remote_farm::MeshSet_ptr remote_farm::compute(const std::string& fragment, double secant_tolerance, const carve::math::Matrix& t)
+{
+   std::shared_ptr<worker> w = acquire();
+   if(!w.get()) return nullptr;
+
+   const double time_0 = json_log::singleton().now();
+   MeshSet_ptr mesh;
+   std::string message;
+   bool connected = true;
+   try {
+      if(!w->stream.get()) {
+         w->stream.reset(new boost::asio::ip::tcp::iostream(w->host,w->port));
+         if(!*w->stream) throw std::runtime_error("could not connect");
+      }
+      std::iostream& stream = *w->stream;
+      if(!write_job(stream,fragment,secant_tolerance,t)) throw std::runtime_error("could not send job");
+      stream.flush();
+
+      uint32_t status = 1;
+      if(!read_value(stream,status)) throw std::runtime_error("no response");
+      if(status == 0) {
+         mesh = mesh_binary::read(stream);
+         if(!mesh.get()) throw std::runtime_error("invalid mesh");
+      }
+      else if(!read_string(stream,message)) throw std::runtime_error("invalid response");
+   }
+   catch(std::exception& ex) {
+      message   = ex.what();
+      connected = false;
+   }
+   release(w,connected);
+
+   const std::string name = w->host + ":" + w->port;
+   if(mesh.get()) {
+      json_log::record("remote_job").add("worker",name).add("status","ok").add("sec",json_log::singleton().now()-time_0);
+   }
+   else {
+      std::cout << "...worker " << name << " failed (" << message << "), the subtree is meshed locally" << endl;
+      json_log::record("remote_job").add("worker",name).add("status","error").add("message",message);
+   }
+   return mesh;
+}
+
+bool remote_farm::write_job(std::ostream& out, const std::string& fragment, double secant_tolerance, const carve::math::Matrix& t)
+{
+   out.write(job_magic,sizeof(job_magic));
+   write_value(out,secant_tolerance);
+   for(size_t i=0; i<16; i++) write_value(out,t.v[i]);
+   return write_string(out,fragment);
+}
+
+bool remote_farm::read_job(std::istream& in, std::string& fragment, double& secant_tolerance, carve::math::Matrix& t)
+{
+   char magic[sizeof(job_magic)];
+   in.read(magic,sizeof(magic));
+   if(!in.good() || std::memcmp(magic,job_magic,sizeof(magic)) != 0) return false;
+   if(!read_value(in,secant_tolerance)) return false;
+   for(size_t i=0; i<16; i++) {
+      if(!read_value(in,t.v[i])) return false;
+   }
+   return read_string(in,fragment);
+}
+
+bool remote_farm::write_result(std::ostream& out, MeshSet_ptr mesh, const std::string& message)
+{
+   if(mesh.get()) {
+      write_value(out,static_cast<uint32_t>(0));
+      if(!mesh_binary::write(out,mesh)) return false;
+   }
+   else {
+      write_value(out,static_cast<uint32_t>(1));
+      write_string(out,message);
+   }
+   out.flush();
+   return out.good();
+}
@@ -0,0 +1,86 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef REMOTE_FARM_H
+#define REMOTE_FARM_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <carve/mesh.hpp>
+#include <carve/matrix.hpp>
+#include <boost/property_tree/ptree.hpp>
+class cf_xmlNode;
+
+// remote_farm sends the child subtrees of a top level union3d or difference3d
+// to worker xcsg processes (--workers host:port,..), which are started with --worker port.
+// The children are independent until the final booleans, so they are meshed in parallel
+// on the workers and the coordinator only performs the final reductions.
+// A job is the XML fragment of the subtree in local coordinates and its transform
+//    request : "XCSGJOB1", float64 secant tolerance, 16 float64 matrix, uint64 length, XML text
+//    response: uint32 status, then the mesh in mesh_binary format (status 0)
+//              or uint64 length and an error message
+// A connection stays open for many jobs. When a worker cannot be reached or fails,
+// the subtree is meshed locally.
+
+class remote_farm {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static remote_farm& singleton()  { static remote_farm instance; return instance;  }
+
+   // comma separated list of host:port, an empty list disables the farm
+   void set_workers(const std::string& workers);
+   bool enabled() const { return m_workers.size() > 0; }
+
+   // select the children of a top level object to be sent to the workers.
+   // Subtrees referring to definitions or external files are meshed locally
+   void select(cf_xmlNode& object);
+   void clear();
+
+   // return true and the XML fragment of node when it was selected
+   bool selected(const cf_xmlNode& node, std::string& fragment) const;
+
+   // mesh the fragment on a free worker, returns nullptr when no worker could do it
+   MeshSet_ptr compute(const std::string& fragment, double secant_tolerance, const carve::math::Matrix& t);
+
+   // job protocol, shared with remote_worker
+   static bool write_job(std::ostream& out, const std::string& fragment, double secant_tolerance, const carve::math::Matrix& t);
+   static bool read_job(std::istream& in, std::string& fragment, double& secant_tolerance, carve::math::Matrix& t);
+   static bool write_result(std::ostream& out, MeshSet_ptr mesh, const std::string& message);
+
+protected:
+   remote_farm();
+   virtual ~remote_farm();
+
+   // true when the subtree can be evaluated without the rest of the model
+   static bool self_contained(const std::string& tag, const boost::property_tree::ptree& pt);
+
+   struct worker;
+   // wait for a worker that is not busy, returns nullptr when all workers have failed
+   std::shared_ptr<worker> acquire();
+   void release(std::shared_ptr<worker> w, bool ok);
+
+private:
+   std::vector<std::shared_ptr<worker>> m_workers;
+   std::map<uint64_t,std::string>       m_fragments;  // selected subtrees by xml_hash::local_hash
+   std::mutex                           m_mutex;
+   std::condition_variable              m_cond;
+};
+
+#endif // REMOTE_FARM_H
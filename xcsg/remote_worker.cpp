@@ -0,0 +1,130 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "remote_worker.h"
+#include "remote_farm.h"
+#include "xcsg_factory.h"
+#include "xdefinitions.h"
+#include "xsolid.h"
+#include "mesh_utils.h"
+#include "mesh_cache.h"
+#include "mesh_file_cache.h"
+#include "boolean_checkpoint.h"
+#include "carve_boolean.h"
+#include "carve_boolean_thread.h"
+#include "boolean_engine.h"
+#include "sdf_field.h"
+#include "thread_pool.h"
+#include "cancel_token.h"
+#include "qhull/qhull3d.h"
+#include "csg_parser/cf_xmlTree.h"
+
+#include <sstream>
+#include <boost/asio.hpp>
+using namespace std;
+
+remote_worker::remote_worker(const boost_command_line& cmd)
+: m_cmd(cmd)
+{
+   // the boolean settings of the worker command line apply to all jobs
+   if(!thread_pool::is_created()) thread_pool::configure(m_cmd.threads(),m_cmd.count("pin_threads")>0);
+   mesh_file_cache::singleton().set_directory("");
+   boolean_checkpoint::singleton().open("",m_cmd.checkpoint_interval());
+   carve_boolean_thread::set_order((m_cmd.bool_order()=="spatial")? carve_boolean_thread::SPATIAL_ORDER : carve_boolean_thread::SIZE_ORDER);
+   carve_boolean::set_welding(m_cmd.count("weld")>0);
+   carve_boolean::set_simplify(m_cmd.count("simplify")>0);
+   carve_boolean::set_snap(m_cmd.snap());
+   carve_boolean::set_split_lumps(m_cmd.count("split_lumps")>0);
+   carve_boolean::set_deterministic(m_cmd.count("deterministic")>0);
+   carve_boolean::set_retry(m_cmd.count("no_retry")==0);
+   carve_boolean::set_partitions(m_cmd.partition_bool());
+   boolean_engine::set_current(m_cmd.bool_engine());
+   sdf_field::set_default_voxel(m_cmd.voxel());
+   qhull3d::set_engine((m_cmd.hull_engine()=="quickhull")? qhull3d::QUICKHULL : qhull3d::LIBQHULL);
+   mesh_utils::set_preview(m_cmd.count("preview")>0);
+}
+
+remote_worker::~remote_worker()
+{}
+
+bool remote_worker::run(unsigned short port)
+{
+   boost::asio::io_service io;
+   boost::system::error_code ec;
+   boost::asio::ip::tcp::acceptor acceptor(io);
+   boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(),port);
+   acceptor.open(endpoint.protocol(),ec);
+   if(!ec) acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true),ec);
+   if(!ec) acceptor.bind(endpoint,ec);
+   if(!ec) acceptor.listen(boost::asio::socket_base::max_connections,ec);
+   if(ec) {
+      cout << "xcsg-worker: cannot listen on port " << port << ": " << ec.message() << endl;
+      return false;
+   }
+
+   cout << "xcsg-worker: ready on port " << port << endl;
+   for(;;) {
+      boost::asio::ip::tcp::iostream stream;
+      acceptor.accept(stream.socket(),ec);
+      if(ec) continue;
+      std::string peer = stream.socket().remote_endpoint(ec).address().to_string();
+      size_t njobs = serve(stream);
+      cout << "xcsg-worker: " << njobs << " jobs from " << peer << endl;
+   }
+   return true;
+}
+
+size_t remote_worker::serve(std::iostream& stream)
+{
+   size_t njobs = 0;
+   std::string fragment;
+   double secant_tolerance = 0.0;
+   carve::math::Matrix t;
+   while(remote_farm::read_job(stream,fragment,secant_tolerance,t)) {
+      cancel_token::singleton().reset();
+
+      std::shared_ptr<carve::mesh::MeshSet<3>> mesh;
+      std::string message;
+      try {
+         std::istringstream in(fragment);
+         cf_xmlTree tree;
+         cf_xmlNode node;
+         if(!tree.read_xml(in) || !tree.get_root(node)) throw std::runtime_error("invalid XML fragment");
+
+         // the fragment is self contained, so it is also the root of the definitions
+         mesh_utils::set_secant_tolerance(secant_tolerance);
+         xdefinitions::singleton().set_root(node);
+         mesh_cache::singleton().clear();
+         mesh_cache::singleton().count_subtrees(node);
+
+         std::shared_ptr<xsolid> obj = xcsg_factory::singleton().make_solid(node);
+         if(m_cmd.count("no_simplify")==0) {
+            obj->simplify();
+            std::shared_ptr<xsolid> child = obj->reduced();
+            if(child.get()) obj = child;
+         }
+         mesh = obj->create_carve_mesh(t);
+         if(!mesh.get()) throw std::runtime_error("no mesh");
+      }
+      catch(std::exception& ex) {
+         // report the first error, not the cancellations it caused in other threads
+         cancel_token& token = cancel_token::singleton();
+         message = (token.cancelled())? token.reason() : std::string(ex.what());
+         mesh.reset();
+      }
+      if(!remote_farm::write_result(stream,mesh,message)) break;
+      njobs++;
+   }
+   return njobs;
+}
@@ -0,0 +1,42 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef REMOTE_WORKER_H
+#define REMOTE_WORKER_H
+
+#include "boost_command_line.h"
+#include <iostream>
+
+// remote_worker serves the jobs of remote_farm coordinators on a TCP port (--worker port).
+// Each job is an XML subtree that is meshed on the thread pool, and the resulting
+// mesh is returned in mesh_binary format. Connections are served one at a time,
+// and a connection may carry any number of jobs.
+
+class remote_worker {
+public:
+   remote_worker(const boost_command_line& cmd);
+   virtual ~remote_worker();
+
+   // serve connections until the process is stopped, returns false if the port cannot be opened
+   bool run(unsigned short port);
+
+protected:
+   // serve the jobs of one connection until it is closed, returns number of jobs
+   size_t serve(std::iostream& stream);
+
+private:
+   boost_command_line m_cmd;
+};
+
+#endif // REMOTE_WORKER_H
@@ -0,0 +1,193 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef SAFE_PRIORITY_QUEUE_H
+#define SAFE_PRIORITY_QUEUE_H
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "boolean_timer.h"
+#include "thread_pool.h"
+
+// safe_priority_queue is a thread safe priority queue with the same interface as safe_queue.
+// The element at the top is the greatest according to Compare, i.e. use
+// a "greater" comparison to dequeue the smallest elements first. Elements are moved in and out
+//
+// For reductions it also tracks outstanding work: wait_dequeue_pair() registers
+// the pair as outstanding, and enqueue_result() returns the result and completes it.
+// Consumers block until a pair is available or no more results can arrive.
+// Producers feeding the reduction while it runs register their items with
+// add_outstanding() and deliver them with enqueue_result().
+
+template <class T, class Compare>
+class safe_priority_queue {
+public:
+   safe_priority_queue(void)
+   : q()
+   , m_compare()
+   , m()
+   , c()
+   , m_outstanding(0)
+   , m_cancelled(false)
+   {}
+
+   ~safe_priority_queue(void)
+   {}
+
+   void enqueue(T t)
+   {
+      {
+       std::lock_guard<std::mutex> lock(m);
+       push(std::move(t));
+      }
+      c.notify_one();
+   }
+
+   // return false if queue is empty
+   bool try_dequeue(T& val)
+   {
+      std::unique_lock<std::mutex> lock(m);
+      if(q.empty())return false;
+
+      val = pop();
+      return true;
+   }
+
+   // dequeue the two top elements in one operation.
+   // return false and leave the queue unchanged if it holds less than 2 elements
+   bool try_dequeue_pair(T& a, T& b)
+   {
+      std::unique_lock<std::mutex> lock(m);
+      if(q.size() < 2)return false;
+
+      a = pop();
+      b = pop();
+      return true;
+   }
+
+   // as try_dequeue_pair, but the pair is registered as outstanding like in wait_dequeue_pair
+   bool try_dequeue_outstanding_pair(T& a, T& b)
+   {
+      std::unique_lock<std::mutex> lock(m);
+      if(m_cancelled || q.size() < 2)return false;
+
+      a = pop();
+      b = pop();
+      m_outstanding++;
+      return true;
+   }
+
+   // register n results to be returned later with enqueue_result
+   void add_outstanding(size_t n)
+   {
+      std::lock_guard<std::mutex> lock(m);
+      m_outstanding += n;
+   }
+
+   // block until 2 elements can be dequeued, or until the reduction is complete.
+   // returns false when less than 2 elements remain and no work is outstanding.
+   // Like task_group::wait, the waiting thread executes pending pool tasks, as the outstanding
+   // results may depend on them, e.g. the slabs of a partitioned boolean. Otherwise it sleeps
+   // briefly, that time is added to the boolean_timer wait time
+   bool wait_dequeue_pair(T& a, T& b)
+   {
+      std::unique_lock<std::mutex> lock(m);
+      while(!m_cancelled && q.size() < 2 && m_outstanding > 0) {
+         lock.unlock();
+         bool helped = thread_pool::singleton().run_pending_task();
+         lock.lock();
+         if(!helped && !m_cancelled && q.size() < 2 && m_outstanding > 0) {
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            c.wait_for(lock,std::chrono::milliseconds(1));
+            std::chrono::duration<double> waited = std::chrono::steady_clock::now() - t0;
+            boolean_timer::singleton().add_wait(waited.count());
+         }
+      }
+      if(m_cancelled || q.size() < 2)return false;
+
+      a = pop();
+      b = pop();
+      m_outstanding++;
+      return true;
+   }
+
+   // return the result of an outstanding pair or a registered producer item
+   void enqueue_result(T t)
+   {
+      {
+       std::lock_guard<std::mutex> lock(m);
+       push(std::move(t));
+       m_outstanding--;
+      }
+      c.notify_all();
+   }
+
+   // release all waiting consumers, e.g. after an error
+   void cancel()
+   {
+      {
+       std::lock_guard<std::mutex> lock(m);
+       m_cancelled = true;
+      }
+      c.notify_all();
+   }
+
+   // wait for new data if queue empty
+   T dequeue(void)
+   {
+      std::unique_lock<std::mutex> lock(m);
+      while(q.empty())
+      {
+         c.wait(lock);
+      }
+      return pop();
+   }
+
+   size_t size() const
+   {
+      std::lock_guard<std::mutex> lock(m);
+      return q.size();
+   }
+
+private:
+   // the heap operations of std::priority_queue, but the top element is moved out. Lock must be held
+   void push(T t)
+   {
+      q.push_back(std::move(t));
+      std::push_heap(q.begin(),q.end(),m_compare);
+   }
+
+   T pop()
+   {
+      std::pop_heap(q.begin(),q.end(),m_compare);
+      T val = std::move(q.back());
+      q.pop_back();
+      return val;
+   }
+
+private:
+   std::vector<T> q;      // heap ordered by m_compare
+   Compare        m_compare;
+   mutable std::mutex m;
+   std::condition_variable c;
+   size_t m_outstanding;  // pairs dequeued, result not yet returned
+   bool   m_cancelled;
+};
+
+#endif // SAFE_PRIORITY_QUEUE_H
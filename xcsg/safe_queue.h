@@ -19,6 +19,10 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
+
+// safe_queue is a thread safe FIFO queue. Elements are moved in and out,
+// so queued shared pointers are handed over without reference count traffic
 
 template <class T>
 class safe_queue {
@@ -32,6 +36,10 @@ public:
    ~safe_queue(void)
    {}
 
+   // no-op, for interface compatibility with lockfree_queue
+   void reserve(size_t /*capacity*/)
+   {}
+
    void enqueue(T t)
    {
       // Unlock before notifying to avoid waking up
@@ -39,7 +47,18 @@ public:
       // Therefore this extra code block.
       {
        std::lock_guard<std::mutex> lock(m);
-       q.push(t);
+       q.push(std::move(t));
+      }
+      c.notify_one();
+   }
+
+   // construct the element in place
+   template <class... Args>
+   void emplace(Args&&... args)
+   {
+      {
+       std::lock_guard<std::mutex> lock(m);
+       q.emplace(std::forward<Args>(args)...);
       }
       c.notify_one();
    }
@@ -50,7 +69,7 @@ public:
       std::unique_lock<std::mutex> lock(m);
       if(q.empty())return false;
 
-      val = q.front();
+      val = std::move(q.front());
       q.pop();
       return true;
   }
@@ -63,7 +82,7 @@ public:
       {
          c.wait(lock);
       }
-      T val = q.front();
+      T val = std::move(q.front());
       q.pop();
       return val;
    }
@@ -0,0 +1,454 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "sdf_field.h"
+#include "triangle_mesh.h"
+#include "thread_pool.h"
+#include "cancel_token.h"
+#include <carve/input.hpp>
+#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+double sdf_field::m_default_voxel = 0.0;
+
+// block coordinates are packed as 21 bit fields with this offset
+static const int64_t key_offset = int64_t(1) << 20;
+
+static uint64_t block_key(int64_t bi, int64_t bj, int64_t bk)
+{
+   return  uint64_t(bi+key_offset) | (uint64_t(bj+key_offset) << 21) | (uint64_t(bk+key_offset) << 42);
+}
+
+static void block_coords(uint64_t key, int64_t& bi, int64_t& bj, int64_t& bk)
+{
+   const uint64_t mask = (uint64_t(1) << 21) - 1;
+   bi = int64_t(key & mask) - key_offset;
+   bj = int64_t((key >> 21) & mask) - key_offset;
+   bk = int64_t((key >> 42) & mask) - key_offset;
+}
+
+static int64_t floor_div(int64_t i, int64_t n)
+{
+   return (i >= 0)? i/n : -((-i+n-1)/n);
+}
+
+// sample index within its block
+static size_t sample_index(int64_t i, int64_t j, int64_t k)
+{
+   const int64_t n = sdf_field::block_size;
+   return size_t((i-n*floor_div(i,n)) + n*((j-n*floor_div(j,n)) + n*(k-n*floor_div(k,n))));
+}
+
+// runs task(i) for i<n as pool tasks taking the next index
+static void parallel_for(size_t n, const std::function<void(size_t)>& task)
+{
+   std::atomic<size_t> next(0);
+   auto worker = [&next,n,&task]() {
+      for(size_t i=next++; i<n; i=next++) {
+         cancel_token::singleton().check();
+         task(i);
+      }
+   };
+   task_group tasks;
+   size_t ntask = std::min(n,thread_pool::singleton().nthreads());
+   for(size_t itask=0; itask<ntask; itask++) tasks.run(worker);
+   tasks.wait();
+}
+
+namespace {
+
+   struct sdf_triangle {
+      double p[3][3];
+      double lo[3],hi[3];
+   };
+
+   inline double dot3(const double* a, const double* b) { return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+
+   // squared distance from point q to triangle t, after Ericson "Real-Time Collision Detection" 5.1.5
+   double distance2(const double* q, const sdf_triangle& t)
+   {
+      const double* a = t.p[0];
+      const double* b = t.p[1];
+      const double* c = t.p[2];
+      double ab[3],ac[3],ap[3],closest[3];
+      for(size_t i=0; i<3; i++) { ab[i]=b[i]-a[i]; ac[i]=c[i]-a[i]; ap[i]=q[i]-a[i]; }
+
+      double d1 = dot3(ab,ap), d2 = dot3(ac,ap);
+      if(d1 <= 0.0 && d2 <= 0.0) { for(size_t i=0; i<3; i++) closest[i]=a[i]; }
+      else {
+         double bp[3]; for(size_t i=0; i<3; i++) bp[i]=q[i]-b[i];
+         double d3 = dot3(ab,bp), d4 = dot3(ac,bp);
+         double cp[3]; for(size_t i=0; i<3; i++) cp[i]=q[i]-c[i];
+         double d5 = dot3(ab,cp), d6 = dot3(ac,cp);
+         double vc = d1*d4 - d3*d2;
+         double vb = d5*d2 - d1*d6;
+         double va = d3*d6 - d5*d4;
+         if(d3 >= 0.0 && d4 <= d3)                  { for(size_t i=0; i<3; i++) closest[i]=b[i]; }
+         else if(d6 >= 0.0 && d5 <= d6)             { for(size_t i=0; i<3; i++) closest[i]=c[i]; }
+         else if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+            double v = d1/(d1-d3);
+            for(size_t i=0; i<3; i++) closest[i]=a[i]+v*ab[i];
+         }
+         else if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+            double w = d2/(d2-d6);
+            for(size_t i=0; i<3; i++) closest[i]=a[i]+w*ac[i];
+         }
+         else if(va <= 0.0 && (d4-d3) >= 0.0 && (d5-d6) >= 0.0) {
+            double w = (d4-d3)/((d4-d3)+(d5-d6));
+            for(size_t i=0; i<3; i++) closest[i]=b[i]+w*(c[i]-b[i]);
+         }
+         else {
+            double denom = 1.0/(va+vb+vc);
+            double v = vb*denom, w = vc*denom;
+            for(size_t i=0; i<3; i++) closest[i]=a[i]+ab[i]*v+ac[i]*w;
+         }
+      }
+      double d[3]; for(size_t i=0; i<3; i++) d[i]=q[i]-closest[i];
+      return dot3(d,d);
+   }
+
+   // z of the crossing of the vertical line through (x,y) with triangle t, false when it misses
+   bool z_crossing(double x, double y, const sdf_triangle& t, double& z)
+   {
+      const double* a = t.p[0];
+      const double* b = t.p[1];
+      const double* c = t.p[2];
+      double w0 = (b[0]-x)*(c[1]-y) - (c[0]-x)*(b[1]-y);
+      double w1 = (c[0]-x)*(a[1]-y) - (a[0]-x)*(c[1]-y);
+      double w2 = (a[0]-x)*(b[1]-y) - (b[0]-x)*(a[1]-y);
+      if(!((w0>=0.0 && w1>=0.0 && w2>=0.0) || (w0<=0.0 && w1<=0.0 && w2<=0.0))) return false;
+      double sum = w0+w1+w2;
+      if(sum == 0.0) return false;
+      z = (w0*a[2] + w1*b[2] + w2*c[2])/sum;
+      return true;
+   }
+}
+
+sdf_field::sdf_field(double voxel)
+: m_voxel(voxel)
+{}
+
+sdf_field::~sdf_field()
+{}
+
+size_t sdf_field::ndense() const
+{
+   size_t n = 0;
+   for(auto& b : m_blocks) if(b.second.v.size() > 0) n++;
+   return n;
+}
+
+float sdf_field::value(int64_t i, int64_t j, int64_t k) const
+{
+   auto it = m_blocks.find(block_key(floor_div(i,block_size),floor_div(j,block_size),floor_div(k,block_size)));
+   if(it == m_blocks.end()) return band();
+   const block& b = it->second;
+   return (b.v.size() > 0)? b.v[sample_index(i,j,k)] : b.uniform;
+}
+
+std::shared_ptr<sdf_field> sdf_field::from_mesh(const carve::mesh::MeshSet<3>& mesh, double voxel)
+{
+   std::shared_ptr<sdf_field> field = std::make_shared<sdf_field>(voxel);
+   const double h    = voxel;
+   const double band = field->band();
+   const int64_t n   = block_size;
+
+   std::vector<sdf_triangle> tris;
+   for(size_t imani=0; imani<mesh.meshes.size(); imani++) {
+      triangle_mesh lump(mesh,imani,false,false);
+      tris.reserve(tris.size()+lump.ntriangles());
+      for(size_t itri=0; itri<lump.ntriangles(); itri++) {
+         const size_t* tri = lump.triangle(itri);
+         sdf_triangle t;
+         for(size_t iv=0; iv<3; iv++) {
+            const xvertex& p = lump.vertex(tri[iv]);
+            for(size_t i=0; i<3; i++) t.p[iv][i] = p[i];
+         }
+         for(size_t i=0; i<3; i++) {
+            t.lo[i] = std::min(std::min(t.p[0][i],t.p[1][i]),t.p[2][i]);
+            t.hi[i] = std::max(std::max(t.p[0][i],t.p[1][i]),t.p[2][i]);
+         }
+         tris.push_back(t);
+      }
+   }
+   if(tris.size() == 0) return field;
+
+   // triangles near each block, within the band, and the triangles over each column of blocks
+   std::unordered_map<uint64_t,std::vector<uint32_t>> near_blocks;
+   std::unordered_map<uint64_t,std::vector<uint32_t>> columns;
+   int64_t blo[3] = {  std::numeric_limits<int64_t>::max(),  std::numeric_limits<int64_t>::max(),  std::numeric_limits<int64_t>::max() };
+   int64_t bhi[3] = { -std::numeric_limits<int64_t>::max(), -std::numeric_limits<int64_t>::max(), -std::numeric_limits<int64_t>::max() };
+   for(uint32_t itri=0; itri<tris.size(); itri++) {
+      const sdf_triangle& t = tris[itri];
+      int64_t b0[3],b1[3];
+      for(size_t i=0; i<3; i++) {
+         b0[i] = floor_div(int64_t(std::floor((t.lo[i]-band)/h)),n);
+         b1[i] = floor_div(int64_t(std::ceil((t.hi[i]+band)/h)),n);
+         blo[i] = std::min(blo[i],b0[i]);
+         bhi[i] = std::max(bhi[i],b1[i]);
+      }
+      for(int64_t bk=b0[2]; bk<=b1[2]; bk++) {
+         for(int64_t bj=b0[1]; bj<=b1[1]; bj++) {
+            for(int64_t bi=b0[0]; bi<=b1[0]; bi++) near_blocks[block_key(bi,bj,bk)].push_back(itri);
+         }
+      }
+      for(int64_t bj=b0[1]; bj<=b1[1]; bj++) {
+         for(int64_t bi=b0[0]; bi<=b1[0]; bi++) columns[block_key(bi,bj,0)].push_back(itri);
+      }
+   }
+
+   // every block in the box is either near the surface or entirely inside or outside
+   std::vector<uint64_t> keys;
+   for(int64_t bk=blo[2]; bk<=bhi[2]; bk++) {
+      for(int64_t bj=blo[1]; bj<=bhi[1]; bj++) {
+         for(int64_t bi=blo[0]; bi<=bhi[0]; bi++) keys.push_back(block_key(bi,bj,bk));
+      }
+   }
+   std::vector<block> blocks(keys.size());
+
+   // the vertical rays are offset slightly from the grid, so they do not pass through mesh vertices and edges
+   const double dx = 1.234567E-5*h, dy = 2.345678E-5*h;
+
+   parallel_for(keys.size(),[&](size_t ikey) {
+      int64_t bi,bj,bk;
+      block_coords(keys[ikey],bi,bj,bk);
+      static const std::vector<uint32_t> no_triangles;
+      auto icolumn = columns.find(block_key(bi,bj,0));
+      const std::vector<uint32_t>& column = (icolumn != columns.end())? icolumn->second : no_triangles;
+
+      // number of crossings below z along the vertical ray through (x,y)
+      std::vector<double> zs;
+      auto crossings = [&](double x, double y) {
+         zs.clear();
+         double z = 0.0;
+         for(uint32_t itri : column) {
+            if(z_crossing(x+dx,y+dy,tris[itri],z)) zs.push_back(z);
+         }
+         std::sort(zs.begin(),zs.end());
+      };
+      auto inside = [&zs](double z) { return ((std::lower_bound(zs.begin(),zs.end(),z) - zs.begin()) % 2) == 1; };
+
+      block& b = blocks[ikey];
+      auto near = near_blocks.find(keys[ikey]);
+      if(near == near_blocks.end()) {
+         double c = (0.5*(n-1))*h;
+         crossings(bi*n*h+c,bj*n*h+c);
+         b.uniform = (inside(bk*n*h+c))? -band : band;
+         return;
+      }
+
+      b.v.assign(block_samples,band);
+      const std::vector<uint32_t>& near_tris = near->second;
+      for(int64_t j=0; j<n; j++) {
+         for(int64_t i=0; i<n; i++) {
+            double q[3] = { (bi*n+i)*h, (bj*n+j)*h, 0.0 };
+            crossings(q[0],q[1]);
+            for(int64_t k=0; k<n; k++) {
+               q[2] = (bk*n+k)*h;
+               double d2 = band*band;
+               for(uint32_t itri : near_tris) {
+                  const sdf_triangle& t = tris[itri];
+                  if(q[0] < t.lo[0]-band || q[0] > t.hi[0]+band || q[1] < t.lo[1]-band || q[1] > t.hi[1]+band || q[2] < t.lo[2]-band || q[2] > t.hi[2]+band) continue;
+                  d2 = std::min(d2,distance2(q,t));
+               }
+               float d = static_cast<float>(std::min(std::sqrt(d2),band));
+               b.v[i + n*(j + n*k)] = (inside(q[2]))? -d : d;
+            }
+         }
+      }
+   });
+
+   for(size_t ikey=0; ikey<keys.size(); ikey++) {
+      field->m_blocks[keys[ikey]].v.swap(blocks[ikey].v);
+      field->m_blocks[keys[ikey]].uniform = blocks[ikey].uniform;
+   }
+   field->compact();
+   return field;
+}
+
+void sdf_field::compact()
+{
+   const float outside = band();
+   for(auto it=m_blocks.begin(); it!=m_blocks.end(); ) {
+      block& b = it->second;
+      if(b.v.size() > 0 && std::all_of(b.v.begin(),b.v.end(),[&b](float v) { return v == b.v[0]; })) {
+         b.uniform = b.v[0];
+         std::vector<float>().swap(b.v);
+      }
+      if(b.v.size() == 0 && b.uniform >= outside) it = m_blocks.erase(it);
+      else it++;
+   }
+}
+
+void sdf_field::combine(const sdf_field& other, op_type op)
+{
+   // block pairs combined sample by sample, blocks missing in one of the fields are resolved here
+   std::vector<std::pair<block*,const block*>> pairs;
+   if(op == UNION) {
+      for(auto& b : other.m_blocks) {
+         auto it = m_blocks.find(b.first);
+         if(it == m_blocks.end()) m_blocks[b.first] = b.second;
+         else pairs.push_back(std::make_pair(&it->second,&b.second));
+      }
+   }
+   else {
+      for(auto it=m_blocks.begin(); it!=m_blocks.end(); ) {
+         auto ib = other.m_blocks.find(it->first);
+         if(ib != other.m_blocks.end()) pairs.push_back(std::make_pair(&it->second,&ib->second));
+         else if(op == INTERSECTION) { it = m_blocks.erase(it); continue; }
+         it++;
+      }
+   }
+
+   parallel_for(pairs.size(),[&pairs,op](size_t ipair) {
+      block& a = *pairs[ipair].first;
+      const block& b = *pairs[ipair].second;
+      if(a.v.size()==0 && b.v.size()==0) {
+         switch(op) {
+            case UNION:        { a.uniform = std::min(a.uniform,b.uniform); break; }
+            case INTERSECTION: { a.uniform = std::max(a.uniform,b.uniform); break; }
+            case DIFFERENCE:   { a.uniform = std::max(a.uniform,-b.uniform); break; }
+         };
+         return;
+      }
+      if(a.v.size() == 0) a.v.assign(block_samples,a.uniform);
+      float* va = &a.v[0];
+      std::vector<float> uniform;
+      if(b.v.size() == 0) uniform.assign(block_samples,b.uniform);
+      const float* vb = (b.v.size() > 0)? &b.v[0] : &uniform[0];
+
+      // contiguous loops the compiler vectorizes
+      switch(op) {
+         case UNION:        { for(int i=0; i<block_samples; i++) va[i] = std::min(va[i],vb[i]);  break; }
+         case INTERSECTION: { for(int i=0; i<block_samples; i++) va[i] = std::max(va[i],vb[i]);  break; }
+         case DIFFERENCE:   { for(int i=0; i<block_samples; i++) va[i] = std::max(va[i],-vb[i]); break; }
+      };
+   });
+   compact();
+}
+
+std::shared_ptr<sdf_field> sdf_field::union_of(size_t n, std::function<std::shared_ptr<sdf_field>(size_t)> field, double voxel)
+{
+   // each task unions the fields it creates, then the task results are unioned
+   size_t ntask = std::max(size_t(1),std::min(n,thread_pool::singleton().nthreads()));
+   std::vector<std::shared_ptr<sdf_field>> parts(ntask);
+   std::atomic<size_t> next(0);
+   task_group tasks;
+   for(size_t itask=0; itask<ntask; itask++) {
+      tasks.run([&parts,&next,&field,n,voxel,itask]() {
+         parts[itask] = std::make_shared<sdf_field>(voxel);
+         for(size_t i=next++; i<n; i=next++) {
+            cancel_token::singleton().check();
+            parts[itask]->combine(*field(i),UNION);
+         }
+      });
+   }
+   tasks.wait();
+
+   for(size_t itask=1; itask<ntask; itask++) parts[0]->combine(*parts[itask],UNION);
+   return parts[0];
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> sdf_field::create_mesh() const
+{
+   const int64_t n = block_size;
+   const double  h = m_voxel;
+
+   // cells are visited in the blocks with samples and in their lower neighbours,
+   // since a cell reaches one sample into the next block
+   std::unordered_set<uint64_t> visit;
+   for(auto& b : m_blocks) {
+      if(b.second.v.size() == 0) continue;
+      int64_t bi,bj,bk;
+      block_coords(b.first,bi,bj,bk);
+      for(int64_t k=0; k<2; k++) for(int64_t j=0; j<2; j++) for(int64_t i=0; i<2; i++) visit.insert(block_key(bi-i,bj-j,bk-k));
+   }
+
+   carve::input::PolyhedronData data;
+   std::unordered_map<uint64_t,int> cell_vertex;
+
+   // surface nets vertex of the cell with corner (i,j,k): the mean of the zero crossings on its edges.
+   // Cell keys use the block key packing with 21 bits per coordinate
+   auto vertex = [&](int64_t i, int64_t j, int64_t k) {
+      uint64_t key = block_key(i,j,k);
+      auto it = cell_vertex.find(key);
+      if(it != cell_vertex.end()) return it->second;
+
+      float v[8];
+      for(int c=0; c<8; c++) v[c] = value(i+(c&1),j+((c>>1)&1),k+((c>>2)&1));
+      double sum[3] = {0,0,0};
+      int count = 0;
+      for(int c=0; c<8; c++) {
+         for(int d=0; d<3; d++) {
+            int c2 = c | (1<<d);
+            if(c2 == c || (v[c]<0.0f) == (v[c2]<0.0f)) continue;
+            double s = v[c]/(v[c]-v[c2]);
+            double p[3] = { double(i+(c&1)), double(j+((c>>1)&1)), double(k+((c>>2)&1)) };
+            p[d] += s;
+            for(int m=0; m<3; m++) sum[m] += p[m];
+            count++;
+         }
+      }
+      if(count == 0) count = 1;
+      int iv = static_cast<int>(data.points.size());
+      data.points.push_back(carve::geom::VECTOR(sum[0]/count*h,sum[1]/count*h,sum[2]/count*h));
+      cell_vertex[key] = iv;
+      return iv;
+   };
+
+   // one quad for each grid edge crossing the surface, joining the vertices of the 4 cells around it
+   int ntri = 0;
+   for(uint64_t key : visit) {
+      int64_t bi,bj,bk;
+      block_coords(key,bi,bj,bk);
+      for(int64_t k=bk*n; k<(bk+1)*n; k++) {
+         for(int64_t j=bj*n; j<(bj+1)*n; j++) {
+            for(int64_t i=bi*n; i<(bi+1)*n; i++) {
+               float v0 = value(i,j,k);
+               int64_t p[3] = { i,j,k };
+               for(int d=0; d<3; d++) {
+                  int64_t q[3] = { i,j,k };
+                  q[d]++;
+                  float v1 = value(q[0],q[1],q[2]);
+                  if((v0<0.0f) == (v1<0.0f)) continue;
+
+                  const int a = (d+1)%3, b = (d+2)%3;
+                  int64_t c[4][3];
+                  for(int m=0; m<4; m++) for(int l=0; l<3; l++) c[m][l] = p[l];
+                  c[0][a]--; c[0][b]--;
+                  c[1][b]--;
+                  c[3][a]--;
+                  int iv[4];
+                  for(int m=0; m<4; m++) iv[m] = vertex(c[m][0],c[m][1],c[m][2]);
+
+                  // counterclockwise around +d, the outward direction when the edge starts inside
+                  if(v0 >= 0.0f) { std::swap(iv[1],iv[3]); }
+                  int tri[2][3] = { {iv[0],iv[1],iv[2]}, {iv[0],iv[2],iv[3]} };
+                  for(int t=0; t<2; t++) {
+                     data.faceIndices.push_back(3);
+                     data.faceIndices.insert(data.faceIndices.end(),tri[t],tri[t]+3);
+                     ntri++;
+                  }
+               }
+            }
+         }
+      }
+   }
+   data.faceCount = ntri;
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(carve::input::Options()));
+}
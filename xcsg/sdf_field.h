@@ -0,0 +1,88 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef SDF_FIELD_H
+#define SDF_FIELD_H
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <carve/mesh.hpp>
+
+// sdf_field is a sparse narrow band signed distance field sampled on the global grid of points
+// (i,j,k)*voxel, negative inside. The samples are stored in blocks of 8x8x8. A block without surface
+// nearby holds a single uniform value, and missing blocks are outside. Booleans are evaluated as
+// min/max per sample, so the cost depends on the surface area and not on the number of booleans,
+// at the price of a result that is only accurate to the voxel size (--backend sdf)
+
+class sdf_field {
+public:
+   enum op_type { UNION, INTERSECTION, DIFFERENCE };
+
+   sdf_field(double voxel);
+   virtual ~sdf_field();
+
+   double voxel() const { return m_voxel; }
+
+   // voxel size given by --voxel, 0 when it is derived from the model size
+   static double default_voxel() { return m_default_voxel; }
+   static void set_default_voxel(double voxel) { m_default_voxel = voxel; }
+
+   // the field of a closed mesh, exact distances within the band and the sign from ray parity
+   static std::shared_ptr<sdf_field> from_mesh(const carve::mesh::MeshSet<3>& mesh, double voxel);
+
+   // union of n fields created by field(i), created and combined as parallel tasks
+   static std::shared_ptr<sdf_field> union_of(size_t n, std::function<std::shared_ptr<sdf_field>(size_t)> field, double voxel);
+
+   // this = this op b
+   void combine(const sdf_field& b, op_type op);
+
+   // triangle mesh of the zero level surface, using surface nets
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_mesh() const;
+
+   // number of stored blocks, and of those with individual samples
+   size_t nblocks() const { return m_blocks.size(); }
+   size_t ndense() const;
+
+public:
+   static const int block_size = 8;
+   static const int block_samples = block_size*block_size*block_size;
+
+   // a block holds block_samples values, or a single uniform value when v is empty
+   struct block {
+      block() : uniform(0.0f) {}
+      float              uniform;
+      std::vector<float> v;
+   };
+
+private:
+   // half width of the narrow band, values are clamped to +/- band
+   float band() const { return static_cast<float>(2.0*m_voxel); }
+
+   // sample value at grid point, outside when the block is missing
+   float value(int64_t i, int64_t j, int64_t k) const;
+
+   // remove blocks that only hold the outside value, make uniform blocks of constant dense blocks
+   void compact();
+
+private:
+   static double                        m_default_voxel;
+   double                               m_voxel;
+   std::unordered_map<uint64_t,block>   m_blocks;
+};
+
+#endif // SDF_FIELD_H
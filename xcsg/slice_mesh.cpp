@@ -0,0 +1,180 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+// include xshape2d so that xvertex is defined
+#include "xshape2d.h"
+
+#include "slice_mesh.h"
+#include "carve_boolean.h"
+#include "triangle_mesh.h"
+#include "thread_pool.h"
+#include "clipper_csg/polygon2d.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <iostream>
+using namespace std;
+
+// triangles of one lump, bucketed by the planes they cross
+struct slice_lump {
+   std::shared_ptr<triangle_mesh> tmesh;
+   std::vector<size_t>            first;     // start of each plane in triangles, size nplanes+1
+   std::vector<size_t>            triangles; // triangle indices per plane
+};
+
+static void index_lump(slice_lump& lump, const std::vector<double>& zsorted)
+{
+   const triangle_mesh& tmesh = *lump.tmesh;
+   const size_t nplanes = zsorted.size();
+   const size_t ntri    = tmesh.ntriangles();
+
+   // plane range of each triangle, a vertex on a plane counts as above it
+   std::vector<std::pair<size_t,size_t>> span(ntri);
+   std::vector<size_t> count(nplanes+1,0);
+   for(size_t itri=0; itri<ntri; itri++) {
+      const size_t* tri = tmesh.triangle(itri);
+      double zmin = tmesh.vertex(tri[0]).z, zmax = zmin;
+      for(size_t ivert=1; ivert<3; ivert++) {
+         zmin = std::min(zmin,tmesh.vertex(tri[ivert]).z);
+         zmax = std::max(zmax,tmesh.vertex(tri[ivert]).z);
+      }
+      size_t ilo = std::upper_bound(zsorted.begin(),zsorted.end(),zmin) - zsorted.begin();
+      size_t ihi = std::upper_bound(zsorted.begin(),zsorted.end(),zmax) - zsorted.begin();
+      span[itri] = std::make_pair(ilo,ihi);
+      for(size_t iplane=ilo; iplane<ihi; iplane++) count[iplane]++;
+   }
+
+   lump.first.assign(nplanes+1,0);
+   for(size_t iplane=0; iplane<nplanes; iplane++) lump.first[iplane+1] = lump.first[iplane] + count[iplane];
+   lump.triangles.resize(lump.first[nplanes]);
+   std::vector<size_t> next(lump.first.begin(),lump.first.end()-1);
+   for(size_t itri=0; itri<ntri; itri++) {
+      for(size_t iplane=span[itri].first; iplane<span[itri].second; iplane++) lump.triangles[next[iplane]++] = itri;
+   }
+}
+
+// append the section loops of the lump at z to loops.
+// A crossing point is identified by its mesh edge, so the segments of neighbouring triangles chain into loops
+static void section_lump(const slice_lump& lump, size_t iplane, double z, polygon2d& loops)
+{
+   const triangle_mesh& tmesh = *lump.tmesh;
+   auto edge_key = [](uint64_t a, uint64_t b) { return (a<b)? ((a<<32)|b) : ((b<<32)|a); };
+
+   // segments run from the edge crossing downwards to the edge crossing upwards,
+   // this keeps the solid on the left, i.e. outer loops CCW and holes CW
+   std::unordered_map<uint64_t,uint64_t> next;
+   std::unordered_map<uint64_t,dpos2d>   points;
+   for(size_t i=lump.first[iplane]; i<lump.first[iplane+1]; i++) {
+      const size_t* tri = tmesh.triangle(lump.triangles[i]);
+      uint64_t down = 0, up = 0;
+      size_t ncross = 0;
+      for(size_t ivert=0; ivert<3; ivert++) {
+         size_t ia = tri[ivert];
+         size_t ib = tri[(ivert+1)%3];
+         const xvertex& a = tmesh.vertex(ia);
+         const xvertex& b = tmesh.vertex(ib);
+         bool a_above = (a.z >= z);
+         bool b_above = (b.z >= z);
+         if(a_above == b_above) continue;
+
+         uint64_t key = edge_key(ia,ib);
+         if(points.find(key) == points.end()) {
+            double s = (z - a.z)/(b.z - a.z);
+            points[key] = dpos2d(a.x + s*(b.x-a.x), a.y + s*(b.y-a.y));
+         }
+         if(a_above) down = key;
+         else        up   = key;
+         ncross++;
+      }
+      if(ncross == 2) next.insert(std::make_pair(down,up));
+   }
+
+   while(next.size() > 0) {
+      std::shared_ptr<contour2d> contour(new contour2d());
+      uint64_t istart = next.begin()->first;
+      uint64_t ikey   = istart;
+      do {
+         contour->push_back(points[ikey]);
+         auto it = next.find(ikey);
+         if(it == next.end()) break;
+         ikey = it->second;
+         next.erase(it);
+      } while(ikey != istart);
+      if(contour->size() > 2) loops.push_back(contour);
+   }
+}
+
+std::vector<std::shared_ptr<clipper_profile>> slice_mesh::slice(std::shared_ptr<carve::mesh::MeshSet<3>> meshset, const std::vector<double>& zvalues)
+{
+   carve_boolean csg_carve;
+   csg_carve.compute(meshset,carve::csg::CSG::OP::UNION);
+   const size_t nmani = csg_carve.size();
+
+   std::vector<double> zsorted(zvalues);
+   std::sort(zsorted.begin(),zsorted.end());
+   zsorted.erase(std::unique(zsorted.begin(),zsorted.end()),zsorted.end());
+   const size_t nplanes = zsorted.size();
+
+   cout << "...Computing " << nplanes << " slices of " << nmani << " lumps" << std::endl;
+
+   // runs f(i) for i in [0,n) on the thread pool
+   auto parallel_for = [](size_t n, const std::function<void(size_t)>& f) {
+      std::atomic<size_t> next_item(0);
+      auto task = [&f,&next_item,n]() {
+         for(size_t i=next_item++; i<n; i=next_item++) f(i);
+      };
+      const size_t ntask = std::min(thread_pool::singleton().nthreads(),n);
+      if(ntask <= 1) task();
+      else {
+         task_group tasks;
+         for(size_t itask=0; itask<ntask; itask++) tasks.run(task);
+         tasks.wait();
+      }
+   };
+
+   // the lumps are triangulated and indexed in parallel
+   std::vector<slice_lump> lumps(nmani);
+   parallel_for(nmani,[&csg_carve,&lumps,&zsorted](size_t imani) {
+      lumps[imani].tmesh = csg_carve.create_triangle_mesh(imani,false,true);
+      index_lump(lumps[imani],zsorted);
+   });
+
+   // then the planes are sectioned in parallel
+   std::vector<std::shared_ptr<clipper_profile>> sections(nplanes);
+   parallel_for(nplanes,[&lumps,&zsorted,&sections](size_t iplane) {
+      polygon2d loops;
+      for(auto& lump : lumps) section_lump(lump,iplane,zsorted[iplane],loops);
+
+      // merge touching lumps and resolve the orientation of holes
+      ClipperLib::Clipper clipper;
+      clipper.AddPaths(*loops.paths(),ClipperLib::ptSubject,true);
+      std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+      if(!clipper.Execute(ClipperLib::ctUnion, profile->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero)) {
+         throw std::logic_error("slice_mesh: section union failed");
+      }
+      profile->set_dirty();
+      sections[iplane] = profile;
+   });
+
+   // return the sections in the order requested
+   std::vector<std::shared_ptr<clipper_profile>> result;
+   result.reserve(zvalues.size());
+   for(double z : zvalues) {
+      size_t iplane = std::lower_bound(zsorted.begin(),zsorted.end(),z) - zsorted.begin();
+      result.push_back(sections[iplane]);
+   }
+   return result;
+}
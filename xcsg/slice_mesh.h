@@ -0,0 +1,32 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef SLICE_MESH_H
+#define SLICE_MESH_H
+
+#include <carve/mesh.hpp>
+#include <vector>
+#include "clipper_csg/clipper_profile.h"
+
+// cross sections of 3d meshes by planes parallel to XY.
+// Each triangle is indexed by the range of planes spanned by its z extent,
+// so the planes only visit the triangles crossing them and are computed in parallel.
+
+class slice_mesh {
+public:
+   // return the cross section at each z value, in the order of zvalues
+   static std::vector<std::shared_ptr<clipper_profile>> slice(std::shared_ptr<carve::mesh::MeshSet<3>> mesh, const std::vector<double>& zvalues);
+};
+
+#endif // SLICE_MESH_H
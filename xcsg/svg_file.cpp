@@ -2,13 +2,16 @@
 
 #include <sstream>
 #include <iomanip>
+#include <cmath>
 #include "clipper_csg/polyset2d.h"
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
-#include "csg_parser/cf_xmlTree.h"
+#include "trace_writer.h"
 
-svg_file::svg_file()
+svg_file::svg_file(int precision, bool relative)
+: m_out(precision)
+, m_relative(relative)
 {
    //ctor
 }
@@ -25,8 +28,29 @@ dpos2d svg_file::to_svg(const dpos2d& p, const dbox2d& box)
    return dpos2d(p.x()-box.p1().x(),box.p2().y() - p.y());
 }
 
+static std::string xml_escape(const std::string& text)
+{
+   std::string escaped;
+   for(char c : text) {
+      switch(c) {
+         case '&': { escaped += "&amp;"; break; }
+         case '<': { escaped += "&lt;"; break; }
+         case '>': { escaped += "&gt;"; break; }
+         case '"': { escaped += "&quot;"; break; }
+         default:  { escaped += c; }
+      };
+   }
+   return escaped;
+}
+
 std::string svg_file::write( std::shared_ptr<polyset2d> polyset, const std::string& file_path)
 {
+   return write(polyset_layers(1,std::make_pair(std::string(""),polyset)),file_path);
+}
+
+std::string svg_file::write( const polyset_layers& layers, const std::string& file_path)
+{
+   trace_span span("write_svg","export");
    boost::filesystem::path fullpath(file_path);
    boost::filesystem::path dxf_path = fullpath.parent_path() / fullpath.stem();
    std::string path = dxf_path.string() + ".svg";
@@ -34,87 +58,107 @@ std::string svg_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   // get bounding box of this polyset
-   dbox2d box = polyset->bounding_box();
+   // get bounding box of all layers
+   dbox2d box;
+   for(auto& layer : layers) {
+      dbox2d layer_box = layer.second->bounding_box();
+      if(!layer_box.initialised()) continue;
+      box.enclose(layer_box.p1());
+      box.enclose(layer_box.p2());
+   }
    dpos2d p1  = box.p1();
    dpos2d p2  = box.p2();
    double dx  = p2.x() - p1.x();
    double dy  = p2.y() - p1.y();
 
-   cf_xmlTree tree;
-   if(tree.create_root("svg")) {
-      cf_xmlNode root;
-      if(tree.get_root(root)) {
-
-         // create some margin space for the viewBox
-         double mx = dx*0.03;
-         double my = dy*0.03;
-
-        // model bounding box, rounded up to nearest mm
-        // By NOT including these properties, the model will autofit to the canvas, e.g. in a browser
-        //
-        //  root.add_property("width",std::to_string(int(dx+2*mx))+"mm");
-        //  root.add_property("height",std::to_string(int(dy+2*my))+"mm");
-
-         dpos2d p = to_svg(p1,box);
-         std::ostringstream box_out;
-         box_out << -mx  << ' ' << -my << ' ' << dx+mx  << ' ' << dy+my;
-         root.add_property("viewBox",box_out.str());
-
-         // bureaucracy
-         root.add_property("xmlns","http://www.w3.org/2000/svg");
-         root.add_property("version","1.1");
-
-         // marketing
-         cf_xmlNode title = root.add_child("title");
-         title.put_value("xcsg: " +fullpath.stem().string());
-
-         // Create the model data, written as a giant "path", containing several closed contours with "pen-ups" between them.
-         // This loop creates the value of the "d" property
-         std::string svg_path;
-         for(auto i=polyset->begin(); i!=polyset->end(); i++) {
-            std::shared_ptr<polygon2d> poly = *i;
-            size_t nc = poly->size();
-            for(size_t ic=0;ic<nc;ic++) {
-               svg_path += write_contour(poly->get_contour(ic),box);
-            }
-         }
+   // the file is streamed directly, the model data can be very large
+   if(!m_out.open(path))  throw std::runtime_error("Could not open file: " + path);
 
-         // create the one and only path tag, with properties and model data.
+   // create some margin space for the viewBox
+   double mx = dx*0.03;
+   double my = dy*0.03;
 
-         // set a stroke width that is adapted to the model size
-         ostringstream stroke_out;
-         stroke_out << std::setprecision(3) << (dx+dy)/1000;
+   // model bounding box, rounded up to nearest mm
+   // By NOT including width and height properties, the model will autofit to the canvas, e.g. in a browser
+   m_out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+   m_out << "<svg viewBox=\"" << -mx  << ' ' << -my << ' ' << dx+mx  << ' ' << dy+my << "\"";
 
-         cf_xmlNode path_tag = root.add_child("path");
+   // bureaucracy
+   m_out << " xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n";
 
-         // properties
-         path_tag.add_property("stroke","black");
-         path_tag.add_property("stroke-width",stroke_out.str());
-         path_tag.add_property("fill","lightgray");
+   // marketing
+   m_out << "\t<title>" << xml_escape("xcsg: " +fullpath.stem().string()) << "</title>\n";
 
-         // model data
-         path_tag.add_property("d",svg_path);
+   // create the one and only path tag, with properties and model data.
 
-         // write SVG to file
-         tree.write_xml(path);
+   // set a stroke width that is adapted to the model size
+   std::ostringstream stroke_out;
+   stroke_out << std::setprecision(3) << (dx+dy)/1000;
+   if(layers.size() == 1) {
+      m_out << "\t<path stroke=\"black\" stroke-width=\"" << stroke_out.str() << "\" fill=\"lightgray\" d=\"";
+      write_polyset(layers[0].second,box);
+      m_out << "\"/>\n";
+   }
+   else {
+      for(auto& layer : layers) {
+         m_out << "\t<g id=\"" << xml_escape(layer.first) << "\">\n";
+         m_out << "\t\t<path stroke=\"black\" stroke-width=\"" << stroke_out.str() << "\" fill=\"none\" d=\"";
+         write_polyset(layer.second,box);
+         m_out << "\"/>\n";
+         m_out << "\t</g>\n";
       }
    }
+   m_out << "</svg>\n";
+   m_out.close();
 
    return path;
 }
 
 
-std::string svg_file::write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box)
+void svg_file::write_polyset(std::shared_ptr<polyset2d> polyset, const dbox2d& box)
 {
-   std::ostringstream out;
-   for(size_t i=0; i<contour->size();i++) {
-      const dpos2d& vtx = (*contour)[i];
-      dpos2d p = to_svg(vtx,box);
-      if(i==0) out << " M ";
-      else     out << " L ";
-      out << p.x() << ',' << p.y();
+   // Create the model data, written as a giant "path", containing several closed contours with "pen-ups" between them.
+   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
+      std::shared_ptr<polygon2d> poly = *i;
+      size_t nc = poly->size();
+      for(size_t ic=0;ic<nc;ic++) {
+         write_contour(poly->get_contour(ic),box);
+      }
+   }
+}
+
+void svg_file::write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box)
+{
+   if(!m_relative) {
+      for(size_t i=0; i<contour->size();i++) {
+         const dpos2d& vtx = (*contour)[i];
+         dpos2d p = to_svg(vtx,box);
+         if(i==0) m_out << " M ";
+         else     m_out << " L ";
+         m_out << p.x() << ',' << p.y();
+      }
+      m_out << " z";
+   }
+   else {
+      // relative coordinates are computed from the coordinates rounded to the output precision,
+      // so rounding errors do not accumulate along the contour
+      const double scale = std::pow(10.0,m_out.precision());
+      long long x0 = 0, y0 = 0;
+      for(size_t i=0; i<contour->size();i++) {
+         const dpos2d& vtx = (*contour)[i];
+         dpos2d p = to_svg(vtx,box);
+         long long x = std::llround(p.x()*scale);
+         long long y = std::llround(p.y()*scale);
+         if(i==0) {
+            m_out << 'M' << x/scale << ',' << y/scale << 'l';
+         }
+         else {
+            if(i>1) m_out << ' ';
+            m_out << (x-x0)/scale << ',' << (y-y0)/scale;
+         }
+         x0 = x;
+         y0 = y;
+      }
+      m_out << 'z';
    }
-   out << " z";
-   return out.str();
 }
@@ -18,26 +18,41 @@
 
 #include <memory>
 #include <string>
-#include <fstream>
+#include <vector>
 #include "dmesh/dpos2d.h"
+#include "buffered_writer.h"
 class polyset2d;
 class contour2d;
 class dbox2d;
 
 class svg_file {
 public:
-   svg_file();
+   typedef std::vector<std::pair<std::string,std::shared_ptr<polyset2d>>> polyset_layers;
+
+   // precision is number of decimals in path coordinates.
+   // relative=true gives compact path data using relative coordinates
+   svg_file(int precision = 6, bool relative = false);
    virtual ~svg_file();
 
    // export to SVG, return the path to the file created
    // input is full path to file, file extension will be replaced to ".svg"
    std::string  write( std::shared_ptr<polyset2d> polyset, const std::string& file_path);
 
+   // export each polyset as a named group, the outlines are not filled since the layers overlap
+   std::string  write( const polyset_layers& layers, const std::string& file_path);
+
 private:
    dpos2d to_svg(const dpos2d& p, const dbox2d& box);
 
-   // convert the contour into an SVG path sequence
-   std::string write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box);
+   // write the contour as an SVG path sequence
+   void write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box);
+
+   // write the path attribute data of all contours in polyset
+   void write_polyset(std::shared_ptr<polyset2d> polyset, const dbox2d& box);
+
+private:
+   buffered_writer m_out;
+   bool            m_relative;
 };
 
 #endif // SVG_FILE_H
@@ -16,111 +16,171 @@
 #include "sweep_mesh.h"
 
 #include "mesh_utils.h"
-#include <carve/matrix.hpp>
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
 
 
 sweep_mesh::sweep_mesh(std::shared_ptr<sweep_path> path, bool torus)
 : m_path(path)
-, m_polyhedron(new xpolyhedron())
 , m_torus(torus)
 {}
 
 sweep_mesh::~sweep_mesh()
 {}
 
-std::shared_ptr<xpolyhedron> sweep_mesh::polyhedron()
+std::shared_ptr<carve::mesh::MeshSet<3>> sweep_mesh::create_carve_mesh(const carve::math::Matrix& t)
 {
-   if(m_polyhedron->v_size() == 0) {
-      sweep();
+   if(m_data.points.size() == 0) {
+      sweep(t);
    }
-   return m_polyhedron;
+   carve::input::Options options;
+   return std::shared_ptr<carve::mesh::MeshSet<3>>(m_data.createMesh(options));
 }
 
-bool sweep_mesh::sweep()
+void sweep_mesh::sweep(const carve::math::Matrix& t)
 {
-   // obtain the number of sweep segments and the parameter step length
-   size_t nseg = m_path->nseg();
-   double dp = 1.0/double(nseg);
-
-   // traverse the sweep segments, i.e. parameter space p=[0,1]
-   size_t last_seg = nseg-1;
-   for(size_t iseg=0; iseg<nseg; iseg++) {
-
-      // obtain the transformed profile mesh at parameter value p, with all 3d coordinates already computed
-      double p = iseg*dp;
-      std::shared_ptr<const polymesh3d> mesh = m_path->profile(p);
-
-      // number of faces so far
-      // size_t f_offset  = m_polyhedron->f_size();
-
-      // offset to layer bottom vertices
-      size_t v_offset0 = m_polyhedron->v_size();
-      // add vertices for this layer by copying from the mesh
-      add_mesh_vertices(mesh);
-      // offset to layer top vertices can now be obtained
-      size_t v_offset1 =  m_polyhedron->v_size();
-
-      if(!m_torus && (iseg==0)) {
-         // 1st segment, add flipped faces from mesh
-         add_mesh_faces(v_offset0,mesh,true);
+   // obtain the layer parameters, the number of sweep segments is one less
+   const std::vector<double> params = m_path->parameters();
+   size_t nseg = params.size()-1;
+
+   // the bottom and top layers provide the end faces, so they are obtained first.
+   // They also fix the vertex and face counts, so every layer and segment has a precomputed offset
+   std::shared_ptr<const polymesh3d> bot = m_path->profile(0.0);
+   std::shared_ptr<const polymesh3d> top = (m_torus)? nullptr : m_path->profile(1.0);
+
+   const size_t nv    = bot->nvertices();
+   const size_t nside = side_faces(bot);
+   const size_t ncap  = (m_torus)? 0 : face_indices(bot);
+
+   // layer iseg vertices start at iseg*nv. In the face index table, the side faces of segment iseg
+   // start at ncap + iseg*nside*5 since they are quads
+   const size_t nvert = nseg*nv + ((m_torus)? 0 : top->nvertices());
+   const size_t nface = nseg*nside + ((m_torus)? 0 : bot->nfaces() + top->nfaces());
+   const size_t nind  = ncap + nseg*nside*5 + ((m_torus)? 0 : face_indices(top));
+   m_data.points.resize(nvert);
+   m_data.faceIndices.resize(nind);
+   m_data.faceCount = static_cast<int>(nface);
+
+   // a mirroring transform reverses all faces
+   const bool flip = mesh_utils::is_left_hand(t);
+
+   // a path sweeping a single profile provides it, so intermediate layers only transform its vertices
+   std::shared_ptr<const polymesh2d> layer = m_path->layer_profile();
+   if(layer.get() && layer->nvertices() != nv) layer.reset();
+
+   // the layers are independent given p. Each segment computes its bottom layer vertices and side faces
+   std::atomic<size_t> next_seg(0);
+   auto seg_task = [this,nseg,nv,nside,ncap,flip,&t,&params,&bot,&layer,&next_seg]() {
+      for(size_t iseg=next_seg++; iseg<nseg; iseg=next_seg++) {
+
+         // add vertices for this layer, from the shared profile or from the transformed profile mesh
+         // at parameter value p, with all 3d coordinates already computed
+         double p = params[iseg];
+         size_t v_offset0 = iseg*nv;
+         std::shared_ptr<const polymesh3d> mesh = bot;
+         if(iseg == 0) {
+            set_mesh_vertices(v_offset0,bot,t);
+         }
+         else if(layer.get()) {
+            set_layer_vertices(v_offset0,layer,t*m_path->layer_transform(p));
+         }
+         else {
+            mesh = m_path->profile(p);
+            if(mesh->nvertices() != nv || side_faces(mesh) != nside) {
+               throw std::logic_error("sweep_mesh: profile topology changes along the sweep path");
+            }
+            set_mesh_vertices(v_offset0,mesh,t);
+         }
+
+         // offset to layer top vertices
+         size_t v_offset1 = v_offset0 + nv;
+         if(m_torus && (iseg==nseg-1)) {
+            // connect side faces to bottom layer to create a topological torus
+            v_offset1 = 0;
+         }
+
+         create_side_faces(ncap + iseg*nside*5,v_offset0,v_offset1,mesh,flip);
       }
-
-      if(m_torus && (iseg==last_seg)) {
-         // connect side faces to bottom layer to create a topological torus
-         v_offset1 = 0;
-      }
-
-      // create side faces
-      create_side_faces(v_offset0,v_offset1,mesh,false);
+   };
+
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),nseg);
+   if(ntask <= 1) seg_task();
+   else {
+      task_group seg_tasks;
+      for(size_t itask=0; itask<ntask; itask++) seg_tasks.run(seg_task);
+      seg_tasks.wait();
    }
 
    if(!m_torus) {
-      // add normally oriented faces on top
-      double p = 1.0;
-      std::shared_ptr<const polymesh3d> mesh = m_path->profile(p);
-      size_t v_offset0 = m_polyhedron->v_size();
-      add_mesh_vertices(mesh);
-      add_mesh_faces(v_offset0, mesh,false);
+      // flipped faces at the bottom, normally oriented faces and the last layer on top
+      set_mesh_faces(0,0,bot,!flip);
+      size_t v_offset = nseg*nv;
+      set_mesh_vertices(v_offset,top,t);
+      set_mesh_faces(ncap + nseg*nside*5,v_offset,top,flip);
    }
 
-   // the polyhedron should now be complete
+   // the mesh data should now be complete
+}
 
-   return true;
+size_t sweep_mesh::side_faces(std::shared_ptr<const polymesh3d> mesh)
+{
+   size_t nside = 0;
+   for(size_t i=0; i<mesh->ncontours(); i++) nside += mesh->contour(i).size();
+   return nside;
 }
 
-void sweep_mesh::add_mesh_vertices(std::shared_ptr<const polymesh3d> mesh)
+size_t sweep_mesh::face_indices(std::shared_ptr<const polymesh3d> mesh)
+{
+   size_t nind = 0;
+   for(size_t i=0; i<mesh->nfaces(); i++) nind += 1 + mesh->face(i).size();
+   return nind;
+}
+
+void sweep_mesh::set_mesh_vertices(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, const carve::math::Matrix& t)
 {
    for(size_t iv=0; iv<mesh->nvertices(); iv++) {
-      m_polyhedron->v_add(mesh->vertex(iv));
+      m_data.points[v_offset+iv] = t * mesh->vertex(iv);
+   }
+}
+
+void sweep_mesh::set_layer_vertices(size_t v_offset, std::shared_ptr<const polymesh2d> layer, const carve::math::Matrix& t)
+{
+   for(size_t iv=0; iv<layer->nvertices(); iv++) {
+      const dpos2d& v = layer->vertex(iv);
+      m_data.points[v_offset+iv] = t * carve::geom::VECTOR(v.x(),v.y(),0.0);
    }
 }
 
-void sweep_mesh::add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse)
+void sweep_mesh::set_mesh_faces(size_t i_offset, size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse)
 {
+   std::vector<int>& ind = m_data.faceIndices;
    for(size_t i=0; i<mesh->nfaces(); i++) {
 
-      // take a copy here
-      polymesh3d::index_vector vinds = mesh->face(i);
-      for(size_t i=0;i<vinds.size();i++) {
-         vinds[i] += v_offset;
+      // face size, then the vertex indices with proper vertex offset
+      const index_span vinds = mesh->face(i);
+      size_t n = vinds.size();
+      ind[i_offset++] = static_cast<int>(n);
+      for(size_t k=0; k<n; k++) {
+         ind[i_offset++] = static_cast<int>(v_offset + vinds[(reverse)? n-1-k : k]);
       }
-
-      // add face indicies with proper vertex offset
-      m_polyhedron->f_add(vinds,reverse);
    }
 }
 
 
-void sweep_mesh::create_side_faces(size_t v_offset0, // vertex offset to bottom layer vertices
+void sweep_mesh::create_side_faces(size_t i_offset,  // face index table offset to the first side face
+                                   size_t v_offset0, // vertex offset to bottom layer vertices
                                    size_t v_offset1, // vertex offset to top layer vertices
                                    std::shared_ptr<const polymesh3d> mesh, bool reverse)
 {
    // v_offset = offset to 1st vertex in vertex layer below the faces to be created
 
+   std::vector<int>& ind = m_data.faceIndices;
    for(size_t i=0; i<mesh->ncontours(); i++) {
 
       // zero level vertex indicies for this contour
-      const polymesh3d::index_vector& vinds = mesh->contour(i);
+      const index_span vinds = mesh->contour(i);
       size_t nvc = vinds.size();
 
       // we must create nvc faces, where the last face connects to the first
@@ -130,7 +190,9 @@ void sweep_mesh::create_side_faces(size_t v_offset0, // vertex offset to bottom
          size_t iv1 = v_offset0 + ((ivc==(nvc-1))? vinds[0] : vinds[ivc+1]) ;
          size_t iv2 = iv1 + (v_offset1 - v_offset0);
          size_t iv3 = iv0 + (v_offset1 - v_offset0);
-         m_polyhedron->f_add( {iv0,iv1,iv2,iv3}, reverse );
+         size_t quad[] = { iv0,iv1,iv2,iv3 };
+         ind[i_offset++] = 4;
+         for(size_t k=0; k<4; k++) ind[i_offset++] = static_cast<int>(quad[(reverse)? 3-k : k]);
       }
    }
 }
@@ -19,31 +19,49 @@
 
 #include <memory>
 #include <vector>
-#include "xpolyhedron.h"
+#include <carve/mesh.hpp>
+#include <carve/input.hpp>
+#include <carve/matrix.hpp>
 #include "sweep_path.h"
 #include "polymesh3d.h"
 
+// sweep_mesh sweeps the profile of a sweep_path into a carve mesh.
+// Vertices and faces are written straight into the carve::input::PolyhedronData
+// at precomputed offsets, so the segments can be created in parallel
+
 class sweep_mesh {
 public:
    sweep_mesh(std::shared_ptr<sweep_path> path, bool torus);
    virtual ~sweep_mesh();
 
-   bool sweep();
-
-   std::shared_ptr<xpolyhedron> polyhedron();
+   // sweep the profile and return the mesh with the transform t applied
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix());
 
 private:
-   void add_mesh_vertices(std::shared_ptr<const polymesh3d> mesh);
-   void add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse);
+   void sweep(const carve::math::Matrix& t);
+
+   // transform and assign the vertices of a layer
+   void set_mesh_vertices(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, const carve::math::Matrix& t);
+   void set_layer_vertices(size_t v_offset, std::shared_ptr<const polymesh2d> layer, const carve::math::Matrix& t);
 
-   void create_side_faces(size_t v_offset0, // vertex offset to bottom layer vertices
+   // assign faces starting at index i_offset of the face index table
+   void set_mesh_faces(size_t i_offset, size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse);
+
+   void create_side_faces(size_t i_offset,  // face index table offset to the first side face
+                          size_t v_offset0, // vertex offset to bottom layer vertices
                           size_t v_offset1, // vertex offset to top layer vertices
                           std::shared_ptr<const polymesh3d> mesh, bool reverse);
 
+   // number of side faces per segment, one per contour edge
+   static size_t side_faces(std::shared_ptr<const polymesh3d> mesh);
+
+   // size of the faces of a mesh in the face index table, a count and the vertex indices per face
+   static size_t face_indices(std::shared_ptr<const polymesh3d> mesh);
+
 private:
-   std::shared_ptr<sweep_path>  m_path;
-   std::shared_ptr<xpolyhedron> m_polyhedron;
-   bool                         m_torus;  // true when the final topology shall become a torus
+   std::shared_ptr<sweep_path>     m_path;
+   carve::input::PolyhedronData    m_data;
+   bool                            m_torus;  // true when the final topology shall become a torus
 };
 
 #endif // SWEEP_MESH_H
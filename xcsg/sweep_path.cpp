@@ -20,3 +20,27 @@ sweep_path::sweep_path()
 
 sweep_path::~sweep_path()
 {}
+
+std::vector<double> sweep_path::parameters() const
+{
+   return uniform_parameters(nseg());
+}
+
+std::vector<double> sweep_path::uniform_parameters(size_t nseg)
+{
+   double dp = 1.0/double(nseg);
+   std::vector<double> p(nseg+1);
+   for(size_t iseg=0; iseg<nseg; iseg++) p[iseg] = iseg*dp;
+   p[nseg] = 1.0;
+   return p;
+}
+
+std::shared_ptr<const polymesh2d> sweep_path::layer_profile() const
+{
+   return nullptr;
+}
+
+carve::math::Matrix sweep_path::layer_transform(double p) const
+{
+   return carve::math::Matrix();
+}
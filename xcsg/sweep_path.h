@@ -17,6 +17,7 @@
 #define SWEEP_PATH_H
 
 #include <memory>
+#include <vector>
 #include "polymesh3d.h"
 
 // sweep path is the abstract base for sweeping a 2d mesh to become a 3d mesh
@@ -36,6 +37,20 @@ public:
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const = 0;
+
+   // return the nseg()+1 layer parameters, increasing from 0 to 1. The default spaces them uniformly
+   virtual std::vector<double> parameters() const;
+
+   // paths sweeping a single profile return it untransformed, so intermediate layers can be
+   // created by transforming its vertices only, without a polymesh3d per layer. Otherwise null
+   virtual std::shared_ptr<const polymesh2d> layer_profile() const;
+
+   // transform placing the layer profile at parameter p=[0,1]
+   virtual carve::math::Matrix layer_transform(double p) const;
+
+protected:
+   // nseg+1 uniformly spaced parameters from 0 to 1
+   static std::vector<double> uniform_parameters(size_t nseg);
 };
 
 #endif // SWEEP_PATH_H
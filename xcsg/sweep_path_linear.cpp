@@ -25,8 +25,12 @@ sweep_path_linear::~sweep_path_linear()
 
 std::shared_ptr<const polymesh3d> sweep_path_linear::profile(double p) const
 {
-   carve::math::Matrix t = carve::math::Matrix::TRANS(0.0,0.0,p*m_h);
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t));
+   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,layer_transform(p)));
+}
+
+carve::math::Matrix sweep_path_linear::layer_transform(double p) const
+{
+   return carve::math::Matrix::TRANS(0.0,0.0,p*m_h);
 }
 
 size_t sweep_path_linear::nseg() const
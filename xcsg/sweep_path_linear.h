@@ -32,6 +32,10 @@ public:
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
 
+   // the profile is shared by all layers
+   virtual std::shared_ptr<const polymesh2d> layer_profile() const { return m_pm2d; }
+   virtual carve::math::Matrix layer_transform(double p) const;
+
 private:
    std::shared_ptr<const polymesh2d> m_pm2d;
    double                            m_h;
@@ -23,7 +23,21 @@ sweep_path_rotate::sweep_path_rotate(std::shared_ptr<const polymesh2d> pm2d, dou
 , m_angle(angle)
 , m_nseg(nseg)
 , m_pitch(pitch)
+, m_pitch_radius(0.0)
 {
+   if(fabs(m_pitch) > 0.0) {
+
+      // obtain the Radius radius = 0.5*Dp of the center of the thread
+      double xmin = std::numeric_limits<double>::max();
+      double xmax = std::numeric_limits<double>::min();
+      for(size_t iv=0; iv!=m_pm2d->nvertices(); iv++) {
+         const dpos2d& vtx = m_pm2d->vertex(iv);
+         xmax = std::max(xmax,vtx.x());
+         xmin = std::min(xmin,vtx.x());
+      }
+      m_pitch_radius = (xmax+xmin)/2.0;
+   }
+
    if(m_nseg < 1) {
 
       // estimate the max radius of the profile
@@ -49,13 +63,30 @@ sweep_path_rotate::sweep_path_rotate(std::shared_ptr<const polymesh2d> pm2d, dou
       double alpha = m_angle/nseg;
       // guard against multiples of 2*pi
       // the resulting segment angle must be less than PI/2
-      while( (fabs(alpha)>0.5*pi) || (radius*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance()) ) {
+      while( (fabs(alpha)>0.5*pi) || (radius*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance(radius)) ) {
          nseg += 1;
          alpha = m_angle/nseg;
       }
 
       m_nseg = nseg;
    }
+
+   // tabulate the rotations at the layer parameters, so the layer transforms need no trigonometry
+   m_params = uniform_parameters(std::max(1,m_nseg));
+   m_cos.resize(m_params.size());
+   m_sin.resize(m_params.size());
+   for(size_t i=0; i<m_params.size(); i++) {
+      double angle = m_params[i]*fabs(m_angle);
+      m_cos[i] = cos(angle);
+      m_sin[i] = sin(angle);
+   }
+
+   if(fabs(m_pitch) > 0.0) {
+      // tilt the profile around the global X axis to accomodate the pitch angle
+      // notice the global sweep rotation axis is Y
+      double angle_pitch = atan(m_pitch/(2*pi*m_pitch_radius));
+      m_rot_pitch = carve::math::Matrix::ROT(angle_pitch,carve::geom::VECTOR(1.0,0.0,0.0));
+   }
 }
 
 sweep_path_rotate::~sweep_path_rotate()
@@ -64,46 +95,47 @@ sweep_path_rotate::~sweep_path_rotate()
 
 std::shared_ptr<const polymesh3d> sweep_path_rotate::profile(double p) const
 {
-   // negative rotate about Y
-  double angle = p*fabs(m_angle);
+   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,layer_transform(p)));
+}
 
-   // rotation matrix
-   carve::math::Matrix t = carve::math::Matrix::ROT(angle,carve::geom::VECTOR(0.0,1.0,0.0));
+carve::math::Matrix sweep_path_rotate::layer_transform(double p) const
+{
+   // negative rotate about Y
+   double angle = p*fabs(m_angle);
+
+   // look up the tabulated layer rotation, or compute it for other parameter values
+   double c,s;
+   size_t i = static_cast<size_t>(p*(m_params.size()-1) + 0.5);
+   if(i<m_params.size() && m_params[i]==p) {
+      c = m_cos[i];
+      s = m_sin[i];
+   }
+   else {
+      c = cos(angle);
+      s = sin(angle);
+   }
 
-/* below is eqivalent to ROT above
+   // rotation matrix, eqivalent to Matrix::ROT(angle,carve::geom::VECTOR(0.0,1.0,0.0))
    carve::math::Matrix t = carve::math::Matrix();
-   t.m[0][0] =  cos(angle);
-   t.m[2][0] = -sin(angle);
-   t.m[0][2] =  sin(angle);
-   t.m[2][2] =  cos(angle);
-*/
+   t.m[0][0] =  c;
+   t.m[2][0] = -s;
+   t.m[0][2] =  s;
+   t.m[2][2] =  c;
 
    if(fabs(m_pitch) > 0.0) {
 
-      double dy    = m_pitch*angle/(2*pi);
-
-
-      // obtain the Radius radius = 0.5*Dp of the center of the thread
-      double xmin = std::numeric_limits<double>::max();
-      double xmax = std::numeric_limits<double>::min();
-      for(size_t iv=0; iv!=m_pm2d->nvertices(); iv++) {
-         const dpos2d& vtx = m_pm2d->vertex(iv);
-         xmax = std::max(xmax,vtx.x());
-         xmin = std::min(xmin,vtx.x());
-      }
-      double radius = (xmax+xmin)/2.0;
-      double angle_pitch = atan(m_pitch/(2*pi*radius));
-
-      // tilt the profile around the global X axis to accomodate the pitch angle
-      // notice the global sweep rotation axis is Y
-      carve::math::Matrix rot_p = carve::math::Matrix::ROT(angle_pitch,carve::geom::VECTOR(1.0,0.0,0.0));
+      double dy = m_pitch*angle/(2*pi);
 
       // first rotate the pitch, then rotate around Y, then translate in Y
-      t  =  carve::math::Matrix::TRANS(0.0,dy,0.0) * t  * rot_p ;
+      t  =  carve::math::Matrix::TRANS(0.0,dy,0.0) * t  * m_rot_pitch;
    };
 
+   return t;
+}
 
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t));
+std::vector<double> sweep_path_rotate::parameters() const
+{
+   return m_params;
 }
 
 size_t sweep_path_rotate::nseg() const
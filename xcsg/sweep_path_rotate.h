@@ -36,11 +36,23 @@ public:
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
 
+   // return the layer parameters, the rotations at these are tabulated
+   virtual std::vector<double> parameters() const;
+
+   // the profile is shared by all layers
+   virtual std::shared_ptr<const polymesh2d> layer_profile() const { return m_pm2d; }
+   virtual carve::math::Matrix layer_transform(double p) const;
+
 private:
    std::shared_ptr<const polymesh2d> m_pm2d;
    double                            m_angle;  // extrusion angle
    double                            m_pitch;
    int                               m_nseg;   // number of extrusion segments
+   double                            m_pitch_radius;  // radius of the center of the thread
+   carve::math::Matrix               m_rot_pitch;     // profile tilt for the pitch angle
+   std::vector<double>               m_params;        // layer parameters
+   std::vector<double>               m_cos;           // cos of the rotation angle at each layer parameter
+   std::vector<double>               m_sin;           // sin of the rotation angle at each layer parameter
 };
 
 #endif // SWEEP_PATH_ROTATE_H
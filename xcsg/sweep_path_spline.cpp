@@ -15,6 +15,7 @@
 
 #include "sweep_path_spline.h"
 #include "mesh_utils.h"
+#include <algorithm>
 static const double pi = 4.0*atan(1.0);
 
 sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std::shared_ptr<const csplines::spline_path> path, int nseg)
@@ -22,12 +23,14 @@ sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std
 , m_path(path)
 , m_nseg(nseg)
 {
-   if(nseg < 1) {
+   const bool adaptive = (nseg < 1);
+   double c_max = 0.0;
+   if(adaptive) {
 
       // estimate the max curvature of the path
       std::shared_ptr<const csplines::spline_path> summed_path = path->summed_spline();
       int nseg_sample = 20;
-      double c_max = summed_path->max_curvature(nseg_sample);
+      c_max = summed_path->max_curvature(nseg_sample);
       if(c_max > 1.0E-5) {
 
          // start with a minimum of 2 segments and increase until the tolerance is satisfied
@@ -47,7 +50,7 @@ sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std
          // scale actual number of segments by known path length
 
          double arclen = 0.5*pi*radius;
-         double slen   = summed_path->length();
+         double slen   = summed_path->arc_length();
          double factor = slen/arclen;
 
          if(factor > 0.0) {
@@ -75,6 +78,16 @@ sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std
 
    // use number of segments at least as fine grained as the number of control points in the path
    if(path->size() > m_nseg)m_nseg =  static_cast<int>(path->size());
+
+   // an automatic number of segments is the uniform spacing for the highest curvature.
+   // Curved paths instead space the layers by the local curvature, so straight parts get few layers
+   if(m_nseg > 0 && adaptive && c_max > 1.0E-5) m_params = adaptive_parameters(path->size());
+   if(m_params.size() < 2) m_params = uniform_parameters(std::max(1,m_nseg));
+   m_nseg = static_cast<int>(m_params.size()-1);
+
+   // evaluate the path at all layers in one pass
+   m_path->pos(m_params,m_pos);
+   m_path->dir(m_params,m_dir);
 }
 
 sweep_path_spline::~sweep_path_spline()
@@ -82,6 +95,11 @@ sweep_path_spline::~sweep_path_spline()
 
 
 std::shared_ptr<const polymesh3d> sweep_path_spline::profile(double p) const
+{
+   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,layer_transform(p)));
+}
+
+carve::math::Matrix sweep_path_spline::layer_transform(double p) const
 {
    typedef carve::geom::vector<3> vec3d;
    const vec3d xglob = carve::geom::VECTOR( 1, 0, 0);
@@ -90,17 +108,16 @@ std::shared_ptr<const polymesh3d> sweep_path_spline::profile(double p) const
 
    carve::math::Matrix t = carve::math::Matrix::IDENT();
 
-   // get the curve point
-   csplines::cpoint cp = m_path->pos(p);
+   // get the curve point and the profile normal vector at parameter p
+   csplines::cpoint cp(0,0,0,0,0,0);
+   csplines::cpoint cp_dir(0,0,0,0,0,0);
+   frame(p,cp,cp_dir);
 
    // set curve position in transformation
    t.m[3][0] = cp.px;
    t.m[3][1] = cp.py;
    t.m[3][2] = cp.pz;
 
-   // get the profile normal vector at parameter p
-   csplines::cpoint cp_dir = m_path->dir(p);
-
    vec3d zdir = carve::geom::VECTOR( cp_dir.px, cp_dir.py, cp_dir.pz).normalize();
    vec3d ydir = carve::geom::VECTOR( cp_dir.vx, cp_dir.vy, cp_dir.vz);
 
@@ -134,11 +151,88 @@ std::shared_ptr<const polymesh3d> sweep_path_spline::profile(double p) const
    // profile scaling
    carve::math::Matrix tscale = carve::math::Matrix::SCALE(scale,scale,1.0);
 
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t*tscale));
+   return t*tscale;
+}
+
+std::vector<double> sweep_path_spline::parameters() const
+{
+   return m_params;
+}
+
+std::vector<double> sweep_path_spline::adaptive_parameters(size_t nmin) const
+{
+   // sample the path finely
+   const size_t nsample = 512;
+   const double dt      = 1.0/nsample;
+   std::vector<double> t(nsample+1);
+   for(size_t i=0; i<nsample; i++) t[i] = i*dt;
+   t[nsample] = 1.0;
+   std::vector<double> c;
+   std::vector<csplines::cpoint> cp;
+   m_path->curvature(t,c);
+   m_path->pos(t,cp);
+
+   // the profile reaches beyond the path by its largest vertex distance times the largest scaling,
+   // the secant tolerance applies at that radius
+   double rprof = 0.0;
+   for(size_t iv=0; iv<m_pm2d->nvertices(); iv++) {
+      const dpos2d& v = m_pm2d->vertex(iv);
+      rprof = std::max(rprof,sqrt(v.x()*v.x()+v.y()*v.y()));
+   }
+   double smax = 0.0;
+   for(auto& p : cp) smax = std::max(smax,p.length());
+   rprof *= smax;
+
+   // cumulative number of segments needed up to each sample, the path length
+   // of a sample comes from the arc length table of the path
+   const double tol = mesh_utils::secant_tolerance();
+   std::vector<double> nacc(nsample+1,0.0);
+   double s0 = 0.0;
+   for(size_t i=0; i<nsample; i++) {
+      double s1    = m_path->arc_length(t[i+1]);
+      double curv  = std::max(c[i],c[i+1]);
+      double nseg  = nmin*dt;
+      if(curv > 1.0E-5) {
+         // largest segment angle with sagitta within tolerance at the outer radius, at most 90 degrees
+         double radius = 1.0/curv + rprof;
+         double alpha  = 2.0*acos(std::max(-1.0,1.0-tol/radius));
+         alpha = std::min(alpha,0.5*pi);
+         nseg  = std::max(nseg,curv*(s1-s0)/alpha);
+      }
+      s0 = s1;
+      nacc[i+1] = nacc[i] + nseg;
+   }
+
+   // place the layers at equal steps of the cumulative count
+   size_t nlayer = std::max(size_t(1),static_cast<size_t>(ceil(nacc[nsample])));
+   std::vector<double> params(nlayer+1);
+   size_t i = 0;
+   for(size_t k=0; k<nlayer; k++) {
+      double target = k*nacc[nsample]/nlayer;
+      while(i < nsample-1 && nacc[i+1] < target) i++;
+      double dn = nacc[i+1]-nacc[i];
+      params[k] = t[i] + ((dn > 0.0)? dt*(target-nacc[i])/dn : 0.0);
+   }
+   params[0]      = 0.0;
+   params[nlayer] = 1.0;
+   return params;
 }
 
+void sweep_path_spline::frame(double p, csplines::cpoint& cp, csplines::cpoint& cp_dir) const
+{
+   // use the precomputed layer when p is one of them
+   auto it = std::lower_bound(m_params.begin(),m_params.end(),p);
+   if(it != m_params.end() && *it == p) {
+      size_t ilayer = it - m_params.begin();
+      cp     = m_pos[ilayer];
+      cp_dir = m_dir[ilayer];
+      return;
+   }
+   cp     = m_path->pos(p);
+   cp_dir = m_path->dir(p);
+}
 
 size_t sweep_path_spline::nseg() const
 {
-   return std::max(1,m_nseg);
+   return m_params.size()-1;
 }
@@ -31,12 +31,29 @@ public:
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
 
+   // the layer parameters, adaptive to the local curvature unless nseg was given
+   virtual std::vector<double> parameters() const;
+
+   // the profile is shared by all layers
+   virtual std::shared_ptr<const polymesh2d> layer_profile() const { return m_pm2d; }
+   virtual carve::math::Matrix layer_transform(double p) const;
+
 protected:
 
+   // path position and direction at parameter p
+   void frame(double p, csplines::cpoint& cp, csplines::cpoint& cp_dir) const;
+
+   // layer parameters spaced so each segment satisfies the secant tolerance at the local
+   // curvature, with at least nmin segments per unit parameter
+   std::vector<double> adaptive_parameters(size_t nmin) const;
+
 private:
    std::shared_ptr<const polymesh2d>            m_pm2d;
    std::shared_ptr<const csplines::spline_path> m_path;
    int                                          m_nseg;   // number of sweep segments
+   std::vector<double>                          m_params; // layer parameters
+   std::vector<csplines::cpoint>                m_pos;    // path positions at the layers
+   std::vector<csplines::cpoint>                m_dir;    // path directions at the layers
 };
 
 #endif // SWEEP_PATH_SPLINE_H
@@ -0,0 +1,82 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef THREAD_ENGINE_H
+#define THREAD_ENGINE_H
+
+#include <memory>
+
+// thread_engine<T> lends out an engine instance kept per thread, such as a carve CSG
+// or a Clipper, so its internal containers stay allocated between thousands of small
+// operations. The engine is cleared with thread_engine_clear() before it is lent out.
+// A thread waiting for a task_group may run another task, so while the thread's engine
+// is lent out a new one is created instead. The caller calls dismiss() once its operation
+// completed, an engine given back without it may be in any state and is replaced.
+
+// clear the engine for the next operation, specialized for engines that need it
+template <class T>
+inline void thread_engine_clear(T&) {}
+
+template <class T>
+class thread_engine {
+public:
+   thread_engine()
+   : m_slot(slot())
+   , m_dismissed(false)
+   {
+      if(m_slot.lent) m_own.reset(new T);
+      else {
+         if(!m_slot.engine.get()) m_slot.engine.reset(new T);
+         m_slot.lent = true;
+      }
+      thread_engine_clear(get());
+   }
+
+   ~thread_engine()
+   {
+      if(m_own.get()) return;
+      if(!m_dismissed) m_slot.engine.reset();
+      m_slot.lent = false;
+   }
+
+   T& get()         { return (m_own.get())? *m_own : *m_slot.engine; }
+   T& operator*()   { return get(); }
+   T* operator->()  { return &get(); }
+
+   // the operation completed, the engine is kept for the next one
+   void dismiss()   { m_dismissed = true; }
+
+private:
+   thread_engine(const thread_engine&) = delete;
+   thread_engine& operator=(const thread_engine&) = delete;
+
+   struct engine_slot {
+      engine_slot() : lent(false) {}
+      std::unique_ptr<T> engine;
+      bool               lent;
+   };
+
+   static engine_slot& slot()
+   {
+      static thread_local engine_slot s;
+      return s;
+   }
+
+   engine_slot&       m_slot;
+   std::unique_ptr<T> m_own;   // used when the thread's engine is already lent out
+   bool               m_dismissed;
+};
+
+#endif // THREAD_ENGINE_H
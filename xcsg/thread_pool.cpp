@@ -0,0 +1,391 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "thread_pool.h"
+#include "cancel_token.h"
+#include "node_profiler.h"
+#include "boolean_timer.h"
+#include <stdexcept>
+#include <chrono>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+// index of the pool worker running in this thread, -1 if not a pool worker
+static thread_local int pool_worker_index = -1;
+
+size_t& thread_pool::configured_nthreads()
+{
+   static size_t nthreads = 0;
+   return nthreads;
+}
+
+bool& thread_pool::configured_pin()
+{
+   static bool pin = false;
+   return pin;
+}
+
+std::atomic<bool>& thread_pool::created()
+{
+   static std::atomic<bool> flag(false);
+   return flag;
+}
+
+void thread_pool::configure(size_t nthreads, bool pin)
+{
+   if(created()) throw std::logic_error("thread_pool::configure must be called before the thread pool is used");
+   configured_nthreads() = nthreads;
+   configured_pin() = pin;
+}
+
+// a cpu available to the process and the NUMA node it belongs to
+struct cpu_node {
+   int cpu;
+   int node;
+};
+
+#ifdef __linux__
+// parse a sysfs cpu list such as "0-31,64-95"
+static std::vector<int> parse_cpulist(const std::string& text)
+{
+   std::vector<int> cpus;
+   std::istringstream in(text);
+   std::string range;
+   while(std::getline(in,range,',')) {
+      int first = 0, last = 0;
+      char dash = 0;
+      std::istringstream rin(range);
+      if(!(rin >> first)) continue;
+      if(rin >> dash >> last) { for(int cpu=first; cpu<=last; cpu++) cpus.push_back(cpu); }
+      else cpus.push_back(first);
+   }
+   return cpus;
+}
+#endif
+
+// the cpus the process may run on, ordered by NUMA node. Empty where pinning is not supported
+static std::vector<cpu_node> numa_cpus()
+{
+   std::vector<cpu_node> cpus;
+#if defined(_WIN32)
+   DWORD_PTR process_mask = 0, system_mask = 0;
+   if(!GetProcessAffinityMask(GetCurrentProcess(),&process_mask,&system_mask)) return cpus;
+   std::vector<cpu_node> unordered;
+   for(int cpu=0; cpu<int(8*sizeof(DWORD_PTR)); cpu++) {
+      if(!(process_mask & (DWORD_PTR(1) << cpu))) continue;
+      UCHAR node = 0;
+      if(!GetNumaProcessorNode(UCHAR(cpu),&node)) node = 0;
+      unordered.push_back({cpu,int(node)});
+   }
+   std::stable_sort(unordered.begin(),unordered.end(),[](const cpu_node& a, const cpu_node& b) { return a.node < b.node; });
+   cpus = unordered;
+#elif defined(__linux__)
+   cpu_set_t allowed;
+   CPU_ZERO(&allowed);
+   if(sched_getaffinity(0,sizeof(allowed),&allowed) != 0) return cpus;
+
+   // the cpus of each node, nodes in numerical order
+   std::set<int> assigned;
+   boost::system::error_code ec;
+   std::vector<std::pair<int,std::string>> nodes;
+   for(boost::filesystem::directory_iterator i("/sys/devices/system/node",ec),iend; !ec && i!=iend; i.increment(ec)) {
+      std::string name = i->path().filename().string();
+      if(name.compare(0,4,"node") != 0 || name.length() == 4 || name.find_first_not_of("0123456789",4) != std::string::npos) continue;
+      nodes.push_back(std::make_pair(std::stoi(name.substr(4)),(i->path() / "cpulist").string()));
+   }
+   std::sort(nodes.begin(),nodes.end());
+   for(auto& n : nodes) {
+      std::ifstream in(n.second);
+      std::string text;
+      std::getline(in,text);
+      for(int cpu : parse_cpulist(text)) {
+         if(cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu,&allowed) && assigned.insert(cpu).second) cpus.push_back({cpu,n.first});
+      }
+   }
+
+   // no NUMA information, all cpus on one node
+   for(int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+      if(CPU_ISSET(cpu,&allowed) && assigned.insert(cpu).second) cpus.push_back({cpu,0});
+   }
+#endif
+   return cpus;
+}
+
+// bind the calling thread to cpu, returns false if not supported
+static bool pin_current_thread(int cpu)
+{
+#if defined(_WIN32)
+   return SetThreadAffinityMask(GetCurrentThread(),DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   CPU_SET(cpu,&set);
+   return pthread_setaffinity_np(pthread_self(),sizeof(set),&set) == 0;
+#else
+   (void)cpu;
+   return false;
+#endif
+}
+
+thread_pool& thread_pool::singleton()
+{
+   size_t nthreads = configured_nthreads();
+   if(nthreads == 0) nthreads = boost::thread::hardware_concurrency();
+   static thread_pool instance((nthreads>0)? nthreads : 1);
+   return instance;
+}
+
+thread_pool::thread_pool(size_t nthreads)
+: m_pinned(false)
+, m_nnodes(1)
+, m_pending(0)
+, m_stop(false)
+{
+   created() = true;
+
+   // the thread waiting for a task_group also executes tasks, so it counts as one
+   size_t nworkers = (nthreads>0)? nthreads-1 : 0;
+   for(size_t i=0; i<nworkers; i++) {
+      m_deques.push_back(std::unique_ptr<task_deque>(new task_deque));
+   }
+
+   // workers next to each other in index share a node, so fewer workers than cpus stay on the first nodes
+   m_cpu.assign(nworkers,-1);
+   m_node.assign(nworkers,0);
+   std::vector<cpu_node> cpus;
+   if(configured_pin() && nworkers > 0) cpus = numa_cpus();
+   if(cpus.size() > 0) {
+      std::set<int> nodes;
+      for(size_t i=0; i<nworkers; i++) {
+         const cpu_node& c = cpus[i%cpus.size()];
+         m_cpu[i]  = c.cpu;
+         m_node[i] = c.node;
+         nodes.insert(c.node);
+      }
+      m_pinned = true;
+      m_nnodes = nodes.size();
+   }
+   for(size_t i=0; i<nworkers; i++) {
+      m_threads.push_back(boost::thread(&thread_pool::worker,this,i));
+   }
+}
+
+thread_pool::~thread_pool()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+   }
+   m_cv.notify_all();
+   for(auto& thread : m_threads) {
+      thread.join();
+   }
+}
+
+void thread_pool::submit(task t)
+{
+   int index = pool_worker_index;
+   task_deque& tq = (index >= 0 && size_t(index) < m_deques.size())? *m_deques[index] : m_shared;
+   {
+      std::lock_guard<std::mutex> lock(tq.m);
+      tq.q.push_back(std::move(t));
+   }
+   {
+      // increment under the pool mutex so a worker about to sleep cannot miss it
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending++;
+   }
+   m_cv.notify_one();
+}
+
+bool thread_pool::pop_task(int index, task& t)
+{
+   // own deque first, newest task first (depth first, cache friendly)
+   if(index >= 0) {
+      task_deque& tq = *m_deques[index];
+      std::lock_guard<std::mutex> lock(tq.m);
+      if(!tq.q.empty()) {
+         t = std::move(tq.q.back());
+         tq.q.pop_back();
+         m_pending--;
+         return true;
+      }
+   }
+
+   // then tasks submitted from outside the pool
+   {
+      std::lock_guard<std::mutex> lock(m_shared.m);
+      if(!m_shared.q.empty()) {
+         t = std::move(m_shared.q.front());
+         m_shared.q.pop_front();
+         m_pending--;
+         return true;
+      }
+   }
+
+   // finally steal the oldest task from another worker. Pinned workers look on their own
+   // NUMA node first, where the inputs of the task were most likely allocated
+   size_t nq = m_deques.size();
+   size_t start = (index >= 0)? size_t(index)+1 : 0;
+   const bool local_first = m_pinned && index >= 0 && m_nnodes > 1;
+   for(int pass=(local_first)? 0 : 1; pass<2; pass++) {
+      for(size_t i=0; i<nq; i++) {
+         size_t victim = (start+i)%nq;
+         if(int(victim) == index)continue;
+         if(local_first && (m_node[victim] == m_node[index]) != (pass == 0)) continue;
+         task_deque& tq = *m_deques[victim];
+         std::lock_guard<std::mutex> lock(tq.m);
+         if(!tq.q.empty()) {
+            t = std::move(tq.q.front());
+            tq.q.pop_front();
+            m_pending--;
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+size_t thread_pool::active() const
+{
+   size_t nactive = 0;
+   for(auto& d : m_deques) {
+      if(d->active.load(std::memory_order_relaxed)) nactive++;
+   }
+   return nactive;
+}
+
+bool thread_pool::run_pending_task()
+{
+   task t;
+   if(pop_task(pool_worker_index,t)) {
+      t();
+      return true;
+   }
+   return false;
+}
+
+void thread_pool::worker(size_t index)
+{
+   pool_worker_index = int(index);
+   if(m_cpu[index] >= 0) pin_current_thread(m_cpu[index]);
+   while(true) {
+      task t;
+      if(pop_task(pool_worker_index,t)) {
+         m_deques[index]->active.store(true,std::memory_order_relaxed);
+         t();
+         m_deques[index]->active.store(false,std::memory_order_relaxed);
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock,[this]() { return m_stop || m_pending > 0; });
+      if(m_stop && m_pending==0) break;
+   }
+}
+
+
+task_group::task_group(thread_pool& pool)
+: m_pool(pool)
+, m_count(0)
+{}
+
+task_group::~task_group()
+{
+   // make sure no task refers to this group after destruction
+   try { wait(); }
+   catch(...) {}
+}
+
+void task_group::run(thread_pool::task t)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_count++;
+   }
+   // the task runs on behalf of the profiled node that submitted it.
+   // It is moved into the pool task, not copied
+   int profile_node = node_profiler::current();
+   m_pool.submit(std::bind(&task_group::execute,this,std::move(t),profile_node));
+}
+
+void task_group::execute(const thread_pool::task& t, int profile_node)
+{
+   try {
+      node_profiler::scope scope(profile_node);
+
+      // tasks queued after a cancellation or a failed task of the group are skipped
+      cancel_token::singleton().check();
+      bool failed = false;
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         failed = static_cast<bool>(m_exception);
+      }
+      if(!failed) t();
+   }
+   catch(std::exception&) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!m_exception)m_exception = std::current_exception();
+   }
+   catch(...) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!m_exception)m_exception = std::make_exception_ptr(std::logic_error("unknown exception in thread_pool task"));
+   }
+   finish_task();
+}
+
+void task_group::finish_task()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(--m_count == 0) m_cv.notify_all();
+}
+
+void task_group::wait()
+{
+   while(true) {
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         if(m_count == 0)break;
+      }
+
+      // help executing pool tasks while waiting, otherwise sleep briefly
+      if(!m_pool.run_pending_task()) {
+         std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+         {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock,std::chrono::milliseconds(1),[this]() { return m_count == 0; });
+         }
+         std::chrono::duration<double> waited = std::chrono::steady_clock::now() - t0;
+         boolean_timer::singleton().add_wait(waited.count());
+      }
+   }
+
+   std::exception_ptr ex;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      std::swap(ex,m_exception);
+   }
+   if(ex) std::rethrow_exception(ex);
+}
@@ -0,0 +1,145 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <boost/thread.hpp>
+
+// thread_pool is a process-wide work-stealing pool of boost::threads.
+// Each worker owns a task deque. Tasks submitted from a worker go to the back
+// of its own deque and are popped LIFO, idle workers steal from the front of
+// other deques. Tasks submitted from other threads go to a shared queue.
+// Nested CSG nodes therefore share the same workers instead of spawning threads.
+// Optionally the workers are pinned to cpus, filling one NUMA node after the other.
+// Memory is then allocated on the node of the worker first touching it, and idle
+// workers steal from workers on their own node before crossing to another node.
+
+class thread_pool {
+public:
+   typedef std::function<void()> task;
+
+   // the process-wide pool
+   static thread_pool& singleton();
+
+   // set number of threads before first use of singleton(), 0 means hardware concurrency.
+   // The thread waiting for results counts as one, so nthreads=1 runs all tasks
+   // sequentially in the calling thread (deterministic mode).
+   // With pin=true each worker is bound to one cpu, where the platform supports it
+   static void configure(size_t nthreads, bool pin = false);
+
+   // true when the pool has been created, after that configure() is not allowed
+   static bool is_created() { return created(); }
+
+   // number of threads executing tasks, including the waiting thread
+   size_t nthreads() const { return m_threads.size()+1; }
+
+   // true when the workers are pinned to cpus, and the number of NUMA nodes they cover
+   bool pinned() const { return m_pinned; }
+   size_t nnodes() const { return m_nnodes; }
+
+   // number of workers executing a task, sampled by progress reports.
+   // Each worker flags only itself, so running tasks touch no shared counter
+   size_t active() const;
+
+   // submit a task for execution
+   void submit(task t);
+
+   // execute one pending task in the calling thread, if any.
+   // returns false if no task was found
+   bool run_pending_task();
+
+protected:
+   thread_pool(size_t nthreads);
+   virtual ~thread_pool();
+
+   // worker thread main loop
+   void worker(size_t index);
+
+   // find a task for worker index (index=-1 means not a worker)
+   bool pop_task(int index, task& t);
+
+private:
+   thread_pool(const thread_pool&) = delete;
+   thread_pool& operator=(const thread_pool&) = delete;
+
+   static size_t& configured_nthreads();
+   static bool& configured_pin();
+   static std::atomic<bool>& created();
+
+   struct task_deque {
+      task_deque() : active(false) {}
+      std::mutex        m;
+      std::deque<task>  q;
+      std::atomic<bool> active;   // written by the owning worker only
+   };
+
+   std::vector<std::unique_ptr<task_deque>> m_deques;   // one per worker
+   task_deque                               m_shared;   // tasks from non-worker threads
+   std::vector<boost::thread>               m_threads;
+   std::vector<int>                         m_cpu;      // pinned cpu per worker, -1 if not pinned
+   std::vector<int>                         m_node;     // NUMA node per worker
+   bool                                     m_pinned;
+   size_t                                   m_nnodes;
+
+   std::atomic<size_t>      m_pending;  // number of queued tasks
+   bool                     m_stop;
+   std::mutex               m_mutex;
+   std::condition_variable  m_cv;
+};
+
+// task_group collects tasks submitted to the thread_pool so they can be waited for.
+// A thread waiting in a task_group executes pending pool tasks while waiting,
+// so waiting inside a pool task (nested CSG nodes) does not starve the pool.
+
+class task_group {
+public:
+   task_group(thread_pool& pool = thread_pool::singleton());
+   virtual ~task_group();
+
+   // submit a task to the pool as part of this group
+   void run(thread_pool::task t);
+
+   // wait for all tasks in the group to complete.
+   // The first exception escaping a task is rethrown here, the remaining tasks
+   // of the group are skipped. Other groups and the cancel_token are not affected
+   void wait();
+
+protected:
+   // run t as a member of the group, called by the pool
+   void execute(const thread_pool::task& t, int profile_node);
+   void finish_task();
+
+private:
+   task_group(const task_group&) = delete;
+   task_group& operator=(const task_group&) = delete;
+
+   thread_pool&             m_pool;
+   size_t                   m_count;      // tasks not yet completed
+   std::exception_ptr       m_exception;  // first exception, if any
+   std::mutex               m_mutex;
+   std::condition_variable  m_cv;
+};
+
+#endif // THREAD_POOL_H
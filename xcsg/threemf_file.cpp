@@ -0,0 +1,174 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "threemf_file.h"
+#include "buffered_writer.h"
+#include "zip_writer.h"
+#include "trace_writer.h"
+#include <ctime>
+#include <stdexcept>
+#include <algorithm>
+#include <map>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/convenience.hpp>
+
+// significant digits in coordinates, 3MF consumers use single precision as in binary STL
+static const int coordinate_digits = 9;
+
+static const char* content_types =
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">\n"
+   " <Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>\n"
+   " <Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\"/>\n"
+   "</Types>\n";
+
+static const char* relationships =
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">\n"
+   " <Relationship Target=\"/3D/3dmodel.model\" Id=\"rel0\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\"/>\n"
+   "</Relationships>\n";
+
+// escape text for XML element content
+static std::string xml_escape(const std::string& text)
+{
+   std::string escaped;
+   for(char c : text) {
+      switch(c) {
+         case '&':  escaped += "&amp;";  break;
+         case '<':  escaped += "&lt;";   break;
+         case '>':  escaped += "&gt;";   break;
+         default:   escaped += c;
+      }
+   }
+   return escaped;
+}
+
+threemf_file::threemf_file()
+{
+   //ctor
+}
+
+threemf_file::~threemf_file()
+{
+   //dtor
+}
+
+std::string threemf_file::write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path)
+{
+   trace_span span("write_3mf","export");
+   // ISO8601 date of current time
+   time_t now = time(0);
+   const size_t blen = 80;
+   char buffer[blen];
+   strftime(buffer,blen,"%Y-%m-%d",gmtime(&now));
+   std::string iso8601(buffer);
+
+   boost::filesystem::path fullpath(file_path);
+   boost::filesystem::path tmf_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = tmf_path.string() + ".3mf";
+
+   // fix inconsistent slashes to something that is consistent and works everytwhere
+   std::replace(path.begin(),path.end(), '\\', '/');
+
+   zip_writer archive;
+   if(!archive.open(path)) throw std::runtime_error("threemf_file::write(...)  Failed to open: " + path);
+
+   archive.begin_entry("[Content_Types].xml");
+   archive.write(content_types);
+   archive.begin_entry("_rels/.rels");
+   archive.write(relationships);
+
+   buffered_writer out;
+   out.open(archive,"3D/3dmodel.model");
+   out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+   out << "<model unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n";
+   out << " <metadata name=\"Title\">" << xml_escape(fullpath.stem().string()) << "</metadata>\n";
+   out << " <metadata name=\"Application\">xcsg</metadata>\n";
+   out << " <metadata name=\"CreationDate\">" << iso8601 << "</metadata>\n";
+
+   // one object per lump, object ids must be positive. Instances of another lump
+   // are build items referring to the object of that lump, with a translation
+   std::map<const triangle_mesh*,size_t> object_ids;
+   for(size_t imesh=0; imesh<meshes->size(); imesh++) {
+      const triangle_mesh* mesh = (*meshes)[imesh].get();
+      if(!mesh->source()) object_ids[mesh] = imesh+1;
+   }
+   out << " <resources>\n";
+   for(size_t imesh=0; imesh<meshes->size(); imesh++) {
+      const triangle_mesh* mesh = (*meshes)[imesh].get();
+      if(!mesh->source() || object_ids.find(mesh->source().get()) == object_ids.end()) {
+         write_3mf_object(out,*mesh,imesh+1);
+      }
+   }
+   out << " </resources>\n";
+
+   out << " <build>\n";
+   for(size_t imesh=0; imesh<meshes->size(); imesh++) {
+      const triangle_mesh* mesh = (*meshes)[imesh].get();
+      auto it = (mesh->source())? object_ids.find(mesh->source().get()) : object_ids.end();
+      if(it == object_ids.end()) {
+         out << "  <item objectid=\"" << imesh+1 << "\"/>\n";
+      }
+      else {
+         std::string transform = "1 0 0 0 1 0 0 0 1";
+         for(size_t k=0; k<3; k++) {
+            transform += ' ';
+            buffered_writer::append_general(transform,mesh->offset().v[k],coordinate_digits);
+         }
+         out << "  <item objectid=\"" << it->second << "\" transform=\"" << transform << "\"/>\n";
+      }
+   }
+   out << " </build>\n";
+   out << "</model>\n";
+   out.close();
+   archive.close();
+
+   return path;
+}
+
+void threemf_file::write_3mf_object(buffered_writer& out, const triangle_mesh& mesh, size_t id)
+{
+   out << "  <object id=\"" << id << "\" type=\"model\">\n";
+   out << "   <mesh>\n";
+
+   out << "    <vertices>\n";
+   out.write_chunked(mesh.nvertices(),[&mesh](size_t ivert, std::string& text) {
+      const xvertex& vtx = mesh.vertex(ivert);
+      text += "     <vertex x=\"";
+      buffered_writer::append_general(text,vtx.v[0],coordinate_digits);
+      text += "\" y=\"";
+      buffered_writer::append_general(text,vtx.v[1],coordinate_digits);
+      text += "\" z=\"";
+      buffered_writer::append_general(text,vtx.v[2],coordinate_digits);
+      text += "\"/>\n";
+   });
+   out << "    </vertices>\n";
+
+   out << "    <triangles>\n";
+   out.write_chunked(mesh.ntriangles(),[&mesh](size_t itri, std::string& text) {
+      const size_t* tri = mesh.triangle(itri);
+      text += "     <triangle v1=\"";
+      buffered_writer::append(text,tri[0]);
+      text += "\" v2=\"";
+      buffered_writer::append(text,tri[1]);
+      text += "\" v3=\"";
+      buffered_writer::append(text,tri[2]);
+      text += "\"/>\n";
+   });
+   out << "    </triangles>\n";
+
+   out << "   </mesh>\n";
+   out << "  </object>\n";
+}
@@ -0,0 +1,42 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef THREEMF_FILE_H
+#define THREEMF_FILE_H
+
+class buffered_writer;
+#include <vector>
+#include <memory>
+#include <string>
+#include "triangle_mesh.h"
+
+// 3MF (3D Manufacturing Format) export. The model XML is streamed directly
+// into a deflate compressed zip container, one 3MF object per lump.
+
+class threemf_file {
+public:
+   typedef triangle_mesh::mesh_vector mesh_vector;
+
+   threemf_file();
+   virtual ~threemf_file();
+
+   // export to 3MF, return the path to the file created
+   // input is full path to file, file extension will be replaced to ".3mf"
+   std::string  write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path);
+
+protected:
+   void write_3mf_object(buffered_writer& out, const triangle_mesh& mesh, size_t id);
+};
+
+#endif // THREEMF_FILE_H
@@ -12,69 +12,89 @@
 // INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
 // A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
 // EndLicense:
-
 #include "tin_mesh.h"
+#include "mesh_utils.h"
 #include "dmesh/dmesh.h"
 #include "dmesh/dtriangle.h"
+#include "dmesh/dcoedge.h"
+#include "dmesh/dedge.h"
+#include <carve/input.hpp>
 #include <algorithm>
-#include <iostream>
+#include <limits>
+#include <stdexcept>
 
-std::shared_ptr<tin_mesh::tpoly> tin_mesh::make_tin(std::shared_ptr<tpoly> poly)
+tin_mesh::MeshSet_ptr tin_mesh::make_tin(const std::vector<xvertex>& vertices, const carve::math::Matrix& t)
 {
+   const size_t npoint = vertices.size();
+   if(npoint < 3) throw std::logic_error("tin_model: at least 3 vertices required, but found " + std::to_string(npoint));
 
+   // compute delaunay mesh in XY, dmesh inserts the points in spatially sorted order
    dmesh mesh;
-
-   // convert 3d points to 2d
-   std::vector<dpos2d> points;
-   points.reserve(poly->m_vert.size());
-   for( auto& v : poly->m_vert) {
-      points.push_back(dpos2d(v.x,v.y));
+   {
+      std::vector<dpos2d> points;
+      points.reserve(npoint);
+      for(auto& v : vertices) points.push_back(dpos2d(v.x,v.y));
+      mesh.triangulate_point_cloud(points);
    }
 
-   // compute delaunay mesh
-   mesh.triangulate_point_cloud(points);
-
-   // get triangles
-   poly->m_face.reserve(mesh.size());
-   for(dtriangle* t : mesh) {
-      size_t v1 = t->vertex1()-3;
-      size_t v2 = t->vertex2()-3;
-      size_t v3 = t->vertex3()-3;
-      poly->m_face.push_back({v1,v2,v3});
+   // the dmesh vertices are offset by its 3 supervertices.
+   // Only vertices used by triangles become mesh vertices
+   const size_t unused = std::numeric_limits<size_t>::max();
+   std::vector<size_t> index(npoint,unused);
+   for(dtriangle* tri : mesh) {
+      index[tri->vertex1()-3] = 0;
+      index[tri->vertex2()-3] = 0;
+      index[tri->vertex3()-3] = 0;
    }
-
-   return close_tin(poly,mesh);
-}
-
-std::shared_ptr<tin_mesh::tpoly> tin_mesh::close_tin(std::shared_ptr<tpoly> poly, dmesh& mesh)
-{
-   size_t nvert = poly->m_vert.size();
-   size_t nface = poly->m_face.size();
-
-   // compute min and max z
-   double zmin = poly->m_vert[0].z;
-   double zmax = zmin;
-   for( auto& v : poly->m_vert) {
-      zmin = std::min(zmin,v.z);
-      zmax = std::max(zmax,v.z);
+   size_t ntop = 0;
+   double zmin =  std::numeric_limits<double>::max();
+   double zmax = -std::numeric_limits<double>::max();
+   double xmin = zmin, xmax = zmax;
+   for(size_t i=0; i<npoint; i++) {
+      if(index[i] == unused) continue;
+      index[i] = ntop++;
+      zmin = std::min(zmin,vertices[i].z); zmax = std::max(zmax,vertices[i].z);
+      xmin = std::min(xmin,vertices[i].x); xmax = std::max(xmax,vertices[i].x);
+   }
+   if(ntop == 0) throw std::logic_error("tin_model: the vertices could not be triangulated");
+
+   // the base is below the lowest point, also when the terrain is flat
+   double depth = 0.1*(zmax-zmin);
+   if(depth <= 0.0) depth = 0.1*(xmax-xmin);
+   if(depth <= 0.0) depth = 1.0;
+   const double zbase = zmin - depth;
+
+   // top vertices followed by the base vertices below them
+   carve::input::PolyhedronData data;
+   data.points.resize(2*ntop);
+   for(size_t i=0; i<npoint; i++) {
+      if(index[i] == unused) continue;
+      const xvertex& v = vertices[i];
+      data.points[index[i]]      = v;
+      data.points[ntop+index[i]] = carve::geom::VECTOR(v.x,v.y,zbase);
+   }
+   mesh_utils::transform(t,&data.points[0],data.points.size(),&data.points[0]);
+
+   // top faces, reversed base faces and a wall quad along every boundary edge.
+   // A boundary edge is used by one triangle only, and the outside is to its right
+   data.reserveFaces(static_cast<int>(2*mesh.size()),3);
+   for(dtriangle* tri : mesh) {
+      int a = static_cast<int>(index[tri->vertex1()-3]);
+      int b = static_cast<int>(index[tri->vertex2()-3]);
+      int c = static_cast<int>(index[tri->vertex3()-3]);
+      data.addFace(a,b,c);
+      data.addFace(int(ntop)+c,int(ntop)+b,int(ntop)+a);
+
+      for(size_t i=0; i<3; i++) {
+         const dcoedge* coedge = tri->coedge(i);
+         if(coedge->edge()->use_count() != 1) continue;
+         int v1 = static_cast<int>(index[coedge->vertex1()-3]);
+         int v2 = static_cast<int>(index[coedge->vertex2()-3]);
+         int wall[4] = { v1, int(ntop)+v1, int(ntop)+v2, v2 };
+         data.addFace(wall,wall+4);
+      }
    }
-   double diff = zmax-zmin;
-
-
-
-   std::shared_ptr<tpoly> cpoly = std::shared_ptr<tpoly>(new tpoly( std::vector<txyz>()));
-   cpoly->m_vert.reserve(nvert*2);
-   cpoly->m_face.reserve(nface*2);
-
-   // z coordinate of bottom vertices
-   double zlow = zmin-diff*0.1;
-   for( auto& v : poly->m_vert) cpoly->m_vert.push_back(txyz(v.x,v.y,zlow));  // bottom vertices
-   for( auto& v : poly->m_vert) cpoly->m_vert.push_back(v);                   // top vertices
-
-
-   for( auto& f : poly->m_face)  cpoly->m_face.push_back({f[2],f[1],f[0]});    // bottom faces (reversed)
-   for( auto& f : poly->m_face) cpoly->m_face.push_back({f[0]+nvert,f[1]+nvert,f[2]+nvert}); // top faces
-
 
-   return cpoly;
+   carve::input::Options options;
+   return MeshSet_ptr(data.createMesh(options));
 }
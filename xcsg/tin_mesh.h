@@ -12,36 +12,26 @@
 // INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
 // A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
 // EndLicense:
-
 #ifndef TIN_MESH_H
 #define TIN_MESH_H
 
 #include <memory>
 #include <vector>
-class dmesh;
+#include <carve/mesh.hpp>
+#include <carve/matrix.hpp>
+#include "xshape.h"
+
+// tin_mesh turns a terrain point cloud into a closed solid.
+// The points are triangulated in XY (Delaunay, inserted in spatially sorted order),
+// the surface is closed by walls along the boundary down to a flat base below the lowest point,
+// and the faces are emitted directly into the carve mesh without intermediate polyhedra.
 
 class tin_mesh {
 public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
 
-   struct txyz {
-      txyz(double tx,double ty, double tz): x(tx),y(ty),z(tz) {}
-      double x,y,z;
-   };
-
-   typedef std::vector<size_t>  pface;
-   struct tpoly {
-      tpoly(const std::vector<txyz>& vertices) : m_vert(vertices) {}
-      std::vector<txyz>   m_vert;
-      std::vector<pface>  m_face;
-   };
-
-   // perform inital meshing of original points, returns non-closed mesh
-   static std::shared_ptr<tpoly> make_tin(std::shared_ptr<tpoly> poly);
-
-private:
-   // convert non-closed mesh to closed polyhedron
-   static std::shared_ptr<tpoly> close_tin(std::shared_ptr<tpoly> poly, dmesh& mesh);
-
+   // return the closed TIN solid of the vertices, transformed by t
+   static MeshSet_ptr make_tin(const std::vector<xvertex>& vertices, const carve::math::Matrix& t);
 };
 
 #endif // TIN_MESH_H
@@ -0,0 +1,89 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "trace_writer.h"
+#include <fstream>
+
+trace_writer::trace_writer()
+: m_enabled(false)
+{}
+
+trace_writer::~trace_writer()
+{}
+
+void trace_writer::open(const std::string& path)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_path  = path;
+   m_start = boost::posix_time::microsec_clock::universal_time();
+   m_events.clear();
+   m_threads.clear();
+   thread_id();   // the opening thread is the main thread
+   m_enabled = true;
+}
+
+long long trace_writer::now() const
+{
+   return (boost::posix_time::microsec_clock::universal_time() - m_start).total_microseconds();
+}
+
+int trace_writer::thread_id()
+{
+   auto i = m_threads.find(boost::this_thread::get_id());
+   if(i != m_threads.end()) return i->second;
+
+   int tid = static_cast<int>(m_threads.size()) + 1;
+   m_threads[boost::this_thread::get_id()] = tid;
+   return tid;
+}
+
+void trace_writer::add(const std::string& name, const std::string& category, long long ts, long long dur)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(!m_enabled) return;
+
+   event e;
+   e.name     = name;
+   e.category = category;
+   e.ts       = ts;
+   e.dur      = dur;
+   e.tid      = thread_id();
+   m_events.push_back(e);
+}
+
+bool trace_writer::close()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(!m_enabled) return false;
+   m_enabled = false;
+
+   std::ofstream out(m_path);
+   if(!out.is_open()) return false;
+
+   out << "{\"traceEvents\":[" << std::endl;
+   for(size_t i=0; i<m_events.size(); i++) {
+      const event& e = m_events[i];
+      out << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\""
+          << ",\"ts\":" << e.ts << ",\"dur\":" << e.dur << ",\"pid\":1,\"tid\":" << e.tid << "}"
+          << ((i+1<m_events.size())? ",":"") << std::endl;
+   }
+   // name the threads, the main thread is registered first
+   for(auto& t : m_threads) {
+      out << ((m_events.size()>0 || t.second>1)? ",":"") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t.second
+          << ",\"args\":{\"name\":\"" << ((t.second==1)? "main" : "thread " + std::to_string(t.second)) << "\"}}" << std::endl;
+   }
+   out << "]}" << std::endl;
+   return out.good();
+}
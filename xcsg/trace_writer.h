@@ -0,0 +1,95 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <boost/date_time.hpp>
+#include <boost/thread.hpp>
+
+// trace_writer collects timeline spans and writes them in Chrome Trace Event
+// format (complete events, "ph":"X"), for viewing in Perfetto or chrome://tracing.
+// Tracing is off unless open() is called, then trace_span costs only a flag test.
+
+class trace_writer {
+public:
+   static trace_writer& singleton()  { static trace_writer instance; return instance;  }
+
+   // start collecting spans, written to path by close()
+   void open(const std::string& path);
+   bool enabled() const { return m_enabled; }
+
+   // write the collected spans and stop tracing, returns false if the file could not be written
+   bool close();
+
+   // microseconds since open()
+   long long now() const;
+
+   // record a complete span for the calling thread
+   void add(const std::string& name, const std::string& category, long long ts, long long dur);
+
+protected:
+   trace_writer();
+   virtual ~trace_writer();
+
+   // small sequential id for the calling thread
+   int thread_id();
+
+private:
+   struct event {
+      std::string name;
+      std::string category;
+      long long   ts;
+      long long   dur;
+      int         tid;
+   };
+
+   std::atomic<bool>             m_enabled;
+   std::string                   m_path;
+   boost::posix_time::ptime      m_start;
+   std::vector<event>            m_events;
+   std::map<boost::thread::id,int> m_threads;
+   std::mutex                    m_mutex;
+};
+
+// trace_span records the time from construction to destruction as one span
+class trace_span {
+public:
+   trace_span(const char* name, const char* category)
+   : m_name(name)
+   , m_category(category)
+   , m_ts(trace_writer::singleton().enabled()? trace_writer::singleton().now() : -1)
+   {}
+
+   ~trace_span()
+   {
+      if(m_ts >= 0) {
+         trace_writer& trace = trace_writer::singleton();
+         trace.add(m_name,m_category,m_ts,trace.now()-m_ts);
+      }
+   }
+
+private:
+   const char* m_name;
+   const char* m_category;
+   long long   m_ts;
+};
+
+#endif // TRACE_WRITER_H
@@ -0,0 +1,449 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "triangle_bvh.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <stdexcept>
+#include <cmath>
+
+// triangles per task when the triangle data is collected
+static const size_t bvh_chunk = 1<<16;
+
+// subtrees larger than this are built in parallel
+static const uint32_t bvh_parallel = 1<<14;
+
+// binned surface area heuristic: bins per axis, and leaf sizes
+static const size_t   bvh_bins     = 16;
+static const uint32_t bvh_min_leaf = 2;
+static const uint32_t bvh_max_leaf = 8;
+
+static inline double dot(const double a[3], const double b[3]) { return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+
+static inline void cross(const double a[3], const double b[3], double c[3])
+{
+   c[0] = a[1]*b[2] - a[2]*b[1];
+   c[1] = a[2]*b[0] - a[0]*b[2];
+   c[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline double half_area(const double bmin[3], const double bmax[3])
+{
+   const double d[] = { bmax[0]-bmin[0], bmax[1]-bmin[1], bmax[2]-bmin[2] };
+   return d[0]*d[1] + d[1]*d[2] + d[2]*d[0];
+}
+
+static inline void empty_box(double bmin[3], double bmax[3])
+{
+   for(size_t k=0; k<3; k++) {
+      bmin[k] =  std::numeric_limits<double>::max();
+      bmax[k] = -std::numeric_limits<double>::max();
+   }
+}
+
+// entry distance of the ray into the box, or false if it misses it before tmax
+static inline bool ray_box(const double p[3], const double inv[3], const double bmin[3], const double bmax[3], double tmax, double& tenter)
+{
+   double t0 = 0.0, t1 = tmax;
+   for(size_t k=0; k<3; k++) {
+      double ta = (bmin[k]-p[k])*inv[k];
+      double tb = (bmax[k]-p[k])*inv[k];
+      if(ta > tb) std::swap(ta,tb);
+      t0 = (ta > t0)? ta : t0;
+      t1 = (tb < t1)? tb : t1;
+      if(t0 > t1) return false;
+   }
+   tenter = t0;
+   return true;
+}
+
+// squared distance from p to the box
+static inline double box_dist2(const double p[3], const double bmin[3], const double bmax[3])
+{
+   double d2 = 0.0;
+   for(size_t k=0; k<3; k++) {
+      double d = (p[k] < bmin[k])? bmin[k]-p[k] : ((p[k] > bmax[k])? p[k]-bmax[k] : 0.0);
+      d2 += d*d;
+   }
+   return d2;
+}
+
+// closest point on triangle (a, a+ab, a+ac) to p, see Ericson: Real-Time Collision Detection 5.1.5
+static void closest_on_triangle(const double p[3], const double a[3], const double ab[3], const double ac[3], double q[3])
+{
+   const double ap[] = { p[0]-a[0], p[1]-a[1], p[2]-a[2] };
+   const double d1 = dot(ab,ap), d2 = dot(ac,ap);
+   if(d1 <= 0.0 && d2 <= 0.0) { for(size_t k=0; k<3; k++) q[k] = a[k]; return; }
+
+   const double bp[] = { ap[0]-ab[0], ap[1]-ab[1], ap[2]-ab[2] };
+   const double d3 = dot(ab,bp), d4 = dot(ac,bp);
+   if(d3 >= 0.0 && d4 <= d3) { for(size_t k=0; k<3; k++) q[k] = a[k]+ab[k]; return; }
+
+   const double vc = d1*d4 - d3*d2;
+   if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+      const double v = d1/(d1-d3);
+      for(size_t k=0; k<3; k++) q[k] = a[k] + v*ab[k];
+      return;
+   }
+
+   const double cp[] = { ap[0]-ac[0], ap[1]-ac[1], ap[2]-ac[2] };
+   const double d5 = dot(ab,cp), d6 = dot(ac,cp);
+   if(d6 >= 0.0 && d5 <= d6) { for(size_t k=0; k<3; k++) q[k] = a[k]+ac[k]; return; }
+
+   const double vb = d5*d2 - d1*d6;
+   if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+      const double w = d2/(d2-d6);
+      for(size_t k=0; k<3; k++) q[k] = a[k] + w*ac[k];
+      return;
+   }
+
+   const double va = d3*d6 - d5*d4;
+   if(va <= 0.0 && (d4-d3) >= 0.0 && (d5-d6) >= 0.0) {
+      const double w = (d4-d3)/((d4-d3) + (d5-d6));
+      for(size_t k=0; k<3; k++) q[k] = a[k]+ab[k] + w*(ac[k]-ab[k]);
+      return;
+   }
+
+   const double denom = 1.0/(va + vb + vc);
+   const double v = vb*denom, w = vc*denom;
+   for(size_t k=0; k<3; k++) q[k] = a[k] + v*ab[k] + w*ac[k];
+}
+
+triangle_bvh::triangle_bvh(const triangle_mesh::mesh_vector& lumps)
+: m_nnodes(0)
+{
+   // the triangles of all lumps are collected in parallel chunks
+   struct chunk { uint32_t lump; size_t ifirst; size_t ilast; size_t offset; };
+   std::vector<chunk> chunks;
+   size_t ntri = 0;
+   for(size_t ilump=0; ilump<lumps.size(); ilump++) {
+      const size_t nlump = (lumps[ilump])? lumps[ilump]->ntriangles() : 0;
+      for(size_t ifirst=0; ifirst<nlump; ifirst+=bvh_chunk) {
+         size_t ilast = std::min(nlump,ifirst+bvh_chunk);
+         chunks.push_back({static_cast<uint32_t>(ilump),ifirst,ilast,ntri + ifirst});
+      }
+      ntri += nlump;
+   }
+   if(ntri >= std::numeric_limits<uint32_t>::max()/2) throw std::logic_error("triangle_bvh: too many triangles");
+   if(ntri == 0) return;
+
+   m_tri.resize(ntri);
+   m_centroid.resize(3*ntri);
+   m_bounds.resize(6*ntri);
+   auto collect = [this,&lumps](const chunk& c) {
+      const triangle_mesh& lump = *lumps[c.lump];
+      for(size_t itri=c.ifirst; itri<c.ilast; itri++) {
+         const size_t* t = lump.triangle(itri);
+         const xvertex p0 = lump.vertex(t[0]), p1 = lump.vertex(t[1]), p2 = lump.vertex(t[2]);
+         const size_t i = c.offset + itri - c.ifirst;
+         tri& dst = m_tri[i];
+         double* bounds = &m_bounds[6*i];
+         for(size_t k=0; k<3; k++) {
+            dst.v0[k] = p0.v[k];
+            dst.e1[k] = p1.v[k] - p0.v[k];
+            dst.e2[k] = p2.v[k] - p0.v[k];
+            bounds[k]   = std::min(std::min(p0.v[k],p1.v[k]),p2.v[k]);
+            bounds[3+k] = std::max(std::max(p0.v[k],p1.v[k]),p2.v[k]);
+            m_centroid[3*i+k] = (p0.v[k] + p1.v[k] + p2.v[k])/3.0;
+         }
+         dst.lump = c.lump;
+      }
+   };
+   if(chunks.size() <= 1 || thread_pool::singleton().nthreads() <= 1) {
+      for(auto& c : chunks) collect(c);
+   }
+   else {
+      task_group tasks;
+      for(auto& c : chunks) {
+         const chunk* pc = &c;
+         tasks.run([&collect,pc]() { collect(*pc); });
+      }
+      tasks.wait();
+   }
+
+   m_order.resize(ntri);
+   std::iota(m_order.begin(),m_order.end(),0);
+
+   // a binary tree with at least one triangle per leaf has at most 2n-1 nodes
+   m_nodes.resize(2*ntri-1);
+   m_nnodes = 1;
+   build(0,0,static_cast<uint32_t>(ntri));
+   m_nodes.resize(m_nnodes);
+
+   // the build data is no longer needed
+   std::vector<double>().swap(m_centroid);
+   std::vector<double>().swap(m_bounds);
+}
+
+triangle_bvh::~triangle_bvh()
+{}
+
+void triangle_bvh::build(uint32_t inode, uint32_t first, uint32_t count)
+{
+   // nodes are never reallocated during the build, the reference stays valid
+   node& nd = m_nodes[inode];
+   double cmin[3], cmax[3];
+   empty_box(nd.bmin,nd.bmax);
+   empty_box(cmin,cmax);
+   for(uint32_t i=first; i<first+count; i++) {
+      const double* b = &m_bounds[6*m_order[i]];
+      const double* c = &m_centroid[3*m_order[i]];
+      for(size_t k=0; k<3; k++) {
+         nd.bmin[k] = std::min(nd.bmin[k],b[k]);
+         nd.bmax[k] = std::max(nd.bmax[k],b[3+k]);
+         cmin[k]    = std::min(cmin[k],c[k]);
+         cmax[k]    = std::max(cmax[k],c[k]);
+      }
+   }
+   nd.first = first;
+   nd.count = count;
+   if(count <= bvh_min_leaf) return;
+
+   // lowest cost split between bins of the centroids, over all axes
+   double best_cost = std::numeric_limits<double>::max();
+   int    best_axis = -1;
+   size_t best_bin  = 0;
+   for(int axis=0; axis<3; axis++) {
+      const double extent = cmax[axis] - cmin[axis];
+      if(extent <= 0.0) continue;
+      const double scale = bvh_bins/extent;
+
+      size_t nbin[bvh_bins] = {0};
+      double bmin[bvh_bins][3], bmax[bvh_bins][3];
+      for(size_t ib=0; ib<bvh_bins; ib++) empty_box(bmin[ib],bmax[ib]);
+      for(uint32_t i=first; i<first+count; i++) {
+         const double* b = &m_bounds[6*m_order[i]];
+         size_t ib = std::min(bvh_bins-1,static_cast<size_t>((m_centroid[3*m_order[i]+axis] - cmin[axis])*scale));
+         nbin[ib]++;
+         for(size_t k=0; k<3; k++) {
+            bmin[ib][k] = std::min(bmin[ib][k],b[k]);
+            bmax[ib][k] = std::max(bmax[ib][k],b[3+k]);
+         }
+      }
+
+      // areas and counts left of each split, swept from the left, then the right side
+      double left_area[bvh_bins];
+      size_t left_count[bvh_bins];
+      double lmin[3], lmax[3];
+      empty_box(lmin,lmax);
+      size_t nleft = 0;
+      for(size_t ib=0; ib+1<bvh_bins; ib++) {
+         nleft += nbin[ib];
+         for(size_t k=0; k<3; k++) { lmin[k] = std::min(lmin[k],bmin[ib][k]); lmax[k] = std::max(lmax[k],bmax[ib][k]); }
+         left_count[ib+1] = nleft;
+         left_area[ib+1]  = (nleft > 0)? half_area(lmin,lmax) : 0.0;
+      }
+      double rmin[3], rmax[3];
+      empty_box(rmin,rmax);
+      size_t nright = 0;
+      for(size_t ib=bvh_bins-1; ib>0; ib--) {
+         nright += nbin[ib];
+         for(size_t k=0; k<3; k++) { rmin[k] = std::min(rmin[k],bmin[ib][k]); rmax[k] = std::max(rmax[k],bmax[ib][k]); }
+         if(nright == 0 || left_count[ib] == 0) continue;
+         const double cost = left_area[ib]*left_count[ib] + half_area(rmin,rmax)*nright;
+         if(cost < best_cost) {
+            best_cost = cost;
+            best_axis = axis;
+            best_bin  = ib;
+         }
+      }
+   }
+
+   // a leaf when splitting costs more than testing all triangles, with unit costs for a
+   // node visit and a triangle test. Larger leaves are split at the middle of the range
+   uint32_t nleft = count/2;
+   const double area = half_area(nd.bmin,nd.bmax);
+   if(best_axis >= 0) {
+      if(count <= bvh_max_leaf && area + best_cost >= area*count) return;
+      const double scale = bvh_bins/(cmax[best_axis] - cmin[best_axis]);
+      const double low   = cmin[best_axis];
+      auto imid = std::partition(m_order.begin()+first,m_order.begin()+first+count,[this,best_axis,best_bin,scale,low](uint32_t itri) {
+         return std::min(bvh_bins-1,static_cast<size_t>((m_centroid[3*itri+best_axis] - low)*scale)) < best_bin;
+      });
+      nleft = static_cast<uint32_t>(imid - (m_order.begin()+first));
+   }
+   else if(count <= bvh_max_leaf) return;
+
+   const uint32_t ileft = m_nnodes.fetch_add(2);
+   nd.first = ileft;
+   nd.count = 0;
+   if(count > bvh_parallel && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      tasks.run([this,ileft,first,nleft]() { build(ileft,first,nleft); });
+      build(ileft+1,first+nleft,count-nleft);
+      tasks.wait();
+   }
+   else {
+      build(ileft,first,nleft);
+      build(ileft+1,first+nleft,count-nleft);
+   }
+}
+
+bool triangle_bvh::first_hit(const xvertex& pos, const xvertex& direction, double& t, size_t& lump) const
+{
+   if(m_nodes.empty()) return false;
+   const double p[]   = { pos.x, pos.y, pos.z };
+   const double dir[] = { direction.x, direction.y, direction.z };
+   const double inv[] = { 1.0/dir[0], 1.0/dir[1], 1.0/dir[2] };
+
+   double best = std::numeric_limits<double>::max();
+   uint32_t best_tri = 0;
+   std::vector<uint32_t> stack(1,0);
+   stack.reserve(64);
+   while(!stack.empty()) {
+      const node& nd = m_nodes[stack.back()];
+      stack.pop_back();
+      double tenter = 0.0;
+      if(!ray_box(p,inv,nd.bmin,nd.bmax,best,tenter)) continue;
+      if(nd.count > 0) {
+         for(uint32_t i=nd.first; i<nd.first+nd.count; i++) {
+            const tri& tr = m_tri[m_order[i]];
+
+            // Moller-Trumbore
+            double pvec[3], qvec[3];
+            cross(dir,tr.e2,pvec);
+            const double det = dot(tr.e1,pvec);
+            if(det == 0.0) continue;
+            const double inv_det = 1.0/det;
+            const double tvec[] = { p[0]-tr.v0[0], p[1]-tr.v0[1], p[2]-tr.v0[2] };
+            const double u = dot(tvec,pvec)*inv_det;
+            if(u < 0.0 || u > 1.0) continue;
+            cross(tvec,tr.e1,qvec);
+            const double v = dot(dir,qvec)*inv_det;
+            if(v < 0.0 || u+v > 1.0) continue;
+            const double thit = dot(tr.e2,qvec)*inv_det;
+            if(thit > 0.0 && thit < best) {
+               best     = thit;
+               best_tri = m_order[i];
+            }
+         }
+      }
+      else {
+         // the nearer child is visited first
+         double t0 = 0.0, t1 = 0.0;
+         const node& left  = m_nodes[nd.first];
+         const node& right = m_nodes[nd.first+1];
+         const bool hit0 = ray_box(p,inv,left.bmin,left.bmax,best,t0);
+         const bool hit1 = ray_box(p,inv,right.bmin,right.bmax,best,t1);
+         if(hit0 && hit1) {
+            if(t0 <= t1) { stack.push_back(nd.first+1); stack.push_back(nd.first);   }
+            else         { stack.push_back(nd.first);   stack.push_back(nd.first+1); }
+         }
+         else if(hit0) stack.push_back(nd.first);
+         else if(hit1) stack.push_back(nd.first+1);
+      }
+   }
+   if(best == std::numeric_limits<double>::max()) return false;
+   t    = best;
+   lump = m_tri[best_tri].lump;
+   return true;
+}
+
+size_t triangle_bvh::count_hits(const double p[3], const double dir[3]) const
+{
+   const double inv[] = { 1.0/dir[0], 1.0/dir[1], 1.0/dir[2] };
+   const double tmax  = std::numeric_limits<double>::max();
+
+   size_t nhits = 0;
+   std::vector<uint32_t> stack(1,0);
+   stack.reserve(64);
+   while(!stack.empty()) {
+      const node& nd = m_nodes[stack.back()];
+      stack.pop_back();
+      double tenter = 0.0;
+      if(!ray_box(p,inv,nd.bmin,nd.bmax,tmax,tenter)) continue;
+      if(nd.count > 0) {
+         for(uint32_t i=nd.first; i<nd.first+nd.count; i++) {
+            const tri& tr = m_tri[m_order[i]];
+            double pvec[3], qvec[3];
+            cross(dir,tr.e2,pvec);
+            const double det = dot(tr.e1,pvec);
+            if(det == 0.0) continue;
+            const double inv_det = 1.0/det;
+            const double tvec[] = { p[0]-tr.v0[0], p[1]-tr.v0[1], p[2]-tr.v0[2] };
+            const double u = dot(tvec,pvec)*inv_det;
+            if(u < 0.0 || u > 1.0) continue;
+            cross(tvec,tr.e1,qvec);
+            const double v = dot(dir,qvec)*inv_det;
+            if(v < 0.0 || u+v > 1.0) continue;
+            if(dot(tr.e2,qvec)*inv_det > 0.0) nhits++;
+         }
+      }
+      else {
+         stack.push_back(nd.first);
+         stack.push_back(nd.first+1);
+      }
+   }
+   return nhits;
+}
+
+bool triangle_bvh::inside(const xvertex& pos) const
+{
+   if(m_nodes.empty()) return false;
+
+   // directions away from the coordinate axes and planes, where mesh edges tend to line up
+   static const double dirs[3][3] = { {  0.2672612419124244,  0.5345224838248488,  0.8017837257372732 },
+                                      { -0.6337502835803360,  0.7190346563699330,  0.2851345418240283 },
+                                      {  0.4110294196546424, -0.3617058892960853, -0.8368374508027017 } };
+   const double p[] = { pos.x, pos.y, pos.z };
+   size_t votes = 0;
+   for(size_t i=0; i<3; i++) {
+      if(count_hits(p,dirs[i])%2 == 1) votes++;
+   }
+   return votes >= 2;
+}
+
+double triangle_bvh::distance(const xvertex& pos, xvertex& closest) const
+{
+   const double p[] = { pos.x, pos.y, pos.z };
+   double best = std::numeric_limits<double>::max();
+   double best_q[3] = { p[0], p[1], p[2] };
+   if(m_nodes.empty()) {
+      closest = pos;
+      return best;
+   }
+
+   std::vector<uint32_t> stack(1,0);
+   stack.reserve(64);
+   while(!stack.empty()) {
+      const node& nd = m_nodes[stack.back()];
+      stack.pop_back();
+      if(box_dist2(p,nd.bmin,nd.bmax) >= best) continue;
+      if(nd.count > 0) {
+         for(uint32_t i=nd.first; i<nd.first+nd.count; i++) {
+            const tri& tr = m_tri[m_order[i]];
+            double q[3];
+            closest_on_triangle(p,tr.v0,tr.e1,tr.e2,q);
+            const double d[] = { q[0]-p[0], q[1]-p[1], q[2]-p[2] };
+            const double d2 = dot(d,d);
+            if(d2 < best) {
+               best = d2;
+               for(size_t k=0; k<3; k++) best_q[k] = q[k];
+            }
+         }
+      }
+      else {
+         // the nearer child is visited first
+         const double d0 = box_dist2(p,m_nodes[nd.first].bmin,m_nodes[nd.first].bmax);
+         const double d1 = box_dist2(p,m_nodes[nd.first+1].bmin,m_nodes[nd.first+1].bmax);
+         if(d0 <= d1) { stack.push_back(nd.first+1); stack.push_back(nd.first);   }
+         else         { stack.push_back(nd.first);   stack.push_back(nd.first+1); }
+      }
+   }
+   closest = carve::geom::VECTOR(best_q[0],best_q[1],best_q[2]);
+   return std::sqrt(best);
+}
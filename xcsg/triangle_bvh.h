@@ -0,0 +1,81 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "triangle_mesh.h"
+
+// triangle_bvh is a bounding volume hierarchy over the triangles of the exported lumps,
+// for point and ray queries against the result without writing it. It is built top down:
+// each node is split where the surface area heuristic over binned triangle centroids is
+// lowest, large subtrees are built in parallel. Nodes are allocated in pairs from one array,
+// the triangles of a leaf are a range of the triangle order. A built tree is read only,
+// so any number of threads may query it.
+
+class triangle_bvh {
+public:
+   triangle_bvh(const triangle_mesh::mesh_vector& lumps);
+   virtual ~triangle_bvh();
+
+   size_t ntriangles() const { return m_tri.size(); }
+   size_t nnodes() const     { return m_nnodes; }
+
+   // nearest intersection of the ray p + t*dir, t > 0, returns false if there is none.
+   // lump is the 0-based index of the lump hit
+   bool first_hit(const xvertex& p, const xvertex& dir, double& t, size_t& lump) const;
+
+   // true if p is inside the solid. Intersections of rays from p are counted, odd means
+   // inside. Three rays in different directions vote, as a ray grazing an edge may miscount
+   bool inside(const xvertex& p) const;
+
+   // distance from p to the nearest point of the surface, returned in closest
+   double distance(const xvertex& p, xvertex& closest) const;
+
+private:
+   struct tri {
+      double   v0[3];
+      double   e1[3];   // v1 - v0
+      double   e2[3];   // v2 - v0
+      uint32_t lump;
+   };
+
+   struct node {
+      double   bmin[3];
+      double   bmax[3];
+      uint32_t first;   // leaf: first entry of m_order, else index of the left child, the right follows it
+      uint32_t count;   // leaf: number of triangles, 0 for inner nodes
+   };
+
+   // build node inode over m_order[first,first+count)
+   void build(uint32_t inode, uint32_t first, uint32_t count);
+
+   // number of intersections of the ray with t > 0
+   size_t count_hits(const double p[3], const double dir[3]) const;
+
+private:
+   std::vector<tri>      m_tri;
+   std::vector<double>   m_centroid;   // 3 per triangle
+   std::vector<double>   m_bounds;     // 6 per triangle, min then max
+   std::vector<uint32_t> m_order;      // triangle order, leaves refer to ranges of it
+   std::vector<node>     m_nodes;
+   std::atomic<uint32_t> m_nnodes;
+};
+
+#endif // TRIANGLE_BVH_H
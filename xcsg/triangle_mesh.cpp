@@ -0,0 +1,375 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "triangle_mesh.h"
+#include <carve/triangulator.hpp>
+#include "thread_pool.h"
+#include "mesh_decimator.h"
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+static const double pi = 4.0*atan(1.0);
+
+typedef carve::geom::vector<3>  vec3d;
+typedef carve::mesh::Vertex<3>  vertex_t;
+typedef carve::mesh::Edge<3>    edge_t;
+typedef carve::mesh::Face<3>    face_t;
+
+// polygon area from the summed triangle fan normals
+static double polygon_area(const vertex_t* const* vloop, size_t nv)
+{
+   vec3d normal = carve::geom::VECTOR(0.0,0.0,0.0);
+   for(size_t i=2; i<nv; i++) {
+      normal += carve::geom::cross(vloop[i-1]->v - vloop[0]->v, vloop[i]->v - vloop[0]->v);
+   }
+   return 0.5*normal.length();
+}
+
+static double triangle_area(const vertex_t* a, const vertex_t* b, const vertex_t* c)
+{
+   return 0.5*carve::geom::cross(b->v - a->v, c->v - a->v).length();
+}
+
+// true if the face is strictly convex: every corner turns the same way around the face normal
+// by a noticeable angle, and the turns add up to one revolution. Such faces, e.g. the untouched
+// caps of primitives and extrusions, are fanned from their first vertex. Collinear vertices,
+// as left on edges split by booleans, would make zero area fan triangles and are excluded
+static bool strictly_convex(const vertex_t* const* vloop, size_t nv)
+{
+   vec3d normal = carve::geom::VECTOR(0.0,0.0,0.0);
+   for(size_t i=2; i<nv; i++) {
+      normal += carve::geom::cross(vloop[i-1]->v - vloop[0]->v, vloop[i]->v - vloop[0]->v);
+   }
+   const double nlen = normal.length();
+   if(!(nlen > 0.0)) return false;
+
+   const double min_sin = 1.0E-8;
+   double turn = 0.0;
+   vec3d prev = vloop[0]->v - vloop[nv-1]->v;
+   for(size_t i=0; i<nv; i++) {
+      const vec3d next = vloop[(i+1)%nv]->v - vloop[i]->v;
+      const double s = carve::geom::dot(carve::geom::cross(prev,next),normal)/nlen;
+      const double c = carve::geom::dot(prev,next);
+      if(!(s > min_sin*prev.length()*next.length())) return false;
+      turn += std::atan2(s,c);
+      prev = next;
+   }
+   return std::fabs(turn - 2.0*pi) < 1.0E-6;
+}
+
+// minimum number of output triangles per parallel triangulation task
+static const size_t min_chunk = 4096;
+
+triangle_mesh::triangle_mesh(const MeshSet& mesh_set, size_t imani, bool improve, bool degen_check)
+: m_offset(carve::geom::VECTOR(0.0,0.0,0.0))
+, m_npolygons(0)
+, m_num_non_tri(0)
+, m_nzero_area(0)
+, m_nedges(0)
+, m_nopen(0)
+, m_ndropped(0)
+{
+   const size_t unused = std::numeric_limits<size_t>::max();
+   const carve::mesh::Mesh<3>* mesh = mesh_set.meshes[imani];
+   m_npolygons = mesh->faces.size();
+
+   // triangle_mesh vertex index per vertex_storage offset, as in carve_boolean::create_manifold
+   static thread_local std::vector<size_t> vertex_index;
+   static thread_local std::vector<size_t> offsets;
+   const vertex_t* vertex_base = &mesh_set.vertex_storage[0];
+   if(vertex_index.size() < mesh_set.vertex_storage.size()) vertex_index.resize(mesh_set.vertex_storage.size(),unused);
+
+   // triangles are copied in this pass, larger faces are collected for triangulation afterwards
+   polygons ngons;
+   m_triangles.reserve(3*m_npolygons);
+   offsets.clear();
+   size_t nhalf = 0;
+   for(size_t iface=0; iface<m_npolygons; iface++) {
+      const face_t* face = mesh->faces[iface];
+      size_t first = ngons.vloop.size();
+      const edge_t* edge = face->edge;
+      do {
+         size_t offset = edge->vert - vertex_base;
+         size_t& index = vertex_index[offset];
+         if(index == unused) {
+            index = m_vertices.size();
+            m_vertices.push_back(edge->vert->v);
+            offsets.push_back(offset);
+         }
+         ngons.indices.push_back(index);
+         ngons.vloop.push_back(edge->vert);
+
+         // an edge without a reverse edge is used by this face only
+         if(!edge->rev) m_nopen++;
+         nhalf++;
+         edge = edge->next;
+      } while(edge != face->edge);
+
+      size_t nv = ngons.vloop.size() - first;
+      if(!(polygon_area(&ngons.vloop[first],nv) > 0.0)) m_nzero_area++;
+      if(nv == 3) {
+         m_triangles.insert(m_triangles.end(),ngons.indices.begin()+first,ngons.indices.end());
+         ngons.indices.resize(first);
+         ngons.vloop.resize(first);
+      }
+      else {
+         ngons.faces.push_back(face);
+         ngons.first.push_back(first);
+         ngons.ntri += nv-2;
+      }
+   }
+   ngons.first.push_back(ngons.vloop.size());
+   m_nedges = (nhalf + m_nopen)/2;
+   m_num_non_tri = ngons.faces.size();
+
+   for(size_t i=0; i<offsets.size(); i++) vertex_index[offsets[i]] = unused;
+
+   // triangulate the larger faces, in parallel chunks of similar size when there is enough work.
+   // The triangles are appended in face order after the original triangles
+   const size_t nngon = ngons.faces.size();
+   const size_t ntask = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),ngons.ntri/min_chunk));
+   if(ntask <= 1) {
+      m_ndropped = triangulate(ngons,0,nngon,improve,degen_check,m_triangles);
+   }
+   else {
+      // chunk boundaries, balanced by number of triangles
+      std::vector<size_t> first(ntask+1,nngon);
+      first[0] = 0;
+      size_t ntri  = 0;
+      size_t itask = 1;
+      for(size_t i=0; i<nngon && itask<ntask; i++) {
+         ntri += ngons.first[i+1] - ngons.first[i] - 2;
+         if(ntri >= (ngons.ntri*itask)/ntask) first[itask++] = i+1;
+      }
+
+      std::vector<std::vector<size_t>> task_triangles(ntask);
+      std::vector<size_t> task_dropped(ntask,0);
+      task_group tasks;
+      for(size_t itask=0; itask<ntask; itask++) {
+         const polygons* p = &ngons;
+         std::vector<size_t>* triangles = &task_triangles[itask];
+         size_t* dropped = &task_dropped[itask];
+         size_t ifirst = first[itask];
+         size_t ilast  = first[itask+1];
+         tasks.run([p,ifirst,ilast,improve,degen_check,triangles,dropped]() {
+            try {
+               *dropped = triangulate(*p,ifirst,ilast,improve,degen_check,*triangles);
+            }
+            catch(carve::exception& ex) {
+               throw std::runtime_error("(carve error): " + ex.str());
+            }
+         });
+      }
+      tasks.wait();
+
+      for(size_t itask=0; itask<ntask; itask++) {
+         m_triangles.insert(m_triangles.end(),task_triangles[itask].begin(),task_triangles[itask].end());
+         m_ndropped += task_dropped[itask];
+      }
+   }
+}
+
+triangle_mesh::~triangle_mesh()
+{}
+
+size_t triangle_mesh::triangulate(const polygons& ngons, size_t ifirst, size_t ilast, bool improve, bool degen_check, std::vector<size_t>& triangles)
+{
+   size_t ndropped = 0;
+   std::vector<carve::triangulate::tri_idx> result;
+   std::vector<const vertex_t*> vloop;
+   for(size_t i=ifirst; i<ilast; i++) {
+      const face_t* face = ngons.faces[i];
+      const size_t first = ngons.first[i];
+      const size_t nv    = ngons.first[i+1] - first;
+      const size_t* indices = &ngons.indices[first];
+      if(strictly_convex(&ngons.vloop[first],nv)) {
+         for(size_t j=2; j<nv; j++) {
+            triangles.push_back(indices[0]);
+            triangles.push_back(indices[j-1]);
+            triangles.push_back(indices[j]);
+         }
+         continue;
+      }
+
+      // the general triangulator for concave faces and faces with collinear vertices
+      vloop.assign(ngons.vloop.begin()+first,ngons.vloop.begin()+ngons.first[i+1]);
+
+      result.clear();
+      carve::triangulate::triangulate(face_t::projection_mapping(face->project), vloop, result);
+      if(improve && vloop.size() > 3) {
+         carve::triangulate::improve(face_t::projection_mapping(face->project), vloop, carve::mesh::vertex_distance(), result);
+      }
+
+      for(size_t j=0; j<result.size(); j++) {
+         const carve::triangulate::tri_idx& tri = result[j];
+
+         // check the area of the triangulated face, ignore if degenerate
+         if(degen_check && !(triangle_area(vloop[tri.a],vloop[tri.b],vloop[tri.c]) > 0.0)) {
+            ndropped++;
+            continue;
+         }
+         triangles.push_back(indices[tri.a]);
+         triangles.push_back(indices[tri.b]);
+         triangles.push_back(indices[tri.c]);
+      }
+   }
+   return ndropped;
+}
+
+triangle_mesh::triangle_mesh(std::shared_ptr<const triangle_mesh> source, const xvertex& offset)
+: m_source((source->m_source)? source->m_source : source)
+, m_offset((source->m_source)? source->m_offset + offset : offset)
+, m_npolygons(0)
+, m_num_non_tri(0)
+, m_nzero_area(0)
+, m_nedges(0)
+, m_nopen(0)
+, m_ndropped(0)
+{}
+
+size_t triangle_mesh::decimate(size_t max_triangles, double max_error)
+{
+   if(m_source) return 0;
+   std::lock_guard<std::mutex> lock(m_normals_mutex);
+   m_normals.clear();
+   m_compact.reset();
+   mesh_decimator decimator(m_vertices,m_triangles);
+   return decimator.decimate(max_triangles,max_error);
+}
+
+// triangles per normal computation task
+static const size_t normal_chunk = 1<<16;
+
+const std::vector<float>& triangle_mesh::normals() const
+{
+   // normals do not change with a translation
+   if(m_source) return m_source->normals();
+   std::lock_guard<std::mutex> lock(m_normals_mutex);
+   const size_t ntri = ntriangles();
+   if(m_normals.size() == 3*ntri) return m_normals;
+
+   m_normals.resize(3*ntri);
+   auto compute = [this](size_t ifirst, size_t ilast) {
+      for(size_t itri=ifirst; itri<ilast; itri++) {
+         const size_t* tri = &m_triangles[3*itri];
+         const xvertex& p0 = m_vertices[tri[0]];
+         const xvertex& p1 = m_vertices[tri[1]];
+         const xvertex& p2 = m_vertices[tri[2]];
+         const double x[] = { p1.v[0]-p0.v[0], p1.v[1]-p0.v[1], p1.v[2]-p0.v[2] };
+         const double y[] = { p2.v[0]-p0.v[0], p2.v[1]-p0.v[1], p2.v[2]-p0.v[2] };
+         const double z[] = { x[1]*y[2]-x[2]*y[1], x[2]*y[0]-x[0]*y[2], x[0]*y[1]-x[1]*y[0] };
+         const double len = std::sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+         const double scale = (len > 0.0)? 1.0/len : 0.0;
+         float* n = &m_normals[3*itri];
+         for(size_t k=0; k<3; k++) n[k] = static_cast<float>(z[k]*scale);
+      }
+   };
+
+   const size_t nchunk = (ntri + normal_chunk-1)/normal_chunk;
+   if(nchunk <= 1 || thread_pool::singleton().nthreads() <= 1) compute(0,ntri);
+   else {
+      task_group tasks;
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+         size_t ifirst = ichunk*normal_chunk;
+         size_t ilast  = std::min(ntri,ifirst+normal_chunk);
+         tasks.run([&compute,ifirst,ilast]() { compute(ifirst,ilast); });
+      }
+      tasks.wait();
+   }
+   return m_normals;
+}
+
+// vertices or triangles per compact buffer task
+static const size_t compact_chunk = 1<<16;
+
+const triangle_mesh::compact_buffers& triangle_mesh::compact() const
+{
+   if(m_source) return m_source->compact();
+   std::lock_guard<std::mutex> lock(m_normals_mutex);
+   if(m_compact.get()) return *m_compact;
+
+   const size_t nvert = nvertices();
+   const size_t ntri  = ntriangles();
+   if(nvert > std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("triangle_mesh::compact(), too many vertices for 32 bit indices: " + std::to_string(nvert));
+   }
+
+   std::unique_ptr<compact_buffers> buffers(new compact_buffers);
+   buffers->xyz.resize(3*nvert);
+   buffers->indices.resize(3*ntri);
+   compact_buffers* b = buffers.get();
+   auto copy_vertices = [this,b](size_t ifirst, size_t ilast) {
+      for(size_t ivert=ifirst; ivert<ilast; ivert++) {
+         const xvertex& p = m_vertices[ivert];
+         float* xyz = &b->xyz[3*ivert];
+         xyz[0] = static_cast<float>(p.v[0]);
+         xyz[1] = static_cast<float>(p.v[1]);
+         xyz[2] = static_cast<float>(p.v[2]);
+      }
+   };
+   auto copy_indices = [this,b](size_t ifirst, size_t ilast) {
+      for(size_t i=3*ifirst; i<3*ilast; i++) b->indices[i] = static_cast<uint32_t>(m_triangles[i]);
+   };
+
+   const size_t nchunk_v = (nvert + compact_chunk-1)/compact_chunk;
+   const size_t nchunk_t = (ntri  + compact_chunk-1)/compact_chunk;
+   if(nchunk_v + nchunk_t <= 1 || thread_pool::singleton().nthreads() <= 1) {
+      copy_vertices(0,nvert);
+      copy_indices(0,ntri);
+   }
+   else {
+      task_group tasks;
+      for(size_t ifirst=0; ifirst<nvert; ifirst+=compact_chunk) {
+         size_t ilast = std::min(nvert,ifirst+compact_chunk);
+         tasks.run([&copy_vertices,ifirst,ilast]() { copy_vertices(ifirst,ilast); });
+      }
+      for(size_t ifirst=0; ifirst<ntri; ifirst+=compact_chunk) {
+         size_t ilast = std::min(ntri,ifirst+compact_chunk);
+         tasks.run([&copy_indices,ifirst,ilast]() { copy_indices(ifirst,ilast); });
+      }
+      tasks.wait();
+   }
+   m_compact = std::move(buffers);
+   return *m_compact;
+}
+
+void triangle_mesh::release_compact() const
+{
+   if(m_source) return;
+   std::lock_guard<std::mutex> lock(m_normals_mutex);
+   m_compact.reset();
+}
+
+bool triangle_mesh::check(std::ostream& out) const
+{
+   if(m_source) return m_source->check(out);
+   if(m_nopen == 0) {
+      out << "...Polyhedron is water-tight (edge use-count check OK)" << std::endl;
+   }
+   else {
+      out << ">>> Warning: Polyhedron is not water-tight, it has " << m_nedges << " edges, " << m_nopen << " with wrong use count, " << m_nopen << " with use-count==1" << std::endl;
+   }
+   if(m_nzero_area == 0) {
+      out << "...Polyhedron has no degenerated faces (face area check OK)" << std::endl;
+   }
+   else {
+      out << ">>> Warning: Polyhedron has " << m_nzero_area << " zero area faces." << std::endl;
+   }
+
+   out << "...Polyhedron has "<< m_num_non_tri << " non-triangular faces" << std::endl;
+   return ((m_nzero_area+m_nopen)==0);
+}
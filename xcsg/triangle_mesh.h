@@ -0,0 +1,126 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <carve/mesh.hpp>
+#include "xshape.h"
+
+// triangle_mesh is a light weight indexed triangle mesh of one lump, as exported.
+// It is created directly from a manifold of a carve MeshSet: vertices are copied
+// once in the order they are referenced, triangles are copied and larger faces are
+// triangulated in 2d, in parallel chunks when there are many. Their triangles follow the
+// copied ones in face order. The properties of the original faces are kept for check().
+// A triangle_mesh may also be an instance of another lump translated by an offset, see
+// lump_instancing. It shares the triangles of its source and returns translated vertices.
+
+class triangle_mesh {
+public:
+   typedef std::vector<std::shared_ptr<triangle_mesh>> mesh_vector;
+   typedef carve::mesh::MeshSet<3> MeshSet;
+
+   // create from manifold imani of mesh_set. With degen_check, zero area
+   // triangles created by the triangulation of larger faces are dropped
+   triangle_mesh(const MeshSet& mesh_set, size_t imani, bool improve, bool degen_check);
+
+   // create an instance of source translated by offset
+   triangle_mesh(std::shared_ptr<const triangle_mesh> source, const xvertex& offset);
+   virtual ~triangle_mesh();
+
+   // the lump this is an instance of, null if it is not an instance
+   std::shared_ptr<const triangle_mesh> source() const { return m_source; }
+   const xvertex& offset() const { return m_offset; }
+
+   size_t nvertices() const  { return data().m_vertices.size(); }
+   size_t ntriangles() const { return data().m_triangles.size()/3; }
+
+   xvertex vertex(size_t ivert) const { return (m_source)? m_source->m_vertices[ivert] + m_offset : m_vertices[ivert]; }
+
+   // the 3 vertex indices of triangle itri
+   const size_t* triangle(size_t itri) const { return &data().m_triangles[3*itri]; }
+
+   // unit normal of each triangle as 3 floats, zero for zero area triangles. Computed in
+   // parallel chunks on first use and shared by the exporters, until the mesh is decimated
+   const std::vector<float>& normals() const;
+
+   // compact export layout as stored by the binary formats: 3 floats per vertex and 3 uint32
+   // indices per triangle, half the size of the double vertices and size_t indices. Built in
+   // parallel chunks on first use and shared by the binary exporters, until the mesh is decimated.
+   // Throws std::logic_error if the vertices cannot be indexed by uint32.
+   // An instance returns the buffers of its source, without the offset
+   struct compact_buffers {
+      std::vector<float>    xyz;
+      std::vector<uint32_t> indices;
+   };
+   const compact_buffers& compact() const;
+
+   // free the compact buffers when no more binary exports follow
+   void release_compact() const;
+
+   // properties of the original faces
+   size_t npolygons() const       { return data().m_npolygons; }
+   size_t num_non_tri() const     { return data().m_num_non_tri; }
+   size_t ndropped() const        { return data().m_ndropped; }
+
+   // report edge use and face area checks of the original faces, as xpolyhedron::check_polyhedron
+   bool check(std::ostream& out) const;
+
+   // reduce the triangles to at most max_triangles and/or within max_error, 0 means no limit.
+   // Returns the number of triangles removed, see mesh_decimator. An instance follows its
+   // source and removes nothing itself
+   size_t decimate(size_t max_triangles, double max_error);
+
+private:
+   // the mesh holding the vertices and triangles
+   const triangle_mesh& data() const { return (m_source)? *m_source : *this; }
+
+   // faces with more than 3 vertices, vertex loops and indices stored back to back
+   struct polygons {
+      polygons() : ntri(0) {}
+      std::vector<const carve::mesh::Face<3>*>   faces;
+      std::vector<size_t>                        first;    // start of each face in vloop and indices, plus end
+      std::vector<const carve::mesh::Vertex<3>*> vloop;
+      std::vector<size_t>                        indices;
+      size_t                                     ntri;     // triangles before degenerate ones are dropped
+   };
+
+   // triangulate polygons [ifirst,ilast) into triangles, returns number of zero area triangles dropped
+   static size_t triangulate(const polygons& ngons, size_t ifirst, size_t ilast, bool improve, bool degen_check, std::vector<size_t>& triangles);
+
+private:
+   std::shared_ptr<const triangle_mesh> m_source;  // null unless an instance
+   xvertex              m_offset;       // translation from the source
+   std::vector<xvertex> m_vertices;
+   std::vector<size_t>  m_triangles;    // 3 vertex indices per triangle
+
+   size_t m_npolygons;    // original faces
+   size_t m_num_non_tri;  // original faces with more than 3 vertices
+   size_t m_nzero_area;   // original faces with zero area
+   size_t m_nedges;       // edges of the original faces
+   size_t m_nopen;        // edges used by one face only
+   size_t m_ndropped;     // zero area triangles dropped
+
+   mutable std::mutex         m_normals_mutex;  // protects m_normals
+   mutable std::vector<float> m_normals;        // 3 per triangle, empty until requested
+   mutable std::unique_ptr<compact_buffers> m_compact;  // protected by m_normals_mutex, null until requested
+};
+
+#endif // TRIANGLE_MESH_H
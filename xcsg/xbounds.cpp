@@ -0,0 +1,78 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xbounds.h"
+#include <algorithm>
+#include <cmath>
+
+xbounds::xbounds()
+: m_empty(true)
+{}
+
+xbounds::~xbounds()
+{}
+
+void xbounds::add(const xvertex& v)
+{
+   if(m_empty) {
+      m_min = m_max = v;
+      m_empty = false;
+      return;
+   }
+   for(size_t k=0; k<3; k++) {
+      m_min.v[k] = std::min(m_min.v[k],v.v[k]);
+      m_max.v[k] = std::max(m_max.v[k],v.v[k]);
+   }
+}
+
+void xbounds::add(const xbounds& b)
+{
+   if(b.m_empty) return;
+   add(b.m_min);
+   add(b.m_max);
+}
+
+void xbounds::add(const xvertex& lo, const xvertex& hi, const carve::math::Matrix& t)
+{
+   for(size_t i=0; i<8; i++) {
+      add(t*carve::geom::VECTOR((i&1)? hi[0]:lo[0], (i&2)? hi[1]:lo[1], (i&4)? hi[2]:lo[2]));
+   }
+}
+
+void xbounds::intersect(const xbounds& b)
+{
+   if(m_empty) return;
+   if(b.m_empty) {
+      m_empty = true;
+      return;
+   }
+   for(size_t k=0; k<3; k++) {
+      m_min.v[k] = std::max(m_min.v[k],b.m_min.v[k]);
+      m_max.v[k] = std::min(m_max.v[k],b.m_max.v[k]);
+      if(m_min.v[k] > m_max.v[k]) m_empty = true;
+   }
+}
+
+bool xbounds::disjoint(const xbounds& b) const
+{
+   if(m_empty || b.m_empty) return false;
+   for(size_t k=0; k<3; k++) {
+      // same tolerance as carve_boolean::disjoint
+      double extent = 0.5*((m_max.v[k]-m_min.v[k]) + (b.m_max.v[k]-b.m_min.v[k]));
+      double gap    = std::max(b.m_min.v[k]-m_max.v[k], m_min.v[k]-b.m_max.v[k]);
+      if(gap > 1.0E-9*extent) return true;
+   }
+   return false;
+}
@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XBOUNDS_H
+#define XBOUNDS_H
+
+#include "xshape.h"
+#include <carve/matrix.hpp>
+
+// axis aligned bounding box, accumulated from vertices or other boxes.
+// A default constructed box is empty
+
+class xbounds {
+public:
+   xbounds();
+   virtual ~xbounds();
+
+   bool empty() const { return m_empty; }
+   const xvertex& min() const { return m_min; }
+   const xvertex& max() const { return m_max; }
+
+   // grow the box to include the vertex or box
+   void add(const xvertex& v);
+   void add(const xbounds& b);
+
+   // grow the box to include the box [lo,hi] transformed by t, through its 8 corners
+   void add(const xvertex& lo, const xvertex& hi, const carve::math::Matrix& t);
+
+   // shrink the box to the overlap with b, the box becomes empty when there is none
+   void intersect(const xbounds& b);
+
+   // true when there is a small positive gap between the boxes, touching boxes are not disjoint
+   bool disjoint(const xbounds& b) const;
+
+private:
+   bool    m_empty;
+   xvertex m_min;
+   xvertex m_max;
+};
+
+#endif // XBOUNDS_H
@@ -0,0 +1,95 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xcached_solid.h"
+#include "mesh_cache.h"
+#include "mesh_file_cache.h"
+#include "mesh_utils.h"
+#include "mesh_view.h"
+
+xcached_solid::xcached_solid(std::shared_ptr<xsolid> solid, uint64_t key, bool first, bool repeated)
+: m_solid(solid)
+, m_key(key)
+, m_first(first)
+, m_repeated(repeated)
+{
+   // take over the transform, so the wrapped solid produces a mesh in local coordinates
+   set_transform(m_solid->get_transform());
+   m_solid->set_transform(carve::math::Matrix());
+}
+
+xcached_solid::~xcached_solid()
+{}
+
+size_t xcached_solid::nbool()
+{
+   return (m_first)? m_solid->nbool() : 0;
+}
+
+size_t xcached_solid::simplify()
+{
+   size_t nelim = m_solid->simplify();
+   std::shared_ptr<xsolid> child = m_solid->reduced();
+   if(child.get()) m_solid = child;
+   return (m_first)? nelim : 0;
+}
+
+bool xcached_solid::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return m_solid->bounding_box(box,t*get_transform());
+}
+
+xsolid::mesh_estimate xcached_solid::estimate() const
+{
+   mesh_estimate e = m_solid->estimate();
+   if(!m_first) e.bool_faces = 0;
+   return e;
+}
+
+double xcached_solid::mesh_cost() const
+{
+   return (m_first)? m_solid->mesh_cost() : 1.0;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xcached_solid::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_mesh_view(t)->materialize();
+}
+
+std::shared_ptr<mesh_view> xcached_solid::create_mesh_view(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+
+   // a transformed view does not reorient faces, so mirrored instances are computed directly
+   if(mesh_utils::is_left_hand(tt)) {
+      return std::make_shared<mesh_view>(m_solid->create_carve_mesh(tt));
+   }
+
+   mesh_cache& cache = mesh_cache::singleton();
+   std::shared_ptr<carve::mesh::MeshSet<3>> local;
+   if(!m_repeated || !cache.get(m_key,local)) {
+
+      // not computed yet, or being computed in another thread.
+      // Waiting for another thread could deadlock the thread pool, so compute it here
+      // unless a previous run left it in the file cache
+      mesh_file_cache& file_cache = mesh_file_cache::singleton();
+      if(!file_cache.load(m_key,local)) {
+         local = m_solid->create_carve_mesh();
+         file_cache.save(m_key,local);
+      }
+      if(m_repeated) cache.put(m_key,local);
+   }
+   return std::make_shared<mesh_view>(local,tt);
+}
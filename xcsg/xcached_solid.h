@@ -0,0 +1,57 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XCACHED_SOLID_H
+#define XCACHED_SOLID_H
+
+#include "xsolid.h"
+#include <cstdint>
+
+// xcached_solid wraps a solid whose XML subtree occurs more than once in the model,
+// or whose result is kept in the mesh_file_cache between runs.
+// The wrapped solid is meshed once in local coordinates and stored in the mesh_cache,
+// other occurrences transform a clone of the cached mesh.
+
+class xcached_solid : public xsolid {
+public:
+   // first is true for the first object created for the key,
+   // repeated is true when the subtree occurs more than once
+   xcached_solid(std::shared_ptr<xsolid> solid, uint64_t key, bool first, bool repeated);
+   virtual ~xcached_solid();
+
+   // only the first occurrence counts its booleans
+   virtual size_t nbool();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // transformed view of the shared mesh, no copy is made until a boolean needs it
+   std::shared_ptr<mesh_view> create_mesh_view(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the wrapped solid is simplified, the geometry and therefore the cache key are unchanged
+   virtual size_t simplify();
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // repeated occurrences reuse the mesh, so only the first one does boolean work
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+private:
+   std::shared_ptr<xsolid> m_solid;  // the wrapped solid, with identity transform
+   uint64_t                m_key;
+   bool                    m_first;
+   bool                    m_repeated;
+};
+
+#endif // XCACHED_SOLID_H
@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "xcircle.h"
+#include "mesh_utils.h"
 #include "primitives2d.h"
 #include "primitives3d.h"
 #include "csg_parser/cf_xmlNode.h"
@@ -37,6 +38,7 @@ xcircle::~xcircle()
 
 std::shared_ptr<clipper_profile> xcircle::create_clipper_profile(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    int  nseg = -1;
    std::shared_ptr<polygon2d> poly = primitives2d::make_circle(m_r,nseg,t*get_transform());
    std::shared_ptr<clipper_profile> mesh(new clipper_profile());
@@ -44,8 +46,15 @@ std::shared_ptr<clipper_profile> xcircle::create_clipper_profile(const carve::ma
    return mesh;
 }
 
+bool xcircle::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   box.add(carve::geom::VECTOR(-m_r,-m_r,0.0),carve::geom::VECTOR(m_r,m_r,0.0),t*get_transform());
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xcircle::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    int  nseg = -1;
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r,m_r, mesh_utils::thickness(),false,nseg,t*get_transform());
    return poly->create_carve_mesh();
@@ -27,6 +27,11 @@ public:
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   double radius() const { return m_r; }
+
+   // the box of the exact circle
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
 private:
    double m_r;
 };
@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "xcone.h"
+#include "mesh_utils.h"
 #include "primitives3d.h"
 #include "csg_parser/cf_xmlNode.h"
 
@@ -44,9 +45,31 @@ xcone::~xcone()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xcone::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    int nseg = -1;
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r1,m_r2,m_h,m_center,nseg,t*get_transform());
 
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh = poly->create_carve_mesh();
    return mesh;
 }
+
+void xcone::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   int nseg = -1;
+   primitives3d::cone_vertices(m_r1,m_r2,m_h,m_center,nseg,t*get_transform(),vertices);
+}
+
+bool xcone::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   double r  = std::max(m_r1,m_r2);
+   double z1 = (m_center)? -0.5*m_h : 0.0;
+   box.add(carve::geom::VECTOR(-r,-r,z1),carve::geom::VECTOR(r,r,z1+m_h),t*get_transform());
+   return true;
+}
+
+xsolid::mesh_estimate xcone::estimate() const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   return mesh_estimate(primitives3d::cone_faces(m_r1,m_r2));
+}
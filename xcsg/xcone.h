@@ -25,6 +25,12 @@ public:
    virtual ~xcone();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   void append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   bool is_convex() const { return true; }
+   // the box of the exact cone, without generating vertices
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   mesh_estimate estimate() const;
+   double mesh_cost() const { return static_cast<double>(estimate().faces); }
 private:
    double m_h;
    double m_r1;
@@ -16,6 +16,15 @@
 #include "csg_parser/cf_xmlNode.h"
 
 #include "xcsg_factory.h"
+#include "mesh_cache.h"
+#include "mesh_file_cache.h"
+#include "xml_hash.h"
+#include "xcached_solid.h"
+#include "xremote_solid.h"
+#include "remote_farm.h"
+#include "node_profiler.h"
+#include "xprofiled_solid.h"
+#include "mesh_utils.h"
 
 #include "xcone.h"
 #include "xcube.h"
@@ -25,7 +34,7 @@
 #include "xintersection3d.h"
 #include "xpolyhedron.h"
 #include "xsphere.h"
-// #include "xtin_model.h"
+#include "xtin_model.h"
 #include "xunion3d.h"
 #include "xhull3d.h"
 #include "xlinear_extrude.h"
@@ -33,6 +42,7 @@
 #include "xtransform_extrude.h"
 #include "xsweep.h"
 #include "xminkowski3d.h"
+#include "xinstance.h"
 
 #include "xcircle.h"
 #include "xpolygon.h"
@@ -46,65 +56,145 @@
 #include "xoffset2d.h"
 #include "xminkowski2d.h"
 #include "xprojection2d.h"
+#include "xslice2d.h"
 
 xcsg_factory::xcsg_factory()
 {
-   m_solid_map.insert(std::make_pair("cone",xcsg_factory::make_cone));
-   m_solid_map.insert(std::make_pair("cube",xcsg_factory::make_cube));
-   m_solid_map.insert(std::make_pair("cuboid",xcsg_factory::make_cuboid));
-   m_solid_map.insert(std::make_pair("cylinder",xcsg_factory::make_cylinder));
-   m_solid_map.insert(std::make_pair("difference3d",xcsg_factory::make_difference3d));
-   m_solid_map.insert(std::make_pair("intersection3d",xcsg_factory::make_intersection3d));
-   m_solid_map.insert(std::make_pair("polyhedron",xcsg_factory::make_polyhedron));
-   m_solid_map.insert(std::make_pair("sphere",xcsg_factory::make_sphere));
- // experimental only  m_solid_map.insert(std::make_pair("tin_model",xcsg_factory::make_tin_model));
-   m_solid_map.insert(std::make_pair("union3d",xcsg_factory::make_union3d));
-   m_solid_map.insert(std::make_pair("hull3d",xcsg_factory::make_hull3d));
-   m_solid_map.insert(std::make_pair("linear_extrude",xcsg_factory::make_linear_extrude));
-   m_solid_map.insert(std::make_pair("rotate_extrude",xcsg_factory::make_rotate_extrude));
-   m_solid_map.insert(std::make_pair("transform_extrude",xcsg_factory::make_transform_extrude));
-   m_solid_map.insert(std::make_pair("sweep",xcsg_factory::make_sweep));
-   m_solid_map.insert(std::make_pair("minkowski3d",xcsg_factory::make_minkowski3d));
-
-   m_shape2d_map.insert(std::make_pair("circle",xcsg_factory::make_circle));
-   m_shape2d_map.insert(std::make_pair("polygon",xcsg_factory::make_polygon));
-   m_shape2d_map.insert(std::make_pair("rectangle",xcsg_factory::make_rectangle));
-   m_shape2d_map.insert(std::make_pair("square",xcsg_factory::make_square));
-   m_shape2d_map.insert(std::make_pair("difference2d",xcsg_factory::make_difference2d));
-   m_shape2d_map.insert(std::make_pair("intersection2d",xcsg_factory::make_intersection2d));
-   m_shape2d_map.insert(std::make_pair("union2d",xcsg_factory::make_union2d));
-   m_shape2d_map.insert(std::make_pair("hull2d",xcsg_factory::make_hull2d));
-   m_shape2d_map.insert(std::make_pair("fill2d",xcsg_factory::make_fill2d));
-   m_shape2d_map.insert(std::make_pair("offset2d",xcsg_factory::make_offset2d));
-   m_shape2d_map.insert(std::make_pair("minkowski2d",xcsg_factory::make_minkowski2d));
-   m_shape2d_map.insert(std::make_pair("projection2d",xcsg_factory::make_projection2d));
+   add_solid("cone",xcsg_factory::make_cone);
+   add_solid("cube",xcsg_factory::make_cube);
+   add_solid("cuboid",xcsg_factory::make_cuboid);
+   add_solid("cylinder",xcsg_factory::make_cylinder);
+   add_solid("difference3d",xcsg_factory::make_difference3d);
+   add_solid("intersection3d",xcsg_factory::make_intersection3d);
+   add_solid("polyhedron",xcsg_factory::make_polyhedron);
+   add_solid("sphere",xcsg_factory::make_sphere);
+   add_solid("tin_model",xcsg_factory::make_tin_model);
+   add_solid("union3d",xcsg_factory::make_union3d);
+   add_solid("hull3d",xcsg_factory::make_hull3d);
+   add_solid("linear_extrude",xcsg_factory::make_linear_extrude);
+   add_solid("rotate_extrude",xcsg_factory::make_rotate_extrude);
+   add_solid("transform_extrude",xcsg_factory::make_transform_extrude);
+   add_solid("sweep",xcsg_factory::make_sweep);
+   add_solid("minkowski3d",xcsg_factory::make_minkowski3d);
+   add_solid("instance",xcsg_factory::make_instance);
+
+   add_shape2d("circle",xcsg_factory::make_circle);
+   add_shape2d("polygon",xcsg_factory::make_polygon);
+   add_shape2d("rectangle",xcsg_factory::make_rectangle);
+   add_shape2d("square",xcsg_factory::make_square);
+   add_shape2d("difference2d",xcsg_factory::make_difference2d);
+   add_shape2d("intersection2d",xcsg_factory::make_intersection2d);
+   add_shape2d("union2d",xcsg_factory::make_union2d);
+   add_shape2d("hull2d",xcsg_factory::make_hull2d);
+   add_shape2d("fill2d",xcsg_factory::make_fill2d);
+   add_shape2d("offset2d",xcsg_factory::make_offset2d);
+   add_shape2d("minkowski2d",xcsg_factory::make_minkowski2d);
+   add_shape2d("projection2d",xcsg_factory::make_projection2d);
+   add_shape2d("slice2d",xcsg_factory::make_slice2d);
 }
 
 xcsg_factory::~xcsg_factory()
 {}
 
-bool xcsg_factory::is_shape2d(const cf_xmlNode& node)
+void xcsg_factory::add_solid(const std::string& tag, solid_factory f)
 {
-   return (m_shape2d_map.find(node.tag()) != m_shape2d_map.end());
+   entry& e = m_entries[tag];
+   e.type  = SOLID;
+   e.solid = f;
 }
 
-bool xcsg_factory::is_solid(const cf_xmlNode& node)
+void xcsg_factory::add_shape2d(const std::string& tag, shape2d_factory f)
 {
-   return (m_solid_map.find(node.tag()) != m_solid_map.end());
+   entry& e  = m_entries[tag];
+   e.type    = SHAPE2D;
+   e.shape2d = f;
 }
 
-std::shared_ptr<xsolid> xcsg_factory::make_solid(const cf_xmlNode& node)
+const xcsg_factory::entry* xcsg_factory::find(const cf_xmlNode& node) const
+{
+   auto i = m_entries.find(node.tag());
+   return (i != m_entries.end())? &i->second : 0;
+}
+
+xcsg_factory::category xcsg_factory::categorize(const cf_xmlNode& node) const
+{
+   const entry* e = find(node);
+   return (e)? e->type : NOT_OBJECT;
+}
+
+// a secant_tolerance attribute applies to the node and is inherited by its children,
+// which are constructed from within the node constructor
+static std::unique_ptr<mesh_utils::tolerance_scope> node_tolerance(const cf_xmlNode& node)
 {
-   std::string tag = node.tag();
-   auto i=m_solid_map.find(tag);
-   if(i != m_solid_map.end()) {
-      solid_factory f = i->second;
-      return f(node);
+   std::unique_ptr<mesh_utils::tolerance_scope> scope;
+   if(node.has_property("secant_tolerance")) {
+      scope.reset(new mesh_utils::tolerance_scope(node.get_property("secant_tolerance",mesh_utils::secant_tolerance())));
    }
-   throw logic_error("make_solid: No factory function installed for XML tag " + tag);
+   return scope;
+}
+
+std::shared_ptr<xsolid> xcsg_factory::make_solid(const cf_xmlNode& node)
+{
+   const entry* e = find(node);
+   if(e && e->type == SOLID) return make_solid(*e,node);
+   throw logic_error("make_solid: No factory function installed for XML tag " + node.tag());
    return 0;
 }
 
+std::shared_ptr<xsolid> xcsg_factory::make_solid(const entry& e, const cf_xmlNode& node)
+{
+   std::unique_ptr<mesh_utils::tolerance_scope> tol_scope = node_tolerance(node);
+
+   // profiled nodes are registered before their children
+   node_profiler& profiler = node_profiler::singleton();
+   if(profiler.enabled()) {
+      size_t inode = profiler.begin_node(node.tag());
+      std::shared_ptr<xsolid> solid;
+      try {
+         solid = make_solid(e.solid,node);
+      }
+      catch(...) {
+         profiler.end_node();
+         throw;
+      }
+      profiler.end_node();
+      return std::shared_ptr<xsolid>(new xprofiled_solid(solid,inode));
+   }
+   return make_solid(e.solid,node);
+}
+
+std::shared_ptr<xsolid> xcsg_factory::make_solid(solid_factory f, const cf_xmlNode& node)
+{
+   std::shared_ptr<xsolid> solid = f(node);
+
+   // children of a top level boolean may be meshed by remote workers
+   remote_farm& farm = remote_farm::singleton();
+   std::string fragment;
+   if(farm.enabled() && solid->nbool() > 0 && farm.selected(node,fragment)) {
+      solid = std::shared_ptr<xsolid>(new xremote_solid(solid,fragment));
+   }
+
+   // repeated subtrees are meshed once and reused,
+   // boolean subtrees are also kept between runs when the file cache is enabled
+   mesh_cache& cache = mesh_cache::singleton();
+   bool file_cache   = mesh_file_cache::singleton().enabled() && solid->nbool() > 0;
+   if(cache.enabled() || file_cache) {
+      uint64_t key  = xml_hash::local_hash(node);
+
+      // with levels of detail, a subtree without curved shapes is meshed once for all levels
+      bool shared_level = cache.enabled() && cache.level_shared(key);
+      bool repeated     = cache.enabled() && (cache.occurrences(key) > 1 || shared_level);
+
+      // an inherited tolerance is not part of the subtree XML, so the meshes are also keyed on it
+      uint64_t mesh_key = (shared_level)? key : xml_hash::combine(key,xml_hash::hash(std::to_string(solid->secant_tolerance())));
+      if(file_cache) mesh_file_cache::singleton().keep(mesh_key);
+      if(repeated || file_cache) {
+         return std::shared_ptr<xsolid>(new xcached_solid(solid,mesh_key,cache.register_object(mesh_key),repeated));
+      }
+   }
+   return solid;
+}
+
 
 std::shared_ptr<xsolid> xcsg_factory::make_cone(const cf_xmlNode& node)               { return std::shared_ptr<xsolid>(new xcone(node));           }
 std::shared_ptr<xsolid> xcsg_factory::make_cube(const cf_xmlNode& node)               { return std::shared_ptr<xsolid>(new xcube(node));           }
@@ -114,7 +204,7 @@ std::shared_ptr<xsolid> xcsg_factory::make_difference3d(const cf_xmlNode& node)
 std::shared_ptr<xsolid> xcsg_factory::make_intersection3d(const cf_xmlNode& node)     { return std::shared_ptr<xsolid>(new xintersection3d(node)); }
 std::shared_ptr<xsolid> xcsg_factory::make_polyhedron(const cf_xmlNode& node)         { return std::shared_ptr<xsolid>(new xpolyhedron(node));     }
 std::shared_ptr<xsolid> xcsg_factory::make_sphere(const cf_xmlNode& node)             { return std::shared_ptr<xsolid>(new xsphere(node));         }
-// std::shared_ptr<xsolid> xcsg_factory::make_tin_model(const cf_xmlNode& node)          { return std::shared_ptr<xsolid>(new xtin_model(node));      }
+std::shared_ptr<xsolid> xcsg_factory::make_tin_model(const cf_xmlNode& node)          { return std::shared_ptr<xsolid>(new xtin_model(node));      }
 std::shared_ptr<xsolid> xcsg_factory::make_union3d(const cf_xmlNode& node)            { return std::shared_ptr<xsolid>(new xunion3d(node));        }
 std::shared_ptr<xsolid> xcsg_factory::make_hull3d(const cf_xmlNode& node)             { return std::shared_ptr<xsolid>(new xhull3d(node));         }
 std::shared_ptr<xsolid> xcsg_factory::make_linear_extrude(const cf_xmlNode& node)     { return std::shared_ptr<xsolid>(new xlinear_extrude(node)); }
@@ -122,19 +212,22 @@ std::shared_ptr<xsolid> xcsg_factory::make_rotate_extrude(const cf_xmlNode& node
 std::shared_ptr<xsolid> xcsg_factory::make_transform_extrude(const cf_xmlNode& node)  { return std::shared_ptr<xsolid>(new xtransform_extrude(node)); }
 std::shared_ptr<xsolid> xcsg_factory::make_sweep(const cf_xmlNode& node)              { return std::shared_ptr<xsolid>(new xsweep(node));          }
 std::shared_ptr<xsolid> xcsg_factory::make_minkowski3d(const cf_xmlNode& node)        { return std::shared_ptr<xsolid>(new xminkowski3d(node));    }
+std::shared_ptr<xsolid> xcsg_factory::make_instance(const cf_xmlNode& node)           { return std::shared_ptr<xsolid>(new xinstance(node));       }
 
 std::shared_ptr<xshape2d>  xcsg_factory::make_shape2d(const cf_xmlNode& node)
 {
-   std::string tag = node.tag();
-   auto i=m_shape2d_map.find(tag);
-   if(i != m_shape2d_map.end()) {
-      shape2d_factory f = i->second;
-      return f(node);
-   }
-   throw logic_error("make_shape2d: No factory function installed for XML tag " + tag);
+   const entry* e = find(node);
+   if(e && e->type == SHAPE2D) return make_shape2d(*e,node);
+   throw logic_error("make_shape2d: No factory function installed for XML tag " + node.tag());
    return 0;
 }
 
+std::shared_ptr<xshape2d>  xcsg_factory::make_shape2d(const entry& e, const cf_xmlNode& node)
+{
+   std::unique_ptr<mesh_utils::tolerance_scope> tol_scope = node_tolerance(node);
+   return e.shape2d(node);
+}
+
 std::shared_ptr<xshape2d> xcsg_factory::make_circle(const cf_xmlNode& node)         { return std::shared_ptr<xshape2d>(new xcircle(node));         }
 std::shared_ptr<xshape2d> xcsg_factory::make_polygon(const cf_xmlNode& node)        { return std::shared_ptr<xshape2d>(new xpolygon(node));        }
 std::shared_ptr<xshape2d> xcsg_factory::make_rectangle(const cf_xmlNode& node)      { return std::shared_ptr<xshape2d>(new xrectangle(node));      }
@@ -147,3 +240,4 @@ std::shared_ptr<xshape2d> xcsg_factory::make_fill2d(const cf_xmlNode& node)
 std::shared_ptr<xshape2d> xcsg_factory::make_offset2d(const cf_xmlNode& node)       { return std::shared_ptr<xshape2d>(new xoffset2d(node));       }
 std::shared_ptr<xshape2d> xcsg_factory::make_minkowski2d(const cf_xmlNode& node)    { return std::shared_ptr<xshape2d>(new xminkowski2d(node));    }
 std::shared_ptr<xshape2d> xcsg_factory::make_projection2d(const cf_xmlNode& node)   { return std::shared_ptr<xshape2d>(new xprojection2d(node));   }
+std::shared_ptr<xshape2d> xcsg_factory::make_slice2d(const cf_xmlNode& node)        { return std::shared_ptr<xshape2d>(new xslice2d(node));        }
@@ -16,7 +16,8 @@
 #ifndef XCSG_FACTORY_H
 #define XCSG_FACTORY_H
 
-#include <map>
+#include <string>
+#include <unordered_map>
 #include <memory>
 
 class xsolid;
@@ -34,18 +35,42 @@ public:
       return instance;
    }
 
+   // category of object created from an XML tag
+   enum category { NOT_OBJECT, SOLID, SHAPE2D };
+
+   // factory entry for an XML tag
+   struct entry {
+      entry() : type(NOT_OBJECT), solid(0), shape2d(0) {}
+      category        type;
+      solid_factory   solid;
+      shape2d_factory shape2d;
+   };
+
+   // look up the entry for the tag of an XML node with a single hash lookup,
+   // returns null if the tag is not a 2d or 3d object.
+   // Use the entry with make_solid/make_shape2d to categorize and construct with one lookup
+   const entry* find(const cf_xmlNode& node) const;
+
    // determine category of shape, given an XML node
-   bool is_shape2d(const cf_xmlNode& node);
-   bool is_solid(const cf_xmlNode& node);
+   category categorize(const cf_xmlNode& node) const;
+   bool is_shape2d(const cf_xmlNode& node) const { return categorize(node) == SHAPE2D; }
+   bool is_solid(const cf_xmlNode& node) const   { return categorize(node) == SOLID; }
 
    // factory functions for 2d and 3d objects, given XML node
    std::shared_ptr<xshape2d> make_shape2d(const cf_xmlNode& node);
    std::shared_ptr<xsolid>   make_solid(const cf_xmlNode& node);
 
+   // factory functions for 2d and 3d objects, given XML node and its entry from find(node)
+   std::shared_ptr<xshape2d> make_shape2d(const entry& e, const cf_xmlNode& node);
+   std::shared_ptr<xsolid>   make_solid(const entry& e, const cf_xmlNode& node);
+
 protected:
    xcsg_factory();
    virtual ~xcsg_factory();
 
+   // create solid using factory function, wrapped for caching when required
+   std::shared_ptr<xsolid> make_solid(solid_factory f, const cf_xmlNode& node);
+
 protected:
 
    // concrete 3d types
@@ -66,6 +91,7 @@ protected:
    static std::shared_ptr<xsolid> make_transform_extrude(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_sweep(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_minkowski3d(const cf_xmlNode& node);
+   static std::shared_ptr<xsolid> make_instance(const cf_xmlNode& node);
 
 
    // concrete 2d types
@@ -82,13 +108,16 @@ protected:
    static std::shared_ptr<xshape2d> make_offset2d(const cf_xmlNode& node);
    static std::shared_ptr<xshape2d> make_minkowski2d(const cf_xmlNode& node);
    static std::shared_ptr<xshape2d> make_projection2d(const cf_xmlNode& node);
+   static std::shared_ptr<xshape2d> make_slice2d(const cf_xmlNode& node);
+
+private:
+   void add_solid(const std::string& tag, solid_factory f);
+   void add_shape2d(const std::string& tag, shape2d_factory f);
 
 private:
-   typedef std::map<std::string,solid_factory> solid_factory_map;
-   typedef std::map<std::string,shape2d_factory> shape2d_factory_map;
+   typedef std::unordered_map<std::string,entry> entry_map;
 
-   solid_factory_map    m_solid_map;
-   shape2d_factory_map  m_shape2d_map;
+   entry_map  m_entries;   // all 2d and 3d object tags
 };
 
 #endif // XCSG_FACTORY_H
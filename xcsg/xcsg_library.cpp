@@ -0,0 +1,126 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "xcsg_library.h"
+#include <sstream>
+#include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "csg_parser/cf_xmlTree.h"
+#include "clipper_csg/clipper_csg_config.h"
+#include "carve_boolean.h"
+#include "mesh_utils.h"
+#include "xcsg_factory.h"
+#include "xsolid.h"
+#include "thread_pool.h"
+#include "mesh_cache.h"
+#include "xdefinitions.h"
+#include "out_triangles.h"
+#include "glb_file.h"
+
+// the factory, caches and definitions are singletons
+static std::mutex& evaluate_mutex()
+{
+   static std::mutex instance;
+   return instance;
+}
+
+xcsg_library::xcsg_library(size_t nthreads)
+{
+   if(!thread_pool::is_created()) thread_pool::configure(nthreads);
+}
+
+xcsg_library::~xcsg_library()
+{}
+
+std::shared_ptr<xcsg_library::mesh_vector> xcsg_library::evaluate(cf_xmlTree& tree)
+{
+   std::lock_guard<std::mutex> lock(evaluate_mutex());
+
+   std::shared_ptr<mesh_vector> lumps(new mesh_vector);
+   cf_xmlNode root;
+   if(!tree.get_root(root) || "xcsg" != root.tag()) throw std::logic_error("xcsg_library: the root element is not <xcsg>");
+
+   mesh_utils::set_secant_tolerance(root.get_property("secant_tolerance",mesh_utils::default_secant_tolerance()));
+   set_clipper_scale(root.get_property("clipper_scale",static_cast<int>(DEFAULT_TO_CLIPPER)));
+   xdefinitions::singleton().set_root(root);
+
+   // the first solid is evaluated, as xcsg_main does for each top level object
+   xcsg_factory& factory = xcsg_factory::singleton();
+   for(auto i=root.begin(); i!=root.end(); i++) {
+      cf_xmlNode child(i);
+      if(child.is_attribute_node() || factory.categorize(child) != xcsg_factory::SOLID) continue;
+
+      mesh_cache::singleton().clear();
+      mesh_cache::singleton().count_subtrees(child);
+      xdefinitions::singleton().build_referenced(child);
+
+      std::shared_ptr<xsolid> obj = factory.make_solid(child);
+      if(!obj.get()) break;
+      obj->simplify();
+      std::shared_ptr<xsolid> reduced = obj->reduced();
+      if(reduced.get()) obj = reduced;
+
+      carve_boolean csg;
+      try {
+         csg.compute(obj->create_carve_mesh(),carve::csg::CSG::OP::UNION);
+      }
+      catch(carve::exception& ex) {
+         throw std::runtime_error("(carve error): " + ex.str());
+      }
+
+      // the lumps are triangulated in parallel
+      const size_t nmani = csg.size();
+      lumps->resize(nmani);
+      const bool improve = !mesh_utils::preview();
+      std::atomic<size_t> next_lump(0);
+      auto lump_task = [&csg,&lumps,&next_lump,nmani,improve]() {
+         for(size_t imani=next_lump++; imani<nmani; imani=next_lump++) {
+            (*lumps)[imani] = csg.create_triangle_mesh(imani,improve,true);
+         }
+      };
+      const size_t ntask = std::min(thread_pool::singleton().nthreads(),nmani);
+      if(ntask <= 1) lump_task();
+      else {
+         task_group lump_tasks;
+         for(size_t itask=0; itask<ntask; itask++) lump_tasks.run(lump_task);
+         lump_tasks.wait();
+      }
+      break;
+   }
+   return lumps;
+}
+
+std::shared_ptr<xcsg_library::mesh_vector> xcsg_library::evaluate_xml(const std::string& xml)
+{
+   cf_xmlTree tree;
+   std::istringstream in(xml);
+   if(!tree.read_xml(in)) throw std::logic_error("xcsg_library: the XML could not be parsed");
+   return evaluate(tree);
+}
+
+bool xcsg_library::write(std::ostream& out, std::shared_ptr<mesh_vector> lumps, format fmt)
+{
+   out_triangles exporter(lumps);
+   switch(fmt) {
+      case STL_BINARY: return exporter.write_stl(out,true);
+      case STL_ASCII:  return exporter.write_stl(out,false);
+      case OFF:        return exporter.write_off(out);
+      case OBJ:        return exporter.write_obj(out);
+      case XMESH:      return exporter.write_xmesh(out);
+      case GLB:        return glb_file().write(out,*lumps);
+   };
+   return false;
+}
@@ -0,0 +1,50 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef XCSG_LIBRARY_H
+#define XCSG_LIBRARY_H
+
+#include <memory>
+#include <string>
+#include <ostream>
+#include "triangle_mesh.h"
+class cf_xmlTree;
+
+// xcsg_library is the entry point when xcsg is embedded in another program (the libxcsg targets).
+// A model is evaluated from an in-memory tree or XML string to indexed triangle meshes,
+// one per lump, which may be written to any stream. Nothing is read or written on disk,
+// except by models referring to external files.
+// The settings are process wide, as for the command line program, so evaluations are serialized.
+
+class xcsg_library {
+public:
+   typedef triangle_mesh::mesh_vector mesh_vector;
+   enum format { STL_BINARY, STL_ASCII, OFF, OBJ, XMESH, GLB };
+
+   // nthreads = 0 means all hardware threads, it is ignored if the thread pool already exists
+   xcsg_library(size_t nthreads = 0);
+   virtual ~xcsg_library();
+
+   // evaluate the first solid of an <xcsg> tree, returns the lumps of the result.
+   // Throws std::exception on errors, the result is empty if the tree contains no solid
+   std::shared_ptr<mesh_vector> evaluate(cf_xmlTree& tree);
+
+   // as above, from an XML string
+   std::shared_ptr<mesh_vector> evaluate_xml(const std::string& xml);
+
+   // write lumps to out in the given format, returns false on stream failure
+   static bool write(std::ostream& out, std::shared_ptr<mesh_vector> lumps, format fmt);
+};
+
+#endif // XCSG_LIBRARY_H
@@ -18,23 +18,56 @@
 #include <boost/date_time.hpp>
 
 #include <sstream>
+#include <iomanip>
 #include <stdexcept>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <ctime>
+#include <boost/filesystem.hpp>
 using namespace std;
 #include "csg_parser/cf_xmlTree.h"
+#include "bulk_reader.h"
 
 #include "xshape2d.h"
 
 #include "clipper_boolean.h"
 #include "carve_boolean.h"
-#include "carve_triangulate.h"
 #include "mesh_utils.h"
 #include "xpolyhedron.h"
+#include "triangle_mesh.h"
 #include "xcsg_factory.h"
 #include "boolean_timer.h"
+#include "thread_pool.h"
+#include "cancel_token.h"
+#include "mesh_cache.h"
+#include "mesh_file_cache.h"
+#include "mesh_spill.h"
+#include "xdefinitions.h"
+#include "node_profiler.h"
+#include "mem_stats.h"
+#include "boolean_checkpoint.h"
+#include "remote_farm.h"
+#include "mesh_memory.h"
+#include "trace_writer.h"
+#include "json_log.h"
+#include "carve_boolean_thread.h"
+#include "boolean_engine.h"
+#include "sdf_field.h"
+#include "qhull/qhull3d.h"
+#include "qhull/qhull_stats.h"
 
 #include "openscad_csg.h"
 #include "out_triangles.h"
 #include "amf_file.h"
+#include "threemf_file.h"
+#include "glb_file.h"
+#include "lump_instancing.h"
+#include "mass_properties.h"
+#include "triangle_bvh.h"
 #include "dxf_file.h"
 #include "svg_file.h"
 
@@ -47,9 +80,96 @@ static std::string DisplayName(const std_filename& fname, bool show_path)
    return ((show_path)? fname.GetFullPath() : fname.GetFullName());
 }
 
-xcsg_main::xcsg_main(const boost_command_line& cmd)
+// with --export_direct the outputs are written to a staging directory inside the export directory,
+// and renamed into place when complete. The export directory never contains partial files,
+// and the staging directory is removed when the object is done, also after errors.
+// With --watch and no export directory, the outputs are staged next to the input file in the same way
+class export_staging {
+public:
+   export_staging(bool direct, const std::pair<bool,std::string>& export_dir, const std::string& xcsg_file)
+   : m_path(xcsg_file)
+   {
+      if(direct) {
+         boost::filesystem::path target = (export_dir.first)? boost::filesystem::path(export_dir.second) : boost::filesystem::path(xcsg_file).parent_path();
+         if(target.empty()) target = ".";
+         boost::filesystem::path dir = target / boost::filesystem::unique_path(".xcsg_partial_%%%%%%%%");
+         boost::filesystem::create_directories(dir);
+         m_dir    = dir.string();
+         m_target = target.string();
+         m_path   = (dir / boost::filesystem::path(xcsg_file).filename()).string();
+      }
+   }
+   ~export_staging()
+   {
+      boost::system::error_code ec;
+      if(m_dir.length() > 0) boost::filesystem::remove_all(m_dir,ec);
+   }
+
+   // true when the outputs are moved instead of copied to the export directory
+   bool active() const { return m_dir.length() > 0; }
+
+   // path given to the writers in place of the input file
+   const std::string& path() const { return m_path; }
+
+   // directory the staged outputs are moved to
+   const std::string& target() const { return m_target; }
+
+private:
+   std::string m_dir;
+   std::string m_path;
+   std::string m_target;
+};
+
+// extract, check and triangulate lump imani of the boolean result, messages are written to out.
+// The triangle mesh is created directly from the result mesh, faces are triangulated as they are copied
+static std::shared_ptr<triangle_mesh> create_lump(const carve_boolean& csg, size_t imani, const boost::posix_time::ptime& time_1, std::ostream& out)
+{
+   bool improve      = !mesh_utils::preview();
+   bool degen_check  = true;
+   std::shared_ptr<triangle_mesh> lump;
+   {
+      trace_span span("triangulate","triangulation");
+      lump = csg.create_triangle_mesh(imani,improve,degen_check);
+   }
+   out << "...lump " << imani+1 << ": " <<lump->nvertices() << " vertices, " << lump->npolygons() << " polygon faces." << endl;
+   lump->check(out);
+
+   if(lump->num_non_tri() > 0) {
+      out << "...Triangulating lump ... " << std::endl;
+      if(lump->ndropped()>0) out << ">>> Warning: dropped "<<lump->ndropped() <<" zero area triangles(s) during triangulation." << std::endl;
+      out << "...Triangulation completed with " << lump->ntriangles() << " triangle faces ";
+
+      boost::posix_time::ptime time_2 = boost::posix_time::microsec_clock::universal_time();
+      double elapsed_2 = 0.001*(time_2 - time_1).total_milliseconds();
+      out << "in " << elapsed_2 << " [sec]" << endl;
+   }
+   return lump;
+}
+
+// run f for each lump index in parallel, dealing out the lumps one at a time
+static void for_each_lump(size_t nmani, const std::function<void(size_t)>& f)
+{
+   std::atomic<size_t> next_lump(0);
+   auto lump_task = [&f,&next_lump,nmani]() {
+      for(size_t imani=next_lump++; imani<nmani; imani=next_lump++) f(imani);
+   };
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),nmani);
+   if(ntask <= 1) lump_task();
+   else {
+      task_group lump_tasks;
+      for(size_t itask=0; itask<ntask; itask++) lump_tasks.run(lump_task);
+      lump_tasks.wait();
+   }
+}
+
+xcsg_main::xcsg_main(const boost_command_line& cmd, const std::string& xcsg_file)
 : m_cmd(cmd)
-{}
+, m_xcsg_file(xcsg_file)
+, m_stdout(nullptr)
+, m_estimate(nullptr)
+{
+   if(m_xcsg_file.length()==0 && m_cmd.xcsg_files().size()>0) m_xcsg_file = m_cmd.xcsg_files()[0];
+}
 
 xcsg_main::~xcsg_main()
 {}
@@ -57,43 +177,113 @@ xcsg_main::~xcsg_main()
 bool xcsg_main::run()
 {
    if(!m_cmd.parsed_ok())return false;
-   if(m_cmd.count("xcsg-file")==0) {
+   if(m_xcsg_file.length()==0) {
       cout << endl << "Error, missing required input parameter <xcsg-file>" << endl;
       return false;
    }
 
-   std::string xcsg_file;
-   try {
-      xcsg_file = m_cmd.get<std::string>("xcsg-file");
-      std::replace(xcsg_file.begin(),xcsg_file.end(), '\\', '/');
+   std::string xcsg_file = m_xcsg_file;
+   std::replace(xcsg_file.begin(),xcsg_file.end(), '\\', '/');
+
+   // '-' reads the model from stdin, output files are then named after stdin.xcsg in the current directory
+   const bool from_stdin = (xcsg_file == "-");
+   if(from_stdin) xcsg_file = "stdin.xcsg";
+   else if(!std_filename::Exists(xcsg_file)) throw std::runtime_error("File does not exist: " + xcsg_file);
+
+   // size the shared thread pool before any boolean work starts.
+   // In server mode it already exists and is shared by all jobs
+   if(!thread_pool::is_created()) {
+      thread_pool::configure(m_cmd.threads(),m_cmd.count("pin_threads")>0);
+      thread_pool& pool = thread_pool::singleton();
+      if(pool.pinned()) cout << "...thread pool: " << pool.nthreads()-1 << " workers pinned on " << pool.nnodes() << " NUMA node(s)" << endl;
    }
-   catch(std::exception& ex) {
-      ostringstream sout;
-      sout << "xcsg  command line processing error: " << ex.what() << ", please report. "<< endl;
-      throw std::logic_error(sout.str());
+   cancel_token::singleton().set_timeout(m_cmd.timeout());
+   mem_stats::singleton().set_enabled(m_cmd.count("mem_stats")>0);
+   mem_stats::singleton().clear();
+   mesh_memory::singleton().set_budget(static_cast<size_t>(m_cmd.max_queue_mem()*1024.0*1024.0));
+   if(m_cmd.cache_dir().first) mesh_file_cache::singleton().set_directory(m_cmd.cache_dir().second);
+   else if(m_cmd.count("incremental")>0 || m_cmd.count("watch")>0) {
+      // the results of the previous run are kept in a directory next to the input file
+      std_filename cache_file(xcsg_file);
+      cache_file.SetExt("xcsg_cache");
+      mesh_file_cache::singleton().set_directory(cache_file.GetFullPath());
    }
-
-   if(!std_filename::Exists(xcsg_file)) throw std::runtime_error("File does not exist: " + xcsg_file);
+   else mesh_file_cache::singleton().set_directory("");
+   mesh_spill::singleton().set_directory((m_cmd.spill_dir().first)? m_cmd.spill_dir().second : "");
+   if(m_cmd.count("checkpoint")>0 && !m_estimate) {
+      // the checkpoint is kept next to the input file until the run completes
+      std_filename checkpoint_file(xcsg_file);
+      checkpoint_file.SetExt("checkpoint");
+      boolean_checkpoint::singleton().open(checkpoint_file.GetFullPath(),m_cmd.checkpoint_interval());
+   }
+   else boolean_checkpoint::singleton().open("",m_cmd.checkpoint_interval());
+   carve_boolean_thread::set_order((m_cmd.bool_order()=="spatial")? carve_boolean_thread::SPATIAL_ORDER : carve_boolean_thread::SIZE_ORDER);
+   carve_boolean::set_welding(m_cmd.count("weld")>0);
+   carve_boolean::set_simplify(m_cmd.count("simplify")>0);
+   carve_boolean::set_snap(m_cmd.snap());
+   carve_boolean::set_split_lumps(m_cmd.count("split_lumps")>0);
+   carve_boolean::set_deterministic(m_cmd.count("deterministic")>0);
+   carve_boolean::set_retry(m_cmd.count("no_retry")==0);
+   carve_boolean::set_partitions(m_cmd.partition_bool());
+   boolean_engine::set_current(m_cmd.bool_engine());
+   sdf_field::set_default_voxel(m_cmd.voxel());
+   remote_farm::singleton().set_workers((m_cmd.count("workers")>0)? m_cmd.get<std::string>("workers") : std::string(""));
+   out_triangles::set_stl_mmap(m_cmd.count("stl_mmap")>0);
+   out_triangles::set_gzip(m_cmd.count("compress")>0);
+   out_triangles::set_io_files(m_cmd.io_files());
+   qhull3d::set_engine((m_cmd.hull_engine()=="quickhull")? qhull3d::QUICKHULL : qhull3d::LIBQHULL);
+   bulk_reader::set_directory(std_filename(xcsg_file).GetPath());
 
    // determine if we shall display full file paths
    bool show_path = m_cmd.count("fullpath")>0;
 
    cf_xmlTree tree;
    std_filename file(xcsg_file);
+   bool loaded = false;
+
+   if(from_stdin) {
 
-   if(file.GetExt() == ".csg") {
+      // the input is OpenSCAD csg unless it starts as XML
+      trace_span span("read_stdin","parse");
+      json_log::phase phase("parse");
+      mem_stats::phase mem_phase("parse");
+      std::string text((std::istreambuf_iterator<char>(std::cin)),std::istreambuf_iterator<char>());
+      size_t ipos = text.find_first_not_of(" \t\r\n");
+      std::istringstream in(text);
+      if(ipos != std::string::npos && text[ipos] != '<') {
+         csg_parser parser(in,m_cmd.secant_tolerance());
+         parser.to_xcsg(tree);
+         loaded = true;
+      }
+      else loaded = tree.read_xml(in);
+   }
+   else if(file.GetExt() == ".csg") {
 
       cout << "Converting from: " << DisplayName(xcsg_file,show_path) << endl;
+      trace_span span("csg_parser","parse");
+      json_log::phase phase("parse");
+      mem_stats::phase mem_phase("parse");
       std::ifstream csg(xcsg_file);
       csg_parser parser(csg,m_cmd.secant_tolerance());
       parser.to_xcsg(tree);
 
+      // the converted tree is evaluated directly, the .xcsg file is only written on request
       file.SetExt("xcsg");
       xcsg_file = file.GetFullPath();
-      tree.write_xml(xcsg_file);
+      if(m_cmd.count("keep_xcsg")>0) tree.write_xml(xcsg_file);
+      loaded = true;
+   }
+   else {
+      // optionally keep large vertex and face blocks as text, they are parsed in parallel later
+      trace_span span("read_xml","parse");
+      json_log::phase phase("parse");
+      mem_stats::phase mem_phase("parse");
+      cf_xmlReader::raw_blocks raw;
+      if(m_cmd.count("bulk_read")>0) raw = bulk_reader::raw_blocks();
+      loaded = tree.read_xml(xcsg_file,raw);
    }
 
-   if(tree.read_xml(xcsg_file)) {
+   if(loaded) {
 
       cout << "xcsg processing: " << DisplayName(file,show_path) << endl;
 
@@ -102,23 +292,94 @@ bool xcsg_main::run()
          if("xcsg" == root.tag()) {
 
             // set the global secant tolerance,
-            mesh_utils::set_secant_tolerance(root.get_property("secant_tolerance",mesh_utils::secant_tolerance()));
+            mesh_utils::set_secant_tolerance(root.get_property("secant_tolerance",mesh_utils::default_secant_tolerance()));
+            mesh_utils::set_preview(m_cmd.count("preview")>0);
+
+            // set the 2d integer coordinate scale
+            set_clipper_scale(root.get_property("clipper_scale",static_cast<int>(DEFAULT_TO_CLIPPER)));
 
-            size_t icount = 0;
+            // named definitions referred to by <instance> elements
+            xdefinitions::singleton().set_root(root);
+
+            // all top level objects are processed
+            std::vector<cf_xmlNode> objects;
+            std::vector<cf_xmlNode::iterator> object_pos;
+            std::vector<xcsg_factory::category> categories;
             for(auto i=root.begin(); i!=root.end(); i++) {
                cf_xmlNode child(i);
                if(!child.is_attribute_node()) {
-                  if(xcsg_factory::singleton().is_solid(child)) {
-                     run_xsolid(child,xcsg_file);
-                     icount++;
+                  xcsg_factory::category type = xcsg_factory::singleton().categorize(child);
+                  if(type != xcsg_factory::NOT_OBJECT) {
+                     objects.push_back(child);
+                     object_pos.push_back(i);
+                     categories.push_back(type);
                   }
-                  else if(xcsg_factory::singleton().is_shape2d(child)) {
-                     run_xshape2d(child,xcsg_file);
-                     icount++;
+               }
+            }
+
+            // a stream carries one mesh
+            if(m_stdout && (objects.size() != 1 || categories[0] != xcsg_factory::SOLID)) {
+               throw std::logic_error("--stdout requires a model with one top level solid");
+            }
+
+            // find repeated subtrees before building the CSG trees, so they are also shared between objects.
+            // With --lod the trees are built once per level, sharing the subtrees that do not depend on the tolerance
+            const std::vector<double>& lods = m_cmd.lod();
+            const size_t nlevels = std::max(size_t(1),lods.size());
+            mesh_cache::singleton().clear();
+            for(size_t iobj=0; iobj<objects.size(); iobj++) {
+               if(categories[iobj] == xcsg_factory::SOLID) {
+                  mesh_cache::singleton().count_subtrees(objects[iobj]);
+                  if(nlevels > 1) mesh_cache::singleton().share_levels(objects[iobj]);
+               }
+            }
+
+            for(size_t ilod=0; ilod<nlevels; ilod++) {
+
+               // each level replaces the model tolerance, the definitions are rebuilt with it
+               std::string lod_suffix;
+               if(lods.size() > 0) {
+                  mesh_utils::set_secant_tolerance(lods[ilod]);
+                  if(ilod > 0) xdefinitions::singleton().set_root(root);
+                  lod_suffix = "_lod" + std::to_string(ilod);
+                  cout << "...level of detail " << ilod << ": secant tolerance " << lods[ilod] << endl;
+                  json_log::record("lod").add("level",ilod).add("secant_tolerance",lods[ilod]);
+               }
+
+               // the solid trees are constructed in parallel, referenced definitions are built up front
+               for(auto& child : objects) xdefinitions::singleton().build_referenced(child);
+
+               for(size_t iobj=0; iobj<objects.size(); iobj++) {
+                  cf_xmlNode& child = objects[iobj];
+
+                  // with several objects, each gets its own numbered output files
+                  std::string obj_file = xcsg_file;
+                  if(objects.size() > 1 || lods.size() > 0) {
+                     std_filename numbered(xcsg_file);
+                     if(objects.size() > 1) numbered.SetName(numbered.GetName() + "_" + std::to_string(iobj+1));
+                     numbered.SetName(numbered.GetName() + lod_suffix);
+                     obj_file = numbered.GetFullPath();
                   }
+
+                  // a built solid tree no longer needs its xml, which may hold large vertex and face blocks.
+                  // It is kept until the last level of detail is built
+                  std::function<void()> release_xml;
+                  if(ilod+1 == nlevels) release_xml = [&root,&object_pos,iobj]() { root.erase(object_pos[iobj]); };
+                  if(categories[iobj] == xcsg_factory::SOLID) run_xsolid(child,obj_file,release_xml);
+                  else                                          run_xshape2d(child,obj_file);
                }
-               if(icount > 0)break;
             }
+
+            // all objects completed, a rerun starts from scratch
+            boolean_checkpoint::singleton().complete();
+
+            if((m_cmd.count("incremental")>0 || m_cmd.count("watch")>0) && !m_cmd.cache_dir().first) {
+               // subtrees of the previous run that no longer exist in the model
+               size_t nstale = mesh_file_cache::singleton().prune();
+               if(nstale > 0) cout << "...incremental: removed " << nstale << " stale subtree meshes" << endl;
+            }
+            // meshes kept in memory by --watch are only needed while their subtrees remain
+            mesh_file_cache::singleton().release_unused();
          }
       }
    }
@@ -129,17 +390,230 @@ bool xcsg_main::run()
 }
 
 
-bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file)
+// approximate mesh of obj from its signed distance field, voxel 0 means 1/256 of the largest model extent
+static std::shared_ptr<carve::mesh::MeshSet<3>> create_sdf_mesh(std::shared_ptr<xsolid> obj, double voxel)
+{
+   if(voxel <= 0.0) {
+      xbounds box;
+      if(!obj->bounding_box(box) || box.empty()) throw std::logic_error("The model size is unknown, please specify --voxel for the sdf backend");
+      xvertex extent = box.max() - box.min();
+      voxel = std::max(std::max(extent[0],extent[1]),extent[2])/256.0;
+      if(voxel <= 0.0) throw std::logic_error("The model has no volume, please specify --voxel for the sdf backend");
+   }
+   std::shared_ptr<sdf_field> field = obj->create_sdf(voxel);
+   cout << "...sdf backend: voxel size " << voxel << ", " << field->nblocks() << " blocks, " << field->ndense() << " near the surface" << endl;
+   json_log::record("sdf").add("voxel",voxel).add("blocks",field->nblocks()).add("dense",field->ndense());
+   return field->create_mesh();
+}
+
+// totals of the convex hulls, e.g. of a minkowski sum, for the profile report
+static void write_hull_report(std::ostream& out)
+{
+   qhull_stats& stats = qhull_stats::singleton();
+   const qhull_stats::totals hulls[2] = { stats.hull2d(), stats.hull3d() };
+   std::ios_base::fmtflags flags = out.flags();
+   std::streamsize precision = out.precision();
+   for(size_t i=0; i<2; i++) {
+      const qhull_stats::totals& t = hulls[i];
+      if(t.nhull == 0) continue;
+      out << "...hull" << i+2 << "d: " << t.nhull << " hulls, points in " << t.points_in << ", processed " << t.processed
+          << ", vertices " << t.vertices << ", facets " << t.facets << ", merges " << t.merges
+          << std::fixed << std::setprecision(3) << ", time " << t.ms << " ms, mean " << t.ms/t.nhull << " ms, max " << t.max_ms << " ms" << std::endl;
+   }
+   out.flags(flags);
+   out.precision(precision);
+}
+
+// write lump and total mass properties as .props.json, returns the path written
+static std::string write_props(const std::vector<mass_properties>& lump_props, const std::string& out_file)
+{
+   std_filename props_file(out_file);
+   props_file.SetExt("props.json");
+   std::ofstream json(props_file.GetFullPath());
+   json << std::setprecision(15);
+   mass_properties total;
+   json << "{ \"lumps\": [" << endl;
+   for(size_t imani=0; imani<lump_props.size(); imani++) {
+      total.add(lump_props[imani]);
+      json << "  ";
+      lump_props[imani].write_json(json);
+      json << ((imani+1 < lump_props.size())? "," : "") << endl;
+   }
+   json << "]," << endl << "\"total\": ";
+   total.write_json(json);
+   json << " }" << endl;
+   if(!json) throw std::runtime_error("Failed to write " + props_file.GetFullPath());
+   return props_file.GetFullPath();
+}
+
+// answer the queries listed in query_path against the result, one per line:
+//    inside x y z              -> inside | outside
+//    distance x y z            -> distance d cx cy cz   (closest surface point c)
+//    ray x y z dx dy dz        -> hit t hx hy hz lump | miss
+// Empty lines and lines starting with '#' are skipped. The results are written
+// in query order as .query.txt, returns the path written
+static std::string write_queries(const triangle_mesh::mesh_vector& lumps, const std::string& query_path, const std::string& out_file)
+{
+   struct query {
+      std::string type;
+      double      v[6];
+      std::string result;
+   };
+   std::vector<query> queries;
+   std::ifstream in(query_path);
+   if(!in) throw std::runtime_error("Query file not found: " + query_path);
+   std::string line;
+   for(size_t iline=1; std::getline(in,line); iline++) {
+      std::istringstream items(line);
+      query q;
+      if(!(items >> q.type) || q.type[0] == '#') continue;
+      const size_t nvalues = (q.type == "ray")? 6 : ((q.type == "inside" || q.type == "distance")? 3 : 0);
+      size_t ivalue = 0;
+      while(ivalue<nvalues && items >> q.v[ivalue]) ivalue++;
+      if(nvalues == 0 || ivalue < nvalues) {
+         throw std::runtime_error("Query file " + query_path + ", line " + std::to_string(iline) + ": expected 'inside x y z', 'distance x y z' or 'ray x y z dx dy dz'");
+      }
+      queries.push_back(q);
+   }
+
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   std::unique_ptr<triangle_bvh> bvh;
+   {
+      trace_span span("bvh","query");
+      bvh.reset(new triangle_bvh(lumps));
+   }
+
+   // the tree is read only, the queries are answered in parallel chunks
+   const size_t query_chunk = 256;
+   auto answer = [&queries,&bvh,query_chunk](size_t ichunk) {
+      trace_span span("queries","query");
+      std::ostringstream out;
+      out << std::setprecision(12);
+      const size_t ilast = std::min(queries.size(),(ichunk+1)*query_chunk);
+      for(size_t i=ichunk*query_chunk; i<ilast; i++) {
+         query& q = queries[i];
+         const xvertex p = carve::geom::VECTOR(q.v[0],q.v[1],q.v[2]);
+         out.str("");
+         if(q.type == "inside") {
+            out << ((bvh->inside(p))? "inside" : "outside");
+         }
+         else if(q.type == "distance") {
+            xvertex c;
+            double d = bvh->distance(p,c);
+            out << "distance " << d << " " << c.x << " " << c.y << " " << c.z;
+         }
+         else {
+            double t = 0.0;
+            size_t lump = 0;
+            if(bvh->first_hit(p,carve::geom::VECTOR(q.v[3],q.v[4],q.v[5]),t,lump)) {
+               out << "hit " << t << " " << q.v[0]+t*q.v[3] << " " << q.v[1]+t*q.v[4] << " " << q.v[2]+t*q.v[5] << " " << lump+1;
+            }
+            else out << "miss";
+         }
+         q.result = out.str();
+      }
+   };
+   const size_t nchunk = (queries.size() + query_chunk-1)/query_chunk;
+   if(nchunk <= 1 || thread_pool::singleton().nthreads() <= 1) {
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) answer(ichunk);
+   }
+   else {
+      task_group tasks;
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) tasks.run([&answer,ichunk]() { answer(ichunk); });
+      tasks.wait();
+   }
+   boost::posix_time::time_duration ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+   cout << "...answered " << queries.size() << " queries on " << bvh->ntriangles() << " triangles, "
+        << bvh->nnodes() << " bvh nodes, in " << setprecision(5) << 0.001*ptime_diff.total_milliseconds() << " [sec]" << endl;
+   json_log::record("queries").add("queries",queries.size()).add("triangles",bvh->ntriangles()).add("nodes",bvh->nnodes());
+
+   std_filename query_file(out_file);
+   query_file.SetExt("query.txt");
+   std::ofstream out(query_file.GetFullPath());
+   for(auto& q : queries) out << q.result << '\n';
+   if(!out) throw std::runtime_error("Failed to write " + query_file.GetFullPath());
+   return query_file.GetFullPath();
+}
+
+// report the estimate of obj, and write it per node as .estimate.json
+static void write_estimate(std::shared_ptr<xsolid> obj, size_t nbool, const std::string& xcsg_file, bool show_path)
+{
+   xsolid::mesh_estimate e = obj->estimate();
+   size_t peak_bytes = mesh_memory::estimate(e.peak_faces);
+   cout << "...estimate: " << e.faces << " faces, " << e.bool_faces << " faces into booleans, peak "
+        << e.peak_faces << " faces (" << setprecision(4) << peak_bytes/(1024.0*1024.0) << " MB)" << endl;
+
+   std_filename estimate_file(xcsg_file);
+   estimate_file.SetExt("estimate.json");
+   std::ofstream json(estimate_file.GetFullPath());
+   json << "{ \"secant_tolerance\": " << mesh_utils::secant_tolerance()
+        << ", \"nbool\": " << nbool << ", \"faces\": " << e.faces
+        << ", \"bool_faces\": " << e.bool_faces << ", \"peak_faces\": " << e.peak_faces
+        << ", \"peak_bytes\": " << peak_bytes << "," << endl
+        << "\"nodes\": ";
+   node_profiler::singleton().write_estimate_json(json);
+   json << "}" << endl;
+   cout << "Created estimate file: " << DisplayName(estimate_file,show_path) << endl;
+}
+
+
+bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file, const std::function<void()>& release_xml)
 {
-   cout << "processing solid: " << node.tag() << endl;
+   // only the tag is used after the tree is built, the xml may be released then
+   const std::string tag = node.tag();
+   cout << "processing solid: " << tag << endl;
+
+   // the estimate is recorded per node by the profiler
+   const bool estimate = m_cmd.count("estimate")>0 || m_estimate != nullptr;
+   node_profiler& profiler = node_profiler::singleton();
+   // --mem_stats charges memory to the top nodes through the profiler
+   mem_stats& mem = mem_stats::singleton();
+   profiler.set_enabled(m_cmd.count("profile")>0 || estimate || mem.enabled());
+   profiler.clear();
+   qhull_stats::singleton().set_enabled(m_cmd.count("profile")>0);
+   qhull_stats::singleton().clear();
+   mesh_memory::singleton().clear();
+
+   // with --workers, the children of a top level boolean are meshed remotely
+   remote_farm& farm = remote_farm::singleton();
+   farm.select(node);
    std::shared_ptr<xsolid> obj = xcsg_factory::singleton().make_solid(node);
+   farm.clear();
+   if(release_xml) release_xml();
    if(obj.get()) {
 
+      if(mem.enabled()) {
+         std::vector<std::string> paths;
+         std::vector<int> slots = profiler.top_nodes(paths);
+         mem.set_nodes(slots,paths);
+      }
+
       // determine if we shall display full file paths
       bool show_path = m_cmd.count("fullpath")>0;
 
+      // flatten nested booleans and prune excluded solids that cannot reach the included ones.
+      // Profiling reports the simplified tree, as it is the one evaluated
+      if(m_cmd.count("no_simplify")==0) {
+         size_t nelim = obj->simplify();
+         std::shared_ptr<xsolid> child = obj->reduced();
+         if(child.get()) obj = child;
+         if(nelim > 0) cout << "...simplified CSG tree: " << nelim << " boolean operations eliminated" << endl;
+      }
+
       size_t nbool = obj->nbool();
       cout << "...completed CSG tree: " <<  nbool << " boolean operations to process." << endl;
+      json_log::record("csg_tree").add("object",tag).add("nbool",nbool);
+      if(m_estimate) {
+         xsolid::mesh_estimate e = obj->estimate();
+         m_estimate->nbool      += nbool;
+         m_estimate->bool_faces += e.bool_faces;
+         m_estimate->peak_bytes  = std::max(m_estimate->peak_bytes,mesh_memory::estimate(e.peak_faces));
+         return true;
+      }
+      if(estimate) {
+         write_estimate(obj,nbool,xcsg_file,show_path);
+         return true;
+      }
       if(nbool > m_cmd.max_bool()) {
          ostringstream sout;
          sout << "Max " << m_cmd.max_bool() << " boolean operations allowed in this configuration.";
@@ -151,84 +625,335 @@ bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file)
          cout << "...starting boolean operations" << endl;
       }
 
+      // the tree is owned here alone, so subtrees and their input data are released as soon
+      // as their meshes are queued. Shared definitions and cached subtrees are kept
+      obj->set_releasable();
+
       boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
       carve_boolean csg;
       try {
 
+         boolean_timer::reporter_scope reporter;
          boolean_timer::singleton().init(static_cast<int>(nbool));
-         csg.compute(obj->create_carve_mesh(),carve::csg::CSG::OP::UNION);
+         {
+            trace_span span("create_carve_mesh","csg");
+            json_log::phase phase("boolean");
+            mem_stats::phase mem_phase("boolean");
+            if(m_cmd.backend() == "sdf") csg.compute(create_sdf_mesh(obj,m_cmd.voxel()),carve::csg::CSG::OP::UNION);
+            else                         csg.compute(obj->create_carve_mesh(),carve::csg::CSG::OP::UNION);
+            obj.reset();
+         }
          boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
          double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
 
          cout << "...completed boolean operations in " << setprecision(5) << elapsed_sec << " [sec] " << endl;
+         if(nbool > 0) boolean_timer::singleton().report(thread_pool::singleton().nthreads());
+         else          boolean_timer::singleton().stop();
+
+         mesh_cache& cache = mesh_cache::singleton();
+         if(cache.repeated() > 0) {
+            cout << "...reused meshes of " << cache.repeated() << " repeated subtrees " << cache.hits() << " times" << endl;
+         }
+         boolean_checkpoint& checkpoint = boolean_checkpoint::singleton();
+         if(checkpoint.resumed() > 0) {
+            cout << "...resumed " << checkpoint.resumed() << " boolean reductions from checkpoint" << endl;
+         }
+         mesh_file_cache& file_cache = mesh_file_cache::singleton();
+         if(file_cache.enabled()) {
+            cout << "...file cache: " << file_cache.loaded() << " subtree meshes loaded, " << file_cache.saved() << " saved";
+            if(file_cache.retained_hits() > 0) cout << ", " << file_cache.retained_hits() << " reused in memory";
+            cout << endl;
+         }
+         const bool profile = m_cmd.count("profile")>0;
+         if(profile || mesh_memory::singleton().budget() > 0) {
+            mesh_memory::singleton().write_report(cout);
+         }
+         if(mesh_spill::singleton().enabled()) {
+            mesh_spill::singleton().write_report(cout);
+         }
+         if(profile) {
+            profiler.write_report(cout);
+            write_hull_report(cout);
+            std_filename profile_file(xcsg_file);
+            profile_file.SetExt("profile.json");
+            std::ofstream json(profile_file.GetFullPath());
+            profiler.write_json(json);
+            cout << "Created profile file : " << DisplayName(profile_file,show_path) << endl;
+         }
       }
       catch(carve::exception& ex ) {
 
          // rethrow as std::exception
          string msg("(carve error): ");
          msg += ex.str();
-         cout << "WARNING: " << msg << endl;
+         cout << "WARNING: " << msg << ", the result is incomplete" << endl;
 //         throw std::exception(msg.c_str());
       }
 
       size_t nmani = csg.size();
       cout << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << endl;
+      json_log::record("lumps").add("lumps",nmani);
 
-      // we export only triangles
-       boost::posix_time::ptime time_1 = boost::posix_time::microsec_clock::universal_time();
-      carve_triangulate triangulate;
-      for(size_t imani=0; imani<nmani; imani++) {
+      // we export only triangles. The lumps are extracted, checked and triangulated in parallel,
+      // their messages are buffered and written in lump order
+      boost::posix_time::ptime time_1 = boost::posix_time::microsec_clock::universal_time();
+      std::shared_ptr<triangle_mesh::mesh_vector> lumps(new triangle_mesh::mesh_vector(nmani));
+      std::vector<std::string> lump_log(nmani);
 
-         // create & check lump
-         std::shared_ptr<xpolyhedron> poly = csg.create_manifold(imani);
-         cout << "...lump " << imani+1 << ": " <<poly->v_size() << " vertices, " << poly->f_size() << " polygon faces." << endl;
+      // --props computes volume, area, centroid and bounding box of the lumps as exported
+      const bool props = m_cmd.count("props")>0;
+      std::vector<mass_properties> lump_props((props)? nmani : 0);
 
-         size_t num_non_tri = 0;
-         poly->check_polyhedron(cout,num_non_tri);
+      // create object for file export
+      out_triangles exporter(lumps);
+      export_staging staging(m_cmd.count("export_direct")>0 || m_cmd.count("watch")>0,m_cmd.export_dir(),xcsg_file);
+      const std::string& out_file = staging.path();
 
-         if(num_non_tri > 0) {
-            cout << "...Triangulating lump ... " << std::endl;
-            bool improve      = true;
-            bool canonicalize = true;
-            bool degen_check  = true;
+      // When only STL and OBJ files are requested, each lump is appended to the open files as soon as
+      // it is triangulated and then released, instead of collecting all lumps before exporting
+      const bool decimate = m_cmd.max_triangles()>0 || m_cmd.max_error()>0.0;
+      const bool stl = !m_stdout && (m_cmd.count("stl")>0 || m_cmd.count("astl")>0);
+      const bool obj_out = !m_stdout && m_cmd.count("obj")>0;
+      const bool stream = (stl || obj_out) && !m_stdout && !decimate && out_triangles::can_stream()
+                       && m_cmd.count("csg")==0 && m_cmd.count("amf")==0 && m_cmd.count("3mf")==0
+                       && m_cmd.count("off")==0 && m_cmd.count("xmesh")==0 && m_cmd.count("glb")==0 && m_cmd.count("query")==0;
+      if(stream) {
+         cout <<    "...Exporting results while triangulating " << endl;
+         exporter.stream_open(out_file,stl,m_cmd.count("stl")>0,obj_out);
+      }
+      {
+         json_log::phase phase("triangulate");
+         mem_stats::phase mem_phase("triangulate");
 
-            cout << "...Triangulation completed with " << triangulate.compute(poly->create_carve_polyhedron(),improve,canonicalize,degen_check)<< " triangle faces ";
-//            cout << "...Triangulation completed with " << triangulate.compute2d(poly->create_carve_polyhedron())<< " triangle faces ";
+         // lumps identical to another lump up to a translation are triangulated once,
+         // the others become instances of it. The sources are kept for their instances
+         std::unique_ptr<lump_instancing> instancing;
+         if(nmani > 1 && m_cmd.count("no_instance")==0) {
+            trace_span span("instancing","triangulation");
+            instancing.reset(new lump_instancing(*csg.mesh_set()));
+            if(instancing->ninstances() > 0) {
+               cout << "...found " << instancing->ninstances() << " lump instances, identical to another lump up to a translation" << endl;
+            }
+            else instancing.reset();
+         }
+         std::vector<std::shared_ptr<triangle_mesh>> sources((instancing)? nmani : 0);
 
-            boost::posix_time::ptime time_2 = boost::posix_time::microsec_clock::universal_time();
-            double elapsed_2 = 0.001*(time_2 - time_1).total_milliseconds();
-            cout << "in " << elapsed_2 << " [sec]" << endl;
+         for_each_lump(nmani,[&csg,&lumps,&lump_log,&lump_props,&exporter,&instancing,&sources,stream,props,time_1](size_t imani) {
+            if(instancing && instancing->source(imani) != imani) return;
+            std::ostringstream out;
+            std::shared_ptr<triangle_mesh> lump;
+            try {
+               lump = create_lump(csg,imani,time_1,out);
+            }
+            catch(carve::exception& ex) {
+               throw std::runtime_error("(carve error): " + ex.str());
+            }
+            lump_log[imani] = out.str();
+            json_log::record("lump").add("lump",imani+1).add("vertices",lump->nvertices()).add("faces",lump->npolygons()).add("triangles",lump->ntriangles());
+            if(instancing) sources[imani] = lump;
+            if(stream && props) lump_props[imani] = mass_properties(*lump);
+            if(stream) exporter.stream_lump(imani,lump);
+            else       (*lumps)[imani] = lump;
+         });
 
+         for(size_t imani=0; instancing && imani<nmani; imani++) {
+            size_t isource = instancing->source(imani);
+            if(isource == imani) continue;
+            const xvertex& offset = instancing->offset(imani);
+            std::shared_ptr<triangle_mesh> lump = std::make_shared<triangle_mesh>(sources[isource],offset);
+            std::ostringstream out;
+            out << "...lump " << imani+1 << ": instance of lump " << isource+1 << ", translated by (" << offset.x << ", " << offset.y << ", " << offset.z << ")" << endl;
+            lump_log[imani] = out.str();
+            json_log::record("lump").add("lump",imani+1).add("instance_of",isource+1).add("triangles",lump->ntriangles());
+            if(stream && props) lump_props[imani] = mass_properties(*lump);
+            if(stream) exporter.stream_lump(imani,lump);
+            else       (*lumps)[imani] = lump;
          }
-         else {
-            // triangulation not required
-            triangulate.add(poly->create_carve_polyhedron());
+      }
+
+      // optional decimation, the triangle budget is shared between the lumps by their size
+      if(decimate) {
+         json_log::phase phase("decimate");
+         mem_stats::phase mem_phase("decimate");
+         size_t ntri = 0;
+         for(size_t imani=0; imani<nmani; imani++) ntri += (*lumps)[imani]->ntriangles();
+         const size_t max_triangles = m_cmd.max_triangles();
+         const double max_error     = m_cmd.max_error();
+
+         // the budgets are taken before any lump changes. Instances share the triangles of their
+         // source, they are not visited while the sources are decimated in parallel
+         std::vector<size_t> lump_max(nmani,0);
+         for(size_t imani=0; imani<nmani; imani++) {
+            size_t lump_tri = (*lumps)[imani]->ntriangles();
+            if(max_triangles > 0 && ntri > 0) lump_max[imani] = std::max(size_t(4),static_cast<size_t>(double(max_triangles)*lump_tri/ntri));
          }
+         for_each_lump(nmani,[&lumps,&lump_log,&lump_max,max_error](size_t imani) {
+            triangle_mesh& lump = *(*lumps)[imani];
+            if(lump.source()) return;
+            trace_span span("decimate","decimation");
+            size_t nremoved = lump.decimate(lump_max[imani],max_error);
+            if(nremoved > 0) {
+               std::ostringstream out;
+               out << "...Decimated lump " << imani+1 << " to " << lump.ntriangles() << " triangle faces" << endl;
+               lump_log[imani] += out.str();
+            }
+         });
       }
-      cout <<    "...Exporting results " << endl;
 
-      // create object for file export
-      out_triangles exporter(triangulate.carve_polyset());
+      for(size_t imani=0; imani<nmani; imani++) {
+         cout << lump_log[imani];
+      }
+
+      // streamed lumps are released once written, their properties were computed before.
+      // Otherwise the final, possibly decimated, lumps are used
+      if(props) {
+         json_log::phase phase("props");
+         if(!stream) {
+            for_each_lump(nmani,[&lumps,&lump_props](size_t imani) { lump_props[imani] = mass_properties(*(*lumps)[imani]); });
+         }
+         mass_properties total;
+         for(size_t imani=0; imani<nmani; imani++) {
+            const mass_properties& p = lump_props[imani];
+            total.add(p);
+            xvertex c = p.centroid();
+            json_log::record("props").add("lump",imani+1).add("volume",p.volume()).add("area",p.area())
+                                     .add("cx",c.x).add("cy",c.y).add("cz",c.z);
+         }
+         xvertex c = total.centroid();
+         cout << "...mass properties: volume " << setprecision(10) << total.volume() << ", area " << total.area()
+              << ", centroid (" << c.x << ", " << c.y << ", " << c.z << ")" << endl;
+         json_log::record("props_total").add("volume",total.volume()).add("area",total.area())
+                                        .add("cx",c.x).add("cy",c.y).add("cz",c.z);
+         if(!total.empty()) {
+            xvertex pmin = total.min(), pmax = total.max();
+            cout << "...bounding box: (" << pmin.x << ", " << pmin.y << ", " << pmin.z << ") - ("
+                 << pmax.x << ", " << pmax.y << ", " << pmax.z << ")" << endl;
+         }
+      }
+      if(!stream) cout <<    "...Exporting results " << endl;
+
+      // the exporters only read the lumps, so the requested formats are written concurrently.
+      // Each export reports the path written, the report lines are printed in the usual order
+      struct export_task {
+         std::string label;
+         std::function<std::string()> write;
+         std::string path;
+      };
+      std::vector<export_task> exports;
+      if(stream) {
+         // the streamed files only need to be completed, OBJ is returned before STL
+         std::vector<std::string> paths = exporter.stream_close();
+         std::string obj_path = (obj_out)? paths.front() : "";
+         std::string stl_path = (stl)? paths.back()  : "";
+         if(obj_out) exports.push_back({"Created OBJ file     : ",[obj_path]() { return obj_path; },""});
+         if(stl) exports.push_back({"Created STL file     : ",[stl_path]() { return stl_path; },""});
+      }
+      else if(m_stdout) {
+         // --stdout streams one format, no files are written
+         const std::string format = m_cmd.stdout_format();
+         exports.push_back({"Written to stdout    : ",[&,format]() {
+            bool ok = false;
+            if(format == "stl" || format == "astl") ok = exporter.write_stl(*m_stdout,format == "stl");
+            else if(format == "obj")               ok = exporter.write_obj(*m_stdout);
+            else if(format == "off")               ok = exporter.write_off(*m_stdout);
+            else if(format == "xmesh")             ok = exporter.write_xmesh(*m_stdout);
+            else if(format == "glb")               ok = glb_file(m_cmd.count("glb_quantize")>0).write(*m_stdout,*lumps);
+            if(!ok) throw std::runtime_error("Failed to write " + format + " to stdout");
+            return format;
+         },""});
+      }
+      else {
+         if(m_cmd.count("csg")>0) exports.push_back({"Created OpenSCAD file: ",[&]() { return exporter.write_csg(out_file); },""});
+         if(m_cmd.count("amf")>0) {
+            exports.push_back({"Created AMF file     : ",[&]() {
+               amf_file amf;
+               std::string amf_path = amf.write(lumps,out_file,m_cmd.count("amf_zip")>0);
+               exporter.add_file_written(amf_path);
+               return amf_path;
+            },""});
+         }
+         if(m_cmd.count("3mf")>0) {
+            exports.push_back({"Created 3MF file     : ",[&]() {
+               threemf_file tmf;
+               std::string tmf_path = tmf.write(lumps,out_file);
+               exporter.add_file_written(tmf_path);
+               return tmf_path;
+            },""});
+         }
+         if(m_cmd.count("obj")>0)       exports.push_back({"Created OBJ file     : ",[&]() { return exporter.write_obj(out_file); },""});
+         if(m_cmd.count("off")>0)       exports.push_back({"Created OFF file(s)  : ",[&]() { return exporter.write_off(out_file); },""});
+         if(m_cmd.count("xmesh")>0)     exports.push_back({"Created XMESH file   : ",[&]() { return exporter.write_xmesh(out_file); },""});
+         if(m_cmd.count("glb")>0) {
+            exports.push_back({"Created GLB file     : ",[&]() {
+               glb_file glb(m_cmd.count("glb_quantize")>0);
+               std::string glb_path = glb.write(lumps,out_file);
+               exporter.add_file_written(glb_path);
+               return glb_path;
+            },""});
+         }
+         // STL is reported last, and its timestamp is set last so it is the most recent updated format
+         if(stl) {
+            const bool binary = m_cmd.count("stl")>0;
+            exports.push_back({"Created STL file     : ",[&,binary]() { return exporter.write_stl(out_file,binary); },""});
+         }
+      }
+
+      // queries are answered from the lumps in memory, before the exports
+      if(m_cmd.count("query")>0) {
+         json_log::phase phase("query");
+         std::string query_path = write_queries(*lumps,m_cmd.get<std::string>("query"),out_file);
+         exporter.add_file_written(query_path);
+         cout << "Created query file   : " << DisplayName(std_filename(query_path),show_path) << endl;
+      }
+
+      // the properties file is small, it is written first so STL stays the last format written
+      if(props && !m_stdout) {
+         exports.insert(exports.begin(),export_task{"Created props file   : ",[&]() {
+            std::string props_path = write_props(lump_props,out_file);
+            exporter.add_file_written(props_path);
+            return props_path;
+         },""});
+      }
+
+      {
+         json_log::phase phase("export");
+         mem_stats::phase mem_phase("export");
+         if(exports.size() <= 1 || thread_pool::singleton().nthreads() <= 1) {
+            for(auto& e : exports) e.path = e.write();
+         }
+         else {
+            task_group export_tasks;
+            for(auto& e : exports) {
+               export_task* task = &e;
+               export_tasks.run([task]() { task->path = task->write(); });
+            }
+            export_tasks.wait();
+            if(stl) {
+               boost::filesystem::last_write_time(exports.back().path,std::time(nullptr));
+            }
+         }
+      }
 
-      if(m_cmd.count("csg")>0)       cout << "Created OpenSCAD file: " << DisplayName(std_filename(exporter.write_csg(xcsg_file)),show_path) << endl;
-      if(m_cmd.count("amf")>0) {
-         amf_file amf;
-         std::string amf_path = amf.write(triangulate.carve_polyset(),xcsg_file);
-         cout << "Created AMF file     : " << DisplayName(std_filename(amf_path),show_path) << endl;
-         exporter.add_file_written(amf_path);
+      for(auto& e : exports) {
+         cout << e.label << DisplayName(std_filename(e.path),show_path) << endl;
+         json_log::record("file_written").add("path",e.path);
       }
-      if(m_cmd.count("obj")>0)       cout << "Created OBJ file     : " << DisplayName(std_filename(exporter.write_obj(xcsg_file)),show_path) << endl;
-      if(m_cmd.count("off")>0)       cout << "Created OFF file(s)  : " << DisplayName(std_filename(exporter.write_off(xcsg_file)),show_path) << endl;
-      // write STL last so it is the most recent updated format
-      if(m_cmd.count("stl")>0)       cout << "Created STL file     : " << DisplayName(std_filename(exporter.write_stl(xcsg_file,true)),show_path) << endl;
-      else if(m_cmd.count("astl")>0) cout << "Created STL file     : " << DisplayName(std_filename(exporter.write_stl(xcsg_file,false)),show_path) << endl;
 
       // check if export is requested
       auto export_pair = m_cmd.export_dir();
       if(export_pair.first) {
-         auto files_copied = exporter.copy_to(export_pair.second);
+         auto files_copied = staging.active()? exporter.move_to(export_pair.second) : exporter.copy_to(export_pair.second);
          for(auto& f : files_copied) cout << "Exported to          : " << f << endl;
       }
+      else if(staging.active()) {
+         // --watch replaces the previous outputs next to the input file in one step each
+         exporter.move_to(staging.target());
+      }
+
+      if(mem.enabled()) {
+         mem.write_report(cout);
+         mem.clear();
+      }
    }
    else {
       throw logic_error("xcsg tree contains no data. ");
@@ -240,6 +965,10 @@ bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file)
 bool xcsg_main::run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file)
 {
    cout << "processing shape2d: " << node.tag() << endl;
+   if(m_cmd.count("estimate")>0 || m_estimate != nullptr) {
+      cout << "...estimate: not available for shape2d" << endl;
+      return true;
+   }
    std::shared_ptr<xshape2d> obj = xcsg_factory::singleton().make_shape2d(node);
    if(obj.get()) {
 
@@ -248,6 +977,7 @@ bool xcsg_main::run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file)
 
       size_t nbool = obj->nbool();
       cout << "...completed CSG tree: " <<  nbool << " boolean operations to process." << endl;
+      json_log::record("csg_tree").add("object",node.tag()).add("nbool",nbool);
       if(nbool > m_cmd.max_bool()) {
          ostringstream sout;
          sout << "Max " << m_cmd.max_bool() << " boolean operations allowed in this configuration.";
@@ -258,46 +988,84 @@ bool xcsg_main::run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file)
          cout << "...starting boolean operations" << endl;
       }
       clipper_boolean csg;
-      csg.compute(obj->create_clipper_profile(),ClipperLib::ctUnion);
-
-      std::shared_ptr<polyset2d> polyset = csg.profile()->polyset();
+      std::shared_ptr<polyset2d> polyset;
+      xshape2d::profile_layers layers;
+      dxf_file::polyset_layers polyset_layers;
+      {
+         json_log::phase phase("boolean");
+         mem_stats::phase mem_phase("boolean");
+         boolean_timer::reporter_scope reporter;
+         boolean_timer::singleton().init(static_cast<int>(nbool));
+         if(obj->create_clipper_layers(layers)) {
+            // the model is the union of the layers, each layer is also exported separately
+            clipper_boolean::profile_vector profiles;
+            for(auto& layer : layers) {
+               profiles.push_back(layer.second);
+               polyset_layers.push_back(std::make_pair(layer.first,layer.second->polyset()));
+            }
+            csg.compute_union(profiles);
+         }
+         else {
+            csg.compute(obj->create_clipper_profile(),ClipperLib::ctUnion);
+         }
+         polyset = csg.profile()->polyset();
+      }
+      if(nbool > 0) boolean_timer::singleton().report(thread_pool::singleton().nthreads());
+      else          boolean_timer::singleton().stop();
       size_t nmani = polyset->size();
       cout << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << endl;
+      json_log::record("lumps").add("lumps",nmani);
+
+      out_triangles exporter(nullptr);
+      export_staging staging(m_cmd.count("export_direct")>0 || m_cmd.count("watch")>0,m_cmd.export_dir(),xcsg_file);
+      const std::string& out_file = staging.path();
 
       if(m_cmd.count("csg")>0) {
-         openscad_csg openscad(xcsg_file);
+         openscad_csg openscad(out_file);
          size_t imani = 0;
          for(auto i=polyset->begin(); i!=polyset->end(); i++) {
             std::shared_ptr<polygon2d> poly = *i;
             openscad.write_polygon(poly);
          }
          cout << "Created OpenSCAD file: " << DisplayName(std_filename(openscad.path()),show_path) << endl;
+         json_log::record("file_written").add("path",openscad.path());
+         exporter.add_file_written(openscad.path());
       }
 
-      out_triangles exporter(nullptr);
-
       // write SVG?
       if(m_cmd.count("svg")>0) {
-         svg_file svg;
-         std::string svg_path = svg.write(polyset,xcsg_file);
+         svg_file svg(m_cmd.svg_precision(),m_cmd.count("svg_relative")>0);
+         std::string svg_path = (polyset_layers.size() > 0)? svg.write(polyset_layers,out_file) : svg.write(polyset,out_file);
          exporter.add_file_written(svg_path);
          cout << "Created SVG      file: " << DisplayName(std_filename(svg_path),show_path) << endl;
+         json_log::record("file_written").add("path",svg_path);
       }
 
       // write DXF last so it is the most recent updated format
       if(m_cmd.count("dxf")>0) {
-         dxf_file dxf;
-         std::string dxf_path = dxf.write(polyset,xcsg_file);
+         dxf_file dxf(m_cmd.dxf_precision());
+         std::string dxf_path = (polyset_layers.size() > 0)? dxf.write(polyset_layers,out_file) : dxf.write(polyset,out_file);
          exporter.add_file_written(dxf_path);
          cout << "Created DXF      file: " << DisplayName(std_filename(dxf_path),show_path) << endl;
+         json_log::record("file_written").add("path",dxf_path);
       }
 
       // check if export is requested
       auto export_pair = m_cmd.export_dir();
       if(export_pair.first) {
-         auto files_copied = exporter.copy_to(export_pair.second);
+         auto files_copied = staging.active()? exporter.move_to(export_pair.second) : exporter.copy_to(export_pair.second);
          for(auto& f : files_copied) cout << "Exported to          : " << f << endl;
       }
+      else if(staging.active()) {
+         // --watch replaces the previous outputs next to the input file in one step each
+         exporter.move_to(staging.target());
+      }
+
+      mem_stats& mem = mem_stats::singleton();
+      if(mem.enabled()) {
+         mem.write_report(cout);
+         mem.clear();
+      }
    }
    else {
       throw logic_error("xcsg tree contains no data. ");
@@ -17,22 +17,43 @@
 #define XCSG_MAIN_H
 
 #include "boost_command_line.h"
+#include <ostream>
+#include <functional>
 class cf_xmlNode;
 
 class xcsg_main {
 public:
-   xcsg_main(const boost_command_line& m_cmd);
+   // dry run estimate of a job, over all top level objects and levels of detail
+   struct job_estimate {
+      job_estimate() : nbool(0), bool_faces(0), peak_bytes(0) {}
+      size_t nbool;       // boolean operations
+      size_t bool_faces;  // faces entering the booleans
+      size_t peak_bytes;  // estimated peak memory of the meshes alive at the same time
+   };
+
+   // process xcsg_file, or the first input file of the command line if empty
+   xcsg_main(const boost_command_line& m_cmd, const std::string& xcsg_file = "");
    virtual ~xcsg_main();
 
    bool run();
 
+   // with --stdout, the selected format is written to out instead of a file
+   void set_stdout(std::ostream* out) { m_stdout = out; }
+
+   // run() only estimates the solids as with --estimate, adding to e instead of writing .estimate.json
+   void set_estimate(job_estimate* e) { m_estimate = e; }
+
 protected:
 
-   bool run_xsolid(cf_xmlNode& node,const std::string& xcsg_file);
+   // release_xml is called once the solid tree is built, so the xml subtree may be dropped before the booleans
+   bool run_xsolid(cf_xmlNode& node,const std::string& xcsg_file, const std::function<void()>& release_xml = nullptr);
    bool run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file);
 
 private:
    boost_command_line m_cmd;
+   std::string        m_xcsg_file;
+   std::ostream*      m_stdout;
+   job_estimate*      m_estimate;
 };
 
 #endif // XCSG_MAIN_H
@@ -0,0 +1,118 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xcsg_server.h"
+#include "xcsg_main.h"
+#include "thread_pool.h"
+#include "cancel_token.h"
+#include "job_admission.h"
+
+#include <boost/program_options/parsers.hpp>
+#include <boost/date_time.hpp>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+xcsg_server::xcsg_server(const boost_command_line& cmd)
+: m_cmd(cmd)
+{
+   // the pool is sized from the server command line, job --threads values are ignored
+   if(!thread_pool::is_created()) thread_pool::configure(m_cmd.threads(),m_cmd.count("pin_threads")>0);
+}
+
+xcsg_server::~xcsg_server()
+{}
+
+// status line of a job run by the admission controller
+static void report_status(const std::string&, int status, double sec, const std::string& message)
+{
+   if(status == 0)               cout << "xcsg-server: ok " << sec << endl;
+   else if(message.length() > 0) cout << "xcsg-server: error " << message << endl;
+   else                          cout << "xcsg-server: error job failed with exit status " << status << endl;
+}
+
+size_t xcsg_server::run(std::istream& in)
+{
+   cout << "xcsg-server: ready" << endl;
+
+   std::unique_ptr<job_admission> jobs;
+   if(m_cmd.job_mem() > 0.0) jobs.reset(new job_admission(m_cmd,cout,report_status));
+
+   size_t nfail = 0;
+   std::string line;
+   while(std::getline(in,line)) {
+      if(line.length() > 0 && line[line.length()-1] == '\r') line.erase(line.length()-1);
+      if(line.length() == 0 || line == "quit") break;
+      if(jobs.get()) {
+         try {
+            jobs->submit(line,boost::program_options::split_unix(line));
+         }
+         catch(std::exception& ex) {
+            jobs->submit_failed(line,ex.what());
+         }
+      }
+      else if(!run_job(line)) nfail++;
+   }
+   if(jobs.get()) nfail += jobs->wait();
+   return nfail;
+}
+
+bool xcsg_server::run_job(const std::string& line)
+{
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   cancel_token& token = cancel_token::singleton();
+   token.reset();
+
+   bool ok = false;
+   std::string message;
+   try {
+      // tokenize like a shell, so quoted paths with spaces work
+      std::vector<std::string> args = boost::program_options::split_unix(line);
+      args.insert(args.begin(),"xcsg");
+      std::vector<char*> argv;
+      for(auto& a : args) argv.push_back(&a[0]);
+      argv.push_back(nullptr);
+
+      boost_command_line cmd(static_cast<int>(args.size()),&argv[0]);
+      if(!cmd.parsed_ok()) {
+         message = "invalid job command line";
+      }
+      else {
+         // a job may list several input files
+         ok = true;
+         for(auto& file : cmd.xcsg_files()) {
+            xcsg_main engine(cmd,file);
+            if(!engine.run()) {
+               ok = false;
+               message = "job failed: " + file;
+               break;
+            }
+         }
+      }
+   }
+   catch(std::exception& ex) {
+      // report the first error, not the cancellations it caused in other threads
+      message = (token.cancelled())? token.reason() : std::string(ex.what());
+   }
+
+   if(ok) {
+      double elapsed_sec = 0.001*(boost::posix_time::microsec_clock::universal_time() - time_0).total_milliseconds();
+      cout << "xcsg-server: ok " << elapsed_sec << endl;
+   }
+   else {
+      cout << "xcsg-server: error " << message << endl;
+   }
+   return ok;
+}
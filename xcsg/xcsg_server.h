@@ -0,0 +1,50 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XCSG_SERVER_H
+#define XCSG_SERVER_H
+
+#include "boost_command_line.h"
+#include <istream>
+#include <string>
+
+// xcsg_server runs many jobs in one process, so the thread pool and the
+// primitive caches stay warm between jobs. Each input line holds the arguments
+// of an ordinary xcsg run, e.g.
+//
+//    --stl --export_dir ./out model.xcsg
+//
+// The job output is followed by a status line "xcsg-server: ok <sec>" or
+// "xcsg-server: error <message>". An empty line, "quit" or end of input stops the server.
+// With --job_mem the jobs run as concurrent processes admitted within the memory and
+// core budget, see job_admission. Their output and status lines keep the input order.
+
+class xcsg_server {
+public:
+   xcsg_server(const boost_command_line& cmd);
+   virtual ~xcsg_server();
+
+   // process jobs until end of input, returns number of failed jobs
+   size_t run(std::istream& in);
+
+protected:
+   // run a single job given its command line, returns true if ok
+   bool run_job(const std::string& line);
+
+private:
+   boost_command_line m_cmd;
+};
+
+#endif // XCSG_SERVER_H
@@ -0,0 +1,90 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xcsg_watch.h"
+#include "xcsg_main.h"
+#include "file_watcher.h"
+#include "mesh_file_cache.h"
+#include "thread_pool.h"
+#include "cancel_token.h"
+
+#include <boost/date_time.hpp>
+#include <iostream>
+#include <stdexcept>
+using namespace std;
+
+xcsg_watch::xcsg_watch(const boost_command_line& cmd)
+: m_cmd(cmd)
+{
+   // the pool and the caches live as long as the watch
+   if(!thread_pool::is_created()) thread_pool::configure(m_cmd.threads(),m_cmd.count("pin_threads")>0);
+   mesh_file_cache::singleton().set_retain(true);
+}
+
+xcsg_watch::~xcsg_watch()
+{
+   mesh_file_cache::singleton().set_retain(false);
+}
+
+bool xcsg_watch::run(const std::string& xcsg_file)
+{
+   // watch from before the first run, so a save during the run is not missed
+   std::unique_ptr<file_watcher> watcher;
+   try {
+      watcher.reset(new file_watcher(xcsg_file));
+   }
+   catch(std::exception& ex) {
+      cout << "xcsg-watch: " << ex.what() << endl;
+      return false;
+   }
+
+   for(;;) {
+      run_once(xcsg_file);
+      cout << "xcsg-watch: waiting for changes to " << xcsg_file << endl;
+      if(!watcher->wait()) {
+         cout << "xcsg-watch: stopped, " << xcsg_file << " can no longer be watched" << endl;
+         return false;
+      }
+   }
+}
+
+bool xcsg_watch::run_once(const std::string& xcsg_file)
+{
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   cancel_token& token = cancel_token::singleton();
+   token.reset();
+
+   bool ok = false;
+   std::string message;
+   try {
+      xcsg_main engine(m_cmd,xcsg_file);
+      ok = engine.run();
+      if(!ok) message = "run failed: " + xcsg_file;
+   }
+   catch(std::exception& ex) {
+      // report the first error, not the cancellations it caused in other threads.
+      // The outputs of the previous run are left in place
+      message = (token.cancelled())? token.reason() : std::string(ex.what());
+   }
+
+   if(ok) {
+      double elapsed_sec = 0.001*(boost::posix_time::microsec_clock::universal_time() - time_0).total_milliseconds();
+      cout << "xcsg-watch: ok " << elapsed_sec << endl;
+   }
+   else {
+      cout << "xcsg-watch: error " << message << endl;
+   }
+   return ok;
+}
@@ -0,0 +1,47 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XCSG_WATCH_H
+#define XCSG_WATCH_H
+
+#include "boost_command_line.h"
+#include <string>
+
+// xcsg_watch runs a model, then runs it again each time the input file is saved, e.g.
+//
+//    xcsg --watch --stl model.xcsg
+//
+// The runs are incremental: subtree meshes are kept in memory between runs and in the
+// .xcsg_cache directory, so only changed subtrees are recomputed. Outputs are written to a
+// staging directory and renamed into place, so viewers never read a partial file.
+// Each run ends with a status line "xcsg-watch: ok <sec>" or "xcsg-watch: error <message>".
+
+class xcsg_watch {
+public:
+   xcsg_watch(const boost_command_line& cmd);
+   virtual ~xcsg_watch();
+
+   // run and watch until interrupted, returns false if the file cannot be watched
+   bool run(const std::string& xcsg_file);
+
+protected:
+   // run the model once, returns true if ok
+   bool run_once(const std::string& xcsg_file);
+
+private:
+   boost_command_line m_cmd;
+};
+
+#endif // XCSG_WATCH_H
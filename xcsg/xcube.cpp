@@ -15,6 +15,7 @@
 
 #include "xcube.h"
 #include "primitives3d.h"
+#include "box_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 
 xcube::xcube(double size, bool center)
@@ -31,6 +32,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xcube::create_carve_mesh(const carve::m
    return poly->create_carve_mesh();
 }
 
+void xcube::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   primitives3d::cuboid_vertices(m_size,m_size,m_size,m_center,m_center,t*get_transform(),vertices);
+}
+
 xcube::xcube(const cf_xmlNode& node)
 {
    if(node.tag() != "cube")throw logic_error("Expected xml tag cube, but found " + node.tag());
@@ -40,3 +46,13 @@ xcube::xcube(const cf_xmlNode& node)
    m_size   = node.get_property("size",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+xsolid::mesh_estimate xcube::estimate() const
+{
+   return mesh_estimate(6);
+}
+
+std::shared_ptr<box_node> xcube::box_expression(const carve::math::Matrix& t) const
+{
+   return box_boolean::make_box(m_size,m_size,m_size,m_center,t*get_transform());
+}
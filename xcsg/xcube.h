@@ -25,6 +25,11 @@ public:
    virtual ~xcube();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   void append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   bool is_convex() const { return true; }
+   mesh_estimate estimate() const;
+   double mesh_cost() const { return static_cast<double>(estimate().faces); }
+   std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const;
 private:
    double m_size;
    bool   m_center;
@@ -15,6 +15,7 @@
 
 #include "xcuboid.h"
 #include "primitives3d.h"
+#include "box_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 
 xcuboid::xcuboid(double dx, double dy, double dz, bool center)
@@ -34,6 +35,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xcuboid::create_carve_mesh(const carve:
    return poly->create_carve_mesh();
 }
 
+void xcuboid::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   primitives3d::cuboid_vertices(m_dx,m_dy,m_dz,m_center,m_center,t*get_transform(),vertices);
+}
+
 
 xcuboid::xcuboid(const cf_xmlNode& node)
 {
@@ -49,3 +55,13 @@ xcuboid::xcuboid(const cf_xmlNode& node)
    m_dz  = node.get_property("dz",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+xsolid::mesh_estimate xcuboid::estimate() const
+{
+   return mesh_estimate(6);
+}
+
+std::shared_ptr<box_node> xcuboid::box_expression(const carve::math::Matrix& t) const
+{
+   return box_boolean::make_box(m_dx,m_dy,m_dz,m_center,t*get_transform());
+}
@@ -14,7 +14,10 @@
 // EndLicense:
 
 #include "xcylinder.h"
+#include "mesh_utils.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
+#include "extrude_mesh.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "carve/mesh_simplify.hpp"
 
@@ -31,8 +34,18 @@ xcylinder::~xcylinder()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xcylinder::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    const int nseg = -1;
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r,m_r,m_h,m_center,nseg,t*get_transform());
+   carve::math::Matrix tt = t*get_transform();
+
+   // instance of the unit cylinder. clone_transform does not reorient faces, so mirrored cylinders are built directly
+   double z1 = (m_center)? -0.5*m_h : 0.0;
+   carve::math::Matrix tloc = tt*carve::math::Matrix::TRANS(0,0,z1)*carve::math::Matrix::SCALE(m_r,m_r,m_h);
+   if(!mesh_utils::is_left_hand(tloc)) {
+      return extrude_mesh::clone_transform(primitive_cache::singleton().unit_cylinder(primitives3d::cone_nseg(m_r,m_r)),tloc);
+   }
+
+   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r,m_r,m_h,m_center,nseg,tt);
    std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh();
 
    carve::mesh::MeshSimplifier simplifier;
@@ -42,6 +55,20 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xcylinder::create_carve_mesh(const carv
    return meshset;
 }
 
+void xcylinder::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   const int nseg = -1;
+   primitives3d::cone_vertices(m_r,m_r,m_h,m_center,nseg,t*get_transform(),vertices);
+}
+
+bool xcylinder::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   double z1 = (m_center)? -0.5*m_h : 0.0;
+   box.add(carve::geom::VECTOR(-m_r,-m_r,z1),carve::geom::VECTOR(m_r,m_r,z1+m_h),t*get_transform());
+   return true;
+}
+
 xcylinder::xcylinder(const cf_xmlNode& node)
 {
    if(node.tag() != "cylinder")throw logic_error("Expected xml tag cylinder, but found " + node.tag());
@@ -53,3 +80,9 @@ xcylinder::xcylinder(const cf_xmlNode& node)
    m_r   = node.get_property("r",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+xsolid::mesh_estimate xcylinder::estimate() const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   return mesh_estimate(primitives3d::cone_faces(m_r,m_r));
+}
@@ -0,0 +1,155 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xdefinitions.h"
+#include "xcsg_factory.h"
+#include "xml_hash.h"
+#include "xsolid.h"
+#include "xsolid_collector.h"
+#include <stdexcept>
+
+xdefinitions::xdefinitions()
+{}
+
+xdefinitions::~xdefinitions()
+{}
+
+void xdefinitions::clear()
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   m_defs.clear();
+}
+
+void xdefinitions::set_root(cf_xmlNode& root)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   m_defs.clear();
+
+   for(auto i=root.begin(); i!=root.end(); i++) {
+      cf_xmlNode child(i);
+      if(child.tag() != "define") continue;
+
+      if(!child.has_property("id"))throw logic_error("Required attribute 'id' not found for " + child.tag());
+      std::string id = child.get_property("id","");
+      if(m_defs.find(id) != m_defs.end())throw logic_error("Duplicate definition id: " + id);
+
+      definition& def = m_defs[id];
+      for(auto j=child.begin(); j!=child.end(); j++) {
+         cf_xmlNode sub(j);
+         if(xcsg_factory::singleton().is_solid(sub)) {
+            def.node = sub;
+            break;
+         }
+      }
+      if(!def.node.is_valid())throw logic_error("Expected a solid under definition " + id + ", but found none.");
+   }
+}
+
+size_t xdefinitions::size() const
+{
+   return m_defs.size();
+}
+
+xdefinitions::definition& xdefinitions::find(const std::string& id)
+{
+   auto i = m_defs.find(id);
+   if(i == m_defs.end())throw logic_error("instance refers to undefined id: " + id);
+   return i->second;
+}
+
+xdefinitions::definition& xdefinitions::build(const std::string& id)
+{
+   definition& def = find(id);
+   if(def.building)throw logic_error("Circular instance reference in definition: " + id);
+
+   if(!def.solid.get()) {
+      // nested instances come back here while the definition is built.
+      // The lock is held, so the definition subtree is constructed in this thread only
+      xsolid_collector::serial_scope serial;
+      def.building = true;
+      try {
+         def.solid = xcsg_factory::singleton().make_solid(def.node);
+      }
+      catch(...) {
+         def.building = false;
+         throw;
+      }
+      def.building = false;
+   }
+   return def;
+}
+
+std::shared_ptr<xsolid> xdefinitions::get(const std::string& id, bool& first)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   definition& def = build(id);
+   first = (++def.instances == 1);
+   return def.solid;
+}
+
+void xdefinitions::build_referenced(const cf_xmlNode& const_node)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   cf_xmlNode node = const_node;
+   for(auto i=node.begin(); i!=node.end(); i++) {
+      cf_xmlNode child(i);
+      if(child.is_attribute_node()) continue;
+      if(child.tag() == "instance" && child.has_property("ref")) build(child.get_property("ref",""));
+      build_referenced(child);
+   }
+}
+
+uint64_t xdefinitions::hash(const std::string& id)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   definition& def = find(id);
+   if(def.hashing)throw logic_error("Circular instance reference in definition: " + id);
+
+   if(def.hash == 0) {
+      // include the definition's own tmatrix, it is part of the instanced geometry
+      def.hashing = true;
+      uint64_t h = 0;
+      try {
+         h = xml_hash::local_hash(def.node);
+         cf_xmlNode tmatrix;
+         if(def.node.get_child("tmatrix",tmatrix)) {
+            h = xml_hash::combine(h,xml_hash::local_hash(tmatrix));
+         }
+      }
+      catch(...) {
+         def.hashing = false;
+         throw;
+      }
+      def.hashing = false;
+      def.hash = h;
+   }
+   return def.hash;
+}
+
+bool xdefinitions::get_mesh(const std::string& id, MeshSet_ptr& mesh)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   definition& def = find(id);
+   if(!def.mesh.get()) return false;
+   mesh = def.mesh;
+   return true;
+}
+
+void xdefinitions::put_mesh(const std::string& id, MeshSet_ptr mesh)
+{
+   std::lock_guard<std::recursive_mutex> lock(m_mutex);
+   definition& def = find(id);
+   if(!def.mesh.get()) def.mesh = mesh;
+}
@@ -0,0 +1,90 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XDEFINITIONS_H
+#define XDEFINITIONS_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <carve/mesh.hpp>
+#include "csg_parser/cf_xmlNode.h"
+class xsolid;
+
+// xdefinitions holds the named solid definitions of an xcsg file,
+//
+//    <define id="bolt"> <cylinder r="3" h="20"/> </define>
+//
+// placed directly under the xcsg root. An <instance ref="bolt"> element refers to a
+// definition. The definition is built and meshed once, each instance transforms a clone.
+
+class xdefinitions {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static xdefinitions& singleton()  { static xdefinitions instance; return instance;  }
+
+   // remove all definitions, then register the <define> children of root
+   void set_root(cf_xmlNode& root);
+   void clear();
+
+   size_t size() const;
+
+   // return the definition solid, built on first request.
+   // first is returned as true for the first instance referring to it
+   std::shared_ptr<xsolid> get(const std::string& id, bool& first);
+
+   // build the definitions referred to by instances under node, so a solid tree
+   // constructed in parallel finds them ready. Definitions are built serially
+   void build_referenced(const cf_xmlNode& node);
+
+   // hash of the definition subtree, used when hashing instances of it
+   uint64_t hash(const std::string& id);
+
+   // return the definition mesh in its local coordinates, if computed
+   bool get_mesh(const std::string& id, MeshSet_ptr& mesh);
+
+   // store the definition mesh. If another thread stored one first, that one is kept
+   void put_mesh(const std::string& id, MeshSet_ptr mesh);
+
+protected:
+   xdefinitions();
+   virtual ~xdefinitions();
+
+private:
+   struct definition {
+      definition() : hash(0), hashing(false), building(false), instances(0) {}
+      cf_xmlNode              node;       // the defined solid
+      uint64_t                hash;       // 0 until computed
+      bool                    hashing;    // true while the hash is computed, detects circular references
+      bool                    building;   // true while the solid is built, detects circular references
+      size_t                  instances;  // number of instances created
+      std::shared_ptr<xsolid> solid;
+      MeshSet_ptr             mesh;
+   };
+
+   definition& find(const std::string& id);
+
+   // build the definition solid unless already built, the lock must be held
+   definition& build(const std::string& id);
+
+private:
+   std::map<std::string,definition> m_defs;
+   std::recursive_mutex             m_mutex;
+};
+
+#endif // XDEFINITIONS_H
@@ -28,41 +28,23 @@ xdifference2d::~xdifference2d()
 
 std::shared_ptr<clipper_profile> xdifference2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   clipper_boolean a,b;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      a.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
-
-   for(auto i=m_excl.begin(); i!=m_excl.end(); i++) {
-      b.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
-
    clipper_boolean csg;
-   csg.compute(a.profile(),ClipperLib::ctUnion);
-   csg.compute(b.profile(),ClipperLib::ctDifference);
+   csg.compute(xshape2d_collector::union_profile(m_incl,t*get_transform()),ClipperLib::ctUnion);
+   csg.compute(xshape2d_collector::union_profile(m_excl,t*get_transform()),ClipperLib::ctDifference);
 
    return csg.profile();
 }
 
 
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xdifference2d::create_carve_mesh(const carve::math::Matrix& t) const
+bool xdifference2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
 {
-   carve_boolean a,b;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      a.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
-   }
-
-   for(auto i=m_excl.begin(); i!=m_excl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      b.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
-   }
+   return xshape2d_collector::bounding_box(m_incl,box,t*get_transform());
+}
 
-   carve_boolean csg;
-   csg.compute(a.mesh_set(),carve::csg::CSG::UNION);
-   csg.compute(b.mesh_set(),carve::csg::CSG::A_MINUS_B);
-   return csg.mesh_set();
+std::shared_ptr<carve::mesh::MeshSet<3>> xdifference2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_profile_mesh(t);
 }
 
 size_t xdifference2d::nbool()
@@ -30,6 +30,9 @@ public:
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the box of the included children
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
 private:
    std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
    std::unordered_set<std::shared_ptr<xshape2d>> m_excl;
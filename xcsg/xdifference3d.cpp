@@ -14,15 +14,23 @@
 // EndLicense:
 
 #include <numeric>
+#include <iostream>
+#include <algorithm>
 
 #include "xdifference3d.h"
+#include "xlinear_extrude.h"
+#include "xunion3d.h"
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "box_boolean.h"
+#include "sdf_field.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
+#include "thread_pool.h"
+#include <atomic>
 
 xdifference3d::xdifference3d( )
 {}
@@ -32,36 +40,35 @@ xdifference3d::~xdifference3d()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::compute_union(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>>  objects) const
 {
-   safe_queue<std::string> exception_queue;
-   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),objects,mesh_queue);
-
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
-
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
-
-   if(mesh_queue.size() > 0) return mesh_queue.dequeue();
-   else return nullptr;
+   return xunion3d::union_mesh(objects,t*get_transform());
 }
 
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // run booleans in threads
-
-   std::shared_ptr<carve::mesh::MeshSet<3>>  a = compute_union(t,m_incl);
-   std::shared_ptr<carve::mesh::MeshSet<3>>  b = compute_union(t,m_excl);
+   // subtrees of axis-aligned boxes only are computed exactly on their grid, without mesh booleans
+   std::shared_ptr<carve::mesh::MeshSet<3>> boxes = box_mesh(t);
+   if(boxes.get()) return boxes;
+
+   // run booleans in threads.
+   // The included union is computed as a pool task while the excluded solids are meshed here
+
+   std::shared_ptr<carve::mesh::MeshSet<3>>  a;
+   task_group incl_task;
+   incl_task.run([this,&t,&a]() {
+      try {
+         a = compute_union(t,m_incl);
+      }
+      catch(carve::exception& ex) {
+         throw std::runtime_error("(carve error): " + ex.str());
+      }
+   });
+
+   safe_queue<carve_boolean_thread::MeshSet_ptr> excl_queue;
+   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_excl,excl_queue);
+   incl_task.wait();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>>  b = compute_excluded(a,excl_queue);
 
    carve_boolean csg;
    csg.compute(a,carve::csg::CSG::UNION);
@@ -71,6 +78,73 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::create_carve_mesh(const
    return csg.mesh_set();
 }
 
+std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::compute_excluded(std::shared_ptr<carve::mesh::MeshSet<3>> a, safe_queue<std::shared_ptr<carve::mesh::MeshSet<3>>>& excl_queue) const
+{
+   // excluded solids not overlapping the included solid cannot change the result,
+   // so they are culled before the union of excluded solids is computed
+   const size_t nexcl = excl_queue.size();
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   carve_boolean_thread::MeshSet_ptr mesh;
+   while(excl_queue.try_dequeue(mesh)) {
+      if(!a.get() || !carve_boolean::disjoint(a.get(),mesh.get())) mesh_queue.enqueue(std::move(mesh));
+   }
+   const size_t nkeep = mesh_queue.size();
+
+   if(nkeep < nexcl) {
+      if(nkeep == 0) cout << "...Info: difference3d skipped all " << nexcl << " excluded solids, none overlap the included solid" << endl;
+      else           cout << "...Info: difference3d culled " << nexcl-nkeep << " of " << nexcl << " excluded solids not overlapping the included solid" << endl;
+   }
+
+   // excluded solids in clusters with disjoint boxes are unioned per cluster, and the results concatenated
+   std::vector<carve_boolean_thread::MeshSet_ptr> meshes;
+   while(mesh_queue.try_dequeue(mesh)) meshes.push_back(std::move(mesh));
+   std::vector<xbounds> boxes(meshes.size());
+   for(size_t i=0; i<meshes.size(); i++) {
+      carve::geom3d::AABB aabb = meshes[i]->getAABB();
+      boxes[i].add(aabb.pos - aabb.extent);
+      boxes[i].add(aabb.pos + aabb.extent);
+   }
+   std::vector<size_t> cluster;
+   const size_t nclusters = (meshes.size() > 2)? xsolid_collector::overlap_clusters(boxes,cluster) : 1;
+   if(nclusters < 2) {
+      for(auto& m : meshes) mesh_queue.enqueue(std::move(m));
+      carve_boolean_thread::compute(mesh_queue,carve::csg::CSG::UNION);
+
+      if(mesh_queue.size() > 0) return mesh_queue.dequeue();
+      else return nullptr;
+   }
+
+   std::vector<safe_queue<carve_boolean_thread::MeshSet_ptr>> cluster_queues(nclusters);
+   for(size_t i=0; i<meshes.size(); i++) cluster_queues[cluster[i]].enqueue(std::move(meshes[i]));
+   meshes.clear();
+
+   std::atomic<size_t> next_cluster(0);
+   auto cluster_task = [&cluster_queues,&next_cluster,nclusters]() {
+      for(size_t i=next_cluster++; i<nclusters; i=next_cluster++) {
+         try {
+            carve_boolean_thread::compute(cluster_queues[i],carve::csg::CSG::UNION);
+         }
+         catch(carve::exception& ex) {
+            throw std::runtime_error("(carve error): " + ex.str());
+         }
+      }
+   };
+   task_group cluster_tasks;
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),nclusters);
+   for(size_t itask=0; itask<ntask; itask++) cluster_tasks.run(cluster_task);
+   cluster_tasks.wait();
+
+   std::vector<carve_boolean_thread::MeshSet_ptr> parts;
+   std::vector<const carve::mesh::MeshSet<3>*> sets;
+   for(auto& q : cluster_queues) {
+      if(q.try_dequeue(mesh)) {
+         parts.push_back(mesh);
+         sets.push_back(mesh.get());
+      }
+   }
+   return carve_boolean::concatenate(sets);
+}
+
 
 size_t xdifference3d::nbool()
 {
@@ -96,3 +170,82 @@ xdifference3d::xdifference3d(const cf_xmlNode& node)
    size_t nchildren = m_incl.size() + m_excl.size();
    if(nchildren<2) throw logic_error("difference3d requires 2 or more children but found " + std::to_string(nchildren));
 }
+
+size_t xdifference3d::simplify()
+{
+   size_t nelim = xsolid_collector::simplify_children(m_incl) + xsolid_collector::simplify_children(m_excl);
+
+   // extrudes sharing their plane and height are unioned in 2d, and extruded through-holes are subtracted in 2d
+   nelim += xlinear_extrude::merge_union(m_incl);
+   nelim += xlinear_extrude::merge_holes(m_incl,m_excl);
+
+   xbounds incl_box;
+   if(!xsolid_collector::bounding_box(m_incl,incl_box,carve::math::Matrix())) return nelim;
+
+   for(auto i=m_excl.begin(); i!=m_excl.end(); ) {
+      xbounds excl_box;
+      if((*i)->bounding_box(excl_box) && incl_box.disjoint(excl_box)) {
+         nelim += ((*i)->nbool()+1);
+         i = m_excl.erase(i);
+      }
+      else i++;
+   }
+   return nelim;
+}
+
+std::shared_ptr<xsolid> xdifference3d::reduced()
+{
+   if(m_incl.size() != 1 || m_excl.size() > 0) return nullptr;
+   std::shared_ptr<xsolid> child = *m_incl.begin();
+   child->set_transform(get_transform()*child->get_transform());
+   return child;
+}
+
+bool xdifference3d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return xsolid_collector::bounding_box(m_incl,box,t*get_transform());
+}
+
+xsolid::mesh_estimate xdifference3d::estimate() const
+{
+   mesh_estimate a = xsolid_collector::estimate(m_incl);
+   mesh_estimate b = xsolid_collector::estimate(m_excl);
+   mesh_estimate e(a.faces+b.faces);
+   e.bool_faces = a.bool_faces + b.bool_faces + e.faces;
+   e.peak_faces = std::max(std::max(a.peak_faces,b.peak_faces),2*e.faces);
+   return e;
+}
+
+double xdifference3d::mesh_cost() const
+{
+   return xsolid_collector::mesh_cost(m_incl) + xsolid_collector::mesh_cost(m_excl);
+}
+
+std::shared_ptr<box_node> xdifference3d::box_expression(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<box_node> node = std::make_shared<box_node>(box_node::DIFFERENCE);
+   if(!xsolid_collector::box_expression(m_incl,t*get_transform(),*node)) return nullptr;
+   node->nincl = node->children.size();
+   if(!xsolid_collector::box_expression(m_excl,t*get_transform(),*node)) return nullptr;
+   return node;
+}
+
+std::shared_ptr<sdf_field> xdifference3d::create_sdf(double voxel, const carve::math::Matrix& t) const
+{
+   std::shared_ptr<sdf_field> field = xsolid_collector::create_sdf(m_incl,voxel,t*get_transform());
+   if(m_excl.size() > 0) field->combine(*xsolid_collector::create_sdf(m_excl,voxel,t*get_transform()),sdf_field::DIFFERENCE);
+   return field;
+}
+
+void xdifference3d::set_releasable()
+{
+   xsolid::set_releasable();
+   xsolid_collector::set_releasable(m_incl);
+   xsolid_collector::set_releasable(m_excl);
+}
+
+void xdifference3d::release_mesh_data()
+{
+   m_incl.clear();
+   m_excl.clear();
+}
@@ -18,6 +18,7 @@
 
 #include "xsolid.h"
 #include <set>
+#include "safe_queue.h"
 
 class xdifference3d : public xsolid {
 public:
@@ -29,9 +30,28 @@ public:
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   // excluded solids with boxes disjoint from the included solid are removed,
+   // the included solid replaces the difference when none remain
+   virtual size_t simplify();
+   virtual std::shared_ptr<xsolid> reduced();
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the union of included and excluded solids, then one boolean between them
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+   std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<sdf_field> create_sdf(double voxel, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the children are marked and released with this solid
+   void set_releasable();
+   void release_mesh_data();
+
 private:
    std::shared_ptr<carve::mesh::MeshSet<3>> compute_union(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>>  objects) const;
 
+   // union of the excluded meshes overlapping the included solid a, nullptr if none
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_excluded(std::shared_ptr<carve::mesh::MeshSet<3>> a, safe_queue<std::shared_ptr<carve::mesh::MeshSet<3>>>& excl_queue) const;
+
 private:
    std::unordered_set<std::shared_ptr<xsolid>> m_incl;
    std::unordered_set<std::shared_ptr<xsolid>> m_excl;
@@ -49,27 +49,20 @@ size_t xfill2d::nbool()
 
 std::shared_ptr<clipper_profile> xfill2d ::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   // traverse underlying objects, fill holes and union the result
-   clipper_boolean csg;
+   // traverse underlying objects, then fill holes and union the result in one operation.
+   // The effect is that all holes dissapear, but outer contours remain
+   clipper_boolean::profile_vector profiles;
    for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<clipper_profile> profile = (*i)->create_clipper_profile(t*get_transform());
-
-      // split the profile into single path profiles with only positive winding order
-      std::list<std::shared_ptr<clipper_profile>> profiles;
-      profile->positive_profiles(profiles);
-
-      // union the profiles to obtain a single profile again
-      // the effect is that all holes dissapear, but outer contours remain
-      for(auto& p : profiles) {
-         csg.compute(p,ClipperLib::ctUnion);
-      }
+      profiles.push_back((*i)->create_clipper_profile(t*get_transform()));
    }
+   clipper_boolean csg;
+   csg.compute_fill(profiles);
    return csg.profile();
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xfill2d ::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   return 0;
+   return create_profile_mesh(t);
 }
 
 
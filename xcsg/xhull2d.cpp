@@ -46,14 +46,24 @@ std::shared_ptr<clipper_profile> xhull2d::create_clipper_profile(const carve::ma
 {
    std::shared_ptr<clipper_profile> profile(new clipper_profile);
 
-   qhull2d qhull;
-
-   // accumulate vertices of underlying objects
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-
-      std::shared_ptr<clipper_profile> profile = (*i)->create_clipper_profile(t*get_transform());
-      std::shared_ptr<polyset2d> polyset = profile->polyset();
+   // the children are evaluated concurrently
+   clipper_boolean::profile_vector profiles;
+   xshape2d_collector::create_profiles(m_incl,t*get_transform(),profiles);
+
+   // accumulate vertices of underlying objects, the input is allocated once
+   std::vector<std::shared_ptr<polyset2d>> polysets;
+   polysets.reserve(profiles.size());
+   size_t nvert = 0;
+   for(auto& child : profiles) {
+      polysets.push_back(child->polyset());
+      for(auto ipoly=polysets.back()->begin(); ipoly!=polysets.back()->end(); ipoly++) {
+         for(size_t ic=0; ic<(*ipoly)->size();ic++) nvert += (**ipoly)[ic]->size();
+      }
+   }
 
+   qhull2d qhull;
+   qhull.reserve(nvert);
+   for(auto& polyset : polysets) {
       for(auto ipoly=polyset->begin(); ipoly!=polyset->end(); ipoly++) {
          std::shared_ptr<polygon2d> poly = *ipoly;
          for(size_t ic=0; ic<poly->size();ic++) {
@@ -88,24 +98,14 @@ std::shared_ptr<clipper_profile> xhull2d::create_clipper_profile(const carve::ma
    return profile;
 }
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xhull2d::create_carve_mesh(const carve::math::Matrix& t) const
+bool xhull2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
 {
-   qhull3d qhull;
-
-   // accumulate vertices of underlying objects
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<carve::mesh::MeshSet<3>> meshset = (*i)->create_carve_mesh(t*get_transform());
-      size_t nvert =  meshset->vertex_storage.size();
-      qhull.reserve(qhull.nvertices()+nvert);
-      for(size_t i=0;i<nvert;i++) {
-         carve::mesh::MeshSet<3>::vertex_t& vertex = meshset->vertex_storage[i];
-         qhull.push_back(vertex.v[0],vertex.v[1],vertex.v[2]);
-      }
-   }
+   return xshape2d_collector::bounding_box(m_incl,box,t*get_transform());
+}
 
-   carve_boolean csg;
-   csg.compute(qhull);
-   return csg.mesh_set();
+std::shared_ptr<carve::mesh::MeshSet<3>> xhull2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_profile_mesh(t);
 }
 
 
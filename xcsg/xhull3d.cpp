@@ -19,6 +19,9 @@
 #include "carve_boolean.h"
 #include "qhull/qhull3d.h"
 #include "xsolid_collector.h"
+#include "extreme_point_filter.h"
+#include "thread_pool.h"
+#include <algorithm>
 
 xhull3d::xhull3d()
 {}
@@ -41,25 +44,101 @@ size_t xhull3d::nbool()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xhull3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   qhull3d qhull;
+   // accumulate vertices of underlying objects, convex primitives are not meshed
+   std::vector<std::vector<xvertex>> parts;
+   child_hull_vertices(parts,t);
 
-   // accumulate vertices of underlying objects
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<carve::mesh::MeshSet<3>> meshset = (*i)->create_carve_mesh(t*get_transform());
-      size_t nvert =  meshset->vertex_storage.size();
-      qhull.reserve(qhull.nvertices()+nvert);
-      for(size_t i=0;i<nvert;i++) {
-         carve::mesh::MeshSet<3>::vertex_t& vertex = meshset->vertex_storage[i];
-         qhull.push_back(vertex.v[0],vertex.v[1],vertex.v[2]);
-	//	   cout << "vertex " <<  vertex.v[0] << "  " <<  vertex.v[1] << "  " << vertex.v[2] << endl;
+   // the input buffer is allocated once for all children
+   size_t nvert = 0;
+   for(auto& part : parts) nvert += part.size();
+   qhull3d qhull;
+   double* coords = qhull.extend(nvert);
+   for(auto& part : parts) {
+      for(const xvertex& vertex : part) {
+         *coords++ = vertex.v[0];
+         *coords++ = vertex.v[1];
+         *coords++ = vertex.v[2];
       }
    }
 
+   // drop the points that are obviously interior before computing the hull
+   extreme_point_filter culling;
+   culling.filter(qhull);
+
    carve_boolean csg;
-  // cout << " xhull3d:: csg.compute(qhull)" << endl;
    csg.compute(qhull);
-  // cout << " xhull3d:: csg.compute(qhull) OK " << csg.mesh_set()->vertex_storage.size() << " " << csg.mesh_set()->meshes.size()  << endl;
    return csg.mesh_set();
 }
 
+void xhull3d::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   std::vector<std::vector<xvertex>> parts;
+   child_hull_vertices(parts,t);
+
+   size_t nvert = vertices.size();
+   for(auto& part : parts) nvert += part.size();
+   vertices.reserve(nvert);
+   for(auto& part : parts) vertices.insert(vertices.end(),part.begin(),part.end());
+}
+
+void xhull3d::child_hull_vertices(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t) const
+{
+   const carve::math::Matrix tc = t*get_transform();
+   std::vector<std::shared_ptr<xsolid>> children(m_incl.begin(),m_incl.end());
+   parts.clear();
+   parts.resize(children.size());
+
+   if(children.size() > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(size_t i=0; i<children.size(); i++) {
+         std::shared_ptr<xsolid> child = children[i];
+         std::vector<xvertex>* part = &parts[i];
+         tasks.run([child,part,&tc]() { child->append_hull_vertices(*part,tc); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(size_t i=0; i<children.size(); i++) children[i]->append_hull_vertices(parts[i],tc);
+   }
+}
+
+bool xhull3d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return xsolid_collector::bounding_box(m_incl,box,t*get_transform());
+}
 
+size_t xhull3d::simplify()
+{
+   return xsolid_collector::simplify_children(m_incl);
+}
+
+xsolid::mesh_estimate xhull3d::estimate() const
+{
+   mesh_estimate e;
+   size_t peak = 0;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      mesh_estimate child = (*i)->estimate();
+      e.faces      += child.faces;
+      e.bool_faces += child.bool_faces;
+      peak = std::max(peak,child.peak_faces);
+   }
+   e.bool_faces += e.faces;
+   e.peak_faces  = std::max(peak,2*e.faces);
+   return e;
+}
+
+double xhull3d::mesh_cost() const
+{
+   return xsolid_collector::mesh_cost(m_incl);
+}
+
+void xhull3d::set_releasable()
+{
+   xsolid::set_releasable();
+   xsolid_collector::set_releasable(m_incl);
+}
+
+void xhull3d::release_mesh_data()
+{
+   m_incl.clear();
+}
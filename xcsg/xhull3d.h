@@ -28,6 +28,28 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the hull of the children has the same hull as the children combined
+   void append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   bool is_convex() const { return true; }
+
+   // the box of the children encloses the hull, without computing child hull vertices
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual size_t simplify();
+
+   // the hull of V child vertices has at most 2V-4 triangles, about the child face count
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+   // the children are marked and released with this solid
+   void set_releasable();
+   void release_mesh_data();
+
+protected:
+   // the hull vertices of each child, the children are evaluated concurrently
+   void child_hull_vertices(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t) const;
+
 private:
    std::unordered_set<std::shared_ptr<xsolid>> m_incl;
 };
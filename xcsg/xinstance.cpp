@@ -0,0 +1,85 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xinstance.h"
+#include "xdefinitions.h"
+#include "mesh_utils.h"
+#include "mesh_view.h"
+#include "csg_parser/cf_xmlNode.h"
+
+xinstance::xinstance(const cf_xmlNode& node)
+: m_first(false)
+{
+   if(node.tag() != "instance")throw logic_error("Expected xml tag instance, but found " + node.tag());
+   if(!node.has_property("ref"))throw logic_error("Required attribute 'ref' not found for " + node.tag());
+
+   set_transform(node);
+   m_ref   = node.get_property("ref","");
+   m_solid = xdefinitions::singleton().get(m_ref,m_first);
+}
+
+xinstance::~xinstance()
+{}
+
+size_t xinstance::nbool()
+{
+   return (m_first)? m_solid->nbool() : 0;
+}
+
+size_t xinstance::simplify()
+{
+   return (m_first)? m_solid->simplify() : 0;
+}
+
+bool xinstance::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return m_solid->bounding_box(box,t*get_transform());
+}
+
+xsolid::mesh_estimate xinstance::estimate() const
+{
+   mesh_estimate e = m_solid->estimate();
+   if(!m_first) e.bool_faces = 0;
+   return e;
+}
+
+double xinstance::mesh_cost() const
+{
+   return (m_first)? m_solid->mesh_cost() : 1.0;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xinstance::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_mesh_view(t)->materialize();
+}
+
+std::shared_ptr<mesh_view> xinstance::create_mesh_view(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+
+   // a transformed view does not reorient faces, so mirrored instances are computed directly
+   if(mesh_utils::is_left_hand(tt)) {
+      return std::make_shared<mesh_view>(m_solid->create_carve_mesh(tt));
+   }
+
+   // if another thread is computing the definition, compute it here rather than wait
+   xdefinitions& defs = xdefinitions::singleton();
+   std::shared_ptr<carve::mesh::MeshSet<3>> local;
+   if(!defs.get_mesh(m_ref,local)) {
+      local = m_solid->create_carve_mesh();
+      defs.put_mesh(m_ref,local);
+   }
+   return std::make_shared<mesh_view>(local,tt);
+}
@@ -0,0 +1,56 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XINSTANCE_H
+#define XINSTANCE_H
+
+#include "xsolid.h"
+#include <string>
+
+// xinstance places a named definition (see xdefinitions) with its own transform,
+//
+//    <instance ref="bolt"> <tmatrix> ... </tmatrix> </instance>
+//
+// All instances share the definition solid, which is meshed once in its local coordinates.
+
+class xinstance : public xsolid {
+public:
+   xinstance(const cf_xmlNode& node);
+   virtual ~xinstance();
+
+   // only the first instance counts the booleans of the definition
+   virtual size_t nbool();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // transformed view of the shared mesh, no copy is made until a boolean needs it
+   std::shared_ptr<mesh_view> create_mesh_view(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the shared definition is simplified by the first instance only, and never reduced
+   // since its root is shared by all instances
+   virtual size_t simplify();
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // only the first instance does the boolean work of the definition
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+private:
+   std::string             m_ref;
+   std::shared_ptr<xsolid> m_solid;  // the shared definition solid
+   bool                    m_first;
+};
+
+#endif // XINSTANCE_H
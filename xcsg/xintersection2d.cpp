@@ -38,29 +38,35 @@ size_t xintersection2d::nbool()
 
 std::shared_ptr<clipper_profile> xintersection2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
+   clipper_boolean::profile_vector profiles;
+   xshape2d_collector::create_profiles(m_incl,t*get_transform(),profiles);
+
    clipper_boolean csg;
-   size_t icount=0;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      if(icount == 0) csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-      else            csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctIntersection);
-      icount++;
+   for(size_t i=0; i<profiles.size(); i++) {
+      if(i == 0) csg.compute(profiles[i],ClipperLib::ctUnion);
+      else       csg.compute(profiles[i],ClipperLib::ctIntersection);
    }
    return csg.profile();
 }
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xintersection2d::create_carve_mesh(const carve::math::Matrix& t) const
+bool xintersection2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
 {
-   carve_boolean csg;
-
-   size_t icount=0;
+   bool known = false;
+   xbounds overlap;
    for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      if(icount == 0) csg.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
-      else            csg.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::INTERSECTION);
-      icount++;
+      xbounds child;
+      if(!(*i)->bounding_box(child,t*get_transform())) continue;
+      if(known) overlap.intersect(child);
+      else      overlap = child;
+      known = true;
    }
-   csg.eliminate_short_edges();
-   return csg.mesh_set();
+   if(known) box.add(overlap);
+   return known;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xintersection2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_profile_mesh(t);
 }
 
 xintersection2d::xintersection2d(const cf_xmlNode& node)
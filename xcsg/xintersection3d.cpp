@@ -18,9 +18,13 @@
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "xprofiled_solid.h"
+#include "box_boolean.h"
+#include "sdf_field.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
+#include <carve/input.hpp>
 
 xintersection3d::xintersection3d()
 {}
@@ -40,28 +44,24 @@ xintersection3d::xintersection3d(const cf_xmlNode& node)
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xintersection3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // run booleans in threads
+   // children with bounding boxes that do not overlap give an empty result, without meshing any of them
+   if(disjoint_children(t*get_transform())) {
+      return std::shared_ptr<carve::mesh::MeshSet<3>>(carve::input::PolyhedronData().createMesh(carve::input::Options()));
+   }
 
-   safe_queue<std::string> exception_queue;
-   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
+   // subtrees of axis-aligned boxes only are computed exactly on their grid, without mesh booleans
+   std::shared_ptr<carve::mesh::MeshSet<3>> boxes = box_mesh(t);
+   if(boxes.get()) return boxes;
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::INTERSECTION,exception_queue)));
-   }
+   // run booleans in threads
 
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
+   // repeated instances are queued as transformed views, materialized when their boolean starts
+   safe_queue<carve_boolean_thread::MeshView_ptr> view_queue;
+   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,view_queue);
 
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+   carve_boolean_thread::compute(view_queue,carve::csg::CSG::INTERSECTION);
 
-   return mesh_queue.dequeue();
+   return view_queue.dequeue()->materialize();
 }
 
 size_t xintersection3d::nbool()
@@ -75,3 +75,101 @@ size_t xintersection3d::nbool()
 }
 
 
+
+size_t xintersection3d::simplify()
+{
+   size_t nelim = xsolid_collector::simplify_children(m_incl);
+
+   // the children of nested intersections become children of this one, with the nested transform applied
+   std::unordered_set<std::shared_ptr<xsolid>> flat;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      std::shared_ptr<xintersection3d> nested = std::dynamic_pointer_cast<xintersection3d>(xprofiled_solid::unwrap(*i));
+      if(!nested.get()) {
+         flat.insert(*i);
+         continue;
+      }
+      for(auto& child : nested->m_incl) {
+         child->set_transform(nested->get_transform()*child->get_transform());
+         flat.insert(child);
+      }
+   }
+   m_incl.swap(flat);
+   return nelim;
+}
+
+std::shared_ptr<xsolid> xintersection3d::reduced()
+{
+   if(m_incl.size() != 1) return nullptr;
+   std::shared_ptr<xsolid> child = *m_incl.begin();
+   child->set_transform(get_transform()*child->get_transform());
+   return child;
+}
+
+bool xintersection3d::disjoint_children(const carve::math::Matrix& t) const
+{
+   bool known = false;
+   xbounds overlap;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      xbounds child;
+      if(!(*i)->bounding_box(child,t)) continue;
+      if(known && overlap.disjoint(child)) return true;
+      if(known) overlap.intersect(child);
+      else      overlap = child;
+      known = true;
+   }
+   return false;
+}
+
+bool xintersection3d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   bool known = false;
+   xbounds overlap;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      xbounds child;
+      if(!(*i)->bounding_box(child,t*get_transform())) continue;
+      if(known) overlap.intersect(child);
+      else      overlap = child;
+      known = true;
+   }
+   if(known) box.add(overlap);
+   return known;
+}
+
+xsolid::mesh_estimate xintersection3d::estimate() const
+{
+   return xsolid_collector::estimate(m_incl);
+}
+
+double xintersection3d::mesh_cost() const
+{
+   return xsolid_collector::mesh_cost(m_incl);
+}
+
+std::shared_ptr<box_node> xintersection3d::box_expression(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<box_node> node = std::make_shared<box_node>(box_node::INTERSECTION);
+   if(!xsolid_collector::box_expression(m_incl,t*get_transform(),*node)) return nullptr;
+   return node;
+}
+
+std::shared_ptr<sdf_field> xintersection3d::create_sdf(double voxel, const carve::math::Matrix& t) const
+{
+   std::shared_ptr<sdf_field> field;
+   for(auto& solid : m_incl) {
+      std::shared_ptr<sdf_field> b = solid->create_sdf(voxel,t*get_transform());
+      if(!field.get()) field = b;
+      else             field->combine(*b,sdf_field::INTERSECTION);
+   }
+   return (field.get())? field : std::make_shared<sdf_field>(voxel);
+}
+
+void xintersection3d::set_releasable()
+{
+   xsolid::set_releasable();
+   xsolid_collector::set_releasable(m_incl);
+}
+
+void xintersection3d::release_mesh_data()
+{
+   m_incl.clear();
+}
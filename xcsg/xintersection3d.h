@@ -27,6 +27,27 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // nested intersections are merged into this one, a single child replaces the intersection
+   virtual size_t simplify();
+   virtual std::shared_ptr<xsolid> reduced();
+
+   // the intersection lies within the box of every child with a known box
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+   std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<sdf_field> create_sdf(double voxel, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the children are marked and released with this solid
+   void set_releasable();
+   void release_mesh_data();
+
+private:
+   // true when the known child boxes in t have no common overlap, so the intersection is empty
+   bool disjoint_children(const carve::math::Matrix& t) const;
+
 private:
    std::unordered_set<std::shared_ptr<xsolid>> m_incl;
 };
@@ -17,9 +17,11 @@
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
+#include "xprofiled_solid.h"
 #include "extrude_mesh.h"
 #include "clipper_boolean.h"
 #include "xshape2d_collector.h"
+#include <cmath>
 
 xlinear_extrude::xlinear_extrude(double dz)
 : m_dz(dz)
@@ -40,16 +42,158 @@ xlinear_extrude::xlinear_extrude(const cf_xmlNode& node)
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xlinear_extrude::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   // create profile in native 2d system
+   std::shared_ptr<clipper_profile> profile = create_profile();
+
+   // apply 3d transformation when creating 3d mesh
+   return  extrude_mesh::linear_extrude(profile,m_dz,t*get_transform());
+}
+
+
+bool xlinear_extrude::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   xbounds profile;
+   if(!xshape2d_collector::bounding_box(m_incl,profile,carve::math::Matrix()) || profile.empty()) return false;
+
+   const xvertex& pmin = profile.min();
+   const xvertex& pmax = profile.max();
+   double z1 = std::min(0.0,m_dz);
+   double z2 = std::max(0.0,m_dz);
+   box.add(carve::geom::VECTOR(pmin[0],pmin[1],z1),carve::geom::VECTOR(pmax[0],pmax[1],z2),t*get_transform());
+
+   // merged parts are placed in the same system as when they were separate solids, holes only remove material
+   for(auto& part : m_merged) {
+      if(part.op == ClipperLib::ctUnion && !part.extrude->bounding_box(box,t)) return false;
+   }
+   return true;
+}
+
+std::shared_ptr<clipper_profile> xlinear_extrude::create_profile(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<clipper_profile> profile = xshape2d_collector::union_profile(m_incl,t);
+   if(m_merged.size() == 0) return profile;
+
    clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
+   csg.compute(profile,ClipperLib::ctUnion);
+   for(auto& part : m_merged) {
+      csg.compute(part.extrude->create_profile(t*part.t),part.op);
    }
+   return csg.profile();
+}
 
-   // apply 3d transformation when creating 3d mesh
-   return  extrude_mesh::linear_extrude(csg.profile(),m_dz,t*get_transform());
+// rel = inverse(a)*b for affine a and b. Returns false when a is singular
+static bool relative_transform(const carve::math::Matrix& a, const carve::math::Matrix& b, carve::math::Matrix& rel)
+{
+   // carve matrices are stored by column, m[col][row]
+   double c00 = a.m[1][1]*a.m[2][2] - a.m[2][1]*a.m[1][2];
+   double c01 = a.m[2][1]*a.m[0][2] - a.m[0][1]*a.m[2][2];
+   double c02 = a.m[0][1]*a.m[1][2] - a.m[1][1]*a.m[0][2];
+   double det = a.m[0][0]*c00 + a.m[1][0]*c01 + a.m[2][0]*c02;
+   if(std::fabs(det) < 1.0E-12) return false;
+
+   // inverse of the linear part, inv[col][row]
+   double inv[3][3];
+   inv[0][0] = c00/det;
+   inv[1][0] = (a.m[2][0]*a.m[1][2] - a.m[1][0]*a.m[2][2])/det;
+   inv[2][0] = (a.m[1][0]*a.m[2][1] - a.m[2][0]*a.m[1][1])/det;
+   inv[0][1] = c01/det;
+   inv[1][1] = (a.m[0][0]*a.m[2][2] - a.m[2][0]*a.m[0][2])/det;
+   inv[2][1] = (a.m[2][0]*a.m[0][1] - a.m[0][0]*a.m[2][1])/det;
+   inv[0][2] = c02/det;
+   inv[1][2] = (a.m[1][0]*a.m[0][2] - a.m[0][0]*a.m[1][2])/det;
+   inv[2][2] = (a.m[0][0]*a.m[1][1] - a.m[1][0]*a.m[0][1])/det;
+
+   rel = carve::math::Matrix();
+   for(size_t col=0; col<4; col++) {
+      for(size_t row=0; row<3; row++) {
+         double v = 0.0;
+         for(size_t k=0; k<3; k++) {
+            double bk = b.m[col][k] - ((col==3)? a.m[3][k] : 0.0);
+            v += inv[k][row]*bk;
+         }
+         rel.m[col][row] = v;
+      }
+   }
+   return true;
+}
+
+// true when rel maps the extrusion plane onto itself and z by a pure offset, returned in dz
+static bool in_plane(const carve::math::Matrix& rel, double& dz)
+{
+   const double tol = 1.0E-9;
+   if(std::fabs(rel.m[2][0]) > tol || std::fabs(rel.m[2][1]) > tol || std::fabs(rel.m[2][2]-1.0) > tol) return false;
+   if(std::fabs(rel.m[0][2]) > tol || std::fabs(rel.m[1][2]) > tol) return false;
+
+   // mirrored profiles would reverse their orientation
+   if(rel.m[0][0]*rel.m[1][1] - rel.m[1][0]*rel.m[0][1] <= 0.0) return false;
+   dz = rel.m[3][2];
+   return true;
+}
+
+size_t xlinear_extrude::merge_union(std::unordered_set<std::shared_ptr<xsolid>>& A)
+{
+   // the members of A, which may be profiling wrappers, and their extrudes
+   std::vector<std::shared_ptr<xsolid>> members;
+   std::vector<std::shared_ptr<xlinear_extrude>> extrudes;
+   for(auto& solid : A) {
+      std::shared_ptr<xlinear_extrude> extrude = std::dynamic_pointer_cast<xlinear_extrude>(xprofiled_solid::unwrap(solid));
+      if(extrude.get()) {
+         members.push_back(solid);
+         extrudes.push_back(extrude);
+      }
+   }
+   if(extrudes.size() < 2) return 0;
+
+   size_t nelim = 0;
+   std::vector<bool> merged(extrudes.size(),false);
+   for(size_t ibase=0; ibase<extrudes.size(); ibase++) {
+      if(merged[ibase]) continue;
+      std::shared_ptr<xlinear_extrude> base = extrudes[ibase];
+      double ztol = 1.0E-9*std::max(1.0,std::fabs(base->m_dz));
+
+      for(size_t i=ibase+1; i<extrudes.size(); i++) {
+         if(merged[i]) continue;
+         std::shared_ptr<xlinear_extrude> other = extrudes[i];
+         carve::math::Matrix rel;
+         double dz = 0.0;
+         if(!relative_transform(base->get_transform(),other->get_transform(),rel) || !in_plane(rel,dz)) continue;
+         if(std::fabs(other->zmin()+dz - base->zmin()) > ztol || std::fabs(other->zmax()+dz - base->zmax()) > ztol) continue;
+
+         rel.m[3][2] = 0.0;
+         merged_part part = { ClipperLib::ctUnion, rel, other };
+         base->m_merged.push_back(part);
+         A.erase(members[i]);
+         merged[i] = true;
+         nelim++;
+      }
+   }
+   return nelim;
 }
 
+size_t xlinear_extrude::merge_holes(std::unordered_set<std::shared_ptr<xsolid>>& A, std::unordered_set<std::shared_ptr<xsolid>>& B)
+{
+   if(A.size() != 1) return 0;
+   std::shared_ptr<xlinear_extrude> base = std::dynamic_pointer_cast<xlinear_extrude>(xprofiled_solid::unwrap(*A.begin()));
+   if(!base.get()) return 0;
+   double ztol = 1.0E-9*std::max(1.0,std::fabs(base->m_dz));
+
+   size_t nelim = 0;
+   for(auto i=B.begin(); i!=B.end(); ) {
+      std::shared_ptr<xlinear_extrude> hole = std::dynamic_pointer_cast<xlinear_extrude>(xprofiled_solid::unwrap(*i));
+      carve::math::Matrix rel;
+      double dz = 0.0;
+      if(hole.get() && relative_transform(base->get_transform(),hole->get_transform(),rel) && in_plane(rel,dz)
+         && hole->zmin()+dz <= base->zmin()+ztol && hole->zmax()+dz >= base->zmax()-ztol) {
+         rel.m[3][2] = 0.0;
+         merged_part part = { ClipperLib::ctDifference, rel, hole };
+         base->m_merged.push_back(part);
+         i = B.erase(i);
+         nelim++;
+      }
+      else i++;
+   }
+   return nelim;
+}
 
 size_t xlinear_extrude::nbool()
 {
@@ -58,5 +202,6 @@ size_t xlinear_extrude::nbool()
       std::shared_ptr<xshape2d> obj = *i;
       nbool += (obj->nbool()+1);
    }
+   for(auto& part : m_merged) nbool += (part.extrude->nbool()+1);
    return nbool-1;
 }
@@ -18,6 +18,8 @@
 
 #include "xsolid.h"
 #include "xshape2d.h"
+#include <algorithm>
+#include <vector>
 
 class xlinear_extrude : public xsolid {
 public:
@@ -28,9 +30,36 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the box of the profile swept along z, the profile is not computed
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the 2d profile in the native extrusion plane, mapped by the in-plane transform t
+   std::shared_ptr<clipper_profile> create_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the linear_extrude children of a union that share the extrusion plane and z range are merged into
+   // one extrude of their 2d union. Returns the number of 3d booleans eliminated
+   static size_t merge_union(std::unordered_set<std::shared_ptr<xsolid>>& A);
+
+   // when A is a single linear_extrude, the linear_extrude holes in B sharing its extrusion plane and
+   // spanning its z range are subtracted from its 2d profile. Returns the number of 3d booleans eliminated
+   static size_t merge_holes(std::unordered_set<std::shared_ptr<xsolid>>& A, std::unordered_set<std::shared_ptr<xsolid>>& B);
+
 private:
+   // z range of the extrusion in its own system
+   double zmin() const { return std::min(0.0,m_dz); }
+   double zmax() const { return std::max(0.0,m_dz); }
+
+   // another extrude combined with the profile in 2d, in the order merged
+   struct merged_part {
+      ClipperLib::ClipType             op;
+      carve::math::Matrix              t;       // in-plane transform of the part profile
+      std::shared_ptr<xlinear_extrude> extrude;
+   };
+
    double  m_dz;
    std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<merged_part>                      m_merged;
 };
 
 #endif // XLINEAR_EXTRUDE3D_H
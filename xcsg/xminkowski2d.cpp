@@ -4,6 +4,12 @@
 
 #include "clipper_boolean.h"
 #include "boolean_timer.h"
+#include "thread_pool.h"
+#include "xcircle.h"
+#include "mesh_utils.h"
+#include "clipper_csg/clipper_offset.h"
+#include <cmath>
+#include <algorithm>
 
 xminkowski2d::xminkowski2d()
 {}
@@ -32,10 +38,65 @@ size_t xminkowski2d::nbool()
 }
 
 
+// true if the brush is a circle that remains a circle in the xy plane under t, i.e. no skew or
+// non-uniform scaling. Returns the transformed radius and centre
+static bool circle_brush(std::shared_ptr<xshape2d> brush, const carve::math::Matrix& t, double& r, xvertex& centre)
+{
+   std::shared_ptr<xcircle> circle = std::dynamic_pointer_cast<xcircle>(brush);
+   if(!circle.get() || circle->radius() <= 0.0) return false;
+
+   carve::math::Matrix tc = t*circle->get_transform();
+   double rc = circle->radius();
+   centre    = tc * carve::geom::VECTOR(0.0,0.0,0.0);
+   xvertex x = tc * carve::geom::VECTOR(rc,0.0,0.0);
+   xvertex y = tc * carve::geom::VECTOR(0.0,rc,0.0);
+   double xx = x.x-centre.x, xy = x.y-centre.y;
+   double yx = y.x-centre.x, yy = y.y-centre.y;
+   double rx = std::sqrt(xx*xx + xy*xy);
+   double ry = std::sqrt(yx*yx + yy*yy);
+
+   const double eps = 1.0E-9*std::max(rx,ry);
+   if(rx <= 0.0 || std::fabs(rx-ry) > eps || std::fabs(xx*yx + xy*yy) > eps*std::max(rx,ry)) return false;
+   r = rx;
+   return true;
+}
+
 std::shared_ptr<clipper_profile> xminkowski2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   std::shared_ptr<clipper_profile> a       = m_incl[0]->create_clipper_profile(t*get_transform());
-   std::shared_ptr<clipper_profile> b_brush = m_incl[1]->create_clipper_profile(t*get_transform());
+   carve::math::Matrix tt = t*get_transform();
+
+   // A circle brush is a round offset of the main object, translated to the circle centre.
+   // Clipper offsets with round joins at the secant tolerance give the same geometry as the
+   // sum with a polygonized circle, with far fewer vertices to clean up afterwards
+   double r = 0.0;
+   xvertex centre;
+   if(circle_brush(m_incl[1],tt,r,centre)) {
+      std::shared_ptr<clipper_profile> a = m_incl[0]->create_clipper_profile(tt);
+
+      mesh_utils::tolerance_scope tol_scope(m_incl[1]->secant_tolerance());
+      clipper_offset offset;
+      offset.set_arc_tolerance(mesh_utils::secant_tolerance(r));
+      offset.compute(a,r,true,false);
+      std::shared_ptr<clipper_profile> result = offset.profile();
+
+      ClipperLib::cInt dx = static_cast<ClipperLib::cInt>(std::round(centre.x*TO_CLIPPER));
+      ClipperLib::cInt dy = static_cast<ClipperLib::cInt>(std::round(centre.y*TO_CLIPPER));
+      if(dx != 0 || dy != 0) {
+         for(auto& path : result->paths()) {
+            for(auto& p : path) { p.X += dx; p.Y += dy; }
+         }
+         result->set_dirty();
+      }
+      return result;
+   }
+
+   // the brush is evaluated in a task while this thread evaluates the main object
+   std::shared_ptr<xshape2d>        brush = m_incl[1];
+   std::shared_ptr<clipper_profile> b_brush;
+   task_group tasks;
+   tasks.run([brush,tt,&b_brush]() { b_brush = brush->create_clipper_profile(tt); });
+   std::shared_ptr<clipper_profile> a = m_incl[0]->create_clipper_profile(tt);
+   tasks.wait();
 
    clipper_boolean csg;
    csg.minkowski_sum(a,b_brush);
@@ -44,7 +105,5 @@ std::shared_ptr<clipper_profile> xminkowski2d::create_clipper_profile(const carv
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xminkowski2d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   std::shared_ptr<carve::mesh::MeshSet<3>> mesh;
-
-   return mesh;
+   return create_profile_mesh(t);
 }
@@ -6,7 +6,6 @@
 #include "carve_boolean_thread.h"
 #include "carve_minkowski_thread.h"
 
-#include "boolean_timer.h"
 
 xminkowski3d::xminkowski3d()
 {
@@ -36,31 +35,54 @@ size_t xminkowski3d::nbool()
    return nbool-1;
 }
 
+size_t xminkowski3d::simplify()
+{
+   return xsolid_collector::simplify_children(m_incl);
+}
+
+xsolid::mesh_estimate xminkowski3d::estimate() const
+{
+   return xsolid_collector::estimate(m_incl);
+}
+
+double xminkowski3d::mesh_cost() const
+{
+   // the hull of every pair of convex parts
+   double cost = 1.0;
+   for(auto& solid : m_incl) cost *= solid->mesh_cost();
+   return cost;
+}
+
+bool xminkowski3d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   if(m_incl.size() != 2) return false;
+
+   xbounds boxA,boxB;
+   carve::math::Matrix tt = t*get_transform();
+   if(!m_incl.front()->bounding_box(boxA,tt) || boxA.empty()) return false;
+   if(!m_incl.back()->bounding_box(boxB,tt)  || boxB.empty()) return false;
+
+   box.add(boxA.min()+boxB.min());
+   box.add(boxA.max()+boxB.max());
+   return true;
+}
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xminkowski3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // first fill the mesh queue with objects to union
-   safe_queue<std::string> exception_queue;
+   // compute the hull meshes and union them in one pipeline
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
    carve_minkowski_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
 
-   // improve the timer estimate now that the number of booleans is known for this operation
-   boolean_timer::singleton().add_nbool(mesh_queue.size());
-
-   // union the resulting meshes
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
+   return mesh_queue.dequeue();
+}
 
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+void xminkowski3d::set_releasable()
+{
+   xsolid::set_releasable();
+   xsolid_collector::set_releasable(m_incl);
+}
 
-   return mesh_queue.dequeue();
+void xminkowski3d::release_mesh_data()
+{
+   m_incl.clear();
 }
@@ -12,6 +12,17 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual size_t simplify();
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+   // the sum of the boxes of the two parameters
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the children are marked and released with this solid
+   void set_releasable();
+   void release_mesh_data();
 protected:
 
 private:
@@ -0,0 +1,110 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xml_hash.h"
+#include "csg_parser/cf_xmlNode.h"
+#include "xdefinitions.h"
+#include "bulk_reader.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+uint64_t xml_hash::hash(const std::string& s, uint64_t h)
+{
+   const uint64_t prime = 1099511628211ULL;
+   for(size_t i=0; i<s.length(); i++) {
+      h ^= static_cast<unsigned char>(s[i]);
+      h *= prime;
+   }
+   // terminate so that "ab"+"c" differs from "a"+"bc"
+   h ^= 0xff;
+   h *= prime;
+   return h;
+}
+
+uint64_t xml_hash::combine(uint64_t h1, uint64_t h2)
+{
+   return h1 ^ (h2 + 0x9e3779b97f4a7c15ULL + (h1 << 6) + (h1 >> 2));
+}
+
+std::string xml_hash::to_string(uint64_t h)
+{
+   char buf[32];
+   std::snprintf(buf,sizeof(buf),"%016llx",static_cast<unsigned long long>(h));
+   return buf;
+}
+
+uint64_t xml_hash::children_hash(uint64_t h, ptree::const_iterator begin, ptree::const_iterator end, bool skip_tmatrix)
+{
+   for(auto i=begin; i!=end; i++) {
+      const std::string& key = i->first;
+      if(key == "<xmlattr>") {
+         // attributes in canonical (sorted) order
+         std::vector<std::pair<std::string,std::string>> attributes;
+         for(auto ia=i->second.begin(); ia!=i->second.end(); ia++) {
+            attributes.push_back(std::make_pair(ia->first,ia->second.data()));
+         }
+         std::sort(attributes.begin(),attributes.end());
+         uint64_t ha = hash(key);
+         for(auto& a : attributes) {
+            ha = hash(a.second,hash(a.first,ha));
+         }
+         h = combine(h,ha);
+      }
+      else if(skip_tmatrix && key == "tmatrix") {
+         continue;
+      }
+      else {
+         h = combine(h,hash(key,i->second));
+      }
+   }
+   return h;
+}
+
+uint64_t xml_hash::instance_hash(const std::string& tag, const std::string& ref, uint64_t h)
+{
+   // an instance has the geometry of its definition, so the definition must be part of the hash
+   if(tag == "instance") h = combine(h,xdefinitions::singleton().hash(ref));
+   return h;
+}
+
+uint64_t xml_hash::file_hash(const std::string& tag, const std::string& file, uint64_t h)
+{
+   // the xml only names the file, so a changed file must change the hash
+   if(file.length() > 0 && (tag == "polyhedron" || tag == "tin_model")) h = combine(h,hash(bulk_reader::file_signature(file)));
+   return h;
+}
+
+uint64_t xml_hash::hash(const std::string& tag, const ptree& pt)
+{
+   uint64_t h = combine(hash(tag),children_hash(hash(pt.data()),pt.begin(),pt.end(),false));
+   h = file_hash(tag,pt.get<std::string>("<xmlattr>.file",""),h);
+   return instance_hash(tag,pt.get<std::string>("<xmlattr>.ref",""),h);
+}
+
+uint64_t xml_hash::local_hash(const std::string& tag, const ptree& pt)
+{
+   uint64_t h = combine(hash(tag),children_hash(hash(pt.data()),pt.begin(),pt.end(),true));
+   h = file_hash(tag,pt.get<std::string>("<xmlattr>.file",""),h);
+   return instance_hash(tag,pt.get<std::string>("<xmlattr>.ref",""),h);
+}
+
+uint64_t xml_hash::local_hash(const cf_xmlNode& node)
+{
+   std::string value = node.get_value(std::string(""));
+   uint64_t h = combine(hash(node.tag()),children_hash(hash(value),node.begin(),node.end(),true));
+   h = file_hash(node.tag(),node.get_property("file",std::string("")),h);
+   return instance_hash(node.tag(),node.get_property("ref",std::string("")),h);
+}
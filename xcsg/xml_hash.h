@@ -0,0 +1,62 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XML_HASH_H
+#define XML_HASH_H
+
+#include <cstdint>
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+class cf_xmlNode;
+
+// xml_hash computes canonical 64 bit hashes of xcsg XML subtrees.
+// Attributes are hashed in sorted order, so attribute ordering does not matter.
+// The hash is FNV-1a based and therefore stable across runs and platforms.
+
+class xml_hash {
+public:
+   typedef boost::property_tree::ptree ptree;
+
+   // hash of the subtree under node, excluding the node's own tmatrix,
+   // i.e. it identifies the geometry of the node in its local coordinates
+   static uint64_t local_hash(const cf_xmlNode& node);
+   static uint64_t local_hash(const std::string& tag, const ptree& pt);
+
+   // hash of tag and content, including any tmatrix
+   static uint64_t hash(const std::string& tag, const ptree& pt);
+
+   // hash a string, optionally continuing from a previous hash value
+   static uint64_t hash(const std::string& s, uint64_t h = offset_basis());
+
+   // combine two hash values
+   static uint64_t combine(uint64_t h1, uint64_t h2);
+
+   // hex formatted hash value
+   static std::string to_string(uint64_t h);
+
+   static uint64_t offset_basis() { return 14695981039346656037ULL; }
+
+private:
+   // for <instance> elements, combine h with the hash of the referenced definition
+   static uint64_t instance_hash(const std::string& tag, const std::string& ref, uint64_t h);
+
+   // for polyhedron and tin_model elements with bulk data in an external file, combine h with the file signature
+   static uint64_t file_hash(const std::string& tag, const std::string& file, uint64_t h);
+
+   // hash of a range of child nodes, optionally skipping the tmatrix child
+   static uint64_t children_hash(uint64_t h, ptree::const_iterator begin, ptree::const_iterator end, bool skip_tmatrix);
+};
+
+#endif // XML_HASH_H
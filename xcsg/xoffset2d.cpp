@@ -58,19 +58,28 @@ size_t xoffset2d::nbool()
 std::shared_ptr<clipper_profile> xoffset2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
    // first union together the components (usually only one)
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
+   std::shared_ptr<clipper_profile> profile = xshape2d_collector::union_profile(m_incl,t*get_transform());
 
    // then compute offset profile and return it
 
    clipper_offset offset;
-   offset.compute(csg.profile(),m_delta,m_round,m_chamfer);
+   offset.compute(profile,m_delta,m_round,m_chamfer);
    return offset.profile();
 }
 
+bool xoffset2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   xbounds children;
+   if(!xshape2d_collector::bounding_box(m_incl,children,t*get_transform())) return false;
+   if(children.empty()) return true;
+
+   double d = std::max(m_delta,0.0);
+   box.add(children.min() - carve::geom::VECTOR(d,d,0.0));
+   box.add(children.max() + carve::geom::VECTOR(d,d,0.0));
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xoffset2d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   return 0;
+   return create_profile_mesh(t);
 }
@@ -85,6 +85,13 @@ std::shared_ptr<clipper_profile> xpolygon::create_clipper_profile(const carve::m
 }
 
 
+bool xpolygon::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   for(size_t i=0; i<m_vert.size(); i++) box.add(tt*m_vert[i]);
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xpolygon::create_carve_mesh(const carve::math::Matrix& t) const
 {
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_polygon(m_vert, mesh_utils::thickness(),t*get_transform());
@@ -34,6 +34,9 @@ public:
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   // the box of the transformed vertices
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
 private:
    std::vector<xvertex> m_vert;
 };
@@ -20,7 +20,8 @@
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "mesh_utils.h"
-#include <map>
+#include "bulk_reader.h"
+#include "mesh_validation.h"
 
 /*
 static double face_area(const std::vector<xvertex>& p)
@@ -72,6 +73,7 @@ static double face_area(const std::vector<xvertex>& p)
 }
 
 xpolyhedron::xpolyhedron()
+: m_face_offsets(1,0)
 {}
 
 xpolyhedron::~xpolyhedron()
@@ -79,67 +81,45 @@ xpolyhedron::~xpolyhedron()
 
 xpolyhedron::xpolyhedron(const xpolyhedron& other)
 : m_vertices(other.m_vertices)
-, m_faces(other.m_faces)
+, m_face_offsets(other.m_face_offsets)
+, m_face_indices(other.m_face_indices)
 {}
 
+xpolyhedron::xpolyhedron(std::vector<xvertex>&& vertices, std::vector<size_t>&& face_offsets, std::vector<size_t>&& face_indices)
+: m_vertices(std::move(vertices))
+, m_face_offsets(std::move(face_offsets))
+, m_face_indices(std::move(face_indices))
+{
+   if(m_face_offsets.size()==0 || m_face_offsets.front()!=0 || m_face_offsets.back()!=m_face_indices.size()) {
+      throw logic_error("xpolyhedron: face offsets do not match the face indices");
+   }
+}
+
 xpolyhedron::xpolyhedron(const cf_xmlNode& const_node)
+: m_face_offsets(1,0)
 {
     if(const_node.tag() != "polyhedron")throw logic_error("Expected xml tag polyhedron, but found " + const_node.tag());
 
     set_transform(const_node);
 
+    // vertices and faces may be given in an external file instead of the xml
+    std::string file = const_node.get_property("file",std::string(""));
+    std::vector<xface> faces;
+    if(file.length() > 0) bulk_reader::read_file(file,"polyhedron",m_vertices,&faces);
+
     cf_xmlNode node = const_node;
     for(auto i=node.begin(); i!=node.end(); i++) {
 
        cf_xmlNode sub(i);
        if(!sub.is_attribute_node()) {
-          if("vertices" == sub.tag()) {
-
-             // be sure to sort the vertices
-             map<size_t,xvertex> v;
-             for(auto iv=sub.begin(); iv!=sub.end(); iv++) {
-
-                // get next vertex
-                cf_xmlNode vertex(iv);
-                if("vertex" == vertex.tag()) {
-                   size_t id = v.size();
-                   v[id]= carve::geom::VECTOR( vertex.get_property("x",0.0),
-                                               vertex.get_property("y",0.0),
-                                               vertex.get_property("z",0.0));
-                }
-                else {
-                   throw logic_error("polyhedron: expected tag 'vertex' but found " + vertex.tag());
-                }
-             }
-
-             // copy to member variable
-             m_vertices.resize(v.size());
-             for(auto i=v.begin(); i!=v.end(); i++) {
-                m_vertices[i->first] = i->second;
-             }
+          if(file.length() > 0 && ("vertices" == sub.tag() || "faces" == sub.tag())) {
+             throw logic_error("polyhedron: 'file' attribute cannot be combined with " + sub.tag());
+          }
+          else if("vertices" == sub.tag()) {
+             bulk_reader::read_vertices(sub,"polyhedron",m_vertices);
           }
           else if("faces" == sub.tag()) {
-
-             map<int,xface> f;
-             int id = -1;
-             for(auto iv=sub.begin(); iv!=sub.end(); iv++) {
-                // get next face
-                cf_xmlNode face(iv);
-                if(!face.is_attribute_node()) {
-                   if("face" == face.tag()) {
-                      f[++id] = xface(face);
-                   }
-                   else {
-                      throw logic_error("polyhedron: expected tag 'face' but found " + face.tag());
-                   }
-                }
-             }
-
-             // copy to member variable
-             m_faces.resize(f.size());
-             for(auto i=f.begin(); i!=f.end(); i++) {
-                m_faces[i->first] = i->second;
-             }
+             bulk_reader::read_faces(sub,"polyhedron",faces);
           }
           else if("tmatrix" == sub.tag()) {
              // skip this, already handled via set_transform(...)
@@ -149,37 +129,72 @@ xpolyhedron::xpolyhedron(const cf_xmlNode& const_node)
           }
        }
     }
+    set_faces(faces);
+}
+
+void xpolyhedron::set_faces(const std::vector<xface>& faces)
+{
+   size_t nind = 0;
+   for(const xface& face : faces) nind += face.size();
+
+   m_face_offsets.assign(1,0);
+   m_face_offsets.reserve(faces.size()+1);
+   m_face_indices.clear();
+   m_face_indices.reserve(nind);
+   for(const xface& face : faces) {
+      m_face_indices.insert(m_face_indices.end(),face.begin(),face.end());
+      m_face_offsets.push_back(m_face_indices.size());
+   }
+}
+
+void xpolyhedron::add_faces(carve::input::PolyhedronData& data, bool reverse_face) const
+{
+   // the face index table holds the vertex count of each face followed by its vertex indices
+   const size_t nface = f_size();
+   data.faceIndices.resize(nface + m_face_indices.size());
+   data.faceCount = static_cast<int>(nface);
+
+   size_t k = 0;
+   for(size_t i=0; i<nface; i++) {
+      size_t ibeg = m_face_offsets[i];
+      size_t iend = m_face_offsets[i+1];
+      data.faceIndices[k++] = static_cast<int>(iend-ibeg);
+      if(reverse_face) for(size_t j=iend; j>ibeg; j--)  data.faceIndices[k++] = static_cast<int>(m_face_indices[j-1]);
+      else             for(size_t j=ibeg; j<iend; j++)  data.faceIndices[k++] = static_cast<int>(m_face_indices[j]);
+   }
+}
+
+bool xpolyhedron::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   for(size_t i=0; i<m_vertices.size(); i++) box.add(tt*m_vertices[i]);
+   return true;
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xpolyhedron::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   bool reverse_face = mesh_utils::is_left_hand(t);
+   // the transforms are composed once, then applied to all vertices in one pass
+   carve::math::Matrix tt = t*get_transform();
+   bool reverse_face = mesh_utils::is_left_hand(tt);
 
    carve::input::PolyhedronData data;
    carve::input::Options options;
 
-   if(m_faces.size() > 0) {
+   if(f_size() > 0) {
 
       // conventional polyhedron
-      data.reserveVertices(static_cast<int>(m_vertices.size()));
-      for(size_t i=0; i<m_vertices.size(); i++) {
-         data.addVertex(t*get_transform()*m_vertices[i]);
-      }
-
-      data.reserveFaces(static_cast<int>(m_faces.size()),4);
-      for(size_t i=0; i<m_faces.size(); i++) {
-         const xface& face = m_faces[i];
-         if(reverse_face) data.addFace(face.rbegin(),face.rend());
-         else             data.addFace(face.begin(),face.end());
-      }
+      data.points.resize(m_vertices.size());
+      if(m_vertices.size() > 0) mesh_utils::transform(tt,&m_vertices[0],m_vertices.size(),&data.points[0]);
+      add_faces(data,reverse_face);
    }
    else if(m_vertices.size() > 2) {
 
       // No faces specified, but several vertices
       // Create instead a convex hull polyhedron, using only the vertices
+      std::vector<xvertex> vertices(m_vertices.size());
+      mesh_utils::transform(tt,&m_vertices[0],m_vertices.size(),&vertices[0]);
       qhull3d qhull;
-      for(size_t i=0; i<m_vertices.size(); i++) {
-         xvertex vertex = t*get_transform()*m_vertices[i];
+      for(const xvertex& vertex : vertices) {
          qhull.push_back(vertex.v[0],vertex.v[1],vertex.v[2]);
       }
 
@@ -213,74 +228,60 @@ const xvertex& xpolyhedron::v_get(size_t v_ind) const
    return m_vertices.at(v_ind);
 }
 
+void xpolyhedron::v_transform(const carve::math::Matrix& t, size_t first)
+{
+   if(first >= m_vertices.size()) return;
+   mesh_utils::transform(t,&m_vertices[first],m_vertices.size()-first,&m_vertices[first]);
+}
+
 void xpolyhedron::f_reserve(size_t nfaces)
 {
-   m_faces.reserve(nfaces);
+   // assume mostly triangles
+   m_face_offsets.reserve(nfaces+1);
+   m_face_indices.reserve(3*nfaces);
 }
 
 size_t xpolyhedron::f_add(const xface& face, bool reverse_face)
 {
-   size_t index = m_faces.size();
-   if(reverse_face) m_faces.push_back(face.reverse_copy());
-   else             m_faces.push_back(face);
+   size_t index = f_size();
+   if(reverse_face) m_face_indices.insert(m_face_indices.end(),face.rbegin(),face.rend());
+   else             m_face_indices.insert(m_face_indices.end(),face.begin(),face.end());
+   m_face_offsets.push_back(m_face_indices.size());
    return index;
 }
 
 size_t xpolyhedron::f_size() const
 {
-   return m_faces.size();
+   return m_face_offsets.size()-1;
 }
 
-const xface& xpolyhedron::f_get(size_t f_ind) const
+xface xpolyhedron::f_get(size_t f_ind) const
 {
-   return m_faces.at(f_ind);
+   auto ibeg = m_face_indices.begin() + m_face_offsets.at(f_ind);
+   auto iend = m_face_indices.begin() + m_face_offsets.at(f_ind+1);
+   return xface(std::vector<size_t>(ibeg,iend));
 }
 
 bool  xpolyhedron::check_polyhedron(ostream& out, size_t& num_non_tri)
 {
-   map<size_t,size_t> edge_count;
-   size_t face_error=0;
-
-   num_non_tri = 0;
+   const size_t nfaces = f_size();
+   mesh_validation validation((nfaces>0)? &m_face_indices[0] : nullptr,&m_face_offsets[0],nfaces);
+   num_non_tri = validation.num_non_tri();
 
-   for(auto i=m_faces.begin(); i!=m_faces.end(); i++) {
-      const xface& face = *i;
+   size_t face_error=0;
+   std::vector<xvertex> p;
+   for(size_t iface=0; iface<nfaces; iface++) {
+      const size_t* face = &m_face_indices[0] + m_face_offsets[iface];
+      const size_t  nv   = m_face_offsets[iface+1] - m_face_offsets[iface];
 
-      std::vector<xvertex> p;
-      p.reserve(face.size());
-      for(size_t i=0; i<face.size(); i++) {
+      p.clear();
+      for(size_t i=0; i<nv; i++) {
          p.push_back(m_vertices[face[i]]);
       }
       if(!(face_area(p)>0.0))face_error++;
-
-      num_non_tri += (face.size()!=3)? 1 : 0;
-
-      // number of edges == number of vertices
-      size_t nedge = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         size_t iv0 = face[iedge];
-         size_t iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         size_t edge_id = std::min(iv0,iv1)*1000000 + std::max(iv0,iv1);
-         edge_count[edge_id]++;
-      }
-   }
-
-   size_t nerr = 0;
-   size_t nc1  = 0;
-   for(auto i=edge_count.begin(); i!=edge_count.end(); i++) {
-      if(i->second != 2) {
-         nerr++;
-         if(i->second == 1)nc1++;
-      }
    }
 
-   if(nerr == 0) {
-      out << "...Polyhedron is water-tight (edge use-count check OK)" << endl;
-   }
-   else {
-      out << ">>> Warning: Polyhedron is not water-tight, it has " << edge_count.size() << " edges, " << nerr << " with wrong use count, " << nc1 << " with use-count==1" << endl;
-   }
+   validation.write_report(out);
    if(face_error == 0) {
       out << "...Polyhedron has no degenerated faces (face area check OK)" << endl;
    }
@@ -289,7 +290,12 @@ bool  xpolyhedron::check_polyhedron(ostream& out, size_t& num_non_tri)
    }
 
    out << "...Polyhedron has "<< num_non_tri << " non-triangular faces" << endl;
-   return ((face_error+nerr)==0);
+   return ((face_error+validation.nwrong())==0);
+}
+
+size_t xpolyhedron::num_non_tri() const
+{
+   return mesh_validation::non_triangles(&m_face_offsets[0],f_size());
 }
 
 
@@ -297,11 +303,20 @@ std::shared_ptr<carve::poly::Polyhedron> xpolyhedron::create_carve_polyhedron()
 {
    carve::input::PolyhedronData data;
    data.points = m_vertices;
-   data.reserveFaces(static_cast<int>(m_faces.size()),4);
-   for(auto i=m_faces.begin(); i!=m_faces.end(); i++) {
-      const xface& face = *i;
-      data.addFace(face.begin(),face.end());
-   }
+   add_faces(data,false);
    carve::input::Options options;
    return std::shared_ptr<carve::poly::Polyhedron>(data.create(options));
 }
+
+xsolid::mesh_estimate xpolyhedron::estimate() const
+{
+   if(f_size() > 0) return mesh_estimate(f_size());
+   return mesh_estimate((m_vertices.size() > 2)? 2*m_vertices.size()-4 : 0);
+}
+
+void xpolyhedron::release_mesh_data()
+{
+   std::vector<xvertex>().swap(m_vertices);
+   std::vector<size_t>(1,0).swap(m_face_offsets);
+   std::vector<size_t>().swap(m_face_indices);
+}
@@ -19,12 +19,18 @@
 #include <vector>
 #include "xface.h"
 #include "xsolid.h"
+#include <carve/input.hpp>
 
 class xpolyhedron : public xsolid {
 public:
    xpolyhedron();
    xpolyhedron(const cf_xmlNode& node);
    xpolyhedron(const xpolyhedron& other);
+
+   // bulk construction, taking ownership of flat vertex and face arrays.
+   // Face i has the vertex indices face_indices[face_offsets[i]] ... face_indices[face_offsets[i+1]-1],
+   // so face_offsets has one entry more than there are faces, starting with 0
+   xpolyhedron(std::vector<xvertex>&& vertices, std::vector<size_t>&& face_offsets, std::vector<size_t>&& face_indices);
    virtual ~xpolyhedron();
 
    // vertices
@@ -33,22 +39,48 @@ public:
    size_t         v_size() const;
    const xvertex& v_get(size_t v_ind) const;
 
+   // apply t to the vertices from index first in one pass, see mesh_utils::transform
+   void           v_transform(const carve::math::Matrix& t, size_t first = 0);
+
+
    // faces
    void           f_reserve(size_t nfaces);
    size_t         f_add(const xface& face, bool reverse_face);
    size_t         f_size() const;
-   const xface&   f_get(size_t f_ind) const;
+   xface          f_get(size_t f_ind) const;
 
+   // report edge use, orientation and face area checks, see mesh_validation
    bool check_polyhedron(ostream& out, size_t& num_non_tri);
 
+   // number of faces with other than 3 vertices
+   size_t num_non_tri() const;
+
    // create meshset from this polyhedron
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
    std::shared_ptr<carve::poly::Polyhedron> create_carve_polyhedron();
 
+   // the faces as given, or at most 2V-4 triangles for the hull of V vertices
+   mesh_estimate estimate() const;
+   double mesh_cost() const { return static_cast<double>(estimate().faces); }
+
+   // the box of the transformed vertices
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the vertices and faces are freed once meshed
+   void release_mesh_data();
+
+private:
+   // replace the faces by the given ones
+   void set_faces(const std::vector<xface>& faces);
+
+   // add the faces to the carve input data, the vertices are added by the caller
+   void add_faces(carve::input::PolyhedronData& data, bool reverse_face) const;
+
 private:
-   std::vector<xvertex> m_vertices;  // vertex coordinates
-   std::vector<xface>   m_faces;     // vertex indices for faces
+   std::vector<xvertex> m_vertices;      // vertex coordinates
+   std::vector<size_t>  m_face_offsets;  // offset to the first vertex index of each face in m_face_indices, plus the end
+   std::vector<size_t>  m_face_indices;  // vertex indices for all faces
 };
 
 #endif // XPOLYHEDRON_H
@@ -0,0 +1,120 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xprofiled_solid.h"
+#include "node_profiler.h"
+#include <boost/date_time.hpp>
+
+xprofiled_solid::xprofiled_solid(std::shared_ptr<xsolid> solid, size_t inode)
+: m_solid(solid)
+, m_inode(inode)
+{}
+
+xprofiled_solid::~xprofiled_solid()
+{}
+
+std::shared_ptr<xsolid> xprofiled_solid::unwrap(const std::shared_ptr<xsolid>& s)
+{
+   std::shared_ptr<xprofiled_solid> wrapper = std::dynamic_pointer_cast<xprofiled_solid>(s);
+   if(!wrapper.get()) return s;
+
+   // the wrapper keeps working with the identity transform
+   std::shared_ptr<xsolid> solid = unwrap(wrapper->m_solid);
+   solid->set_transform(wrapper->get_transform()*solid->get_transform());
+   wrapper->set_transform(carve::math::Matrix());
+   return solid;
+}
+
+size_t xprofiled_solid::nbool()
+{
+   return m_solid->nbool();
+}
+
+size_t xprofiled_solid::simplify()
+{
+   return m_solid->simplify();
+}
+
+std::shared_ptr<xsolid> xprofiled_solid::reduced()
+{
+   std::shared_ptr<xsolid> child = m_solid->reduced();
+   if(child.get()) child->set_transform(get_transform()*child->get_transform());
+   return child;
+}
+
+void xprofiled_solid::set_releasable()
+{
+   xsolid::set_releasable();
+   m_solid->set_releasable();
+}
+
+void xprofiled_solid::release_mesh_data()
+{
+   m_solid->release_mesh_data();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xprofiled_solid::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   node_profiler::scope scope(static_cast<int>(m_inode));
+
+   boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = m_solid->create_carve_mesh(t*get_transform());
+   double elapsed_ms = 0.001*(boost::posix_time::microsec_clock::universal_time() - p1).total_microseconds();
+
+   node_profiler::singleton().add_mesh(m_inode,elapsed_ms,mesh.get());
+   return mesh;
+}
+
+bool xprofiled_solid::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return m_solid->bounding_box(box,t*get_transform());
+}
+
+bool xprofiled_solid::is_convex() const
+{
+   return m_solid->is_convex();
+}
+
+void xprofiled_solid::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   m_solid->append_hull_vertices(vertices,t*get_transform());
+}
+
+bool xprofiled_solid::append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t) const
+{
+   return m_solid->append_convex_parts(parts,t*get_transform());
+}
+
+std::shared_ptr<box_node> xprofiled_solid::box_expression(const carve::math::Matrix& t) const
+{
+   return m_solid->box_expression(t*get_transform());
+}
+
+std::shared_ptr<sdf_field> xprofiled_solid::create_sdf(double voxel, const carve::math::Matrix& t) const
+{
+   return m_solid->create_sdf(voxel,t*get_transform());
+}
+
+xsolid::mesh_estimate xprofiled_solid::estimate() const
+{
+   mesh_estimate e = m_solid->estimate();
+   node_profiler::singleton().add_estimate(m_inode,m_solid->nbool(),e.faces,e.bool_faces,e.peak_faces);
+   return e;
+}
+
+double xprofiled_solid::mesh_cost() const
+{
+   return m_solid->mesh_cost();
+}
@@ -0,0 +1,63 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XPROFILED_SOLID_H
+#define XPROFILED_SOLID_H
+
+#include "xsolid.h"
+
+// xprofiled_solid wraps a solid when --profile is given, and records
+// the time and size of its mesh in the node_profiler. Booleans performed
+// while the wrapped solid creates its mesh are charged to the same node.
+// The wrapper is transparent to simplification, so a profiled run evaluates
+// the same tree as an unprofiled one. Nodes eliminated by it report no mesh.
+
+class xprofiled_solid : public xsolid {
+public:
+   xprofiled_solid(std::shared_ptr<xsolid> solid, size_t inode);
+   virtual ~xprofiled_solid();
+
+   // the solid wrapped by s, with the transform of the wrapper moved to it, or s itself.
+   // Simplification looks at the wrapped solids through this
+   static std::shared_ptr<xsolid> unwrap(const std::shared_ptr<xsolid>& s);
+
+   virtual size_t nbool();
+
+   size_t simplify();
+   std::shared_ptr<xsolid> reduced();
+   void set_releasable();
+   void release_mesh_data();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // records the estimate of the wrapped solid in the node_profiler
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+   // the box of the wrapped solid
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool is_convex() const;
+   void append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   bool append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<sdf_field> create_sdf(double voxel, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+private:
+   std::shared_ptr<xsolid> m_solid;
+   size_t                  m_inode;   // node_profiler node
+};
+
+#endif // XPROFILED_SOLID_H
@@ -51,24 +51,10 @@ std::shared_ptr<clipper_profile> xprojection2d ::create_clipper_profile(const ca
 {
    // run 3d booleans in threads
 
-   safe_queue<std::string> exception_queue;
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
    carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
-
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+   carve_boolean_thread::compute(mesh_queue,carve::csg::CSG::UNION);
 
    // retrieve the computed 3d mesh
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh = mesh_queue.dequeue();
@@ -79,6 +65,6 @@ std::shared_ptr<clipper_profile> xprojection2d ::create_clipper_profile(const ca
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xprojection2d ::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   return 0;
+   return create_profile_mesh(t);
 }
 
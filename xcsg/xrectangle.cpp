@@ -49,6 +49,14 @@ std::shared_ptr<clipper_profile> xrectangle::create_clipper_profile(const carve:
    return mesh;
 }
 
+bool xrectangle::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   double x1 = (m_center)? -0.5*m_dx : 0.0;
+   double y1 = (m_center)? -0.5*m_dy : 0.0;
+   box.add(carve::geom::VECTOR(x1,y1,0.0),carve::geom::VECTOR(x1+m_dx,y1+m_dy,0.0),t*get_transform());
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xrectangle::create_carve_mesh(const carve::math::Matrix& t) const
 {
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_dx,m_dy, mesh_utils::thickness(),m_center,false,t*get_transform());
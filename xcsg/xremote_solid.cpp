@@ -0,0 +1,56 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "xremote_solid.h"
+#include "remote_farm.h"
+
+xremote_solid::xremote_solid(std::shared_ptr<xsolid> solid, const std::string& fragment)
+: m_solid(solid)
+, m_fragment(fragment)
+{
+   // take over the transform, it is sent with the job
+   set_transform(m_solid->get_transform());
+   m_solid->set_transform(carve::math::Matrix());
+}
+
+xremote_solid::~xremote_solid()
+{}
+
+size_t xremote_solid::nbool()
+{
+   return m_solid->nbool();
+}
+
+bool xremote_solid::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return m_solid->bounding_box(box,t*get_transform());
+}
+
+xsolid::mesh_estimate xremote_solid::estimate() const
+{
+   return m_solid->estimate();
+}
+
+double xremote_solid::mesh_cost() const
+{
+   return m_solid->mesh_cost();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xremote_solid::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = remote_farm::singleton().compute(m_fragment,m_solid->secant_tolerance(),tt);
+   if(!mesh.get()) mesh = m_solid->create_carve_mesh(tt);
+   return mesh;
+}
@@ -0,0 +1,44 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef XREMOTE_SOLID_H
+#define XREMOTE_SOLID_H
+
+#include "xsolid.h"
+#include <string>
+
+// xremote_solid wraps a child of a top level boolean selected by the remote_farm.
+// Its mesh is computed by a worker process from the XML fragment of the subtree,
+// the wrapped solid is meshed locally when no worker is available.
+
+class xremote_solid : public xsolid {
+public:
+   xremote_solid(std::shared_ptr<xsolid> solid, const std::string& fragment);
+   virtual ~xremote_solid();
+
+   // the booleans are still counted, they are just performed elsewhere
+   virtual size_t nbool();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+
+private:
+   std::shared_ptr<xsolid> m_solid;     // the wrapped solid, with identity transform
+   std::string             m_fragment;  // XML of the subtree without its tmatrix
+};
+
+#endif // XREMOTE_SOLID_H
@@ -57,14 +57,35 @@ size_t xrotate_extrude::nbool()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xrotate_extrude::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
-   }
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   // create profile in native 2d system
+   std::shared_ptr<clipper_profile> profile = xshape2d_collector::union_profile(m_incl,carve::math::Matrix());
 
    // apply 3d transformation when creating 3d mesh
-   return extrude_mesh::rotate_extrude(csg.profile(),m_angle,m_pitch,t*get_transform());
+   return extrude_mesh::rotate_extrude(profile,m_angle,m_pitch,t*get_transform());
+}
+
+
+bool xrotate_extrude::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   xbounds profile;
+   if(!xshape2d_collector::bounding_box(m_incl,profile,carve::math::Matrix()) || profile.empty()) return false;
+
+   const xvertex& pmin = profile.min();
+   const xvertex& pmax = profile.max();
+   double r  = std::max(fabs(pmin[0]),fabs(pmax[0]));
+   double y1 = pmin[1];
+   double y2 = pmax[1];
+   if(fabs(m_pitch) > 0.0) {
+      // the profile is tilted around x before it is swept and raised by the pitch
+      double ry = std::max(fabs(y1),fabs(y2));
+      double dy = m_pitch*fabs(m_angle)/(2*pi);
+      r  = sqrt(r*r + ry*ry);
+      y1 = std::min(0.0,dy) - ry;
+      y2 = std::max(0.0,dy) + ry;
+   }
+   box.add(carve::geom::VECTOR(-r,y1,-r),carve::geom::VECTOR(r,y2,r),t*get_transform());
+   return true;
 }
 
 
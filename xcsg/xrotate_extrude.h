@@ -28,6 +28,9 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the box of the profile swept around y, the profile is not computed
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
 private:
    double  m_angle; // ccw angle around y
    double  m_pitch;
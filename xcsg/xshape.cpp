@@ -14,8 +14,10 @@
 // EndLicense:
 
 #include "xshape.h"
+#include "mesh_utils.h"
 
 xshape::xshape()
+: m_secant_tolerance(mesh_utils::secant_tolerance())
 {}
 
 xshape::~xshape()
@@ -29,6 +29,13 @@ public:
    virtual ~xshape();
 
    virtual size_t nbool();
+
+   // secant tolerance for meshing this shape, inherited from the nearest
+   // ancestor with a secant_tolerance attribute when the shape was constructed
+   double secant_tolerance() const { return m_secant_tolerance; }
+
+private:
+   double m_secant_tolerance;
 };
 
 #endif // XSHAPE_H
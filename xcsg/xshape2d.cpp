@@ -16,6 +16,8 @@
 #include "xshape2d.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xtmatrix.h"
+#include "extrude_mesh.h"
+#include "mesh_utils.h"
 
 xshape2d::xshape2d()
 {}
@@ -38,3 +40,18 @@ const carve::math::Matrix& xshape2d::get_transform() const
    return m_t;
 }
 
+bool xshape2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return false;
+}
+
+bool xshape2d::create_clipper_layers(profile_layers& layers, const carve::math::Matrix& t) const
+{
+   return false;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xshape2d::create_profile_mesh(const carve::math::Matrix& t) const
+{
+   // the profile includes the transform of this shape
+   return extrude_mesh::linear_extrude(create_clipper_profile(),mesh_utils::thickness(),t);
+}
@@ -18,8 +18,11 @@
 
 
 #include "xshape.h"
+#include "xbounds.h"
 #include <carve/matrix.hpp>
 #include "clipper_csg/clipper_profile.h"
+#include <string>
+#include <vector>
 
 // abstract base class for 2d objects
 
@@ -33,6 +36,21 @@ public:
 
    virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
    virtual std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
+
+   // add a box enclosing the shape to box, without computing clipper profiles.
+   // returns false, adding nothing, when no such box is known
+   virtual bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // named profiles exported as separate DXF and SVG layers, e.g. the sections of slice2d.
+   // returns false, adding nothing, when the shape has a single layer
+   typedef std::vector<std::pair<std::string,std::shared_ptr<clipper_profile>>> profile_layers;
+   virtual bool create_clipper_layers(profile_layers& layers, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+protected:
+   // carve mesh of the clipper profile extruded once by mesh_utils::thickness(), so 2d booleans
+   // are computed by clipper instead of as carve booleans of thin slabs
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_profile_mesh(const carve::math::Matrix& t) const;
+
 private:
    carve::math::Matrix m_t;
 };
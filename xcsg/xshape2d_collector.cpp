@@ -15,6 +15,7 @@
 
 #include "xshape2d_collector.h"
 #include "xcsg_factory.h"
+#include "thread_pool.h"
 
 void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
 {
@@ -22,8 +23,9 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
    cf_xmlNode tmp(parent);
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_shape2d(sub)) {
-         A.insert(xcsg_factory::singleton().make_shape2d(sub));
+      const xcsg_factory::entry* e = xcsg_factory::singleton().find(sub);
+      if(e && e->type == xcsg_factory::SHAPE2D) {
+         A.insert(xcsg_factory::singleton().make_shape2d(*e,sub));
          icount++;
       }
    }
@@ -39,12 +41,13 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A,
    cf_xmlNode tmp(parent);
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_shape2d(sub)) {
+      const xcsg_factory::entry* e = xcsg_factory::singleton().find(sub);
+      if(e && e->type == xcsg_factory::SHAPE2D) {
          if(icount < nA) {
-            A.insert(xcsg_factory::singleton().make_shape2d(sub));
+            A.insert(xcsg_factory::singleton().make_shape2d(*e,sub));
          }
          else {
-            B.insert(xcsg_factory::singleton().make_shape2d(sub));
+            B.insert(xcsg_factory::singleton().make_shape2d(*e,sub));
          }
          icount++;
       }
@@ -61,8 +64,9 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeVector&
    cf_xmlNode tmp(parent);
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_shape2d(sub)) {
-         A.push_back(xcsg_factory::singleton().make_shape2d(sub));
+      const xcsg_factory::entry* e = xcsg_factory::singleton().find(sub);
+      if(e && e->type == xcsg_factory::SHAPE2D) {
+         A.push_back(xcsg_factory::singleton().make_shape2d(*e,sub));
           icount++;
       }
    }
@@ -70,3 +74,44 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeVector&
       throw logic_error("Expected 2d shape under " + parent.tag() + ", but found none.");
    }
 }
+
+void xshape2d_collector::create_profiles(const ShapeSet& A, const carve::math::Matrix& t, clipper_boolean::profile_vector& profiles)
+{
+   // the children are independent, so they are evaluated concurrently
+   size_t k = profiles.size();
+   profiles.resize(k+A.size());
+   if(A.size() > 1 && thread_pool::singleton().nthreads() > 1) {
+      task_group tasks;
+      for(auto i=A.begin(); i!=A.end(); i++) {
+         std::shared_ptr<xshape2d> shape = *i;
+         std::shared_ptr<clipper_profile>* slot = &profiles[k++];
+         tasks.run([shape,slot,t]() { *slot = shape->create_clipper_profile(t); });
+      }
+      tasks.wait();
+   }
+   else {
+      for(auto i=A.begin(); i!=A.end(); i++) {
+         profiles[k++] = (*i)->create_clipper_profile(t);
+      }
+   }
+}
+
+std::shared_ptr<clipper_profile> xshape2d_collector::union_profile(const ShapeSet& A, const carve::math::Matrix& t)
+{
+   clipper_boolean::profile_vector profiles;
+   create_profiles(A,t,profiles);
+
+   clipper_boolean csg;
+   csg.compute_union(profiles);
+   return csg.profile();
+}
+
+bool xshape2d_collector::bounding_box(const ShapeSet& A, xbounds& box, const carve::math::Matrix& t)
+{
+   xbounds shapes;
+   for(auto& shape : A) {
+      if(!shape->bounding_box(shapes,t)) return false;
+   }
+   box.add(shapes);
+   return true;
+}
@@ -20,6 +20,7 @@
 #include <vector>
 #include <memory>
 #include "xshape2d.h"
+#include "clipper_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 
 // xshape2d_collector is a helper class for collecting child shape2d nodes from XML
@@ -37,6 +38,16 @@ public:
 
    // collect all children into A
    static void collect_children(const cf_xmlNode& parent, ShapeVector& A);
+
+   // create clipper profiles of all shapes in A, using transformation t
+   static void create_profiles(const ShapeSet& A, const carve::math::Matrix& t, clipper_boolean::profile_vector& profiles);
+
+   // union of all shapes in A as a single clipper operation
+   static std::shared_ptr<clipper_profile> union_profile(const ShapeSet& A, const carve::math::Matrix& t);
+
+   // add the combined bounding box of the shapes in A to box,
+   // returns false when the box of any shape is unknown
+   static bool bounding_box(const ShapeSet& A, xbounds& box, const carve::math::Matrix& t);
 };
 
 #endif // XSHAPE2D_COLLECTOR_H
@@ -0,0 +1,98 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "csg_parser/cf_xmlNode.h"
+#include "xslice2d.h"
+#include "xsolid_collector.h"
+
+#include "carve_boolean_thread.h"
+#include "carve_mesh_thread.h"
+#include "clipper_boolean.h"
+#include "slice_mesh.h"
+
+xslice2d::xslice2d()
+{}
+
+xslice2d::xslice2d(const cf_xmlNode& node)
+{
+   if(node.tag() != "slice2d")throw std::logic_error("Expected xml tag slice2d, but found " + node.tag());
+   set_transform(node);
+   xsolid_collector::collect_children(node,m_incl);
+
+   if(m_incl.size() != 1) throw std::logic_error("Expected one child object for slice2d, but found " + std::to_string(m_incl.size()));
+
+   if(node.has_property("nslice")) {
+      double zmin = node.get_property("zmin",0.0);
+      double zmax = node.get_property("zmax",0.0);
+      int nslice  = node.get_property("nslice",1);
+      if(nslice < 1) throw std::logic_error("slice2d: nslice must be 1 or larger");
+      if(zmax < zmin) throw std::logic_error("slice2d: zmax must not be less than zmin");
+      for(int i=0; i<nslice; i++) {
+         m_z.push_back((nslice == 1)? zmin : zmin + i*(zmax-zmin)/(nslice-1));
+      }
+   }
+   else {
+      m_z.push_back(node.get_property("z",0.0));
+   }
+}
+
+xslice2d::~xslice2d()
+{}
+
+size_t xslice2d::nbool()
+{
+   size_t nbool = 0;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      std::shared_ptr<xsolid> obj = *i;
+      nbool += (obj->nbool()+1);
+   }
+   return nbool;
+}
+
+std::vector<std::shared_ptr<clipper_profile>> xslice2d::create_sections(const carve::math::Matrix& t) const
+{
+   // run 3d booleans in threads
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
+
+   carve_boolean_thread::compute(mesh_queue,carve::csg::CSG::UNION);
+
+   // retrieve the computed 3d mesh and cut it at all z values
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = mesh_queue.dequeue();
+   return slice_mesh::slice(mesh,m_z);
+}
+
+std::shared_ptr<clipper_profile> xslice2d::create_clipper_profile(const carve::math::Matrix& t) const
+{
+   std::vector<std::shared_ptr<clipper_profile>> sections = create_sections(t);
+   if(sections.size() == 1) return sections[0];
+
+   clipper_boolean csg;
+   csg.compute_union(sections);
+   return csg.profile();
+}
+
+bool xslice2d::create_clipper_layers(profile_layers& layers, const carve::math::Matrix& t) const
+{
+   std::vector<std::shared_ptr<clipper_profile>> sections = create_sections(t);
+   for(size_t i=0; i<sections.size(); i++) {
+      layers.push_back(std::make_pair("slice_" + std::to_string(i+1),sections[i]));
+   }
+   return true;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xslice2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return create_profile_mesh(t);
+}
@@ -0,0 +1,48 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef XSLICE2D_H
+#define XSLICE2D_H
+
+#include "xshape2d.h"
+#include "xsolid.h"
+
+// xslice2d is the cross section of a solid at one or more z values.
+//    <slice2d z="..">                        a single section
+//    <slice2d zmin=".." zmax=".." nslice=".."> nslice evenly spaced sections from zmin to zmax
+// The profile is the union of the sections, DXF and SVG files get one layer per section.
+
+class xslice2d : public xshape2d {
+public:
+   xslice2d();
+   xslice2d(const cf_xmlNode& node);
+   virtual ~xslice2d();
+
+   virtual size_t nbool();
+
+   std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // one layer per section, named slice_1, slice_2, ..
+   bool create_clipper_layers(profile_layers& layers, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+protected:
+   std::vector<std::shared_ptr<clipper_profile>> create_sections(const carve::math::Matrix& t) const;
+
+private:
+   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
+   std::vector<double>                         m_z;
+};
+
+#endif // XSLICE2D_H
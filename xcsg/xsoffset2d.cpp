@@ -65,5 +65,5 @@ std::shared_ptr<clipper_profile> xsoffset2d::create_clipper_profile(const carve:
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xsoffset2d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   return 0;
+   return create_profile_mesh(t);
 }
@@ -16,8 +16,12 @@
 #include "xsolid.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xtmatrix.h"
+#include "mesh_view.h"
+#include "box_boolean.h"
+#include "sdf_field.h"
 
 xsolid::xsolid()
+: m_releasable(false)
 {}
 
 xsolid::~xsolid()
@@ -32,6 +36,72 @@ void xsolid::set_transform(const cf_xmlNode& parent)
    }
 }
 
+void xsolid::set_transform(const carve::math::Matrix& t)
+{
+   m_t = t;
+}
+
+std::shared_ptr<mesh_view> xsolid::create_mesh_view(const carve::math::Matrix& t) const
+{
+   return std::make_shared<mesh_view>(create_carve_mesh(t));
+}
+
+void xsolid::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = create_carve_mesh(t);
+   size_t nvert = meshset->vertex_storage.size();
+   vertices.reserve(vertices.size()+nvert);
+   for(size_t i=0;i<nvert;i++) {
+      vertices.push_back(meshset->vertex_storage[i].v);
+   }
+}
+
+bool xsolid::append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t) const
+{
+   if(!is_convex()) return false;
+   parts.push_back(std::vector<xvertex>());
+   append_hull_vertices(parts.back(),t);
+   return true;
+}
+
+bool xsolid::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   if(!is_convex()) return false;
+   std::vector<xvertex> vertices;
+   append_hull_vertices(vertices,t);
+   for(size_t i=0;i<vertices.size();i++) box.add(vertices[i]);
+   return true;
+}
+
+xsolid::mesh_estimate xsolid::estimate() const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = create_carve_mesh();
+   size_t nface = 0;
+   for(size_t i=0; i<meshset->meshes.size(); i++) nface += meshset->meshes[i]->faces.size();
+   return mesh_estimate(nface);
+}
+
+// faces of a typical tessellated solid
+static const double nominal_cost = 1000.0;
+
+double xsolid::mesh_cost() const
+{
+   return nominal_cost;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xsolid::box_mesh(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<box_node> tree = box_expression(t);
+   if(!tree.get()) return nullptr;
+   return box_boolean::create_mesh(*tree);
+}
+
+std::shared_ptr<sdf_field> xsolid::create_sdf(double voxel, const carve::math::Matrix& t) const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = create_carve_mesh(t);
+   if(!mesh.get()) return std::make_shared<sdf_field>(voxel);
+   return sdf_field::from_mesh(*mesh,voxel);
+}
 
 const carve::math::Matrix& xsolid::get_transform() const
 {
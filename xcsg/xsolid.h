@@ -17,22 +17,94 @@
 #define XSOLID_H
 
 #include "xshape.h"
+#include "xbounds.h"
 #include <carve/matrix.hpp>
+#include <vector>
+#include <memory>
+class mesh_view;
+struct box_node;
+class sdf_field;
 
 // abstract base class for 3d objects
 
 class xsolid : public xshape {
 public:
+   // estimated size of the mesh of a subtree and its boolean work, for --estimate
+   struct mesh_estimate {
+      mesh_estimate(size_t nface = 0) : faces(nface), bool_faces(0), peak_faces(nface) {}
+      size_t faces;       // faces of the resulting mesh, an upper bound for booleans
+      size_t bool_faces;  // faces entering the booleans of the subtree
+      size_t peak_faces;  // faces of the meshes alive at the same time
+   };
+
    xsolid();
    virtual ~xsolid();
 
    void set_transform(const cf_xmlNode& parent);
+   void set_transform(const carve::math::Matrix& t);
    const carve::math::Matrix& get_transform() const;
 
    virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
 
+   // return the mesh as a view, materialized when a boolean needs it.
+   // The default views the result of create_carve_mesh, repeated instances view a shared mesh
+   virtual std::shared_ptr<mesh_view> create_mesh_view(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // append a vertex cloud with the same convex hull as the solid, for hull and minkowski.
+   // The default harvests the vertices of create_carve_mesh, convex primitives generate them directly
+   virtual void append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // true when the solid is known to be convex
+   virtual bool is_convex() const { return false; }
+
+   // append convex parts whose union is the solid, each as a hull vertex cloud.
+   // returns false, appending nothing, when no such decomposition is known
+   virtual bool append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // add a box enclosing the solid to box, without computing booleans.
+   // returns false, adding nothing, when no such box is known. The default boxes convex solids only
+   virtual bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // simplify the subtree before evaluation, returns the number of booleans eliminated
+   virtual size_t simplify() { return 0; }
+
+   // when the solid has reduced to a single child, return the child with the transform
+   // of this solid applied. This solid must not be used afterwards. Otherwise returns null
+   virtual std::shared_ptr<xsolid> reduced() { return nullptr; }
+
+   // estimate the mesh without computing booleans.
+   // The default meshes the solid, primitives count their tessellation directly
+   virtual mesh_estimate estimate() const;
+
+   // relative cost of creating the mesh of the subtree, so the most expensive subtrees are started first.
+   // Nothing is meshed: the default is a nominal solid, primitives count their faces, booleans add up their children
+   virtual double mesh_cost() const;
+
+   // the subtree in t as an expression of axis-aligned boxes for the box_boolean engine,
+   // nullptr when the subtree is not made of axis-aligned cubes and cuboids only
+   virtual std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const { return nullptr; }
+
+   // the mesh of box_expression(t) computed by box_boolean, nullptr when the subtree does not qualify
+   std::shared_ptr<carve::mesh::MeshSet<3>> box_mesh(const carve::math::Matrix& t) const;
+
+   // signed distance field of the subtree in t for --backend sdf. The default rasterizes
+   // the mesh of the solid, booleans combine the fields of their children instead
+   virtual std::shared_ptr<sdf_field> create_sdf(double voxel, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // mark the subtree as owned by this tree alone, so its data may be released once meshed.
+   // Booleans pass the mark on to their children. Instances and cached subtrees refer to
+   // solids shared with other parts of the model, so the mark stops there
+   virtual void set_releasable() { m_releasable = true; }
+   bool releasable() const { return m_releasable; }
+
+   // release the data needed only for meshing, called on releasable solids when their mesh has
+   // entered a boolean queue. The default keeps everything, booleans drop their children and
+   // polyhedra their vertices and faces. The solid must not be meshed again afterwards
+   virtual void release_mesh_data() {}
+
 private:
    carve::math::Matrix m_t;
+   bool                m_releasable;
 };
 
 #endif // XSOLID_H
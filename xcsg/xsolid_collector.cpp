@@ -15,56 +15,313 @@
 
 #include "xsolid_collector.h"
 #include "xcsg_factory.h"
+#include "node_profiler.h"
+#include "thread_pool.h"
+#include "box_boolean.h"
+#include "sdf_field.h"
+#include <algorithm>
 
-void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
+// number of serial_scope objects alive in this thread
+static thread_local int serial_depth = 0;
+
+xsolid_collector::serial_scope::serial_scope()
+{
+   serial_depth++;
+}
+
+xsolid_collector::serial_scope::~serial_scope()
+{
+   serial_depth--;
+}
+
+std::vector<std::shared_ptr<xsolid>> xsolid_collector::make_children(const cf_xmlNode& parent)
 {
-   size_t icount=0;
+   xcsg_factory& factory = xcsg_factory::singleton();
+
+   // the factory entry of each child is looked up once
+   std::vector<cf_xmlNode> nodes;
+   std::vector<const xcsg_factory::entry*> entries;
    cf_xmlNode tmp(parent);
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_solid(sub)) {
-         A.insert(xcsg_factory::singleton().make_solid(sub));
-         icount++;
+      const xcsg_factory::entry* e = factory.find(sub);
+      if(e && e->type == xcsg_factory::SOLID) {
+         nodes.push_back(sub);
+         entries.push_back(e);
       }
    }
-   if(icount == 0) {
+   if(nodes.size() == 0) {
       throw logic_error("Expected solids under " + parent.tag() + ", but found none.");
    }
+
+   // the profiler registers nodes in construction order, so it requires serial construction
+   std::vector<std::shared_ptr<xsolid>> solids(nodes.size());
+   thread_pool& pool = thread_pool::singleton();
+   if(nodes.size() == 1 || pool.nthreads() <= 1 || serial_depth > 0 || node_profiler::singleton().enabled()) {
+      for(size_t i=0; i<nodes.size(); i++) solids[i] = factory.make_solid(*entries[i],nodes[i]);
+   }
+   else {
+      task_group tasks(pool);
+      for(size_t i=0; i<nodes.size(); i++) {
+         tasks.run([&factory,&nodes,&entries,&solids,i]() { solids[i] = factory.make_solid(*entries[i],nodes[i]); });
+      }
+      tasks.wait();
+   }
+   return solids;
+}
+
+void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
+{
+   for(auto& solid : make_children(parent)) A.insert(solid);
 }
 
 void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A, size_t nA, ShapeSet& B)
 {
-   size_t icount=0;
-   cf_xmlNode tmp(parent);
-   for(auto i=tmp.begin(); i!=tmp.end(); i++) {
-      cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_solid(sub)) {
-         if(icount < nA) {
-            A.insert(xcsg_factory::singleton().make_solid(sub));
+   std::vector<std::shared_ptr<xsolid>> solids = make_children(parent);
+   for(size_t i=0; i<solids.size(); i++) {
+      if(i < nA) A.insert(solids[i]);
+      else       B.insert(solids[i]);
+   }
+}
+
+void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeList& A)
+{
+   for(auto& solid : make_children(parent)) A.push_back(solid);
+}
+
+template <class C>
+static xsolid::mesh_estimate pairwise_estimate(const C& A)
+{
+   if(A.size() == 1) return (*A.begin())->estimate();
+
+   xsolid::mesh_estimate e;
+   size_t peak = 0;
+   for(auto& solid : A) {
+      xsolid::mesh_estimate child = solid->estimate();
+      e.faces      += child.faces;
+      e.bool_faces += child.bool_faces;
+      peak = std::max(peak,child.peak_faces);
+   }
+   size_t nlevel = 0;
+   for(size_t n=1; n<A.size(); n*=2) nlevel++;
+   e.bool_faces += nlevel*e.faces;
+   e.peak_faces  = std::max(peak,2*e.faces);
+   return e;
+}
+
+// the children are meshed, then each of their faces enters about log2(n) booleans
+template <class C>
+static double pairwise_cost(const C& A)
+{
+   double cost = 0.0;
+   for(auto& solid : A) cost += solid->mesh_cost();
+   size_t nlevel = 0;
+   for(size_t n=1; n<A.size(); n*=2) nlevel++;
+   return cost*(1+nlevel);
+}
+
+size_t xsolid_collector::simplify_children(ShapeSet& A)
+{
+   size_t nelim = 0;
+   ShapeSet simplified;
+   for(auto& solid : A) {
+      nelim += solid->simplify();
+      std::shared_ptr<xsolid> child = solid->reduced();
+      simplified.insert((child.get())? child : solid);
+   }
+   A.swap(simplified);
+   return nelim;
+}
+
+size_t xsolid_collector::simplify_children(ShapeList& A)
+{
+   size_t nelim = 0;
+   for(auto& solid : A) {
+      nelim += solid->simplify();
+      std::shared_ptr<xsolid> child = solid->reduced();
+      if(child.get()) solid = child;
+   }
+   return nelim;
+}
+
+bool xsolid_collector::bounding_box(const ShapeSet& A, xbounds& box, const carve::math::Matrix& t)
+{
+   xbounds children;
+   for(auto& solid : A) {
+      if(!solid->bounding_box(children,t)) return false;
+   }
+   box.add(children);
+   return true;
+}
+
+// bounding volume hierarchy over a set of boxes, built by splitting at the median
+// box centre along the longest axis of each node
+class box_tree {
+public:
+   box_tree(const std::vector<xbounds>& boxes)
+   : m_boxes(boxes)
+   , m_index(boxes.size())
+   {
+      for(size_t i=0; i<m_index.size(); i++) m_index[i] = i;
+      if(boxes.size() > 0) build(0,boxes.size());
+   }
+
+   // call f(j) for each box j > i not disjoint from box i
+   template <class F>
+   void overlapping(size_t i, F f) const
+   {
+      if(m_nodes.empty()) return;
+      std::vector<size_t> stack(1,0);
+      const xbounds& box = m_boxes[i];
+      while(!stack.empty()) {
+         const node& n = m_nodes[stack.back()];
+         stack.pop_back();
+         if(n.box.disjoint(box)) continue;
+         if(n.left == 0) {
+            for(size_t k=n.first; k<n.last; k++) {
+               size_t j = m_index[k];
+               if(j > i && !m_boxes[j].disjoint(box)) f(j);
+            }
          }
          else {
-            B.insert(xcsg_factory::singleton().make_solid(sub));
+            stack.push_back(n.left);
+            stack.push_back(n.right);
          }
-         icount++;
       }
    }
-   if(icount == 0) {
-      throw logic_error("Expected solids under " + parent.tag() + ", but found none.");
+
+private:
+   static const size_t leaf_size = 4;
+
+   // node covering m_index[first,last), a leaf has left==0 since the root is node 0
+   struct node {
+      xbounds box;
+      size_t  first,last;
+      size_t  left,right;
+   };
+
+   size_t build(size_t first, size_t last)
+   {
+      size_t inode = m_nodes.size();
+      node n;
+      n.first = first;
+      n.last  = last;
+      n.left  = n.right = 0;
+      for(size_t k=first; k<last; k++) n.box.add(m_boxes[m_index[k]]);
+      m_nodes.push_back(n);
+      if(last-first <= leaf_size) return inode;
+
+      size_t axis = 0;
+      for(size_t k=1; k<3; k++) {
+         if(n.box.max()[k]-n.box.min()[k] > n.box.max()[axis]-n.box.min()[axis]) axis = k;
+      }
+      size_t mid = (first+last)/2;
+      const std::vector<xbounds>& boxes = m_boxes;
+      std::nth_element(m_index.begin()+first,m_index.begin()+mid,m_index.begin()+last,[&boxes,axis](size_t a, size_t b) {
+         return boxes[a].min()[axis]+boxes[a].max()[axis] < boxes[b].min()[axis]+boxes[b].max()[axis];
+      });
+
+      size_t left  = build(first,mid);
+      size_t right = build(mid,last);
+      m_nodes[inode].left  = left;
+      m_nodes[inode].right = right;
+      return inode;
+   }
+
+private:
+   const std::vector<xbounds>& m_boxes;
+   std::vector<size_t>         m_index;
+   std::vector<node>           m_nodes;
+};
+
+size_t xsolid_collector::overlap_clusters(const std::vector<xbounds>& boxes, std::vector<size_t>& cluster)
+{
+   // union-find over the overlapping pairs
+   std::vector<size_t> parent(boxes.size());
+   for(size_t i=0; i<parent.size(); i++) parent[i] = i;
+   auto root = [&parent](size_t i) {
+      while(parent[i] != i) i = parent[i] = parent[parent[i]];
+      return i;
+   };
+
+   box_tree tree(boxes);
+   for(size_t i=0; i<boxes.size(); i++) {
+      tree.overlapping(i,[&parent,&root,i](size_t j) {
+         size_t ri = root(i);
+         size_t rj = root(j);
+         if(ri != rj) parent[std::max(ri,rj)] = std::min(ri,rj);
+      });
+   }
+
+   // clusters are numbered in the order of their first box
+   const size_t unused = boxes.size();
+   std::vector<size_t> root_cluster(boxes.size(),unused);
+   cluster.resize(boxes.size());
+   size_t nclusters = 0;
+   for(size_t i=0; i<boxes.size(); i++) {
+      size_t r = root(i);
+      if(root_cluster[r] == unused) root_cluster[r] = nclusters++;
+      cluster[i] = root_cluster[r];
    }
+   return nclusters;
 }
 
-void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeList& A)
+bool xsolid_collector::overlap_clusters(const ShapeSet& A, const carve::math::Matrix& t, std::vector<ShapeSet>& clusters)
 {
-   size_t icount=0;
-   cf_xmlNode tmp(parent);
-   for(auto i=tmp.begin(); i!=tmp.end(); i++) {
-      cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_solid(sub)) {
-         A.push_back(xcsg_factory::singleton().make_solid(sub));
-         icount++;
-      }
+   std::vector<std::shared_ptr<xsolid>> solids(A.begin(),A.end());
+   std::vector<xbounds> boxes(solids.size());
+   for(size_t i=0; i<solids.size(); i++) {
+      if(!solids[i]->bounding_box(boxes[i],t)) return false;
    }
-   if(icount == 0) {
-      throw logic_error("Expected solids under " + parent.tag() + ", but found none.");
+
+   std::vector<size_t> cluster;
+   clusters.assign(overlap_clusters(boxes,cluster),ShapeSet());
+   for(size_t i=0; i<solids.size(); i++) clusters[cluster[i]].insert(solids[i]);
+   return true;
+}
+
+xsolid::mesh_estimate xsolid_collector::estimate(const ShapeSet& A)
+{
+   return pairwise_estimate(A);
+}
+
+xsolid::mesh_estimate xsolid_collector::estimate(const ShapeList& A)
+{
+   return pairwise_estimate(A);
+}
+
+double xsolid_collector::mesh_cost(const ShapeSet& A)
+{
+   return pairwise_cost(A);
+}
+
+double xsolid_collector::mesh_cost(const ShapeList& A)
+{
+   return pairwise_cost(A);
+}
+
+void xsolid_collector::set_releasable(const ShapeSet& A)
+{
+   for(auto& solid : A) solid->set_releasable();
+}
+
+void xsolid_collector::set_releasable(const ShapeList& A)
+{
+   for(auto& solid : A) solid->set_releasable();
+}
+
+bool xsolid_collector::box_expression(const ShapeSet& A, const carve::math::Matrix& t, box_node& node)
+{
+   for(auto& solid : A) {
+      std::shared_ptr<box_node> child = solid->box_expression(t);
+      if(!child.get()) return false;
+      node.children.push_back(child);
    }
+   return true;
+}
+
+std::shared_ptr<sdf_field> xsolid_collector::create_sdf(const ShapeSet& A, double voxel, const carve::math::Matrix& t)
+{
+   std::vector<std::shared_ptr<xsolid>> children(A.begin(),A.end());
+   return sdf_field::union_of(children.size(),[&children,voxel,&t](size_t i) { return children[i]->create_sdf(voxel,t); },voxel);
 }
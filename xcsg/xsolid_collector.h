@@ -19,16 +19,27 @@
 #include <set>
 #include <list>
 #include <memory>
+#include <vector>
 #include "xsolid.h"
 #include "csg_parser/cf_xmlNode.h"
 
 // xsolid_collector is a helper class for collecting child solid nodes from XML
+// Sibling subtrees are independent, so the child solids are constructed as parallel
+// tasks in the thread_pool. The children are always collected in document order.
 
 class xsolid_collector {
 public:
    typedef std::unordered_set<std::shared_ptr<xsolid>> ShapeSet;
    typedef std::list<std::shared_ptr<xsolid>>          ShapeList;
 
+   // while a serial_scope exists, children are constructed in the calling thread only
+   // (e.g. when a shared definition is built under a lock)
+   class serial_scope {
+   public:
+      serial_scope();
+     ~serial_scope();
+   };
+
    // collect all children into A
    static void collect_children(const cf_xmlNode& parent, ShapeSet& A);
 
@@ -38,6 +49,46 @@ public:
    // collect all children into A
    static void collect_children(const cf_xmlNode& parent, ShapeList& A);
 
+   // simplify the children in A, replacing those reduced to a single solid.
+   // returns the number of booleans eliminated
+   static size_t simplify_children(ShapeSet& A);
+   static size_t simplify_children(ShapeList& A);
+
+   // add the combined bounding box of the children in A to box,
+   // returns false when the box of any child is unknown
+   static bool bounding_box(const ShapeSet& A, xbounds& box, const carve::math::Matrix& t);
+
+   // partition A into clusters of children whose bounding boxes in t overlap, directly or through
+   // other children. Children of different clusters are disjoint, so their union is a concatenation.
+   // The overlapping pairs are found through a bounding volume hierarchy over the child boxes.
+   // Returns false when the box of any child is unknown
+   static bool overlap_clusters(const ShapeSet& A, const carve::math::Matrix& t, std::vector<ShapeSet>& clusters);
+
+   // as above for plain boxes, cluster[i] is set to the cluster of box i. Returns the number of clusters
+   static size_t overlap_clusters(const std::vector<xbounds>& boxes, std::vector<size_t>& cluster);
+
+   // estimate for combining the children in A by pairwise booleans: each face enters
+   // about log2(n) booleans, and the child meshes are queued together with the result
+   static xsolid::mesh_estimate estimate(const ShapeSet& A);
+   static xsolid::mesh_estimate estimate(const ShapeList& A);
+
+   // mesh cost of combining the children in A by pairwise booleans, see xsolid::mesh_cost
+   static double mesh_cost(const ShapeSet& A);
+   static double mesh_cost(const ShapeList& A);
+
+   // append the box trees of the children in A to node, returns false when any child is not made of boxes
+   static bool box_expression(const ShapeSet& A, const carve::math::Matrix& t, box_node& node);
+
+   // union of the signed distance fields of the children in A, created as parallel tasks
+   static std::shared_ptr<sdf_field> create_sdf(const ShapeSet& A, double voxel, const carve::math::Matrix& t);
+
+   // mark the children in A releasable, see xsolid::set_releasable
+   static void set_releasable(const ShapeSet& A);
+   static void set_releasable(const ShapeList& A);
+
+private:
+   // construct all child solids of parent in document order, throws if there are none
+   static std::vector<std::shared_ptr<xsolid>> make_children(const cf_xmlNode& parent);
 };
 
 #endif // XSOLID_COLLECTOR_H
@@ -14,7 +14,10 @@
 // EndLicense:
 
 #include "xsphere.h"
+#include "mesh_utils.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
+#include "extrude_mesh.h"
 
 xsphere::xsphere(double r)
 : m_r(r)
@@ -35,8 +38,37 @@ xsphere::~xsphere()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xsphere::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    int nseg = -1;
- //  std::shared_ptr<xpolyhedron> poly = primitives3d::make_sphere(m_r,nseg,t*get_transform());
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_geodesic_sphere(m_r,nseg,t*get_transform());
+   carve::math::Matrix tt = t*get_transform();
+
+   // instance of the unit sphere. clone_transform does not reorient faces, so mirrored spheres are built directly
+   carve::math::Matrix tloc = tt*carve::math::Matrix::SCALE(m_r,m_r,m_r);
+   if(!mesh_utils::is_left_hand(tloc)) {
+      size_t idepth = primitives3d::geodesic_depth(m_r,nseg);
+      return extrude_mesh::clone_transform(primitive_cache::singleton().geodesic_mesh(idepth),tloc);
+   }
+
+ //  std::shared_ptr<xpolyhedron> poly = primitives3d::make_sphere(m_r,nseg,tt);
+   std::shared_ptr<xpolyhedron> poly = primitives3d::make_geodesic_sphere(m_r,nseg,tt);
    return poly->create_carve_mesh();
 }
+
+void xsphere::append_hull_vertices(std::vector<xvertex>& vertices, const carve::math::Matrix& t) const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   int nseg = -1;
+   primitives3d::geodesic_sphere_vertices(m_r,nseg,t*get_transform(),vertices);
+}
+
+bool xsphere::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   box.add(carve::geom::VECTOR(-m_r,-m_r,-m_r),carve::geom::VECTOR(m_r,m_r,m_r),t*get_transform());
+   return true;
+}
+
+xsolid::mesh_estimate xsphere::estimate() const
+{
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
+   return mesh_estimate(primitives3d::geodesic_sphere_faces(m_r,-1));
+}
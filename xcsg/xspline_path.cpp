@@ -55,6 +55,7 @@ xspline_path::xspline_path(const cf_xmlNode& const_node)
    m_cp.shrink_to_fit();
 
    if(m_cp.size() < 2)throw logic_error("spline_path: at least 2 <cpoint> control points must be specified.");
+   m_spline = std::make_shared<csplines::spline_path>(m_cp);
 }
 
 xspline_path::~xspline_path()
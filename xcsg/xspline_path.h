@@ -29,10 +29,14 @@ public:
 
    const std::vector<csplines::cpoint>& cp() const;
 
+   // the spline through the control points, computed once and shared by all sweeps of this path
+   std::shared_ptr<const csplines::spline_path> spline() const { return m_spline; }
+
 protected:
 
 private:
    std::vector<csplines::cpoint> m_cp;  // spline control points
+   std::shared_ptr<const csplines::spline_path> m_spline;
 };
 
 #endif // XSPLINE_PATH_H
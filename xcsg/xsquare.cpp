@@ -47,6 +47,13 @@ std::shared_ptr<clipper_profile> xsquare::create_clipper_profile(const carve::ma
 }
 
 
+bool xsquare::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   double x1 = (m_center)? -0.5*m_size : 0.0;
+   box.add(carve::geom::VECTOR(x1,x1,0.0),carve::geom::VECTOR(x1+m_size,x1+m_size,0.0),t*get_transform());
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xsquare::create_carve_mesh(const carve::math::Matrix& t) const
 {
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_size,m_size, mesh_utils::thickness(),m_center,false,t*get_transform());
@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "xsweep.h"
+#include "mesh_utils.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xspline_path.h"
@@ -51,18 +52,13 @@ xsweep::~xsweep()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xsweep::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    // create profile in native 2d system
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
-   }
+   std::shared_ptr<clipper_profile> profile = xshape2d_collector::union_profile(m_incl,carve::math::Matrix());
 
 
    // apply 3d transformation when creating 3d mesh
-   std::shared_ptr<const csplines::spline_path> spline(new csplines::spline_path(m_path->cp()));
-
-   return  extrude_mesh::sweep_extrude(csg.profile(),spline,t*get_transform());
+   return  extrude_mesh::sweep_extrude(profile,m_path->spline(),t*get_transform());
 }
 
 
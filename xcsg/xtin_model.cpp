@@ -14,10 +14,8 @@
 // EndLicense:
 
 #include "xtin_model.h"
-#include "primitives3d.h"
-#include <carve/input.hpp>
-#include <map>
 #include "tin_mesh.h"
+#include "bulk_reader.h"
 
 
 
@@ -27,34 +25,21 @@ xtin_model::xtin_model(const cf_xmlNode& const_node)
 
    set_transform(const_node);
 
+   // vertices may be given in an external file instead of the xml
+   std::string file = const_node.get_property("file",std::string(""));
+   if(file.length() > 0) bulk_reader::read_file(file,"tin_model",m_vertices,0);
+
    cf_xmlNode node = const_node;
    for(auto i=node.begin(); i!=node.end(); i++) {
 
       cf_xmlNode sub(i);
       if(!sub.is_attribute_node()) {
 
-         if("vertices" == sub.tag()) {
-
-            map<size_t,xvertex> v;
-            for(auto iv=sub.begin(); iv!=sub.end(); iv++) {
-               // get next vertex
-               cf_xmlNode vertex(iv);
-               if("vertex" == vertex.tag()) {
-                  size_t id = v.size();
-                  v[id]= carve::geom::VECTOR( vertex.get_property("x",0.0),
-                                              vertex.get_property("y",0.0),
-                                              vertex.get_property("z",0.0));
-               }
-               else {
-                  throw logic_error("tin_model: expected tag 'vertex' but found " + vertex.tag());
-               }
-            }
-
-            // copy to member variable
-            m_vertices.resize(v.size());
-            for(auto i=v.begin(); i!=v.end(); i++) {
-               m_vertices[i->first] = i->second;
-            }
+         if(file.length() > 0 && "vertices" == sub.tag()) {
+            throw logic_error("tin_model: 'file' attribute cannot be combined with vertices");
+         }
+         else if("vertices" == sub.tag()) {
+            bulk_reader::read_vertices(sub,"tin_model",m_vertices);
          }
       }
    }
@@ -64,38 +49,20 @@ xtin_model::~xtin_model()
 {}
 
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xtin_model::create_carve_mesh(const carve::math::Matrix& t) const
+bool xtin_model::bounding_box(xbounds& box, const carve::math::Matrix& t) const
 {
-   // create a neutral vector of vertices for tin_mesh
-   std::vector<tin_mesh::txyz>  vert;
-   vert.reserve(m_vertices.size());
-   for(auto& v : m_vertices) {
-      vert.push_back(tin_mesh::txyz(v.x,v.y,v.z));
-   }
-
-   // create neutral polyhedron with only vertices
-   std::shared_ptr<tin_mesh::tpoly> poly(new tin_mesh::tpoly(vert));
-
-   // perform meshing, this adds faces to poly
-   poly = tin_mesh::make_tin(poly);
-
-   // convert to carve mesh
-   carve::input::PolyhedronData data;
-   data.reserveVertices(static_cast<int>(poly->m_vert.size()));
-   for(size_t i=0; i<poly->m_vert.size(); i++) {
-      const tin_mesh::txyz& v = poly->m_vert[i];
-      data.addVertex(t*get_transform()*carve::geom::VECTOR(v.x,v.y,v.z));
-   }
-
-   data.reserveFaces(static_cast<int>(poly->m_face.size()),3);
-   for(size_t i=0; i<poly->m_face.size(); i++) {
-      const xface& face = poly->m_face[i];
-      data.addFace(face.begin(),face.end());
-   }
-
-   carve::input::Options options;
-   std::shared_ptr<carve::mesh::MeshSet<3>>  meshset(data.createMesh(options));
+   carve::math::Matrix tt = t*get_transform();
+   for(size_t i=0; i<m_vertices.size(); i++) box.add(tt*m_vertices[i]);
+   return true;
+}
 
+std::shared_ptr<carve::mesh::MeshSet<3>> xtin_model::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   // triangulate and close the terrain, the faces are emitted directly into the mesh
+   return tin_mesh::make_tin(m_vertices,t*get_transform());
+}
 
-   return meshset;
+void xtin_model::release_mesh_data()
+{
+   std::vector<xvertex>().swap(m_vertices);
 }
@@ -26,6 +26,12 @@ public:
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   // the box of the transformed vertices, the model is not triangulated
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the vertices are freed once meshed
+   void release_mesh_data();
+
 protected:
 
 private:
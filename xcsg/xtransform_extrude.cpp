@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "xtransform_extrude.h"
+#include "mesh_utils.h"
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
@@ -39,11 +40,15 @@ xtransform_extrude::xtransform_extrude(const cf_xmlNode& node)
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xtransform_extrude::create_carve_mesh(const carve::math::Matrix& t) const
 {
+   mesh_utils::tolerance_scope tol_scope(secant_tolerance());
    std::shared_ptr<clipper_profile> bottom = m_incl[0]->create_clipper_profile(carve::math::Matrix());
    carve::math::Matrix t_bot               = m_incl[0]->get_transform();
    std::shared_ptr<clipper_profile> top    = m_incl[1]->create_clipper_profile(carve::math::Matrix());
    carve::math::Matrix t_top               = m_incl[1]->get_transform();
 
+   // cleaning may remove degenerate paths, so do it before comparing
+   bottom->clean();
+   top->clean();
    size_t np_bot = bottom->paths().size();
    size_t np_top = top->paths().size();
    if(np_bot != np_top) {
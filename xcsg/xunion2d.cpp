@@ -45,20 +45,16 @@ size_t xunion2d::nbool()
 
 std::shared_ptr<clipper_profile> xunion2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
-   return csg.profile();
+   return xshape2d_collector::union_profile(m_incl,t*get_transform());
 }
 
 
+bool xunion2d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return xshape2d_collector::bounding_box(m_incl,box,t*get_transform());
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xunion2d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   carve_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
-   }
-   csg.eliminate_short_edges();
-   return csg.mesh_set();
+   return create_profile_mesh(t);
 }
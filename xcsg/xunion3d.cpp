@@ -14,13 +14,20 @@
 // EndLicense:
 
 #include "xunion3d.h"
+#include "xlinear_extrude.h"
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "xprofiled_solid.h"
+#include "box_boolean.h"
+#include "sdf_field.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <algorithm>
 
 xunion3d::xunion3d()
 {}
@@ -46,27 +53,151 @@ size_t xunion3d::nbool()
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xunion3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   // subtrees of axis-aligned boxes only are computed exactly on their grid, without mesh booleans
+   std::shared_ptr<carve::mesh::MeshSet<3>> boxes = box_mesh(t);
+   if(boxes.get()) return boxes;
+
+   return union_mesh(m_incl,t*get_transform());
+}
+
+// union of the solids in A through the boolean queues, nullptr if A is empty
+static std::shared_ptr<carve::mesh::MeshSet<3>> queue_union(const xsolid_collector::ShapeSet& A, const carve::math::Matrix& t)
 {
    // run booleans in threads
 
-   safe_queue<std::string> exception_queue;
-   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
+   // repeated instances are queued as transformed views, materialized when their boolean starts
+   safe_queue<carve_boolean_thread::MeshView_ptr> view_queue;
+   carve_mesh_thread::create_mesh_queue(t,A,view_queue);
+
+   carve_boolean_thread::compute(view_queue,carve::csg::CSG::UNION);
+
+   if(view_queue.size() > 0) return view_queue.dequeue()->materialize();
+   else return nullptr;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xunion3d::union_mesh(const std::unordered_set<std::shared_ptr<xsolid>>& A, const carve::math::Matrix& t)
+{
+   std::vector<xsolid_collector::ShapeSet> clusters;
+   if(A.size() < 3 || !xsolid_collector::overlap_clusters(A,t,clusters) || clusters.size() < 2) return queue_union(A,t);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
+   // solids overlapping nothing need no boolean, they are meshed together in this thread
+   // while the clusters of overlapping solids are unioned as pool tasks
+   xsolid_collector::ShapeSet singles;
+   std::vector<const xsolid_collector::ShapeSet*> groups;
+   for(auto& cluster : clusters) {
+      if(cluster.size() == 1) singles.insert(*cluster.begin());
+      else                    groups.push_back(&cluster);
    }
 
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
+   std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>> parts(groups.size());
+   std::atomic<size_t> next_group(0);
+   auto group_task = [&groups,&parts,&next_group,&t]() {
+      for(size_t i=next_group++; i<groups.size(); i=next_group++) {
+         try {
+            parts[i] = queue_union(*groups[i],t);
+         }
+         catch(carve::exception& ex) {
+            throw std::runtime_error("(carve error): " + ex.str());
+         }
+      }
+   };
+   task_group group_tasks;
+   const size_t ntask = std::min(thread_pool::singleton().nthreads(),groups.size());
+   for(size_t itask=0; itask<ntask; itask++) group_tasks.run(group_task);
+
+   safe_queue<carve_boolean_thread::MeshView_ptr> single_queue;
+   if(singles.size() > 0) carve_mesh_thread::create_mesh_queue(t,singles,single_queue);
+   group_tasks.wait();
+
+   carve_boolean_thread::MeshView_ptr view;
+   while(single_queue.try_dequeue(view)) parts.push_back(view->materialize());
+
+   std::vector<const carve::mesh::MeshSet<3>*> sets;
+   for(auto& part : parts) {
+      if(part.get()) sets.push_back(part.get());
    }
+   return carve_boolean::concatenate(sets);
+}
 
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
+bool xunion3d::append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t) const
+{
+   size_t nparts = parts.size();
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      if(!(*i)->append_convex_parts(parts,t*get_transform())) {
+         parts.resize(nparts);
+         return false;
+      }
    }
+   return true;
+}
+
+size_t xunion3d::simplify()
+{
+   size_t nelim = xsolid_collector::simplify_children(m_incl);
+
+   // the children of nested unions become children of this union, with the nested transform applied
+   std::unordered_set<std::shared_ptr<xsolid>> flat;
+   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
+      std::shared_ptr<xunion3d> nested = std::dynamic_pointer_cast<xunion3d>(xprofiled_solid::unwrap(*i));
+      if(!nested.get()) {
+         flat.insert(*i);
+         continue;
+      }
+      for(auto& child : nested->m_incl) {
+         child->set_transform(nested->get_transform()*child->get_transform());
+         flat.insert(child);
+      }
+   }
+   m_incl.swap(flat);
+
+   // extrudes sharing their plane and height are unioned in 2d
+   nelim += xlinear_extrude::merge_union(m_incl);
+   return nelim;
+}
 
-   return mesh_queue.dequeue();
+std::shared_ptr<xsolid> xunion3d::reduced()
+{
+   if(m_incl.size() != 1) return nullptr;
+   std::shared_ptr<xsolid> child = *m_incl.begin();
+   child->set_transform(get_transform()*child->get_transform());
+   return child;
+}
+
+bool xunion3d::bounding_box(xbounds& box, const carve::math::Matrix& t) const
+{
+   return xsolid_collector::bounding_box(m_incl,box,t*get_transform());
+}
+
+xsolid::mesh_estimate xunion3d::estimate() const
+{
+   return xsolid_collector::estimate(m_incl);
+}
+
+double xunion3d::mesh_cost() const
+{
+   return xsolid_collector::mesh_cost(m_incl);
+}
+
+std::shared_ptr<box_node> xunion3d::box_expression(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<box_node> node = std::make_shared<box_node>(box_node::UNION);
+   if(!xsolid_collector::box_expression(m_incl,t*get_transform(),*node)) return nullptr;
+   return node;
+}
+
+std::shared_ptr<sdf_field> xunion3d::create_sdf(double voxel, const carve::math::Matrix& t) const
+{
+   return xsolid_collector::create_sdf(m_incl,voxel,t*get_transform());
+}
+
+void xunion3d::set_releasable()
+{
+   xsolid::set_releasable();
+   xsolid_collector::set_releasable(m_incl);
+}
+
+void xunion3d::release_mesh_data()
+{
+   m_incl.clear();
 }
@@ -28,6 +28,28 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // a union of solids with convex decompositions is decomposed into all their parts
+   bool append_convex_parts(std::vector<std::vector<xvertex>>& parts, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // nested unions are merged into this one, a single child replaces the union
+   virtual size_t simplify();
+   virtual std::shared_ptr<xsolid> reduced();
+   bool bounding_box(xbounds& box, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate() const;
+   double mesh_cost() const;
+   std::shared_ptr<box_node> box_expression(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   std::shared_ptr<sdf_field> create_sdf(double voxel, const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // the children are marked and released with this solid
+   void set_releasable();
+   void release_mesh_data();
+
+   // union of the solids in A meshed in t. Clusters of solids with overlapping bounding boxes are
+   // unioned as parallel tasks, and the disjoint cluster results are concatenated without a boolean
+   static std::shared_ptr<carve::mesh::MeshSet<3>> union_mesh(const std::unordered_set<std::shared_ptr<xsolid>>& A, const carve::math::Matrix& t);
+
 private:
    std::unordered_set<std::shared_ptr<xsolid>> m_incl;
 };
@@ -0,0 +1,416 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#include "zip_writer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <ctime>
+
+// uncompressed bytes per deflate task
+static const size_t deflate_chunk_bytes = 1<<18;
+
+// LZ77 parameters
+static const size_t window_size = 1<<15;
+static const size_t min_match   = 3;
+static const size_t max_match   = 258;
+static const size_t max_chain   = 32;
+static const size_t hash_bits   = 15;
+
+// deflate length and distance codes (RFC 1951, section 3.2.5)
+static const uint16_t length_base[]  = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+static const uint8_t  length_extra[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+static const uint16_t dist_base[]    = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+static const uint8_t  dist_extra[]   = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+// little endian bit output, as required by deflate
+class bit_writer {
+public:
+   bit_writer(std::string& out) : m_out(out), m_bits(0), m_nbits(0) {}
+
+   void put(uint32_t bits, size_t nbits)
+   {
+      m_bits |= uint64_t(bits) << m_nbits;
+      m_nbits += nbits;
+      while(m_nbits >= 8) {
+         m_out += char(m_bits & 0xFF);
+         m_bits >>= 8;
+         m_nbits -= 8;
+      }
+   }
+
+   // Huffman codes are stored most significant bit first
+   void put_code(uint32_t code, size_t nbits)
+   {
+      uint32_t reversed = 0;
+      for(size_t i=0; i<nbits; i++) {
+         reversed = (reversed<<1) | ((code>>i) & 1);
+      }
+      put(reversed,nbits);
+   }
+
+   void align()
+   {
+      if(m_nbits > 0) put(0,8-m_nbits);
+   }
+
+private:
+   std::string& m_out;
+   uint64_t     m_bits;
+   size_t       m_nbits;
+};
+
+// fixed Huffman code for a literal/length symbol
+static void put_symbol(bit_writer& bits, uint32_t symbol)
+{
+   if(symbol < 144)      bits.put_code(0x30 + symbol,8);
+   else if(symbol < 256) bits.put_code(0x190 + symbol-144,9);
+   else if(symbol < 280) bits.put_code(symbol-256,7);
+   else                  bits.put_code(0xC0 + symbol-280,8);
+}
+
+static void put_match(bit_writer& bits, size_t length, size_t distance)
+{
+   size_t il = std::upper_bound(length_base,length_base+29,length) - length_base - 1;
+   put_symbol(bits,uint32_t(257+il));
+   bits.put(uint32_t(length - length_base[il]),length_extra[il]);
+
+   size_t id = std::upper_bound(dist_base,dist_base+30,distance) - dist_base - 1;
+   bits.put_code(uint32_t(id),5);
+   bits.put(uint32_t(distance - dist_base[id]),dist_extra[id]);
+}
+
+static inline size_t hash3(const unsigned char* p)
+{
+   uint32_t v = (uint32_t(p[0])<<16) | (uint32_t(p[1])<<8) | p[2];
+   return (v*2654435761u) >> (32-hash_bits);
+}
+
+void zip_writer::deflate_chunk(const char* data, size_t len, std::string& out)
+{
+   const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+   const size_t out_start = out.size();
+
+   // hash chains of previous positions with the same 3 leading bytes, -1 for none
+   std::vector<int> head(size_t(1)<<hash_bits,-1);
+   std::vector<int> prev(len,-1);
+   auto insert = [&](size_t pos) {
+      size_t h = hash3(p+pos);
+      prev[pos] = head[h];
+      head[h]   = int(pos);
+   };
+
+   bit_writer bits(out);
+
+   // one fixed Huffman block, not final
+   bits.put(0,1);
+   bits.put(1,2);
+
+   size_t pos = 0;
+   while(pos < len) {
+      size_t best_len  = 0;
+      size_t best_dist = 0;
+      if(pos+min_match <= len) {
+         const size_t max_len = std::min(max_match,len-pos);
+         int cand = head[hash3(p+pos)];
+         for(size_t ichain=0; ichain<max_chain && cand>=0 && pos-cand <= window_size; ichain++) {
+            const unsigned char* a = p + cand;
+            const unsigned char* b = p + pos;
+            if(a[best_len] == b[best_len]) {
+               size_t n = 0;
+               while(n<max_len && a[n]==b[n]) n++;
+               if(n > best_len) {
+                  best_len  = n;
+                  best_dist = pos - cand;
+                  if(n == max_len) break;
+               }
+            }
+            cand = prev[cand];
+         }
+      }
+
+      if(best_len >= min_match) {
+         put_match(bits,best_len,best_dist);
+         const size_t end = pos+best_len;
+         for(; pos<end; pos++) {
+            if(pos+min_match <= len) insert(pos);
+         }
+      }
+      else {
+         put_symbol(bits,p[pos]);
+         if(pos+min_match <= len) insert(pos);
+         pos++;
+      }
+   }
+
+   // end of block, followed by an empty stored block to align on a byte boundary
+   put_symbol(bits,256);
+   bits.put(0,3);
+   bits.align();
+   out += std::string("\x00\x00\xFF\xFF",4);
+
+   // incompressible data is stored instead, in blocks of max 64K
+   if(out.size()-out_start > len + 5*(len/0xFFFF + 1)) {
+      out.resize(out_start);
+      size_t first = 0;
+      do {
+         uint32_t n = uint32_t(std::min(size_t(0xFFFF),len-first));
+         out += char(0);   // not final, stored
+         out += char(n & 0xFF);
+         out += char(n >> 8);
+         out += char(~n & 0xFF);
+         out += char((~n >> 8) & 0xFF);
+         out.append(data+first,n);
+         first += n;
+      } while(first < len);
+   }
+}
+
+uint32_t zip_writer::crc32(uint32_t crc, const char* data, size_t len)
+{
+   struct crc_table {
+      uint32_t value[256];
+      crc_table()
+      {
+         for(uint32_t i=0; i<256; i++) {
+            uint32_t c = i;
+            for(int k=0; k<8; k++) c = (c&1)? (0xEDB88320u ^ (c>>1)) : (c>>1);
+            value[i] = c;
+         }
+      }
+   };
+   static const crc_table table;
+
+   crc = ~crc;
+   const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+   for(size_t i=0; i<len; i++) {
+      crc = table.value[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+   }
+   return ~crc;
+}
+
+// little endian integers for zip headers
+static void put16(std::string& out, uint32_t value)
+{
+   out += char(value & 0xFF);
+   out += char((value>>8) & 0xFF);
+}
+
+static void put32(std::string& out, uint32_t value)
+{
+   put16(out,value & 0xFFFF);
+   put16(out,value >> 16);
+}
+
+zip_writer::zip_writer()
+: m_offset(0)
+, m_in_entry(false)
+, m_entry_size(0)
+, m_entry_csize(0)
+, m_entry_crc(0)
+, m_dos_time(0)
+, m_dos_date(0)
+{}
+
+zip_writer::~zip_writer()
+{
+   // errors are reported by explicit close() only
+   try { close(); }
+   catch(...) {}
+}
+
+bool zip_writer::open(const std::string& path)
+{
+   m_entries.clear();
+   m_offset   = 0;
+   m_in_entry = false;
+   m_out.open(path,std::ios::binary);
+
+   // all entries get the time the archive was opened, in MS-DOS format
+   time_t now = time(0);
+   const struct tm* t = localtime(&now);
+   m_dos_time = uint16_t((t->tm_hour<<11) | (t->tm_min<<5) | (t->tm_sec/2));
+   m_dos_date = uint16_t(((std::max(t->tm_year,80)-80)<<9) | ((t->tm_mon+1)<<5) | t->tm_mday);
+
+   return m_out.is_open();
+}
+
+uint32_t zip_writer::checked(uint64_t value) const
+{
+   if(value > 0xFFFFFFFFu) throw std::runtime_error("zip_writer: archive exceeds 4GB, zip64 is not supported");
+   return uint32_t(value);
+}
+
+void zip_writer::write_raw(const std::string& bytes)
+{
+   m_out.write(bytes.data(),bytes.size());
+   if(!m_out) throw std::runtime_error("zip_writer: write error");
+   m_offset += bytes.size();
+}
+
+void zip_writer::begin_entry(const std::string& name)
+{
+   end_entry();
+
+   entry e;
+   e.name   = name;
+   e.crc    = 0;
+   e.compressed_size = 0;
+   e.size   = 0;
+   e.offset = checked(m_offset);
+   m_entries.push_back(e);
+
+   // local file header, crc and sizes follow in the data descriptor
+   std::string header;
+   put32(header,0x04034b50);
+   put16(header,20);        // version needed to extract
+   put16(header,0x0008);    // data descriptor follows
+   put16(header,8);         // deflate
+   put16(header,m_dos_time);
+   put16(header,m_dos_date);
+   put32(header,0);
+   put32(header,0);
+   put32(header,0);
+   put16(header,uint32_t(name.size()));
+   put16(header,0);
+   header += name;
+   write_raw(header);
+
+   m_in_entry    = true;
+   m_entry_size  = 0;
+   m_entry_csize = 0;
+   m_entry_crc   = 0;
+   m_pending.clear();
+}
+
+void zip_writer::write(const char* data, size_t len)
+{
+   if(!m_in_entry) throw std::logic_error("zip_writer: write outside entry");
+
+   m_entry_crc   = crc32(m_entry_crc,data,len);
+   m_entry_size += len;
+   m_pending.append(data,len);
+   if(m_pending.size() >= 2*thread_pool::singleton().nthreads()*deflate_chunk_bytes) {
+      compress_pending();
+   }
+}
+
+size_t zip_writer::deflate_chunk_size()
+{
+   return deflate_chunk_bytes;
+}
+
+void zip_writer::deflate_parallel(const char* data, size_t len, std::vector<std::string>& compressed)
+{
+   const size_t nchunk = (len + deflate_chunk_bytes-1)/deflate_chunk_bytes;
+   compressed.assign(nchunk,std::string());
+   auto compress = [data,len,&compressed](size_t ichunk) {
+      size_t first = ichunk*deflate_chunk_bytes;
+      size_t clen  = std::min(deflate_chunk_bytes,len-first);
+      deflate_chunk(data+first,clen,compressed[ichunk]);
+   };
+
+   if(nchunk <= 1 || thread_pool::singleton().nthreads() <= 1) {
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) compress(ichunk);
+   }
+   else {
+      task_group tasks;
+      for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+         tasks.run([&compress,ichunk]() { compress(ichunk); });
+      }
+      tasks.wait();
+   }
+}
+
+void zip_writer::compress_pending()
+{
+   std::vector<std::string> compressed;
+   deflate_parallel(m_pending.data(),m_pending.size(),compressed);
+   for(auto& c : compressed) {
+      write_raw(c);
+      m_entry_csize += c.size();
+   }
+   m_pending.clear();
+}
+
+void zip_writer::end_entry()
+{
+   if(!m_in_entry) return;
+
+   compress_pending();
+
+   // final empty fixed Huffman block terminates the deflate stream
+   write_raw(std::string("\x03\x00",2));
+   m_entry_csize += 2;
+
+   entry& e = m_entries.back();
+   e.crc    = m_entry_crc;
+   e.compressed_size = checked(m_entry_csize);
+   e.size   = checked(m_entry_size);
+
+   std::string descriptor;
+   put32(descriptor,0x08074b50);
+   put32(descriptor,e.crc);
+   put32(descriptor,e.compressed_size);
+   put32(descriptor,e.size);
+   write_raw(descriptor);
+
+   m_in_entry = false;
+   m_pending.clear();
+   m_pending.shrink_to_fit();
+}
+
+void zip_writer::close()
+{
+   if(!m_out.is_open()) return;
+
+   end_entry();
+
+   const uint32_t cd_offset = checked(m_offset);
+   std::string cd;
+   for(auto& e : m_entries) {
+      put32(cd,0x02014b50);
+      put16(cd,20);       // version made by
+      put16(cd,20);       // version needed to extract
+      put16(cd,0x0008);
+      put16(cd,8);
+      put16(cd,m_dos_time);
+      put16(cd,m_dos_date);
+      put32(cd,e.crc);
+      put32(cd,e.compressed_size);
+      put32(cd,e.size);
+      put16(cd,uint32_t(e.name.size()));
+      put16(cd,0);        // extra field length
+      put16(cd,0);        // comment length
+      put16(cd,0);        // disk number
+      put16(cd,0);        // internal attributes
+      put32(cd,0);        // external attributes
+      put32(cd,e.offset);
+      cd += e.name;
+   }
+   write_raw(cd);
+
+   std::string end;
+   put32(end,0x06054b50);
+   put16(end,0);
+   put16(end,0);
+   put16(end,uint32_t(m_entries.size()));
+   put16(end,uint32_t(m_entries.size()));
+   put32(end,checked(cd.size()));
+   put32(end,cd_offset);
+   put16(end,0);
+   write_raw(end);
+
+   m_out.close();
+}
@@ -0,0 +1,93 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+#ifndef ZIP_WRITER_H
+#define ZIP_WRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+// zip_writer streams entries into a zip archive, as used for compressed AMF and 3MF.
+// Entry data is buffered and compressed with deflate in independent chunks that are
+// compressed in parallel on the thread_pool and written in order, so the memory used
+// is bounded regardless of entry size. Sizes and CRC are written after each entry
+// (data descriptor), so nothing is seeked back. Zip64 is not supported, archives
+// must be smaller than 4GB.
+
+class zip_writer {
+public:
+   zip_writer();
+   virtual ~zip_writer();
+
+   // open archive file for writing, returns true if ok
+   bool open(const std::string& path);
+   bool is_open() const { return m_out.is_open(); }
+
+   // start a new entry with given name in archive, any previous entry is closed
+   void begin_entry(const std::string& name);
+
+   // append data to the current entry
+   void write(const char* data, size_t len);
+   void write(const std::string& text) { write(text.data(),text.size()); }
+
+   // finish the current entry, if any
+   void end_entry();
+
+   // finish the archive with its central directory and close the file
+   void close();
+
+   // compress data with raw deflate (no zlib header), as independent of any other chunk.
+   // The result is appended to out and ends on a byte boundary with a non-final block,
+   // so compressed chunks can be concatenated. A final empty block must terminate the stream
+   static void deflate_chunk(const char* data, size_t len, std::string& out);
+
+   // compress data as consecutive deflate chunks in parallel on the thread_pool, one string per chunk.
+   // The chunks are written in order, followed by a final empty block as for deflate_chunk
+   static void deflate_parallel(const char* data, size_t len, std::vector<std::string>& compressed);
+
+   // uncompressed bytes per chunk of deflate_parallel
+   static size_t deflate_chunk_size();
+
+   // update a CRC-32 value with data
+   static uint32_t crc32(uint32_t crc, const char* data, size_t len);
+
+private:
+   struct entry {
+      std::string name;
+      uint32_t    crc;
+      uint32_t    compressed_size;
+      uint32_t    size;
+      uint32_t    offset;
+   };
+
+   void compress_pending();
+   void write_raw(const std::string& bytes);
+   uint32_t checked(uint64_t value) const;
+
+private:
+   std::ofstream      m_out;
+   uint64_t           m_offset;      // bytes written to file
+   std::vector<entry> m_entries;
+   bool               m_in_entry;
+   uint64_t           m_entry_size;  // uncompressed bytes in current entry
+   uint64_t           m_entry_csize; // compressed bytes in current entry
+   uint32_t           m_entry_crc;
+   std::string        m_pending;     // uncompressed data not yet compressed
+   uint16_t           m_dos_time;
+   uint16_t           m_dos_date;
+};
+
+#endif // ZIP_WRITER_H
@@ -0,0 +1,60 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "bench_corpus.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+bench_corpus::bench_corpus()
+{}
+
+bench_corpus::bench_corpus(const std::string& corpus_file)
+{
+   std::ifstream in(corpus_file);
+   if(!in.is_open()) throw std::runtime_error("bench_corpus: cannot open corpus file: " + corpus_file);
+
+   boost::filesystem::path dir = boost::filesystem::absolute(corpus_file).parent_path();
+
+   std::string line;
+   while(std::getline(in,line)) {
+      std::istringstream words(line);
+      std::string file;
+      if(!(words >> file) || file[0]=='#') continue;
+
+      bench_case c;
+      boost::filesystem::path path = dir / file;
+      if(!boost::filesystem::exists(path)) throw std::runtime_error("bench_corpus: file does not exist: " + path.string());
+      c.name = path.stem().string();
+      c.path = path.string();
+
+      std::string option;
+      while(words >> option) c.options.push_back(option);
+      m_cases.push_back(c);
+   }
+}
+
+bench_corpus::~bench_corpus()
+{}
+
+void bench_corpus::filter(const std::string& pattern)
+{
+   std::vector<bench_case> kept;
+   for(auto& c : m_cases) {
+      if(c.name.find(pattern) != std::string::npos) kept.push_back(c);
+   }
+   m_cases.swap(kept);
+}
@@ -0,0 +1,51 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <string>
+#include <vector>
+
+// bench_case is one model of the benchmark corpus and the xcsg options it is run with
+struct bench_case {
+   std::string              name;      // file name without extension
+   std::string              path;      // full path of the .xcsg file
+   std::vector<std::string> options;   // xcsg command line options, e.g. --stl
+};
+
+// bench_corpus reads the list of benchmark cases from a text file.
+// Each line names an .xcsg file relative to the corpus file, followed by
+// the xcsg options to use. Empty lines and lines starting with '#' are ignored
+
+class bench_corpus {
+public:
+   bench_corpus();
+   bench_corpus(const std::string& corpus_file);
+   virtual ~bench_corpus();
+
+   // append a case, e.g. a generated model
+   void add(const bench_case& c) { m_cases.push_back(c); }
+
+   // keep only the cases whose name contains the filter string
+   void filter(const std::string& pattern);
+
+   const std::vector<bench_case>& cases() const { return m_cases; }
+
+private:
+   std::vector<bench_case> m_cases;
+};
+
+#endif // BENCH_CORPUS_H
@@ -0,0 +1,198 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "bench_generator.h"
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include "csg_parser/cf_xmlTree.h"
+
+static const double pi = 4.0*atan(1.0);
+
+// add a tmatrix rotating by angle [deg] around z, then translating by (dx,dy,dz)
+static void add_tmatrix(cf_xmlNode& node, double dx, double dy, double dz, double angle = 0.0)
+{
+   double c = cos(angle*pi/180.0);
+   double s = sin(angle*pi/180.0);
+   const double m[4][4] = { { c, -s, 0, dx }, { s, c, 0, dy }, { 0, 0, 1, dz }, { 0, 0, 0, 1 } };
+
+   cf_xmlNode xml_this = node.add_child("tmatrix");
+   for(size_t irow=0; irow<4; irow++) {
+      cf_xmlNode xml_row = xml_this.add_child("trow");
+      for(size_t icol=0; icol<4; icol++) {
+         ostringstream out;
+         out << 'c' << icol;
+         xml_row.add_property(out.str(),m[irow][icol]);
+      }
+   }
+}
+
+// smallest k with k^dim >= n
+static size_t grid_size(size_t n, int dim)
+{
+   size_t k = 1;
+   while(static_cast<size_t>(pow(double(k),dim)) < n) k++;
+   return k;
+}
+
+// sphere i of n on a cubic grid, neighbours overlap
+static void add_ball(cf_xmlNode& parent, size_t i, size_t n)
+{
+   const double r = 10.0;
+   size_t k = grid_size(n,3);
+   cf_xmlNode sphere = parent.add_child("sphere");
+   sphere.add_property("r",r);
+   add_tmatrix(sphere,1.5*r*(i%k),1.5*r*((i/k)%k),1.5*r*(i/(k*k)));
+}
+
+// balls first to last as a balanced tree of binary unions
+static void add_balls_nested(cf_xmlNode& parent, size_t first, size_t last, size_t n)
+{
+   if(last-first == 1) {
+      add_ball(parent,first,n);
+      return;
+   }
+   cf_xmlNode node = parent.add_child("union3d");
+   size_t mid = first + (last-first)/2;
+   add_balls_nested(node,first,mid,n);
+   add_balls_nested(node,mid,last,n);
+}
+
+// a plate with n holes on a square grid
+static void add_plate(cf_xmlNode& parent, size_t n)
+{
+   const double pitch = 10.0;
+   size_t k = grid_size(n,2);
+   cf_xmlNode diff = parent.add_child("difference3d");
+   cf_xmlNode cuboid = diff.add_child("cuboid");
+   cuboid.add_property("dx",pitch*k);
+   cuboid.add_property("dy",pitch*k);
+   cuboid.add_property("dz",5.0);
+   for(size_t i=0; i<n; i++) {
+      cf_xmlNode cyl = diff.add_child("cylinder");
+      cyl.add_property("r",3.0);
+      cyl.add_property("h",20.0);
+      cyl.add_property("center","true");
+      add_tmatrix(cyl,pitch*(i%k+0.5),pitch*(i/k+0.5),0.0);
+   }
+}
+
+const std::vector<std::string>& bench_generator::models()
+{
+   static const std::vector<std::string> names = { "balls_flat", "balls_nested", "plate", "transforms", "nest2d", "sweep", "minkowski" };
+   return names;
+}
+
+bench_case bench_generator::write(const std::string& model, size_t n, const std::string& dir)
+{
+   if(n < 1) throw std::logic_error("bench_generator: size must be 1 or larger");
+
+   cf_xmlTree tree;
+   cf_xmlNode root;
+   tree.create_root("xcsg");
+   tree.get_root(root);
+   root.add_property("version","1.0");
+   root.add_property("secant_tolerance",0.05);
+
+   if(model == "balls_flat")        balls_flat(root,n);
+   else if(model == "balls_nested") balls_nested(root,n);
+   else if(model == "plate")        plate(root,n);
+   else if(model == "transforms")   transforms(root,n);
+   else if(model == "nest2d")       nest2d(root,n);
+   else if(model == "sweep")        sweep(root,n);
+   else if(model == "minkowski")    minkowski(root,n);
+   else throw std::logic_error("bench_generator: unknown model '" + model + "'");
+
+   bench_case c;
+   c.name = model + "_" + std::to_string(n);
+   c.path = (boost::filesystem::path(dir) / (c.name + ".xcsg")).string();
+   c.options.push_back((model == "nest2d")? "--dxf" : "--stl");
+   boost::filesystem::create_directories(dir);
+   if(!tree.write_xml(c.path)) throw std::runtime_error("bench_generator: could not write " + c.path);
+   return c;
+}
+
+void bench_generator::balls_flat(cf_xmlNode& parent, size_t n)
+{
+   cf_xmlNode node = parent.add_child("union3d");
+   for(size_t i=0; i<n; i++) add_ball(node,i,n);
+}
+
+void bench_generator::balls_nested(cf_xmlNode& parent, size_t n)
+{
+   cf_xmlNode node = parent.add_child("union3d");
+   add_balls_nested(node,0,n,n);
+}
+
+void bench_generator::plate(cf_xmlNode& parent, size_t n)
+{
+   add_plate(parent,n);
+}
+
+void bench_generator::transforms(cf_xmlNode& parent, size_t n)
+{
+   // each level is rotated and lifted relative to its parent, so the innermost
+   // sphere is transformed by a product of n matrices
+   cf_xmlNode node = parent;
+   for(size_t i=0; i<n; i++) {
+      cf_xmlNode level = node.add_child("union3d");
+      add_tmatrix(level,1.0,0.0,0.5,360.0/n);
+      cf_xmlNode sphere = level.add_child("sphere");
+      sphere.add_property("r",2.0);
+      node = level;
+   }
+   cf_xmlNode cube = node.add_child("cube");
+   cube.add_property("size",2.0);
+}
+
+void bench_generator::nest2d(cf_xmlNode& parent, size_t n)
+{
+   cf_xmlNode node = parent.add_child("union2d");
+   for(size_t i=0; i<n; i++) {
+      double r = 10.0 + 3.0*i;
+      cf_xmlNode ring = node.add_child("difference2d");
+      cf_xmlNode outer = ring.add_child("circle");
+      outer.add_property("r",r + 2.0);
+      cf_xmlNode inner = ring.add_child("circle");
+      inner.add_property("r",r);
+   }
+}
+
+void bench_generator::sweep(cf_xmlNode& parent, size_t n)
+{
+   // helix with 8 control points per turn
+   cf_xmlNode node = parent.add_child("sweep");
+   node.add_child("circle").add_property("r",2.0);
+   cf_xmlNode path = node.add_child("spline_path");
+   const size_t ncp = std::max(n,size_t(2));
+   for(size_t i=0; i<ncp; i++) {
+      double a = i*pi/4.0;
+      cf_xmlNode cp = path.add_child("cpoint");
+      cp.add_property("x",30.0*cos(a));
+      cp.add_property("y",30.0*sin(a));
+      cp.add_property("z",1.5*i);
+      cp.add_property("vx",0.0);
+      cp.add_property("vy",0.0);
+      cp.add_property("vz",1.0);
+   }
+}
+
+void bench_generator::minkowski(cf_xmlNode& parent, size_t n)
+{
+   cf_xmlNode node = parent.add_child("minkowski3d");
+   add_plate(node,n);
+   node.add_child("sphere").add_property("r",1.0);
+}
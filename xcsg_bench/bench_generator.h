@@ -0,0 +1,51 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BENCH_GENERATOR_H
+#define BENCH_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include "bench_corpus.h"
+class cf_xmlNode;
+
+// bench_generator writes synthetic .xcsg stress models that scale with a size n:
+//    balls_flat   : n overlapping spheres in one union3d
+//    balls_nested : the same spheres as a balanced tree of binary union3d
+//    plate        : a plate with n holes
+//    transforms   : n nested transformed union3d, each adding a sphere
+//    nest2d       : n concentric 2d rings, 2n contours
+//    sweep        : a circle swept along a spline path with n control points
+//    minkowski    : a plate with n holes rounded by a sphere
+
+class bench_generator {
+public:
+   // the model names
+   static const std::vector<std::string>& models();
+
+   // write model of size n to the directory, returns the case to run
+   static bench_case write(const std::string& model, size_t n, const std::string& dir);
+
+protected:
+   static void balls_flat(cf_xmlNode& parent, size_t n);
+   static void balls_nested(cf_xmlNode& parent, size_t n);
+   static void plate(cf_xmlNode& parent, size_t n);
+   static void transforms(cf_xmlNode& parent, size_t n);
+   static void nest2d(cf_xmlNode& parent, size_t n);
+   static void sweep(cf_xmlNode& parent, size_t n);
+   static void minkowski(cf_xmlNode& parent, size_t n);
+};
+
+#endif // BENCH_GENERATOR_H
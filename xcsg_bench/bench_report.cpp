@@ -0,0 +1,132 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "bench_report.h"
+#include <algorithm>
+#include <iomanip>
+#include <boost/thread.hpp>
+
+// JSON string with quotes and backslashes escaped
+static std::string quoted(const std::string& s)
+{
+   std::string q = "\"";
+   for(char c : s) {
+      if(c=='"' || c=='\\') q += '\\';
+      q += c;
+   }
+   return q + "\"";
+}
+
+bench_report::bench_report(const std::string& xcsg, size_t repeat, size_t warmup)
+: m_xcsg(xcsg)
+, m_repeat(repeat)
+, m_warmup(warmup)
+{}
+
+bench_report::~bench_report()
+{}
+
+double bench_report::median(std::vector<double> values)
+{
+   if(values.size() == 0) return 0.0;
+   std::sort(values.begin(),values.end());
+   size_t n = values.size();
+   return (n%2 == 1)? values[n/2] : 0.5*(values[n/2-1]+values[n/2]);
+}
+
+void bench_report::add(const bench_case& c, size_t threads, const std::vector<bench_sample>& samples)
+{
+   if(m_cases.size()==0 || m_cases.back().name != c.name) {
+      case_results cr;
+      cr.name = c.name;
+      for(auto& o : c.options) cr.options += (cr.options.empty()? "" : " ") + o;
+      m_cases.push_back(cr);
+   }
+
+   // the medians are taken over the successful runs, the peak memory is the largest seen
+   result r;
+   r.threads     = (threads > 0)? threads : std::max(1u,boost::thread::hardware_concurrency());
+   r.nfailed     = 0;
+   r.peak_rss_kb = 0;
+   std::vector<double> wall;
+   std::map<std::string,std::vector<double>> phases;
+   for(auto& s : samples) {
+      if(s.status != 0) {
+         r.nfailed++;
+         continue;
+      }
+      wall.push_back(s.wall);
+      for(auto& p : s.phases) phases[p.first].push_back(p.second);
+      r.peak_rss_kb = std::max(r.peak_rss_kb,s.peak_rss_kb);
+   }
+   r.wall = median(wall);
+   for(auto& p : phases) r.phases[p.first] = median(p.second);
+   m_cases.back().results.push_back(r);
+}
+
+void bench_report::write_summary(std::ostream& out) const
+{
+   if(m_cases.size() == 0 || m_cases.back().results.size() == 0) return;
+   const case_results& cr = m_cases.back();
+   const result& r = cr.results.back();
+   out << std::left << std::setw(24) << cr.name << std::right << " threads=" << std::setw(3) << r.threads
+       << " wall=" << std::fixed << std::setprecision(3) << std::setw(9) << r.wall << " [sec]";
+   for(auto& phase : bench_runner::phases()) {
+      auto i = r.phases.find(phase);
+      if(i != r.phases.end()) out << " " << phase << "=" << i->second;
+   }
+   out << " peak_rss=" << r.peak_rss_kb/1024 << " MB";
+   if(r.nfailed > 0) out << " FAILED " << r.nfailed << " of " << m_repeat;
+   out << std::defaultfloat << std::endl;
+}
+
+void bench_report::write_json(std::ostream& out) const
+{
+   out << std::setprecision(6);
+   out << "{ \"xcsg\": " << quoted(m_xcsg) << ", \"repeat\": " << m_repeat << ", \"warmup\": " << m_warmup
+       << ", \"hardware_threads\": " << boost::thread::hardware_concurrency() << "," << std::endl
+       << "\"cases\": [" << std::endl;
+   for(size_t ic=0; ic<m_cases.size(); ic++) {
+      const case_results& cr = m_cases[ic];
+      out << "{ \"name\": " << quoted(cr.name) << ", \"options\": " << quoted(cr.options) << "," << std::endl
+          << "  \"results\": [" << std::endl;
+      for(size_t ir=0; ir<cr.results.size(); ir++) {
+         const result& r = cr.results[ir];
+         out << "    { \"threads\": " << r.threads << ", \"failed\": " << r.nfailed << ", \"wall\": " << r.wall;
+         for(auto& phase : bench_runner::phases()) {
+            auto i = r.phases.find(phase);
+            if(i != r.phases.end()) out << ", " << quoted(phase) << ": " << i->second;
+         }
+         out << ", \"peak_rss_kb\": " << r.peak_rss_kb << " }" << ((ir+1<cr.results.size())? ",":"") << std::endl;
+      }
+      out << "  ]";
+
+      // speedup and parallel efficiency relative to the first thread count
+      if(cr.results.size() > 1 && cr.results[0].wall > 0.0) {
+         const result& base = cr.results[0];
+         out << "," << std::endl << "  \"scaling\": [" << std::endl;
+         for(size_t ir=0; ir<cr.results.size(); ir++) {
+            const result& r = cr.results[ir];
+            double speedup = (r.wall > 0.0)? base.wall/r.wall : 0.0;
+            double efficiency = speedup*base.threads/r.threads;
+            out << "    { \"threads\": " << r.threads << ", \"speedup\": " << speedup << ", \"efficiency\": " << efficiency << " }"
+                << ((ir+1<cr.results.size())? ",":"") << std::endl;
+         }
+         out << "  ]";
+      }
+      out << std::endl << "}" << ((ic+1<m_cases.size())? ",":"") << std::endl;
+   }
+   out << "]}" << std::endl;
+}
@@ -0,0 +1,62 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <ostream>
+#include "bench_runner.h"
+
+// bench_report collects the samples of each case and thread count, and writes
+// their medians as JSON. With several thread counts, the wall time medians
+// also give the thread scaling curve of the case, relative to the first count.
+
+class bench_report {
+public:
+   bench_report(const std::string& xcsg, size_t repeat, size_t warmup);
+   virtual ~bench_report();
+
+   // add the samples of running case c with the given number of threads
+   void add(const bench_case& c, size_t threads, const std::vector<bench_sample>& samples);
+
+   // write a one line summary of the last case added
+   void write_summary(std::ostream& out) const;
+
+   void write_json(std::ostream& out) const;
+
+   // median of the values, 0 if there are none
+   static double median(std::vector<double> values);
+
+private:
+   struct result {
+      size_t threads;
+      size_t nfailed;
+      double wall;
+      std::map<std::string,double> phases;
+      size_t peak_rss_kb;
+   };
+   struct case_results {
+      std::string         name;
+      std::string         options;
+      std::vector<result> results;
+   };
+
+   std::string               m_xcsg;
+   size_t                    m_repeat;
+   size_t                    m_warmup;
+   std::vector<case_results> m_cases;
+};
+
+#endif // BENCH_REPORT_H
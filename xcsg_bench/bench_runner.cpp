@@ -0,0 +1,198 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "bench_runner.h"
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+#include <boost/date_time.hpp>
+
+#ifdef _WIN32
+   #include <windows.h>
+   #include <psapi.h>
+#else
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/wait.h>
+   #include <sys/resource.h>
+#endif
+
+// trace event categories for each reported phase
+static const char* phase_category(const std::string& phase)
+{
+   if(phase == "parse")       return "parse";
+   if(phase == "mesh")        return "mesh";
+   if(phase == "boolean")     return "csg";
+   if(phase == "triangulate") return "triangulation";
+   if(phase == "export")      return "export";
+   return "";
+}
+
+// the number following "key": in a trace event line, false if it is missing
+static bool trace_number(const std::string& line, const std::string& key, long long& value)
+{
+   size_t pos = line.find("\"" + key + "\":");
+   if(pos == std::string::npos) return false;
+   value = std::atoll(line.c_str() + pos + key.length() + 3);
+   return true;
+}
+
+// the string following "key": in a trace event line, empty if it is missing
+static std::string trace_string(const std::string& line, const std::string& key)
+{
+   size_t pos = line.find("\"" + key + "\":\"");
+   if(pos == std::string::npos) return "";
+   pos += key.length() + 4;
+   return line.substr(pos,line.find('"',pos)-pos);
+}
+
+bench_runner::bench_runner(const std::string& xcsg, const std::string& work_dir)
+: m_xcsg(xcsg)
+, m_work_dir(work_dir)
+{
+   boost::filesystem::create_directories(m_work_dir);
+}
+
+bench_runner::~bench_runner()
+{}
+
+const std::vector<std::string>& bench_runner::phases()
+{
+   static const std::vector<std::string> names = { "parse", "mesh", "boolean", "triangulate", "export" };
+   return names;
+}
+
+bench_sample bench_runner::run(const bench_case& c, size_t threads)
+{
+   boost::filesystem::path dir(m_work_dir);
+   boost::filesystem::path input = dir / boost::filesystem::path(c.path).filename();
+   boost::filesystem::path trace = dir / (c.name + ".trace.json");
+   boost::filesystem::path log   = dir / (c.name + ".log");
+   boost::filesystem::copy_file(c.path,input,boost::filesystem::copy_option::overwrite_if_exists);
+   boost::filesystem::remove(trace);
+
+   std::vector<std::string> args;
+   args.push_back(m_xcsg);
+   args.insert(args.end(),c.options.begin(),c.options.end());
+   if(threads > 0) {
+      args.push_back("--threads");
+      args.push_back(std::to_string(threads));
+   }
+   args.push_back("--trace");
+   args.push_back(trace.string());
+   args.push_back(input.string());
+
+   bench_sample sample;
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   sample.status = spawn(args,log.string(),sample.peak_rss_kb);
+   sample.wall   = 1.0E-6*(boost::posix_time::microsec_clock::universal_time() - time_0).total_microseconds();
+   if(sample.status == 0) read_trace(trace.string(),sample.phases);
+   return sample;
+}
+
+void bench_runner::read_trace(const std::string& path, std::map<std::string,double>& times)
+{
+   std::map<std::string,std::pair<long long,long long>> extent;
+   std::ifstream in(path);
+   std::string line;
+   while(std::getline(in,line)) {
+      long long ts=0,dur=0;
+      if(!trace_number(line,"ts",ts) || !trace_number(line,"dur",dur)) continue;
+
+      std::string category = trace_string(line,"cat");
+      auto i = extent.find(category);
+      if(i == extent.end()) extent[category] = std::make_pair(ts,ts+dur);
+      else {
+         i->second.first  = std::min(i->second.first,ts);
+         i->second.second = std::max(i->second.second,ts+dur);
+      }
+   }
+
+   for(auto& phase : phases()) {
+      auto i = extent.find(phase_category(phase));
+      if(i != extent.end()) times[phase] = 1.0E-6*(i->second.second - i->second.first);
+   }
+}
+
+#ifdef _WIN32
+
+int bench_runner::spawn(const std::vector<std::string>& args, const std::string& log, size_t& peak_rss_kb)
+{
+   std::string cmd;
+   for(auto& a : args) cmd += (cmd.empty()? "\"" : " \"") + a + "\"";
+
+   SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+   HANDLE out = CreateFileA(log.c_str(),GENERIC_WRITE,FILE_SHARE_READ,&sa,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+
+   STARTUPINFOA si;
+   ZeroMemory(&si,sizeof(si));
+   si.cb         = sizeof(si);
+   si.dwFlags    = STARTF_USESTDHANDLES;
+   si.hStdOutput = out;
+   si.hStdError  = out;
+   PROCESS_INFORMATION pi;
+   std::vector<char> cmd_line(cmd.begin(),cmd.end());
+   cmd_line.push_back(0);
+   if(!CreateProcessA(NULL,&cmd_line[0],NULL,NULL,TRUE,0,NULL,NULL,&si,&pi)) {
+      CloseHandle(out);
+      return -1;
+   }
+   WaitForSingleObject(pi.hProcess,INFINITE);
+
+   DWORD status = 0;
+   GetExitCodeProcess(pi.hProcess,&status);
+   PROCESS_MEMORY_COUNTERS pmc;
+   if(GetProcessMemoryInfo(pi.hProcess,&pmc,sizeof(pmc))) peak_rss_kb = pmc.PeakWorkingSetSize/1024;
+   CloseHandle(pi.hProcess);
+   CloseHandle(pi.hThread);
+   CloseHandle(out);
+   return static_cast<int>(status);
+}
+
+#else
+
+int bench_runner::spawn(const std::vector<std::string>& args, const std::string& log, size_t& peak_rss_kb)
+{
+   std::vector<char*> argv;
+   for(auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+   argv.push_back(nullptr);
+
+   pid_t pid = fork();
+   if(pid < 0) return -1;
+   if(pid == 0) {
+      int fd = open(log.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+      if(fd >= 0) {
+         dup2(fd,STDOUT_FILENO);
+         dup2(fd,STDERR_FILENO);
+         close(fd);
+      }
+      execvp(argv[0],&argv[0]);
+      _exit(127);
+   }
+
+   int status = 0;
+   struct rusage usage;
+   if(wait4(pid,&status,0,&usage) < 0) return -1;
+#ifdef __APPLE__
+   peak_rss_kb = static_cast<size_t>(usage.ru_maxrss)/1024;
+#else
+   peak_rss_kb = static_cast<size_t>(usage.ru_maxrss);
+#endif
+   return WIFEXITED(status)? WEXITSTATUS(status) : -1;
+}
+
+#endif
@@ -0,0 +1,61 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BENCH_RUNNER_H
+#define BENCH_RUNNER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "bench_corpus.h"
+
+// bench_sample is the outcome of one xcsg run
+struct bench_sample {
+   bench_sample() : status(0), wall(0.0), peak_rss_kb(0) {}
+   int                           status;      // xcsg exit status, -1 if it could not be started
+   double                        wall;        // elapsed time of the whole process [sec]
+   std::map<std::string,double>  phases;      // elapsed time per phase [sec]
+   size_t                        peak_rss_kb; // peak resident set size of the process
+};
+
+// bench_runner runs the xcsg executable on a benchmark case, in a copy of the
+// input file under the work directory so the sample folders are not written to.
+// The phase times are taken from the xcsg trace file (--trace), as the time from
+// the first span of each phase category to the end of its last span.
+
+class bench_runner {
+public:
+   bench_runner(const std::string& xcsg, const std::string& work_dir);
+   virtual ~bench_runner();
+
+   // the phases reported, in order
+   static const std::vector<std::string>& phases();
+
+   // run the case once, threads=0 means the xcsg default
+   bench_sample run(const bench_case& c, size_t threads);
+
+protected:
+   // run the command with stdout and stderr written to log, returns the exit status
+   static int spawn(const std::vector<std::string>& args, const std::string& log, size_t& peak_rss_kb);
+
+   // the phase times of a trace file
+   static void read_trace(const std::string& path, std::map<std::string,double>& times);
+
+private:
+   std::string m_xcsg;
+   std::string m_work_dir;
+};
+
+#endif // BENCH_RUNNER_H
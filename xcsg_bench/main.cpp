@@ -0,0 +1,155 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+using namespace std;
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+namespace po = boost::program_options;
+
+#include "bench_corpus.h"
+#include "bench_runner.h"
+#include "bench_report.h"
+#include "bench_generator.h"
+
+// xcsg_bench runs the xcsg executable on a corpus of models, each one repeated
+// after warmup runs, and reports the median times per phase, peak memory and
+// thread scaling as JSON so that releases can be compared.
+
+// positive numbers from a comma separated list
+static std::vector<size_t> parse_counts(const std::string& list, const std::string& what)
+{
+   std::vector<size_t> counts;
+   std::istringstream in(list);
+   std::string item;
+   while(std::getline(in,item,',')) {
+      size_t n = static_cast<size_t>(std::atoi(item.c_str()));
+      if(n == 0) throw std::logic_error("xcsg_bench: invalid " + what + ": " + item);
+      counts.push_back(n);
+   }
+   return counts;
+}
+
+// names from a comma separated list, "all" means all the known names
+static std::vector<std::string> parse_names(const std::string& list, const std::vector<std::string>& known)
+{
+   if(list == "all") return known;
+   std::vector<std::string> names;
+   std::istringstream in(list);
+   std::string item;
+   while(std::getline(in,item,',')) {
+      if(std::find(known.begin(),known.end(),item) == known.end()) throw std::logic_error("xcsg_bench: unknown model: " + item);
+      names.push_back(item);
+   }
+   return names;
+}
+
+int main(int argc, char **argv)
+{
+   po::options_description options("xcsg_bench options");
+   options.add_options()
+        ("help,h", "Show this help")
+        ("xcsg", po::value<std::string>()->default_value("xcsg"), "The xcsg executable to benchmark")
+        ("corpus", po::value<std::string>(), "Corpus file listing the models and their xcsg options")
+        ("repeat", po::value<size_t>()->default_value(5), "Timed runs per case, the medians are reported")
+        ("warmup", po::value<size_t>()->default_value(1), "Untimed runs per case before the timed runs")
+        ("threads", po::value<std::string>(), "Comma separated thread counts, e.g. 1,2,4 (xcsg default)")
+        ("scaling", "Run with 1,2,4.. threads up to the number of cores")
+        ("filter", po::value<std::string>(), "Run only the cases whose name contains this string")
+        ("generate", po::value<std::string>(), "Add generated models to the corpus (all, or balls_flat,balls_nested,plate,transforms,nest2d,sweep,minkowski)")
+        ("size", po::value<std::string>()->default_value("10,100"), "Comma separated sizes of the generated models")
+        ("generate_only", "Write the generated models to the work directory without running them")
+        ("work_dir", po::value<std::string>(), "Directory for the model copies and output files (system temp)")
+        ("json", po::value<std::string>()->default_value("xcsg_bench.json"), "JSON report file")
+        ;
+
+   po::variables_map vm;
+   try {
+      po::store(po::parse_command_line(argc,argv,options),vm);
+      po::notify(vm);
+   }
+   catch(std::exception& ex) {
+      cout << "xcsg_bench: " << ex.what() << endl << options << endl;
+      return 1;
+   }
+   if(vm.count("help") > 0 || (vm.count("corpus") == 0 && vm.count("generate") == 0)) {
+      cout << "usage: xcsg_bench [options] --corpus <corpus-file> --generate <models>" << endl << options << endl;
+      return (vm.count("help") > 0)? 0 : 1;
+   }
+
+   try {
+      std::string work_dir = (vm.count("work_dir") > 0)? vm["work_dir"].as<std::string>()
+                                                       : (boost::filesystem::temp_directory_path() / "xcsg_bench").string();
+
+      bench_corpus corpus;
+      if(vm.count("corpus") > 0) corpus = bench_corpus(vm["corpus"].as<std::string>());
+      if(vm.count("generate") > 0) {
+         std::string dir = (boost::filesystem::path(work_dir) / "generated").string();
+         for(auto& model : parse_names(vm["generate"].as<std::string>(),bench_generator::models())) {
+            for(size_t n : parse_counts(vm["size"].as<std::string>(),"size")) {
+               bench_case c = bench_generator::write(model,n,dir);
+               cout << "Created model: " << c.path << endl;
+               corpus.add(c);
+            }
+         }
+         if(vm.count("generate_only") > 0) return 0;
+      }
+      if(vm.count("filter") > 0) corpus.filter(vm["filter"].as<std::string>());
+
+      std::vector<size_t> threads(1,0);
+      if(vm.count("threads") > 0) threads = parse_counts(vm["threads"].as<std::string>(),"thread count");
+      else if(vm.count("scaling") > 0) {
+         const size_t ncores = std::max(1u,boost::thread::hardware_concurrency());
+         threads.clear();
+         for(size_t n=1; n<ncores; n*=2) threads.push_back(n);
+         threads.push_back(ncores);
+      }
+
+      const std::string xcsg = vm["xcsg"].as<std::string>();
+      const size_t repeat    = std::max(size_t(1),vm["repeat"].as<size_t>());
+      const size_t warmup    = vm["warmup"].as<size_t>();
+
+      bench_runner runner(xcsg,work_dir);
+      bench_report report(xcsg,repeat,warmup);
+      for(auto& c : corpus.cases()) {
+         for(size_t nthreads : threads) {
+            for(size_t i=0; i<warmup; i++) runner.run(c,nthreads);
+
+            std::vector<bench_sample> samples;
+            for(size_t i=0; i<repeat; i++) samples.push_back(runner.run(c,nthreads));
+            report.add(c,nthreads,samples);
+            report.write_summary(cout);
+         }
+      }
+
+      const std::string json_file = vm["json"].as<std::string>();
+      std::ofstream json(json_file);
+      report.write_json(json);
+      if(!json.good()) throw std::runtime_error("xcsg_bench: could not write " + json_file);
+      cout << "Created benchmark report: " << json_file << endl;
+   }
+   catch(std::exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+   return 0;
+}